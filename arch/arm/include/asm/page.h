@@ -141,6 +141,7 @@ extern void __cpu_copy_user_highpage(struct page *to, struct page *from,
 
 #define clear_page(page)	memset((void *)(page), 0, PAGE_SIZE)
 extern void copy_page(void *to, const void *from);
+extern unsigned int copy_page_pld_dist;
 
 #define __HAVE_ARCH_GATE_AREA 1
 
@@ -21,6 +21,7 @@
  */
 enum arm_pmu_type {
 	ARM_PMU_DEVICE_CPU	= 0,
+	ARM_PMU_DEVICE_L2X0,
 	ARM_NUM_PMU_DEVICES,
 };
 
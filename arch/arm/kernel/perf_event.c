@@ -13,6 +13,7 @@
 #define pr_fmt(fmt) "hw perfevents: " fmt
 
 #include <linux/bitmap.h>
+#include <linux/cpu_pm.h>
 #include <linux/interrupt.h>
 #include <linux/kernel.h>
 #include <linux/export.h>
@@ -716,6 +717,84 @@ static struct notifier_block __cpuinitdata pmu_cpu_notifier = {
 	.notifier_call = pmu_cpu_notify,
 };
 
+#ifdef CONFIG_CPU_PM
+/*
+ * Idle states that power the core down take the PMU state with them. Fold
+ * the counts into the events before and program them again after, so that
+ * counting and multiplexed events see no gap or junk across idle.
+ */
+static DEFINE_PER_CPU(unsigned long [BITS_TO_LONGS(ARMPMU_MAX_HWEVENTS)],
+		      pm_stopped_mask);
+
+static void cpu_pm_pmu_setup(struct arm_pmu *armpmu, unsigned long cmd)
+{
+	struct pmu_hw_events *hw_events = armpmu->get_hw_events();
+	unsigned long *stopped = __get_cpu_var(pm_stopped_mask);
+	struct perf_event *event;
+	int idx;
+
+	for (idx = 0; idx < armpmu->num_events; idx++) {
+		event = hw_events->events[idx];
+		if (!test_bit(idx, hw_events->used_mask) || !event)
+			continue;
+
+		switch (cmd) {
+		case CPU_PM_ENTER:
+			/* leave events stopped by the core, e.g. throttled, alone */
+			if (event->hw.state & PERF_HES_STOPPED)
+				break;
+			armpmu_stop(event, PERF_EF_UPDATE);
+			set_bit(idx, stopped);
+			break;
+		case CPU_PM_EXIT:
+		case CPU_PM_ENTER_FAILED:
+			if (test_and_clear_bit(idx, stopped))
+				armpmu_start(event, PERF_EF_RELOAD);
+			break;
+		}
+	}
+}
+
+static int cpu_pm_pmu_notify(struct notifier_block *b, unsigned long cmd,
+			     void *v)
+{
+	struct pmu_hw_events *hw_events = cpu_pmu->get_hw_events();
+
+	/* an unused PMU may belong to someone else, gator for one */
+	if (bitmap_empty(hw_events->used_mask, cpu_pmu->num_events))
+		return NOTIFY_OK;
+
+	switch (cmd) {
+	case CPU_PM_ENTER:
+		cpu_pmu->stop();
+		cpu_pm_pmu_setup(cpu_pmu, cmd);
+		break;
+	case CPU_PM_EXIT:
+	case CPU_PM_ENTER_FAILED:
+		if (cpu_pmu->reset)
+			cpu_pmu->reset(NULL);
+		cpu_pm_pmu_setup(cpu_pmu, cmd);
+		cpu_pmu->start();
+		break;
+	default:
+		return NOTIFY_DONE;
+	}
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block cpu_pm_pmu_notifier = {
+	.notifier_call = cpu_pm_pmu_notify,
+};
+
+static void __init cpu_pm_pmu_init(void)
+{
+	cpu_pm_register_notifier(&cpu_pm_pmu_notifier);
+}
+#else
+static inline void cpu_pm_pmu_init(void) { }
+#endif
+
 /*
  * CPU PMU identification and registration.
  */
@@ -771,6 +850,7 @@ init_hw_perf_events(void)
 			cpu_pmu->name, cpu_pmu->num_events);
 		cpu_pmu_init(cpu_pmu);
 		register_cpu_notifier(&pmu_cpu_notifier);
+		cpu_pm_pmu_init();
 		armpmu_register(cpu_pmu, "cpu", PERF_TYPE_RAW);
 	} else {
 		pr_info("no hardware support available\n");
@@ -24,7 +24,7 @@
 #include <linux/clk.h>
 
 /* inlcude platform specific file */
-#include <linux/cpufreq_pegasusq.h>
+#include <linux/pm_qos_params.h>
 #include <linux/platform_data/modem.h>
 
 #include <plat/gpio-cfg.h>
@@ -515,22 +515,29 @@ static struct modemlink_pm_data umts_link_pm_data = {
 static struct modemlink_pm_link_activectl active_ctl;
 
 #ifdef CONFIG_EXYNOS4_CPUFREQ
+/* each link keeps its own floor, dropping one leaves the other in place */
+static struct pm_qos_request_list umts_usb_online_qos;
+static struct pm_qos_request_list umts_dpram_online_qos;
+
 static int exynos_frequency_lock(struct device *dev)
 {
 	unsigned int level, cpufreq = 600; /* 200 ~ 1400 */
 	unsigned int busfreq = 400200; /* 100100 ~ 400200 */
 	int ret = 0, lock_id;
 	atomic_t *freqlock;
+	struct pm_qos_request_list *online_qos;
 	struct device *busdev = dev_get("exynos-busfreq");
 
 	if (!strcmp(dev->bus->name, "usb")) {
 		lock_id = DVFS_LOCK_ID_USB_IF;
 		cpufreq = 600;
 		freqlock = &umts_link_pm_data.freqlock;
+		online_qos = &umts_usb_online_qos;
 	} else if (!strcmp(dev->bus->name, "platform")) { // for dpram lock
 		lock_id = DVFS_LOCK_ID_DPRAM_IF;
 		cpufreq = 800;
 		freqlock = &umts_link_pm_data.freq_dpramlock;
+		online_qos = &umts_dpram_online_qos;
 	} else {
 		mif_err("ERR: Unkown unlock ID (%s)\n", dev->bus->name);
 		goto exit;
@@ -565,7 +572,7 @@ static int exynos_frequency_lock(struct device *dev)
 		}
 
 		/* lock minimum number of cpu cores */
-		cpufreq_pegasusq_min_cpu_lock(2);
+		pm_qos_add_request(online_qos, PM_QOS_CPU_ONLINE_MIN, 2);
 
 		atomic_set(freqlock, 1);
 		mif_info("level=%d, cpufreq=%d MHz, busfreq=%06d\n",
@@ -579,14 +586,17 @@ static int exynos_frequency_unlock(struct device *dev)
 {
 	int ret = 0, lock_id;
 	atomic_t *freqlock;
+	struct pm_qos_request_list *online_qos;
 	struct device *busdev = dev_get("exynos-busfreq");
 
 	if (!strcmp(dev->bus->name, "usb")) {
 		lock_id = DVFS_LOCK_ID_USB_IF;
 		freqlock = &umts_link_pm_data.freqlock;
+		online_qos = &umts_usb_online_qos;
 	} else if (!strcmp(dev->bus->name, "platform")) { // for dpram lock
 		lock_id = DVFS_LOCK_ID_DPRAM_IF;
 		freqlock = &umts_link_pm_data.freq_dpramlock;
+		online_qos = &umts_dpram_online_qos;
 	} else {
 		mif_err("ERR: Unkown unlock ID (%s)\n", dev->bus->name);
 		goto exit;
@@ -604,7 +614,7 @@ static int exynos_frequency_unlock(struct device *dev)
 		}
 
 		/* unlock minimum number of cpu cores */
-		cpufreq_pegasusq_min_cpu_unlock();
+		pm_qos_remove_request(online_qos);
 
 		atomic_set(freqlock, 0);
 		mif_info("success\n");
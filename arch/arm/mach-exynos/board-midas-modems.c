@@ -21,6 +21,8 @@
 
 #include <linux/platform_data/modem.h>
 
+#include <plat/devs.h>
+
 /* umts target platform data */
 static struct modem_io_t umts_io_devices[] = {
 	[0] = {
@@ -243,7 +245,14 @@ static int __init init_modem(void)
 
 	umts_modem_cfg_gpio();
 	modem_link_pm_config_gpio();
-	platform_device_register(&umts_modem);
+	if (platform_device_register(&umts_modem))
+		return 0;
+
+	/* the modem resumes on its own, once the C2C link it talks over is up */
+	device_enable_async_suspend(&umts_modem.dev);
+#ifdef CONFIG_EXYNOS_C2C
+	device_pm_add_dependency(&umts_modem.dev, &exynos_device_c2c.dev);
+#endif
 
 	return 0;
 }
@@ -321,6 +321,8 @@ int __init brcm_wlan_init(void)
 #endif
 
 	ret =  platform_device_register(&brcm_device_wlan);
+	if (!ret)
+		device_enable_async_suspend(&brcm_device_wlan.dev);
 	printk("-----------------------------------------------------\n");
 	printk("-----------------------------------------------------\n");
 	printk("-----------------------------------------------------\n");
@@ -48,6 +48,8 @@
 #include <plat/gpio-cfg.h>
 #include <plat/cpu.h>
 
+#include <trace/events/dvfs.h>
+
 #define UP_THRESHOLD			30
 #define IDLE_THRESHOLD			4
 #define UP_CPU_THRESHOLD		11
@@ -895,6 +897,8 @@ struct opp *exynos4x12_monitor(struct busfreq_data *data)
 
 	pr_debug("curfreq %ld, newfreq %ld, dmc0_load %ld, dmc1_load %ld, cpu_load %ld\n",
 		currfreq, newfreq, dmc0_load, dmc1_load, cpu_load);
+	trace_dvfs_busfreq(cpu_load, dmc_load, dmc_load_average, cpufreq,
+			   dmcfreq, lockfreq, newfreq);
 
 	opp = opp_find_freq_ceil(data->dev, &newfreq);
 	if (IS_ERR(opp))
@@ -920,7 +924,47 @@ static inline void exynos4x12_bus_qos_notifier_init(struct notifier_block *n)
 	pm_qos_add_notifier(PM_QOS_BUS_QOS, n);
 }
 
-#define ARM_INT_CORRECTION 160160
+/*
+ * Bus level voted for the cpu while it runs above each frequency, highest
+ * first. The vote is raised before a cpu ramp and dropped after the cpu
+ * slowed down, so memory bound work doesn't wait a whole PPMU window for
+ * the bus to follow. The lowest entry also keeps INT high enough for the
+ * ARM above 900MHz.
+ */
+static const struct {
+	unsigned int cpufreq;
+	unsigned int bus_level;
+} exynos4x12_cpufreq_bus_vote[] = {
+	{ 1200000, LV_2 },
+	{  900000, LV_4 },
+};
+
+static unsigned long exynos4x12_cpufreq_bus_voted;
+
+static void exynos4x12_cpufreq_bus_vote_update(struct busfreq_data *data,
+					       unsigned int cpufreq)
+{
+	unsigned long freq = 0;
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(exynos4x12_cpufreq_bus_vote); i++) {
+		if (cpufreq > exynos4x12_cpufreq_bus_vote[i].cpufreq) {
+			freq = exynos4_busfreq_table[
+				exynos4x12_cpufreq_bus_vote[i].bus_level].mem_clk;
+			break;
+		}
+	}
+
+	if (freq == exynos4x12_cpufreq_bus_voted)
+		return;
+
+	if (freq)
+		dev_lock(data->dev, data->dev, freq);
+	else
+		dev_unlock(data->dev, data->dev);
+
+	exynos4x12_cpufreq_bus_voted = freq;
+}
 
 static int exynos4x12_busfreq_cpufreq_transition(struct notifier_block *nb,
 					    unsigned long val, void *data)
@@ -931,12 +975,12 @@ static int exynos4x12_busfreq_cpufreq_transition(struct notifier_block *nb,
 
 	switch (val) {
 	case CPUFREQ_PRECHANGE:
-		if (freqs->new > 900000 && freqs->old < 1000000)
-			dev_lock(bus_data->dev, bus_data->dev, ARM_INT_CORRECTION);
+		if (freqs->new > freqs->old)
+			exynos4x12_cpufreq_bus_vote_update(bus_data, freqs->new);
 		break;
 	case CPUFREQ_POSTCHANGE:
-		if (freqs->old > 900000 && freqs->new < 1000000)
-			dev_unlock(bus_data->dev, bus_data->dev);
+		if (freqs->new < freqs->old)
+			exynos4x12_cpufreq_bus_vote_update(bus_data, freqs->new);
 		break;
 	}
 	return NOTIFY_DONE;
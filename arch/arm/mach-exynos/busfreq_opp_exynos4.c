@@ -42,17 +42,21 @@
 #include <mach/dev.h>
 #include <mach/busfreq_exynos4.h>
 #include <mach/smc.h>
+#include <mach/tmu.h>
 
 #include <plat/map-s5p.h>
 #include <plat/cpu.h>
 #include <plat/clock.h>
 
+#include <trace/events/dvfs.h>
+
 #define BUSFREQ_DEBUG	1
 
 static DEFINE_MUTEX(busfreq_lock);
 
 struct busfreq_control {
 	struct opp *opp_lock;
+	struct opp *opp_thermal;
 	struct device *dev;
 	struct busfreq_data *data;
 	bool init_done;
@@ -60,6 +64,14 @@ struct busfreq_control {
 
 static struct busfreq_control bus_ctrl;
 
+/* levels below max_opp allowed at each TMU throttling level */
+static const unsigned int busfreq_thermal_steps[TMU_THROTTLE_END] = {
+	[TMU_THROTTLE_NONE]	= 0,
+	[TMU_THROTTLE_1ST]	= 0,
+	[TMU_THROTTLE_2ND]	= 2,
+	[TMU_THROTTLE_TRIP]	= 4,
+};
+
 void update_busfreq_stat(struct busfreq_data *data, unsigned int index)
 {
 #ifdef BUSFREQ_DEBUG
@@ -115,6 +127,7 @@ static unsigned int _target(struct busfreq_data *data, struct opp *new)
 	unsigned int voltage;
 	unsigned long newfreq;
 	unsigned long currfreq;
+	ktime_t start;
 
 	newfreq = opp_get_freq(new);
 	currfreq = opp_get_freq(data->curr_opp);
@@ -124,6 +137,7 @@ static unsigned int _target(struct busfreq_data *data, struct opp *new)
 	if (newfreq == 0 || newfreq == currfreq || data->use == false)
 		return data->get_table_index(data->curr_opp);
 
+	start = ktime_get();
 	voltage = opp_get_voltage(new);
 	if (newfreq > currfreq) {
 		regulator_set_voltage(data->vdd_mif, voltage,
@@ -150,6 +164,9 @@ static unsigned int _target(struct busfreq_data *data, struct opp *new)
 	}
 	data->curr_opp = new;
 
+	trace_dvfs_busfreq_change(currfreq, newfreq,
+			ktime_to_us(ktime_sub(ktime_get(), start)));
+
 	return index;
 }
 
@@ -170,11 +187,16 @@ static void exynos_busfreq_timer(struct work_struct *work)
 	if (bus_ctrl.opp_lock)
 		opp = bus_ctrl.opp_lock;
 
+	if (bus_ctrl.opp_thermal &&
+	    opp_get_freq(opp) > opp_get_freq(bus_ctrl.opp_thermal))
+		opp = bus_ctrl.opp_thermal;
+
 	index = _target(data, opp);
 
 	update_busfreq_stat(data, index);
 	mutex_unlock(&busfreq_lock);
-	queue_delayed_work(system_freezable_wq, &data->worker, data->sampling_rate);
+	queue_delayed_work(system_freezable_wq, &data->worker,
+			   align_jiffies_relative(data->sampling_rate));
 }
 
 static int exynos_buspm_notifier_event(struct notifier_block *this,
@@ -221,6 +243,42 @@ static int exynos_busfreq_reboot_event(struct notifier_block *this,
 	return NOTIFY_DONE;
 }
 
+static int exynos_busfreq_tmu_event(struct notifier_block *this,
+		unsigned long event, void *ptr)
+{
+	struct busfreq_data *data = container_of(this, struct busfreq_data,
+			exynos_tmu_notifier);
+	unsigned int level = *(unsigned int *)ptr;
+	struct opp *opp = NULL;
+	unsigned long freq;
+	unsigned int i;
+
+	if (event != TMU_THROTTLE_CHANGE || level >= TMU_THROTTLE_END)
+		return NOTIFY_DONE;
+
+	if (busfreq_thermal_steps[level]) {
+		opp = data->max_opp;
+		for (i = 0; i < busfreq_thermal_steps[level]; i++) {
+			struct opp *next;
+
+			if (opp == data->min_opp)
+				break;
+
+			freq = opp_get_freq(opp) - 1;
+			next = opp_find_freq_floor(data->dev, &freq);
+			if (IS_ERR(next))
+				break;
+			opp = next;
+		}
+	}
+
+	mutex_lock(&busfreq_lock);
+	bus_ctrl.opp_thermal = opp;
+	mutex_unlock(&busfreq_lock);
+
+	return NOTIFY_OK;
+}
+
 int exynos_busfreq_lock(unsigned int nId,
 	enum busfreq_level_request busfreq_level)
 {
@@ -496,6 +554,10 @@ void exynos_request_apply(unsigned long freq)
 	if (bus_ctrl.opp_lock)
 		opp = bus_ctrl.opp_lock;
 
+	if (bus_ctrl.opp_thermal &&
+	    opp_get_freq(opp) > opp_get_freq(bus_ctrl.opp_thermal))
+		opp = bus_ctrl.opp_thermal;
+
 	if (opp_get_freq(bus_ctrl.data->curr_opp) >= opp_get_freq(opp))
 		goto out;
 
@@ -535,6 +597,8 @@ static __devinit int exynos_busfreq_probe(struct platform_device *pdev)
 		exynos_buspm_notifier_event;
 	data->exynos_reboot_notifier.notifier_call =
 		exynos_busfreq_reboot_event;
+	data->exynos_tmu_notifier.notifier_call =
+		exynos_busfreq_tmu_event;
 	data->busfreq_attr_group.attrs = busfreq_attributes;
 
 	if (soc_is_exynos4212() || soc_is_exynos4412()) {
@@ -559,7 +623,8 @@ static __devinit int exynos_busfreq_probe(struct platform_device *pdev)
 	bus_ctrl.dev =  data->dev;
 	bus_ctrl.data =  data;
 
-	INIT_DELAYED_WORK(&data->worker, exynos_busfreq_timer);
+	/* nothing to sample while the cpus are idle, don't wake them */
+	INIT_DELAYED_WORK_DEFERRABLE(&data->worker, exynos_busfreq_timer);
 
 	if (data->init(&pdev->dev, data)) {
 		pr_err("Failed to init busfreq.\n");
@@ -594,6 +659,9 @@ static __devinit int exynos_busfreq_probe(struct platform_device *pdev)
 	if (register_reboot_notifier(&data->exynos_reboot_notifier))
 		pr_err("Failed to setup reboot notifier\n");
 
+	if (exynos_tmu_register_notifier(&data->exynos_tmu_notifier))
+		pr_err("Failed to setup tmu notifier\n");
+
 	platform_set_drvdata(pdev, data);
 
 	queue_delayed_work(system_freezable_wq, &data->worker, 10 * data->sampling_rate);
@@ -619,6 +687,7 @@ static __devexit int exynos_busfreq_remove(struct platform_device *pdev)
 
 	unregister_pm_notifier(&data->exynos_buspm_notifier);
 	unregister_reboot_notifier(&data->exynos_reboot_notifier);
+	exynos_tmu_unregister_notifier(&data->exynos_tmu_notifier);
 	regulator_put(data->vdd_int);
 	regulator_put(data->vdd_mif);
 	sysfs_remove_group(data->busfreq_kobject, &data->busfreq_attr_group);
@@ -126,7 +126,7 @@ err_sysfs:
 	pr_err("CORESIGHT init failed\n");
 	return ret;
 }
-module_init(coresight_init);
+deferred_module_init(coresight_init);
 
 static void __exit coresight_exit(void)
 {
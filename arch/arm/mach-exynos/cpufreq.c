@@ -21,6 +21,8 @@
 #include <linux/suspend.h>
 #include <linux/reboot.h>
 #include <linux/pm_qos_params.h>
+#include <linux/spinlock.h>
+#include <linux/tick.h>
 
 #include <mach/map.h>
 #include <mach/regs-clock.h>
@@ -67,6 +69,84 @@ unsigned int exynos_getspeed(unsigned int cpu)
 	return clk_get_rate(exynos_info->cpu_clk) / 1000;
 }
 
+/*
+ * Busy time of each cpu weighted by the frequency it ran at, so that
+ * getavg can tell governors what a sampling window was really worth
+ * when the clock changed inside it. All cores share the ARM clock, so
+ * every transition closes the current interval of every cpu.
+ */
+struct exynos_busy_info {
+	u64	idle;		/* idle and wall time at the last update */
+	u64	wall;
+	u64	busy;		/* busy us since the last getavg */
+	u64	busy_khz;	/* sum of busy us * kHz since the last getavg */
+};
+
+static DEFINE_PER_CPU(struct exynos_busy_info, exynos_busy_info);
+static DEFINE_SPINLOCK(exynos_busy_lock);
+static unsigned int exynos_busy_freq;
+
+/* caller holds exynos_busy_lock */
+static void exynos_busy_update_cpu(unsigned int cpu)
+{
+	struct exynos_busy_info *info = &per_cpu(exynos_busy_info, cpu);
+	u64 idle, wall;
+	u64 delta_idle, delta_wall;
+
+	idle = get_cpu_idle_time_us(cpu, &wall);
+	if (idle == -1ULL)
+		return;
+
+	delta_idle = idle - info->idle;
+	delta_wall = wall - info->wall;
+	info->idle = idle;
+	info->wall = wall;
+
+	if (delta_wall <= delta_idle)
+		return;
+
+	info->busy += delta_wall - delta_idle;
+	info->busy_khz += (delta_wall - delta_idle) * exynos_busy_freq;
+}
+
+/* called with the clock about to move to new_freq */
+static void exynos_busy_account(unsigned int new_freq)
+{
+	unsigned int cpu;
+
+	spin_lock(&exynos_busy_lock);
+	for_each_possible_cpu(cpu)
+		exynos_busy_update_cpu(cpu);
+	exynos_busy_freq = new_freq;
+	spin_unlock(&exynos_busy_lock);
+}
+
+/*
+ * Average frequency of the busy part of the time since the previous call
+ * for this cpu, or 0 when that is not known, in which case governors use
+ * policy->cur. Busy fraction times this is the frequency invariant load.
+ */
+static unsigned int exynos_getavg(struct cpufreq_policy *policy,
+				  unsigned int cpu)
+{
+	struct exynos_busy_info *info = &per_cpu(exynos_busy_info, cpu);
+	u64 busy_khz;
+	unsigned int avg = 0;
+
+	spin_lock(&exynos_busy_lock);
+	exynos_busy_update_cpu(cpu);
+	if (info->busy) {
+		busy_khz = info->busy_khz;
+		do_div(busy_khz, info->busy);
+		avg = (unsigned int)busy_khz;
+	}
+	info->busy = 0;
+	info->busy_khz = 0;
+	spin_unlock(&exynos_busy_lock);
+
+	return avg;
+}
+
 static unsigned int exynos_get_safe_armvolt(unsigned int old_index, unsigned int new_index)
 {
 	unsigned int safe_arm_volt = 0;
@@ -155,8 +235,10 @@ static int exynos_target(struct cpufreq_policy *policy,
 	if (safe_arm_volt)
 		regulator_set_voltage(arm_regulator, safe_arm_volt,
 				     safe_arm_volt + 25000);
-	if (freqs.new != freqs.old)
+	if (freqs.new != freqs.old) {
+		exynos_busy_account(freqs.new);
 		exynos_info->set_freq(old_index, index);
+	}
 
 	cpufreq_notify_transition(&freqs, CPUFREQ_POSTCHANGE);
 
@@ -344,6 +426,7 @@ int exynos_cpufreq_lock(unsigned int nId,
 		regulator_set_voltage(arm_regulator, arm_volt,
 				     arm_volt + 25000);
 
+		exynos_busy_account(freq_new);
 		exynos_info->set_freq(old_idx, cpufreq_level);
 
 		cpufreq_notify_transition(&freqs, CPUFREQ_POSTCHANGE);
@@ -492,6 +575,7 @@ int exynos_cpufreq_upper_limit(unsigned int nId,
 
 		cpufreq_notify_transition(&freqs, CPUFREQ_PRECHANGE);
 
+		exynos_busy_account(freq_new);
 		exynos_info->set_freq(old_idx, cpufreq_level);
 
 		safe_arm_volt = exynos_get_safe_armvolt(old_idx, cpufreq_level);
@@ -706,6 +790,7 @@ static int exynos_cpufreq_cpu_init(struct cpufreq_policy *policy)
 	int ret;
 
 	policy->cur = policy->min = policy->max = exynos_getspeed(policy->cpu);
+	exynos_busy_freq = policy->cur;
 
 	cpufreq_frequency_table_get_attr(exynos_info->freq_table, policy->cpu);
 
@@ -780,6 +865,7 @@ static struct cpufreq_driver exynos_driver = {
 	.verify		= exynos_verify_speed,
 	.target		= exynos_target,
 	.get		= exynos_getspeed,
+	.getavg		= exynos_getavg,
 	.init		= exynos_cpufreq_cpu_init,
 	.exit		= exynos_cpufreq_cpu_exit,
 	.name		= "exynos_cpufreq",
@@ -17,6 +17,8 @@
 #include <linux/platform_device.h>
 #include <linux/gpio.h>
 #include <linux/cpufreq.h>
+#include <linux/pm_qos.h>
+#include <linux/tick.h>
 
 #include <asm/proc-fns.h>
 #include <asm/tlbflush.h>
@@ -37,6 +39,7 @@
 #include <plat/pm.h>
 #include <plat/devs.h>
 #include <plat/cpu.h>
+#include <plat/pd.h>
 #ifdef CONFIG_SEC_WATCHDOG_RESET
 #include <plat/regs-watchdog.h>
 #endif
@@ -109,6 +112,63 @@ module_param_named(enable_mask, enable_mask, uint, 0644);
 
 #define ENABLE_LOWPWRMASK (ENABLE_AFTR | ENABLE_LPA)
 
+/*
+ * LPA takes far longer to get in and out of than AFTR, and checking whether
+ * it is allowed at all walks a good number of device registers. Only try
+ * it when the expected sleep is long enough to pay for that and no pm_qos
+ * request wants a faster wakeup.
+ */
+static unsigned int lpa_latency = 1000;
+module_param_named(lpa_latency, lpa_latency, uint, 0644);
+
+static unsigned int lpa_residency = 20000;
+module_param_named(lpa_residency, lpa_residency, uint, 0644);
+
+#define IDLE_HISTORY	8
+
+struct idle_history {
+	unsigned int	interval[IDLE_HISTORY];
+	unsigned int	next;
+};
+
+static DEFINE_PER_CPU(struct idle_history, idle_history);
+
+static void idle_history_add(int idle_time)
+{
+	struct idle_history *h = &__get_cpu_var(idle_history);
+
+	h->interval[h->next] = max(idle_time, 1);
+	h->next = (h->next + 1) % IDLE_HISTORY;
+}
+
+/*
+ * Expected length of the coming sleep in us: the time to the next timer,
+ * shortened to the recent average when wakeups have been coming from
+ * interrupts sooner than that.
+ */
+static unsigned int idle_predict(void)
+{
+	struct idle_history *h = &__get_cpu_var(idle_history);
+	struct timespec t = tick_nohz_get_sleep_length();
+	u64 sleep = (u64)t.tv_sec * USEC_PER_SEC + t.tv_nsec / NSEC_PER_USEC;
+	u64 sum = 0;
+	unsigned int i, n = 0;
+
+	for (i = 0; i < IDLE_HISTORY; i++) {
+		if (h->interval[i]) {
+			sum += h->interval[i];
+			n++;
+		}
+	}
+
+	if (n) {
+		do_div(sum, n);
+		sleep = min(sleep, sum);
+	}
+
+	return (unsigned int)min_t(u64, sleep, UINT_MAX);
+}
+
 static struct check_device_op chk_sdhc_op[] = {
 #if defined(CONFIG_EXYNOS4_DEV_DWMCI)
 	{.base = 0, .pdev = &exynos_device_dwmci, .type = HC_MSHC},
@@ -228,33 +288,46 @@ static void exynos4212_gpio_conpdn_reg(void)
 	__raw_writel(val, gpio_base + GPIO_PUD_PDN_OFFSET);
 }
 
+static const struct {
+	enum exynos_pd_block	id;
+	void __iomem		*conf;
+} idle_pd_check[] = {
+	{ PD_LCD0,	S5P_PMU_LCD0_CONF },
+	{ PD_MFC,	S5P_PMU_MFC_CONF },
+	{ PD_G3D,	S5P_PMU_G3D_CONF },
+	{ PD_CAM,	S5P_PMU_CAM_CONF },
+	{ PD_TV,	S5P_PMU_TV_CONF },
+	{ PD_GPS,	S5P_PMU_GPS_CONF },
+};
+
 static int check_power_domain(void)
 {
+	unsigned long managed = 0;
+	unsigned long on = 0;
 	unsigned long tmp;
+	int i;
 
-	tmp = __raw_readl(S5P_PMU_LCD0_CONF);
-	if ((tmp & S5P_INT_LOCAL_PWR_EN) == S5P_INT_LOCAL_PWR_EN)
-		return 1;
-
-	tmp = __raw_readl(S5P_PMU_MFC_CONF);
-	if ((tmp & S5P_INT_LOCAL_PWR_EN) == S5P_INT_LOCAL_PWR_EN)
-		return 1;
-
-	tmp = __raw_readl(S5P_PMU_G3D_CONF);
-	if ((tmp & S5P_INT_LOCAL_PWR_EN) == S5P_INT_LOCAL_PWR_EN)
-		return 1;
-
-	tmp = __raw_readl(S5P_PMU_CAM_CONF);
-	if ((tmp & S5P_INT_LOCAL_PWR_EN) == S5P_INT_LOCAL_PWR_EN)
-		return 1;
+#ifdef CONFIG_PM_RUNTIME
+	/*
+	 * Domains under the power domain driver are tracked as it switches
+	 * them. Without runtime PM, drivers such as Mali write the PMU
+	 * directly, so the registers stay the only reliable source.
+	 */
+	managed = ACCESS_ONCE(exynos_pd_managed_mask);
+	on = ACCESS_ONCE(exynos_pd_on_mask);
+#endif
 
-	tmp = __raw_readl(S5P_PMU_TV_CONF);
-	if ((tmp & S5P_INT_LOCAL_PWR_EN) == S5P_INT_LOCAL_PWR_EN)
-		return 1;
+	for (i = 0; i < ARRAY_SIZE(idle_pd_check); i++) {
+		if (test_bit(idle_pd_check[i].id, &managed)) {
+			if (test_bit(idle_pd_check[i].id, &on))
+				return 1;
+			continue;
+		}
 
-	tmp = __raw_readl(S5P_PMU_GPS_CONF);
-	if ((tmp & S5P_INT_LOCAL_PWR_EN) == S5P_INT_LOCAL_PWR_EN)
-		return 1;
+		tmp = __raw_readl(idle_pd_check[i].conf);
+		if ((tmp & S5P_INT_LOCAL_PWR_EN) == S5P_INT_LOCAL_PWR_EN)
+			return 1;
+	}
 
 	return 0;
 }
@@ -922,9 +995,10 @@ static int exynos4_enter_idle(struct cpuidle_device *dev,
 		cpu_do_idle();
 
 	do_gettimeofday(&after);
-	local_irq_enable();
 	idle_time = (after.tv_sec - before.tv_sec) * USEC_PER_SEC +
 		    (after.tv_usec - before.tv_usec);
+	idle_history_add(idle_time);
+	local_irq_enable();
 
 	return idle_time;
 }
@@ -937,6 +1011,14 @@ static int exynos4_check_entermode(void)
 	if (!mask)
 		return 0;
 
+	/* cheap checks first, device state only when LPA would pay off */
+	if ((mask & ENABLE_LPA) &&
+	    pm_qos_request(PM_QOS_CPU_DMA_LATENCY) < lpa_latency)
+		mask &= ~ENABLE_LPA;
+
+	if ((mask & ENABLE_LPA) && idle_predict() < lpa_residency)
+		mask &= ~ENABLE_LPA;
+
 	if ((mask & ENABLE_LPA) && !exynos4_check_operation())
 		ret = S5P_CHECK_LPA;
 	else if (mask & ENABLE_AFTR)
@@ -994,6 +1076,7 @@ static int exynos4_enter_lowpower(struct cpuidle_device *dev,
 #ifdef CONFIG_CORESIGHT_ETM
 		etm_enable(0);
 #endif
+		idle_history_add(ret);
 	}
 
 	return ret;
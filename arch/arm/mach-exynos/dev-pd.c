@@ -23,6 +23,9 @@
 #include <plat/pd.h>
 #include <plat/bts.h>
 
+unsigned long exynos_pd_managed_mask;
+unsigned long exynos_pd_on_mask;
+
 int exynos_pd_init(struct device *dev)
 {
 	struct samsung_pd_info *pdata =  dev->platform_data;
@@ -34,6 +37,12 @@ int exynos_pd_init(struct device *dev)
 			return -ENOMEM;
 	}
 
+	if (__raw_readl(pdata->base + 0x4) & S5P_INT_LOCAL_PWR_EN)
+		set_bit(pdata->id, &exynos_pd_on_mask);
+	else
+		clear_bit(pdata->id, &exynos_pd_on_mask);
+	set_bit(pdata->id, &exynos_pd_managed_mask);
+
 	return 0;
 }
 
@@ -75,6 +84,7 @@ int exynos_pd_enable(struct device *dev)
 	if (data->clk_base)
 		__raw_writel(tmp, data->clk_base);
 
+	set_bit(pdata->id, &exynos_pd_on_mask);
 	bts_enable(pdata->id);
 	return 0;
 }
@@ -146,6 +156,7 @@ int exynos_pd_disable(struct device *dev)
 		}
 	}
 
+	bts_disable(pdata->id);
 	__raw_writel(0, pdata->base);
 
 	/* Wait max 1ms */
@@ -160,6 +171,8 @@ int exynos_pd_disable(struct device *dev)
 		udelay(1);
 	}
 
+	clear_bit(pdata->id, &exynos_pd_on_mask);
+
 	/* restore clock source register */
 	if (data->clksrc_base)
 		__raw_writel(tmp, data->clksrc_base);
@@ -10,313 +10,113 @@
  * published by the Free Software Foundation.
 */
 
-#include <linux/sched.h>
-#include <linux/cpufreq.h>
+#include <linux/init.h>
 #include <linux/cpu.h>
-#include <linux/err.h>
-#include <linux/notifier.h>
-#include <linux/reboot.h>
-#include <linux/suspend.h>
-#include <linux/io.h>
+#include <linux/exynos_hotplug.h>
+#include <linux/string.h>
 
-#ifdef CONFIG_SLP
-#include <linux/platform_device.h>
-#endif
+#define FREQ_IN_TRG	800000		/* frequency hotplug in trigger, tunnable */
+#define FREQ_TRG_COUNT	5		/* 500ms at the trigger, tunnable */
 
-#include <plat/cpu.h>
-
-static unsigned int total_num_target_freq;
 static unsigned int ctn_freq_in_trg_cnt;	/* continuous frequency hotplug in trigger count */
 static unsigned int ctn_freq_out_trg_cnt;	/* continuous frequency hotplug out trigger count */
-static unsigned int ctn_nr_running_over2;
-static unsigned int ctn_nr_running_over3;
-static unsigned int ctn_nr_running_over4;
-static unsigned int ctn_nr_running_under2;
-static unsigned int ctn_nr_running_under3;
-static unsigned int ctn_nr_running_under4;
-static unsigned int freq_max;			/* max frequency of the dedicated dvfs table */
-static unsigned int freq_min = -1UL;		/* min frequency of the dedicated dvfs table */
-static unsigned int freq_in_trg;		/* frequency hotplug in trigger */
-static unsigned int freq_out_trg;		/* frequency hotplug out trigger */
-static unsigned int can_hotplug;
-#ifdef CONFIG_SLP
-static unsigned int user_lock;			/* Enable/Disable hotplug */
-#endif
-
-static void exynos4_integrated_dvfs_hotplug(unsigned int freq_old,
-					unsigned int freq_new)
-{
-
-	total_num_target_freq++;
-	freq_in_trg = 800000;			/* tunnable */
-	freq_out_trg = freq_min;		/* tunnable */
-
-	if (nr_running() <= 1) {
-		ctn_nr_running_over2 = 0;
-		ctn_nr_running_over3 = 0;
-		ctn_nr_running_over4 = 0;
-		ctn_nr_running_under2++;
-		ctn_nr_running_under3++;
-		ctn_nr_running_under4++;
-	} else if ((nr_running() > 1) && (nr_running() <= 2)) {
-		ctn_nr_running_over2++;
-		ctn_nr_running_over3 = 0;
-		ctn_nr_running_over4 = 0;
-		ctn_nr_running_under2 = 0;
-		ctn_nr_running_under3++;
-		ctn_nr_running_under4++;
-	} else if ((nr_running() > 2) && (nr_running() <= 3)) {
-		ctn_nr_running_over2++;
-		ctn_nr_running_over3++;
-		ctn_nr_running_over4 = 0;
-		ctn_nr_running_under2 = 0;
-		ctn_nr_running_under3 = 0;
-		ctn_nr_running_under4++;
-	} else if (nr_running() > 3) {
-		ctn_nr_running_over2++;
-		ctn_nr_running_over3++;
-		ctn_nr_running_over4++;
-		ctn_nr_running_under2 = 0;
-		ctn_nr_running_under3 = 0;
-		ctn_nr_running_under4 = 0;
-	}
-
-	if ((freq_old >= freq_in_trg) && (freq_new >= freq_in_trg))
-		ctn_freq_in_trg_cnt++;
-	else
-		ctn_freq_in_trg_cnt = 0;
-	if ((freq_old <= freq_out_trg) && (freq_new <= freq_out_trg))
-		ctn_freq_out_trg_cnt++;
-	else
-		ctn_freq_out_trg_cnt = 0;
+static unsigned int freq_old;
 
-	if (soc_is_exynos4412()) {
-		if ((cpu_online(3) == 0) && (nr_running() >= 2) &&
-		   ((freq_old >= freq_in_trg) && (freq_new >= freq_in_trg))) {
-			if ((ctn_nr_running_over2 >= 4) &&
-			   (ctn_freq_in_trg_cnt >= 5)) {
-				/* over 400ms for nr_running(), over 500ms for frequency, tunnable */
-				cpu_up(3);
-				ctn_freq_in_trg_cnt = 0;
-			}
-		} else if ((cpu_online(2) == 0) && (nr_running() >= 3) &&
-			  ((freq_old >= freq_in_trg) && (freq_new >= freq_in_trg))) {
-			if ((ctn_nr_running_over3 >= 4) &&
-			   (ctn_freq_in_trg_cnt >= 5)) {
-				/* over 400ms for nr_running(), over 500ms for frequency, tunnable */
-				cpu_up(2);
-				ctn_freq_in_trg_cnt = 0;
-			}
-		} else if ((cpu_online(1) == 0) && (nr_running() >= 4) &&
-			  ((freq_old >= freq_in_trg) && (freq_new >= freq_in_trg))) {
-			if ((ctn_nr_running_over4 >= 8) &&
-			   (ctn_freq_in_trg_cnt >= 5)) {
-				/* over 800ms for nr_running(), over 500ms for frequency, tunnable */
-				cpu_up(1);
-				ctn_freq_in_trg_cnt = 0;
-			}
-		}
-	} else {
-		if ((cpu_online(1) == 0) && ((freq_old >= freq_in_trg) &&
-		   (freq_new >= freq_in_trg))) {
-			if ((ctn_nr_running_over2 >= 8) &&
-			   (ctn_freq_in_trg_cnt >= 5)) {
-				/* over 800ms  for nr_running(), over 500ms for frequency, tunnable */
-				cpu_up(1);
-				ctn_nr_running_over2 = 0;
-				ctn_freq_in_trg_cnt = 0;
-			}
-		}
-	}
+/*
+ * ctn_nr_running_over[n] counts consecutive samples with at least n
+ * runnable tasks, ctn_nr_running_under[n] those with fewer than n.
+ */
+static unsigned int ctn_nr_running_over[NR_CPUS + 1];
+static unsigned int ctn_nr_running_under[NR_CPUS + 1];
 
-	if (soc_is_exynos4412()) {
-		if ((cpu_online(1) == 1) && (nr_running() < 4) &&
-		   ((freq_old <= freq_out_trg) && (freq_new <= freq_out_trg))) {
-			if ((ctn_nr_running_under4 >= 8) &&
-			   (ctn_freq_out_trg_cnt >= 5)) {
-				/* over 800ms for nr_running(), over 500ms for frequency, tunnable */
-				cpu_down(1);
-				ctn_freq_out_trg_cnt = 0;
-			}
-		} else if ((cpu_online(2) == 1) && (nr_running() < 3) &&
-			  ((freq_old <= freq_out_trg) && (freq_new <= freq_out_trg))) {
-			if ((ctn_nr_running_under3 >= 8) &&
-			   (ctn_freq_out_trg_cnt >= 5)) {
-				/* over 800ms for nr_running(), over 500ms for frequency, tunnable */
-				cpu_down(2);
-				ctn_freq_out_trg_cnt = 0;
-			}
-		} else if ((cpu_online(3) == 1) && (nr_running() < 2) &&
-			  ((freq_old <= freq_out_trg) && (freq_new <= freq_out_trg))) {
-			if ((ctn_nr_running_under2 >= 8) &&
-			   (ctn_freq_out_trg_cnt >= 5)) {
-				/* over 800ms for nr_running(), over 500ms for frequency, tunnable */
-				cpu_down(3);
-				ctn_freq_out_trg_cnt = 0;
-			}
-		}
-	} else {
-		if ((cpu_online(1) == 1) &&
-		   ((freq_old <= freq_out_trg) && (freq_new <= freq_out_trg))) {
-			if ((ctn_nr_running_under2 >= 8) &&
-			   (ctn_freq_out_trg_cnt >= 5)) {
-				/* over 800ms for nr_running(), over 500ms for frequency, tunnable */
-				cpu_down(1);
-				ctn_nr_running_under2 = 0;
-				ctn_freq_out_trg_cnt = 0;
-			}
+static void update_nr_running_counts(unsigned long nr)
+{
+	int n;
+
+	for (n = 2; n <= num_possible_cpus(); n++) {
+		if (nr >= n) {
+			ctn_nr_running_over[n]++;
+			ctn_nr_running_under[n] = 0;
+		} else {
+			ctn_nr_running_over[n] = 0;
+			ctn_nr_running_under[n]++;
 		}
 	}
 }
 
-static int hotplug_cpufreq_transition(struct notifier_block *nb,
-					unsigned long val, void *data)
-{
-	struct cpufreq_freqs *freqs = (struct cpufreq_freqs *)data;
-
-	if ((val == CPUFREQ_POSTCHANGE) && can_hotplug)
-		exynos4_integrated_dvfs_hotplug(freqs->old, freqs->new);
-
-	return 0;
-}
-
-static struct notifier_block dvfs_hotplug = {
-	.notifier_call = hotplug_cpufreq_transition,
-};
-
-static int hotplug_pm_transition(struct notifier_block *nb,
-					unsigned long val, void *data)
+/* 400ms before onlining a core, 800ms for the last one; tunnable */
+static unsigned int up_count(unsigned int n)
 {
-	switch (val) {
-	case PM_SUSPEND_PREPARE:
-		can_hotplug = 0;
-		ctn_freq_in_trg_cnt = 0;
-		ctn_freq_out_trg_cnt = 0;
-		break;
-	case PM_POST_RESTORE:
-	case PM_POST_SUSPEND:
-#ifdef CONFIG_SLP
-		if (!user_lock)
-#endif
-			can_hotplug = 1;
-		break;
-	}
-
-	return 0;
+	return n == num_possible_cpus() ? 8 : 4;
 }
 
-static struct notifier_block pm_hotplug = {
-	.notifier_call = hotplug_pm_transition,
-};
+/* 800ms of fewer runnable tasks than cores before offlining; tunnable */
+#define DOWN_COUNT	8
 
-#ifdef CONFIG_SLP
-static ssize_t user_lock_show(struct device *dev,
-	 struct device_attribute *attr,	char *buf)
+static unsigned int
+exynos4_integrated_dvfs_hotplug(const struct exynos_hotplug_stats *stats)
 {
-	return sprintf(buf, "%u\n", user_lock);
-}
+	unsigned int online = stats->nr_online;
+	unsigned long nr = stats->nr_running;
+	unsigned int freq_new = stats->cur_freq;
+	unsigned int freq_out_trg = stats->min_freq;	/* tunnable */
+	bool freq_in, freq_out;
 
-static ssize_t user_lock_store(struct device *dev,
-	struct device_attribute *attr, const char *buf, size_t count)
-{
-	int ret;
+	update_nr_running_counts(nr);
 
-	ret = sscanf(buf, "%u", &user_lock);
-	if (ret != 1)
-		return -EINVAL;
+	freq_in = (freq_old >= FREQ_IN_TRG) && (freq_new >= FREQ_IN_TRG);
+	freq_out = (freq_old <= freq_out_trg) && (freq_new <= freq_out_trg);
+	freq_old = freq_new;
 
-	if (user_lock)
-		can_hotplug = 0;
+	if (freq_in)
+		ctn_freq_in_trg_cnt++;
 	else
-		can_hotplug = 1;
-
-	return count;
-}
-static DEVICE_ATTR(user_lock, 0644, user_lock_show, user_lock_store);
-
-static int sysfs_pm_hotplug_create(struct device *dev)
-{
-	int ret;
+		ctn_freq_in_trg_cnt = 0;
+	if (freq_out)
+		ctn_freq_out_trg_cnt++;
+	else
+		ctn_freq_out_trg_cnt = 0;
 
-	ret = device_create_file(dev, &dev_attr_user_lock);
+	if (freq_in && online < num_possible_cpus() && nr > online &&
+	    ctn_nr_running_over[online + 1] >= up_count(online + 1) &&
+	    ctn_freq_in_trg_cnt >= FREQ_TRG_COUNT) {
+		ctn_freq_in_trg_cnt = 0;
+		return online + 1;
+	}
 
-	if (ret)
-		device_remove_file(dev, &dev_attr_user_lock);
+	if (freq_out && online > 1 && nr < online &&
+	    ctn_nr_running_under[online] >= DOWN_COUNT &&
+	    ctn_freq_out_trg_cnt >= FREQ_TRG_COUNT) {
+		ctn_freq_out_trg_cnt = 0;
+		return online - 1;
+	}
 
-	return ret;
+	return 0;
 }
 
-static void sysfs_pm_hotplug_remove(struct device *dev)
+static void exynos4_integrated_dvfs_hotplug_reset(void)
 {
-	device_remove_file(dev, &dev_attr_user_lock);
+	ctn_freq_in_trg_cnt = 0;
+	ctn_freq_out_trg_cnt = 0;
+	freq_old = 0;
+	memset(ctn_nr_running_over, 0, sizeof(ctn_nr_running_over));
+	memset(ctn_nr_running_under, 0, sizeof(ctn_nr_running_under));
 }
 
-static struct platform_device exynos_pm_hotplug_device = {
-	.name   = "exynos-dynamic-cpu-hotplug",
-	.id     = -1,
-};
-#endif
-
 /*
- * Note : This function should be called after intialization of CPUFreq
- * driver for exynos4. The cpufreq_frequency_table for exynos4 should be
- * established before calling this function.
+ * The policy used to run from the cpufreq transition notifier; it is now
+ * sampled every 100ms so the trigger counts keep their meaning.
  */
+static struct exynos_hotplug_policy dvfs_nr_running_policy = {
+	.name = "dvfs-nr_running",
+	.rate = HZ / 10,
+	.evaluate = exynos4_integrated_dvfs_hotplug,
+	.reset = exynos4_integrated_dvfs_hotplug_reset,
+};
+
 static int __init exynos4_integrated_dvfs_hotplug_init(void)
 {
-	int i;
-	struct cpufreq_frequency_table *table;
-	unsigned int freq;
-
-#ifdef CONFIG_SLP
-	int ret;
-#endif
-
-	total_num_target_freq = 0;
-	ctn_freq_in_trg_cnt = 0;
-	ctn_freq_out_trg_cnt = 0;
-	ctn_nr_running_over2 = 0;
-	ctn_nr_running_over3 = 0;
-	ctn_nr_running_over4 = 0;
-	ctn_nr_running_under2 = 0;
-	ctn_nr_running_under3 = 0;
-	ctn_nr_running_under4 = 0;
-
-	can_hotplug = 1;
-
-	table = cpufreq_frequency_get_table(0);
-	if (IS_ERR(table)) {
-		printk(KERN_ERR "%s: Check loading cpufreq before\n", __func__);
-		return PTR_ERR(table);
-	}
-
-	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
-		freq = table[i].frequency;
-
-		if (freq != CPUFREQ_ENTRY_INVALID && freq > freq_max)
-			freq_max = freq;
-		else if (freq != CPUFREQ_ENTRY_INVALID && freq_min > freq)
-			freq_min = freq;
-	}
-
-	printk(KERN_INFO "%s, max(%d),min(%d)\n", __func__, freq_max, freq_min);
-
-#ifdef CONFIG_SLP
-	ret = platform_device_register(&exynos_pm_hotplug_device);
-	if (ret) {
-		printk(KERN_ERR "failed register pd\n");
-		return ret;
-	}
-
-	ret = sysfs_pm_hotplug_create(&exynos_pm_hotplug_device.dev);
-	if (ret)
-		printk(KERN_ERR "failed at(%d)\n", __LINE__);
-#endif
-
-	register_pm_notifier(&pm_hotplug);
-
-	return cpufreq_register_notifier(&dvfs_hotplug,
-					 CPUFREQ_TRANSITION_NOTIFIER);
+	return exynos_hotplug_register_policy(&dvfs_nr_running_policy, 0);
 }
 
 late_initcall(exynos4_integrated_dvfs_hotplug_init);
@@ -0,0 +1,536 @@
+/* linux/arch/arm/mach-exynos/hotplug-core.c
+ *
+ * Copyright (c) 2011 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * EXYNOS - dynamic CPU hotplug core
+ *
+ * All dynamic hotplugging goes through here: the sampled policy selected
+ * in Kconfig, the governors that make their own hotplug decisions and the
+ * drivers that need a minimum number of cores online. cpu_up() and
+ * cpu_down() are only ever called under hotplug_core_mutex, so the users
+ * can no longer undo each other's work.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/err.h>
+#include <linux/exynos_hotplug.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/pm_qos_params.h>
+#include <linux/reboot.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/suspend.h>
+#include <linux/tick.h>
+#include <linux/workqueue.h>
+
+#include <trace/events/dvfs.h>
+
+struct cpu_time_info {
+	u64 prev_cpu_idle;
+	u64 prev_cpu_wall;
+	struct sched_nr_snapshot nr_snap;
+};
+
+static DEFINE_PER_CPU(struct cpu_time_info, hotplug_cpu_time);
+static struct sched_nr_snapshot hotplug_nr_snap;
+
+/* runqueue averages come in hundredths; round to whole tasks */
+#define NR_AVG_ROUND(avg)	(((avg) + 50) / 100)
+
+static struct workqueue_struct *hotplug_wq;
+static struct delayed_work hotplug_sample_work;
+static struct work_struct hotplug_apply_work;
+
+/* serialises cpu_up()/cpu_down() and the policy state below */
+static DEFINE_MUTEX(hotplug_core_mutex);
+static struct exynos_hotplug_policy *hotplug_policy;
+static unsigned int governor_count;
+static bool hotplug_suspended;
+static bool hotplug_disabled;
+static unsigned int freq_min, freq_max;
+
+/* protects the locks and limits, which may be changed from atomic context */
+static DEFINE_SPINLOCK(hotplug_limit_lock);
+static unsigned int hotplug_lock_cores;
+static unsigned int hotplug_lock_count;
+static unsigned int hotplug_min_cores;
+static unsigned int hotplug_boost_cores;
+
+static unsigned int user_lock;
+static unsigned int user_min_cpus;
+static unsigned int user_max_cpus;
+
+static void hotplug_get_limits(unsigned int *min, unsigned int *max)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&hotplug_limit_lock, flags);
+	if (hotplug_lock_cores) {
+		*min = *max = hotplug_lock_cores;
+	} else {
+		*max = user_max_cpus ? user_max_cpus : num_possible_cpus();
+		*min = max3(1U, hotplug_min_cores, user_min_cpus);
+		*min = max(*min, hotplug_boost_cores);
+		*min = max_t(unsigned int, *min,
+			     pm_qos_request(PM_QOS_CPU_ONLINE_MIN));
+		*min = min(*min, *max);
+	}
+	spin_unlock_irqrestore(&hotplug_limit_lock, flags);
+}
+
+static void hotplug_sample(struct exynos_hotplug_stats *stats)
+{
+	int i;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->nr_online = num_online_cpus();
+	stats->nr_running = NR_AVG_ROUND(sched_nr_running_avg(-1,
+							&hotplug_nr_snap));
+#ifdef CONFIG_CPU_FREQ
+	stats->cur_freq = cpufreq_quick_get(0);
+#endif
+	stats->min_freq = freq_min;
+	stats->max_freq = freq_max;
+	stats->rq_min = -1UL;
+
+	for_each_online_cpu(i) {
+		struct cpu_time_info *tmp_info = &per_cpu(hotplug_cpu_time, i);
+		u64 cur_wall_time, cur_idle_time;
+		unsigned int idle_time, wall_time;
+
+		cur_idle_time = get_cpu_idle_time_us(i, &cur_wall_time);
+
+		idle_time = (unsigned int)(cur_idle_time -
+					   tmp_info->prev_cpu_idle);
+		tmp_info->prev_cpu_idle = cur_idle_time;
+
+		wall_time = (unsigned int)(cur_wall_time -
+					   tmp_info->prev_cpu_wall);
+		tmp_info->prev_cpu_wall = cur_wall_time;
+
+		if (wall_time && wall_time >= idle_time)
+			stats->cpu_load[i] = 100 * (wall_time - idle_time) /
+					     wall_time;
+		stats->load += stats->cpu_load[i];
+
+		stats->cpu_nr_running[i] = NR_AVG_ROUND(
+			sched_nr_running_avg(i, &tmp_info->nr_snap));
+		if (i && stats->rq_min > stats->cpu_nr_running[i]) {
+			stats->rq_min = stats->cpu_nr_running[i];
+			stats->rq_min_cpu = i;
+		}
+	}
+}
+
+static void hotplug_read_freq_table(void)
+{
+#ifdef CONFIG_CPU_FREQ
+	struct cpufreq_frequency_table *table;
+	unsigned int freq, lo = -1U, hi = 0;
+	int i;
+
+	table = cpufreq_frequency_get_table(0);
+	if (IS_ERR_OR_NULL(table))
+		return;
+
+	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
+		freq = table[i].frequency;
+		if (freq == CPUFREQ_ENTRY_INVALID)
+			continue;
+		hi = max(hi, freq);
+		lo = min(lo, freq);
+	}
+
+	if (hi) {
+		freq_min = lo;
+		freq_max = hi;
+	}
+#endif
+}
+
+/* Called with hotplug_core_mutex held */
+static int hotplug_cpu_set(unsigned int cpu, bool up)
+{
+	ktime_t start = ktime_get();
+	int ret;
+
+	ret = up ? cpu_up(cpu) : cpu_down(cpu);
+	trace_dvfs_hotplug_cpu(cpu, up, ret,
+			       ktime_to_us(ktime_sub(ktime_get(), start)));
+	return ret;
+}
+
+static unsigned int hotplug_pick_down(const struct exynos_hotplug_stats *stats)
+{
+	int cpu;
+
+	if (stats && stats->rq_min_cpu && cpu_online(stats->rq_min_cpu))
+		return stats->rq_min_cpu;
+
+	for (cpu = num_possible_cpus() - 1; cpu > 0; cpu--)
+		if (cpu_online(cpu))
+			return cpu;
+	return 0;
+}
+
+/*
+ * Moves the number of online cpus by at most @max_steps towards @target,
+ * within the current locks and limits. Called with hotplug_core_mutex held.
+ */
+static void hotplug_apply(unsigned int target, unsigned int max_steps,
+			  const struct exynos_hotplug_stats *stats)
+{
+	unsigned int min, max, online;
+	int cpu;
+
+	if (hotplug_disabled || hotplug_suspended)
+		return;
+
+	hotplug_get_limits(&min, &max);
+	target = clamp(target, min, max);
+
+	while (max_steps--) {
+		online = num_online_cpus();
+
+		if (online < target) {
+			cpu = cpumask_next_zero(0, cpu_online_mask);
+			if (cpu >= nr_cpu_ids || hotplug_cpu_set(cpu, true))
+				break;
+		} else if (online > target) {
+			cpu = hotplug_pick_down(stats);
+			stats = NULL;
+			if (!cpu || hotplug_cpu_set(cpu, false))
+				break;
+		} else {
+			break;
+		}
+	}
+}
+
+static void hotplug_sample_fn(struct work_struct *work)
+{
+	struct exynos_hotplug_stats stats;
+	unsigned int target;
+
+	mutex_lock(&hotplug_core_mutex);
+
+	if (!hotplug_policy || governor_count || hotplug_suspended ||
+	    hotplug_disabled)
+		goto out;
+
+	if (!freq_max)
+		hotplug_read_freq_table();
+
+	hotplug_sample(&stats);
+	if (!user_lock) {
+		target = hotplug_policy->evaluate(&stats);
+		trace_dvfs_hotplug_evaluate(hotplug_policy->name,
+					    stats.nr_online, target, stats.load,
+					    stats.nr_running, stats.cur_freq);
+		if (target)
+			hotplug_apply(target, 1, &stats);
+	}
+
+	/* sample on the same ticks as the cpufreq governors */
+	queue_delayed_work_on(0, hotplug_wq, &hotplug_sample_work,
+			      align_jiffies_relative(hotplug_policy->rate));
+out:
+	mutex_unlock(&hotplug_core_mutex);
+}
+
+static void hotplug_apply_fn(struct work_struct *work)
+{
+	mutex_lock(&hotplug_core_mutex);
+	hotplug_apply(num_online_cpus(), num_possible_cpus(), NULL);
+	mutex_unlock(&hotplug_core_mutex);
+}
+
+static void hotplug_kick(void)
+{
+	if (hotplug_wq)
+		queue_work_on(0, hotplug_wq, &hotplug_apply_work);
+}
+
+/* Called with hotplug_core_mutex held */
+static void hotplug_resume_policy(unsigned long delay)
+{
+	if (!hotplug_policy || governor_count)
+		return;
+
+	if (hotplug_policy->reset)
+		hotplug_policy->reset();
+	queue_delayed_work_on(0, hotplug_wq, &hotplug_sample_work, delay);
+}
+
+int exynos_hotplug_register_policy(struct exynos_hotplug_policy *policy,
+				   unsigned long delay)
+{
+	int ret = 0;
+
+	if (!hotplug_wq)
+		return -ENODEV;
+
+	mutex_lock(&hotplug_core_mutex);
+	if (hotplug_policy) {
+		pr_err("%s: %s already registered, ignoring %s\n", __func__,
+		       hotplug_policy->name, policy->name);
+		ret = -EBUSY;
+		goto out;
+	}
+
+	hotplug_policy = policy;
+	hotplug_resume_policy(delay);
+	pr_info("exynos-hotplug: using %s policy\n", policy->name);
+out:
+	mutex_unlock(&hotplug_core_mutex);
+	return ret;
+}
+
+void exynos_hotplug_governor_start(void)
+{
+	mutex_lock(&hotplug_core_mutex);
+	governor_count++;
+	mutex_unlock(&hotplug_core_mutex);
+}
+EXPORT_SYMBOL_GPL(exynos_hotplug_governor_start);
+
+void exynos_hotplug_governor_stop(void)
+{
+	mutex_lock(&hotplug_core_mutex);
+	if (!WARN_ON(!governor_count) && !--governor_count &&
+	    !hotplug_suspended)
+		hotplug_resume_policy(hotplug_policy ? hotplug_policy->rate : 0);
+	mutex_unlock(&hotplug_core_mutex);
+}
+EXPORT_SYMBOL_GPL(exynos_hotplug_governor_stop);
+
+int exynos_hotplug_cpu_up(unsigned int cpu)
+{
+	unsigned int min, max;
+	int ret = 0;
+
+	mutex_lock(&hotplug_core_mutex);
+	if (hotplug_disabled || hotplug_suspended) {
+		ret = -EBUSY;
+		goto out;
+	}
+	if (cpu_online(cpu))
+		goto out;
+
+	hotplug_get_limits(&min, &max);
+	if (num_online_cpus() >= max)
+		ret = -EPERM;
+	else
+		ret = hotplug_cpu_set(cpu, true);
+out:
+	mutex_unlock(&hotplug_core_mutex);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(exynos_hotplug_cpu_up);
+
+int exynos_hotplug_cpu_down(unsigned int cpu)
+{
+	unsigned int min, max;
+	int ret = 0;
+
+	if (!cpu)
+		return -EINVAL;
+
+	mutex_lock(&hotplug_core_mutex);
+	if (hotplug_disabled || hotplug_suspended) {
+		ret = -EBUSY;
+		goto out;
+	}
+	if (!cpu_online(cpu))
+		goto out;
+
+	hotplug_get_limits(&min, &max);
+	if (num_online_cpus() <= min)
+		ret = -EPERM;
+	else
+		ret = hotplug_cpu_set(cpu, false);
+out:
+	mutex_unlock(&hotplug_core_mutex);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(exynos_hotplug_cpu_down);
+
+int exynos_hotplug_lock(unsigned int num_core)
+{
+	unsigned long flags;
+	int ret = 0;
+
+	if (num_core < 1 || num_core > num_possible_cpus())
+		return -EINVAL;
+
+	spin_lock_irqsave(&hotplug_limit_lock, flags);
+	if (hotplug_lock_cores && hotplug_lock_cores < num_core) {
+		ret = -EINVAL;
+	} else if (hotplug_lock_cores == num_core) {
+		hotplug_lock_count++;
+	} else {
+		hotplug_lock_cores = num_core;
+		hotplug_lock_count = 1;
+	}
+	spin_unlock_irqrestore(&hotplug_limit_lock, flags);
+
+	if (!ret)
+		hotplug_kick();
+	return ret;
+}
+EXPORT_SYMBOL_GPL(exynos_hotplug_lock);
+
+int exynos_hotplug_unlock(unsigned int num_core)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&hotplug_limit_lock, flags);
+	if (hotplug_lock_cores == num_core && !--hotplug_lock_count)
+		hotplug_lock_cores = 0;
+	spin_unlock_irqrestore(&hotplug_limit_lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(exynos_hotplug_unlock);
+
+void exynos_hotplug_min_lock(unsigned int num_core)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&hotplug_limit_lock, flags);
+	hotplug_min_cores = min(num_core, num_possible_cpus());
+	spin_unlock_irqrestore(&hotplug_limit_lock, flags);
+
+	hotplug_kick();
+}
+EXPORT_SYMBOL_GPL(exynos_hotplug_min_lock);
+
+void exynos_hotplug_min_unlock(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&hotplug_limit_lock, flags);
+	hotplug_min_cores = 0;
+	spin_unlock_irqrestore(&hotplug_limit_lock, flags);
+}
+EXPORT_SYMBOL_GPL(exynos_hotplug_min_unlock);
+
+/*
+ * The input boost has a floor of its own so that it neither overrides nor
+ * releases a min lock taken by a governor or a driver.
+ */
+void exynos_hotplug_boost(unsigned int num_core)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&hotplug_limit_lock, flags);
+	hotplug_boost_cores = min(num_core, num_possible_cpus());
+	spin_unlock_irqrestore(&hotplug_limit_lock, flags);
+
+	if (num_core)
+		hotplug_kick();
+}
+EXPORT_SYMBOL_GPL(exynos_hotplug_boost);
+
+static int hotplug_limit_set(const char *val, const struct kernel_param *kp)
+{
+	unsigned int n;
+	int ret;
+
+	ret = kstrtouint(val, 0, &n);
+	if (ret)
+		return ret;
+	if (n > num_possible_cpus())
+		return -EINVAL;
+
+	*(unsigned int *)kp->arg = n;
+	hotplug_kick();
+	return 0;
+}
+
+static struct kernel_param_ops hotplug_limit_ops = {
+	.set = hotplug_limit_set,
+	.get = param_get_uint,
+};
+
+module_param_named(lock, user_lock, uint, 0644);
+module_param_cb(min_cpus, &hotplug_limit_ops, &user_min_cpus, 0644);
+module_param_cb(max_cpus, &hotplug_limit_ops, &user_max_cpus, 0644);
+
+static int hotplug_pm_notifier_call(struct notifier_block *this,
+				    unsigned long event, void *ptr)
+{
+	switch (event) {
+	case PM_SUSPEND_PREPARE:
+		mutex_lock(&hotplug_core_mutex);
+		hotplug_suspended = true;
+		mutex_unlock(&hotplug_core_mutex);
+		return NOTIFY_OK;
+	case PM_POST_RESTORE:
+	case PM_POST_SUSPEND:
+		mutex_lock(&hotplug_core_mutex);
+		hotplug_suspended = false;
+		hotplug_resume_policy(hotplug_policy ? hotplug_policy->rate : 0);
+		mutex_unlock(&hotplug_core_mutex);
+		return NOTIFY_OK;
+	}
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block hotplug_pm_notifier = {
+	.notifier_call = hotplug_pm_notifier_call,
+};
+
+static int hotplug_reboot_notifier_call(struct notifier_block *this,
+					unsigned long code, void *_cmd)
+{
+	mutex_lock(&hotplug_core_mutex);
+	pr_info("%s: disabling dynamic hotplug\n", __func__);
+	hotplug_disabled = true;
+	mutex_unlock(&hotplug_core_mutex);
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block hotplug_reboot_notifier = {
+	.notifier_call = hotplug_reboot_notifier_call,
+};
+
+static int hotplug_qos_notifier_call(struct notifier_block *this,
+				     unsigned long val, void *data)
+{
+	hotplug_kick();
+	return NOTIFY_OK;
+}
+
+static struct notifier_block hotplug_qos_notifier = {
+	.notifier_call = hotplug_qos_notifier_call,
+};
+
+static int __init exynos_hotplug_core_init(void)
+{
+	hotplug_wq = alloc_ordered_workqueue("exynos_hotplug", WQ_FREEZABLE);
+	if (!hotplug_wq) {
+		pr_err("%s: creation of hotplug workqueue failed\n", __func__);
+		return -ENOMEM;
+	}
+
+	INIT_DELAYED_WORK_DEFERRABLE(&hotplug_sample_work, hotplug_sample_fn);
+	INIT_WORK(&hotplug_apply_work, hotplug_apply_fn);
+
+	register_pm_notifier(&hotplug_pm_notifier);
+	register_reboot_notifier(&hotplug_reboot_notifier);
+	pm_qos_add_notifier(PM_QOS_CPU_ONLINE_MIN, &hotplug_qos_notifier);
+
+	return 0;
+}
+core_initcall(exynos_hotplug_core_init);
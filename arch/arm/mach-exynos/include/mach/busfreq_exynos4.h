@@ -69,6 +69,7 @@ struct busfreq_data {
 	struct notifier_block exynos_request_notifier;
 	struct notifier_block exynos_cpufreq_notifier;
 	struct notifier_block exynos_busqos_notifier;
+	struct notifier_block exynos_tmu_notifier;
 	struct early_suspend busfreq_early_suspend_handler;
 	struct attribute_group busfreq_attr_group;
 	int (*init)	(struct device *dev, struct busfreq_data *data);
@@ -13,6 +13,8 @@
 #ifndef __ASM_ARCH_PPMU_H
 #define __ASM_ARCH_PPMU_H __FILE__
 
+#include <linux/notifier.h>
+
 #define NUMBER_OF_COUNTER	4
 
 #define PPMU_CNTENS	0x10
@@ -117,6 +119,21 @@ void ppmu_start(struct device *dev);
 void ppmu_update(struct device *dev, int ch);
 void ppmu_reset(struct device *dev);
 
+#define PPMU_HISTORY_SIZE	16
+
+/* Passed to the ppmu notifiers after every window that was read */
+struct ppmu_sample {
+	u64 time;			/* local_clock() at the end */
+	unsigned long updated;		/* mask of the ports read this time */
+	unsigned int load[PPMU_END];	/* busy percent, latest of each port */
+};
+
+/* Notifiers are called in atomic context */
+int ppmu_register_notifier(struct notifier_block *nb);
+int ppmu_unregister_notifier(struct notifier_block *nb);
+/* Average load of a port over its last nr_samples windows */
+unsigned int ppmu_get_load(enum exynos4_ppmu id, unsigned int nr_samples);
+
 extern struct exynos4_ppmu_hw exynos_ppmu[];
 #endif /* __ASM_ARCH_PPMU_H */
 
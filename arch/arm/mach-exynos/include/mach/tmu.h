@@ -0,0 +1,56 @@
+/* linux/arch/arm/mach-exynos/include/mach/tmu.h
+ *
+ * Copyright (c) 2011 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com
+ *
+ * EXYNOS4 - TMU temperature and throttling notification
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#ifndef __ASM_ARCH_TMU_H
+#define __ASM_ARCH_TMU_H __FILE__
+
+#include <linux/notifier.h>
+
+/*
+ * Throttling level decided by the TMU driver. The cpufreq upper limit is
+ * applied by the TMU driver itself; busfreq and the GPU listen for
+ * TMU_THROTTLE_CHANGE and apply their own ceiling for the same level, so
+ * the whole SoC backs off together instead of the cpu alone.
+ */
+enum tmu_throttle_level {
+	TMU_THROTTLE_NONE,
+	TMU_THROTTLE_1ST,
+	TMU_THROTTLE_2ND,
+	TMU_THROTTLE_TRIP,
+	TMU_THROTTLE_END,
+};
+
+/* notifier events, data points to an unsigned int */
+#define TMU_TEMP_CHANGE		1	/* temperature in celsius */
+#define TMU_THROTTLE_CHANGE	2	/* enum tmu_throttle_level */
+
+#ifdef CONFIG_EXYNOS4_SETUP_THERMAL
+/*
+ * A new listener is called once with the current temperature and level
+ * before this returns. Callbacks run from the TMU work with its lock held
+ * and must not call back into the TMU driver.
+ */
+int exynos_tmu_register_notifier(struct notifier_block *nb);
+int exynos_tmu_unregister_notifier(struct notifier_block *nb);
+#else
+static inline int exynos_tmu_register_notifier(struct notifier_block *nb)
+{
+	return 0;
+}
+
+static inline int exynos_tmu_unregister_notifier(struct notifier_block *nb)
+{
+	return 0;
+}
+#endif
+
+#endif /* __ASM_ARCH_TMU_H */
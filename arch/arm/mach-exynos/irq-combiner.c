@@ -114,6 +114,8 @@ static struct irq_chip combiner_chip = {
 
 void __init combiner_cascade_irq(unsigned int combiner_nr, unsigned int irq)
 {
+	unsigned int i, irq_start;
+
 	if (combiner_nr >= MAX_COMBINER_NR)
 		BUG();
 	if (irq_set_handler_data(irq, &combiner_data[combiner_nr]) != 0)
@@ -121,6 +123,11 @@ void __init combiner_cascade_irq(unsigned int combiner_nr, unsigned int irq)
 	irq_set_chained_handler(irq, combiner_handle_cascade_irq);
 
 	combiner_data[combiner_nr].parent_irq = irq;
+
+	/* the whole group moves with the parent, let the balancer know */
+	irq_start = combiner_data[combiner_nr].irq_offset;
+	for (i = irq_start; i < irq_start + MAX_IRQ_IN_COMBINER; i++)
+		irq_set_parent(i, irq);
 }
 
 void __init combiner_init(unsigned int combiner_nr, void __iomem *base,
@@ -219,9 +219,12 @@ int __init exynos_init_irq_eint(void)
 	}
 
 	irq_set_chained_handler(IRQ_EINT16_31, exynos_irq_demux_eint16_31);
+	for (irq = 16 ; irq <= 31 ; irq++)
+		irq_set_parent(IRQ_EINT(irq), IRQ_EINT16_31);
 
 	for (irq = 0 ; irq <= 15 ; irq++) {
 		eint0_15_data[irq] = IRQ_EINT(irq);
+		irq_set_parent(IRQ_EINT(irq), eint0_15_src_int[irq]);
 
 		irq_set_handler_data(eint0_15_src_int[irq],
 				     &eint0_15_data[irq]);
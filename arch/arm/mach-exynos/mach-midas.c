@@ -1506,6 +1506,44 @@ static int __init setup_ram_console_mem(char *str)
 __setup("ram_console=", setup_ram_console_mem);
 #endif
 
+#ifdef CONFIG_ANDROID_RAM_TRACE
+static struct resource ram_trace_resource[] = {
+	{
+		.flags = IORESOURCE_MEM,
+	}
+};
+
+static struct platform_device ram_trace_device = {
+	.name = "ram_trace",
+	.id = -1,
+	.num_resources = ARRAY_SIZE(ram_trace_resource),
+	.resource = ram_trace_resource,
+};
+
+static int __init setup_ram_trace_mem(char *str)
+{
+	unsigned size = memparse(str, &str);
+
+	if (size && (*str == '@')) {
+		unsigned long long base = 0;
+
+		base = simple_strtoul(++str, &str, 0);
+		if (reserve_bootmem(base, size, BOOTMEM_EXCLUSIVE)) {
+			pr_err("%s: failed reserving size %d "
+			       "at base 0x%llx\n", __func__, size, base);
+			return -1;
+		}
+
+		ram_trace_resource[0].start = base;
+		ram_trace_resource[0].end = base + size - 1;
+		pr_info("%s: %x at %llx\n", __func__, size, base);
+	}
+	return 0;
+}
+
+__setup("ram_trace=", setup_ram_trace_mem);
+#endif
+
 #if defined(CONFIG_BATTERY_SAMSUNG)
 static struct samsung_battery_platform_data samsung_battery_pdata = {
 	.charger_name	= "max77693-charger",
@@ -2118,6 +2156,9 @@ static struct platform_device *midas_devices[] __initdata = {
 #endif
 #ifdef CONFIG_ANDROID_RAM_CONSOLE
 	&ram_console_device,
+#endif
+#ifdef CONFIG_ANDROID_RAM_TRACE
+	&ram_trace_device,
 #endif
 	/* Samsung Power Domain */
 	&exynos4_device_pd[PD_MFC],
@@ -45,14 +45,45 @@ static unsigned int mct_int_type;
 struct mct_clock_event_device {
 	struct clock_event_device *evt;
 	void __iomem *base;
+	u32 tcon;		/* last value written to L_TCON */
 	char name[10];
 };
 
+/* L_WSTAT bits of the local timer registers */
+#define MCT_L_WSTAT_TCNTB	(1 << 0)
+#define MCT_L_WSTAT_ICNTB	(1 << 1)
+#define MCT_L_WSTAT_TCON	(1 << 3)
+
+/* Wait until a value written to addr is applied, as stat_addr & mask says */
+static void exynos4_mct_wait(unsigned int value, void *addr,
+			     void __iomem *stat_addr, u32 mask)
+{
+	u32 i;
+
+	for (i = 0; i < 0x1000; i++)
+		if (__raw_readl(stat_addr) & mask) {
+			__raw_writel(mask, stat_addr);
+			return;
+		}
+
+	/* Workaround: Try again if fail */
+	__raw_writel(value, addr);
+
+	printk(KERN_ERR "[%s]value=%d addr=0x%X\n", __func__, value, (u32)addr);
+
+	for (i = 0; i < loops_per_jiffy / 1000 * HZ; i++)
+		if (__raw_readl(stat_addr) & mask) {
+			__raw_writel(mask, stat_addr);
+			return;
+		}
+
+	panic("MCT hangs after writing %d (addr:0x%08x)\n", value, (u32)addr);
+}
+
 static void exynos4_mct_write(unsigned int value, void *addr)
 {
 	void __iomem *stat_addr;
 	u32 mask;
-	u32 i;
 
 	__raw_writel(value, addr);
 
@@ -61,15 +92,15 @@ static void exynos4_mct_write(unsigned int value, void *addr)
 		switch ((u32) addr & ~EXYNOS4_MCT_L_MASK) {
 		case (u32) MCT_L_TCON_OFFSET:
 			stat_addr = (void __iomem *) base + MCT_L_WSTAT_OFFSET;
-			mask = 1 << 3;		/* L_TCON write status */
+			mask = MCT_L_WSTAT_TCON;
 			break;
 		case (u32) MCT_L_ICNTB_OFFSET:
 			stat_addr = (void __iomem *) base + MCT_L_WSTAT_OFFSET;
-			mask = 1 << 1;		/* L_ICNTB write status */
+			mask = MCT_L_WSTAT_ICNTB;
 			break;
 		case (u32) MCT_L_TCNTB_OFFSET:
 			stat_addr = (void __iomem *) base + MCT_L_WSTAT_OFFSET;
-			mask = 1 << 0;		/* L_TCNTB write status */
+			mask = MCT_L_WSTAT_TCNTB;
 			break;
 		default:
 			return;
@@ -105,25 +136,7 @@ static void exynos4_mct_write(unsigned int value, void *addr)
 		}
 	}
 
-	/* Wait until written values are applied */
-	for (i = 0; i < 0x1000; i++)
-		if (__raw_readl(stat_addr) & mask) {
-			__raw_writel(mask, stat_addr);
-			return;
-		}
-
-	/* Workaround: Try again if fail */
-	__raw_writel(value, addr);
-
-	printk(KERN_ERR "[%s]value=%d addr=0x%X\n", __func__, value, (u32)addr);
-
-	for (i = 0; i < loops_per_jiffy / 1000 * HZ; i++)
-		if (__raw_readl(stat_addr) & mask) {
-			__raw_writel(mask, stat_addr);
-			return;
-		}
-
-	panic("MCT hangs after writing %d (addr:0x%08x)\n", value, (u32)addr);
+	exynos4_mct_wait(value, addr, stat_addr, mask);
 }
 
 /* Clocksource handling */
@@ -290,39 +303,72 @@ static void exynos4_clockevent_init(void)
 
 static DEFINE_PER_CPU(struct mct_clock_event_device, percpu_mct_tick);
 
-/* Clock event handling */
-static void exynos4_mct_tick_stop(struct mct_clock_event_device *mevt)
+/*
+ * Clock event handling
+ *
+ * With NO_HZ every idle entry and exit reprograms the local timer, so the
+ * tick paths keep what they last wrote to L_TCON instead of reading it
+ * back, leave L_INT_ENB alone once the tick is set up, and go to the
+ * write status bits they need directly.
+ */
+static void exynos4_mct_tick_tcon(struct mct_clock_event_device *mevt,
+				  u32 tcon)
 {
-	unsigned long tmp;
-	unsigned long mask = MCT_L_TCON_INT_START | MCT_L_TCON_TIMER_START;
 	void __iomem *addr = mevt->base + MCT_L_TCON_OFFSET;
 
-	tmp = __raw_readl(addr);
-	if (tmp & mask) {
-		tmp &= ~mask;
-		exynos4_mct_write(tmp, addr);
-	}
+	__raw_writel(tcon, addr);
+	mevt->tcon = tcon;
+	exynos4_mct_wait(tcon, addr, mevt->base + MCT_L_WSTAT_OFFSET,
+			 MCT_L_WSTAT_TCON);
+}
+
+static void exynos4_mct_tick_stop(struct mct_clock_event_device *mevt)
+{
+	u32 mask = MCT_L_TCON_INT_START | MCT_L_TCON_TIMER_START;
+
+	if (mevt->tcon & mask)
+		exynos4_mct_tick_tcon(mevt, mevt->tcon & ~mask);
 }
 
 static void exynos4_mct_tick_start(unsigned long cycles,
 				   struct mct_clock_event_device *mevt)
 {
-	unsigned long tmp;
-
-	exynos4_mct_tick_stop(mevt);
+	void __iomem *stat_addr = mevt->base + MCT_L_WSTAT_OFFSET;
+	void __iomem *icntb = mevt->base + MCT_L_ICNTB_OFFSET;
+	u32 mask = MCT_L_TCON_INT_START | MCT_L_TCON_TIMER_START;
+	u32 tcon = mevt->tcon;
+	u32 tmp;
 
 	tmp = (1 << 31) | cycles;	/* MCT_L_UPDATE_ICNTB */
 
-	/* update interrupt count buffer */
-	exynos4_mct_write(tmp, mevt->base + MCT_L_ICNTB_OFFSET);
+	/*
+	 * Stopping the timer and loading the interrupt count buffer are
+	 * writes to different registers, let both settle at once.
+	 */
+	if (tcon & mask) {
+		tcon &= ~mask;
+		__raw_writel(tcon, mevt->base + MCT_L_TCON_OFFSET);
+		__raw_writel(tmp, icntb);
+		exynos4_mct_wait(tmp, icntb, stat_addr, MCT_L_WSTAT_ICNTB);
+		exynos4_mct_wait(tcon, mevt->base + MCT_L_TCON_OFFSET,
+				 stat_addr, MCT_L_WSTAT_TCON);
+	} else {
+		__raw_writel(tmp, icntb);
+		exynos4_mct_wait(tmp, icntb, stat_addr, MCT_L_WSTAT_ICNTB);
+	}
+
+	tcon |= MCT_L_TCON_INT_START | MCT_L_TCON_TIMER_START |
+		MCT_L_TCON_INTERVAL_MODE;
+	exynos4_mct_tick_tcon(mevt, tcon);
+}
 
+/* Pick the hardware state up again after it may have been lost */
+static void exynos4_mct_tick_init(struct mct_clock_event_device *mevt)
+{
+	exynos4_mct_write(TICK_BASE_CNT, mevt->base + MCT_L_TCNTB_OFFSET);
 	/* enable MCT tick interrupt */
 	exynos4_mct_write(0x1, mevt->base + MCT_L_INT_ENB_OFFSET);
-
-	tmp = __raw_readl(mevt->base + MCT_L_TCON_OFFSET);
-	tmp |= MCT_L_TCON_INT_START | MCT_L_TCON_TIMER_START |
-	       MCT_L_TCON_INTERVAL_MODE;
-	exynos4_mct_write(tmp, mevt->base + MCT_L_TCON_OFFSET);
+	mevt->tcon = __raw_readl(mevt->base + MCT_L_TCON_OFFSET);
 }
 
 static int exynos4_tick_set_next_event(unsigned long cycles,
@@ -357,7 +403,7 @@ static inline void exynos4_tick_set_mode(enum clock_event_mode mode,
 		break;
 
 	case CLOCK_EVT_MODE_RESUME:
-		exynos4_mct_write(TICK_BASE_CNT, mevt->base + MCT_L_TCNTB_OFFSET);
+		exynos4_mct_tick_init(mevt);
 		break;
 	}
 }
@@ -427,6 +473,11 @@ static int __cpuinit exynos4_local_timer_setup(struct clock_event_device *evt)
 	evt->cpumask = cpumask_of(cpu);
 	evt->set_next_event = exynos4_tick_set_next_event;
 	evt->set_mode = exynos4_tick_set_mode;
+	/*
+	 * The MCT is outside the CPU power domains and keeps counting
+	 * through AFTR and LPA, so the local timers need no C3STOP and
+	 * cpuidle no broadcast tick.
+	 */
 	evt->features = CLOCK_EVT_FEAT_PERIODIC | CLOCK_EVT_FEAT_ONESHOT;
 	evt->rating = 450;
 
@@ -436,9 +487,9 @@ static int __cpuinit exynos4_local_timer_setup(struct clock_event_device *evt)
 	evt->min_delta_ns =
 		clockevent_delta2ns(0xf, evt);
 
-	clockevents_register_device(evt);
+	exynos4_mct_tick_init(mevt);
 
-	exynos4_mct_write(TICK_BASE_CNT, mevt->base + MCT_L_TCNTB_OFFSET);
+	clockevents_register_device(evt);
 
 	if (mct_int_type == MCT_INT_SPI) {
 		if (cpu == 0) {
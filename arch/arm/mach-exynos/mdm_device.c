@@ -9,7 +9,7 @@
 #include <mach/mdm2.h>
 #include "mdm_private.h"
 
-#include <linux/cpufreq_pegasusq.h>
+#include <linux/pm_qos_params.h>
 #include <mach/cpufreq.h>
 #include <mach/dev.h>
 
@@ -129,6 +129,8 @@ static struct mdm_platform_data mdm_platform_data = {
 #endif
 };
 
+static struct pm_qos_request_list mdm_online_qos;
+
 static int exynos_frequency_lock(struct device *dev)
 {
 	unsigned int level, cpufreq = 1400; /* 200 ~ 1400 */
@@ -165,7 +167,7 @@ static int exynos_frequency_lock(struct device *dev)
 		}
 
 		/* lock minimum number of cpu cores */
-		cpufreq_pegasusq_min_cpu_lock(2);
+		pm_qos_add_request(&mdm_online_qos, PM_QOS_CPU_ONLINE_MIN, 2);
 
 		atomic_set(&mdm_hsic_pm_pdata.freqlock, 1);
 		pr_debug("level=%d, cpufreq=%d MHz, busfreq=%06d\n",
@@ -192,7 +194,7 @@ static int exynos_frequency_unlock(struct device *dev)
 		}
 
 		/* unlock minimum number of cpu cores */
-		cpufreq_pegasusq_min_cpu_unlock();
+		pm_qos_remove_request(&mdm_online_qos);
 
 		atomic_set(&mdm_hsic_pm_pdata.freqlock, 0);
 		pr_debug("success\n");
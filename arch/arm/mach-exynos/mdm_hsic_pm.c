@@ -45,7 +45,7 @@
 #ifdef CONFIG_USBIRQ_BALANCING_LTE_HIGHTP
 #include <mach/mdm2.h>
 #include <linux/cpu.h>
-#include <linux/cpufreq_pegasusq.h>
+#include <linux/pm_qos_params.h>
 #define dev_put devput
 #include <linux/netdevice.h>
 #undef dev_put
@@ -104,6 +104,7 @@ struct mdm_hsic_pm_data {
 	struct notifier_block rndis_notifier;
 	struct notifier_block cpu_hotplug_notifier;
 	struct delayed_work hotplug_work;
+	struct pm_qos_request_list cpu_online_qos;
 	bool is_rndis_running;
 #endif
 
@@ -1202,7 +1203,9 @@ static int link_pm_rndis_event(struct notifier_block *this,
 		case NETDEV_UP:
 			if (mdm_pdata && mdm_pdata->dev)
 				boost_busfreq(mdm_pdata->dev, 1);
-			cpufreq_pegasusq_min_cpu_lock(2);
+			if (!pm_qos_request_active(&pm_data->cpu_online_qos))
+				pm_qos_add_request(&pm_data->cpu_online_qos,
+						   PM_QOS_CPU_ONLINE_MIN, 2);
 			clear_cpu0_from_usbhost_irq(1);
 			pm_data->is_rndis_running = true;
 			pr_info("%s: %s UP\n", __func__, dev->name);
@@ -1210,7 +1213,8 @@ static int link_pm_rndis_event(struct notifier_block *this,
 		case NETDEV_DOWN:
 			pm_data->is_rndis_running = false;
 			clear_cpu0_from_usbhost_irq(0);
-			cpufreq_pegasusq_min_cpu_unlock();
+			if (pm_qos_request_active(&pm_data->cpu_online_qos))
+				pm_qos_remove_request(&pm_data->cpu_online_qos);
 			if (mdm_pdata && mdm_pdata->dev)
 				boost_busfreq(mdm_pdata->dev, 0);
 			pr_info("%s: %s DOWN\n", __func__, dev->name);
@@ -1238,9 +1242,9 @@ static int hotplug_notify_callback(struct notifier_block *this,
 		switch (action) {
 
 		case CPU_POST_DEAD:
+			/* the cpu_online_qos floor brings the second core back */
 			if (1 == num_online_cpus())
 			{
-				cpufreq_pegasusq_min_cpu_lock(2);
 				queue_delayed_work(pm_data->wq, &pm_data->hotplug_work,
 					msecs_to_jiffies(100));
 			}
@@ -251,7 +251,7 @@ static int __init midas_mhl_init(void)
 {
 	int ret;
 #define I2C_BUS_ID_MHL	15
-	ret = i2c_add_devices(I2C_BUS_ID_MHL, i2c_devs_sii9234,
+	ret = i2c_add_async_devices(I2C_BUS_ID_MHL, i2c_devs_sii9234,
 			ARRAY_SIZE(i2c_devs_sii9234));
 
 	if (ret < 0) {
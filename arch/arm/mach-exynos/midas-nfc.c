@@ -89,5 +89,5 @@ static int __init midas_nfc_init(void)
 
 	return ret;
 }
-module_init(midas_nfc_init);
+deferred_module_init(midas_nfc_init);
 #endif
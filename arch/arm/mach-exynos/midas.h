@@ -5,8 +5,8 @@
 #ifndef __MIDAS_H__
 #define __MIDAS_H__
 
-static inline int i2c_add_devices(int busnum, struct i2c_board_info *infos,
-				  int size)
+static inline int __i2c_add_devices(int busnum, struct i2c_board_info *infos,
+				    int size, bool async)
 {
 	struct i2c_adapter *i2c_adap;
 	int i;
@@ -18,10 +18,12 @@ static inline int i2c_add_devices(int busnum, struct i2c_board_info *infos,
 
 	for (i = 0; i < size; i++) {
 		struct i2c_client *client = i2c_new_device(i2c_adap, infos + i);
-		if (client)
+		if (client) {
+			if (async)
+				device_enable_async_suspend(&client->dev);
 			dev_info(&client->dev, "%s - added %s successfully\n",
 				 __func__, infos[i].type);
-		else
+		} else
 			dev_err(&i2c_adap->dev,
 				"%s - added %s at bus i2c bus %d failed\n",
 				__func__, infos[i].type, busnum);
@@ -32,4 +34,17 @@ static inline int i2c_add_devices(int busnum, struct i2c_board_info *infos,
 	return 0;
 }
 
+static inline int i2c_add_devices(int busnum, struct i2c_board_info *infos,
+				  int size)
+{
+	return __i2c_add_devices(busnum, infos, size, false);
+}
+
+/* for devices that may suspend and resume in parallel with the others */
+static inline int i2c_add_async_devices(int busnum,
+					struct i2c_board_info *infos, int size)
+{
+	return __i2c_add_devices(busnum, infos, size, true);
+}
+
 #endif
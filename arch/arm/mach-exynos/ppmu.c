@@ -17,6 +17,15 @@
 #include <linux/list.h>
 #include <linux/math64.h>
 #include <linux/device.h>
+#include <linux/module.h>
+#include <linux/notifier.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/sched.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include <trace/events/dvfs.h>
 
 #include <plat/cpu.h>
 
@@ -29,6 +38,26 @@ static LIST_HEAD(ppmu_list);
 unsigned long long ppmu_load[PPMU_END];
 unsigned long long ppmu_load_detail[2][PPMU_END];
 
+/*
+ * Every window read from a PPMU, whoever asked for it, lands in a short
+ * per port history and is passed to the subscribers, so busfreq, BTS,
+ * GPU DVFS or thermal can share the counters instead of each setting
+ * them up again. Loads are busy percentages of the window and do not
+ * depend on its length, so windows cut short by another reader are as
+ * good as the others.
+ */
+static DEFINE_SPINLOCK(ppmu_lock);
+static ATOMIC_NOTIFIER_HEAD(ppmu_notifier_list);
+
+static struct ppmu_sample ppmu_last;
+static unsigned int ppmu_history[PPMU_END][PPMU_HISTORY_SIZE];
+static unsigned int ppmu_history_idx[PPMU_END];
+static unsigned int ppmu_history_nr[PPMU_END];
+
+/* 0: no sampling of our own, the windows busfreq reads are used */
+static unsigned int ppmu_sample_ms;
+static struct delayed_work ppmu_work;
+
 void exynos4_ppmu_reset(struct exynos4_ppmu_hw *ppmu)
 {
 	void __iomem *ppmu_base = ppmu->hw_base;
@@ -99,18 +128,156 @@ void ppmu_start(struct device *dev)
 			exynos4_ppmu_start(ppmu);
 }
 
+/* Called with ppmu_lock held */
+static void ppmu_record(struct exynos4_ppmu_hw *ppmu, int ch)
+{
+	unsigned int load;
+	int id = ppmu->id;
+
+	ppmu_load[id] = exynos4_ppmu_update(ppmu, ch);
+	load = min_t(unsigned long long, ppmu_load[id], UINT_MAX);
+
+	ppmu_history[id][ppmu_history_idx[id]] = load;
+	ppmu_history_idx[id] = (ppmu_history_idx[id] + 1) % PPMU_HISTORY_SIZE;
+	if (ppmu_history_nr[id] < PPMU_HISTORY_SIZE)
+		ppmu_history_nr[id]++;
+
+	ppmu_last.load[id] = load;
+	ppmu_last.updated |= 1 << id;
+
+	trace_dvfs_ppmu(id, load, ppmu->ccnt);
+}
+
+/* Called with ppmu_lock held, hands the finished sample to the subscribers */
+static void ppmu_publish(struct ppmu_sample *sample)
+{
+	ppmu_last.time = local_clock();
+	*sample = ppmu_last;
+	ppmu_last.updated = 0;
+}
+
+static void ppmu_notify(struct ppmu_sample *sample)
+{
+	if (sample->updated)
+		atomic_notifier_call_chain(&ppmu_notifier_list, 0, sample);
+}
+
 void ppmu_update(struct device *dev, int ch)
 {
 	struct exynos4_ppmu_hw *ppmu;
+	struct ppmu_sample sample;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ppmu_lock, flags);
 
 	list_for_each_entry(ppmu, &ppmu_list, node)
 		if (ppmu->dev == dev) {
 			exynos4_ppmu_stop(ppmu);
-			ppmu_load[ppmu->id] = exynos4_ppmu_update(ppmu, ch);
+			ppmu_record(ppmu, ch);
 			exynos4_ppmu_reset(ppmu);
 		}
+
+	ppmu_publish(&sample);
+	spin_unlock_irqrestore(&ppmu_lock, flags);
+
+	ppmu_notify(&sample);
+}
+
+int ppmu_register_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_register(&ppmu_notifier_list, nb);
+}
+EXPORT_SYMBOL_GPL(ppmu_register_notifier);
+
+int ppmu_unregister_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_unregister(&ppmu_notifier_list, nb);
+}
+EXPORT_SYMBOL_GPL(ppmu_unregister_notifier);
+
+unsigned int ppmu_get_load(enum exynos4_ppmu id, unsigned int nr_samples)
+{
+	unsigned int i, idx, sum = 0;
+	unsigned long flags;
+
+	if (id >= PPMU_END || !nr_samples)
+		return 0;
+
+	spin_lock_irqsave(&ppmu_lock, flags);
+
+	nr_samples = min(nr_samples, ppmu_history_nr[id]);
+	idx = ppmu_history_idx[id];
+	for (i = 0; i < nr_samples; i++) {
+		idx = idx ? idx - 1 : PPMU_HISTORY_SIZE - 1;
+		sum += ppmu_history[id][idx];
+	}
+
+	spin_unlock_irqrestore(&ppmu_lock, flags);
+
+	return nr_samples ? sum / nr_samples : 0;
+}
+EXPORT_SYMBOL_GPL(ppmu_get_load);
+
+/* the counter busfreq and the tables below put the data count on */
+static int ppmu_default_ch(struct exynos4_ppmu_hw *ppmu)
+{
+	int ch;
+
+	for (ch = NUMBER_OF_COUNTER - 1; ch > 0; ch--)
+		if (ppmu->event[ch])
+			break;
+
+	return ch;
+}
+
+static void ppmu_sample_work(struct work_struct *work)
+{
+	struct exynos4_ppmu_hw *ppmu;
+	struct ppmu_sample sample;
+	unsigned long flags;
+	unsigned int ms = ACCESS_ONCE(ppmu_sample_ms);
+
+	if (!ms)
+		return;
+
+	spin_lock_irqsave(&ppmu_lock, flags);
+
+	list_for_each_entry(ppmu, &ppmu_list, node) {
+		exynos4_ppmu_stop(ppmu);
+		ppmu_record(ppmu, ppmu_default_ch(ppmu));
+		exynos4_ppmu_reset(ppmu);
+		exynos4_ppmu_start(ppmu);
+	}
+
+	ppmu_publish(&sample);
+	spin_unlock_irqrestore(&ppmu_lock, flags);
+
+	ppmu_notify(&sample);
+
+	schedule_delayed_work(&ppmu_work, msecs_to_jiffies(ms));
+}
+
+static int ppmu_set_sample_ms(const char *val, const struct kernel_param *kp)
+{
+	int ret = param_set_uint(val, kp);
+
+	if (ret || !ppmu_work.work.func)
+		return ret;
+
+	cancel_delayed_work_sync(&ppmu_work);
+	if (ppmu_sample_ms)
+		schedule_delayed_work(&ppmu_work,
+				      msecs_to_jiffies(ppmu_sample_ms));
+
+	return 0;
 }
 
+static struct kernel_param_ops ppmu_sample_ms_ops = {
+	.set = ppmu_set_sample_ms,
+	.get = param_get_uint,
+};
+module_param_cb(sample_ms, &ppmu_sample_ms_ops, &ppmu_sample_ms, 0644);
+
 void ppmu_reset(struct device *dev)
 {
 	struct exynos4_ppmu_hw *ppmu;
@@ -133,7 +300,10 @@ void ppmu_init(struct exynos4_ppmu_hw *ppmu, struct device *dev)
 	int i;
 
 	ppmu->dev = dev;
+
+	spin_lock_irq(&ppmu_lock);
 	list_add(&ppmu->node, &ppmu_list);
+	spin_unlock_irq(&ppmu_lock);
 
 	if (soc_is_exynos4210())
 		for (i = 0; i < NUMBER_OF_COUNTER; i++) {
@@ -192,3 +362,69 @@ struct exynos4_ppmu_hw exynos_ppmu[] = {
 	},
 #endif
 };
+
+static const char * const ppmu_names[PPMU_END] = {
+	[PPMU_DMC0]		= "dmc0",
+	[PPMU_DMC1]		= "dmc1",
+	[PPMU_CPU]		= "cpu",
+#ifdef CONFIG_ARCH_EXYNOS5
+	[PPMU_DDR_C]		= "ddr_c",
+	[PPMU_DDR_R1]		= "ddr_r1",
+	[PPMU_DDR_L]		= "ddr_l",
+	[PPMU_RIGHT0_BUS]	= "right0_bus",
+#endif
+};
+
+#ifdef CONFIG_DEBUG_FS
+static int ppmu_debug_show(struct seq_file *s, void *unused)
+{
+	struct exynos4_ppmu_hw *ppmu;
+	unsigned int history[PPMU_HISTORY_SIZE];
+	unsigned int i, idx, nr;
+
+	list_for_each_entry(ppmu, &ppmu_list, node) {
+		spin_lock_irq(&ppmu_lock);
+		nr = ppmu_history_nr[ppmu->id];
+		idx = ppmu_history_idx[ppmu->id];
+		for (i = 0; i < nr; i++) {
+			idx = idx ? idx - 1 : PPMU_HISTORY_SIZE - 1;
+			history[i] = ppmu_history[ppmu->id][idx];
+		}
+		spin_unlock_irq(&ppmu_lock);
+
+		/* newest first */
+		seq_printf(s, "%-10s", ppmu_names[ppmu->id]);
+		for (i = 0; i < nr; i++)
+			seq_printf(s, " %3u", history[i]);
+		seq_printf(s, "\n");
+	}
+
+	return 0;
+}
+
+static int ppmu_debug_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ppmu_debug_show, inode->i_private);
+}
+
+static const struct file_operations ppmu_debug_fops = {
+	.open		= ppmu_debug_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
+static int __init ppmu_service_init(void)
+{
+	INIT_DELAYED_WORK_DEFERRABLE(&ppmu_work, ppmu_sample_work);
+	if (ppmu_sample_ms)
+		schedule_delayed_work(&ppmu_work,
+				      msecs_to_jiffies(ppmu_sample_ms));
+
+#ifdef CONFIG_DEBUG_FS
+	debugfs_create_file("ppmu", S_IRUGO, NULL, NULL, &ppmu_debug_fops);
+#endif
+	return 0;
+}
+late_initcall(ppmu_service_init);
@@ -29,6 +29,7 @@
 #include <linux/io.h>
 #include <linux/clk.h>
 #include <linux/cpu.h>
+#include <linux/ram_trace.h>
 
 #ifdef CONFIG_SEC_DEBUG
 #include <mach/sec_debug.h>
@@ -66,10 +67,18 @@ static enum hrtimer_restart watchdog_timerfunc(struct hrtimer *timer);
 static struct clk *wd_clk;
 static spinlock_t wdt_lock;
 
+/* the time left at each pet shows how close earlier stalls came */
+static void watchdog_pet_log(void)
+{
+	ram_trace_log(RAM_TRACE_WATCHDOG,
+		      readl(S3C2410_WTCNT) * MSEC_PER_SEC / TPS, 0, 0);
+}
+
 #if defined(PET_BY_WORKQUEUE)
 static void watchdog_workfunc(struct work_struct *work)
 {
 	pr_debug("%s kicking...%x\n", __func__, readl(S3C2410_WTCNT));
+	watchdog_pet_log();
 	writel(watchdog_reset * TPS, S3C2410_WTCNT);
 	queue_delayed_work_on(0, watchdog_wq, &watchdog_work,
 			      watchdog_pet * HZ);
@@ -78,6 +87,7 @@ static void watchdog_workfunc(struct work_struct *work)
 static void pet_watchdog_timer_fn(unsigned long data)
 {
 	pr_debug("%s kicking...%x\n", __func__, readl(S3C2410_WTCNT));
+	watchdog_pet_log();
 	writel(watchdog_reset * TPS, S3C2410_WTCNT);
 	pet_watchdog_timer.expires += watchdog_pet * HZ;
 	add_timer_on(&pet_watchdog_timer, 0);
@@ -86,6 +96,7 @@ static void pet_watchdog_timer_fn(unsigned long data)
 static enum hrtimer_restart watchdog_timerfunc(struct hrtimer *timer)
 {
 	pr_debug("%s kicking...%x\n", __func__, readl(S3C2410_WTCNT));
+	watchdog_pet_log();
 	writel(watchdog_reset * TPS, S3C2410_WTCNT);
 	hrtimer_start(&watchdog_timer,
 		      ktime_set(watchdog_pet, 0), HRTIMER_MODE_REL);
@@ -26,6 +26,9 @@
 #include <linux/gpio.h>
 #include <linux/slab.h>
 #include <linux/kobject.h>
+#include <linux/notifier.h>
+#include <linux/ram_trace.h>
+#include <linux/dvfs_monitor.h>
 
 #ifdef CONFIG_EXYNOS4_EXPORT_TEMP
 #include <linux/exynos4_export_temp.h>
@@ -37,6 +40,7 @@
 #include <mach/cpufreq.h>
 #include <mach/map.h>
 #include <mach/smc.h>
+#include <mach/tmu.h>
 #include <plat/s5p-tmu.h>
 #include <plat/map-s5p.h>
 #include <plat/gpio-cfg.h>
@@ -136,6 +140,58 @@ unsigned int get_exynos4_temperature(void)
 EXPORT_SYMBOL(get_exynos4_temperature);
 #endif
 
+static BLOCKING_NOTIFIER_HEAD(tmu_notifier_list);
+static unsigned int tmu_notified_temp;
+static unsigned int tmu_notified_level = TMU_THROTTLE_NONE;
+
+/* must be called with tmu_lock held */
+static void tmu_notify_temp(unsigned int temp)
+{
+	if (temp == tmu_notified_temp)
+		return;
+
+	tmu_notified_temp = temp;
+	blocking_notifier_call_chain(&tmu_notifier_list, TMU_TEMP_CHANGE,
+				     &temp);
+	dvfs_monitor_report_temp(temp);
+}
+
+/* must be called with tmu_lock held */
+static void tmu_notify_throttle(unsigned int level)
+{
+	if (level == tmu_notified_level)
+		return;
+
+	tmu_notified_level = level;
+	blocking_notifier_call_chain(&tmu_notifier_list, TMU_THROTTLE_CHANGE,
+				     &level);
+}
+
+int exynos_tmu_register_notifier(struct notifier_block *nb)
+{
+	unsigned int val;
+	int ret;
+
+	mutex_lock(&tmu_lock);
+	ret = blocking_notifier_chain_register(&tmu_notifier_list, nb);
+	if (!ret) {
+		val = tmu_notified_temp;
+		nb->notifier_call(nb, TMU_TEMP_CHANGE, &val);
+		val = tmu_notified_level;
+		nb->notifier_call(nb, TMU_THROTTLE_CHANGE, &val);
+	}
+	mutex_unlock(&tmu_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(exynos_tmu_register_notifier);
+
+int exynos_tmu_unregister_notifier(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_unregister(&tmu_notifier_list, nb);
+}
+EXPORT_SYMBOL_GPL(exynos_tmu_unregister_notifier);
+
 static ssize_t show_temperature(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -354,6 +410,7 @@ static void exynos4_poll_cur_temp(struct work_struct *work)
 
 	if (mask & ENABLE_TEMP_MON) {
 		cur_temp = get_curr_temp(info);
+		tmu_notify_temp(cur_temp);
 
 		if (tmu_print_temp_on_off)
 			pr_info("curr temp in polling_interval = %u state = %d\n",
@@ -362,7 +419,7 @@ static void exynos4_poll_cur_temp(struct work_struct *work)
 			pr_debug("curr temp in polling_interval = %u\n", cur_temp);
 	}
 	queue_delayed_work_on(0, tmu_monitor_wq, &info->monitor,
-			      info->monitor_period);
+			      align_jiffies_relative(info->monitor_period));
 
 	mutex_unlock(&tmu_lock);
 }
@@ -465,6 +522,9 @@ static int notify_change_of_tmu_state(struct s5p_tmu_info *info)
 	char *envp[2];
 	int env_offset = 0;
 
+	ram_trace_log(RAM_TRACE_THERMAL, info->tmu_state,
+		      info->last_temperature, 0);
+
 	snprintf(temp_buf, sizeof(temp_buf), "TMUSTATE=%d", info->tmu_state);
 	envp[env_offset++] = temp_buf;
 	envp[env_offset] = NULL;
@@ -556,6 +616,21 @@ err_unlock:
 }
 #endif
 
+/* the level every listener should enforce, following the cpufreq limit */
+static unsigned int tmu_throttle_level(struct s5p_tmu_info *info,
+				       int check_handle)
+{
+	if (info->tmu_state == TMU_STATUS_TRIPPED &&
+	    (check_handle & TRIPPING_FLAG))
+		return TMU_THROTTLE_TRIP;
+	if (check_handle & WARNING_FLAG)
+		return TMU_THROTTLE_2ND;
+	if (check_handle & THROTTLE_FLAG)
+		return TMU_THROTTLE_1ST;
+
+	return TMU_THROTTLE_NONE;
+}
+
 static void exynos4_handler_tmu_state(struct work_struct *work)
 {
 	struct delayed_work *delayed_work = to_delayed_work(work);
@@ -572,6 +647,7 @@ static void exynos4_handler_tmu_state(struct work_struct *work)
 	cur_temp = get_curr_temp(info);
 	trend = cur_temp - info->last_temperature;
 	pr_debug("curr_temp = %u, temp_diff = %d\n", cur_temp, trend);
+	tmu_notify_temp(cur_temp);
 
 	switch (info->tmu_state) {
 #if defined(CONFIG_TC_VOLTAGE)
@@ -613,11 +689,14 @@ static void exynos4_handler_tmu_state(struct work_struct *work)
 		/* 2. polling end and uevent */
 		} else if ((cur_temp <= data->ts.stop_1st_throttle)
 			&& (cur_temp <= data->ts.stop_mem_throttle)) {
-			if (check_handle & THROTTLE_FLAG) {
+			/* 2nd throttling may be left when cooling fast */
+			if (check_handle & (THROTTLE_FLAG | WARNING_FLAG)) {
 				exynos_cpufreq_upper_limit_free(DVFS_LOCK_ID_TMU);
-				check_handle &= ~(THROTTLE_FLAG);
+				check_handle &= ~(THROTTLE_FLAG | WARNING_FLAG);
 			}
 			pr_debug("check_handle = %d\n", check_handle);
+			tmu_notify_throttle(tmu_throttle_level(info,
+							       check_handle));
 			notify_change_of_tmu_state(info);
 			pr_info("normal: free cpufreq_limit & interrupt enable.\n");
 
@@ -795,10 +874,11 @@ static void exynos4_handler_tmu_state(struct work_struct *work)
 	}
 
 	info->last_temperature = cur_temp;
+	tmu_notify_throttle(tmu_throttle_level(info, check_handle));
 
-	/* reschedule the next work */
+	/* reschedule the next work, on the ticks the other samplers use */
 	queue_delayed_work_on(0, tmu_monitor_wq, &info->polling,
-			info->sampling_rate);
+			align_jiffies_relative(info->sampling_rate));
 
 	mutex_unlock(&tmu_lock);
 
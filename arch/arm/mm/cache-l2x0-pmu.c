@@ -0,0 +1,407 @@
+/*
+ * arch/arm/mm/cache-l2x0-pmu.c - L2C-310 event counters for perf
+ *
+ * The PL310 has two 32-bit event counters shared by all cpus. They are
+ * exported as the "l2x0" perf PMU, counting only (there is no usable
+ * overflow interrupt) and bound to cpu 0:
+ *
+ *	perf stat -a -C 0 -e l2x0/config=3/,l2x0/config=2/ ...
+ *
+ * Events (config, the counter source field):
+ *	1  CO		eviction (castout) of a line
+ *	2  DRHIT	data read hit
+ *	3  DRREQ	data read lookup
+ *	4  DWHIT	data write hit
+ *	5  DWREQ	data write lookup
+ *	6  DWTREQ	data write lookup, write-through
+ *	7  IRHIT	instruction read hit
+ *	8  IRREQ	instruction read lookup
+ *	9  WA		allocation on a write miss
+ *	10 IPFALLOC	allocation by an internal prefetch
+ *	11 EPFHIT	prefetch hint hit
+ *	12 EPFALLOC	allocation by a prefetch hint
+ *	13 SRRCVD	speculative read received
+ *	14 SRCONF	speculative read confirmed
+ *	15 EPFRCVD	prefetch hint received
+ *
+ * The counters saturate instead of wrapping, so they are started from zero
+ * and folded into the events every L2X0_PMU_POLL_MS. More events than
+ * counters are multiplexed by the perf core.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#define pr_fmt(fmt) "l2x0 pmu: " fmt
+
+#include <linux/init.h>
+#include <linux/io.h>
+#include <linux/hrtimer.h>
+#include <linux/mutex.h>
+#include <linux/perf_event.h>
+
+#include <asm/pmu.h>
+#include <asm/hardware/cache-l2x0.h>
+
+#define L2X0_PMU_COUNTERS	2
+#define L2X0_PMU_CPU		0
+#define L2X0_PMU_POLL_MS	1000
+
+#define L2X0_EVENT_CNT_ENABLE		(1 << 0)
+#define L2X0_EVENT_CNT_RESET_ALL	(3 << 1)
+#define L2X0_EVENT_SRC_SHIFT		2
+#define L2X0_EVENT_SRC_MAX		15
+
+static void __iomem *l2x0_pmu_base;
+static struct perf_event *l2x0_pmu_events[L2X0_PMU_COUNTERS];
+static struct hrtimer l2x0_pmu_hrtimer;
+static atomic_t l2x0_pmu_active = ATOMIC_INIT(0);
+static DEFINE_MUTEX(l2x0_pmu_reserve_mutex);
+static bool l2x0_pmu_enabled;
+
+/* counter 0 sits above counter 1 in the register map */
+static void __iomem *l2x0_pmu_cfg(int idx)
+{
+	return l2x0_pmu_base + L2X0_EVENT_CNT0_CFG - 4 * idx;
+}
+
+static void __iomem *l2x0_pmu_val(int idx)
+{
+	return l2x0_pmu_base + L2X0_EVENT_CNT0_VAL - 4 * idx;
+}
+
+static void l2x0_pmu_hw_enable(bool on)
+{
+	writel_relaxed(on ? L2X0_EVENT_CNT_ENABLE : 0,
+		       l2x0_pmu_base + L2X0_EVENT_CNT_CTRL);
+	l2x0_pmu_enabled = on;
+}
+
+static void l2x0_pmu_hw_reset(void)
+{
+	int idx;
+
+	writel_relaxed(L2X0_EVENT_CNT_RESET_ALL,
+		       l2x0_pmu_base + L2X0_EVENT_CNT_CTRL);
+	for (idx = 0; idx < L2X0_PMU_COUNTERS; idx++)
+		writel_relaxed(0, l2x0_pmu_cfg(idx));
+	l2x0_pmu_enabled = false;
+}
+
+static void l2x0_pmu_event_update(struct perf_event *event)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	u64 prev, new;
+
+	do {
+		prev = local64_read(&hwc->prev_count);
+		new = readl_relaxed(l2x0_pmu_val(hwc->idx));
+	} while (local64_cmpxchg(&hwc->prev_count, prev, new) != prev);
+
+	local64_add((new - prev) & 0xffffffff, &event->count);
+
+	WARN_ONCE(new == 0xffffffff, "counter %d saturated\n", hwc->idx);
+}
+
+/* start the counter from zero, the farthest it can be from saturating */
+static void l2x0_pmu_event_configure(struct perf_event *event)
+{
+	struct hw_perf_event *hwc = &event->hw;
+
+	local64_set(&hwc->prev_count, 0);
+	writel_relaxed(0, l2x0_pmu_val(hwc->idx));
+	writel_relaxed(hwc->config_base << L2X0_EVENT_SRC_SHIFT,
+		       l2x0_pmu_cfg(hwc->idx));
+}
+
+static enum hrtimer_restart l2x0_pmu_poll(struct hrtimer *hrtimer)
+{
+	struct perf_event *event;
+	unsigned long flags;
+	bool lost;
+	int idx;
+
+	local_irq_save(flags);
+
+	/* the controller may have been powered down and set up again */
+	lost = l2x0_pmu_enabled &&
+	       !(readl_relaxed(l2x0_pmu_base + L2X0_EVENT_CNT_CTRL) &
+		 L2X0_EVENT_CNT_ENABLE);
+
+	writel_relaxed(0, l2x0_pmu_base + L2X0_EVENT_CNT_CTRL);
+	for (idx = 0; idx < L2X0_PMU_COUNTERS; idx++) {
+		event = l2x0_pmu_events[idx];
+		if (!event || (event->hw.state & PERF_HES_STOPPED))
+			continue;
+
+		if (!lost)
+			l2x0_pmu_event_update(event);
+		l2x0_pmu_event_configure(event);
+	}
+	if (l2x0_pmu_enabled)
+		writel_relaxed(L2X0_EVENT_CNT_ENABLE,
+			       l2x0_pmu_base + L2X0_EVENT_CNT_CTRL);
+
+	local_irq_restore(flags);
+
+	hrtimer_forward_now(hrtimer, ms_to_ktime(L2X0_PMU_POLL_MS));
+	return HRTIMER_RESTART;
+}
+
+static int l2x0_pmu_used(void)
+{
+	int idx, used = 0;
+
+	for (idx = 0; idx < L2X0_PMU_COUNTERS; idx++)
+		if (l2x0_pmu_events[idx])
+			used++;
+	return used;
+}
+
+static void l2x0_pmu_enable(struct pmu *pmu)
+{
+	if (l2x0_pmu_used())
+		l2x0_pmu_hw_enable(true);
+}
+
+static void l2x0_pmu_disable(struct pmu *pmu)
+{
+	l2x0_pmu_hw_enable(false);
+}
+
+static void l2x0_pmu_event_start(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+
+	if (flags & PERF_EF_RELOAD)
+		WARN_ON_ONCE(!(hwc->state & PERF_HES_UPTODATE));
+
+	hwc->state = 0;
+	l2x0_pmu_event_configure(event);
+}
+
+static void l2x0_pmu_event_stop(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+
+	if (hwc->state & PERF_HES_STOPPED)
+		return;
+
+	writel_relaxed(0, l2x0_pmu_cfg(hwc->idx));
+	l2x0_pmu_event_update(event);
+	hwc->state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+}
+
+static int l2x0_pmu_event_add(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	int idx;
+
+	for (idx = 0; idx < L2X0_PMU_COUNTERS; idx++)
+		if (!l2x0_pmu_events[idx])
+			break;
+
+	/* both counters taken, the core rotates the events */
+	if (idx == L2X0_PMU_COUNTERS)
+		return -EAGAIN;
+
+	if (!l2x0_pmu_used())
+		hrtimer_start(&l2x0_pmu_hrtimer, ms_to_ktime(L2X0_PMU_POLL_MS),
+			      HRTIMER_MODE_REL_PINNED);
+
+	l2x0_pmu_events[idx] = event;
+	hwc->idx = idx;
+	hwc->state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+
+	if (flags & PERF_EF_START)
+		l2x0_pmu_event_start(event, PERF_EF_RELOAD);
+
+	return 0;
+}
+
+static void l2x0_pmu_event_del(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+
+	l2x0_pmu_event_stop(event, PERF_EF_UPDATE);
+
+	l2x0_pmu_events[hwc->idx] = NULL;
+	hwc->idx = -1;
+
+	if (!l2x0_pmu_used())
+		hrtimer_cancel(&l2x0_pmu_hrtimer);
+}
+
+static void l2x0_pmu_event_read(struct perf_event *event)
+{
+	if (event->hw.idx >= 0 && !(event->hw.state & PERF_HES_STOPPED))
+		l2x0_pmu_event_update(event);
+}
+
+static void l2x0_pmu_event_destroy(struct perf_event *event)
+{
+	if (atomic_dec_and_mutex_lock(&l2x0_pmu_active,
+				      &l2x0_pmu_reserve_mutex)) {
+		release_pmu(ARM_PMU_DEVICE_L2X0);
+		mutex_unlock(&l2x0_pmu_reserve_mutex);
+	}
+}
+
+/* gator drives the same counters, only one of them can have them */
+static int l2x0_pmu_reserve(void)
+{
+	int err = 0;
+
+	if (atomic_inc_not_zero(&l2x0_pmu_active))
+		return 0;
+
+	mutex_lock(&l2x0_pmu_reserve_mutex);
+	if (atomic_read(&l2x0_pmu_active) == 0) {
+		err = reserve_pmu(ARM_PMU_DEVICE_L2X0);
+		if (!err)
+			l2x0_pmu_hw_reset();
+	}
+	if (!err)
+		atomic_inc(&l2x0_pmu_active);
+	mutex_unlock(&l2x0_pmu_reserve_mutex);
+
+	return err;
+}
+
+static bool l2x0_pmu_group_fits(struct perf_event *event)
+{
+	struct perf_event *sibling, *leader = event->group_leader;
+	int counters = 0;
+
+	if (leader->pmu == event->pmu)
+		counters++;
+	else if (!is_software_event(leader))
+		return false;
+
+	list_for_each_entry(sibling, &leader->sibling_list, group_entry) {
+		if (sibling->pmu == event->pmu)
+			counters++;
+		else if (!is_software_event(sibling))
+			return false;
+	}
+
+	if (leader != event)
+		counters++;
+
+	return counters <= L2X0_PMU_COUNTERS;
+}
+
+static int l2x0_pmu_event_init(struct perf_event *event)
+{
+	struct perf_event_attr *attr = &event->attr;
+	int err;
+
+	if (attr->type != event->pmu->type)
+		return -ENOENT;
+
+	/* counting of the whole cache only */
+	if (is_sampling_event(event) || event->attach_state & PERF_ATTACH_TASK)
+		return -EOPNOTSUPP;
+
+	if (attr->exclude_user || attr->exclude_kernel || attr->exclude_hv ||
+	    attr->exclude_idle || has_branch_stack(event))
+		return -EINVAL;
+
+	if (event->cpu != L2X0_PMU_CPU)
+		return -ENODEV;
+
+	if (!attr->config || attr->config > L2X0_EVENT_SRC_MAX)
+		return -EINVAL;
+
+	if (!l2x0_pmu_group_fits(event))
+		return -EINVAL;
+
+	err = l2x0_pmu_reserve();
+	if (err)
+		return err;
+
+	event->destroy = l2x0_pmu_event_destroy;
+	event->hw.config_base = attr->config;
+	event->hw.idx = -1;
+
+	return 0;
+}
+
+PMU_FORMAT_ATTR(event, "config:0-3");
+
+static struct attribute *l2x0_pmu_format_attrs[] = {
+	&format_attr_event.attr,
+	NULL,
+};
+
+static struct attribute_group l2x0_pmu_format_group = {
+	.name	= "format",
+	.attrs	= l2x0_pmu_format_attrs,
+};
+
+static ssize_t l2x0_pmu_cpumask_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", L2X0_PMU_CPU);
+}
+
+static struct device_attribute l2x0_pmu_cpumask_attr =
+	__ATTR(cpumask, S_IRUGO, l2x0_pmu_cpumask_show, NULL);
+
+static struct attribute *l2x0_pmu_attrs[] = {
+	&l2x0_pmu_cpumask_attr.attr,
+	NULL,
+};
+
+static struct attribute_group l2x0_pmu_attr_group = {
+	.attrs	= l2x0_pmu_attrs,
+};
+
+static const struct attribute_group *l2x0_pmu_attr_groups[] = {
+	&l2x0_pmu_attr_group,
+	&l2x0_pmu_format_group,
+	NULL,
+};
+
+static struct pmu l2x0_pmu = {
+	.task_ctx_nr	= perf_invalid_context,
+	.attr_groups	= l2x0_pmu_attr_groups,
+	.pmu_enable	= l2x0_pmu_enable,
+	.pmu_disable	= l2x0_pmu_disable,
+	.event_init	= l2x0_pmu_event_init,
+	.add		= l2x0_pmu_event_add,
+	.del		= l2x0_pmu_event_del,
+	.start		= l2x0_pmu_event_start,
+	.stop		= l2x0_pmu_event_stop,
+	.read		= l2x0_pmu_event_read,
+};
+
+void __init l2x0_pmu_register(void __iomem *base, u32 cache_id)
+{
+	/* the L210 and L220 have no event counters */
+	if ((cache_id & L2X0_CACHE_ID_PART_MASK) != L2X0_CACHE_ID_PART_L310)
+		return;
+
+	l2x0_pmu_base = base;
+}
+
+static int __init l2x0_pmu_init(void)
+{
+	int err;
+
+	if (!l2x0_pmu_base)
+		return 0;
+
+	hrtimer_init(&l2x0_pmu_hrtimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	l2x0_pmu_hrtimer.function = l2x0_pmu_poll;
+
+	err = perf_pmu_register(&l2x0_pmu, "l2x0", -1);
+	if (err) {
+		pr_warning("registration failed (%d)\n", err);
+		return err;
+	}
+
+	pr_info("registered %d counters\n", L2X0_PMU_COUNTERS);
+	return 0;
+}
+device_initcall(l2x0_pmu_init);
@@ -20,6 +20,11 @@
 #include <linux/init.h>
 #include <linux/spinlock.h>
 #include <linux/io.h>
+#include <linux/mm.h>
+#include <linux/gfp.h>
+#include <linux/sched.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
 
@@ -36,6 +41,18 @@ static u32 l2x0_cache_id;
 static unsigned int l2x0_sets;
 static unsigned int l2x0_ways;
 
+/*
+ * Range operations at least this long work on all ways instead, which
+ * costs the same whatever the size while line operations grow with it.
+ * Starts at the cache size and is measured once the system is up.
+ */
+static u32 l2x0_flush_threshold;
+
+/* statistics, updated under l2x0_lock */
+static u32 l2x0_range_ops;
+static u64 l2x0_range_bytes;
+static u32 l2x0_all_ops;
+
 static inline bool is_pl310_rev(int rev)
 {
 	return (l2x0_cache_id &
@@ -180,6 +197,7 @@ static void l2x0_flush_all(void)
 
 	/* clean all ways */
 	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	l2x0_all_ops++;
 	__l2x0_flush_all();
 	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
 }
@@ -197,6 +215,7 @@ static void l2x0_clean_all(void)
 
 	/* clean all ways */
 	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	l2x0_all_ops++;
 	debug_writel(0x03);
 	writel_relaxed(l2x0_way_mask, l2x0_base + L2X0_CLEAN_WAY);
 	cache_wait_way(l2x0_base + L2X0_CLEAN_WAY, l2x0_way_mask);
@@ -224,7 +243,19 @@ static void l2x0_inv_range(unsigned long start, unsigned long end)
 	void __iomem *base = l2x0_base;
 	unsigned long flags;
 
+	/*
+	 * Buffers are cleaned before they are handed to a device, so the
+	 * range holds no dirty lines of its own and cleaning along with
+	 * the invalidate writes back only unrelated data.
+	 */
+	if ((end - start) >= l2x0_flush_threshold) {
+		l2x0_flush_all();
+		return;
+	}
+
 	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	l2x0_range_ops++;
+	l2x0_range_bytes += end - start;
 	if (start & (CACHE_LINE_SIZE - 1)) {
 		start &= ~(CACHE_LINE_SIZE - 1);
 		debug_writel(0x03);
@@ -263,12 +294,14 @@ static void l2x0_clean_range(unsigned long start, unsigned long end)
 	void __iomem *base = l2x0_base;
 	unsigned long flags;
 
-	if ((end - start) >= l2x0_size) {
+	if ((end - start) >= l2x0_flush_threshold) {
 		l2x0_clean_all();
 		return;
 	}
 
 	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	l2x0_range_ops++;
+	l2x0_range_bytes += end - start;
 	start &= ~(CACHE_LINE_SIZE - 1);
 	while (start < end) {
 		unsigned long blk_end = start + min(end - start, 4096UL);
@@ -293,12 +326,14 @@ static void l2x0_flush_range(unsigned long start, unsigned long end)
 	void __iomem *base = l2x0_base;
 	unsigned long flags;
 
-	if ((end - start) >= l2x0_size) {
+	if ((end - start) >= l2x0_flush_threshold) {
 		l2x0_flush_all();
 		return;
 	}
 
 	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	l2x0_range_ops++;
+	l2x0_range_bytes += end - start;
 	start &= ~(CACHE_LINE_SIZE - 1);
 	while (start < end) {
 		unsigned long blk_end = start + min(end - start, 4096UL);
@@ -374,6 +409,7 @@ void __init l2x0_init(void __iomem *base, __u32 aux_val, __u32 aux_mask)
 	way_size = SZ_1K << (way_size + 3);
 	l2x0_size = l2x0_ways * way_size;
 	l2x0_sets = way_size / CACHE_LINE_SIZE;
+	l2x0_flush_threshold = l2x0_size;
 
 	/*
 	 * Check if l2x0 controller is already enabled.
@@ -406,7 +442,79 @@ void __init l2x0_init(void __iomem *base, __u32 aux_val, __u32 aux_mask)
 	printk(KERN_INFO "%s cache controller enabled\n", type);
 	printk(KERN_INFO "l2x0: %d ways, CACHE_ID 0x%08x, AUX_CTRL 0x%08x, Cache size: %d B\n",
 			l2x0_ways, l2x0_cache_id, aux, l2x0_size);
+
+	l2x0_pmu_register(l2x0_base, l2x0_cache_id);
+}
+
+/*
+ * Time a flush of a dirty cache-sized buffer by lines against a flush of
+ * all ways: the line cost is linear in the size, so the break-even size
+ * is the cache size scaled by the ratio of the two.
+ */
+static void __init l2x0_measure_threshold(void)
+{
+	struct page *page;
+	void *vaddr;
+	phys_addr_t paddr;
+	u64 t_lines, t_all;
+
+	page = alloc_pages(GFP_KERNEL, get_order(l2x0_size));
+	if (!page)
+		return;
+	vaddr = page_address(page);
+	paddr = page_to_phys(page);
+
+	l2x0_flush_threshold = U32_MAX;
+	preempt_disable();
+
+	memset(vaddr, 0x5a, l2x0_size);
+	__cpuc_flush_dcache_area(vaddr, l2x0_size);
+	t_lines = sched_clock();
+	l2x0_flush_range(paddr, paddr + l2x0_size);
+	t_lines = sched_clock() - t_lines;
+
+	memset(vaddr, 0xa5, l2x0_size);
+	__cpuc_flush_dcache_area(vaddr, l2x0_size);
+	t_all = sched_clock();
+	l2x0_flush_all();
+	t_all = sched_clock() - t_all;
+
+	preempt_enable();
+
+	if (t_lines)
+		l2x0_flush_threshold = clamp_t(u64,
+			div64_u64((u64)l2x0_size * t_all, t_lines),
+			PAGE_SIZE, l2x0_size);
+	else
+		l2x0_flush_threshold = l2x0_size;
+
+	__free_pages(page, get_order(l2x0_size));
+
+	pr_info("l2x0: by-way maintenance from %u bytes (%llu/%llu ns)\n",
+		l2x0_flush_threshold, t_all, t_lines);
+}
+
+static int __init l2x0_late_init(void)
+{
+	struct dentry *dir;
+
+	if (!l2x0_base)
+		return 0;
+
+	l2x0_measure_threshold();
+
+	dir = debugfs_create_dir("l2x0", NULL);
+	if (IS_ERR_OR_NULL(dir))
+		return 0;
+
+	debugfs_create_u32("flush_threshold", S_IRUGO | S_IWUSR, dir,
+			   &l2x0_flush_threshold);
+	debugfs_create_u32("range_ops", S_IRUGO, dir, &l2x0_range_ops);
+	debugfs_create_u64("range_bytes", S_IRUGO, dir, &l2x0_range_bytes);
+	debugfs_create_u32("all_ops", S_IRUGO, dir, &l2x0_all_ops);
+	return 0;
 }
+late_initcall(l2x0_late_init);
 
 #ifdef CONFIG_OF
 static void __init l2x0_of_setup(const struct device_node *np,
@@ -11,12 +11,14 @@
 #include <linux/spinlock.h>
 #include <linux/mm.h>
 #include <linux/highmem.h>
+#include <linux/sched.h>
 
 #include <asm/pgtable.h>
 #include <asm/shmparam.h>
 #include <asm/tlbflush.h>
 #include <asm/cacheflush.h>
 #include <asm/cachetype.h>
+#include <asm/outercache.h>
 
 #include "mm.h"
 
@@ -138,3 +140,59 @@ static int __init v6_userpage_init(void)
 }
 
 core_initcall(v6_userpage_init);
+
+/*
+ * copy_page() preloads copy_page_pld_dist bytes ahead of the source. The
+ * distance that hides memory latency best depends on the L2 and DRAM of
+ * the SoC, so time a few of them on cold pages once and keep the fastest.
+ */
+#define PLD_TUNE_ORDER	4
+#define PLD_TUNE_RUNS	3
+
+static int __init v6_copy_page_tune(void)
+{
+	static const unsigned int lines[] __initconst = { 2, 4, 6, 8 };
+	unsigned int best = copy_page_pld_dist;
+	u64 best_ns = ULLONG_MAX;
+	unsigned long src, dst;
+	int i, j, run;
+	u64 t;
+
+	src = __get_free_pages(GFP_KERNEL, PLD_TUNE_ORDER);
+	dst = __get_free_pages(GFP_KERNEL, PLD_TUNE_ORDER);
+	if (!src || !dst)
+		goto out;
+
+	for (i = 0; i < ARRAY_SIZE(lines); i++) {
+		copy_page_pld_dist = lines[i] * L1_CACHE_BYTES;
+
+		for (run = 0; run < PLD_TUNE_RUNS; run++) {
+			preempt_disable();
+			flush_cache_all();
+			outer_flush_all();
+
+			t = sched_clock();
+			for (j = 0; j < (1 << PLD_TUNE_ORDER); j++)
+				copy_page((void *)dst + j * PAGE_SIZE,
+					  (void *)src + j * PAGE_SIZE);
+			t = sched_clock() - t;
+			preempt_enable();
+
+			if (t < best_ns) {
+				best_ns = t;
+				best = copy_page_pld_dist;
+			}
+		}
+	}
+
+	pr_info("copy_page: preload %u bytes ahead\n", best);
+out:
+	copy_page_pld_dist = best;
+	if (src)
+		free_pages(src, PLD_TUNE_ORDER);
+	if (dst)
+		free_pages(dst, PLD_TUNE_ORDER);
+	return 0;
+}
+
+late_initcall(v6_copy_page_tune);
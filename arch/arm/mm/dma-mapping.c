@@ -19,6 +19,7 @@
 #include <linux/dma-mapping.h>
 #include <linux/highmem.h>
 #include <linux/slab.h>
+#include <linux/debugfs.h>
 
 #include <asm/memory.h>
 #include <asm/highmem.h>
@@ -582,6 +583,86 @@ void ___dma_page_dev_to_cpu(struct page *page, unsigned long off,
 }
 EXPORT_SYMBOL(___dma_page_dev_to_cpu);
 
+#ifndef CONFIG_DMABOUNCE
+/*
+ * Scatterlists from the camera, codec and 2D allocators are mostly runs
+ * of physically adjacent pages. The outer cache is maintained once per
+ * run rather than once per entry, so a multi-megabyte buffer takes the
+ * L2 lock and sync a few times and can reach its by-way threshold.
+ * The counters are not locked and only meant for tuning.
+ */
+static u32 dma_sg_entries;
+static u32 dma_sg_runs;
+
+static void dma_outer_maint(phys_addr_t start, phys_addr_t end,
+	enum dma_data_direction dir, bool to_dev)
+{
+	if (to_dev && dir != DMA_FROM_DEVICE)
+		outer_clean_range(start, end);
+	else if (dir != DMA_TO_DEVICE)
+		outer_inv_range(start, end);
+}
+
+static void dma_sg_outer_maint(struct scatterlist *sg, int nents,
+	enum dma_data_direction dir, bool to_dev)
+{
+	struct scatterlist *s;
+	phys_addr_t start = 0, end = 0;
+	int i;
+
+	for_each_sg(sg, s, nents, i) {
+		phys_addr_t paddr = sg_phys(s);
+
+		dma_sg_entries++;
+		if (end != start && paddr == end) {
+			end += s->length;
+			continue;
+		}
+		if (end != start) {
+			dma_outer_maint(start, end, dir, to_dev);
+			dma_sg_runs++;
+		}
+		start = paddr;
+		end = paddr + s->length;
+	}
+	if (end != start) {
+		dma_outer_maint(start, end, dir, to_dev);
+		dma_sg_runs++;
+	}
+}
+
+static void dma_sg_cpu_to_dev(struct scatterlist *sg, int nents,
+	enum dma_data_direction dir)
+{
+	struct scatterlist *s;
+	int i;
+
+	for_each_sg(sg, s, nents, i)
+		dma_cache_maint_page(sg_page(s), s->offset, s->length, dir,
+				     dmac_map_area);
+
+	dma_sg_outer_maint(sg, nents, dir, true);
+}
+
+static void dma_sg_dev_to_cpu(struct scatterlist *sg, int nents,
+	enum dma_data_direction dir)
+{
+	struct scatterlist *s;
+	int i;
+
+	dma_sg_outer_maint(sg, nents, dir, false);
+
+	for_each_sg(sg, s, nents, i) {
+		dma_cache_maint_page(sg_page(s), s->offset, s->length, dir,
+				     dmac_unmap_area);
+
+		if (dir != DMA_TO_DEVICE && s->offset == 0 &&
+		    s->length >= PAGE_SIZE)
+			set_bit(PG_dcache_clean, &sg_page(s)->flags);
+	}
+}
+#endif
+
 /**
  * dma_map_sg - map a set of SG buffers for streaming mode DMA
  * @dev: valid struct device pointer, or NULL for ISA and EISA-like devices
@@ -606,6 +687,17 @@ int dma_map_sg(struct device *dev, struct scatterlist *sg, int nents,
 
 	BUG_ON(!valid_dma_direction(dir));
 
+#ifndef CONFIG_DMABOUNCE
+	if (!arch_is_coherent()) {
+		for_each_sg(sg, s, nents, i)
+			s->dma_address = pfn_to_dma(dev, page_to_pfn(sg_page(s))) +
+					 s->offset;
+		dma_sg_cpu_to_dev(sg, nents, dir);
+		debug_dma_map_sg(dev, sg, nents, nents, dir);
+		return nents;
+	}
+#endif
+
 	for_each_sg(sg, s, nents, i) {
 		s->dma_address = __dma_map_page(dev, sg_page(s), s->offset,
 						s->length, dir);
@@ -640,6 +732,13 @@ void dma_unmap_sg(struct device *dev, struct scatterlist *sg, int nents,
 
 	debug_dma_unmap_sg(dev, sg, nents, dir);
 
+#ifndef CONFIG_DMABOUNCE
+	if (!arch_is_coherent()) {
+		dma_sg_dev_to_cpu(sg, nents, dir);
+		return;
+	}
+#endif
+
 	for_each_sg(sg, s, nents, i)
 		__dma_unmap_page(dev, sg_dma_address(s), sg_dma_len(s), dir);
 }
@@ -658,6 +757,14 @@ void dma_sync_sg_for_cpu(struct device *dev, struct scatterlist *sg,
 	struct scatterlist *s;
 	int i;
 
+#ifndef CONFIG_DMABOUNCE
+	if (!arch_is_coherent()) {
+		dma_sg_dev_to_cpu(sg, nents, dir);
+		debug_dma_sync_sg_for_cpu(dev, sg, nents, dir);
+		return;
+	}
+#endif
+
 	for_each_sg(sg, s, nents, i) {
 		if (!dmabounce_sync_for_cpu(dev, sg_dma_address(s), 0,
 					    sg_dma_len(s), dir))
@@ -684,6 +791,14 @@ void dma_sync_sg_for_device(struct device *dev, struct scatterlist *sg,
 	struct scatterlist *s;
 	int i;
 
+#ifndef CONFIG_DMABOUNCE
+	if (!arch_is_coherent()) {
+		dma_sg_cpu_to_dev(sg, nents, dir);
+		debug_dma_sync_sg_for_device(dev, sg, nents, dir);
+		return;
+	}
+#endif
+
 	for_each_sg(sg, s, nents, i) {
 		if (!dmabounce_sync_for_device(dev, sg_dma_address(s), 0,
 					sg_dma_len(s), dir))
@@ -735,3 +850,19 @@ static int __init dma_debug_do_init(void)
 	return 0;
 }
 fs_initcall(dma_debug_do_init);
+
+#ifndef CONFIG_DMABOUNCE
+static int __init dma_sg_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("dma_sg", NULL);
+	if (IS_ERR_OR_NULL(dir))
+		return 0;
+
+	debugfs_create_u32("entries", S_IRUGO, dir, &dma_sg_entries);
+	debugfs_create_u32("outer_runs", S_IRUGO, dir, &dma_sg_runs);
+	return 0;
+}
+late_initcall(dma_sg_debugfs_init);
+#endif
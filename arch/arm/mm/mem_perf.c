@@ -0,0 +1,340 @@
+/* linux/arch/arm/mm/mem_perf.c
+ *
+ * Microbenchmarks of the memory primitives: memcpy, memset, the user copy
+ * routines, page copy and clear, and L1/outer cache maintenance.
+ *
+ * Opening <debugfs>/mem_perf runs the whole suite on the calling cpu and
+ * reading it returns one line per case with the best time of a few rounds, the
+ * throughput and, when cpufreq knows the clock, cycles per byte:
+ *
+ *	memcpy   4096 0/0      811 ns  5050 MB/s  0.24 cyc/B
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/mm.h>
+#include <linux/mman.h>
+#include <linux/gfp.h>
+#include <linux/debugfs.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/cpufreq.h>
+#include <linux/uaccess.h>
+#include <linux/math64.h>
+#include <linux/string.h>
+#include <linux/dma-mapping.h>
+
+#include <asm/cacheflush.h>
+#include <asm/outercache.h>
+
+#define PERF_MIN_SIZE	64
+#define PERF_MAX_SIZE	SZ_512K
+#define PERF_ORDER	get_order(PERF_MAX_SIZE + PAGE_SIZE)
+#define PERF_BYTES	SZ_4M		/* moved per round */
+#define PERF_ROUNDS	3
+#define PERF_REPORT	SZ_16K
+
+static DEFINE_MUTEX(mem_perf_mutex);
+
+/* src/dst byte offsets tried for memcpy and memset */
+static const unsigned int perf_align[][2] = {
+	{ 0, 0 }, { 1, 0 }, { 0, 3 }, { 2, 1 },
+};
+
+enum perf_op {
+	OP_MEMCPY,
+	OP_MEMSET,
+	OP_COPY_TO_USER,
+	OP_COPY_FROM_USER,
+	OP_COPY_PAGE,
+	OP_CLEAR_PAGE,
+	OP_DMA_CLEAN,
+	OP_DMA_INV,
+	OP_DMA_FLUSH,
+	OP_FLUSH_ALL,
+	OP_OUTER_CLEAN,
+	OP_OUTER_INV,
+	OP_OUTER_FLUSH,
+};
+
+static const char * const perf_op_name[] = {
+	[OP_MEMCPY]		= "memcpy",
+	[OP_MEMSET]		= "memset",
+	[OP_COPY_TO_USER]	= "copy_to_user",
+	[OP_COPY_FROM_USER]	= "copy_from_user",
+	[OP_COPY_PAGE]		= "copy_page",
+	[OP_CLEAR_PAGE]		= "clear_page",
+	[OP_DMA_CLEAN]		= "dma_clean",
+	[OP_DMA_INV]		= "dma_inv",
+	[OP_DMA_FLUSH]		= "dma_flush",
+	[OP_FLUSH_ALL]		= "flush_cache_all",
+	[OP_OUTER_CLEAN]	= "outer_clean",
+	[OP_OUTER_INV]		= "outer_inv",
+	[OP_OUTER_FLUSH]	= "outer_flush",
+};
+
+struct perf_bufs {
+	void *src;
+	void *dst;
+	void __user *ubuf;
+	char *report;
+	size_t len;
+};
+
+static __printf(2, 3) void perf_report(struct perf_bufs *b,
+				       const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	b->len += vscnprintf(b->report + b->len, PERF_REPORT - b->len,
+			     fmt, args);
+	va_end(args);
+}
+
+static int perf_do(enum perf_op op, struct perf_bufs *b, void *s, void *d,
+		   size_t size)
+{
+	phys_addr_t phys = virt_to_phys(d);
+	size_t off;
+
+	switch (op) {
+	case OP_MEMCPY:
+		memcpy(d, s, size);
+		break;
+	case OP_MEMSET:
+		memset(d, 0x5a, size);
+		break;
+	case OP_COPY_TO_USER:
+		if (copy_to_user(b->ubuf, s, size))
+			return -EFAULT;
+		break;
+	case OP_COPY_FROM_USER:
+		if (copy_from_user(d, b->ubuf, size))
+			return -EFAULT;
+		break;
+	case OP_COPY_PAGE:
+		for (off = 0; off < size; off += PAGE_SIZE)
+			copy_page(d + off, s + off);
+		break;
+	case OP_CLEAR_PAGE:
+		for (off = 0; off < size; off += PAGE_SIZE)
+			clear_page(d + off);
+		break;
+	case OP_DMA_CLEAN:
+		dmac_map_area(d, size, DMA_TO_DEVICE);
+		break;
+	case OP_DMA_INV:
+		dmac_unmap_area(d, size, DMA_FROM_DEVICE);
+		break;
+	case OP_DMA_FLUSH:
+		dmac_flush_range(d, d + size);
+		break;
+	case OP_FLUSH_ALL:
+		flush_cache_all();
+		break;
+	case OP_OUTER_CLEAN:
+		outer_clean_range(phys, phys + size);
+		break;
+	case OP_OUTER_INV:
+		outer_inv_range(phys, phys + size);
+		break;
+	case OP_OUTER_FLUSH:
+		outer_flush_range(phys, phys + size);
+		break;
+	}
+
+	return 0;
+}
+
+static int perf_case(enum perf_op op, struct perf_bufs *b, size_t size,
+		     unsigned int soff, unsigned int doff)
+{
+	unsigned int loops = max_t(unsigned int, PERF_BYTES / size, 1);
+	unsigned int khz = cpufreq_quick_get(raw_smp_processor_id());
+	u64 best = ULLONG_MAX;
+	u64 ns, bytes;
+	unsigned int i, round;
+	int ret;
+
+	for (round = 0; round < PERF_ROUNDS; round++) {
+		/* dirty the destination so maintenance has work to do */
+		if (op >= OP_DMA_CLEAN)
+			memset(b->dst, round, PERF_MAX_SIZE);
+
+		ns = sched_clock();
+		for (i = 0; i < loops; i++) {
+			ret = perf_do(op, b, b->src + soff, b->dst + doff,
+				      size);
+			if (ret)
+				return ret;
+		}
+		ns = sched_clock() - ns;
+		best = min(best, ns);
+		cond_resched();
+	}
+
+	bytes = (u64)size * loops;
+	ns = div_u64(best, loops);
+	perf_report(b, "%-16s %7zu %u/%u %9llu ns %6llu MB/s",
+		   perf_op_name[op], size, soff, doff, ns,
+		   div64_u64(bytes * 1000, max_t(u64, best, 1)));
+	if (khz) {
+		/* cycles per byte in hundredths */
+		u64 cpb = div64_u64(best * khz, bytes * 10000);
+
+		perf_report(b, " %3llu.%02llu cyc/B",
+			   div_u64(cpb, 100), cpb - div_u64(cpb, 100) * 100);
+	}
+	perf_report(b, "\n");
+
+	return 0;
+}
+
+static int perf_sizes(enum perf_op op, struct perf_bufs *b, size_t min_size,
+		      unsigned int soff, unsigned int doff)
+{
+	size_t size;
+	int ret;
+
+	for (size = min_size; size <= PERF_MAX_SIZE; size *= 4) {
+		ret = perf_case(op, b, size, soff, doff);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int mem_perf_run(struct perf_bufs *bp)
+{
+	struct perf_bufs b = *bp;
+	unsigned long src, dst, ubuf;
+	enum perf_op op;
+	int i, ret;
+
+	src = __get_free_pages(GFP_KERNEL, PERF_ORDER);
+	dst = __get_free_pages(GFP_KERNEL, PERF_ORDER);
+	ubuf = vm_mmap(NULL, 0, PERF_MAX_SIZE, PROT_READ | PROT_WRITE,
+		       MAP_ANONYMOUS | MAP_PRIVATE, 0);
+	if (!src || !dst || IS_ERR_VALUE(ubuf)) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	b.src = (void *)src;
+	b.dst = (void *)dst;
+	b.ubuf = (void __user *)ubuf;
+	memset(b.src, 0xab, PERF_MAX_SIZE);
+
+	/* fault the user pages in before they are timed */
+	ret = -EFAULT;
+	if (clear_user(b.ubuf, PERF_MAX_SIZE))
+		goto out;
+
+	mutex_lock(&mem_perf_mutex);
+
+	for (i = 0; i < ARRAY_SIZE(perf_align); i++) {
+		ret = perf_sizes(OP_MEMCPY, &b, PERF_MIN_SIZE,
+				 perf_align[i][0], perf_align[i][1]);
+		if (ret)
+			goto unlock;
+	}
+	for (i = 0; i < ARRAY_SIZE(perf_align); i++) {
+		ret = perf_sizes(OP_MEMSET, &b, PERF_MIN_SIZE,
+				 0, perf_align[i][1]);
+		if (ret)
+			goto unlock;
+	}
+
+	for (op = OP_COPY_TO_USER; op <= OP_OUTER_FLUSH; op++) {
+#ifndef CONFIG_OUTER_CACHE
+		if (op >= OP_OUTER_CLEAN)
+			break;
+#endif
+
+		if (op == OP_FLUSH_ALL)
+			ret = perf_case(op, &b, PERF_MAX_SIZE, 0, 0);
+		else if (op == OP_COPY_PAGE || op == OP_CLEAR_PAGE)
+			ret = perf_sizes(op, &b, PAGE_SIZE, 0, 0);
+		else
+			ret = perf_sizes(op, &b, PERF_MIN_SIZE, 0, 0);
+		if (ret)
+			goto unlock;
+	}
+
+unlock:
+	mutex_unlock(&mem_perf_mutex);
+	bp->len = b.len;
+out:
+	if (!IS_ERR_VALUE(ubuf))
+		vm_munmap(ubuf, PERF_MAX_SIZE);
+	if (dst)
+		free_pages(dst, PERF_ORDER);
+	if (src)
+		free_pages(src, PERF_ORDER);
+	return ret;
+}
+
+/* the suite runs once per open, reads return its report */
+static int mem_perf_open(struct inode *inode, struct file *file)
+{
+	struct perf_bufs *b;
+	int ret;
+
+	b = kzalloc(sizeof(*b), GFP_KERNEL);
+	if (!b)
+		return -ENOMEM;
+
+	b->report = kmalloc(PERF_REPORT, GFP_KERNEL);
+	if (!b->report) {
+		kfree(b);
+		return -ENOMEM;
+	}
+
+	ret = mem_perf_run(b);
+	if (ret) {
+		kfree(b->report);
+		kfree(b);
+		return ret;
+	}
+
+	file->private_data = b;
+	return 0;
+}
+
+static ssize_t mem_perf_read(struct file *file, char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	struct perf_bufs *b = file->private_data;
+
+	return simple_read_from_buffer(buf, count, ppos, b->report, b->len);
+}
+
+static int mem_perf_release(struct inode *inode, struct file *file)
+{
+	struct perf_bufs *b = file->private_data;
+
+	kfree(b->report);
+	kfree(b);
+	return 0;
+}
+
+static const struct file_operations mem_perf_fops = {
+	.open		= mem_perf_open,
+	.read		= mem_perf_read,
+	.llseek		= default_llseek,
+	.release	= mem_perf_release,
+};
+
+static int __init mem_perf_init(void)
+{
+	debugfs_create_file("mem_perf", S_IRUSR, NULL, NULL, &mem_perf_fops);
+	return 0;
+}
+late_initcall(mem_perf_init);
@@ -11,6 +11,8 @@
 #include <linux/gfp.h>
 #include <linux/highmem.h>
 #include <linux/slab.h>
+#include <linux/percpu.h>
+#include <linux/cpu.h>
 
 #include <asm/cp15.h>
 #include <asm/pgalloc.h>
@@ -23,8 +25,69 @@
 #define __pgd_alloc()	kmalloc(PTRS_PER_PGD * sizeof(pgd_t), GFP_KERNEL)
 #define __pgd_free(pgd)	kfree(pgd)
 #else
-#define __pgd_alloc()	(pgd_t *)__get_free_pages(GFP_KERNEL, 2)
-#define __pgd_free(pgd)	free_pages((unsigned long)pgd, 2)
+/*
+ * Every fork needs an order-2 block for the level 1 table, and once memory
+ * is fragmented getting one means compaction or reclaim on the fork path.
+ * Each cpu keeps the last few freed tables for the next fork instead;
+ * pgd_alloc() rewrites both the user and the kernel entries anyway.
+ */
+#define PGD_ORDER		2
+#define PGD_CACHE_DEPTH		4
+
+struct pgd_cache {
+	int nr;
+	pgd_t *pgd[PGD_CACHE_DEPTH];
+};
+
+static DEFINE_PER_CPU(struct pgd_cache, pgd_cache);
+
+static pgd_t *__pgd_alloc(void)
+{
+	struct pgd_cache *cache = &get_cpu_var(pgd_cache);
+	pgd_t *pgd = NULL;
+
+	if (cache->nr)
+		pgd = cache->pgd[--cache->nr];
+	put_cpu_var(pgd_cache);
+
+	if (!pgd)
+		pgd = (pgd_t *)__get_free_pages(GFP_KERNEL, PGD_ORDER);
+	return pgd;
+}
+
+static void __pgd_free(pgd_t *pgd)
+{
+	struct pgd_cache *cache = &get_cpu_var(pgd_cache);
+
+	if (cache->nr < PGD_CACHE_DEPTH) {
+		cache->pgd[cache->nr++] = pgd;
+		pgd = NULL;
+	}
+	put_cpu_var(pgd_cache);
+
+	if (pgd)
+		free_pages((unsigned long)pgd, PGD_ORDER);
+}
+
+static int __cpuinit pgd_cache_cpu_notify(struct notifier_block *self,
+					  unsigned long action, void *hcpu)
+{
+	struct pgd_cache *cache = &per_cpu(pgd_cache, (long)hcpu);
+
+	if (action == CPU_DEAD || action == CPU_DEAD_FROZEN) {
+		while (cache->nr)
+			free_pages((unsigned long)cache->pgd[--cache->nr],
+				   PGD_ORDER);
+	}
+	return NOTIFY_OK;
+}
+
+static int __init pgd_cache_init(void)
+{
+	hotcpu_notifier(pgd_cache_cpu_notify, 0);
+	return 0;
+}
+core_initcall(pgd_cache_init);
 #endif
 
 /*
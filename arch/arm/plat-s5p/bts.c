@@ -22,6 +22,9 @@
 #include <linux/dma-mapping.h>
 #include <linux/slab.h>
 #include <linux/clk.h>
+#include <linux/jiffies.h>
+#include <linux/module.h>
+#include <linux/spinlock.h>
 #if (defined(CONFIG_EXYNOS_DEV_PD) && defined(CONFIG_PM_RUNTIME))
 #include <linux/pm_runtime.h>
 #include <plat/pd.h>
@@ -30,6 +33,9 @@
 #include <plat/cpu.h>
 #include <plat/bts.h>
 #include <mach/map.h>
+#ifdef CONFIG_ARCH_EXYNOS5
+#include <mach/ppmu.h>
+#endif
 
 /* BTS register */
 #define BTS_CONTROL 0x0
@@ -83,6 +89,28 @@
 static LIST_HEAD(fbm_list);
 static LIST_HEAD(bts_list);
 
+/*
+ * Best-effort masters are only blocked in favour of the hard-time ones
+ * while the display is at risk: from the DRAM load reaching
+ * congested_load, or a FIFO underrun, until the load falls below
+ * relaxed_load and underrun_hold_ms passed since the last underrun.
+ * The rest of the time they get the bus to themselves and busfreq does
+ * not need to keep DRAM clocked for the worst case.
+ */
+static unsigned int bts_congested_load = 70;
+static unsigned int bts_relaxed_load = 50;
+static unsigned int bts_underrun_hold_ms = 1000;
+module_param_named(congested_load, bts_congested_load, uint, 0644);
+module_param_named(relaxed_load, bts_relaxed_load, uint, 0644);
+module_param_named(underrun_hold_ms, bts_underrun_hold_ms, uint, 0644);
+
+/* protects bts_list, the on state of the blocks and the policy */
+static DEFINE_SPINLOCK(bts_lock);
+static bool bts_congested = true;
+static unsigned long bts_hold_until;
+static unsigned long bts_nr_underrun;
+module_param_named(nr_underrun, bts_nr_underrun, ulong, 0444);
+
 struct exynos_bts_local_data {
 	enum exynos_bts_id id;
 	void __iomem	*base;
@@ -96,6 +124,7 @@ struct exynos_bts_data {
 	struct clk *clk;
 	enum exynos_pd_block pd_block;
 	u32 listnum;
+	bool on;
 };
 
 struct exynos_fbm_data {
@@ -194,6 +223,19 @@ static void fbm_init_config(void __iomem *base, enum bts_priority prior)
 	}
 }
 
+/* blocking of a best-effort master by the hard-time ones, FBM driven */
+static void bts_set_blocking(void __iomem *base, enum bts_priority prior,
+		bool congested)
+{
+	if (prior != BTS_BE)
+		return;
+
+	if (congested)
+		bts_set_control(base, prior);
+	else
+		writel(BTS_ON_OFF, base + BTS_CONTROL);
+}
+
 static void bts_init_config(void __iomem *base, enum bts_priority prior)
 {
 	if (prior == BTS_BE) {
@@ -220,11 +262,75 @@ static void __exynos_bts_enable(struct exynos_bts_data *bts_data)
 	for (i = 0; i < bts_data->listnum; i++) {
 		bts_init_config(bts_local_data->base,
 				bts_local_data->def_priority);
+		bts_set_blocking(bts_local_data->base,
+				bts_local_data->def_priority, bts_congested);
 		bts_local_data++;
 	}
 
 	if (bts_data->clk)
 		clk_disable(bts_data->clk);
+
+	bts_data->on = true;
+}
+
+/* Called with bts_lock held, only the blocks that are powered are touched */
+static void bts_set_congested(bool congested)
+{
+	struct exynos_bts_data *bts_data;
+	struct exynos_bts_local_data *bts_local_data;
+	int i;
+
+	if (bts_congested == congested)
+		return;
+
+	bts_congested = congested;
+
+	list_for_each_entry(bts_data, &bts_list, node) {
+		if (!bts_data->on)
+			continue;
+
+		if (bts_data->clk)
+			clk_enable(bts_data->clk);
+
+		bts_local_data = bts_data->bts_local_data;
+		for (i = 0; i < bts_data->listnum; i++) {
+			bts_set_blocking(bts_local_data->base,
+					bts_local_data->def_priority,
+					congested);
+			bts_local_data++;
+		}
+
+		if (bts_data->clk)
+			clk_disable(bts_data->clk);
+	}
+}
+
+void exynos_bts_update_load(unsigned int dram_load)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&bts_lock, flags);
+
+	if (dram_load >= bts_congested_load)
+		bts_set_congested(true);
+	else if (dram_load < bts_relaxed_load &&
+			time_after_eq(jiffies, bts_hold_until))
+		bts_set_congested(false);
+
+	spin_unlock_irqrestore(&bts_lock, flags);
+}
+
+void exynos_bts_fifo_underrun(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&bts_lock, flags);
+
+	bts_nr_underrun++;
+	bts_hold_until = jiffies + msecs_to_jiffies(bts_underrun_hold_ms);
+	bts_set_congested(true);
+
+	spin_unlock_irqrestore(&bts_lock, flags);
 }
 
 void exynos_bts_set_priority(enum bts_priority prior)
@@ -251,6 +357,9 @@ void exynos_bts_enable(enum exynos_pd_block pd_block)
 {
 	struct exynos_bts_data *bts_data;
 	struct exynos_fbm_data *fbm_data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&bts_lock, flags);
 
 	if (pd_block == PD_TOP) {
 		list_for_each_entry(fbm_data, &fbm_list, node)
@@ -262,8 +371,50 @@ void exynos_bts_enable(enum exynos_pd_block pd_block)
 		if (bts_data->pd_block == pd_block)
 			__exynos_bts_enable(bts_data);
 	}
+
+	spin_unlock_irqrestore(&bts_lock, flags);
+}
+
+void exynos_bts_disable(enum exynos_pd_block pd_block)
+{
+	struct exynos_bts_data *bts_data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&bts_lock, flags);
+
+	list_for_each_entry(bts_data, &bts_list, node) {
+		if (bts_data->pd_block == pd_block)
+			bts_data->on = false;
+	}
+
+	spin_unlock_irqrestore(&bts_lock, flags);
+}
+
+#ifdef CONFIG_ARCH_EXYNOS5
+static int bts_ppmu_notifier(struct notifier_block *nb, unsigned long event,
+		void *data)
+{
+	struct ppmu_sample *sample = data;
+	unsigned int load;
+
+	if (!(sample->updated & ((1 << PPMU_DDR_C) | (1 << PPMU_DDR_R1) |
+					(1 << PPMU_DDR_L))))
+		return NOTIFY_DONE;
+
+	/* the busiest DRAM port */
+	load = max(sample->load[PPMU_DDR_C], sample->load[PPMU_DDR_R1]);
+	load = max(load, sample->load[PPMU_DDR_L]);
+
+	exynos_bts_update_load(load);
+
+	return NOTIFY_OK;
 }
 
+static struct notifier_block bts_ppmu_nb = {
+	.notifier_call = bts_ppmu_notifier,
+};
+#endif
+
 static int bts_probe(struct platform_device *pdev)
 {
 	struct exynos_bts_pdata *bts_pdata;
@@ -274,6 +425,7 @@ static int bts_probe(struct platform_device *pdev)
 	struct resource *res = NULL;
 	void __iomem	*base;
 	struct clk *clk = NULL;
+	unsigned long flags;
 	int i, ret = 0;
 
 	bts_pdata = pdev->dev.platform_data;
@@ -337,7 +489,17 @@ static int bts_probe(struct platform_device *pdev)
 	bts_data->pd_block = bts_pdata->pd_block;
 	bts_data->clk = clk;
 	bts_data->dev = &pdev->dev;
+	bts_data->on = true;
+
+	spin_lock_irqsave(&bts_lock, flags);
+	bts_local_data = bts_local_data_h;
+	for (i = 0; i < bts_data->listnum; i++) {
+		bts_set_blocking(bts_local_data->base,
+				bts_local_data->def_priority, bts_congested);
+		bts_local_data++;
+	}
 	list_add_tail(&bts_data->node, &bts_list);
+	spin_unlock_irqrestore(&bts_lock, flags);
 	pdev->dev.platform_data = bts_data;
 
 probe_err:
@@ -353,15 +515,19 @@ static int bts_remove(struct platform_device *pdev)
 	struct exynos_fbm_data *fbm_data;
 	struct exynos_bts_data *bts_data = pdev->dev.platform_data;
 	struct exynos_bts_local_data *bts_local_data;
+	unsigned long flags;
 	int i;
 
+	spin_lock_irqsave(&bts_lock, flags);
+	list_del(&bts_data->node);
+	spin_unlock_irqrestore(&bts_lock, flags);
+
 	bts_local_data = bts_data->bts_local_data;
 	for (i = 0; i < bts_data->listnum; i++) {
 		bts_local_data++;
 		iounmap(bts_local_data->base);
 	}
 	kfree(bts_data->bts_local_data);
-	list_del(&bts_data->node);
 	kfree(bts_data);
 
 	if (list_empty(&bts_list))
@@ -388,6 +554,9 @@ static struct platform_driver bts_driver = {
 
 static int __init bts_init(void)
 {
+#ifdef CONFIG_ARCH_EXYNOS5
+	ppmu_register_notifier(&bts_ppmu_nb);
+#endif
 	return platform_driver_register(&bts_driver);
 }
 arch_initcall(bts_init);
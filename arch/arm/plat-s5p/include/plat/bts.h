@@ -83,10 +83,24 @@ struct exynos_bts_pdata {
 
 /* BTS functions */
 void exynos_bts_enable(enum exynos_pd_block pd_block);
+void exynos_bts_disable(enum exynos_pd_block pd_block);
 void exynos_bts_set_priority(enum bts_priority prior);
 #ifdef CONFIG_S5P_BTS
 #define bts_enable(a) exynos_bts_enable(a);
+#define bts_disable(a) exynos_bts_disable(a);
+
+/*
+ * Inputs of the blocking policy: the busiest DRAM port in percent from
+ * the PPMU sampling, and the display FIFO underrun interrupt. Both are
+ * safe from atomic context.
+ */
+void exynos_bts_update_load(unsigned int dram_load);
+void exynos_bts_fifo_underrun(void);
 #else
 #define bts_enable(a) do {} while (0)
+#define bts_disable(a) do {} while (0)
+
+static inline void exynos_bts_update_load(unsigned int dram_load) { }
+static inline void exynos_bts_fifo_underrun(void) { }
 #endif
 #endif	/* __EXYNOS_BTS_H_ */
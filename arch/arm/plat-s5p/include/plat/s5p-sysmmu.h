@@ -111,6 +111,18 @@ void s5p_sysmmu_tlb_invalidate_entry(struct device *owner,
 					unsigned int count,
 					unsigned long page_size);
 
+/**
+ * s5p_sysmmu_tlb_invalidate_range() - flush TLB entries of an address range
+ * @owner: The device whose System MMU.
+ * @iova: start of the device address range.
+ * @size: size of the range in bytes.
+ *
+ * The System MMU is blocked once for the whole range. Large ranges flush
+ * the whole TLB instead, which is cheaper than walking them.
+ */
+void s5p_sysmmu_tlb_invalidate_range(struct device *owner, unsigned long iova,
+					size_t size);
+
 /** s5p_sysmmu_set_fault_handler() - Fault handler for System MMUs
  * Called when interrupt occurred by the System MMUs
  * The device drivers of peripheral devices that has a System MMU can implement
@@ -145,7 +157,26 @@ void s5p_sysmmu_set_prefbuf(struct device *owner,
 #define s5p_sysmmu_disable(owner) do { } while (0)
 #define s5p_sysmmu_set_tablebase_pgd(owner, pgd) do { } while (0)
 #define s5p_sysmmu_tlb_invalidate(owner) do { } while (0)
+#define s5p_sysmmu_tlb_invalidate_range(owner, iova, size) do { } while (0)
 #define s5p_sysmmu_set_fault_handler(sysmmu, handler) do { } while (0)
 #define s5p_sysmmu_set_prefbuf(owner, base, size) do { } while (0)
 #endif
+
+struct iommu_domain;
+
+#ifdef CONFIG_IOMMU_EXYNOS4_API
+/**
+ * s5p_iommu_tlb_batch_begin() - defer TLB invalidation of unmapped areas
+ * @domain: The IOMMU domain that is about to be unmapped from.
+ *
+ * Unmaps between this and s5p_iommu_tlb_batch_end() only record the range
+ * they cleared. The TLB is invalidated once for the whole range at the end,
+ * which must come before the range is reused.
+ */
+void s5p_iommu_tlb_batch_begin(struct iommu_domain *domain);
+void s5p_iommu_tlb_batch_end(struct iommu_domain *domain);
+#else
+#define s5p_iommu_tlb_batch_begin(domain) do { } while (0)
+#define s5p_iommu_tlb_batch_end(domain) do { } while (0)
+#endif
 #endif /* __ASM_PLAT_SYSMMU_H */
@@ -32,6 +32,9 @@
 #define CTRL_BLOCK	0x7
 #define CTRL_DISABLE	0x0
 
+/* above this many 4KiB entries, flushing the whole TLB is cheaper */
+#define SYSMMU_FLUSH_ENTRY_MAX	64
+
 static unsigned short fault_reg_offset[SYSMMU_FAULTS_NUM] = {
 	S5P_PAGE_FAULT_ADDR,
 	S5P_AR_FAULT_ADDR,
@@ -480,14 +483,49 @@ void s5p_sysmmu_tlb_invalidate_entry(struct device *owner, unsigned long iova,
 		read_lock_irqsave(&mmudata->lock, flags);
 
 		if (is_sysmmu_active(mmudata)) {
-			while (count > 0) {
-				sysmmu_block(mmudata->sfrbase);
+			unsigned long addr = iova;
+			unsigned int n = count;
+
+			sysmmu_block(mmudata->sfrbase);
+			while (n > 0) {
 				__sysmmu_tlb_invalidate_entry(mmudata->sfrbase,
-								iova);
-				sysmmu_unblock(mmudata->sfrbase);
-				count--;
-				iova += page_size;
+								addr);
+				n--;
+				addr += page_size;
 			}
+			sysmmu_unblock(mmudata->sfrbase);
+		} else {
+			dev_dbg(mmudata->dev,
+				"Disabled: Skipping invalidating TLB.\n");
+		}
+
+		read_unlock_irqrestore(&mmudata->lock, flags);
+	}
+}
+
+void s5p_sysmmu_tlb_invalidate_range(struct device *owner, unsigned long iova,
+					size_t size)
+{
+	struct sysmmu_drvdata *mmudata = NULL;
+	unsigned long start = iova & PAGE_MASK;
+	unsigned long end = PAGE_ALIGN(iova + size);
+
+	while ((mmudata = get_sysmmu_data(owner, mmudata))) {
+		unsigned long flags;
+		unsigned long addr;
+
+		read_lock_irqsave(&mmudata->lock, flags);
+
+		if (is_sysmmu_active(mmudata)) {
+			sysmmu_block(mmudata->sfrbase);
+			if ((end - start) >> PAGE_SHIFT > SYSMMU_FLUSH_ENTRY_MAX)
+				__sysmmu_tlb_invalidate(mmudata->sfrbase);
+			else
+				for (addr = start; addr != end;
+							addr += PAGE_SIZE)
+					__sysmmu_tlb_invalidate_entry(
+						mmudata->sfrbase, addr);
+			sysmmu_unblock(mmudata->sfrbase);
 		} else {
 			dev_dbg(mmudata->dev,
 				"Disabled: Skipping invalidating TLB.\n");
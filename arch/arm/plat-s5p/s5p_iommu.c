@@ -77,6 +77,9 @@ struct s5p_iommu_domain {
 	struct device *dev;
 	unsigned long *pgtable;
 	struct mutex lock;
+	int tlb_batch;		/* nesting of s5p_iommu_tlb_batch_begin() */
+	unsigned long batch_start;
+	unsigned long batch_end;
 };
 
 /* slab cache for level 2 page tables */
@@ -220,6 +223,69 @@ static void s5p_iommu_detach_device(struct iommu_domain *domain,
 }
 #endif
 
+/*
+ * Invalidate the TLB for a range that was just unmapped, or remember it
+ * if unmaps are being batched.  Called with the domain lock held.
+ */
+static void s5p_iommu_tlb_flush(struct s5p_iommu_domain *s5p_domain,
+				unsigned long iova, size_t size)
+{
+#ifdef CONFIG_DRM_EXYNOS_IOMMU
+	struct sysmmu_drvdata *data;
+#endif
+
+	if (s5p_domain->tlb_batch) {
+		if (s5p_domain->batch_end == s5p_domain->batch_start) {
+			s5p_domain->batch_start = iova;
+			s5p_domain->batch_end = iova + size;
+		} else {
+			s5p_domain->batch_start = min(s5p_domain->batch_start,
+						      iova);
+			s5p_domain->batch_end = max(s5p_domain->batch_end,
+						    iova + size);
+		}
+		return;
+	}
+
+#ifdef CONFIG_DRM_EXYNOS_IOMMU
+	/*
+	 * The domain is shared by every device of the DRM, the owners of
+	 * the System MMUs were set at machine code.
+	 */
+	list_for_each_entry(data, get_sysmmu_list(), node)
+		s5p_sysmmu_tlb_invalidate_range(data->owner, iova, size);
+#else
+	if (s5p_domain->dev)
+		s5p_sysmmu_tlb_invalidate_range(s5p_domain->dev, iova, size);
+#endif
+}
+
+void s5p_iommu_tlb_batch_begin(struct iommu_domain *domain)
+{
+	struct s5p_iommu_domain *s5p_domain = domain->priv;
+
+	mutex_lock(&s5p_domain->lock);
+	s5p_domain->tlb_batch++;
+	mutex_unlock(&s5p_domain->lock);
+}
+
+void s5p_iommu_tlb_batch_end(struct iommu_domain *domain)
+{
+	struct s5p_iommu_domain *s5p_domain = domain->priv;
+
+	mutex_lock(&s5p_domain->lock);
+	if (!WARN_ON(s5p_domain->tlb_batch == 0) &&
+			--s5p_domain->tlb_batch == 0 &&
+			s5p_domain->batch_end != s5p_domain->batch_start) {
+		unsigned long start = s5p_domain->batch_start;
+		unsigned long end = s5p_domain->batch_end;
+
+		s5p_domain->batch_start = s5p_domain->batch_end = 0;
+		s5p_iommu_tlb_flush(s5p_domain, start, end - start);
+	}
+	mutex_unlock(&s5p_domain->lock);
+}
+
 static bool section_available(struct iommu_domain *domain,
 			      unsigned long *lv1entry)
 {
@@ -405,8 +471,6 @@ static int s5p_iommu_unmap(struct iommu_domain *domain, unsigned long iova,
 			   int gfp_order)
 {
 	struct s5p_iommu_domain *s5p_domain = domain->priv;
-	struct sysmmu_drvdata *data;
-	struct list_head *sysmmu_list, *pos;
 	unsigned long *entry;
 	int num_entry;
 
@@ -447,38 +511,7 @@ static int s5p_iommu_unmap(struct iommu_domain *domain, unsigned long iova,
 		}
 	}
 
-	sysmmu_list = get_sysmmu_list();
-
-	/*
-	 * invalidate tlb entries to iova(device address) to each iommu
-	 * registered in sysmmu_list.
-	 *
-	 * P.S. a device using iommu was set to data->owner at machine code
-	 * and enabled iommu was added in sysmmu_list at sysmmu probe
-	 */
-	list_for_each(pos, sysmmu_list) {
-		unsigned int page_size, count;
-
-		/*
-		 * get entry count and page size to device address space
-		 * mapped with iommu page table and invalidate each entry.
-		 */
-		if (gfp_order >= S5P_SECTION_ORDER) {
-			count = 1 << (gfp_order - S5P_SECTION_ORDER);
-			page_size = S5P_SECTION_SIZE;
-		} else if (gfp_order >= S5P_LPAGE_ORDER) {
-			count = 1 << (gfp_order - S5P_LPAGE_ORDER);
-			page_size = S5P_LPAGE_SIZE;
-		} else {
-			count = 1 << (gfp_order - S5P_SPAGE_ORDER);
-			page_size = S5P_SPAGE_SIZE;
-		}
-
-		data = list_entry(pos, struct sysmmu_drvdata, node);
-		if (data)
-			s5p_sysmmu_tlb_invalidate_entry(data->owner, iova,
-							count, page_size);
-	}
+	s5p_iommu_tlb_flush(s5p_domain, iova, S5P_SPAGE_SIZE << gfp_order);
 
 	mutex_unlock(&s5p_domain->lock);
 
@@ -530,10 +563,9 @@ static int s5p_iommu_unmap(struct iommu_domain *domain, unsigned long iova,
 		}
 	}
 
-	mutex_unlock(&s5p_domain->lock);
+	s5p_iommu_tlb_flush(s5p_domain, iova, S5P_SPAGE_SIZE << gfp_order);
 
-	if (s5p_domain->dev)
-		s5p_sysmmu_tlb_invalidate(s5p_domain->dev);
+	mutex_unlock(&s5p_domain->lock);
 
 	return 0;
 }
@@ -12,26 +12,52 @@
 #include <linux/scatterlist.h>
 #include <linux/device.h>
 #include <linux/list.h>
+#include <linux/rbtree.h>
 #include <linux/ion.h>
 #include <linux/iommu.h>
 #include <linux/genalloc.h>
 #include <linux/err.h>
 #include <linux/spinlock.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <plat/s5p-iovmm.h>
+#include <plat/s5p-sysmmu.h>
+
+/* recently freed IO address ranges kept out of the pool for reuse */
+#define IOVMM_IOVA_CACHE_SIZE	8
 
 struct s5p_vm_region {
-	struct list_head node;
+	struct rb_node node;		/* element of s5p_iovmm.regions */
 	dma_addr_t start;
 	size_t size;
 };
 
+struct s5p_iova_range {
+	dma_addr_t start;
+	size_t size;
+};
+
+struct s5p_iovmm_stats {
+	unsigned long nr_map;
+	unsigned long nr_unmap;
+	unsigned long nr_iova_hit;
+	u64 map_ns;
+	u64 unmap_ns;
+	u64 map_max_ns;
+	u64 unmap_max_ns;
+};
+
 struct s5p_iovmm {
 	struct list_head node;		/* element of s5p_iovmm_list */
 	struct iommu_domain *domain;
 	struct device *dev;
 	struct gen_pool *vmm_pool;
-	struct list_head regions_list;	/* list of s5p_vm_region */
+	struct rb_root regions;		/* s5p_vm_region by start */
+	struct s5p_iova_range iova_cache[IOVMM_IOVA_CACHE_SIZE];
+	int nr_iova_cache;		/* oldest first */
+	struct s5p_iovmm_stats stats;
 	bool   active;
 	struct mutex lock;
 };
@@ -56,147 +82,168 @@ static struct s5p_iovmm *find_iovmm(struct device *dev)
 
 static struct s5p_vm_region *find_region(struct s5p_iovmm *vmm, dma_addr_t iova)
 {
-	struct list_head *pos;
-	struct s5p_vm_region *region;
+	struct rb_node *n = vmm->regions.rb_node;
+
+	while (n) {
+		struct s5p_vm_region *region;
 
-	list_for_each(pos, &vmm->regions_list) {
-		region = list_entry(pos, struct s5p_vm_region, node);
-		if (region->start == iova)
+		region = rb_entry(n, struct s5p_vm_region, node);
+		if (iova < region->start)
+			n = n->rb_left;
+		else if (iova > region->start)
+			n = n->rb_right;
+		else
 			return region;
 	}
 	return NULL;
 }
 
-#ifdef CONFIG_DRM_EXYNOS_IOMMU
-void *iovmm_setup(unsigned long s_iova, unsigned long size)
+static void insert_region(struct s5p_iovmm *vmm, struct s5p_vm_region *region)
 {
-	struct s5p_iovmm *vmm;
-	int ret;
-
-	vmm = kzalloc(sizeof(*vmm), GFP_KERNEL);
-	if (!vmm) {
-		ret = -ENOMEM;
-		goto err_setup_alloc;
-	}
-
-	vmm->vmm_pool = gen_pool_create(PAGE_SHIFT, -1);
-	if (!vmm->vmm_pool) {
-		ret = -ENOMEM;
-		goto err_setup_genalloc;
+	struct rb_node **p = &vmm->regions.rb_node;
+	struct rb_node *parent = NULL;
+
+	while (*p) {
+		struct s5p_vm_region *tmp;
+
+		parent = *p;
+		tmp = rb_entry(parent, struct s5p_vm_region, node);
+		if (region->start < tmp->start)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
 	}
 
-	/* device address space starts from s_iova to s_iova + size */
-	ret = gen_pool_add(vmm->vmm_pool, s_iova, size, -1);
-	if (ret)
-		goto err_setup_domain;
+	rb_link_node(&region->node, parent, p);
+	rb_insert_color(&region->node, &vmm->regions);
+}
 
-	vmm->domain = iommu_domain_alloc();
-	if (!vmm->domain) {
-		ret = -ENOMEM;
-		goto err_setup_domain;
+/*
+ * Video and camera drivers map and unmap buffers of the same few sizes
+ * every frame, so a range of the right size and alignment that was just
+ * freed is handed out again without searching the pool's bitmap.
+ */
+static dma_addr_t iovmm_alloc_iova(struct s5p_iovmm *vmm, size_t size,
+								int order)
+{
+	dma_addr_t start;
+	int i;
+
+	for (i = vmm->nr_iova_cache - 1; i >= 0; i--) {
+		struct s5p_iova_range *range = &vmm->iova_cache[i];
+
+		if (range->size == size && IS_ALIGNED(range->start, 1 << order)) {
+			start = range->start;
+			vmm->nr_iova_cache--;
+			memmove(range, range + 1, (vmm->nr_iova_cache - i) *
+							sizeof(*range));
+			vmm->stats.nr_iova_hit++;
+			return start;
+		}
 	}
 
-	mutex_init(&vmm->lock);
-
-	INIT_LIST_HEAD(&vmm->node);
-	INIT_LIST_HEAD(&vmm->regions_list);
-
-	write_lock(&iovmm_list_lock);
-	list_add(&vmm->node, &s5p_iovmm_list);
-	write_unlock(&iovmm_list_lock);
+	start = (dma_addr_t)gen_pool_alloc_aligned(vmm->vmm_pool, size, order);
+	if (!start && vmm->nr_iova_cache) {
+		/* the cached ranges may be what is missing */
+		for (i = 0; i < vmm->nr_iova_cache; i++)
+			gen_pool_free(vmm->vmm_pool, vmm->iova_cache[i].start,
+						vmm->iova_cache[i].size);
+		vmm->nr_iova_cache = 0;
+
+		start = (dma_addr_t)gen_pool_alloc_aligned(vmm->vmm_pool,
+								size, order);
+	}
 
-	return vmm;
-err_setup_domain:
-	gen_pool_destroy(vmm->vmm_pool);
-err_setup_genalloc:
-	kfree(vmm);
-err_setup_alloc:
-	return ERR_PTR(ret);
+	return start;
 }
 
-void iovmm_cleanup(void *in_vmm)
+static void iovmm_free_iova(struct s5p_iovmm *vmm, dma_addr_t start,
+								size_t size)
 {
-	struct s5p_iovmm *vmm = in_vmm;
-
-	WARN_ON(!vmm);
-
-	if (vmm) {
-		struct list_head *pos, *tmp;
-
-		iommu_domain_free(vmm->domain);
-
-		list_for_each_safe(pos, tmp, &vmm->regions_list) {
-			struct s5p_vm_region *region;
+	if (vmm->nr_iova_cache == IOVMM_IOVA_CACHE_SIZE) {
+		gen_pool_free(vmm->vmm_pool, vmm->iova_cache[0].start,
+						vmm->iova_cache[0].size);
+		vmm->nr_iova_cache--;
+		memmove(&vmm->iova_cache[0], &vmm->iova_cache[1],
+			vmm->nr_iova_cache * sizeof(vmm->iova_cache[0]));
+	}
 
-			region = list_entry(pos, struct s5p_vm_region, node);
+	vmm->iova_cache[vmm->nr_iova_cache].start = start;
+	vmm->iova_cache[vmm->nr_iova_cache].size = size;
+	vmm->nr_iova_cache++;
+}
 
-			/* No need to unmap the region because
-			 * iommu_domain_free() frees the page table */
-			gen_pool_free(vmm->vmm_pool, region->start,
-								region->size);
+/*
+ * Unmap in the largest pieces the alignment allows, with a single TLB
+ * invalidation for the whole range at the end.
+ */
+static void iovmm_unmap_range(struct s5p_iovmm *vmm, dma_addr_t start,
+								size_t size)
+{
+	s5p_iommu_tlb_batch_begin(vmm->domain);
 
-			kfree(list_entry(pos, struct s5p_vm_region, node));
-		}
+	while (size != 0) {
+		int order;
 
-		gen_pool_destroy(vmm->vmm_pool);
+		order = min(__fls(size), __ffs(start));
 
-		write_lock(&iovmm_list_lock);
-		list_del(&vmm->node);
-		write_unlock(&iovmm_list_lock);
+		iommu_unmap(vmm->domain, start, order - PAGE_SHIFT);
 
-		kfree(vmm);
+		start += 1 << order;
+		size -= 1 << order;
 	}
+
+	s5p_iommu_tlb_batch_end(vmm->domain);
 }
 
-int iovmm_activate(void *in_vmm, struct device *dev)
+static void iovmm_account(u64 *total, u64 *max, ktime_t begin)
 {
-	struct s5p_iovmm *vmm = in_vmm;
-	int ret = 0;
-
-	if (WARN_ON(!vmm))
-		return -EINVAL;
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), begin));
 
-	mutex_lock(&vmm->lock);
-
-	ret = iommu_attach_device(vmm->domain, dev);
-	if (!ret)
-		vmm->active = true;
-
-	mutex_unlock(&vmm->lock);
-
-	return ret;
+	*total += ns;
+	if (ns > *max)
+		*max = ns;
 }
 
-void iovmm_deactivate(void *in_vmm, struct device *dev)
+static void iovmm_free_regions(struct s5p_iovmm *vmm)
 {
-	struct s5p_iovmm *vmm = in_vmm;
+	struct rb_node *n;
+	int i;
 
-	if (WARN_ON(!vmm))
-		return;
+	while ((n = rb_first(&vmm->regions))) {
+		struct s5p_vm_region *region;
 
-	iommu_detach_device(vmm->domain, dev);
+		region = rb_entry(n, struct s5p_vm_region, node);
+		rb_erase(n, &vmm->regions);
 
-	vmm->active = false;
+		/* No need to unmap the region because
+		 * iommu_domain_free() frees the page table */
+		gen_pool_free(vmm->vmm_pool,
+				round_down(region->start, PAGE_SIZE),
+				region->size);
+
+		kfree(region);
+	}
+
+	for (i = 0; i < vmm->nr_iova_cache; i++)
+		gen_pool_free(vmm->vmm_pool, vmm->iova_cache[i].start,
+						vmm->iova_cache[i].size);
+	vmm->nr_iova_cache = 0;
 }
 
-dma_addr_t iovmm_map(void *in_vmm, struct scatterlist *sg, off_t offset,
-								size_t size)
+static dma_addr_t __iovmm_map(struct s5p_iovmm *vmm, struct scatterlist *sg,
+						off_t offset, size_t size)
 {
 	off_t start_off;
 	dma_addr_t addr, start = 0;
 	size_t mapped_size = 0;
 	struct s5p_vm_region *region;
-	struct s5p_iovmm *vmm = in_vmm;
+	ktime_t begin = ktime_get();
 	int order;
 #ifdef CONFIG_S5P_SYSTEM_MMU_WA5250ERR
 	size_t iova_size = 0;
 #endif
 
-	BUG_ON(!sg);
-
-	if (WARN_ON(!vmm))
-		goto err_map_nomem;
-
 	for (; sg_dma_len(sg) < offset; sg = sg_next(sg))
 		offset -= sg_dma_len(sg);
 
@@ -208,10 +255,9 @@ dma_addr_t iovmm_map(void *in_vmm, struct scatterlist *sg, off_t offset,
 	order = __fls(min(size, (size_t)SZ_1M));
 #ifdef CONFIG_S5P_SYSTEM_MMU_WA5250ERR
 	iova_size = ALIGN(size, SZ_64K);
-	start = (dma_addr_t)gen_pool_alloc_aligned(vmm->vmm_pool, iova_size,
-									order);
+	start = iovmm_alloc_iova(vmm, iova_size, order);
 #else
-	start = (dma_addr_t)gen_pool_alloc_aligned(vmm->vmm_pool, size, order);
+	start = iovmm_alloc_iova(vmm, size, order);
 #endif
 	if (!start)
 		goto err_map_nomem_lock;
@@ -280,45 +326,31 @@ dma_addr_t iovmm_map(void *in_vmm, struct scatterlist *sg, off_t offset,
 
 	region->start = start + start_off;
 	region->size = size;
-	INIT_LIST_HEAD(&region->node);
 
-	list_add(&region->node, &vmm->regions_list);
+	insert_region(vmm, region);
+
+	vmm->stats.nr_map++;
+	iovmm_account(&vmm->stats.map_ns, &vmm->stats.map_max_ns, begin);
 
 	mutex_unlock(&vmm->lock);
 
 	return region->start;
 err_map_map:
-	while (addr >= start) {
-		int order;
-		mapped_size = addr - start;
-
-		if (mapped_size == 0) /* Mapping failed at the first page */
-			mapped_size = size;
-
-		BUG_ON(mapped_size < PAGE_SIZE);
-
-		order = min(__fls(mapped_size), __ffs(start));
-
-		iommu_unmap(vmm->domain, start, order - PAGE_SHIFT);
-
-		start += 1 << order;
-		mapped_size -= 1 << order;
-	}
-	gen_pool_free(vmm->vmm_pool, start, size);
+	iovmm_unmap_range(vmm, start, addr - start);
+#ifdef CONFIG_S5P_SYSTEM_MMU_WA5250ERR
+	size = iova_size;
+#endif
+	iovmm_free_iova(vmm, start, size);
 
 err_map_nomem_lock:
 	mutex_unlock(&vmm->lock);
-err_map_nomem:
 	return (dma_addr_t)0;
 }
 
-void iovmm_unmap(void *in_vmm, dma_addr_t iova)
+static void __iovmm_unmap(struct s5p_iovmm *vmm, dma_addr_t iova)
 {
 	struct s5p_vm_region *region;
-	struct s5p_iovmm *vmm = in_vmm;
-
-	if (WARN_ON(!vmm))
-		return;
+	ktime_t begin = ktime_get();
 
 	mutex_lock(&vmm->lock);
 
@@ -326,29 +358,25 @@ void iovmm_unmap(void *in_vmm, dma_addr_t iova)
 	if (WARN_ON(!region))
 		goto err_region_not_found;
 
-	region->start = round_down(region->start, PAGE_SIZE);
-
-	gen_pool_free(vmm->vmm_pool, region->start, region->size);
-	list_del(&region->node);
-
-	while (region->size != 0) {
-		int order;
-
-		order = min(__fls(region->size), __ffs(region->start));
+	rb_erase(&region->node, &vmm->regions);
 
-		iommu_unmap(vmm->domain, region->start, order - PAGE_SHIFT);
+	region->start = round_down(region->start, PAGE_SIZE);
 
-		region->start += 1 << order;
-		region->size -= 1 << order;
-	}
+	/* the range goes back only after the TLB forgot about it */
+	iovmm_unmap_range(vmm, region->start, region->size);
+	iovmm_free_iova(vmm, region->start, region->size);
 
 	kfree(region);
 
+	vmm->stats.nr_unmap++;
+	iovmm_account(&vmm->stats.unmap_ns, &vmm->stats.unmap_max_ns, begin);
+
 err_region_not_found:
 	mutex_unlock(&vmm->lock);
 }
-#else
-int iovmm_setup(struct device *dev)
+
+#ifdef CONFIG_DRM_EXYNOS_IOMMU
+void *iovmm_setup(unsigned long s_iova, unsigned long size)
 {
 	struct s5p_iovmm *vmm;
 	int ret;
@@ -365,8 +393,8 @@ int iovmm_setup(struct device *dev)
 		goto err_setup_genalloc;
 	}
 
-	/* 1GB addr space from 0x80000000 */
-	ret = gen_pool_add(vmm->vmm_pool, 0x80000000, 0x40000000, -1);
+	/* device address space starts from s_iova to s_iova + size */
+	ret = gen_pool_add(vmm->vmm_pool, s_iova, size, -1);
 	if (ret)
 		goto err_setup_domain;
 
@@ -376,53 +404,34 @@ int iovmm_setup(struct device *dev)
 		goto err_setup_domain;
 	}
 
-	vmm->dev = dev;
-
 	mutex_init(&vmm->lock);
 
 	INIT_LIST_HEAD(&vmm->node);
-	INIT_LIST_HEAD(&vmm->regions_list);
+	vmm->regions = RB_ROOT;
 
 	write_lock(&iovmm_list_lock);
 	list_add(&vmm->node, &s5p_iovmm_list);
 	write_unlock(&iovmm_list_lock);
 
-	return 0;
+	return vmm;
 err_setup_domain:
 	gen_pool_destroy(vmm->vmm_pool);
 err_setup_genalloc:
 	kfree(vmm);
 err_setup_alloc:
-	return ret;
+	return ERR_PTR(ret);
 }
 
-void iovmm_cleanup(struct device *dev)
+void iovmm_cleanup(void *in_vmm)
 {
-	struct s5p_iovmm *vmm;
-
-	vmm = find_iovmm(dev);
+	struct s5p_iovmm *vmm = in_vmm;
 
 	WARN_ON(!vmm);
-	if (vmm) {
-		struct list_head *pos, *tmp;
-
-		if (vmm->active)
-			iommu_detach_device(vmm->domain, dev);
 
+	if (vmm) {
 		iommu_domain_free(vmm->domain);
 
-		list_for_each_safe(pos, tmp, &vmm->regions_list) {
-			struct s5p_vm_region *region;
-
-			region = list_entry(pos, struct s5p_vm_region, node);
-
-			/* No need to unmap the region because
-			 * iommu_domain_free() frees the page table */
-			gen_pool_free(vmm->vmm_pool, region->start,
-								region->size);
-
-			kfree(list_entry(pos, struct s5p_vm_region, node));
-		}
+		iovmm_free_regions(vmm);
 
 		gen_pool_destroy(vmm->vmm_pool);
 
@@ -434,18 +443,17 @@ void iovmm_cleanup(struct device *dev)
 	}
 }
 
-int iovmm_activate(struct device *dev)
+int iovmm_activate(void *in_vmm, struct device *dev)
 {
-	struct s5p_iovmm *vmm;
+	struct s5p_iovmm *vmm = in_vmm;
 	int ret = 0;
 
-	vmm = find_iovmm(dev);
 	if (WARN_ON(!vmm))
 		return -EINVAL;
 
 	mutex_lock(&vmm->lock);
 
-	ret = iommu_attach_device(vmm->domain, vmm->dev);
+	ret = iommu_attach_device(vmm->domain, dev);
 	if (!ret)
 		vmm->active = true;
 
@@ -454,194 +462,226 @@ int iovmm_activate(struct device *dev)
 	return ret;
 }
 
-void iovmm_deactivate(struct device *dev)
+void iovmm_deactivate(void *in_vmm, struct device *dev)
 {
-	struct s5p_iovmm *vmm;
+	struct s5p_iovmm *vmm = in_vmm;
 
-	vmm = find_iovmm(dev);
 	if (WARN_ON(!vmm))
 		return;
 
-	iommu_detach_device(vmm->domain, vmm->dev);
+	iommu_detach_device(vmm->domain, dev);
 
 	vmm->active = false;
 }
 
-dma_addr_t iovmm_map(struct device *dev, struct scatterlist *sg, off_t offset,
+dma_addr_t iovmm_map(void *in_vmm, struct scatterlist *sg, off_t offset,
 								size_t size)
 {
-	off_t start_off;
-	dma_addr_t addr, start = 0;
-	size_t mapped_size = 0;
-	struct s5p_vm_region *region;
-	struct s5p_iovmm *vmm;
-	int order;
-#ifdef CONFIG_S5P_SYSTEM_MMU_WA5250ERR
-	size_t iova_size = 0;
-#endif
+	struct s5p_iovmm *vmm = in_vmm;
 
 	BUG_ON(!sg);
 
-	vmm = find_iovmm(dev);
 	if (WARN_ON(!vmm))
-		goto err_map_nomem;
+		return (dma_addr_t)0;
 
-	for (; sg_dma_len(sg) < offset; sg = sg_next(sg))
-		offset -= sg_dma_len(sg);
+	return __iovmm_map(vmm, sg, offset, size);
+}
 
-	mutex_lock(&vmm->lock);
+void iovmm_unmap(void *in_vmm, dma_addr_t iova)
+{
+	struct s5p_iovmm *vmm = in_vmm;
 
-	start_off = offset_in_page(sg_phys(sg) + offset);
-	size = PAGE_ALIGN(size + start_off);
+	if (WARN_ON(!vmm))
+		return;
 
-	order = __fls(min(size, (size_t)SZ_1M));
-#ifdef CONFIG_S5P_SYSTEM_MMU_WA5250ERR
-	iova_size = ALIGN(size, SZ_64K);
-	start = (dma_addr_t)gen_pool_alloc_aligned(vmm->vmm_pool, iova_size,
-									order);
+	__iovmm_unmap(vmm, iova);
+}
 #else
-	start = (dma_addr_t)gen_pool_alloc_aligned(vmm->vmm_pool, size, order);
-#endif
-	if (!start)
-		goto err_map_nomem_lock;
-
-	addr = start;
-	do {
-		phys_addr_t phys;
-		size_t len;
+int iovmm_setup(struct device *dev)
+{
+	struct s5p_iovmm *vmm;
+	int ret;
 
-		phys = sg_phys(sg);
-		len = sg_dma_len(sg);
+	vmm = kzalloc(sizeof(*vmm), GFP_KERNEL);
+	if (!vmm) {
+		ret = -ENOMEM;
+		goto err_setup_alloc;
+	}
 
-		if (offset > 0) {
-			len -= offset;
-			phys += offset;
-			offset = 0;
-		}
+	vmm->vmm_pool = gen_pool_create(PAGE_SHIFT, -1);
+	if (!vmm->vmm_pool) {
+		ret = -ENOMEM;
+		goto err_setup_genalloc;
+	}
 
-		if (offset_in_page(phys)) {
-			len += offset_in_page(phys);
-			phys = round_down(phys, PAGE_SIZE);
-		}
+	/* 1GB addr space from 0x80000000 */
+	ret = gen_pool_add(vmm->vmm_pool, 0x80000000, 0x40000000, -1);
+	if (ret)
+		goto err_setup_domain;
 
-		len = PAGE_ALIGN(len);
+	vmm->domain = iommu_domain_alloc();
+	if (!vmm->domain) {
+		ret = -ENOMEM;
+		goto err_setup_domain;
+	}
 
-		if (len > (size - mapped_size))
-			len = size - mapped_size;
+	vmm->dev = dev;
 
-		while (len > 0) {
-			order = min3(__ffs(phys), __ffs(addr), __fls(len));
+	mutex_init(&vmm->lock);
 
-			if (iommu_map(vmm->domain, addr, phys,
-							order - PAGE_SHIFT, 0))
-				goto err_map_map;
+	INIT_LIST_HEAD(&vmm->node);
+	vmm->regions = RB_ROOT;
 
-			addr += (1 << order);
-			phys += (1 << order);
-			len -= (1 << order);
-			mapped_size += (1 << order);
-		}
-	} while ((sg = sg_next(sg)) && (mapped_size < size));
+	write_lock(&iovmm_list_lock);
+	list_add(&vmm->node, &s5p_iovmm_list);
+	write_unlock(&iovmm_list_lock);
 
-	BUG_ON(mapped_size > size);
+	return 0;
+err_setup_domain:
+	gen_pool_destroy(vmm->vmm_pool);
+err_setup_genalloc:
+	kfree(vmm);
+err_setup_alloc:
+	return ret;
+}
 
-	if (mapped_size < size)
-		goto err_map_map;
+void iovmm_cleanup(struct device *dev)
+{
+	struct s5p_iovmm *vmm;
 
-#ifdef CONFIG_S5P_SYSTEM_MMU_WA5250ERR
-	if (iova_size != size) {
-		/* System MMU v3 support in SMDK5250 EVT0 */
-		addr = start + size;
-		size = iova_size;
+	vmm = find_iovmm(dev);
 
-		for (; addr < start + size; addr += PAGE_SIZE) {
-			if (iommu_map(vmm->domain, addr,
-					page_to_phys(ZERO_PAGE(0)), 0, 0)) {
-				goto err_map_map;
-			}
-			mapped_size += PAGE_SIZE;
-		}
-	}
-#endif
-	region = kmalloc(sizeof(*region), GFP_KERNEL);
-	if (!region)
-		goto err_map_map;
+	WARN_ON(!vmm);
+	if (vmm) {
+		if (vmm->active)
+			iommu_detach_device(vmm->domain, dev);
 
-	region->start = start + start_off;
-	region->size = size;
-	INIT_LIST_HEAD(&region->node);
+		iommu_domain_free(vmm->domain);
 
-	list_add(&region->node, &vmm->regions_list);
+		iovmm_free_regions(vmm);
 
-	mutex_unlock(&vmm->lock);
+		gen_pool_destroy(vmm->vmm_pool);
 
-	return region->start;
-err_map_map:
-	while (addr >= start) {
-		int order;
-		mapped_size = addr - start;
+		write_lock(&iovmm_list_lock);
+		list_del(&vmm->node);
+		write_unlock(&iovmm_list_lock);
 
-		if (mapped_size == 0) /* Mapping failed at the first page */
-			mapped_size = size;
+		kfree(vmm);
+	}
+}
 
-		BUG_ON(mapped_size < PAGE_SIZE);
+int iovmm_activate(struct device *dev)
+{
+	struct s5p_iovmm *vmm;
+	int ret = 0;
 
-		order = min(__fls(mapped_size), __ffs(start));
+	vmm = find_iovmm(dev);
+	if (WARN_ON(!vmm))
+		return -EINVAL;
 
-		iommu_unmap(vmm->domain, start, order - PAGE_SHIFT);
+	mutex_lock(&vmm->lock);
 
-		start += 1 << order;
-		mapped_size -= 1 << order;
-	}
-	gen_pool_free(vmm->vmm_pool, start, size);
+	ret = iommu_attach_device(vmm->domain, vmm->dev);
+	if (!ret)
+		vmm->active = true;
 
-err_map_nomem_lock:
 	mutex_unlock(&vmm->lock);
-err_map_nomem:
-	return (dma_addr_t)0;
+
+	return ret;
 }
 
-void iovmm_unmap(struct device *dev, dma_addr_t iova)
+void iovmm_deactivate(struct device *dev)
 {
-	struct s5p_vm_region *region;
 	struct s5p_iovmm *vmm;
 
 	vmm = find_iovmm(dev);
-
 	if (WARN_ON(!vmm))
 		return;
 
-	mutex_lock(&vmm->lock);
+	iommu_detach_device(vmm->domain, vmm->dev);
 
-	region = find_region(vmm, iova);
-	if (WARN_ON(!region))
-		goto err_region_not_found;
+	vmm->active = false;
+}
 
-	region->start = round_down(region->start, PAGE_SIZE);
+dma_addr_t iovmm_map(struct device *dev, struct scatterlist *sg, off_t offset,
+								size_t size)
+{
+	struct s5p_iovmm *vmm;
+
+	BUG_ON(!sg);
+
+	vmm = find_iovmm(dev);
+	if (WARN_ON(!vmm))
+		return (dma_addr_t)0;
 
-	gen_pool_free(vmm->vmm_pool, region->start, region->size);
-	list_del(&region->node);
+	return __iovmm_map(vmm, sg, offset, size);
+}
 
-	while (region->size != 0) {
-		int order;
+void iovmm_unmap(struct device *dev, dma_addr_t iova)
+{
+	struct s5p_iovmm *vmm;
+
+	vmm = find_iovmm(dev);
+
+	if (WARN_ON(!vmm))
+		return;
+
+	__iovmm_unmap(vmm, iova);
+}
+#endif
 
-		order = min(__fls(region->size), __ffs(region->start));
+#ifdef CONFIG_DEBUG_FS
+static int s5p_iovmm_debug_show(struct seq_file *s, void *unused)
+{
+	struct s5p_iovmm *vmm;
 
-		iommu_unmap(vmm->domain, region->start, order - PAGE_SHIFT);
+	seq_printf(s, "%-16s %8s %8s %8s %10s %10s %10s %10s\n", "owner",
+			"map", "unmap", "iova_hit", "map_avg", "map_max",
+			"unmap_avg", "unmap_max");
 
-		region->start += 1 << order;
-		region->size -= 1 << order;
+	read_lock(&iovmm_list_lock);
+	list_for_each_entry(vmm, &s5p_iovmm_list, node) {
+		/* no sleeping under the list lock, a torn sample is fine here */
+		struct s5p_iovmm_stats st = vmm->stats;
+		u64 map_avg, unmap_avg;
+
+		map_avg = st.map_ns;
+		if (st.nr_map)
+			do_div(map_avg, st.nr_map);
+		unmap_avg = st.unmap_ns;
+		if (st.nr_unmap)
+			do_div(unmap_avg, st.nr_unmap);
+
+		/* nanoseconds */
+		seq_printf(s, "%-16s %8lu %8lu %8lu %10llu %10llu %10llu %10llu\n",
+			vmm->dev ? dev_name(vmm->dev) : "drm",
+			st.nr_map, st.nr_unmap, st.nr_iova_hit,
+			map_avg, st.map_max_ns, unmap_avg, st.unmap_max_ns);
 	}
+	read_unlock(&iovmm_list_lock);
 
-	kfree(region);
+	return 0;
+}
 
-err_region_not_found:
-	mutex_unlock(&vmm->lock);
+static int s5p_iovmm_debug_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, s5p_iovmm_debug_show, inode->i_private);
 }
+
+static const struct file_operations s5p_iovmm_debug_fops = {
+	.open		= s5p_iovmm_debug_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
 #endif
 
 static int __init s5p_iovmm_init(void)
 {
+#ifdef CONFIG_DEBUG_FS
+	debugfs_create_file("s5p_iovmm", S_IRUGO, NULL, NULL,
+						&s5p_iovmm_debug_fops);
+#endif
 	return 0;
 }
 arch_initcall(s5p_iovmm_init);
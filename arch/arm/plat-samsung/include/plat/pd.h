@@ -45,6 +45,14 @@ struct exynos_pd_data {
 	unsigned long read_phy_addr;
 };
 
+/*
+ * Domains handled by exynos_pd_init/enable/disable, and which of them are
+ * currently powered, indexed by enum exynos_pd_block. Lets the idle path
+ * know what is busy without reading the PMU.
+ */
+extern unsigned long exynos_pd_managed_mask;
+extern unsigned long exynos_pd_on_mask;
+
 int exynos_pd_init(struct device *dev);
 int exynos_pd_enable(struct device *dev);
 int exynos_pd_disable(struct device *dev);
@@ -10,15 +10,20 @@
  */
 #include <linux/types.h>
 #include <linux/cpu.h>
+#include <linux/export.h>
 #include <linux/kernel.h>
 #include <linux/notifier.h>
 #include <linux/signal.h>
 #include <linux/sched.h>
 #include <linux/smp.h>
 #include <linux/init.h>
+#include <linux/percpu.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 
 #include <asm/cp15.h>
 #include <asm/cputype.h>
+#include <asm/neon.h>
 #include <asm/system_info.h>
 #include <asm/thread_notify.h>
 #include <asm/vfp.h>
@@ -53,6 +58,23 @@ unsigned int VFP_arch;
  */
 union vfp_state *vfp_current_hw_state[NR_CPUS];
 
+/*
+ * A thread that used the VFP in more than VFP_EAGER_MIN slices in a row
+ * gets its context loaded when it is switched in, instead of taking the
+ * undefined instruction trap first. vfp_counter is a u8 that wraps at
+ * 256, so such a thread eventually has one lazy slice and is then tested
+ * again.
+ */
+#define VFP_EAGER_MIN	5
+
+struct vfp_stats {
+	unsigned long lazy;	/* slices that trapped to enable the VFP */
+	unsigned long eager;	/* contexts loaded at switch */
+	struct thread_info *eager_thread;
+};
+
+static DEFINE_PER_CPU(struct vfp_stats, vfp_stats);
+
 /*
  * Is 'thread's most up to date state stored in this CPUs hardware?
  * Must be called from non-preemptible context.
@@ -105,6 +127,7 @@ static void vfp_thread_flush(struct thread_info *thread)
 	put_cpu();
 
 	memset(vfp, 0, sizeof(union vfp_state));
+	thread->vfp_counter = 0;
 
 	vfp->hard.fpexc = FPEXC_EN;
 	vfp->hard.fpscr = FPSCR_ROUND_NEAREST;
@@ -130,11 +153,75 @@ static void vfp_thread_copy(struct thread_info *thread)
 
 	vfp_sync_hwstate(parent);
 	thread->vfpstate = parent->vfpstate;
+	thread->vfp_counter = 0;
 #ifdef CONFIG_SMP
 	thread->vfpstate.hard.cpu = NR_CPUS;
 #endif
 }
 
+/*
+ * Called on a switch away from the current thread: the VFP is enabled
+ * only if it was used since the thread was switched in.
+ */
+static void vfp_account_switch(unsigned int cpu, u32 fpexc)
+{
+	struct thread_info *prev = current_thread_info();
+	struct vfp_stats *stats = &per_cpu(vfp_stats, cpu);
+
+	if ((fpexc & FPEXC_EN) &&
+	    vfp_current_hw_state[cpu] == &prev->vfpstate) {
+		prev->vfp_counter++;
+		if (stats->eager_thread != prev)
+			stats->lazy++;
+	} else {
+		prev->vfp_counter = 0;
+	}
+	stats->eager_thread = NULL;
+}
+
+/*
+ * Load the context of a thread that is about to run so it finds the VFP
+ * enabled. The hardware was disabled by the caller; fpexc is the value
+ * it had before.
+ */
+static void vfp_eager_restore(unsigned int cpu, struct thread_info *thread,
+			      u32 fpexc)
+{
+	union vfp_state *vfp = &thread->vfpstate;
+
+	/* pending exceptions are left to the undefined instruction trap */
+	if (vfp->hard.fpexc & FPEXC_EX)
+		return;
+
+	if (vfp_state_in_hw(cpu, thread)) {
+		if (fpexc & FPEXC_EX)
+			return;
+		fmxr(FPEXC, fpexc | FPEXC_EN);
+	} else {
+#ifndef CONFIG_SMP
+		/* on UP the previous owner's context has not been saved */
+		union vfp_state *owner = vfp_current_hw_state[cpu];
+
+		if (owner) {
+			if (fpexc & FPEXC_EX)
+				return;
+			fmxr(FPEXC, fpexc | FPEXC_EN);
+			vfp_save_state(owner, fpexc | FPEXC_EN);
+		}
+#endif
+		fmxr(FPEXC, (fpexc & ~FPEXC_EX) | FPEXC_EN);
+		vfp_load_state(vfp);
+		vfp_current_hw_state[cpu] = vfp;
+#ifdef CONFIG_SMP
+		vfp->hard.cpu = cpu;
+#endif
+		fmxr(FPEXC, vfp->hard.fpexc | FPEXC_EN);
+	}
+
+	per_cpu(vfp_stats, cpu).eager++;
+	per_cpu(vfp_stats, cpu).eager_thread = thread;
+}
+
 /*
  * When this function is called with the following 'cmd's, the following
  * is true while this function is being run:
@@ -162,16 +249,16 @@ static int vfp_notifier(struct notifier_block *self, unsigned long cmd, void *v)
 {
 	struct thread_info *thread = v;
 	u32 fpexc;
-#ifdef CONFIG_SMP
 	unsigned int cpu;
-#endif
 
 	switch (cmd) {
 	case THREAD_NOTIFY_SWITCH:
 		fpexc = fmrx(FPEXC);
+		cpu = thread->cpu;
+
+		vfp_account_switch(cpu, fpexc);
 
 #ifdef CONFIG_SMP
-		cpu = thread->cpu;
 
 		/*
 		 * On SMP, if VFP is enabled, save the old state in
@@ -187,6 +274,9 @@ static int vfp_notifier(struct notifier_block *self, unsigned long cmd, void *v)
 		 * old state.
 		 */
 		fmxr(FPEXC, fpexc & ~FPEXC_EN);
+
+		if (thread->vfp_counter > VFP_EAGER_MIN)
+			vfp_eager_restore(cpu, thread, fpexc);
 		break;
 
 	case THREAD_NOTIFY_FLUSH:
@@ -542,6 +632,85 @@ static int vfp_hotplug(struct notifier_block *b, unsigned long action,
 	return NOTIFY_OK;
 }
 
+#ifdef CONFIG_KERNEL_MODE_NEON
+
+/*
+ * Kernel-side NEON support functions
+ */
+void kernel_neon_begin(void)
+{
+	struct thread_info *thread = current_thread_info();
+	unsigned int cpu;
+	u32 fpexc;
+
+	/*
+	 * Kernel mode NEON is only allowed outside of interrupt context
+	 * with preemption disabled. This will make sure that the kernel
+	 * mode NEON register contents never need to be preserved.
+	 */
+	BUG_ON(in_interrupt());
+	cpu = get_cpu();
+
+	fpexc = fmrx(FPEXC) | FPEXC_EN;
+	fmxr(FPEXC, fpexc);
+
+	/*
+	 * Save the userland NEON/VFP state. Under UP,
+	 * the owner could be a task other than 'current'
+	 */
+	if (vfp_state_in_hw(cpu, thread))
+		vfp_save_state(&thread->vfpstate, fpexc);
+#ifndef CONFIG_SMP
+	else if (vfp_current_hw_state[cpu] != NULL)
+		vfp_save_state(vfp_current_hw_state[cpu], fpexc);
+#endif
+	vfp_current_hw_state[cpu] = NULL;
+}
+EXPORT_SYMBOL(kernel_neon_begin);
+
+void kernel_neon_end(void)
+{
+	/* Disable the NEON/VFP unit. */
+	fmxr(FPEXC, fmrx(FPEXC) & ~FPEXC_EN);
+	put_cpu();
+}
+EXPORT_SYMBOL(kernel_neon_end);
+
+#endif /* CONFIG_KERNEL_MODE_NEON */
+
+#ifdef CONFIG_PROC_FS
+static int vfp_stats_show(struct seq_file *m, void *v)
+{
+	unsigned int cpu;
+
+	seq_printf(m, "cpu        lazy       eager\n");
+	for_each_online_cpu(cpu)
+		seq_printf(m, "%-4u %10lu %10lu\n", cpu,
+			   per_cpu(vfp_stats, cpu).lazy,
+			   per_cpu(vfp_stats, cpu).eager);
+	return 0;
+}
+
+static int vfp_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, vfp_stats_show, NULL);
+}
+
+static const struct file_operations vfp_stats_fops = {
+	.open		= vfp_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void __init vfp_stats_init(void)
+{
+	proc_create("vfpstat", S_IRUGO, NULL, &vfp_stats_fops);
+}
+#else
+static inline void vfp_stats_init(void) { }
+#endif
+
 /*
  * VFP support code initialisation.
  */
@@ -586,6 +755,7 @@ static int __init vfp_init(void)
 
 		thread_register_notifier(&vfp_notifier_block);
 		vfp_pm_init();
+		vfp_stats_init();
 
 		/*
 		 * We detected VFP, and the support code is
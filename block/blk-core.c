@@ -600,6 +600,11 @@ blk_init_allocated_queue(struct request_queue *q, request_fn_proc *rfn,
 	if (blk_init_free_list(q))
 		return NULL;
 
+#ifdef CONFIG_BLK_LATENCY_HIST
+	/* the histogram is optional, the queue works without it */
+	q->latency_hist = alloc_percpu(struct blk_latency_hist);
+#endif
+
 	q->request_fn		= rfn;
 	q->prep_rq_fn		= NULL;
 	q->unprep_rq_fn		= NULL;
@@ -1897,6 +1902,40 @@ static void blk_account_io_done(struct request *req)
 	}
 }
 
+#ifdef CONFIG_BLK_LATENCY_HIST
+static inline int blk_latency_size(unsigned int bytes)
+{
+	if (bytes <= 4096)
+		return 0;
+	if (bytes <= 16384)
+		return 1;
+	if (bytes <= 65536)
+		return 2;
+	return 3;
+}
+
+static void blk_account_latency(struct request *req)
+{
+	struct blk_latency_hist __percpu *hist = req->q->latency_hist;
+	u64 us;
+	int bucket;
+
+	if (!hist || !blk_account_rq(req) || (req->cmd_flags & REQ_FLUSH_SEQ))
+		return;
+
+	us = div_u64(sched_clock() - req->io_start_time_ns, NSEC_PER_USEC);
+	us >>= BLK_LAT_SHIFT;
+	bucket = us ? min(fls64(us), BLK_LAT_BUCKETS - 1) : 0;
+
+	this_cpu_inc(hist->count[rq_data_dir(req)]
+			[blk_latency_size(req->io_start_bytes)][bucket]);
+}
+#else
+static inline void blk_account_latency(struct request *req)
+{
+}
+#endif
+
 /**
  * blk_peek_request - peek at the top of a request queue
  * @q: request queue to peek at
@@ -2303,7 +2342,7 @@ static void blk_finish_request(struct request *req, int error)
 	if (req->cmd_flags & REQ_DONTPREP)
 		blk_unprep_request(req);
 
-
+	blk_account_latency(req);
 	blk_account_io_done(req);
 
 	if (req->end_io)
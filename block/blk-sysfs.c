@@ -389,6 +389,71 @@ static struct queue_sysfs_entry queue_random_entry = {
 	.store = queue_store_random,
 };
 
+#ifdef CONFIG_BLK_LATENCY_HIST
+static ssize_t queue_latency_hist_show(struct request_queue *q, char *page)
+{
+	static const char * const size_name[BLK_LAT_SIZES] = {
+		"4k", "16k", "64k", "max",
+	};
+	struct blk_latency_hist *hist;
+	ssize_t len;
+	int dir, size, i, cpu;
+
+	if (!q->latency_hist)
+		return -ENODEV;
+
+	/* header: upper bound of each bucket in microseconds */
+	len = sprintf(page, "usecs");
+	for (i = 0; i < BLK_LAT_BUCKETS - 1; i++)
+		len += sprintf(page + len, " %u", 1U << (BLK_LAT_SHIFT + i));
+	len += sprintf(page + len, " inf\n");
+
+	for (dir = READ; dir <= WRITE; dir++) {
+		for (size = 0; size < BLK_LAT_SIZES; size++) {
+			len += sprintf(page + len, "%s-%s",
+				       dir == READ ? "read" : "write",
+				       size_name[size]);
+			for (i = 0; i < BLK_LAT_BUCKETS; i++) {
+				unsigned long sum = 0;
+
+				for_each_possible_cpu(cpu) {
+					hist = per_cpu_ptr(q->latency_hist, cpu);
+					sum += hist->count[dir][size][i];
+				}
+				len += sprintf(page + len, " %lu", sum);
+			}
+			len += sprintf(page + len, "\n");
+		}
+	}
+
+	return len;
+}
+
+static ssize_t
+queue_latency_hist_store(struct request_queue *q, const char *page,
+			 size_t count)
+{
+	int cpu;
+
+	if (!q->latency_hist)
+		return -ENODEV;
+
+	spin_lock_irq(q->queue_lock);
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(q->latency_hist, cpu), 0,
+		       sizeof(struct blk_latency_hist));
+	spin_unlock_irq(q->queue_lock);
+
+	return count;
+}
+
+static struct queue_sysfs_entry queue_latency_hist_entry = {
+	.attr = {.name = "latency_hist", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_latency_hist_show,
+	.store = queue_latency_hist_store,
+};
+#endif
+
 static struct attribute *default_attrs[] = {
 	&queue_requests_entry.attr,
 	&queue_ra_entry.attr,
@@ -411,6 +476,9 @@ static struct attribute *default_attrs[] = {
 	&queue_rq_affinity_entry.attr,
 	&queue_iostats_entry.attr,
 	&queue_random_entry.attr,
+#ifdef CONFIG_BLK_LATENCY_HIST
+	&queue_latency_hist_entry.attr,
+#endif
 	NULL,
 };
 
@@ -499,6 +567,10 @@ static void blk_release_queue(struct kobject *kobj)
 	blk_throtl_release(q);
 	blk_trace_shutdown(q);
 
+#ifdef CONFIG_BLK_LATENCY_HIST
+	free_percpu(q->latency_hist);
+#endif
+
 	bdi_destroy(&q->backing_dev_info);
 
 	ida_simple_remove(&blk_queue_ida, q->id);
@@ -9,6 +9,21 @@
 /* Number of requests a "batching" process may submit */
 #define BLK_BATCH_REQ	32
 
+#ifdef CONFIG_BLK_LATENCY_HIST
+/*
+ * Dispatch to completion latency of fs requests by direction and size
+ * (up to 4k, 16k, 64k and larger). Bucket 0 counts requests done within
+ * 128us, bucket n those within 128us << n, the last one everything else.
+ */
+#define BLK_LAT_SIZES		4
+#define BLK_LAT_BUCKETS		16
+#define BLK_LAT_SHIFT		7
+
+struct blk_latency_hist {
+	unsigned int count[2][BLK_LAT_SIZES][BLK_LAT_BUCKETS];
+};
+#endif
+
 extern struct kmem_cache *blk_requestq_cachep;
 extern struct kobj_type blk_queue_ktype;
 extern struct ida blk_queue_ida;
@@ -13,6 +13,7 @@
 #include <linux/init.h>
 #include <linux/compiler.h>
 #include <linux/rbtree.h>
+#include <linux/ktime.h>
 
 /*
  * See Documentation/block/deadline-iosched.txt
@@ -23,16 +24,27 @@ static const int writes_starved = 2;    /* max times reads can starve a write */
 static const int fifo_batch = 16;       /* # of sequential requests treated as one
 				     by the above parameters. For throughput. */
 
+/*
+ * Dispatch latency is kept per direction in power of two buckets of
+ * milliseconds: bucket 0 is below 1ms, bucket n covers [2^(n-1), 2^n) ms
+ * and the last one everything above.
+ */
+#define DL_LAT_BUCKETS	12
+
 struct deadline_data {
+	struct request_queue *queue;
+
 	/*
 	 * run time data
 	 */
 
 	/*
-	 * requests (deadline_rq s) are present on both sort_list and fifo_list
+	 * requests (deadline_rq s) are present on both sort_list and fifo_list,
+	 * the fifos are kept apart for async and sync requests of a direction
+	 * since their expire times differ
 	 */
 	struct rb_root sort_list[2];	
-	struct list_head fifo_list[2];
+	struct list_head fifo_list[2][2];
 
 	/*
 	 * next in sort order. read, write or both are NULL
@@ -41,14 +53,18 @@ struct deadline_data {
 	unsigned int batching;		/* number of sequential requests made */
 	sector_t last_sector;		/* head position */
 	unsigned int starved;		/* times reads have starved writes */
+	int last_dir;			/* direction of the current batch */
+
+	unsigned long lat_hist[2][DL_LAT_BUCKETS];
 
 	/*
 	 * settings that change how the i/o scheduler behaves
 	 */
-	int fifo_expire[2];
+	int fifo_expire[2][2];
 	int fifo_batch;
 	int writes_starved;
 	int front_merges;
+	int sort;			/* batches in sector order, else fifo */
 };
 
 static void deadline_move_request(struct deadline_data *, struct request *);
@@ -92,6 +108,53 @@ deadline_del_rq_rb(struct deadline_data *dd, struct request *rq)
 	elv_rb_del(deadline_rb_root(dd, rq), rq);
 }
 
+static inline int deadline_fifo_empty(struct deadline_data *dd, int ddir)
+{
+	return list_empty(&dd->fifo_list[ddir][0]) &&
+		list_empty(&dd->fifo_list[ddir][1]);
+}
+
+/*
+ * the request of direction `ddir' that expires first, if any
+ */
+static struct request *
+deadline_fifo_request(struct deadline_data *dd, int ddir)
+{
+	struct request *rq = NULL, *__rq;
+	int sync;
+
+	/* on a tie the sync request goes first */
+	for (sync = 1; sync >= 0; sync--) {
+		if (list_empty(&dd->fifo_list[ddir][sync]))
+			continue;
+
+		__rq = rq_entry_fifo(dd->fifo_list[ddir][sync].next);
+		if (!rq || time_before(rq_fifo_time(__rq), rq_fifo_time(rq)))
+			rq = __rq;
+	}
+
+	return rq;
+}
+
+/*
+ * the queueing time is kept in the otherwise unused elevator private
+ * field, in microseconds modulo the width of a long
+ */
+static inline unsigned long deadline_now_us(void)
+{
+	return (unsigned long)ktime_to_us(ktime_get());
+}
+
+static void
+deadline_account_latency(struct deadline_data *dd, struct request *rq)
+{
+	unsigned long us = deadline_now_us() - (unsigned long)rq->elv.priv[0];
+	unsigned int ms = us / USEC_PER_MSEC;
+	int bucket = ms ? min(fls(ms), DL_LAT_BUCKETS - 1) : 0;
+
+	dd->lat_hist[rq_data_dir(rq)][bucket]++;
+}
+
 /*
  * add rq to rbtree and fifo
  */
@@ -100,14 +163,16 @@ deadline_add_request(struct request_queue *q, struct request *rq)
 {
 	struct deadline_data *dd = q->elevator->elevator_data;
 	const int data_dir = rq_data_dir(rq);
+	const int sync = rq_is_sync(rq);
 
 	deadline_add_rq_rb(dd, rq);
 
 	/*
 	 * set expire time and add to fifo list
 	 */
-	rq_set_fifo_time(rq, jiffies + dd->fifo_expire[data_dir]);
-	list_add_tail(&rq->queuelist, &dd->fifo_list[data_dir]);
+	rq_set_fifo_time(rq, jiffies + dd->fifo_expire[data_dir][sync]);
+	list_add_tail(&rq->queuelist, &dd->fifo_list[data_dir][sync]);
+	rq->elv.priv[0] = (void *)deadline_now_us();
 }
 
 /*
@@ -194,6 +259,7 @@ deadline_move_to_dispatch(struct deadline_data *dd, struct request *rq)
 {
 	struct request_queue *q = rq->q;
 
+	deadline_account_latency(dd, rq);
 	deadline_remove_request(q, rq);
 	elv_dispatch_add_tail(q, rq);
 }
@@ -211,6 +277,7 @@ deadline_move_request(struct deadline_data *dd, struct request *rq)
 	dd->next_rq[data_dir] = deadline_latter_request(rq);
 
 	dd->last_sector = rq_end_sector(rq);
+	dd->last_dir = data_dir;
 
 	/*
 	 * take it off the sort and fifo list, move
@@ -221,11 +288,11 @@ deadline_move_request(struct deadline_data *dd, struct request *rq)
 
 /*
  * deadline_check_fifo returns 0 if there are no expired requests on the fifo,
- * 1 otherwise. Requires !list_empty(&dd->fifo_list[data_dir])
+ * 1 otherwise. Requires !deadline_fifo_empty(dd, ddir)
  */
 static inline int deadline_check_fifo(struct deadline_data *dd, int ddir)
 {
-	struct request *rq = rq_entry_fifo(dd->fifo_list[ddir].next);
+	struct request *rq = deadline_fifo_request(dd, ddir);
 
 	/*
 	 * rq is expired!
@@ -243,15 +310,18 @@ static inline int deadline_check_fifo(struct deadline_data *dd, int ddir)
 static int deadline_dispatch_requests(struct request_queue *q, int force)
 {
 	struct deadline_data *dd = q->elevator->elevator_data;
-	const int reads = !list_empty(&dd->fifo_list[READ]);
-	const int writes = !list_empty(&dd->fifo_list[WRITE]);
+	const int reads = !deadline_fifo_empty(dd, READ);
+	const int writes = !deadline_fifo_empty(dd, WRITE);
 	struct request *rq;
 	int data_dir;
 
 	/*
-	 * batches are currently reads XOR writes
+	 * batches are currently reads XOR writes. A sorted batch goes on
+	 * in sector order, a fifo batch in expiry order.
 	 */
-	if (dd->next_rq[WRITE])
+	if (!dd->sort)
+		rq = deadline_fifo_request(dd, dd->last_dir);
+	else if (dd->next_rq[WRITE])
 		rq = dd->next_rq[WRITE];
 	else
 		rq = dd->next_rq[READ];
@@ -297,13 +367,14 @@ dispatch_find_request:
 	/*
 	 * we are not running a batch, find best request for selected data_dir
 	 */
-	if (deadline_check_fifo(dd, data_dir) || !dd->next_rq[data_dir]) {
+	if (!dd->sort || deadline_check_fifo(dd, data_dir) ||
+	    !dd->next_rq[data_dir]) {
 		/*
 		 * A deadline has expired, the last request was in the other
 		 * direction, or we have run out of higher-sectored requests.
 		 * Start again from the request with the earliest expiry time.
 		 */
-		rq = rq_entry_fifo(dd->fifo_list[data_dir].next);
+		rq = deadline_fifo_request(dd, data_dir);
 	} else {
 		/*
 		 * The last req was the same dir and we have a next request in
@@ -328,8 +399,8 @@ static void deadline_exit_queue(struct elevator_queue *e)
 {
 	struct deadline_data *dd = e->elevator_data;
 
-	BUG_ON(!list_empty(&dd->fifo_list[READ]));
-	BUG_ON(!list_empty(&dd->fifo_list[WRITE]));
+	BUG_ON(!deadline_fifo_empty(dd, READ));
+	BUG_ON(!deadline_fifo_empty(dd, WRITE));
 
 	kfree(dd);
 }
@@ -345,15 +416,21 @@ static void *deadline_init_queue(struct request_queue *q)
 	if (!dd)
 		return NULL;
 
-	INIT_LIST_HEAD(&dd->fifo_list[READ]);
-	INIT_LIST_HEAD(&dd->fifo_list[WRITE]);
+	dd->queue = q;
+	INIT_LIST_HEAD(&dd->fifo_list[READ][0]);
+	INIT_LIST_HEAD(&dd->fifo_list[READ][1]);
+	INIT_LIST_HEAD(&dd->fifo_list[WRITE][0]);
+	INIT_LIST_HEAD(&dd->fifo_list[WRITE][1]);
 	dd->sort_list[READ] = RB_ROOT;
 	dd->sort_list[WRITE] = RB_ROOT;
-	dd->fifo_expire[READ] = read_expire;
-	dd->fifo_expire[WRITE] = write_expire;
+	dd->fifo_expire[READ][1] = read_expire;
+	dd->fifo_expire[WRITE][1] = write_expire;
+	dd->fifo_expire[READ][0] = read_expire;
+	dd->fifo_expire[WRITE][0] = write_expire;
 	dd->writes_starved = writes_starved;
 	dd->front_merges = 1;
 	dd->fifo_batch = fifo_batch;
+	dd->sort = 1;
 	return dd;
 }
 
@@ -385,11 +462,14 @@ static ssize_t __FUNC(struct elevator_queue *e, char *page)		\
 		__data = jiffies_to_msecs(__data);			\
 	return deadline_var_show(__data, (page));			\
 }
-SHOW_FUNCTION(deadline_read_expire_show, dd->fifo_expire[READ], 1);
-SHOW_FUNCTION(deadline_write_expire_show, dd->fifo_expire[WRITE], 1);
+SHOW_FUNCTION(deadline_read_expire_show, dd->fifo_expire[READ][1], 1);
+SHOW_FUNCTION(deadline_write_expire_show, dd->fifo_expire[WRITE][1], 1);
+SHOW_FUNCTION(deadline_async_read_expire_show, dd->fifo_expire[READ][0], 1);
+SHOW_FUNCTION(deadline_async_write_expire_show, dd->fifo_expire[WRITE][0], 1);
 SHOW_FUNCTION(deadline_writes_starved_show, dd->writes_starved, 0);
 SHOW_FUNCTION(deadline_front_merges_show, dd->front_merges, 0);
 SHOW_FUNCTION(deadline_fifo_batch_show, dd->fifo_batch, 0);
+SHOW_FUNCTION(deadline_sort_show, dd->sort, 0);
 #undef SHOW_FUNCTION
 
 #define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
@@ -408,13 +488,65 @@ static ssize_t __FUNC(struct elevator_queue *e, const char *page, size_t count)
 		*(__PTR) = __data;					\
 	return ret;							\
 }
-STORE_FUNCTION(deadline_read_expire_store, &dd->fifo_expire[READ], 0, INT_MAX, 1);
-STORE_FUNCTION(deadline_write_expire_store, &dd->fifo_expire[WRITE], 0, INT_MAX, 1);
+STORE_FUNCTION(deadline_read_expire_store, &dd->fifo_expire[READ][1], 0, INT_MAX, 1);
+STORE_FUNCTION(deadline_write_expire_store, &dd->fifo_expire[WRITE][1], 0, INT_MAX, 1);
+STORE_FUNCTION(deadline_async_read_expire_store, &dd->fifo_expire[READ][0], 0, INT_MAX, 1);
+STORE_FUNCTION(deadline_async_write_expire_store, &dd->fifo_expire[WRITE][0], 0, INT_MAX, 1);
 STORE_FUNCTION(deadline_writes_starved_store, &dd->writes_starved, INT_MIN, INT_MAX, 0);
 STORE_FUNCTION(deadline_front_merges_store, &dd->front_merges, 0, 1, 0);
 STORE_FUNCTION(deadline_fifo_batch_store, &dd->fifo_batch, 0, INT_MAX, 0);
+STORE_FUNCTION(deadline_sort_store, &dd->sort, 0, 1, 0);
 #undef STORE_FUNCTION
 
+/*
+ * one "bucket-limit-ms count" line per bucket, any write clears the
+ * histogram
+ */
+static ssize_t
+deadline_latency_show(struct deadline_data *dd, int ddir, char *page)
+{
+	unsigned long hist[DL_LAT_BUCKETS];
+	struct request_queue *q = dd->queue;
+	ssize_t len = 0;
+	int i;
+
+	spin_lock_irq(q->queue_lock);
+	memcpy(hist, dd->lat_hist[ddir], sizeof(hist));
+	spin_unlock_irq(q->queue_lock);
+
+	for (i = 0; i < DL_LAT_BUCKETS - 1; i++)
+		len += sprintf(page + len, "<%u %lu\n", 1U << i, hist[i]);
+	len += sprintf(page + len, ">=%u %lu\n", 1U << (i - 1), hist[i]);
+
+	return len;
+}
+
+static ssize_t
+deadline_latency_store(struct deadline_data *dd, int ddir, size_t count)
+{
+	struct request_queue *q = dd->queue;
+
+	spin_lock_irq(q->queue_lock);
+	memset(dd->lat_hist[ddir], 0, sizeof(dd->lat_hist[ddir]));
+	spin_unlock_irq(q->queue_lock);
+
+	return count;
+}
+
+#define LATENCY_FUNCTION(__SHOW, __STORE, __DIR)			\
+static ssize_t __SHOW(struct elevator_queue *e, char *page)		\
+{									\
+	return deadline_latency_show(e->elevator_data, __DIR, page);	\
+}									\
+static ssize_t __STORE(struct elevator_queue *e, const char *page,	\
+		       size_t count)					\
+{									\
+	return deadline_latency_store(e->elevator_data, __DIR, count);	\
+}
+LATENCY_FUNCTION(deadline_read_latency_show, deadline_read_latency_store, READ);
+LATENCY_FUNCTION(deadline_write_latency_show, deadline_write_latency_store, WRITE);
+#undef LATENCY_FUNCTION
+
 #define DD_ATTR(name) \
 	__ATTR(name, S_IRUGO|S_IWUSR, deadline_##name##_show, \
 				      deadline_##name##_store)
@@ -422,9 +554,14 @@ STORE_FUNCTION(deadline_fifo_batch_store, &dd->fifo_batch, 0, INT_MAX, 0);
 static struct elv_fs_entry deadline_attrs[] = {
 	DD_ATTR(read_expire),
 	DD_ATTR(write_expire),
+	DD_ATTR(async_read_expire),
+	DD_ATTR(async_write_expire),
 	DD_ATTR(writes_starved),
 	DD_ATTR(front_merges),
 	DD_ATTR(fifo_batch),
+	DD_ATTR(sort),
+	DD_ATTR(read_latency),
+	DD_ATTR(write_latency),
 	__ATTR_NULL
 };
 
@@ -12,6 +12,7 @@
 #include <linux/ioprio.h>
 #include <linux/blktrace_api.h>
 #include "blk.h"
+#include "blk-cgroup.h"
 
 #define VIOS_SCALE_SHIFT 10
 #define VIOS_SCALE (1 << VIOS_SCALE_SHIFT)
@@ -72,6 +73,10 @@ struct fiops_ioc {
 	pid_t pid;
 	unsigned short ioprio;
 	enum wl_prio_t wl_type;
+
+	/* blkio cgroup weight of the owning task, scales charged vios */
+	unsigned int weight;
+	unsigned long weight_stamp;
 };
 
 #define ioc_service_tree(ioc) (&((ioc)->fiopsd->service_tree[(ioc)->wl_type]))
@@ -333,6 +338,13 @@ static u64 fiops_scaled_vios(struct fiops_data *fiopsd,
 
 	vios +=  vios * (ioc->ioprio - IOPRIO_NORM) / VIOS_PRIO_SCALE;
 
+	/*
+	 * A context in a group with twice the weight is charged half the
+	 * vios per request, so it gets twice the dispatches while both are
+	 * backlogged on the same service tree.
+	 */
+	vios = vios * BLKIO_WEIGHT_DEFAULT / ioc->weight;
+
 	return vios;
 }
 
@@ -483,10 +495,55 @@ static void fiops_init_prio_data(struct fiops_ioc *cic)
 	fiops_clear_ioc_prio_changed(cic);
 }
 
+#ifdef CONFIG_BLK_CGROUP
+/*
+ * Pick up the blkio weight of the task issuing IO through @cic. A cgroup
+ * move is flagged on the icq, but a write to blkio.weight is not, so the
+ * weight is also re-read once a second.
+ */
+static void fiops_update_weight(struct fiops_ioc *cic)
+{
+	struct backing_dev_info *bdi = &cic->fiopsd->queue->backing_dev_info;
+	unsigned int changed, major, minor;
+	struct blkio_cgroup *blkcg;
+	dev_t dev = 0;
+
+	/* requests may be inserted on behalf of another context */
+	if (cic->icq.ioc != current->io_context)
+		return;
+
+	changed = icq_get_changed(&cic->icq);
+	if (changed & ICQ_IOPRIO_CHANGED)
+		fiops_mark_ioc_prio_changed(cic);
+
+	if (!(changed & ICQ_CGROUP_CHANGED) &&
+	    time_before(jiffies, cic->weight_stamp + HZ))
+		return;
+
+	if (bdi->dev && dev_name(bdi->dev)) {
+		sscanf(dev_name(bdi->dev), "%u:%u", &major, &minor);
+		dev = MKDEV(major, minor);
+	}
+
+	rcu_read_lock();
+	blkcg = task_blkio_cgroup(current);
+	cic->weight = clamp_t(unsigned int, blkcg_get_weight(blkcg, dev),
+			      BLKIO_WEIGHT_MIN, BLKIO_WEIGHT_MAX);
+	rcu_read_unlock();
+
+	cic->weight_stamp = jiffies;
+}
+#else
+static inline void fiops_update_weight(struct fiops_ioc *cic)
+{
+}
+#endif
+
 static void fiops_insert_request(struct request_queue *q, struct request *rq)
 {
 	struct fiops_ioc *ioc = RQ_CIC(rq);
 
+	fiops_update_weight(ioc);
 	fiops_init_prio_data(ioc);
 
 	list_add_tail(&rq->queuelist, &ioc->fifo);
@@ -651,6 +708,9 @@ static void fiops_init_icq(struct io_cq *icq)
 
 	ioc->pid = current->pid;
 	fiops_mark_ioc_prio_changed(ioc);
+
+	ioc->weight = BLKIO_WEIGHT_DEFAULT;
+	ioc->weight_stamp = jiffies - HZ;
 }
 
 /*
@@ -613,7 +613,7 @@ static int __init barcode_emul_init(void)
 
 	return 0;
 }
-late_initcall(barcode_emul_init);
+deferred_late_initcall(barcode_emul_init);
 
 static void __exit barcode_emul_exit(void)
 {
@@ -23,6 +23,8 @@
 #include <linux/kthread.h>
 #include <linux/wait.h>
 #include <linux/async.h>
+#include <linux/ktime.h>
+#include <linux/init.h>
 #include <linux/pm_runtime.h>
 
 #include "base.h"
@@ -476,6 +478,40 @@ int driver_attach(struct device_driver *drv)
 }
 EXPORT_SYMBOL_GPL(driver_attach);
 
+/* "driver_async_probe=0" probes every driver in line again */
+static bool driver_async_probe = true;
+core_param(driver_async_probe, driver_async_probe, bool, 0644);
+
+bool driver_allows_async_probing(struct device_driver *drv)
+{
+	return drv->probe_type == PROBE_PREFER_ASYNCHRONOUS &&
+	       driver_async_probe && system_state == SYSTEM_BOOTING;
+}
+
+static void __driver_attach_async(void *_drv, async_cookie_t cookie)
+{
+	struct device_driver *drv = _drv;
+	ktime_t calltime = ktime_get();
+	int ret;
+
+	ret = driver_attach(drv);
+
+	if (initcall_debug)
+		printk(KERN_DEBUG "async probe of %s returned %d after %lld usecs\n",
+		       drv->name, ret,
+		       ktime_to_us(ktime_sub(ktime_get(), calltime)));
+}
+
+/*
+ * Attach @drv from the async pool. Whoever needs the devices bound waits
+ * in wait_for_device_probe(), and init_post() has every async probe done
+ * before userspace starts.
+ */
+void driver_attach_async(struct device_driver *drv)
+{
+	async_schedule(__driver_attach_async, drv);
+}
+
 /*
  * __device_release_driver() must be called with @dev lock held.
  * When called for a USB interface, @dev->parent lock must be held as well.
@@ -31,6 +31,9 @@
 #include <linux/swap.h>
 #include <linux/mm_types.h>
 #include <linux/dma-contiguous.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
 
 #ifndef SZ_1M
 #define SZ_1M (1 << 20)
@@ -40,10 +43,25 @@ struct cma {
 	unsigned long	base_pfn;
 	unsigned long	count;
 	unsigned long	*bitmap;
+
+	/* pageblocks that failed to migrate lately, skipped on the first try */
+	unsigned long	*busy;
+	unsigned long	busy_expires;	/* jiffies */
+
+	/* allocation statistics, guarded by cma_mutex */
+	unsigned long	nr_allocs;
+	unsigned long	nr_fails;
+	unsigned long	nr_busy;	/* ranges found busy */
+	u64		total_us;
+	unsigned long	max_us;
+	unsigned long	last_us;
 };
 
 struct cma *dma_contiguous_default_area;
 
+/* how long a pageblock that failed to migrate is avoided */
+#define CMA_BUSY_EXPIRES	HZ
+
 #ifdef CONFIG_CMA_SIZE_MBYTES
 #define CMA_SIZE_MBYTES CONFIG_CMA_SIZE_MBYTES
 #else
@@ -137,6 +155,9 @@ void __init dma_contiguous_reserve(phys_addr_t limit)
 
 static DEFINE_MUTEX(cma_mutex);
 
+static struct cma *cma_areas[MAX_CMA_AREAS];
+static unsigned cma_area_count;
+
 static __init int cma_activate_area(unsigned long base_pfn, unsigned long count)
 {
 	unsigned long pfn = base_pfn;
@@ -168,27 +189,32 @@ static __init struct cma *cma_create_area(unsigned long base_pfn,
 
 	pr_debug("%s(base %08lx, count %lx)\n", __func__, base_pfn, count);
 
-	cma = kmalloc(sizeof *cma, GFP_KERNEL);
+	cma = kzalloc(sizeof *cma, GFP_KERNEL);
 	if (!cma)
 		return ERR_PTR(-ENOMEM);
 
 	cma->base_pfn = base_pfn;
 	cma->count = count;
 	cma->bitmap = kzalloc(bitmap_size, GFP_KERNEL);
+	cma->busy = kzalloc(BITS_TO_LONGS(count >> pageblock_order) *
+			    sizeof(long), GFP_KERNEL);
 
-	if (!cma->bitmap)
+	if (!cma->bitmap || !cma->busy)
 		goto no_mem;
 
 	ret = cma_activate_area(base_pfn, count);
 	if (ret)
-		goto error;
+		goto no_mem;
+
+	if (cma_area_count < MAX_CMA_AREAS)
+		cma_areas[cma_area_count++] = cma;
 
 	pr_debug("%s: returned %p\n", __func__, (void *)cma);
 	return cma;
 
-error:
-	kfree(cma->bitmap);
 no_mem:
+	kfree(cma->busy);
+	kfree(cma->bitmap);
 	kfree(cma);
 	return ERR_PTR(ret);
 }
@@ -303,11 +329,44 @@ err:
 	return base;
 }
 
+/*
+ * Returns the first page number from @pageno on that is worth trying for
+ * @count pages, skipping pageblocks that failed to migrate lately.
+ */
+static unsigned long cma_skip_busy(struct cma *cma, unsigned long pageno,
+				   int count, unsigned long mask)
+{
+	unsigned long first = pageno >> pageblock_order;
+	unsigned long last = (pageno + count - 1) >> pageblock_order;
+	unsigned long busy;
+
+	if (time_after(jiffies, cma->busy_expires)) {
+		bitmap_zero(cma->busy, cma->count >> pageblock_order);
+		return pageno;
+	}
+
+	busy = find_next_bit(cma->busy, last + 1, first);
+	if (busy > last)
+		return pageno;
+	return ALIGN((busy + 1) << pageblock_order, mask + 1);
+}
+
+static void cma_mark_busy(struct cma *cma, unsigned long pfn)
+{
+	set_bit((pfn - cma->base_pfn) >> pageblock_order, cma->busy);
+	cma->busy_expires = jiffies + CMA_BUSY_EXPIRES;
+	cma->nr_busy++;
+}
+
 static struct page *__dma_alloc_from_contiguous(struct device *dev, int count,
 				       unsigned int align)
 {
-	unsigned long mask, pfn, pageno, start = 0;
+	unsigned long mask, pfn, pageno, next, start;
+	unsigned long busy_pfn;
 	struct cma *cma = dev_get_cma_area(dev);
+	ktime_t begin = ktime_get();
+	unsigned long us;
+	bool fast = true;
 	int ret;
 
 	if (!cma || !cma->count)
@@ -326,10 +385,21 @@ static struct page *__dma_alloc_from_contiguous(struct device *dev, int count,
 
 	mutex_lock(&cma_mutex);
 
+	/*
+	 * The first pass steers clear of pageblocks that failed lately and
+	 * moves on at the first busy page; only when no range can be had
+	 * that way does the second pass wait for pages to come free.
+	 */
+	start = 0;
 	for (;;) {
 		pageno = bitmap_find_next_zero_area(cma->bitmap, cma->count,
 						    start, count, mask);
 		if (pageno >= cma->count) {
+			if (fast) {
+				fast = false;
+				start = 0;
+				continue;
+			}
 			printk(KERN_ERR "%s : cma->count is %lu, "
 					"pageno is %lu\n", __func__,
 					cma->count, pageno);
@@ -337,8 +407,18 @@ static struct page *__dma_alloc_from_contiguous(struct device *dev, int count,
 			goto error;
 		}
 
+		if (fast) {
+			next = cma_skip_busy(cma, pageno, count, mask);
+			if (next != pageno) {
+				start = next;
+				continue;
+			}
+		}
+
 		pfn = cma->base_pfn + pageno;
-		ret = alloc_contig_range(pfn, pfn + count, MIGRATE_CMA);
+		busy_pfn = pfn;
+		ret = __alloc_contig_range(pfn, pfn + count, MIGRATE_CMA,
+					   fast, &busy_pfn);
 		if (ret == 0) {
 			bitmap_set(cma->bitmap, pageno, count);
 			break;
@@ -346,17 +426,26 @@ static struct page *__dma_alloc_from_contiguous(struct device *dev, int count,
 			goto error;
 		}
 		pr_debug("%s(): memory range at %p is busy, retrying\n",
-			 __func__, pfn_to_page(pfn));
-		/* try again with a bit different memory target */
-		start = pageno + mask + 1;
+			 __func__, pfn_to_page(busy_pfn));
+		cma_mark_busy(cma, busy_pfn);
+		/* try again past the page that is in use */
+		start = max(pageno + mask + 1,
+			    ALIGN(busy_pfn - cma->base_pfn + 1, mask + 1));
 	}
 
+	us = ktime_to_us(ktime_sub(ktime_get(), begin));
+	cma->nr_allocs++;
+	cma->total_us += us;
+	cma->last_us = us;
+	if (us > cma->max_us)
+		cma->max_us = us;
 	mutex_unlock(&cma_mutex);
 
 	pr_debug("%s(): returned %p\n", __func__, pfn_to_page(pfn));
 	return pfn_to_page(pfn);
 error:
 	pr_err("%s(): returned error (%d)\n", __func__, ret);
+	cma->nr_fails++;
 	mutex_unlock(&cma_mutex);
 	return NULL;
 }
@@ -502,3 +591,50 @@ bool dma_release_from_contiguous(struct device *dev, struct page *pages,
 
 	return true;
 }
+
+#ifdef CONFIG_DEBUG_FS
+static int cma_stats_show(struct seq_file *s, void *unused)
+{
+	unsigned i;
+
+	seq_printf(s, "%-10s %8s %8s %6s %6s %10s %10s %10s\n",
+		   "base_pfn", "pages", "allocs", "fails", "busy",
+		   "avg_us", "max_us", "last_us");
+
+	mutex_lock(&cma_mutex);
+	for (i = 0; i < cma_area_count; i++) {
+		struct cma *cma = cma_areas[i];
+		u64 avg = cma->total_us;
+
+		if (cma->nr_allocs)
+			do_div(avg, cma->nr_allocs);
+		seq_printf(s, "0x%08lx %8lu %8lu %6lu %6lu %10llu %10lu %10lu\n",
+			   cma->base_pfn, cma->count, cma->nr_allocs,
+			   cma->nr_fails, cma->nr_busy, avg, cma->max_us,
+			   cma->last_us);
+	}
+	mutex_unlock(&cma_mutex);
+
+	return 0;
+}
+
+static int cma_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cma_stats_show, NULL);
+}
+
+static const struct file_operations cma_stats_fops = {
+	.open		= cma_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init cma_debugfs_init(void)
+{
+	debugfs_create_file("dma_contiguous", S_IRUGO, NULL, NULL,
+			    &cma_stats_fops);
+	return 0;
+}
+late_initcall(cma_debugfs_init);
+#endif
@@ -26,6 +26,7 @@
 #include <linux/interrupt.h>
 #include <linux/sched.h>
 #include <linux/async.h>
+#include <linux/slab.h>
 #include <linux/suspend.h>
 #include <linux/timer.h>
 
@@ -59,6 +60,19 @@ struct dpm_drv_wd_data {
 
 static int async_error;
 
+/*
+ * Ordering between devices that are not parent and child, added with
+ * device_pm_add_dependency(). The list only changes under pm_mutex, which
+ * is held across a whole system transition, so the transition walks it
+ * without locking.
+ */
+struct dpm_dependency {
+	struct list_head entry;
+	struct device *consumer;
+	struct device *supplier;
+};
+static LIST_HEAD(dpm_dependencies);
+
 /**
  * device_pm_init - Initialize the PM-related part of a device object.
  * @dev: Device object being initialized.
@@ -213,6 +227,24 @@ static void dpm_wait_for_children(struct device *dev, bool async)
        device_for_each_child(dev, &async, dpm_wait_fn);
 }
 
+static void dpm_wait_for_suppliers(struct device *dev, bool async)
+{
+	struct dpm_dependency *dep;
+
+	list_for_each_entry(dep, &dpm_dependencies, entry)
+		if (dep->consumer == dev)
+			dpm_wait(dep->supplier, async);
+}
+
+static void dpm_wait_for_consumers(struct device *dev, bool async)
+{
+	struct dpm_dependency *dep;
+
+	list_for_each_entry(dep, &dpm_dependencies, entry)
+		if (dep->supplier == dev)
+			dpm_wait(dep->consumer, async);
+}
+
 /**
  * pm_op - Execute the PM operation appropriate for given PM event.
  * @dev: Device to handle.
@@ -532,11 +564,14 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	int error = 0;
 	struct timer_list timer;
 	struct dpm_drv_wd_data data;
+	ktime_t calltime;
 
 	TRACE_DEVICE(dev);
 	TRACE_RESUME(0);
 
 	dpm_wait(dev->parent, async);
+	dpm_wait_for_suppliers(dev, async);
+	calltime = ktime_get();
 
 	data.dev = dev;
 	data.tsk = get_current();
@@ -600,6 +635,9 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	del_timer_sync(&timer);
 	destroy_timer_on_stack(&timer);
 
+	suspend_time_device_resumed(dev,
+			ktime_to_us(ktime_sub(ktime_get(), calltime)));
+
 	complete_all(&dev->power.completion);
 
 	TRACE_RESUME(error);
@@ -697,6 +735,7 @@ void dpm_resume(pm_message_t state)
 	}
 	mutex_unlock(&dpm_list_mtx);
 	async_synchronize_full();
+	suspend_time_resumed(ktime_to_us(ktime_sub(ktime_get(), starttime)));
 	dpm_show_time(starttime, state, NULL);
 }
 
@@ -930,6 +969,7 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 	struct dpm_drv_wd_data data;
 
 	dpm_wait_for_children(dev, async);
+	dpm_wait_for_consumers(dev, async);
 
 	data.dev = dev;
 	data.tsk = get_current();
@@ -1225,3 +1265,56 @@ int device_pm_wait_for_dev(struct device *subordinate, struct device *dev)
 	return async_error;
 }
 EXPORT_SYMBOL_GPL(device_pm_wait_for_dev);
+
+/**
+ * device_pm_add_dependency - Order system suspend/resume of two devices.
+ * @consumer: Device to suspend before and resume after @supplier.
+ * @supplier: Device @consumer relies on.
+ *
+ * For devices that are not parent and child, typically async ones on
+ * different buses. The supplier should have been registered first, and
+ * both devices are pinned until the dependency is removed.
+ */
+int device_pm_add_dependency(struct device *consumer, struct device *supplier)
+{
+	struct dpm_dependency *dep;
+
+	dep = kmalloc(sizeof(*dep), GFP_KERNEL);
+	if (!dep)
+		return -ENOMEM;
+
+	dep->consumer = get_device(consumer);
+	dep->supplier = get_device(supplier);
+
+	mutex_lock(&pm_mutex);
+	list_add_tail(&dep->entry, &dpm_dependencies);
+	mutex_unlock(&pm_mutex);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(device_pm_add_dependency);
+
+/**
+ * device_pm_remove_dependency - Drop an ordering added earlier.
+ * @consumer: Device passed as @consumer to device_pm_add_dependency().
+ * @supplier: Device passed as @supplier to device_pm_add_dependency().
+ */
+void device_pm_remove_dependency(struct device *consumer,
+				 struct device *supplier)
+{
+	struct dpm_dependency *dep;
+
+	mutex_lock(&pm_mutex);
+	list_for_each_entry(dep, &dpm_dependencies, entry) {
+		if (dep->consumer == consumer && dep->supplier == supplier) {
+			list_del(&dep->entry);
+			mutex_unlock(&pm_mutex);
+
+			put_device(dep->consumer);
+			put_device(dep->supplier);
+			kfree(dep);
+			return;
+		}
+	}
+	mutex_unlock(&pm_mutex);
+}
+EXPORT_SYMBOL_GPL(device_pm_remove_dependency);
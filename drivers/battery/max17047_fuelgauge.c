@@ -60,6 +60,15 @@
 #define MAX17047_REG_VFOCV		0xFB
 #define MAX17047_REG_SOC_VF		0xFF
 
+/* STATUS: Vmn, Tmn, Smn, Vmx, Tmx and Smx in the high byte */
+#define MAX17047_STATUS_ALRT_MASK	0x77
+
+/*
+ * The SOC alert is re-armed SALRT_WINDOW% around the VF SOC after every
+ * update, so the gauge interrupts once per step instead of being polled.
+ */
+#define SALRT_WINDOW		1
+
 /* Polling work */
 #undef	DEBUG_FUELGAUGE_POLLING
 #define MAX17047_POLLING_INTERVAL	10000
@@ -100,6 +109,9 @@ struct max17047_fuelgauge_data {
 	/* adjust full soc */
 	int				full_soc;
 
+	/* VF SOC% the SOC alert window is centred on, -1 if not armed */
+	int				salrt_soc;
+
 #ifdef USE_TRIM_ERROR_DETECTION
 	/* trim error state */
 	bool				trim_err;
@@ -421,6 +433,22 @@ static void max17047_set_valrt(struct max17047_fuelgauge_data *fg_data,
 			__func__, i2c_data[1], i2c_data[0], max, min);
 }
 
+static void max17047_rearm_salrt(struct max17047_fuelgauge_data *fg_data)
+{
+	int soc = fg_data->rawsoc / 100;
+	u8 lo, hi;
+
+	if (soc == fg_data->salrt_soc)
+		return;
+
+	/* never lose the 1% low battery alert the window started from */
+	lo = max(soc - SALRT_WINDOW, 1);
+	hi = (soc + SALRT_WINDOW >= 100) ? 0xFF : soc + SALRT_WINDOW;
+
+	max17047_set_salrt(fg_data, lo, hi);
+	fg_data->salrt_soc = soc;
+}
+
 static void max17047_alert_init(struct max17047_fuelgauge_data *fg_data)
 {
 	struct i2c_client *client = fg_data->client;
@@ -493,6 +521,8 @@ static void max17047_update_work(struct work_struct *work)
 
 	max17047_test_read(fg_data);
 
+	max17047_rearm_salrt(fg_data);
+
 	if (!battery_psy || !battery_psy->set_property) {
 		pr_err("%s: fail to get battery power supply\n", __func__);
 		return;
@@ -529,7 +559,7 @@ static void max17047_polling_work(struct work_struct *work)
 
 	max17047_test_read(fg_data);
 
-	schedule_delayed_work(&fg_data->polling_work,
+	queue_delayed_work(system_power_efficient_wq, &fg_data->polling_work,
 		msecs_to_jiffies(MAX17047_POLLING_INTERVAL));
 }
 #endif
@@ -674,9 +704,16 @@ static irqreturn_t max17047_fuelgauge_isr(int irq, void *data)
 	pr_info("%s: MAX17047_REG_STATUS(0x%02x%02x)\n", __func__,
 					i2c_data[1], i2c_data[0]);
 
+	/* the alert bits are sticky, clear them for the next window */
+	if (i2c_data[1] & MAX17047_STATUS_ALRT_MASK) {
+		i2c_data[1] &= ~MAX17047_STATUS_ALRT_MASK;
+		max17047_i2c_write(client, MAX17047_REG_STATUS, i2c_data);
+	}
+
 	cancel_delayed_work(&fg_data->update_work);
 	wake_lock(&fg_data->update_wake_lock);
-	schedule_delayed_work(&fg_data->update_work, msecs_to_jiffies(1000));
+	queue_delayed_work(system_power_efficient_wq,
+			&fg_data->update_work, msecs_to_jiffies(1000));
 
 	mutex_unlock(&fg_data->irq_lock);
 	return IRQ_HANDLED;
@@ -899,7 +936,9 @@ static int __devinit max17047_fuelgauge_i2c_probe(struct i2c_client *client,
 	max17047_reg_init(fg_data);
 
 	/* Initialize fuelgauge alert */
+	fg_data->salrt_soc = -1;
 	max17047_alert_init(fg_data);
+	max17047_rearm_salrt(fg_data);
 
 	INIT_DELAYED_WORK_DEFERRABLE(&fg_data->update_work,
 					max17047_update_work);
@@ -934,7 +973,8 @@ static int __devinit max17047_fuelgauge_i2c_probe(struct i2c_client *client,
 #ifdef DEBUG_FUELGAUGE_POLLING
 	INIT_DELAYED_WORK_DEFERRABLE(&fg_data->polling_work,
 					max17047_polling_work);
-	schedule_delayed_work(&fg_data->polling_work, 0);
+	queue_delayed_work(system_power_efficient_wq,
+			&fg_data->polling_work, 0);
 #else
 	max17047_test_read(fg_data);
 #endif
@@ -1054,7 +1094,8 @@ static int max17047_fuelgauge_resume(struct device *dev)
 #endif
 
 #ifdef DEBUG_FUELGAUGE_POLLING
-	schedule_delayed_work(&fg_data->polling_work, 0);
+	queue_delayed_work(system_power_efficient_wq,
+			&fg_data->polling_work, 0);
 #endif
 
 	return 0;
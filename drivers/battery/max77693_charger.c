@@ -1024,7 +1024,7 @@ void max77693_set_online_type(struct max77693_charger_data *chg_data, int data)
 
 	cancel_delayed_work(&chg_data->update_work);
 	wake_lock(&chg_data->update_wake_lock);
-	schedule_delayed_work(&chg_data->update_work,
+	queue_delayed_work(system_power_efficient_wq, &chg_data->update_work,
 			msecs_to_jiffies(STABLE_POWER_DELAY));
 }
 
@@ -1039,7 +1039,7 @@ void max77693_set_muic_cb_type(struct max77693_charger_data *chg_data, int data)
 
 	cancel_delayed_work(&chg_data->update_work);
 	wake_lock(&chg_data->update_wake_lock);
-	schedule_delayed_work(&chg_data->update_work,
+	queue_delayed_work(system_power_efficient_wq, &chg_data->update_work,
 			msecs_to_jiffies(STABLE_POWER_DELAY));
 }
 
@@ -1258,7 +1258,8 @@ static void max77693_update_work(struct work_struct *work)
 		if (vbus_state == POWER_SUPPLY_VBUS_WEAK) {
 			pr_info("%s: vbus weak\n", __func__);
 			wake_lock(&chg_data->softreg_wake_lock);
-			schedule_delayed_work(&chg_data->softreg_work,
+			queue_delayed_work(system_power_efficient_wq,
+					&chg_data->softreg_work,
 					msecs_to_jiffies(SW_REG_START_DELAY));
 		} else
 			pr_debug("%s: vbus not weak\n", __func__);
@@ -1349,7 +1350,8 @@ static void max77693_softreg_work(struct work_struct *work)
 
 		/* schedule softreg wq */
 		wake_lock(&chg_data->softreg_wake_lock);
-		schedule_delayed_work(&chg_data->softreg_work,
+		queue_delayed_work(system_power_efficient_wq,
+				&chg_data->softreg_work,
 				msecs_to_jiffies(SW_REG_STEP_DELAY));
 	} else {
 		/* check cable detached */
@@ -1360,7 +1362,8 @@ static void max77693_softreg_work(struct work_struct *work)
 
 			cancel_delayed_work(&chg_data->update_work);
 			wake_lock(&chg_data->update_wake_lock);
-			schedule_delayed_work(&chg_data->update_work,
+			queue_delayed_work(system_power_efficient_wq,
+					&chg_data->update_work,
 					msecs_to_jiffies(STABLE_POWER_DELAY));
 		}
 
@@ -1534,7 +1537,8 @@ static irqreturn_t max77693_bypass_irq(int irq, void *data)
 		if (chg_data->cable_type != POWER_SUPPLY_TYPE_WIRELESS) {
 			/* software regulation */
 			wake_lock(&chg_data->softreg_wake_lock);
-			schedule_delayed_work(&chg_data->softreg_work,
+			queue_delayed_work(system_power_efficient_wq,
+					&chg_data->softreg_work,
 					msecs_to_jiffies(SW_REG_START_DELAY));
 		} else
 			pr_err("%s: now in wireless charging, "
@@ -1548,7 +1552,7 @@ static irqreturn_t max77693_bypass_irq(int irq, void *data)
 
 	cancel_delayed_work(&chg_data->update_work);
 	wake_lock(&chg_data->update_wake_lock);
-	schedule_delayed_work(&chg_data->update_work,
+	queue_delayed_work(system_power_efficient_wq, &chg_data->update_work,
 			msecs_to_jiffies(STABLE_POWER_DELAY));
 
 	mutex_unlock(&chg_data->irq_lock);
@@ -1639,14 +1643,15 @@ static irqreturn_t max77693_charger_irq(int irq, void *data)
 
 		/* software regulation */
 		wake_lock(&chg_data->softreg_wake_lock);
-		schedule_delayed_work(&chg_data->softreg_work,
+		queue_delayed_work(system_power_efficient_wq,
+				&chg_data->softreg_work,
 				msecs_to_jiffies(SW_REG_STEP_DELAY));
 	}
 #endif
 
 	cancel_delayed_work(&chg_data->update_work);
 	wake_lock(&chg_data->update_wake_lock);
-	schedule_delayed_work(&chg_data->update_work,
+	queue_delayed_work(system_power_efficient_wq, &chg_data->update_work,
 			msecs_to_jiffies(STABLE_POWER_DELAY));
 
 	mutex_unlock(&chg_data->irq_lock);
@@ -1713,7 +1718,8 @@ static irqreturn_t wpc_charger_irq(int irq, void *data)
 
 			cancel_delayed_work(&chg_data->update_work);
 			wake_lock(&chg_data->update_wake_lock);
-			schedule_delayed_work(&chg_data->update_work,
+			queue_delayed_work(system_power_efficient_wq,
+				&chg_data->update_work,
 				msecs_to_jiffies(STABLE_POWER_DELAY));
 		}
 
@@ -13,12 +13,16 @@
 #include <linux/slab.h>
 #include <linux/wait.h>
 #include <linux/sched.h>
+#include <linux/percpu.h>
 
 #include "zcomp.h"
 #include "zcomp_lzo.h"
 #ifdef CONFIG_ZRAM_LZ4_COMPRESS
 #include "zcomp_lz4.h"
 #endif
+#ifdef CONFIG_ZRAM_LZ4HC_COMPRESS
+#include "zcomp_lz4hc.h"
+#endif
 
 /*
  * single zcomp_strm backend
@@ -41,12 +45,20 @@ struct zcomp_strm_multi {
 	/* list of available strms */
 	struct list_head idle_strm;
 	wait_queue_head_t strm_wait;
+	/*
+	 * one idle stream cached per cpu, taken and returned with xchg()
+	 * and cmpxchg() so that the common case never touches strm_lock
+	 */
+	struct zcomp_strm * __percpu *cpu_strm;
 };
 
 static struct zcomp_backend *backends[] = {
 	&zcomp_lzo,
 #ifdef CONFIG_ZRAM_LZ4_COMPRESS
 	&zcomp_lz4,
+#endif
+#ifdef CONFIG_ZRAM_LZ4HC_COMPRESS
+	&zcomp_lz4hc,
 #endif
 	NULL
 };
@@ -93,6 +105,43 @@ static struct zcomp_strm *zcomp_strm_alloc(struct zcomp *comp)
 	return zstrm;
 }
 
+/* take the idle stream cached on this cpu, if any */
+static struct zcomp_strm *zcomp_strm_multi_get_cpu(struct zcomp_strm_multi *zs)
+{
+	struct zcomp_strm **slot = get_cpu_ptr(zs->cpu_strm);
+	struct zcomp_strm *zstrm = xchg(slot, NULL);
+
+	put_cpu_ptr(zs->cpu_strm);
+	return zstrm;
+}
+
+/* take an idle stream cached on any cpu */
+static struct zcomp_strm *zcomp_strm_multi_steal(struct zcomp_strm_multi *zs)
+{
+	struct zcomp_strm *zstrm;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		zstrm = xchg(per_cpu_ptr(zs->cpu_strm, cpu), NULL);
+		if (zstrm)
+			return zstrm;
+	}
+	return NULL;
+}
+
+static bool zcomp_strm_multi_idle(struct zcomp_strm_multi *zs)
+{
+	int cpu;
+
+	if (!list_empty(&zs->idle_strm))
+		return true;
+	for_each_possible_cpu(cpu) {
+		if (*per_cpu_ptr(zs->cpu_strm, cpu))
+			return true;
+	}
+	return false;
+}
+
 /*
  * get idle zcomp_strm or wait until other process release
  * (zcomp_strm_release()) one for us
@@ -102,6 +151,10 @@ static struct zcomp_strm *zcomp_strm_multi_find(struct zcomp *comp)
 	struct zcomp_strm_multi *zs = comp->stream;
 	struct zcomp_strm *zstrm;
 
+	zstrm = zcomp_strm_multi_get_cpu(zs);
+	if (zstrm)
+		return zstrm;
+
 	while (1) {
 		spin_lock(&zs->strm_lock);
 		if (!list_empty(&zs->idle_strm)) {
@@ -114,7 +167,10 @@ static struct zcomp_strm *zcomp_strm_multi_find(struct zcomp *comp)
 		/* zstrm streams limit reached, wait for idle stream */
 		if (zs->avail_strm >= zs->max_strm) {
 			spin_unlock(&zs->strm_lock);
-			wait_event(zs->strm_wait, !list_empty(&zs->idle_strm));
+			zstrm = zcomp_strm_multi_steal(zs);
+			if (zstrm)
+				return zstrm;
+			wait_event(zs->strm_wait, zcomp_strm_multi_idle(zs));
 			continue;
 		}
 		/* allocate new zstrm stream */
@@ -126,7 +182,7 @@ static struct zcomp_strm *zcomp_strm_multi_find(struct zcomp *comp)
 			spin_lock(&zs->strm_lock);
 			zs->avail_strm--;
 			spin_unlock(&zs->strm_lock);
-			wait_event(zs->strm_wait, !list_empty(&zs->idle_strm));
+			wait_event(zs->strm_wait, zcomp_strm_multi_idle(zs));
 			continue;
 		}
 		break;
@@ -134,10 +190,27 @@ static struct zcomp_strm *zcomp_strm_multi_find(struct zcomp *comp)
 	return zstrm;
 }
 
-/* add stream back to idle list and wake up waiter or free the stream */
+/*
+ * park stream in this cpu's cache slot, or add it back to idle list,
+ * and wake up waiter; free the stream if the limit has been lowered
+ */
 static void zcomp_strm_multi_release(struct zcomp *comp, struct zcomp_strm *zstrm)
 {
 	struct zcomp_strm_multi *zs = comp->stream;
+	struct zcomp_strm **slot;
+
+	if (ACCESS_ONCE(zs->avail_strm) <= ACCESS_ONCE(zs->max_strm)) {
+		slot = get_cpu_ptr(zs->cpu_strm);
+		if (!cmpxchg(slot, NULL, zstrm)) {
+			put_cpu_ptr(zs->cpu_strm);
+			/* pairs with set_current_state() in wait_event() */
+			smp_mb();
+			if (waitqueue_active(&zs->strm_wait))
+				wake_up(&zs->strm_wait);
+			return;
+		}
+		put_cpu_ptr(zs->cpu_strm);
+	}
 
 	spin_lock(&zs->strm_lock);
 	if (zs->avail_strm <= zs->max_strm) {
@@ -164,10 +237,15 @@ static bool zcomp_strm_multi_set_max_streams(struct zcomp *comp, int num_strm)
 	 * if user has lowered the limit and there are idle streams,
 	 * immediately free as much streams (and memory) as we can.
 	 */
-	while (zs->avail_strm > num_strm && !list_empty(&zs->idle_strm)) {
-		zstrm = list_entry(zs->idle_strm.next,
-				struct zcomp_strm, list);
-		list_del(&zstrm->list);
+	while (zs->avail_strm > num_strm) {
+		zstrm = zcomp_strm_multi_steal(zs);
+		if (!zstrm) {
+			if (list_empty(&zs->idle_strm))
+				break;
+			zstrm = list_entry(zs->idle_strm.next,
+					struct zcomp_strm, list);
+			list_del(&zstrm->list);
+		}
 		zcomp_strm_free(comp, zstrm);
 		zs->avail_strm--;
 	}
@@ -180,12 +258,15 @@ static void zcomp_strm_multi_destroy(struct zcomp *comp)
 	struct zcomp_strm_multi *zs = comp->stream;
 	struct zcomp_strm *zstrm;
 
+	while ((zstrm = zcomp_strm_multi_steal(zs)))
+		zcomp_strm_free(comp, zstrm);
 	while (!list_empty(&zs->idle_strm)) {
 		zstrm = list_entry(zs->idle_strm.next,
 				struct zcomp_strm, list);
 		list_del(&zstrm->list);
 		zcomp_strm_free(comp, zstrm);
 	}
+	free_percpu(zs->cpu_strm);
 	kfree(zs);
 }
 
@@ -202,6 +283,12 @@ static int zcomp_strm_multi_create(struct zcomp *comp, int max_strm)
 	if (!zs)
 		return -ENOMEM;
 
+	zs->cpu_strm = alloc_percpu(struct zcomp_strm *);
+	if (!zs->cpu_strm) {
+		kfree(zs);
+		return -ENOMEM;
+	}
+
 	comp->stream = zs;
 	spin_lock_init(&zs->strm_lock);
 	INIT_LIST_HEAD(&zs->idle_strm);
@@ -211,6 +298,7 @@ static int zcomp_strm_multi_create(struct zcomp *comp, int max_strm)
 
 	zstrm = zcomp_strm_alloc(comp);
 	if (!zstrm) {
+		free_percpu(zs->cpu_strm);
 		kfree(zs);
 		return -ENOMEM;
 	}
@@ -286,6 +374,11 @@ ssize_t zcomp_available_show(const char *comp, char *buf)
 	return sz;
 }
 
+bool zcomp_available_algorithm(const char *comp)
+{
+	return find_backend(comp) != NULL;
+}
+
 bool zcomp_set_max_streams(struct zcomp *comp, int num_strm)
 {
 	return comp->set_max_streams(comp, num_strm);
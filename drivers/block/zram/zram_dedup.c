@@ -0,0 +1,209 @@
+/*
+ * Compressed RAM block device - same page deduplication
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/jhash.h>
+#include <linux/highmem.h>
+
+#include "zram_drv.h"
+#include "zram_dedup.h"
+
+/* One hash bucket for every 2^ZRAM_HASH_SHIFT disk pages */
+#define ZRAM_HASH_SHIFT		10
+#define ZRAM_HASH_SIZE_MIN	(1 << 10)
+#define ZRAM_HASH_SIZE_MAX	(1 << 20)
+
+u32 zram_dedup_checksum(unsigned char *mem)
+{
+	return jhash2((const u32 *)mem, PAGE_SIZE / sizeof(u32), 0);
+}
+
+static struct zram_hash *zram_dedup_bucket(struct zram_meta *meta,
+					u32 checksum)
+{
+	return &meta->hash[checksum % meta->hash_size];
+}
+
+static void zram_dedup_insert(struct zram_meta *meta, struct zram_entry *new)
+{
+	struct zram_hash *hash = zram_dedup_bucket(meta, new->checksum);
+	struct rb_node **rb_node, *parent = NULL;
+	struct zram_entry *entry;
+
+	spin_lock(&hash->lock);
+	rb_node = &hash->rb_root.rb_node;
+	while (*rb_node) {
+		parent = *rb_node;
+		entry = rb_entry(parent, struct zram_entry, rb_node);
+		if (new->checksum < entry->checksum)
+			rb_node = &parent->rb_left;
+		else
+			rb_node = &parent->rb_right;
+	}
+
+	rb_link_node(&new->rb_node, parent, rb_node);
+	rb_insert_color(&new->rb_node, &hash->rb_root);
+	spin_unlock(&hash->lock);
+}
+
+/*
+ * Drop a reference; the last one frees the compressed object.
+ * Returns the number of references left.
+ */
+static unsigned long zram_dedup_put_ref(struct zram *zram,
+					struct zram_entry *entry)
+{
+	struct zram_meta *meta = zram->meta;
+	struct zram_hash *hash = zram_dedup_bucket(meta, entry->checksum);
+	unsigned long refcount;
+
+	spin_lock(&hash->lock);
+	refcount = --entry->refcount;
+	if (!refcount)
+		rb_erase(&entry->rb_node, &hash->rb_root);
+	spin_unlock(&hash->lock);
+
+	if (!refcount) {
+		zs_free(meta->mem_pool, entry->handle);
+		atomic64_sub(entry->len, &zram->stats.compr_data_size);
+		kfree(entry);
+	}
+
+	return refcount;
+}
+
+static bool zram_dedup_match(struct zram *zram, struct zcomp_strm *zstrm,
+			struct zram_entry *entry, unsigned char *mem)
+{
+	struct zram_meta *meta = zram->meta;
+	unsigned char *cmem;
+	bool match = false;
+
+	cmem = zs_map_object(meta->mem_pool, entry->handle, ZS_MM_RO);
+	if (entry->len == PAGE_SIZE)
+		match = !memcmp(mem, cmem, PAGE_SIZE);
+	else if (!zcomp_decompress(zram->comp, cmem, entry->len,
+				zstrm->buffer))
+		match = !memcmp(mem, zstrm->buffer, PAGE_SIZE);
+	zs_unmap_object(meta->mem_pool, entry->handle);
+
+	return match;
+}
+
+/*
+ * Look for an already stored object with the same content as @mem.
+ * On a hit the returned entry has an extra reference for the caller.
+ * The checksum is returned either way so that a miss can be inserted
+ * with zram_dedup_new() without hashing the page again.
+ *
+ * @zstrm's buffer is used to decompress the candidate, so this has to
+ * be called before the page is compressed into it.
+ */
+struct zram_entry *zram_dedup_find(struct zram *zram, struct zcomp_strm *zstrm,
+				unsigned char *mem, u32 *checksum)
+{
+	struct zram_meta *meta = zram->meta;
+	struct zram_hash *hash;
+	struct zram_entry *entry = NULL;
+	struct rb_node *rb_node;
+	size_t len;
+
+	*checksum = zram_dedup_checksum(mem);
+	hash = zram_dedup_bucket(meta, *checksum);
+
+	spin_lock(&hash->lock);
+	rb_node = hash->rb_root.rb_node;
+	while (rb_node) {
+		entry = rb_entry(rb_node, struct zram_entry, rb_node);
+		if (*checksum == entry->checksum) {
+			entry->refcount++;
+			break;
+		}
+		if (*checksum < entry->checksum)
+			rb_node = rb_node->rb_left;
+		else
+			rb_node = rb_node->rb_right;
+		entry = NULL;
+	}
+	spin_unlock(&hash->lock);
+
+	if (!entry)
+		return NULL;
+
+	/* checksum collision, only the first candidate is compared */
+	if (!zram_dedup_match(zram, zstrm, entry, mem)) {
+		zram_dedup_put_ref(zram, entry);
+		return NULL;
+	}
+
+	len = entry->len;
+	atomic64_inc(&zram->stats.dedup_hits);
+	atomic64_add(len, &zram->stats.dup_data_size);
+	return entry;
+}
+
+/*
+ * Wrap a freshly stored object into an entry holding one reference and
+ * make it visible to zram_dedup_find(). Returns NULL if out of memory.
+ */
+struct zram_entry *zram_dedup_new(struct zram *zram, unsigned long handle,
+				size_t len, u32 checksum)
+{
+	struct zram_entry *entry;
+
+	entry = kmalloc(sizeof(*entry), GFP_NOIO | __GFP_NOWARN);
+	if (!entry)
+		return NULL;
+
+	entry->handle = handle;
+	entry->len = len;
+	entry->checksum = checksum;
+	entry->refcount = 1;
+	zram_dedup_insert(zram->meta, entry);
+
+	return entry;
+}
+
+void zram_dedup_put(struct zram *zram, struct zram_entry *entry)
+{
+	size_t len = entry->len;
+
+	if (zram_dedup_put_ref(zram, entry))
+		atomic64_sub(len, &zram->stats.dup_data_size);
+}
+
+int zram_dedup_init(struct zram_meta *meta, size_t num_pages)
+{
+	size_t i;
+
+	meta->hash_size = num_pages >> ZRAM_HASH_SHIFT;
+	meta->hash_size = clamp_t(size_t, meta->hash_size,
+				ZRAM_HASH_SIZE_MIN, ZRAM_HASH_SIZE_MAX);
+	meta->hash = vzalloc(meta->hash_size * sizeof(struct zram_hash));
+	if (!meta->hash) {
+		pr_err("Error allocating zram entry hash\n");
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < meta->hash_size; i++) {
+		spin_lock_init(&meta->hash[i].lock);
+		meta->hash[i].rb_root = RB_ROOT;
+	}
+
+	return 0;
+}
+
+void zram_dedup_fini(struct zram_meta *meta)
+{
+	vfree(meta->hash);
+	meta->hash = NULL;
+	meta->hash_size = 0;
+}
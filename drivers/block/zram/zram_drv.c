@@ -34,8 +34,12 @@
 #include <linux/vmalloc.h>
 #include <linux/ratelimit.h>
 #include <linux/err.h>
+#include <linux/file.h>
+#include <linux/workqueue.h>
+#include <linux/mempool.h>
 
 #include "zram_drv.h"
+#include "zram_dedup.h"
 
 /* Globals */
 static int zram_major;
@@ -55,6 +59,60 @@ static const char *default_compressor = "lzo";
 /* Module params (documentation at end) */
 static unsigned int num_devices = 1;
 
+static void zram_stat_inc(struct zram *zram, enum zram_pcpu_stat_item item)
+{
+	struct zram_pcpu_stats *stats = get_cpu_ptr(zram->pcpu_stats);
+
+	u64_stats_update_begin(&stats->syncp);
+	stats->count[item]++;
+	u64_stats_update_end(&stats->syncp);
+	put_cpu_ptr(zram->pcpu_stats);
+}
+
+static u64 zram_stat_read(struct zram *zram, enum zram_pcpu_stat_item item)
+{
+	u64 sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct zram_pcpu_stats *stats = per_cpu_ptr(zram->pcpu_stats,
+							    cpu);
+		unsigned int start;
+		u64 val;
+
+		do {
+			start = u64_stats_fetch_begin(&stats->syncp);
+			val = stats->count[item];
+		} while (u64_stats_fetch_retry(&stats->syncp, start));
+		sum += val;
+	}
+
+	return sum;
+}
+
+static void zram_stat_reset(struct zram *zram)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct zram_pcpu_stats *stats = per_cpu_ptr(zram->pcpu_stats,
+							    cpu);
+
+		memset(stats->count, 0, sizeof(stats->count));
+	}
+}
+
+#define ZRAM_PCPU_ATTR_RO(name, item)					\
+static ssize_t zram_attr_##name##_show(struct device *d,		\
+				struct device_attribute *attr, char *b)	\
+{									\
+	struct zram *zram = dev_to_zram(d);				\
+	return scnprintf(b, PAGE_SIZE, "%llu\n",			\
+		(u64)zram_stat_read(zram, item));			\
+}									\
+static struct device_attribute dev_attr_##name =			\
+	__ATTR(name, S_IRUGO, zram_attr_##name##_show, NULL);
+
 #define ZRAM_ATTR_RO(name)						\
 static ssize_t zram_attr_##name##_show(struct device *d,		\
 				struct device_attribute *attr, char *b)	\
@@ -66,6 +124,15 @@ static ssize_t zram_attr_##name##_show(struct device *d,		\
 static struct device_attribute dev_attr_##name =			\
 	__ATTR(name, S_IRUGO, zram_attr_##name##_show, NULL);
 
+/*
+ * One stream per online cpu lets kswapd and direct reclaim compress in
+ * parallel. Streams beyond the first are only allocated on contention.
+ */
+static inline int default_comp_streams(void)
+{
+	return num_online_cpus();
+}
+
 static inline int init_done(struct zram *zram)
 {
 	return zram->meta != NULL;
@@ -121,6 +188,42 @@ static ssize_t mem_used_total_show(struct device *dev,
 	return scnprintf(buf, PAGE_SIZE, "%llu\n", val << PAGE_SHIFT);
 }
 
+static ssize_t pages_compacted_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	u64 val = 0;
+	struct zram *zram = dev_to_zram(dev);
+	struct zram_meta *meta = zram->meta;
+
+	down_read(&zram->init_lock);
+	if (init_done(zram))
+		val = zs_get_compacted_pages(meta->mem_pool);
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%llu\n", val);
+}
+
+static ssize_t compact_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	unsigned long nr_migrated;
+	struct zram *zram = dev_to_zram(dev);
+	struct zram_meta *meta;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		up_read(&zram->init_lock);
+		return -EINVAL;
+	}
+
+	meta = zram->meta;
+	nr_migrated = zs_compact(meta->mem_pool);
+	atomic64_add(nr_migrated, &zram->stats.num_migrated);
+	up_read(&zram->init_lock);
+
+	return len;
+}
+
 static ssize_t max_comp_streams_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -180,6 +283,10 @@ static ssize_t comp_algorithm_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
 	struct zram *zram = dev_to_zram(dev);
+
+	if (!zcomp_available_algorithm(buf))
+		return -EINVAL;
+
 	down_write(&zram->init_lock);
 	if (init_done(zram)) {
 		up_write(&zram->init_lock);
@@ -191,6 +298,46 @@ static ssize_t comp_algorithm_store(struct device *dev,
 	return len;
 }
 
+static ssize_t use_dedup_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	bool val;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	val = zram->use_dedup;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", (int)val);
+}
+
+static ssize_t use_dedup_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	int val;
+	struct zram *zram = dev_to_zram(dev);
+	int ret;
+
+	if (!IS_ENABLED(CONFIG_ZRAM_DEDUP))
+		return -EINVAL;
+
+	ret = kstrtoint(buf, 10, &val);
+	if (ret < 0)
+		return ret;
+	if (val != 0 && val != 1)
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change dedup usage for initialized device\n");
+		return -EBUSY;
+	}
+	zram->use_dedup = val;
+	up_write(&zram->init_lock);
+	return len;
+}
+
 /* flag operations needs meta->tb_lock */
 static int zram_test_flag(struct zram_meta *meta, u32 index,
 			enum zram_pageflags flag)
@@ -252,17 +399,29 @@ static inline int valid_io_request(struct zram *zram, struct bio *bio)
 	return 1;
 }
 
+static unsigned long zram_get_handle(struct zram_meta *meta, u32 index)
+{
+	struct zram_entry *entry;
+
+	if (!zram_dedup_enabled(meta))
+		return meta->table[index].handle;
+
+	entry = meta->table[index].entry;
+	return entry ? entry->handle : 0;
+}
+
 static void zram_meta_free(struct zram_meta *meta)
 {
+	zram_dedup_fini(meta);
 	zs_destroy_pool(meta->mem_pool);
 	vfree(meta->table);
 	kfree(meta);
 }
 
-static struct zram_meta *zram_meta_alloc(u64 disksize)
+static struct zram_meta *zram_meta_alloc(u64 disksize, bool use_dedup)
 {
 	size_t num_pages;
-	struct zram_meta *meta = kmalloc(sizeof(*meta), GFP_KERNEL);
+	struct zram_meta *meta = kzalloc(sizeof(*meta), GFP_KERNEL);
 	if (!meta)
 		goto out;
 
@@ -280,8 +439,13 @@ static struct zram_meta *zram_meta_alloc(u64 disksize)
 		goto free_table;
 	}
 
+	if (use_dedup && zram_dedup_init(meta, num_pages))
+		goto free_pool;
+
 	return meta;
 
+free_pool:
+	zs_destroy_pool(meta->mem_pool);
 free_table:
 	vfree(meta->table);
 free_meta:
@@ -328,6 +492,153 @@ static void handle_zero_page(struct bio_vec *bvec)
 	flush_dcache_page(page);
 }
 
+/*
+ * Partial IO has to go through a whole page. Take it from a small per
+ * device pool rather than the page allocator: GFP_NOIO allocations made
+ * while swapping out are the ones most likely to fail or stall.
+ */
+static struct page *zram_get_bounce(struct zram *zram)
+{
+	zram_stat_inc(zram, ZRAM_STAT_PARTIAL_IO);
+	return mempool_alloc(zram->bounce_pool, GFP_NOIO);
+}
+
+static void zram_put_bounce(struct zram *zram, struct page *page)
+{
+	mempool_free(page, zram->bounce_pool);
+}
+
+#ifdef CONFIG_ZRAM_WRITEBACK
+static bool zram_wb_enabled(struct zram *zram)
+{
+	return zram->backing_dev != NULL;
+}
+
+static void reset_bdev(struct zram *zram)
+{
+	if (!zram_wb_enabled(zram))
+		return;
+
+	blkdev_put(zram->bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL);
+	filp_close(zram->backing_dev, NULL);
+	vfree(zram->bitmap);
+	zram->backing_dev = NULL;
+	zram->bdev = NULL;
+	zram->bitmap = NULL;
+	zram->nr_pages = 0;
+}
+
+/* block 0 is never handed out so that a zero handle still means empty */
+static unsigned long alloc_block_bdev(struct zram *zram)
+{
+	unsigned long blk_idx = 1;
+retry:
+	blk_idx = find_next_zero_bit(zram->bitmap, zram->nr_pages, blk_idx);
+	if (blk_idx >= zram->nr_pages)
+		return 0;
+
+	if (test_and_set_bit(blk_idx, zram->bitmap))
+		goto retry;
+
+	atomic64_inc(&zram->stats.bd_count);
+	return blk_idx;
+}
+
+static void free_block_bdev(struct zram *zram, unsigned long blk_idx)
+{
+	int was_set;
+
+	was_set = test_and_clear_bit(blk_idx, zram->bitmap);
+	WARN_ON_ONCE(!was_set);
+	atomic64_dec(&zram->stats.bd_count);
+}
+
+static void zram_bdev_end_io(struct bio *bio, int err)
+{
+	complete(bio->bi_private);
+}
+
+/* synchronous single page I/O against the backing device */
+static int zram_bdev_rw(struct zram *zram, struct page *page,
+			unsigned long blk_idx, int rw)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct bio *bio;
+	int ret;
+
+	bio = bio_alloc(GFP_NOIO, 1);
+	if (!bio)
+		return -ENOMEM;
+
+	bio->bi_sector = blk_idx * (PAGE_SIZE >> SECTOR_SHIFT);
+	bio->bi_bdev = zram->bdev;
+	if (!bio_add_page(bio, page, PAGE_SIZE, 0)) {
+		bio_put(bio);
+		return -EIO;
+	}
+	bio->bi_end_io = zram_bdev_end_io;
+	bio->bi_private = &done;
+
+	submit_bio(rw, bio);
+	wait_for_completion(&done);
+
+	ret = test_bit(BIO_UPTODATE, &bio->bi_flags) ? 0 : -EIO;
+	bio_put(bio);
+
+	if (rw & WRITE)
+		atomic64_inc(&zram->stats.bd_writes);
+	else
+		atomic64_inc(&zram->stats.bd_reads);
+	return ret;
+}
+
+struct zram_work {
+	struct work_struct work;
+	struct zram *zram;
+	unsigned long blk_idx;
+	struct page *page;
+	int ret;
+};
+
+static void zram_sync_read(struct work_struct *work)
+{
+	struct zram_work *zw = container_of(work, struct zram_work, work);
+
+	zw->ret = zram_bdev_rw(zw->zram, zw->page, zw->blk_idx, READ_SYNC);
+}
+
+/*
+ * Bios submitted from inside zram_make_request() are only dispatched
+ * once it returns (see generic_make_request()), so waiting for one here
+ * would deadlock. Issue the read from a worker instead.
+ */
+static int read_from_bdev(struct zram *zram, struct page *page,
+			unsigned long blk_idx)
+{
+	struct zram_work work;
+
+	work.zram = zram;
+	work.page = page;
+	work.blk_idx = blk_idx;
+
+	INIT_WORK_ONSTACK(&work.work, zram_sync_read);
+	queue_work(system_unbound_wq, &work.work);
+	flush_work(&work.work);
+	destroy_work_on_stack(&work.work);
+
+	return work.ret;
+}
+#else
+static inline bool zram_wb_enabled(struct zram *zram) { return false; }
+static inline void reset_bdev(struct zram *zram) { }
+static inline void free_block_bdev(struct zram *zram,
+			unsigned long blk_idx) { }
+static inline int read_from_bdev(struct zram *zram, struct page *page,
+			unsigned long blk_idx)
+{
+	return -EIO;
+}
+#endif
 
 /*
  * To protect concurrent access to the same index entry,
@@ -337,8 +648,20 @@ static void handle_zero_page(struct bio_vec *bvec)
 static void zram_free_page(struct zram *zram, size_t index)
 {
 	struct zram_meta *meta = zram->meta;
-	unsigned long handle = meta->table[index].handle;
+	unsigned long handle;
+
+	zram_clear_flag(meta, index, ZRAM_HUGE);
+	zram_clear_flag(meta, index, ZRAM_IDLE);
+	zram_clear_flag(meta, index, ZRAM_UNDER_WB);
+
+	if (zram_test_flag(meta, index, ZRAM_WB)) {
+		zram_clear_flag(meta, index, ZRAM_WB);
+		free_block_bdev(zram, meta->table[index].handle);
+		meta->table[index].handle = 0;
+		return;
+	}
 
+	handle = zram_get_handle(meta, index);
 	if (unlikely(!handle)) {
 		/*
 		 * No memory is allocated for zero filled pages.
@@ -351,10 +674,13 @@ static void zram_free_page(struct zram *zram, size_t index)
 		return;
 	}
 
-	zs_free(meta->mem_pool, handle);
-
-	atomic64_sub(zram_get_obj_size(meta, index),
-			&zram->stats.compr_data_size);
+	if (zram_dedup_enabled(meta)) {
+		zram_dedup_put(zram, meta->table[index].entry);
+	} else {
+		zs_free(meta->mem_pool, handle);
+		atomic64_sub(zram_get_obj_size(meta, index),
+				&zram->stats.compr_data_size);
+	}
 	atomic64_dec(&zram->stats.pages_stored);
 
 	meta->table[index].handle = 0;
@@ -370,7 +696,13 @@ static int zram_decompress_page(struct zram *zram, char *mem, u32 index)
 	size_t size;
 
 	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
-	handle = meta->table[index].handle;
+	if (unlikely(zram_test_flag(meta, index, ZRAM_WB))) {
+		/* callers read written back pages with read_from_bdev() */
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		return -EIO;
+	}
+	zram_clear_flag(meta, index, ZRAM_IDLE);
+	handle = zram_get_handle(meta, index);
 	size = zram_get_obj_size(meta, index);
 
 	if (!handle || zram_test_flag(meta, index, ZRAM_ZERO)) {
@@ -396,13 +728,37 @@ static int zram_decompress_page(struct zram *zram, char *mem, u32 index)
 	return 0;
 }
 
+static int zram_bvec_read_bdev(struct zram *zram, struct bio_vec *bvec,
+			unsigned long blk_idx, int offset)
+{
+	unsigned char *user_mem;
+	struct page *bounce;
+	int ret;
+
+	if (!is_partial_io(bvec))
+		return read_from_bdev(zram, bvec->bv_page, blk_idx);
+
+	bounce = zram_get_bounce(zram);
+	ret = read_from_bdev(zram, bounce, blk_idx);
+	if (!ret) {
+		user_mem = kmap_atomic(bvec->bv_page);
+		memcpy(user_mem + bvec->bv_offset,
+				page_address(bounce) + offset, bvec->bv_len);
+		kunmap_atomic(user_mem);
+		flush_dcache_page(bvec->bv_page);
+	}
+	zram_put_bounce(zram, bounce);
+	return ret;
+}
+
 static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 			  u32 index, int offset, struct bio *bio)
 {
 	int ret;
-	struct page *page;
+	struct page *page, *bounce = NULL;
 	unsigned char *user_mem, *uncmem = NULL;
 	struct zram_meta *meta = zram->meta;
+	unsigned long blk_idx;
 	page = bvec->bv_page;
 
 	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
@@ -412,22 +768,23 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 		handle_zero_page(bvec);
 		return 0;
 	}
+	if (zram_test_flag(meta, index, ZRAM_WB)) {
+		blk_idx = meta->table[index].handle;
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		return zram_bvec_read_bdev(zram, bvec, blk_idx, offset);
+	}
 	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
 
-	if (is_partial_io(bvec))
-		/* Use  a temporary buffer to decompress the page */
-		uncmem = kmalloc(PAGE_SIZE, GFP_NOIO);
+	if (is_partial_io(bvec)) {
+		/* Use a bounce page to decompress the page */
+		bounce = zram_get_bounce(zram);
+		uncmem = page_address(bounce);
+	}
 
 	user_mem = kmap_atomic(page);
 	if (!is_partial_io(bvec))
 		uncmem = user_mem;
 
-	if (!uncmem) {
-		pr_info("Unable to allocate temp memory\n");
-		ret = -ENOMEM;
-		goto out_cleanup;
-	}
-
 	ret = zram_decompress_page(zram, uncmem, index);
 	/* Should NEVER happen. Return bio error if it does. */
 	if (unlikely(ret))
@@ -441,8 +798,8 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 	ret = 0;
 out_cleanup:
 	kunmap_atomic(user_mem);
-	if (is_partial_io(bvec))
-		kfree(uncmem);
+	if (bounce)
+		zram_put_bounce(zram, bounce);
 	return ret;
 }
 
@@ -452,11 +809,14 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 	int ret = 0;
 	size_t clen;
 	unsigned long handle;
-	struct page *page;
+	struct page *page, *bounce = NULL;
 	unsigned char *user_mem, *cmem, *src, *uncmem = NULL;
 	struct zram_meta *meta = zram->meta;
 	static unsigned long zram_rs_time;
 	struct zcomp_strm *zstrm;
+	struct zram_entry *entry = NULL;
+	bool dup = false;
+	u32 checksum = 0;
 	bool locked = false;
 
 	page = bvec->bv_page;
@@ -465,12 +825,20 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 		 * This is a partial IO. We need to read the full page
 		 * before to write the changes.
 		 */
-		uncmem = kmalloc(PAGE_SIZE, GFP_NOIO);
-		if (!uncmem) {
-			ret = -ENOMEM;
-			goto out;
-		}
-		ret = zram_decompress_page(zram, uncmem, index);
+		unsigned long blk_idx = 0;
+
+		bounce = zram_get_bounce(zram);
+		uncmem = page_address(bounce);
+
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		if (zram_test_flag(meta, index, ZRAM_WB))
+			blk_idx = meta->table[index].handle;
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+		if (blk_idx)
+			ret = read_from_bdev(zram, bounce, blk_idx);
+		else
+			ret = zram_decompress_page(zram, uncmem, index);
 		if (ret)
 			goto out;
 	}
@@ -501,6 +869,22 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 		goto out;
 	}
 
+	if (zram_dedup_enabled(meta)) {
+		entry = zram_dedup_find(zram, zstrm, uncmem, &checksum);
+		if (entry) {
+			if (!is_partial_io(bvec)) {
+				kunmap_atomic(user_mem);
+				user_mem = NULL;
+				uncmem = NULL;
+			}
+			zcomp_strm_release(zram->comp, zstrm);
+			locked = false;
+			dup = true;
+			clen = entry->len;
+			goto found_dup;
+		}
+	}
+
 	ret = zcomp_compress(zram->comp, zstrm, uncmem, &clen);
 	if (!is_partial_io(bvec)) {
 		kunmap_atomic(user_mem);
@@ -542,6 +926,16 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 	locked = false;
 	zs_unmap_object(meta->mem_pool, handle);
 
+	if (zram_dedup_enabled(meta)) {
+		entry = zram_dedup_new(zram, handle, clen, checksum);
+		if (!entry) {
+			zs_free(meta->mem_pool, handle);
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
+found_dup:
 	/*
 	 * Free memory associated with this sector
 	 * before overwriting unused sectors.
@@ -549,18 +943,24 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
 	zram_free_page(zram, index);
 
-	meta->table[index].handle = handle;
+	if (entry)
+		meta->table[index].entry = entry;
+	else
+		meta->table[index].handle = handle;
 	zram_set_obj_size(meta, index, clen);
+	if (clen == PAGE_SIZE)
+		zram_set_flag(meta, index, ZRAM_HUGE);
 	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
 
 	/* Update stats */
-	atomic64_add(clen, &zram->stats.compr_data_size);
+	if (!dup)
+		atomic64_add(clen, &zram->stats.compr_data_size);
 	atomic64_inc(&zram->stats.pages_stored);
 out:
 	if (locked)
 		zcomp_strm_release(zram->comp, zstrm);
-	if (is_partial_io(bvec))
-		kfree(uncmem);
+	if (bounce)
+		zram_put_bounce(zram, bounce);
 	return ret;
 }
 
@@ -571,18 +971,18 @@ static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 	int rw = bio_data_dir(bio);
 
 	if (rw == READ) {
-		atomic64_inc(&zram->stats.num_reads);
+		zram_stat_inc(zram, ZRAM_STAT_NUM_READS);
 		ret = zram_bvec_read(zram, bvec, index, offset, bio);
 	} else {
-		atomic64_inc(&zram->stats.num_writes);
+		zram_stat_inc(zram, ZRAM_STAT_NUM_WRITES);
 		ret = zram_bvec_write(zram, bvec, index, offset);
 	}
 
 	if (unlikely(ret)) {
 		if (rw == READ)
-			atomic64_inc(&zram->stats.failed_reads);
+			zram_stat_inc(zram, ZRAM_STAT_FAILED_READS);
 		else
-			atomic64_inc(&zram->stats.failed_writes);
+			zram_stat_inc(zram, ZRAM_STAT_FAILED_WRITES);
 	}
 
 	return ret;
@@ -641,19 +1041,24 @@ static void zram_reset_device(struct zram *zram, bool reset_capacity)
 	/* Free all pages that are still in this zram device */
 	for (index = 0; index < zram->disksize >> PAGE_SHIFT; index++) {
 		unsigned long handle = meta->table[index].handle;
-		if (!handle)
+		if (!handle || zram_test_flag(meta, index, ZRAM_WB))
 			continue;
 
-		zs_free(meta->mem_pool, handle);
+		if (zram_dedup_enabled(meta))
+			zram_dedup_put(zram, meta->table[index].entry);
+		else
+			zs_free(meta->mem_pool, handle);
 	}
 
 	zcomp_destroy(zram->comp);
-	zram->max_comp_streams = 1;
+	zram->max_comp_streams = default_comp_streams();
 
 	zram_meta_free(zram->meta);
 	zram->meta = NULL;
+	reset_bdev(zram);
 	/* Reset stats */
 	memset(&zram->stats, 0, sizeof(zram->stats));
+	zram_stat_reset(zram);
 
 	zram->disksize = 0;
 	if (reset_capacity)
@@ -670,6 +1075,250 @@ static void zram_reset_device(struct zram *zram, bool reset_capacity)
 		revalidate_disk(zram->disk);
 }
 
+#ifdef CONFIG_ZRAM_WRITEBACK
+static ssize_t backing_dev_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct file *file;
+	char *p;
+	ssize_t ret;
+
+	down_read(&zram->init_lock);
+	file = zram->backing_dev;
+	if (!file) {
+		memcpy(buf, "none\n", 5);
+		up_read(&zram->init_lock);
+		return 5;
+	}
+
+	p = d_path(&file->f_path, buf, PAGE_SIZE - 1);
+	if (IS_ERR(p)) {
+		ret = PTR_ERR(p);
+		goto out;
+	}
+
+	ret = strlen(p);
+	memmove(buf, p, ret);
+	buf[ret++] = '\n';
+out:
+	up_read(&zram->init_lock);
+	return ret;
+}
+
+static ssize_t backing_dev_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	char *file_name;
+	size_t sz;
+	struct file *backing_dev = NULL;
+	struct inode *inode;
+	struct block_device *bdev = NULL;
+	unsigned long nr_pages, *bitmap = NULL;
+	struct zram *zram = dev_to_zram(dev);
+	int err;
+
+	file_name = kmalloc(PATH_MAX, GFP_KERNEL);
+	if (!file_name)
+		return -ENOMEM;
+
+	strlcpy(file_name, buf, PATH_MAX);
+	/* ignore trailing newline */
+	sz = strlen(file_name);
+	if (sz > 0 && file_name[sz - 1] == '\n')
+		file_name[sz - 1] = 0x00;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		pr_info("Can't setup backing device for initialized device\n");
+		err = -EBUSY;
+		goto out;
+	}
+
+	backing_dev = filp_open(file_name, O_RDWR | O_LARGEFILE, 0);
+	if (IS_ERR(backing_dev)) {
+		err = PTR_ERR(backing_dev);
+		backing_dev = NULL;
+		goto out;
+	}
+
+	inode = backing_dev->f_mapping->host;
+
+	/* Support only block device in this moment */
+	if (!S_ISBLK(inode->i_mode)) {
+		err = -ENOTBLK;
+		goto out;
+	}
+
+	bdev = bdgrab(I_BDEV(inode));
+	err = blkdev_get(bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL, zram);
+	if (err < 0) {
+		/* blkdev_get() dropped the reference on failure */
+		bdev = NULL;
+		goto out;
+	}
+
+	nr_pages = i_size_read(inode) >> PAGE_SHIFT;
+	bitmap = vzalloc(BITS_TO_LONGS(nr_pages) * sizeof(long));
+	if (!bitmap) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	reset_bdev(zram);
+
+	zram->bdev = bdev;
+	zram->backing_dev = backing_dev;
+	zram->bitmap = bitmap;
+	zram->nr_pages = nr_pages;
+	up_write(&zram->init_lock);
+
+	pr_info("setup backing device %s\n", file_name);
+	kfree(file_name);
+
+	return len;
+out:
+	vfree(bitmap);
+
+	if (bdev)
+		blkdev_put(bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL);
+
+	if (backing_dev)
+		filp_close(backing_dev, NULL);
+
+	up_write(&zram->init_lock);
+
+	kfree(file_name);
+
+	return err;
+}
+
+/* mark every stored page idle, the next access clears the mark again */
+static ssize_t idle_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct zram_meta *meta;
+	unsigned long nr_pages, index;
+
+	if (!sysfs_streq(buf, "all"))
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		up_read(&zram->init_lock);
+		return -EINVAL;
+	}
+
+	meta = zram->meta;
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < nr_pages; index++) {
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		if (meta->table[index].handle &&
+				!zram_test_flag(meta, index, ZRAM_WB))
+			zram_set_flag(meta, index, ZRAM_IDLE);
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+	}
+
+	up_read(&zram->init_lock);
+
+	return len;
+}
+
+/*
+ * Move "huge" (incompressible) or "idle" pages out to backing_dev.
+ * A page overwritten or freed while its copy is in flight loses
+ * ZRAM_UNDER_WB, in which case the written block is reused.
+ */
+static ssize_t writeback_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct zram_meta *meta;
+	unsigned long nr_pages, index, blk_idx = 0;
+	struct page *page;
+	ssize_t ret = len;
+	int err, flag;
+
+	if (sysfs_streq(buf, "idle"))
+		flag = ZRAM_IDLE;
+	else if (sysfs_streq(buf, "huge"))
+		flag = ZRAM_HUGE;
+	else
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		ret = -EINVAL;
+		goto release_init_lock;
+	}
+
+	if (!zram_wb_enabled(zram)) {
+		ret = -ENODEV;
+		goto release_init_lock;
+	}
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page) {
+		ret = -ENOMEM;
+		goto release_init_lock;
+	}
+
+	meta = zram->meta;
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < nr_pages; index++) {
+		if (!blk_idx) {
+			blk_idx = alloc_block_bdev(zram);
+			if (!blk_idx) {
+				ret = -ENOSPC;
+				break;
+			}
+		}
+
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		if (!meta->table[index].handle ||
+				zram_test_flag(meta, index, ZRAM_ZERO) ||
+				zram_test_flag(meta, index, ZRAM_WB) ||
+				zram_test_flag(meta, index, ZRAM_UNDER_WB) ||
+				!zram_test_flag(meta, index, flag)) {
+			bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+			continue;
+		}
+		zram_set_flag(meta, index, ZRAM_UNDER_WB);
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+		err = zram_decompress_page(zram, page_address(page), index);
+		if (!err)
+			err = zram_bdev_rw(zram, page, blk_idx, WRITE);
+
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		if (err || !zram_test_flag(meta, index, ZRAM_UNDER_WB)) {
+			zram_clear_flag(meta, index, ZRAM_UNDER_WB);
+			bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+			if (err)
+				ret = err;
+			continue;
+		}
+
+		zram_free_page(zram, index);
+		zram_set_flag(meta, index, ZRAM_WB);
+		meta->table[index].handle = blk_idx;
+		blk_idx = 0;
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+		cond_resched();
+	}
+
+	if (blk_idx)
+		free_block_bdev(zram, blk_idx);
+	__free_page(page);
+release_init_lock:
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+#endif
+
 static ssize_t disksize_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
@@ -684,7 +1333,7 @@ static ssize_t disksize_store(struct device *dev,
 		return -EINVAL;
 
 	disksize = PAGE_ALIGN(disksize);
-	meta = zram_meta_alloc(disksize);
+	meta = zram_meta_alloc(disksize, zram->use_dedup);
 	if (!meta)
 		return -ENOMEM;
 
@@ -830,7 +1479,7 @@ static void zram_make_request(struct request_queue *queue, struct bio *bio)
 		goto error;
 
 	if (!valid_io_request(zram, bio)) {
-		atomic64_inc(&zram->stats.invalid_io);
+		zram_stat_inc(zram, ZRAM_STAT_INVALID_IO);
 		goto error;
 	}
 
@@ -858,7 +1507,7 @@ static void zram_slot_free_notify(struct block_device *bdev,
 	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
 	zram_free_page(zram, index);
 	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
-	atomic64_inc(&zram->stats.notify_free);
+	zram_stat_inc(zram, ZRAM_STAT_NOTIFY_FREE);
 }
 
 static const struct block_device_operations zram_devops = {
@@ -872,19 +1521,38 @@ static DEVICE_ATTR(initstate, S_IRUGO, initstate_show, NULL);
 static DEVICE_ATTR(reset, S_IWUSR, NULL, reset_store);
 static DEVICE_ATTR(orig_data_size, S_IRUGO, orig_data_size_show, NULL);
 static DEVICE_ATTR(mem_used_total, S_IRUGO, mem_used_total_show, NULL);
+static DEVICE_ATTR(compact, S_IWUSR, NULL, compact_store);
+static DEVICE_ATTR(pages_compacted, S_IRUGO, pages_compacted_show, NULL);
 static DEVICE_ATTR(max_comp_streams, S_IRUGO | S_IWUSR,
 		max_comp_streams_show, max_comp_streams_store);
 static DEVICE_ATTR(comp_algorithm, S_IRUGO | S_IWUSR,
 		comp_algorithm_show, comp_algorithm_store);
+static DEVICE_ATTR(use_dedup, S_IRUGO | S_IWUSR,
+		use_dedup_show, use_dedup_store);
+#ifdef CONFIG_ZRAM_WRITEBACK
+static DEVICE_ATTR(backing_dev, S_IRUGO | S_IWUSR,
+		backing_dev_show, backing_dev_store);
+static DEVICE_ATTR(idle, S_IWUSR, NULL, idle_store);
+static DEVICE_ATTR(writeback, S_IWUSR, NULL, writeback_store);
+#endif
 
-ZRAM_ATTR_RO(num_reads);
-ZRAM_ATTR_RO(num_writes);
-ZRAM_ATTR_RO(failed_reads);
-ZRAM_ATTR_RO(failed_writes);
-ZRAM_ATTR_RO(invalid_io);
-ZRAM_ATTR_RO(notify_free);
 ZRAM_ATTR_RO(zero_pages);
 ZRAM_ATTR_RO(compr_data_size);
+ZRAM_ATTR_RO(num_migrated);
+ZRAM_ATTR_RO(dedup_hits);
+ZRAM_ATTR_RO(dup_data_size);
+ZRAM_PCPU_ATTR_RO(num_reads, ZRAM_STAT_NUM_READS);
+ZRAM_PCPU_ATTR_RO(num_writes, ZRAM_STAT_NUM_WRITES);
+ZRAM_PCPU_ATTR_RO(failed_reads, ZRAM_STAT_FAILED_READS);
+ZRAM_PCPU_ATTR_RO(failed_writes, ZRAM_STAT_FAILED_WRITES);
+ZRAM_PCPU_ATTR_RO(invalid_io, ZRAM_STAT_INVALID_IO);
+ZRAM_PCPU_ATTR_RO(notify_free, ZRAM_STAT_NOTIFY_FREE);
+ZRAM_PCPU_ATTR_RO(partial_io, ZRAM_STAT_PARTIAL_IO);
+#ifdef CONFIG_ZRAM_WRITEBACK
+ZRAM_ATTR_RO(bd_count);
+ZRAM_ATTR_RO(bd_reads);
+ZRAM_ATTR_RO(bd_writes);
+#endif
 
 static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_disksize.attr,
@@ -897,11 +1565,26 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_invalid_io.attr,
 	&dev_attr_notify_free.attr,
 	&dev_attr_zero_pages.attr,
+	&dev_attr_partial_io.attr,
 	&dev_attr_orig_data_size.attr,
 	&dev_attr_compr_data_size.attr,
 	&dev_attr_mem_used_total.attr,
+	&dev_attr_compact.attr,
+	&dev_attr_pages_compacted.attr,
+	&dev_attr_num_migrated.attr,
 	&dev_attr_max_comp_streams.attr,
 	&dev_attr_comp_algorithm.attr,
+	&dev_attr_use_dedup.attr,
+	&dev_attr_dedup_hits.attr,
+	&dev_attr_dup_data_size.attr,
+#ifdef CONFIG_ZRAM_WRITEBACK
+	&dev_attr_backing_dev.attr,
+	&dev_attr_idle.attr,
+	&dev_attr_writeback.attr,
+	&dev_attr_bd_count.attr,
+	&dev_attr_bd_reads.attr,
+	&dev_attr_bd_writes.attr,
+#endif
 	NULL,
 };
 
@@ -915,11 +1598,25 @@ static int create_device(struct zram *zram, int device_id)
 
 	init_rwsem(&zram->init_lock);
 
+	zram->pcpu_stats = alloc_percpu(struct zram_pcpu_stats);
+	if (!zram->pcpu_stats) {
+		pr_err("Error allocating stats for device %d\n", device_id);
+		goto out;
+	}
+
+	/* one bounce page per cpu covers partial IO from every cpu at once */
+	zram->bounce_pool = mempool_create_page_pool(num_possible_cpus(), 0);
+	if (!zram->bounce_pool) {
+		pr_err("Error allocating bounce pool for device %d\n",
+			device_id);
+		goto out_free_stats;
+	}
+
 	zram->queue = blk_alloc_queue(GFP_KERNEL);
 	if (!zram->queue) {
 		pr_err("Error allocating disk queue for device %d\n",
 			device_id);
-		goto out;
+		goto out_free_pool;
 	}
 
 	blk_queue_make_request(zram->queue, zram_make_request);
@@ -979,7 +1676,7 @@ static int create_device(struct zram *zram, int device_id)
 	}
 	strlcpy(zram->compressor, default_compressor, sizeof(zram->compressor));
 	zram->meta = NULL;
-	zram->max_comp_streams = 1;
+	zram->max_comp_streams = default_comp_streams();
 	return 0;
 
 out_free_disk:
@@ -987,6 +1684,10 @@ out_free_disk:
 	put_disk(zram->disk);
 out_free_queue:
 	blk_cleanup_queue(zram->queue);
+out_free_pool:
+	mempool_destroy(zram->bounce_pool);
+out_free_stats:
+	free_percpu(zram->pcpu_stats);
 out:
 	return ret;
 }
@@ -1000,6 +1701,8 @@ static void destroy_device(struct zram *zram)
 	put_disk(zram->disk);
 
 	blk_cleanup_queue(zram->queue);
+	mempool_destroy(zram->bounce_pool);
+	free_percpu(zram->pcpu_stats);
 }
 
 static int __init zram_init(void)
@@ -17,6 +17,10 @@
 #define _ZRAM_DRV_H_
 
 #include <linux/spinlock.h>
+#include <linux/rbtree.h>
+#include <linux/mempool.h>
+#include <linux/percpu.h>
+#include <linux/u64_stats_sync.h>
 #include <linux/zsmalloc.h>
 
 #include "zcomp.h"
@@ -69,33 +73,82 @@ enum zram_pageflags {
 	/* Page consists entirely of zeros */
 	ZRAM_ZERO = ZRAM_FLAG_SHIFT + 1,
 	ZRAM_ACCESS,	/* page in now accessed */
+	ZRAM_HUGE,	/* page is stored uncompressed */
+	ZRAM_IDLE,	/* not accessed since last marked idle */
+	ZRAM_WB,	/* page is stored on backing_dev, handle is block */
+	ZRAM_UNDER_WB,	/* page is being written to backing_dev */
 
 	__NR_ZRAM_PAGEFLAGS,
 };
 
 /*-- Data structures */
 
+/*
+ * A stored object shared by every disk page with the same content
+ * (only used when deduplication is enabled)
+ */
+struct zram_entry {
+	struct rb_node rb_node;
+	u32 len;
+	u32 checksum;
+	unsigned long refcount;	/* protected by zram_hash.lock */
+	unsigned long handle;
+};
+
+/* Dedup index bucket, entries are sorted by checksum */
+struct zram_hash {
+	spinlock_t lock;
+	struct rb_root rb_root;
+};
+
 /* Allocated for each disk page */
 struct zram_table_entry {
-	unsigned long handle;
+	union {
+		unsigned long handle;
+		struct zram_entry *entry;	/* if zram_dedup_enabled() */
+	};
 	unsigned long value;
 };
 
 struct zram_stats {
 	atomic64_t compr_data_size;	/* compressed size of pages stored */
-	atomic64_t num_reads;	/* failed + successful */
-	atomic64_t num_writes;	/* --do-- */
-	atomic64_t failed_reads;	/* can happen when memory is too low */
-	atomic64_t failed_writes;	/* can happen when memory is too low */
-	atomic64_t invalid_io;	/* non-page-aligned I/O requests */
-	atomic64_t notify_free;	/* no. of swap slot free notifications */
 	atomic64_t zero_pages;		/* no. of zero filled pages */
 	atomic64_t pages_stored;	/* no. of pages currently stored */
+	atomic64_t num_migrated;	/* no. of objects moved by compaction */
+	atomic64_t dedup_hits;	/* no. of writes matching a stored page */
+	atomic64_t dup_data_size;	/* compressed bytes saved by dedup */
+	atomic64_t bd_count;		/* no. of pages in backing device */
+	atomic64_t bd_reads;		/* no. of reads from backing device */
+	atomic64_t bd_writes;		/* no. of writes to backing device */
+};
+
+/*
+ * Event counters bumped on every request. They are kept per cpu so that
+ * IO on different cores does not bounce a shared cache line.
+ */
+enum zram_pcpu_stat_item {
+	ZRAM_STAT_NUM_READS,	/* failed + successful */
+	ZRAM_STAT_NUM_WRITES,	/* --do-- */
+	ZRAM_STAT_FAILED_READS,	/* can happen when memory is too low */
+	ZRAM_STAT_FAILED_WRITES,	/* can happen when memory is too low */
+	ZRAM_STAT_INVALID_IO,	/* non-page-aligned I/O requests */
+	ZRAM_STAT_NOTIFY_FREE,	/* no. of swap slot free notifications */
+	ZRAM_STAT_PARTIAL_IO,	/* no. of requests needing a bounce page */
+	NR_ZRAM_PCPU_STATS,
+};
+
+struct zram_pcpu_stats {
+	u64 count[NR_ZRAM_PCPU_STATS];
+	struct u64_stats_sync syncp;
 };
 
 struct zram_meta {
 	struct zram_table_entry *table;
 	struct zs_pool *mem_pool;
+#ifdef CONFIG_ZRAM_DEDUP
+	struct zram_hash *hash;
+	size_t hash_size;
+#endif
 };
 
 struct zram {
@@ -103,6 +156,7 @@ struct zram {
 	struct request_queue *queue;
 	struct gendisk *disk;
 	struct zcomp *comp;
+	mempool_t *bounce_pool;	/* bounce pages for partial IO */
 
 	/* Prevent concurrent execution of device init, reset and R/W request */
 	struct rw_semaphore init_lock;
@@ -112,7 +166,16 @@ struct zram {
 	 */
 	u64 disksize;	/* bytes */
 	int max_comp_streams;
+	bool use_dedup;
 	struct zram_stats stats;
+	struct zram_pcpu_stats __percpu *pcpu_stats;
 	char compressor[10];
+#ifdef CONFIG_ZRAM_WRITEBACK
+	/* set through backing_dev before init, protected by init_lock */
+	struct file *backing_dev;
+	struct block_device *bdev;
+	unsigned long *bitmap;	/* allocated blocks of bdev */
+	unsigned long nr_pages;	/* size of bdev in pages */
+#endif
 };
 #endif
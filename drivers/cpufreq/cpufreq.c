@@ -29,8 +29,12 @@
 #include <linux/completion.h>
 #include <linux/mutex.h>
 #include <linux/syscore_ops.h>
+#include <linux/pm_qos_params.h>
+#include <linux/workqueue.h>
+#include <linux/ram_trace.h>
 
 #include <trace/events/power.h>
+#include <trace/events/dvfs.h>
 
 #if defined(CONFIG_CPU_FREQ) && defined(CONFIG_ARCH_EXYNOS4)
 #define CONFIG_DVFS_LIMIT
@@ -288,8 +292,12 @@ void cpufreq_notify_transition(struct cpufreq_freqs *freqs, unsigned int state)
 		trace_cpu_frequency(freqs->new, freqs->cpu);
 		srcu_notifier_call_chain(&cpufreq_transition_notifier_list,
 				CPUFREQ_POSTCHANGE, freqs);
-		if (likely(policy) && likely(policy->cpu == freqs->cpu))
+		if (likely(policy) && likely(policy->cpu == freqs->cpu)) {
+			/* once per policy, not for every cpu that follows it */
+			ram_trace_log(RAM_TRACE_CPUFREQ, freqs->cpu,
+				      freqs->old, freqs->new);
 			policy->cur = freqs->new;
+		}
 		break;
 	}
 }
@@ -1520,14 +1528,21 @@ int __cpufreq_driver_target(struct cpufreq_policy *policy,
 			    unsigned int relation)
 {
 	int retval = -EINVAL;
+	unsigned int old_freq = policy->cur;
+	ktime_t start;
 
 	if (cpufreq_disabled())
 		return -ENODEV;
 
 	pr_debug("target for CPU %u: %u kHz, relation %u\n", policy->cpu,
 		target_freq, relation);
-	if (cpu_online(policy->cpu) && cpufreq_driver->target)
+	if (cpu_online(policy->cpu) && cpufreq_driver->target) {
+		start = ktime_get();
 		retval = cpufreq_driver->target(policy, target_freq, relation);
+		trace_dvfs_freq_change(policy->cpu, target_freq, old_freq,
+				policy->cur, retval,
+				ktime_to_us(ktime_sub(ktime_get(), start)));
+	}
 
 	return retval;
 }
@@ -1989,6 +2004,59 @@ int cpufreq_unregister_driver(struct cpufreq_driver *driver)
 }
 EXPORT_SYMBOL_GPL(cpufreq_unregister_driver);
 
+/*
+ * PM_QOS_CPU_FREQ_MIN and PM_QOS_CPU_FREQ_MAX bound every policy on top of
+ * the user limits. A floor above the ceiling gives way to the ceiling, so
+ * a thermal cap always wins over a boost.
+ */
+static int cpufreq_qos_policy_notifier(struct notifier_block *nb,
+				       unsigned long val, void *data)
+{
+	struct cpufreq_policy *policy = data;
+	unsigned int min, max;
+
+	if (val != CPUFREQ_ADJUST)
+		return NOTIFY_DONE;
+
+	max = pm_qos_request(PM_QOS_CPU_FREQ_MAX);
+	min = min_t(unsigned int, pm_qos_request(PM_QOS_CPU_FREQ_MIN), max);
+	cpufreq_verify_within_limits(policy, min, max);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block cpufreq_qos_policy_nb = {
+	.notifier_call = cpufreq_qos_policy_notifier,
+};
+
+static void cpufreq_qos_work_fn(struct work_struct *work)
+{
+	unsigned int cpu;
+
+	get_online_cpus();
+	for_each_online_cpu(cpu)
+		cpufreq_update_policy(cpu);
+	put_online_cpus();
+}
+
+static DECLARE_WORK(cpufreq_qos_work, cpufreq_qos_work_fn);
+
+/* requests may come from atomic context, the policies are updated later */
+static int cpufreq_qos_notifier(struct notifier_block *nb,
+				unsigned long val, void *data)
+{
+	schedule_work(&cpufreq_qos_work);
+	return NOTIFY_OK;
+}
+
+static struct notifier_block cpufreq_qos_min_nb = {
+	.notifier_call = cpufreq_qos_notifier,
+};
+
+static struct notifier_block cpufreq_qos_max_nb = {
+	.notifier_call = cpufreq_qos_notifier,
+};
+
 static int __init cpufreq_core_init(void)
 {
 	int cpu;
@@ -2005,6 +2073,11 @@ static int __init cpufreq_core_init(void)
 	BUG_ON(!cpufreq_global_kobject);
 	register_syscore_ops(&cpufreq_syscore_ops);
 
+	cpufreq_register_notifier(&cpufreq_qos_policy_nb,
+				  CPUFREQ_POLICY_NOTIFIER);
+	pm_qos_add_notifier(PM_QOS_CPU_FREQ_MIN, &cpufreq_qos_min_nb);
+	pm_qos_add_notifier(PM_QOS_CPU_FREQ_MAX, &cpufreq_qos_max_nb);
+
 	return 0;
 }
 core_initcall(cpufreq_core_init);
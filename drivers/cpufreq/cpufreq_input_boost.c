@@ -0,0 +1,246 @@
+/*
+ * drivers/cpufreq/cpufreq_input_boost.c
+ *
+ * Frequency floor and minimum online cpus on touch and key input.
+ *
+ * A touch-down or key press raises every participating policy to freq
+ * straight away and keeps cpus online for ms milliseconds; further input
+ * extends the boost. Governors read the floor through
+ * cpufreq_input_boost_freq() so that none of them drops below it on its
+ * next sample, which leaves no gap between the input event and the first
+ * frame for userspace boosters to fill.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/cpufreq_input_boost.h>
+#include <linux/cpumask.h>
+#include <linux/exynos_hotplug.h>
+#include <linux/init.h>
+#include <linux/input.h>
+#include <linux/jiffies.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+static unsigned int boost_freq = 800000;
+module_param_named(freq, boost_freq, uint, 0644);
+MODULE_PARM_DESC(freq, "frequency floor in kHz while boosted, 0 for none");
+
+static unsigned int boost_ms = 200;
+module_param_named(ms, boost_ms, uint, 0644);
+MODULE_PARM_DESC(ms, "boost duration after the last input event");
+
+static unsigned int boost_cpus = 2;
+module_param_named(cpus, boost_cpus, uint, 0644);
+MODULE_PARM_DESC(cpus, "minimum online cpus while boosted, 0 for none");
+
+static struct workqueue_struct *input_boost_wq;
+static struct work_struct input_boost_start_work;
+static struct delayed_work input_boost_end_work;
+
+/* policies whose governor honours the boost, by policy->cpu */
+static struct cpumask boost_policies;
+
+static unsigned long boost_expires;
+static unsigned int boost_floor;
+static bool boost_active;
+
+void cpufreq_input_boost_start(struct cpufreq_policy *policy)
+{
+	cpumask_set_cpu(policy->cpu, &boost_policies);
+}
+EXPORT_SYMBOL_GPL(cpufreq_input_boost_start);
+
+void cpufreq_input_boost_stop(struct cpufreq_policy *policy)
+{
+	cpumask_clear_cpu(policy->cpu, &boost_policies);
+}
+EXPORT_SYMBOL_GPL(cpufreq_input_boost_stop);
+
+unsigned int cpufreq_input_boost_freq(void)
+{
+	return ACCESS_ONCE(boost_floor);
+}
+EXPORT_SYMBOL_GPL(cpufreq_input_boost_freq);
+
+static void input_boost_raise(unsigned int freq)
+{
+	struct cpufreq_policy *policy;
+	int cpu;
+
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		if (!cpumask_test_cpu(cpu, &boost_policies))
+			continue;
+
+		policy = cpufreq_cpu_get(cpu);
+		if (!policy)
+			continue;
+
+		if (policy->cur < freq)
+			cpufreq_driver_target(policy, min(freq, policy->max),
+					      CPUFREQ_RELATION_L);
+		cpufreq_cpu_put(policy);
+	}
+	put_online_cpus();
+}
+
+static void input_boost_start_fn(struct work_struct *work)
+{
+	unsigned int freq = boost_freq;
+
+	if (boost_active)
+		return;
+
+	boost_active = true;
+	ACCESS_ONCE(boost_floor) = freq;
+	exynos_hotplug_boost(boost_cpus);
+	if (freq)
+		input_boost_raise(freq);
+
+	queue_delayed_work(input_boost_wq, &input_boost_end_work,
+			   msecs_to_jiffies(boost_ms));
+}
+
+static void input_boost_end_fn(struct work_struct *work)
+{
+	long left = (long)(ACCESS_ONCE(boost_expires) - jiffies);
+
+	if (left > 0) {
+		queue_delayed_work(input_boost_wq, &input_boost_end_work,
+				   left);
+		return;
+	}
+
+	ACCESS_ONCE(boost_floor) = 0;
+	exynos_hotplug_boost(0);
+	boost_active = false;
+
+	/* pairs with input_boost_event(): input that saw us still active */
+	smp_mb();
+	if (time_before(jiffies, ACCESS_ONCE(boost_expires)))
+		queue_work(input_boost_wq, &input_boost_start_work);
+}
+
+static void input_boost_event(struct input_handle *handle,
+		unsigned int type, unsigned int code, int value)
+{
+	if (!boost_ms || (!boost_freq && !boost_cpus))
+		return;
+
+	/* boost on presses and touch movement, not on releases */
+	if (type == EV_KEY) {
+		if (!value)
+			return;
+	} else if (type == EV_ABS) {
+		if (code == ABS_MT_TRACKING_ID && value < 0)
+			return;
+	} else {
+		return;
+	}
+
+	ACCESS_ONCE(boost_expires) = jiffies + msecs_to_jiffies(boost_ms);
+
+	smp_mb();
+	if (!ACCESS_ONCE(boost_active))
+		queue_work(input_boost_wq, &input_boost_start_work);
+}
+
+static int input_boost_connect(struct input_handler *handler,
+		struct input_dev *dev, const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "cpufreq_input_boost";
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err2;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err1;
+
+	return 0;
+err1:
+	input_unregister_handle(handle);
+err2:
+	kfree(handle);
+	return error;
+}
+
+static void input_boost_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id input_boost_ids[] = {
+	/* multi-touch touchscreen */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			BIT_MASK(ABS_MT_POSITION_X) |
+			BIT_MASK(ABS_MT_POSITION_Y) },
+	},
+	/* touchpad */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_KEYBIT |
+			INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
+		.absbit = { [BIT_WORD(ABS_X)] =
+			BIT_MASK(ABS_X) | BIT_MASK(ABS_Y) },
+	},
+	/* Keypad */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
+		.evbit = { BIT_MASK(EV_KEY) },
+	},
+	{ },
+};
+
+static struct input_handler input_boost_handler = {
+	.event		= input_boost_event,
+	.connect	= input_boost_connect,
+	.disconnect	= input_boost_disconnect,
+	.name		= "cpufreq_input_boost",
+	.id_table	= input_boost_ids,
+};
+
+static int __init cpufreq_input_boost_init(void)
+{
+	int ret;
+
+	input_boost_wq = alloc_ordered_workqueue("input_boost", WQ_HIGHPRI);
+	if (!input_boost_wq)
+		return -ENOMEM;
+
+	INIT_WORK(&input_boost_start_work, input_boost_start_fn);
+	INIT_DELAYED_WORK(&input_boost_end_work, input_boost_end_fn);
+
+	ret = input_register_handler(&input_boost_handler);
+	if (ret) {
+		pr_err("%s: failed to register input handler: %d\n",
+		       __func__, ret);
+		destroy_workqueue(input_boost_wq);
+		input_boost_wq = NULL;
+	}
+
+	return ret;
+}
+late_initcall(cpufreq_input_boost_init);
@@ -20,9 +20,12 @@
 #include <linux/cpufreq.h>
 #include <linux/cpu.h>
 #include <linux/cpumask.h>
+#include <linux/cpufreq_input_boost.h>
+#include <linux/exynos_hotplug.h>
 #include <linux/jiffies.h>
 #include <linux/kernel_stat.h>
 #include <linux/mutex.h>
+#include <linux/pm_qos_params.h>
 #include <linux/hrtimer.h>
 #include <linux/tick.h>
 #include <linux/ktime.h>
@@ -30,6 +33,7 @@
 #include <linux/slab.h>
 #include <linux/suspend.h>
 #include <linux/reboot.h>
+#include <trace/events/dvfs.h>
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
 #include <linux/earlysuspend.h>
@@ -40,108 +44,22 @@
  * runqueue average
  */
 
-#define RQ_AVG_TIMER_RATE	10
-
 #ifdef CONFIG_CPU_FREQ_PEGASUSQ_ENHANCEMENTS
 int pegasusq_cpu_cores_lock = 0;
 #endif
 
-struct runqueue_data {
-	unsigned int nr_run_avg;
-	unsigned int update_rate;
-	int64_t last_time;
-	int64_t total_time;
-	struct delayed_work work;
-	struct workqueue_struct *nr_run_wq;
-	spinlock_t lock;
-};
-
-static struct runqueue_data *rq_data;
-static void rq_work_fn(struct work_struct *work);
-
-static void start_rq_work(void)
-{
-	rq_data->nr_run_avg = 0;
-	rq_data->last_time = 0;
-	rq_data->total_time = 0;
-	if (rq_data->nr_run_wq == NULL)
-		rq_data->nr_run_wq =
-			create_singlethread_workqueue("nr_run_avg");
-
-	queue_delayed_work(rq_data->nr_run_wq, &rq_data->work,
-			   msecs_to_jiffies(rq_data->update_rate));
-	return;
-}
-
-static void stop_rq_work(void)
-{
-	if (rq_data->nr_run_wq)
-		cancel_delayed_work(&rq_data->work);
-	return;
-}
+static struct sched_nr_snapshot nr_run_snap;
 
-static int __init init_rq_avg(void)
+static void reset_nr_run_avg(void)
 {
-	rq_data = kzalloc(sizeof(struct runqueue_data), GFP_KERNEL);
-	if (rq_data == NULL) {
-		pr_err("%s cannot allocate memory\n", __func__);
-		return -ENOMEM;
-	}
-	spin_lock_init(&rq_data->lock);
-	rq_data->update_rate = RQ_AVG_TIMER_RATE;
-	INIT_DELAYED_WORK_DEFERRABLE(&rq_data->work, rq_work_fn);
-
-	return 0;
-}
-
-static void rq_work_fn(struct work_struct *work)
-{
-	int64_t time_diff = 0;
-	int64_t nr_run = 0;
-	unsigned long flags = 0;
-	int64_t cur_time = ktime_to_ns(ktime_get());
-
-	spin_lock_irqsave(&rq_data->lock, flags);
-
-	if (rq_data->last_time == 0)
-		rq_data->last_time = cur_time;
-	if (rq_data->nr_run_avg == 0)
-		rq_data->total_time = 0;
-
-	nr_run = nr_running() * 100;
-	time_diff = cur_time - rq_data->last_time;
-	do_div(time_diff, 1000 * 1000);
-
-	if (time_diff != 0 && rq_data->total_time != 0) {
-		nr_run = (nr_run * time_diff) +
-			(rq_data->nr_run_avg * rq_data->total_time);
-		do_div(nr_run, rq_data->total_time + time_diff);
-	}
-	rq_data->nr_run_avg = nr_run;
-	rq_data->total_time += time_diff;
-	rq_data->last_time = cur_time;
-
-	if (rq_data->update_rate != 0)
-		queue_delayed_work(rq_data->nr_run_wq, &rq_data->work,
-				   msecs_to_jiffies(rq_data->update_rate));
-
-	spin_unlock_irqrestore(&rq_data->lock, flags);
+	sched_nr_running_snapshot(-1, &nr_run_snap);
 }
 
 static unsigned int get_nr_run_avg(void)
 {
-	unsigned int nr_run_avg;
-	unsigned long flags = 0;
-
-	spin_lock_irqsave(&rq_data->lock, flags);
-	nr_run_avg = rq_data->nr_run_avg;
-	rq_data->nr_run_avg = 0;
-	spin_unlock_irqrestore(&rq_data->lock, flags);
-
-	return nr_run_avg;
+	return sched_nr_running_avg(-1, &nr_run_snap);
 }
 
-
 /*
  * dbs is used in this file as a shortform for demandbased switching
  * It helps to keep variable names smaller, simpler
@@ -326,6 +244,14 @@ static struct dbs_tuners {
 };
 
 
+/* the sysfs min_cpu_lock or the PM_QOS_CPU_ONLINE_MIN requests if higher */
+static unsigned int get_min_cpu_lock(void)
+{
+	return max_t(unsigned int, dbs_tuners_ins.min_cpu_lock,
+		     min_t(unsigned int, num_possible_cpus(),
+			   pm_qos_request(PM_QOS_CPU_ONLINE_MIN)));
+}
+
 /*
  * CPU hotplug lock interface
  */
@@ -374,6 +300,7 @@ int cpufreq_pegasusq_cpu_lock(int num_core)
 	atomic_set(&g_hotplug_lock, num_core);
 	atomic_set(&g_hotplug_count, 1);
 	apply_hotplug_lock();
+	exynos_hotplug_lock(num_core);
 
 	return 0;
 }
@@ -389,6 +316,7 @@ int cpufreq_pegasusq_cpu_unlock(int num_core)
 
 	if (atomic_read(&g_hotplug_count) == 0)
 		atomic_set(&g_hotplug_lock, 0);
+	exynos_hotplug_unlock(num_core);
 
 	return 0;
 }
@@ -399,6 +327,7 @@ void cpufreq_pegasusq_min_cpu_lock(unsigned int num_core)
 	struct cpu_dbs_info_s *dbs_info;
 
 	dbs_tuners_ins.min_cpu_lock = min(num_core, num_possible_cpus());
+	exynos_hotplug_min_lock(num_core);
 
 	dbs_info = &per_cpu(od_cpu_dbs_info, 0); /* from CPU0 */
 	online = num_online_cpus();
@@ -414,6 +343,7 @@ void cpufreq_pegasusq_min_cpu_unlock(void)
 	struct cpu_dbs_info_s *dbs_info;
 
 	dbs_tuners_ins.min_cpu_lock = 0;
+	exynos_hotplug_min_unlock();
 
 	dbs_info = &per_cpu(od_cpu_dbs_info, 0); /* from CPU0 */
 	online = num_online_cpus();
@@ -1073,7 +1003,7 @@ static void cpu_up_work(struct work_struct *work)
 	int cpu;
 	int online = num_online_cpus();
 	int nr_up = dbs_tuners_ins.up_nr_cpus;
-	int min_cpu_lock = dbs_tuners_ins.min_cpu_lock;
+	int min_cpu_lock = get_min_cpu_lock();
 #ifdef CONFIG_CPU_FREQ_GOV_PEGASUSQ_BOOST
 	int boost_mincpus = dbs_tuners_ins.boost_mincpus;
 #endif
@@ -1101,7 +1031,7 @@ do_up_work:
 #endif
 	if (online == 1) {
 		printk(KERN_ERR "CPU_UP 3\n");
-		cpu_up(num_possible_cpus() - 1);
+		exynos_hotplug_cpu_up(num_possible_cpus() - 1);
 		nr_up -= 1;
 	}
 
@@ -1111,7 +1041,7 @@ do_up_work:
 		if (cpu == 0)
 			continue;
 		printk(KERN_ERR "CPU_UP %d\n", cpu);
-		cpu_up(cpu);
+		exynos_hotplug_cpu_up(cpu);
 	}
 }
 
@@ -1134,7 +1064,7 @@ static void cpu_down_work(struct work_struct *work)
 		if (cpu == 0)
 			continue;
 		printk(KERN_ERR "CPU_DOWN %d\n", cpu);
-		cpu_down(cpu);
+		exynos_hotplug_cpu_down(cpu);
 		if (--nr_down == 0)
 			break;
 	}
@@ -1198,8 +1128,7 @@ static int check_up(void)
 		&& online >= dbs_tuners_ins.max_cpu_lock)
 		return 0;
 
-	if (dbs_tuners_ins.min_cpu_lock != 0
-		&& online < dbs_tuners_ins.min_cpu_lock)
+	if (online < get_min_cpu_lock())
 		return 1;
 
 #ifdef CONFIG_CPU_FREQ_GOV_PEGASUSQ_BOOST
@@ -1224,6 +1153,11 @@ static int check_up(void)
 			debug_hotplug_check(1, rq_avg, freq, usage);
 	}
 
+	trace_dvfs_hotplug_check("pegasusq", online, min_freq, up_freq,
+				 min_rq_avg, up_rq,
+				 min_freq >= up_freq && min_rq_avg > up_rq ?
+				 DVFS_UP : DVFS_HOLD);
+
 	if (min_freq >= up_freq && min_rq_avg > up_rq) {
 		printk(KERN_ERR "[HOTPLUG IN] %s %d>=%d && %d>%d\n",
 			__func__, min_freq, up_freq, min_rq_avg, up_rq);
@@ -1273,8 +1207,7 @@ static int check_down(void)
 		&& online > dbs_tuners_ins.max_cpu_lock)
 		return 1;
 
-	if (dbs_tuners_ins.min_cpu_lock != 0
-		&& online <= dbs_tuners_ins.min_cpu_lock)
+	if (online <= get_min_cpu_lock())
 		return 0;
 
 	if (num_hist == 0 || num_hist % down_rate)
@@ -1293,6 +1226,11 @@ static int check_down(void)
 			debug_hotplug_check(0, rq_avg, freq, usage);
 	}
 
+	trace_dvfs_hotplug_check("pegasusq", online, max_freq, down_freq,
+				 max_rq_avg, down_rq,
+				 max_freq <= down_freq && max_rq_avg <= down_rq ?
+				 DVFS_DOWN : DVFS_HOLD);
+
 	if (max_freq <= down_freq && max_rq_avg <= down_rq) {
 		printk(KERN_ERR "[HOTPLUG OUT] %s %d<=%d && %d<%d\n",
 			__func__, max_freq, down_freq, max_rq_avg, down_rq);
@@ -1303,8 +1241,21 @@ static int check_down(void)
 	return 0;
 }
 
+/* the lowest frequency allowed right now by boost_lock_time and input */
+static unsigned int boost_floor(struct cpufreq_policy *policy)
+{
+	unsigned int floor = cpufreq_input_boost_freq();
+
+#ifdef CONFIG_CPU_FREQ_GOV_PEGASUSQ_BOOST
+	if (is_boosting)
+		floor = max(floor, dbs_tuners_ins.boost_freq);
+#endif
+	return min(floor, policy->max);
+}
+
 static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 {
+	unsigned int floor;
 	unsigned int max_load_freq;
 
 	struct cpufreq_policy *policy;
@@ -1401,19 +1352,18 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 		up_threshold = up_threshold_at_min_freq;
 	}
 
-#ifdef CONFIG_CPU_FREQ_GOV_PEGASUSQ_BOOST
-	if (is_boosting && policy->cur < dbs_tuners_ins.boost_freq) {
-		/* disallow boosting beyond max freq */
-		int target = min(policy->max, dbs_tuners_ins.boost_freq);
-		dbs_tuners_ins.boost_freq = target;
+	floor = boost_floor(policy);
+	if (policy->cur < floor) {
 		/* If switching to max speed, apply sampling_down_factor */
-		if (policy->cur < policy->max && target == policy->max)
+		if (floor == policy->max)
 			this_dbs_info->rate_mult =
 				dbs_tuners_ins.sampling_down_factor;
-		dbs_freq_increase(policy, target);
+		trace_dvfs_governor("pegasusq", policy->cpu,
+				    max_load_freq / policy->cur, policy->cur,
+				    floor, up_threshold, DVFS_BOOST);
+		dbs_freq_increase(policy, floor);
 		return;
 	}
-#endif
 
 	if (max_load_freq > up_threshold * policy->cur) {
 		int inc = (policy->max * dbs_tuners_ins.freq_step) / 100;
@@ -1422,6 +1372,9 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 		if (policy->cur < policy->max && target == policy->max)
 			this_dbs_info->rate_mult =
 				dbs_tuners_ins.sampling_down_factor;
+		trace_dvfs_governor("pegasusq", policy->cpu,
+				    max_load_freq / policy->cur, policy->cur,
+				    target, up_threshold, DVFS_UP);
 		dbs_freq_increase(policy, target);
 		return;
 	}
@@ -1433,11 +1386,9 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 		return;
 #endif
 
-#ifdef CONFIG_CPU_FREQ_GOV_PEGASUSQ_BOOST
-	/* don't bother trying to downclock below boost_freq */
-	if (is_boosting && policy->cur <= dbs_tuners_ins.boost_freq)
+	/* don't bother trying to downclock below the boost floor */
+	if (floor && policy->cur <= floor)
 		return;
-#endif
 
 	/*
 	 * The optimal frequency is the frequency that is the lowest that
@@ -1469,11 +1420,14 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 			&& (max_load_freq / freq_next) > down_thres)
 			freq_next = freq_for_responsiveness;
 
-#ifdef CONFIG_CPU_FREQ_GOV_PEGASUSQ_BOOST
-		if (is_boosting)
-			freq_next = max(freq_next, dbs_tuners_ins.boost_freq);
+		freq_next = max(freq_next, floor);
 
-#endif
+		trace_dvfs_governor("pegasusq", policy->cpu,
+				    max_load_freq / policy->cur, policy->cur,
+				    freq_next, up_threshold -
+				    dbs_tuners_ins.down_differential,
+				    policy->cur == freq_next ?
+				    DVFS_HOLD : DVFS_DOWN);
 
 		if (policy->cur == freq_next)
 			return;
@@ -1493,14 +1447,9 @@ static void do_dbs_timer(struct work_struct *work)
 	mutex_lock(&dbs_info->timer_mutex);
 
 	dbs_check_cpu(dbs_info);
-	/* We want all CPUs to do sampling nearly on
-	 * same jiffy
-	 */
-	delay = usecs_to_jiffies(dbs_tuners_ins.sampling_rate
-				 * dbs_info->rate_mult);
-
-	if (num_online_cpus() > 1)
-		delay -= jiffies % delay;
+	/* We want all CPUs, and the other samplers, on the same jiffy */
+	delay = align_jiffies_relative(usecs_to_jiffies(
+			dbs_tuners_ins.sampling_rate * dbs_info->rate_mult));
 
 	queue_delayed_work_on(cpu, dvfs_workqueue, &dbs_info->work, delay);
 	mutex_unlock(&dbs_info->timer_mutex);
@@ -1584,10 +1533,8 @@ static void cpufreq_pegasusq_early_suspend(struct early_suspend *h)
 	dbs_tuners_ins.freq_step = 20;
 	dbs_tuners_ins.sampling_rate *= 4;
 #if EARLYSUSPEND_HOTPLUGLOCK
-	atomic_set(&g_hotplug_lock,
-	    (dbs_tuners_ins.min_cpu_lock) ? dbs_tuners_ins.min_cpu_lock : 1);
+	atomic_set(&g_hotplug_lock, max(get_min_cpu_lock(), 1U));
 	apply_hotplug_lock();
-	stop_rq_work();
 #endif
 }
 static void cpufreq_pegasusq_late_resume(struct early_suspend *h)
@@ -1600,7 +1547,7 @@ static void cpufreq_pegasusq_late_resume(struct early_suspend *h)
 	dbs_tuners_ins.sampling_rate = prev_sampling_rate;
 #if EARLYSUSPEND_HOTPLUGLOCK
 	apply_hotplug_lock();
-	start_rq_work();
+	reset_nr_run_avg();
 #endif
 }
 #endif
@@ -1623,7 +1570,7 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 		dbs_tuners_ins.max_freq = policy->max;
 		dbs_tuners_ins.min_freq = policy->min;
 		hotplug_history->num_hist = 0;
-		start_rq_work();
+		reset_nr_run_avg();
 
 		mutex_lock(&dbs_mutex);
 
@@ -1657,9 +1604,12 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 			min_sampling_rate = MIN_SAMPLING_RATE;
 			dbs_tuners_ins.sampling_rate = DEF_SAMPLING_RATE;
 			dbs_tuners_ins.io_is_busy = 0;
+			exynos_hotplug_governor_start();
 		}
 		mutex_unlock(&dbs_mutex);
 
+		cpufreq_input_boost_start(policy);
+
 		register_reboot_notifier(&reboot_notifier);
 
 		mutex_init(&this_dbs_info->timer_mutex);
@@ -1681,6 +1631,7 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 		unregister_pm_notifier(&pm_notifier);
 #endif
 
+		cpufreq_input_boost_stop(policy);
 		dbs_timer_exit(this_dbs_info);
 
 		mutex_lock(&dbs_mutex);
@@ -1691,11 +1642,11 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 		dbs_enable--;
 		mutex_unlock(&dbs_mutex);
 
-		stop_rq_work();
-
-		if (!dbs_enable)
+		if (!dbs_enable) {
 			sysfs_remove_group(cpufreq_global_kobject,
 					   &dbs_attr_group);
+			exynos_hotplug_governor_stop();
+		}
 
 		break;
 
@@ -1721,15 +1672,10 @@ static int __init cpufreq_gov_dbs_init(void)
 {
 	int ret;
 
-	ret = init_rq_avg();
-	if (ret)
-		return ret;
-
 	hotplug_history = kzalloc(sizeof(struct cpu_usage_history), GFP_KERNEL);
 	if (!hotplug_history) {
 		pr_err("%s cannot create hotplug history array\n", __func__);
-		ret = -ENOMEM;
-		goto err_hist;
+		return -ENOMEM;
 	}
 
 	dvfs_workqueue = create_workqueue("kpegasusq");
@@ -1755,8 +1701,6 @@ err_reg:
 	destroy_workqueue(dvfs_workqueue);
 err_queue:
 	kfree(hotplug_history);
-err_hist:
-	kfree(rq_data);
 	return ret;
 }
 
@@ -1765,7 +1709,6 @@ static void __exit cpufreq_gov_dbs_exit(void)
 	cpufreq_unregister_governor(&cpufreq_gov_pegasusq);
 	destroy_workqueue(dvfs_workqueue);
 	kfree(hotplug_history);
-	kfree(rq_data);
 }
 
 MODULE_AUTHOR("ByungChang Cha <bc.cha@samsung.com>");
@@ -18,20 +18,28 @@
 #include <linux/jiffies.h>
 #include <linux/percpu.h>
 #include <linux/kobject.h>
-#include <linux/spinlock.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/seqlock.h>
 #include <linux/notifier.h>
+#include <linux/cpufreq_task_stats.h>
+#include <linux/seq_file.h>
 #include <asm/cputime.h>
 
-static spinlock_t cpufreq_stats_lock;
-
 #define CPUFREQ_STATDEVICE_ATTR(_name, _mode, _show) \
 static struct freq_attr _attr_##_name = {\
 	.attr = {.name = __stringify(_name), .mode = _mode, }, \
 	.show = _show,\
 };
 
+/*
+ * Only the transition notifier of a policy writes its stats, under @lock.
+ * Readers retry instead of taking the lock and add the time spent in the
+ * current state themselves, so reading never stalls a transition.
+ */
 struct cpufreq_stats {
 	unsigned int cpu;
+	seqlock_t lock;
 	unsigned int total_trans;
 	unsigned long long  last_time;
 	unsigned int max_state;
@@ -42,6 +50,10 @@ struct cpufreq_stats {
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	unsigned int *trans_table;
 #endif
+#ifdef CONFIG_CPU_FREQ_STAT_TASK
+	struct cpumask related_cpus;
+	unsigned int *task_index;
+#endif
 };
 
 static DEFINE_PER_CPU(struct cpufreq_stats *, cpufreq_stats_table);
@@ -51,21 +63,112 @@ struct cpufreq_stats_attribute {
 	ssize_t(*show) (struct cpufreq_stats *, char *);
 };
 
-static int cpufreq_stats_update(unsigned int cpu)
+#ifdef CONFIG_CPU_FREQ_STAT_TASK
+#define CPUFREQ_TASK_MAX_FREQS	64
+
+/* published entries never change; all_freqs_count only grows */
+static DEFINE_MUTEX(all_freqs_mutex);
+static unsigned int all_freqs[CPUFREQ_TASK_MAX_FREQS];
+static unsigned int all_freqs_count;
+
+/* index into all_freqs of the frequency each cpu runs at, or -1 */
+static DEFINE_PER_CPU(int, task_freq_index) = -1;
+
+unsigned int cpufreq_task_stats_nr_freqs(void)
 {
-	struct cpufreq_stats *stat;
-	unsigned long long cur_time;
+	return ACCESS_ONCE(all_freqs_count);
+}
+EXPORT_SYMBOL_GPL(cpufreq_task_stats_nr_freqs);
 
-	cur_time = get_jiffies_64();
-	spin_lock(&cpufreq_stats_lock);
-	stat = per_cpu(cpufreq_stats_table, cpu);
-	if (stat->time_in_state)
-		stat->time_in_state[stat->last_index] +=
-			cur_time - stat->last_time;
-	stat->last_time = cur_time;
-	spin_unlock(&cpufreq_stats_lock);
+unsigned int cpufreq_task_stats_freq(unsigned int index)
+{
+	return index < cpufreq_task_stats_nr_freqs() ? all_freqs[index] : 0;
+}
+EXPORT_SYMBOL_GPL(cpufreq_task_stats_freq);
+
+static unsigned int all_freqs_get_index(unsigned int freq)
+{
+	unsigned int i;
+
+	mutex_lock(&all_freqs_mutex);
+	for (i = 0; i < all_freqs_count; i++)
+		if (all_freqs[i] == freq)
+			goto out;
+
+	if (i < CPUFREQ_TASK_MAX_FREQS) {
+		all_freqs[i] = freq;
+		smp_wmb();
+		all_freqs_count = i + 1;
+	}
+out:
+	mutex_unlock(&all_freqs_mutex);
+	return i;
+}
+
+static void task_freq_index_set(struct cpufreq_stats *stat, int index)
+{
+	int cpu, task_index = -1;
+
+	if (index >= 0 && stat->task_index[index] < CPUFREQ_TASK_MAX_FREQS)
+		task_index = stat->task_index[index];
+
+	for_each_cpu(cpu, &stat->related_cpus)
+		per_cpu(task_freq_index, cpu) = task_index;
+}
+
+void cpufreq_task_stats_init(struct task_struct *p)
+{
+	p->time_in_state = NULL;
+	p->max_state = 0;
+}
+
+void cpufreq_task_stats_alloc(struct task_struct *p)
+{
+	unsigned int max_state = cpufreq_task_stats_nr_freqs();
+
+	if (!max_state)
+		return;
+
+	p->time_in_state = kcalloc(max_state, sizeof(cputime_t), GFP_KERNEL);
+	if (p->time_in_state)
+		p->max_state = max_state;
+}
+
+void cpufreq_task_stats_free(struct task_struct *p)
+{
+	kfree(p->time_in_state);
+	p->time_in_state = NULL;
+	p->max_state = 0;
+}
+
+int cpufreq_task_stats_index(unsigned int cpu)
+{
+	return per_cpu(task_freq_index, cpu);
+}
+
+void cpufreq_task_stats_account(struct task_struct *p, cputime_t cputime)
+{
+	int index = cpufreq_task_stats_index(task_cpu(p));
+
+	if (index >= 0 && index < p->max_state)
+		p->time_in_state[index] += cputime;
+}
+
+int proc_time_in_state_show(struct seq_file *m, struct pid_namespace *ns,
+			    struct pid *pid, struct task_struct *p)
+{
+	unsigned int i;
+
+	for (i = 0; i < p->max_state; i++)
+		seq_printf(m, "%u %llu\n", all_freqs[i],
+			   (unsigned long long)
+			   cputime_to_clock_t(p->time_in_state[i]));
 	return 0;
 }
+#else
+static inline void task_freq_index_set(struct cpufreq_stats *stat,
+				       int index) {}
+#endif
 
 static ssize_t show_total_trans(struct cpufreq_policy *policy, char *buf)
 {
@@ -78,17 +181,27 @@ static ssize_t show_total_trans(struct cpufreq_policy *policy, char *buf)
 
 static ssize_t show_time_in_state(struct cpufreq_policy *policy, char *buf)
 {
-	ssize_t len = 0;
+	ssize_t len;
 	int i;
+	unsigned int seq;
+	unsigned long long now;
+	cputime64_t time;
 	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
 	if (!stat)
 		return 0;
-	cpufreq_stats_update(stat->cpu);
-	for (i = 0; i < stat->state_num; i++) {
-		len += sprintf(buf + len, "%u %llu\n", stat->freq_table[i],
-			(unsigned long long)
-			cputime64_to_clock_t(stat->time_in_state[i]));
-	}
+	do {
+		seq = read_seqbegin(&stat->lock);
+		now = get_jiffies_64();
+		len = 0;
+		for (i = 0; i < stat->state_num; i++) {
+			time = stat->time_in_state[i];
+			if (i == stat->last_index)
+				time += now - stat->last_time;
+			len += sprintf(buf + len, "%u %llu\n",
+				stat->freq_table[i], (unsigned long long)
+				cputime64_to_clock_t(time));
+		}
+	} while (read_seqretry(&stat->lock, seq));
 	return len;
 }
 
@@ -101,7 +214,6 @@ static ssize_t show_trans_table(struct cpufreq_policy *policy, char *buf)
 	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
 	if (!stat)
 		return 0;
-	cpufreq_stats_update(stat->cpu);
 	len += snprintf(buf + len, PAGE_SIZE - len, "   From  :    To\n");
 	len += snprintf(buf + len, PAGE_SIZE - len, "         : ");
 	for (i = 0; i < stat->state_num; i++) {
@@ -227,6 +339,9 @@ static int cpufreq_stats_create_table(struct cpufreq_policy *policy,
 
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	alloc_size += count * count * sizeof(int);
+#endif
+#ifdef CONFIG_CPU_FREQ_STAT_TASK
+	alloc_size += count * sizeof(int);
 #endif
 	stat->max_state = count;
 	stat->time_in_state = kzalloc(alloc_size, GFP_KERNEL);
@@ -238,6 +353,13 @@ static int cpufreq_stats_create_table(struct cpufreq_policy *policy,
 
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	stat->trans_table = stat->freq_table + count;
+#endif
+#ifdef CONFIG_CPU_FREQ_STAT_TASK
+	stat->task_index = stat->freq_table + count;
+#ifdef CONFIG_CPU_FREQ_STAT_DETAILS
+	stat->task_index += count * count;
+#endif
+	cpumask_copy(&stat->related_cpus, policy->related_cpus);
 #endif
 	j = 0;
 	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
@@ -248,10 +370,14 @@ static int cpufreq_stats_create_table(struct cpufreq_policy *policy,
 			stat->freq_table[j++] = freq;
 	}
 	stat->state_num = j;
-	spin_lock(&cpufreq_stats_lock);
+#ifdef CONFIG_CPU_FREQ_STAT_TASK
+	for (i = 0; i < j; i++)
+		stat->task_index[i] = all_freqs_get_index(stat->freq_table[i]);
+#endif
+	seqlock_init(&stat->lock);
 	stat->last_time = get_jiffies_64();
 	stat->last_index = freq_table_get_index(stat, policy->cur);
-	spin_unlock(&cpufreq_stats_lock);
+	task_freq_index_set(stat, stat->last_index);
 	cpufreq_cpu_put(data);
 	return 0;
 error_out:
@@ -285,6 +411,7 @@ static int cpufreq_stat_notifier_trans(struct notifier_block *nb,
 {
 	struct cpufreq_freqs *freq = data;
 	struct cpufreq_stats *stat;
+	unsigned long long cur_time;
 	int old_index, new_index;
 
 	if (val != CPUFREQ_POSTCHANGE)
@@ -301,18 +428,21 @@ static int cpufreq_stat_notifier_trans(struct notifier_block *nb,
 	if (old_index == -1 || new_index == -1)
 		return 0;
 
-	cpufreq_stats_update(freq->cpu);
-
-	if (old_index == new_index)
-		return 0;
-
-	spin_lock(&cpufreq_stats_lock);
-	stat->last_index = new_index;
+	cur_time = get_jiffies_64();
+	write_seqlock(&stat->lock);
+	stat->time_in_state[old_index] += cur_time - stat->last_time;
+	stat->last_time = cur_time;
+	if (old_index != new_index) {
+		stat->last_index = new_index;
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
-	stat->trans_table[old_index * stat->max_state + new_index]++;
+		stat->trans_table[old_index * stat->max_state + new_index]++;
 #endif
-	stat->total_trans++;
-	spin_unlock(&cpufreq_stats_lock);
+		stat->total_trans++;
+	}
+	write_sequnlock(&stat->lock);
+
+	if (old_index != new_index)
+		task_freq_index_set(stat, new_index);
 	return 0;
 }
 
@@ -382,7 +512,6 @@ static int __init cpufreq_stats_init(void)
 	int ret;
 	unsigned int cpu;
 
-	spin_lock_init(&cpufreq_stats_lock);
 	ret = cpufreq_register_notifier(&notifier_policy_block,
 				CPUFREQ_POLICY_NOTIFIER);
 	if (ret)
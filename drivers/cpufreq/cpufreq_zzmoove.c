@@ -39,11 +39,14 @@
 #include <linux/lcd_notify.h>
 #endif /* USE_LCD_NOTIFIER */
 #include <linux/cpufreq.h>
+#include <linux/cpufreq_input_boost.h>
+#include <linux/exynos_hotplug.h>
 #if defined(CONFIG_HAS_EARLYSUSPEND) && !defined(DISABLE_POWER_MANAGEMENT)
 #include <linux/earlysuspend.h>
 #endif /* defined(CONFIG_HAS_EARLYSUSPEND)... */
 #ifdef CONFIG_EXYNOS4_EXPORT_TEMP
 #include <linux/exynos4_export_temp.h>		// ZZ: Exynos4 temperatue reading support
+#include <mach/tmu.h>					// ZZ: Exynos4 temperature change notification
 #endif /* CONFIG_EXYNOS4_EXPORT_TEMP */
 #include <linux/hrtimer.h>
 #include <linux/init.h>
@@ -57,8 +60,11 @@
 #include <linux/powersuspend.h>
 #endif /* defined(CONFIG_HAS_EARLYSUSPEND)... */
 #include <linux/sched.h>
+#include <linux/seqlock.h>
+#include <linux/spinlock.h>
 #include <linux/tick.h>
 #include <linux/version.h>
+#include <trace/events/dvfs.h>
 
 // #define ENABLE_SNAP_THERMAL_SUPPORT		// ZZ: Snapdragon temperature tripping support
 
@@ -176,7 +182,6 @@ static char custom_profile[20] = "custom";			// ZZ: name to show in sysfs if any
 #define DEF_SCALING_UP_BLOCK_CYCLES			(0)	// ff: default scaling-up block cycles
 #define DEF_SCALING_UP_BLOCK_FREQ			(0)	// ff: default scaling-up block frequency threshold
 #ifdef CONFIG_EXYNOS4_EXPORT_TEMP
-#define DEF_TMU_READ_DELAY				(1000)	// ZZ: delay for cpu temperature reading in ms (tmu driver polling intervall is 10 sec)
 #define DEF_SCALING_BLOCK_TEMP				(0)	// ZZ: default cpu temperature threshold in °C
 #endif /* CONFIG_EXYNOS4_EXPORT_TEMP */
 #ifdef ENABLE_SNAP_THERMAL_SUPPORT				// ff: snapdragon temperature tripping defaults
@@ -335,12 +340,12 @@ static bool set_profile_active = false;				// ZZ: flag to avoid changing of any
 #ifdef ENABLE_HOTPLUGGING
 static bool hotplug_up_temp_block;				// ZZ: flag for blocking up hotplug work during temp freq blocking
 #endif /* ENABLE_HOTPLUGGING */
-static bool cancel_temp_reading = false;			// ZZ: flag for starting temp reading work
-static bool temp_reading_started = false;			// ZZ: flag for canceling temp reading work
 
-// ZZ: Exynos CPU temp reading work
-static void tmu_read_temperature(struct work_struct * tmu_read_work);	// ZZ: prepare temp reading work
-static DECLARE_DELAYED_WORK(tmu_read_work, tmu_read_temperature);	// ZZ: declare delayed work for temp reading
+// ZZ: Exynos CPU temp is pushed by the tmu driver whenever it changes
+static int tmu_temperature_notify(struct notifier_block *nb, unsigned long event, void *data);
+static struct notifier_block tmu_temperature_notifier = {
+	.notifier_call = tmu_temperature_notify,
+};
 static unsigned int cpu_temp;						// ZZ: static var for holding current cpu temp
 #endif /* CONFIG_EXYNOS4_EXPORT_TEMP */
 
@@ -435,6 +440,23 @@ static int hotplug_freq_threshold_out_of_range[2][8] = {
     { 0 ,0 ,0 ,0 ,0 ,0 ,0 ,0 }
     };
 #endif /* ENABLE_AUTO_ADJUST_FREQ */
+
+/*
+ * ZZ: compiled hotplug table, one entry per secondary core. The load and freq
+ * thresholds above, the out of range flags and the core limits are folded
+ * into it whenever one of them changes, so the hotplug works only compare
+ * load and freq against it. Profile switches publish the whole new table at once.
+ */
+struct zz_hotplug_entry {
+	int up_load;						// ZZ: 0 = never online this core
+	int up_freq;						// ZZ: 0 = no freq condition
+	int down_load;						// ZZ: -1 = never offline this core
+	int down_freq;						// ZZ: 0 = no freq condition
+};
+
+static struct zz_hotplug_entry zz_hotplug_table[8];
+static seqcount_t zz_hotplug_table_seq = SEQCNT_ZERO;
+static DEFINE_SPINLOCK(zz_hotplug_table_lock);
 #endif /* ENABLE_HOTPLUGGING */
 
 // ZZ: core on which we currently run
@@ -921,6 +943,58 @@ static struct dbs_tuners {
 #endif /* ENABLE_MUSIC_LIMITS */
 };
 
+#ifdef ENABLE_HOTPLUGGING
+// ZZ: fold all hotplug tuneables into the compiled table
+static void zz_hotplug_table_rebuild(void)
+{
+	struct zz_hotplug_entry t[8];
+	unsigned long flags;
+	int core, cpu;
+
+	for (core = 0; core < 8; core++) {
+		cpu = core + 1;
+		t[core].up_load = hotplug_thresholds[0][core];
+		t[core].up_freq = hotplug_thresholds_freq[0][core];
+		t[core].down_load = hotplug_thresholds[1][core];
+		t[core].down_freq = hotplug_thresholds_freq[1][core];
+#ifdef ENABLE_AUTO_ADJUST_FREQ
+		if (hotplug_freq_threshold_out_of_range[0][core])
+		    t[core].up_freq = 0;
+		if (hotplug_freq_threshold_out_of_range[1][core])
+		    t[core].down_freq = 0;
+#endif /* ENABLE_AUTO_ADJUST_FREQ */
+		if (dbs_tuners_ins.hotplug_max_limit && cpu >= dbs_tuners_ins.hotplug_max_limit)
+		    t[core].up_load = 0;
+		if (dbs_tuners_ins.hotplug_min_limit && cpu < dbs_tuners_ins.hotplug_min_limit)
+		    t[core].down_load = -1;
+#ifdef ENABLE_MUSIC_LIMITS
+		if (dbs_tuners_ins.music_state && dbs_tuners_ins.music_min_cores
+		    && cpu < dbs_tuners_ins.music_min_cores)
+		    t[core].down_load = -1;
+#endif /* ENABLE_MUSIC_LIMITS */
+	}
+
+	spin_lock_irqsave(&zz_hotplug_table_lock, flags);
+	write_seqcount_begin(&zz_hotplug_table_seq);
+	memcpy(zz_hotplug_table, t, sizeof(t));
+	write_seqcount_end(&zz_hotplug_table_seq);
+	spin_unlock_irqrestore(&zz_hotplug_table_lock, flags);
+}
+
+// ZZ: consistent copy of the entry of one secondary core
+static inline void zz_hotplug_entry_get(int core, struct zz_hotplug_entry *e)
+{
+	unsigned int seq;
+
+	do {
+	    seq = read_seqcount_begin(&zz_hotplug_table_seq);
+	    *e = zz_hotplug_table[core];
+	} while (read_seqcount_retry(&zz_hotplug_table_seq, seq));
+}
+#else
+static inline void zz_hotplug_table_rebuild(void) {}
+#endif /* ENABLE_HOTPLUGGING */
+
 #ifdef ENABLE_INPUTBOOSTER
 // ff: Input Booster
 static void interactive_input_event(struct input_handle *handle, unsigned int type, unsigned int code, int value)
@@ -1504,7 +1578,7 @@ static inline void __cpuinit enable_disable_cores(void)
 
 		for (i = 1; i < possible_cpus; i++) {					// ZZ: enable all offline cores
 		    if (!cpu_online(i))
-		    cpu_up(i);
+		    exynos_hotplug_cpu_up(i);
 		}
 		enable_cores = 0;							// ZZ: reset enable flag again
 	}
@@ -1518,7 +1592,7 @@ static inline void __cpuinit enable_disable_cores(void)
 #endif /* ENABLE_MUSIC_LIMITS */
 		    && (!dbs_tuners_ins.hotplug_max_limit || i < dbs_tuners_ins.hotplug_max_limit)) {
 			    // ff: this core is below the minimum, so bring it up
-			    cpu_up(i);
+			    exynos_hotplug_cpu_up(i);
 #ifdef ZZMOOVE_DEBUG
 			    pr_info("[zzmoove] hotplug_min_limit: CPU%d forced up\n", i);
 #endif /* ZZMOOVE_DEBUG */
@@ -1536,7 +1610,7 @@ static inline void __cpuinit enable_disable_cores(void)
 		    || i >= dbs_tuners_ins.hotplug_min_limit)) {
 #endif /* ENABLE_MUSIC_LIMITS */
 			    // ff: this core is more than the limit, so turn it off, but don't go below hotplug_min_limit or music_min_cores
-			    cpu_down(i);
+			    exynos_hotplug_cpu_down(i);
 #ifdef ZZMOOVE_DEBUG
 			    pr_info("[zzmoove] hotplug_max_limit: CPU%d forced down\n", i);
 #endif /* ZZMOOVE_DEBUG */
@@ -1549,13 +1623,13 @@ static inline void __cpuinit enable_disable_cores(void)
 		for (i = 1; i < num_possible_cpus(); i++) {
 			if (!cpu_online(i) && i < dbs_tuners_ins.hotplug_lock) {
 			    // ff: this core is less than the lock, so bring it up
-			    cpu_up(i);
+			    exynos_hotplug_cpu_up(i);
 #ifdef ZZMOOVE_DEBUG
 			    pr_info("[zzmoove] hotplug_lock: CPU%d forced up\n", i);
 #endif /* ZZMOOVE_DEBUG */
 			} else if (cpu_online(i) && i >= dbs_tuners_ins.hotplug_lock) {
 			    // ff: this core is more than the lock, so turn it off
-			    cpu_down(i);
+			    exynos_hotplug_cpu_down(i);
 #ifdef ZZMOOVE_DEBUG
 			    pr_info("[zzmoove] hotplug_lock: CPU%d forced down\n", i);
 #endif /* ZZMOOVE_DEBUG */
@@ -2559,6 +2633,7 @@ static inline void adjust_freq_thresholds(unsigned int step)
 		}
 #endif /* (MAX_CORES == 8) */
 #endif /* ENABLE_HOTPLUGGING */
+	zz_hotplug_table_rebuild();
 }
 #endif /* ENABLE_AUTO_ADJUST_FREQ */
 
@@ -3254,6 +3329,7 @@ static ssize_t store_up_threshold_hotplug##name							\
 												\
 	    dbs_tuners_ins.up_threshold_hotplug##name = input;					\
 	    hotplug_thresholds[0][core] = input;						\
+	    zz_hotplug_table_rebuild();								\
 												\
 	return count;										\
 }												\
@@ -3278,6 +3354,7 @@ static ssize_t store_down_threshold_hotplug##name						\
 												\
 	    dbs_tuners_ins.down_threshold_hotplug##name = input;				\
 	    hotplug_thresholds[1][core] = input;						\
+	    zz_hotplug_table_rebuild();								\
 												\
 	return count;										\
 }												\
@@ -3370,6 +3447,7 @@ static ssize_t store_up_threshold_hotplug##name							\
 												\
 	    dbs_tuners_ins.up_threshold_hotplug##name = input;					\
 	    hotplug_thresholds[0][core] = input;						\
+	    zz_hotplug_table_rebuild();								\
 												\
 	return count;										\
 }												\
@@ -3387,6 +3465,7 @@ static ssize_t store_down_threshold_hotplug##name						\
 												\
 	    dbs_tuners_ins.down_threshold_hotplug##name = input;				\
 	    hotplug_thresholds[1][core] = input;						\
+	    zz_hotplug_table_rebuild();								\
 												\
 	return count;										\
 }												\
@@ -4409,6 +4488,7 @@ static ssize_t store_hotplug_max_limit(struct kobject *a, struct attribute *b, c
 #endif /* ENABLE_PROFILES_SUPPORT */
 
 	dbs_tuners_ins.hotplug_max_limit = input;
+	zz_hotplug_table_rebuild();
 
 	if (input > 0) {
 	    disable_cores = 1;
@@ -4475,6 +4555,7 @@ static ssize_t store_hotplug_min_limit(struct kobject *a, struct attribute *b, c
 #endif /* ENABLE_PROFILES_SUPPORT */
 	dbs_tuners_ins.hotplug_min_limit = input;
 	dbs_tuners_ins.hotplug_min_limit_saved = input;
+	zz_hotplug_table_rebuild();
 
 	if (input > 1) {
 	    enable_cores = 1;
@@ -5407,6 +5488,7 @@ static ssize_t store_music_min_cores(struct kobject *a, struct attribute *b, con
 	}
 #endif /* ENABLE_PROFILES_SUPPORT */
 	dbs_tuners_ins.music_min_cores = input;
+	zz_hotplug_table_rebuild();
 
 	return count;
 }
@@ -5442,6 +5524,7 @@ static ssize_t store_music_state(struct kobject *a, struct attribute *b, const c
 		}
 
 		dbs_tuners_ins.music_state = 1;
+		zz_hotplug_table_rebuild();
 		return count;
 
 	} else {
@@ -5450,6 +5533,7 @@ static ssize_t store_music_state(struct kobject *a, struct attribute *b, const c
 		    limit_table_start = 0;		// ZZ: reset freq limit start point
 		}
 		dbs_tuners_ins.music_state = 0;		// ZZ: disable music state
+		zz_hotplug_table_rebuild();
 	}
 	return count;
 }
@@ -6404,6 +6488,7 @@ static ssize_t store_profile_number(struct kobject *a, struct attribute *b, cons
 
 	// ZZ: set profile and check result
 	ret_profile = set_profile(input);
+	zz_hotplug_table_rebuild();						// ZZ: publish the new profile at once
 
 	if (ret_profile != 1)
 	    return -EINVAL; // ZZ: given profile not available
@@ -6471,6 +6556,7 @@ static ssize_t store_up_threshold_hotplug_freq##name						\
 	    }											\
 	    dbs_tuners_ins.up_threshold_hotplug_freq##name = input;				\
 	    hotplug_thresholds_freq[0][core] = input;						\
+	    zz_hotplug_table_rebuild();								\
 	return count;										\
 	}											\
 												\
@@ -6491,6 +6577,7 @@ static ssize_t store_up_threshold_hotplug_freq##name						\
 			}									\
 			dbs_tuners_ins.up_threshold_hotplug_freq##name = input;			\
 			hotplug_thresholds_freq[0][core] = input;				\
+			zz_hotplug_table_rebuild();								\
 		    return count;								\
 		    }										\
 	    }											\
@@ -6520,6 +6607,7 @@ static ssize_t store_down_threshold_hotplug_freq##name						\
 	    }											\
 	    dbs_tuners_ins.down_threshold_hotplug_freq##name = input;				\
 	    hotplug_thresholds_freq[1][core] = input;						\
+	    zz_hotplug_table_rebuild();								\
 	return count;										\
 	}											\
 												\
@@ -6540,6 +6628,7 @@ static ssize_t store_down_threshold_hotplug_freq##name						\
 			}									\
 			dbs_tuners_ins.down_threshold_hotplug_freq##name = input;		\
 			hotplug_thresholds_freq[1][core] = input;				\
+			zz_hotplug_table_rebuild();								\
 		    return count;								\
 		    }										\
 	    }											\
@@ -6590,6 +6679,7 @@ static ssize_t store_up_threshold_hotplug_freq##name						\
 	if (input == 0) {									\
 	    dbs_tuners_ins.up_threshold_hotplug_freq##name = input;				\
 	    hotplug_thresholds_freq[0][core] = input;						\
+	    zz_hotplug_table_rebuild();								\
 	return count;										\
 	}											\
 												\
@@ -6600,6 +6690,7 @@ static ssize_t store_up_threshold_hotplug_freq##name						\
 		    if (unlikely(system_freq_table[i].frequency == input)) {			\
 			dbs_tuners_ins.up_threshold_hotplug_freq##name = input;			\
 			hotplug_thresholds_freq[0][core] = input;				\
+			zz_hotplug_table_rebuild();								\
 		    return count;								\
 		    }										\
 	    }											\
@@ -6622,6 +6713,7 @@ static ssize_t store_down_threshold_hotplug_freq##name						\
 	if (input == 0) {									\
 	    dbs_tuners_ins.down_threshold_hotplug_freq##name = input;				\
 	    hotplug_thresholds_freq[1][core] = input;						\
+	    zz_hotplug_table_rebuild();								\
 	return count;										\
 	}											\
 												\
@@ -6632,6 +6724,7 @@ static ssize_t store_down_threshold_hotplug_freq##name						\
 		    if (unlikely(system_freq_table[i].frequency == input)) {			\
 			dbs_tuners_ins.down_threshold_hotplug_freq##name = input;		\
 			hotplug_thresholds_freq[1][core] = input;				\
+			zz_hotplug_table_rebuild();								\
 		    return count;								\
 		    }										\
 	    }											\
@@ -7271,6 +7364,8 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 			pr_info("[zzmoove/dbs_check_cpu] manual max-boost call! boosting to: %d mhz %d more times, cur: %d\n", policy->max, flg_ctr_cpuboost, policy->cur);
 #endif /* ZZMOOVE_DEBUG */
 			if (policy->cur < policy->max) {
+				trace_dvfs_governor("zzmoove", policy->cpu, 0, policy->cur,
+						    policy->max, 0, DVFS_BOOST);
 				__cpufreq_driver_target(policy, policy->max, CPUFREQ_RELATION_H);
 			}
 
@@ -7305,6 +7400,9 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 					pr_info("[zzmoove/dbs_check_cpu] time since touch: %d ms\n", time_since_touchbooster_lastrun);
 					pr_info("[zzmoove/dbs_check_cpu] freq: %d too low, punching to %d immediately\n", policy->cur, dbs_tuners_ins.inputboost_punch_freq);
 #endif /* ZZMOOVE_DEBUG */
+					trace_dvfs_governor("zzmoove", policy->cpu, 0, policy->cur,
+							    dbs_tuners_ins.inputboost_punch_freq, 0,
+							    DVFS_BOOST);
 					__cpufreq_driver_target(policy, dbs_tuners_ins.inputboost_punch_freq, CPUFREQ_RELATION_H);
 				}
 			}
@@ -7784,6 +7882,9 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 #ifdef ZZMOOVE_DEBUG
 			pr_info("[zzmoove/dbs_check_cpu] thermal throttling - cur freq: %d, max: %d, new freq: %d\n", policy->cur, policy->max, this_dbs_info->requested_freq);
 #endif /* ZZMOOVE_DEBUG */
+			trace_dvfs_governor("zzmoove", policy->cpu, max_load, policy->cur,
+					    this_dbs_info->requested_freq,
+					    scaling_up_threshold, DVFS_THERMAL);
 			__cpufreq_driver_target(policy, this_dbs_info->requested_freq,
 									CPUFREQ_RELATION_H);
 			return;
@@ -7891,6 +7992,10 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 #ifdef ZZMOOVE_DEBUG
 		pr_info("[zzmoove/dbs_check_cpu] scaling up SET - cur freq: %d, max: %d, new freq: %d\n", policy->cur, policy->max,  this_dbs_info->requested_freq);
 #endif /* ZZMOOVE_DEBUG */
+		trace_dvfs_governor("zzmoove", policy->cpu, max_load, policy->cur,
+				    this_dbs_info->requested_freq,
+				    scaling_up_threshold,
+				    boost_freq ? DVFS_BOOST : DVFS_UP);
 		__cpufreq_driver_target(policy, this_dbs_info->requested_freq,
 			    CPUFREQ_RELATION_H);
 
@@ -7998,6 +8103,10 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 			this_dbs_info->requested_freq = dbs_tuners_ins.inputboost_punch_freq;
 		}
 #endif /* ENABLE_INPUTBOOSTER */
+		// ZZ: don't scale below the shared input boost floor
+		if (this_dbs_info->requested_freq < cpufreq_input_boost_freq())
+		    this_dbs_info->requested_freq = min(cpufreq_input_boost_freq(), policy->max);
+
 		if (dbs_tuners_ins.freq_limit != 0 && this_dbs_info->requested_freq
 		    > dbs_tuners_ins.freq_limit)
 		    this_dbs_info->requested_freq = dbs_tuners_ins.freq_limit;
@@ -8011,6 +8120,9 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 			this_dbs_info->requested_freq = dbs_tuners_ins.music_min_freq;
 		}
 #endif /* ENABLE_MUSIC_LIMITS */
+		trace_dvfs_governor("zzmoove", policy->cpu, max_load, policy->cur,
+				    this_dbs_info->requested_freq,
+				    scaling_down_threshold, DVFS_DOWN);
 		__cpufreq_driver_target(policy, this_dbs_info->requested_freq,
 			CPUFREQ_RELATION_L);							// ZZ: changed to relation low
 		return;
@@ -8188,6 +8300,7 @@ static void tmu_check_work(struct work_struct * work_tmu_check)
 #ifdef ENABLE_HOTPLUGGING
 static void __cpuinit hotplug_offline_work_fn(struct work_struct *work)
 {
+	struct zz_hotplug_entry entry;
 	int cpu;	// ZZ: for hotplug down loop
 
 	hotplug_down_in_progress = true;
@@ -8201,26 +8314,17 @@ static void __cpuinit hotplug_offline_work_fn(struct work_struct *work)
 	    return;
 	}
 
-	// Yank: added frequency thresholds
+	// Yank: added frequency thresholds, ZZ: limits are compiled into the hotplug table
 	for_each_online_cpu(cpu) {
-		if (likely(cpu_online(cpu) && (cpu)) && cpu != 0
-			&& cur_load <= hotplug_thresholds[1][cpu-1]
-			&& (!dbs_tuners_ins.hotplug_min_limit || cpu >= dbs_tuners_ins.hotplug_min_limit)
-#ifdef ENABLE_MUSIC_LIMITS
-			&& (!dbs_tuners_ins.music_state || (dbs_tuners_ins.music_state
-			&& (!dbs_tuners_ins.music_min_cores || cpu >= dbs_tuners_ins.music_min_cores)))
-#endif /* ENABLE_MUSIC_LIMITS */
+		if (unlikely(!cpu))
+		    continue;
+
+		zz_hotplug_entry_get(cpu - 1, &entry);
+		if (entry.down_load >= 0 && cur_load <= entry.down_load
 #ifdef ENABLE_INPUTBOOSTER
 			&& (!dbs_tuners_ins.hotplug_min_limit_touchbooster || cpu >= dbs_tuners_ins.hotplug_min_limit_touchbooster)
 #endif /* ENABLE_INPUTBOOSTER */
-			&& (hotplug_thresholds_freq[1][cpu-1] == 0
-				|| cur_freq <= hotplug_thresholds_freq[1][cpu-1]
-#ifdef ENABLE_AUTO_ADJUST_FREQ
-				|| hotplug_freq_threshold_out_of_range[1][cpu-1])
-#else
-			)
-#endif /* ENABLE_AUTO_ADJUST_FREQ */
-			) {
+			&& (!entry.down_freq || cur_freq <= entry.down_freq)) {
 #ifdef ZZMOOVE_DEBUG
 #if defined(ENABLE_MUSIC_LIMITS) && defined(ENABLE_AUTO_ADJUST_FREQ)
 			pr_info("[zzmoove/hotplug_offline_work] turning off cpu: %d, load: %d / %d, min_limit: %d music_min: %d (saved: %d), min_touchbooster: %d, freq: %d / %d, mftl: %d\n",
@@ -8262,7 +8366,7 @@ static void __cpuinit hotplug_offline_work_fn(struct work_struct *work)
 #ifdef ZZMOOVE_DEBUG
 				pr_info("[zzmoove/hotplug_offline_work] CPU %d OFF\n", cpu);
 #endif /* ZZMOOVE_DEBUG */
-				cpu_down(cpu);
+				exynos_hotplug_cpu_down(cpu);
 
 				// ff: break after a core removed
 				hotplug_down_in_progress = false;
@@ -8273,7 +8377,7 @@ static void __cpuinit hotplug_offline_work_fn(struct work_struct *work)
 #ifdef ZZMOOVE_DEBUG
 				pr_info("[zzmoove/hotplug_offline_work] CPU %d OFF\n", cpu);
 #endif /* ZZMOOVE_DEBUG */
-				cpu_down(cpu);
+				exynos_hotplug_cpu_down(cpu);
 			}
 		}
 	}
@@ -8283,6 +8387,7 @@ static void __cpuinit hotplug_offline_work_fn(struct work_struct *work)
 // ZZ: function for hotplug up work
 static void __cpuinit hotplug_online_work_fn(struct work_struct *work)
 {
+	struct zz_hotplug_entry entry;
 	int i = 0;	// ZZ: for hotplug up loop
 
 	hotplug_up_in_progress = true;
@@ -8310,7 +8415,7 @@ static void __cpuinit hotplug_online_work_fn(struct work_struct *work)
 	if (flg_ctr_inputbooster_typingbooster > 0 && num_online_cpus() < dbs_tuners_ins.inputboost_typingbooster_cores) {
 		for (i = 1; i < num_possible_cpus(); i++) {
 			if (!cpu_online(i) && i < dbs_tuners_ins.inputboost_typingbooster_cores) {
-				cpu_up(i);
+				exynos_hotplug_cpu_up(i);
 #ifdef ZZMOOVE_DEBUG
 				pr_info("[zzmoove/hotplug_online_work_fn/typingbooster] cpu%d forced online\n", i);
 #endif /* ZZMOOVE_DEBUG */
@@ -8320,16 +8425,12 @@ static void __cpuinit hotplug_online_work_fn(struct work_struct *work)
 #endif /* ENABLE_INPUTBOOSTER */
 	// Yank: added frequency thresholds
 	for (i = 1; likely(i < possible_cpus); i++) {
-		if (!cpu_online(i) && hotplug_thresholds[0][i-1] != 0 && cur_load >= hotplug_thresholds[0][i-1]
-			&& (!dbs_tuners_ins.hotplug_max_limit || i < dbs_tuners_ins.hotplug_max_limit)
-			&& (hotplug_thresholds_freq[0][i-1] == 0 || cur_freq >= hotplug_thresholds_freq[0][i-1]
-			|| boost_hotplug
-#ifdef ENABLE_AUTO_ADJUST_FREQ
-			|| hotplug_freq_threshold_out_of_range[0][i-1])
-#else
-			)
-#endif /* ENABLE_AUTO_ADJUST_FREQ */
-			) {
+		if (cpu_online(i))
+		    continue;
+
+		zz_hotplug_entry_get(i - 1, &entry);
+		if (entry.up_load && cur_load >= entry.up_load
+			&& (!entry.up_freq || cur_freq >= entry.up_freq || boost_hotplug)) {
 #ifdef ZZMOOVE_DEBUG
 #if defined(ENABLE_MUSIC_LIMITS) && defined(ENABLE_AUTO_ADJUST_FREQ)
 			pr_info("[zzmoove/hotplug_online_work] turning on cpu: %d, load: %d / %d, min_limit: %d music_min: %d (saved: %d), min_touchbooster: %d, freq: %d / %d, mftl: %d\n",
@@ -8363,7 +8464,7 @@ static void __cpuinit hotplug_online_work_fn(struct work_struct *work)
 #ifdef ZZMOOVE_DEBUG
 				pr_info("[zzmoove/hotplug_online_work] CPU %d ON\n", i);
 #endif /* ZZMOOVE_DEBUG */
-				cpu_up(i);
+				exynos_hotplug_cpu_up(i);
 
 				// ff: break after a core added
 				hotplug_up_in_progress = false;
@@ -8374,7 +8475,7 @@ static void __cpuinit hotplug_online_work_fn(struct work_struct *work)
 #ifdef ZZMOOVE_DEBUG
 				pr_info("[zzmoove/hotplug_online_work] CPU %d ON\n", i);
 #endif /* ZZMOOVE_DEBUG */
-				cpu_up(i);
+				exynos_hotplug_cpu_up(i);
 			}
 		}
 	}
@@ -8383,11 +8484,13 @@ static void __cpuinit hotplug_online_work_fn(struct work_struct *work)
 #endif /* ENABLE_HOTPLUGGING */
 
 #ifdef CONFIG_EXYNOS4_EXPORT_TEMP
-// ZZ: function for exynos4 CPU temperature reading
-static void tmu_read_temperature(struct work_struct * tmu_read_work)
+// ZZ: exynos4 CPU temperature change notification
+static int tmu_temperature_notify(struct notifier_block *nb, unsigned long event, void *data)
 {
-	cpu_temp = get_exynos4_temperature();
-	return;
+	if (event == TMU_TEMP_CHANGE)
+	    cpu_temp = *(unsigned int *)data;
+
+	return NOTIFY_OK;
 }
 #endif /* CONFIG_EXYNOS4_EXPORT_TEMP */
 
@@ -8403,28 +8506,6 @@ static void do_dbs_timer(struct work_struct *work)
 	// We want all CPUs to do sampling nearly on same jiffy
 	int delay = usecs_to_jiffies(dbs_tuners_ins.sampling_rate_current * dbs_info->rate_mult); // ZZ: Sampling down momentum - added multiplier
 
-#ifdef CONFIG_EXYNOS4_EXPORT_TEMP
-	// ZZ: start reading of temperature from exynos4 thermal management driver but disable it at suspend
-	if (dbs_tuners_ins.scaling_block_temp != 0) {						// ZZ: only if it is enabled and we are not at suspend
-	    if (!suspend_flag) {
-		schedule_delayed_work(&tmu_read_work, msecs_to_jiffies(DEF_TMU_READ_DELAY));	// ZZ: start work
-		temp_reading_started = true;							// ZZ: set work started flag
-		cancel_temp_reading = false;							// ZZ: reset cancel flag
-	    } else {
-		cancel_temp_reading = true;							// ZZ: else set cancel flag
-	    }
-
-	    if (temp_reading_started && cancel_temp_reading) {					// ZZ: if work was started and cancel flag was set
-		cancel_delayed_work(&tmu_read_work);						// ZZ: cancel work
-		cancel_temp_reading = false;							// ZZ: reset cancel flag
-		temp_reading_started = false;							// ZZ: reset started flag
-	    }
-	}
-
-	if (dbs_tuners_ins.scaling_block_temp == 0 && temp_reading_started)			// ZZ: if temp reading was disabled via sysfs and work was started
-	    cancel_delayed_work(&tmu_read_work);						// ZZ: cancel work
-#endif /* CONFIG_EXYNOS4_EXPORT_TEMP */
-
 #ifdef ENABLE_SNAP_THERMAL_SUPPORT
 	if (dbs_tuners_ins.scaling_trip_temp > 0) {
 		if (!suspend_flag) {
@@ -8475,9 +8556,6 @@ static inline void dbs_timer_exit(struct cpu_dbs_info_s *dbs_info)
 	dbs_info_enabled = false;
 
 	cancel_delayed_work_sync(&dbs_info->work);
-#ifdef CONFIG_EXYNOS4_EXPORT_TEMP
-	cancel_delayed_work(&tmu_read_work);					// ZZ: cancel cpu temperature reading
-#endif /* CONFIG_EXYNOS4_EXPORT_TEMP */
 }
 
 #if (defined(CONFIG_HAS_EARLYSUSPEND) || defined(CONFIG_POWERSUSPEND) && !defined(DISABLE_POWER_MANAGEMENT)) || defined(USE_LCD_NOTIFIER)
@@ -8669,6 +8747,7 @@ void zzmoove_suspend(void)
 	flg_ctr_inputbooster_typingbooster = 0;
 #endif /* ENABLE_INPUTBOOSTER */
 	scaling_up_block_cycles_count = 0;
+	zz_hotplug_table_rebuild();
 #ifdef ZZMOOVE_DEBUG
 	pr_info("[zzmoove/lcd_notifier] Suspend function executed.\n");
 #endif /* ZZMOOVE_DEBUG */
@@ -8759,6 +8838,7 @@ void zzmoove_resume(void)
 	else
 	    scaling_mode_down = dbs_tuners_ins.fast_scaling_down;		// Yank: fast scaling up only
 
+	zz_hotplug_table_rebuild();
 #ifdef ZZMOOVE_DEBUG
 	pr_info("[zzmoove/lcd_notifier] Resume function executed.\n");
 #endif /* ZZMOOVE_DEBUG */
@@ -8900,6 +8980,12 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 			cpufreq_register_notifier(
 					&dbs_cpufreq_notifier_block,
 					CPUFREQ_TRANSITION_NOTIFIER);
+#ifdef CONFIG_EXYNOS4_EXPORT_TEMP
+			exynos_tmu_register_notifier(&tmu_temperature_notifier);	// ZZ: receive temperature changes
+#endif /* CONFIG_EXYNOS4_EXPORT_TEMP */
+#if defined(ENABLE_HOTPLUGGING) && !defined(SNAP_NATIVE_HOTPLUGGING)
+			exynos_hotplug_governor_start();			// ZZ: we make the hotplug decisions from now on
+#endif /* defined(ENABLE_HOTPLUGGING)... */
 #ifdef ENABLE_INPUTBOOST
 			if (dbs_tuners_ins.inputboost_cycles) {
 				rc = input_register_handler(&interactive_input_handler);
@@ -8912,7 +8998,9 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 #endif /* ENABLE_INPUTBOOST */
 		}
 		mutex_unlock(&dbs_mutex);
+		zz_hotplug_table_rebuild();
 		dbs_timer_init(this_dbs_info);
+		cpufreq_input_boost_start(policy);
 #if defined(CONFIG_HAS_EARLYSUSPEND) && !defined(USE_LCD_NOTIFIER) && !defined(DISABLE_POWER_MANAGEMENT)
 		register_early_suspend(&_powersave_early_suspend);
 #elif defined(CONFIG_POWERSUSPEND) && !defined(USE_LCD_NOTIFIER) && !defined(DISABLE_POWER_MANAGEMENT) || defined(CONFIG_POWERSUSPEND) && defined(USE_LCD_NOTIFIER) && !defined(DISABLE_POWER_MANAGEMENT)
@@ -8932,6 +9020,7 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 		    queue_work_on(0, dbs_wq, &hotplug_online_work);			// ZZ: enable offline cores
 		}
 #endif /* defined(ENABLE_HOTPLUGGING)... */
+		cpufreq_input_boost_stop(policy);
 		dbs_timer_exit(this_dbs_info);
 
 		this_dbs_info->idle_exit_time = 0;					// ZZ: idle exit time handling
@@ -8956,10 +9045,17 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 #endif /* (defined(CONFIG_HAS_EARLYSUSPEND)... */
 #ifdef ENABLE_MUSIC_LIMITS
 		    dbs_tuners_ins.music_state = 0;
+		    zz_hotplug_table_rebuild();
 #endif /* ENABLE_MUSIC_LIMITS */
 		    cpufreq_unregister_notifier(
 		    &dbs_cpufreq_notifier_block,
 		    CPUFREQ_TRANSITION_NOTIFIER);
+#ifdef CONFIG_EXYNOS4_EXPORT_TEMP
+		    exynos_tmu_unregister_notifier(&tmu_temperature_notifier);
+#endif /* CONFIG_EXYNOS4_EXPORT_TEMP */
+#if defined(ENABLE_HOTPLUGGING) && !defined(SNAP_NATIVE_HOTPLUGGING)
+		    exynos_hotplug_governor_stop();				// ZZ: hand hotplugging back to the platform policy
+#endif /* defined(ENABLE_HOTPLUGGING)... */
 		}
 
 		mutex_unlock(&dbs_mutex);
@@ -13,6 +13,12 @@
 #include <linux/proc_fs.h>
 #include <linux/atomic.h>
 #include <linux/tick.h>
+#include <linux/miscdevice.h>
+#include <linux/mutex.h>
+#include <linux/poll.h>
+#include <linux/uaccess.h>
+#include <linux/ktime.h>
+#include <linux/dvfs_monitor.h>
 
 struct cpufreq_load_data {
 	cputime64_t prev_idle;
@@ -29,6 +35,19 @@ struct dvfs_data {
 	struct cpufreq_load_data load_data[NR_CPUS];
 	wait_queue_head_t wait_queue;
 	spinlock_t load_lock;
+
+	/* shared by /proc/dvfs_mon and /dev/dvfs_mon, under users_lock */
+	struct mutex users_lock;
+	int users;
+
+	/* latest record of /dev/dvfs_mon, under load_lock */
+	struct dvfs_mon_record record;
+	unsigned int gpu_load;
+	unsigned int temp;
+};
+
+struct dvfs_mon_reader {
+	u32 seq;	/* of the last record read */
 };
 
 static struct dvfs_data *dvfs_info;
@@ -42,18 +61,16 @@ static void init_dvfs_mon(void)
 		dvfs_info->cpus[cpu] = cpu_online(cpu);
 		dvfs_info->freq[cpu] = cur_freq;
 	}
-	atomic_set(&dvfs_info->num_events, 1);
 }
 
-static void calculate_load(void)
+/* Called with load_lock held */
+static void __calculate_load(void)
 {
 	int cpu;
 	cputime64_t cur_wall, cur_idle;
 	cputime64_t prev_wall, prev_idle;
 	unsigned int wall_time, idle_time;
-	unsigned long flags;
 
-	spin_lock_irqsave(&dvfs_info->load_lock, flags);
 	for_each_online_cpu(cpu) {
 		cur_idle = get_cpu_idle_time_us(cpu, &cur_wall);
 		prev_idle = dvfs_info->load_data[cpu].prev_idle;
@@ -65,16 +82,55 @@ static void calculate_load(void)
 		idle_time = (unsigned int)(cur_idle - prev_idle);
 		wall_time = (unsigned int)(cur_wall - prev_wall);
 
-		if (wall_time < idle_time) {
-			pr_err("%s walltime < idletime\n", __func__);
+		if (!wall_time || wall_time < idle_time) {
 			dvfs_info->load_data[cpu].load = 0;
+			continue;
 		}
 
 		dvfs_info->load_data[cpu].load = (wall_time - idle_time) * 100
 			/ wall_time;
 	}
+}
+
+/* Called with load_lock held */
+static void __dvfs_mon_fill_record(unsigned int events)
+{
+	struct dvfs_mon_record *rec = &dvfs_info->record;
+	int cpu;
+
+	rec->version = DVFS_MON_VERSION;
+	rec->size = sizeof(*rec);
+	rec->time_ns = ktime_to_ns(ktime_get());
+	rec->seq++;
+	rec->events = events;
+	rec->nr_running = nr_running();
+	rec->gpu_load = dvfs_info->gpu_load;
+	rec->temp = dvfs_info->temp;
+	rec->nr_cpus = min_t(unsigned int, num_possible_cpus(),
+			     DVFS_MON_MAX_CPUS);
+
+	for (cpu = 0; cpu < rec->nr_cpus; cpu++) {
+		rec->cpu[cpu].freq = dvfs_info->freq[cpu];
+		rec->cpu[cpu].online = dvfs_info->cpus[cpu];
+		rec->cpu[cpu].load = dvfs_info->cpus[cpu] ?
+			dvfs_info->load_data[cpu].load : 0;
+	}
+}
+
+/* A change both interfaces see, new loads are taken at every one */
+static void dvfs_mon_event(unsigned int events)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dvfs_info->load_lock, flags);
+	__calculate_load();
+	__dvfs_mon_fill_record(events);
 	spin_unlock_irqrestore(&dvfs_info->load_lock, flags);
-	return;
+
+	/* /proc/dvfs_mon only tells about the cpus */
+	if (events & (DVFS_MON_EV_FREQ | DVFS_MON_EV_HOTPLUG))
+		atomic_inc(&dvfs_info->num_events);
+	wake_up_interruptible(&dvfs_info->wait_queue);
 }
 
 static int dvfs_monitor_trans(struct notifier_block *nb,
@@ -91,10 +147,7 @@ static int dvfs_monitor_trans(struct notifier_block *nb,
 	dvfs_info->prev_freq[freq->cpu] = freq->old;
 	dvfs_info->freq[freq->cpu] = freq->new;
 
-	calculate_load();
-
-	atomic_inc(&dvfs_info->num_events);
-	wake_up_interruptible(&dvfs_info->wait_queue);
+	dvfs_mon_event(DVFS_MON_EV_FREQ);
 
 	return 0;
 }
@@ -118,9 +171,7 @@ static int __cpuinit dvfs_monitor_hotplug(struct notifier_block *nb,
 	}
 
 	dvfs_info->cpus[cpu] = cpu_status;
-	atomic_inc(&dvfs_info->num_events);
-	calculate_load();
-	wake_up_interruptible(&dvfs_info->wait_queue);
+	dvfs_mon_event(DVFS_MON_EV_HOTPLUG);
 
 	return NOTIFY_OK;
 }
@@ -134,36 +185,117 @@ static struct notifier_block notifier_hotplug_block __refdata = {
 	.priority = 1,
 };
 
-static int dvfs_mon_open(struct inode *inode, struct file *file)
+/* The notifiers are only there while someone is reading */
+static int dvfs_mon_get(void)
 {
+	unsigned long flags;
 	int ret = 0;
 
-	if (atomic_xchg(&dvfs_info->opened, 1) != 0)
-		return -EBUSY;
+	mutex_lock(&dvfs_info->users_lock);
+
+	if (dvfs_info->users++)
+		goto out;
 
 	init_dvfs_mon();
 	ret = cpufreq_register_notifier(&notifier_trans_block,
 				  CPUFREQ_TRANSITION_NOTIFIER);
-	if (ret)
-		return ret;
+	if (ret) {
+		dvfs_info->users--;
+		goto out;
+	}
 
 	register_hotcpu_notifier(&notifier_hotplug_block);
 
-	return 0;
+	spin_lock_irqsave(&dvfs_info->load_lock, flags);
+	__calculate_load();
+	__dvfs_mon_fill_record(0);
+	spin_unlock_irqrestore(&dvfs_info->load_lock, flags);
+out:
+	mutex_unlock(&dvfs_info->users_lock);
+	return ret;
 }
 
-static int dvfs_mon_release(struct inode *inode, struct file *file)
+static int dvfs_mon_put(void)
 {
 	int ret = 0;
 
-	atomic_dec(&dvfs_info->opened);
-	ret = cpufreq_unregister_notifier(&notifier_trans_block,
-				    CPUFREQ_TRANSITION_NOTIFIER);
-	unregister_hotcpu_notifier(&notifier_hotplug_block);
+	mutex_lock(&dvfs_info->users_lock);
+
+	if (!--dvfs_info->users) {
+		ret = cpufreq_unregister_notifier(&notifier_trans_block,
+					    CPUFREQ_TRANSITION_NOTIFIER);
+		unregister_hotcpu_notifier(&notifier_hotplug_block);
+	}
 
+	mutex_unlock(&dvfs_info->users_lock);
 	return ret;
 }
 
+void dvfs_monitor_report_gpu(unsigned int load)
+{
+	unsigned long flags;
+
+	if (!ACCESS_ONCE(dvfs_info))
+		return;
+
+	spin_lock_irqsave(&dvfs_info->load_lock, flags);
+	if (load == dvfs_info->gpu_load) {
+		spin_unlock_irqrestore(&dvfs_info->load_lock, flags);
+		return;
+	}
+	dvfs_info->gpu_load = load;
+	spin_unlock_irqrestore(&dvfs_info->load_lock, flags);
+
+	if (ACCESS_ONCE(dvfs_info->users))
+		dvfs_mon_event(DVFS_MON_EV_GPU);
+}
+EXPORT_SYMBOL_GPL(dvfs_monitor_report_gpu);
+
+void dvfs_monitor_report_temp(unsigned int temp)
+{
+	unsigned long flags;
+
+	if (!ACCESS_ONCE(dvfs_info))
+		return;
+
+	spin_lock_irqsave(&dvfs_info->load_lock, flags);
+	if (temp == dvfs_info->temp) {
+		spin_unlock_irqrestore(&dvfs_info->load_lock, flags);
+		return;
+	}
+	dvfs_info->temp = temp;
+	spin_unlock_irqrestore(&dvfs_info->load_lock, flags);
+
+	if (ACCESS_ONCE(dvfs_info->users))
+		dvfs_mon_event(DVFS_MON_EV_TEMP);
+}
+EXPORT_SYMBOL_GPL(dvfs_monitor_report_temp);
+
+static int dvfs_mon_open(struct inode *inode, struct file *file)
+{
+	int ret = 0;
+
+	if (atomic_xchg(&dvfs_info->opened, 1) != 0)
+		return -EBUSY;
+
+	ret = dvfs_mon_get();
+	if (ret) {
+		atomic_set(&dvfs_info->opened, 0);
+		return ret;
+	}
+
+	atomic_set(&dvfs_info->num_events, 1);
+
+	return 0;
+}
+
+static int dvfs_mon_release(struct inode *inode, struct file *file)
+{
+	atomic_dec(&dvfs_info->opened);
+
+	return dvfs_mon_put();
+}
+
 static ssize_t dvfs_mon_read(struct file *file, char __user *buf,
 			 size_t count, loff_t *ppos)
 {
@@ -171,7 +303,9 @@ static ssize_t dvfs_mon_read(struct file *file, char __user *buf,
 	unsigned long nanosec_rem;
 	int freq, prev_freq;
 	char cpu_status[NR_CPUS * 8 + 1];
-	char temp[3];
+	char line[NR_CPUS * 8 + 48];
+	char temp[9];
+	size_t len;
 	int i;
 
 	wait_event_interruptible(dvfs_info->wait_queue,
@@ -195,9 +329,15 @@ static ssize_t dvfs_mon_read(struct file *file, char __user *buf,
 	t = cpu_clock(0);
 	nanosec_rem = do_div(t, 1000000000);
 
-	return sprintf(buf, "%lu.%06lu,%s%d,%d\n",
+	len = scnprintf(line, sizeof(line), "%lu.%06lu,%s%d,%d\n",
 		       (unsigned long) t, nanosec_rem / 1000,
 		       cpu_status, prev_freq, freq);
+	if (len > count)
+		return -EINVAL;
+	if (copy_to_user(buf, line, len))
+		return -EFAULT;
+
+	return len;
 }
 
 static const struct file_operations dvfs_mon_operations = {
@@ -206,26 +346,130 @@ static const struct file_operations dvfs_mon_operations = {
 	.release = dvfs_mon_release,
 };
 
+static bool dvfs_mon_changed(struct dvfs_mon_reader *reader)
+{
+	return ACCESS_ONCE(dvfs_info->record.seq) != reader->seq;
+}
+
+static int dvfs_mon_dev_open(struct inode *inode, struct file *file)
+{
+	struct dvfs_mon_reader *reader;
+	int ret;
+
+	reader = kzalloc(sizeof(*reader), GFP_KERNEL);
+	if (!reader)
+		return -ENOMEM;
+
+	ret = dvfs_mon_get();
+	if (ret) {
+		kfree(reader);
+		return ret;
+	}
+
+	/* the first read returns the current state at once */
+	reader->seq = ACCESS_ONCE(dvfs_info->record.seq) - 1;
+	file->private_data = reader;
+
+	return nonseekable_open(inode, file);
+}
+
+static int dvfs_mon_dev_release(struct inode *inode, struct file *file)
+{
+	kfree(file->private_data);
+
+	return dvfs_mon_put();
+}
+
+static ssize_t dvfs_mon_dev_read(struct file *file, char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct dvfs_mon_reader *reader = file->private_data;
+	struct dvfs_mon_record rec;
+	unsigned long flags;
+	int ret;
+
+	if (count < sizeof(rec))
+		return -EINVAL;
+
+	if (!dvfs_mon_changed(reader)) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+
+		ret = wait_event_interruptible(dvfs_info->wait_queue,
+					       dvfs_mon_changed(reader));
+		if (ret)
+			return ret;
+	}
+
+	spin_lock_irqsave(&dvfs_info->load_lock, flags);
+	rec = dvfs_info->record;
+	spin_unlock_irqrestore(&dvfs_info->load_lock, flags);
+
+	reader->seq = rec.seq;
+
+	if (copy_to_user(buf, &rec, sizeof(rec)))
+		return -EFAULT;
+
+	return sizeof(rec);
+}
+
+static unsigned int dvfs_mon_dev_poll(struct file *file, poll_table *wait)
+{
+	struct dvfs_mon_reader *reader = file->private_data;
+
+	poll_wait(file, &dvfs_info->wait_queue, wait);
+
+	return dvfs_mon_changed(reader) ? POLLIN | POLLRDNORM : 0;
+}
+
+static const struct file_operations dvfs_mon_dev_operations = {
+	.owner = THIS_MODULE,
+	.read = dvfs_mon_dev_read,
+	.poll = dvfs_mon_dev_poll,
+	.open = dvfs_mon_dev_open,
+	.release = dvfs_mon_dev_release,
+	.llseek = no_llseek,
+};
+
+static struct miscdevice dvfs_mon_device = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "dvfs_mon",
+	.fops = &dvfs_mon_dev_operations,
+};
+
 static int __init dvfs_monitor_init(void)
 {
-	dvfs_info = kzalloc(sizeof(struct dvfs_data), GFP_KERNEL);
-	if (dvfs_info == NULL) {
+	struct dvfs_data *info;
+
+	info = kzalloc(sizeof(struct dvfs_data), GFP_KERNEL);
+	if (info == NULL) {
 		pr_err("[DVFS_MON] cannot allocate memory\n");
 		return -ENOMEM;
 	}
 
-	spin_lock_init(&dvfs_info->load_lock);
+	spin_lock_init(&info->load_lock);
+	mutex_init(&info->users_lock);
+	info->gpu_load = DVFS_MON_UNKNOWN;
+	info->temp = DVFS_MON_UNKNOWN;
+
+	init_waitqueue_head(&info->wait_queue);
 
-	init_waitqueue_head(&dvfs_info->wait_queue);
+	/* the GPU and TMU may report from now on */
+	smp_wmb();
+	dvfs_info = info;
 
 	proc_create("dvfs_mon", S_IRUSR, NULL, &dvfs_mon_operations);
 
+	if (misc_register(&dvfs_mon_device))
+		pr_err("[DVFS_MON] cannot register /dev/dvfs_mon\n");
+
 	return 0;
 }
 late_initcall(dvfs_monitor_init);
 
 static void __exit dvfs_monitor_exit(void)
 {
+	misc_deregister(&dvfs_mon_device);
 	kfree(dvfs_info);
 	return;
 }
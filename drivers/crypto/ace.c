@@ -94,6 +94,18 @@ static int count_clk_delta;
 
 static int count_use_sw;
 
+#ifdef CONFIG_ACE_BC_ASYNC
+/*
+ * Requests shorter than this are run on the software fallback in the
+ * caller's context: for a few blocks the DMA setup, cache maintenance
+ * and tasklet round trip cost more than the cipher itself. It is below
+ * a sector so that dm-crypt keeps using the engine.
+ */
+static unsigned int sw_threshold = 256;
+module_param(sw_threshold, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(sw_threshold, "requests below this many bytes use SW AES");
+#endif
+
 #if defined(ACE_DEBUG_HEARTBEAT) || defined(ACE_DEBUG_WATCHDOG)
 #define ACE_HEARTBEAT_MS		10000
 #define ACE_WATCHDOG_MS			500
@@ -1028,6 +1040,24 @@ static void s5p_ace_bc_task(unsigned long data)
 	s5p_ace_aes_handle_req(dev);
 }
 
+static int s5p_ace_aes_crypt_sw(struct ablkcipher_request *req,
+				u32 encmode)
+{
+	struct s5p_ace_aes_ctx *sctx =
+		crypto_ablkcipher_ctx(crypto_ablkcipher_reqtfm(req));
+	struct blkcipher_desc desc = {
+		.tfm	= sctx->fallback_bc,
+		.info	= req->info,
+		.flags	= req->base.flags & CRYPTO_TFM_REQ_MAY_SLEEP,
+	};
+
+	if (encmode == BC_MODE_ENC)
+		return crypto_blkcipher_encrypt_iv(&desc, req->dst, req->src,
+						req->nbytes);
+	return crypto_blkcipher_decrypt_iv(&desc, req->dst, req->src,
+						req->nbytes);
+}
+
 static int s5p_ace_aes_crypt(struct ablkcipher_request *req, u32 encmode)
 {
 	struct s5p_ace_reqctx *rctx = ablkcipher_request_ctx(req);
@@ -1035,6 +1065,9 @@ static int s5p_ace_aes_crypt(struct ablkcipher_request *req, u32 encmode)
 	int ret;
 	unsigned long timeout;
 
+	if (req->nbytes < sw_threshold)
+		return s5p_ace_aes_crypt_sw(req, encmode);
+
 #ifdef ACE_DEBUG_WATCHDOG
 	do_gettimeofday(&timestamp[0]);		/* 0: request */
 #endif
@@ -2210,7 +2210,7 @@ static void __exit felica_exit(void)
 	FELICA_LOG_DEBUG("[MFDD] %s END", __func__);
 }
 
-module_init(felica_init);
+deferred_module_init(felica_init);
 module_exit(felica_exit);
 
 MODULE_DESCRIPTION("felica_dd");
@@ -0,0 +1,726 @@
+/**
+ * Continuous profiling mode for gator
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ */
+
+/*
+ * A Streamline capture needs a host draining /dev/gator/buffer at full rate.
+ * The continuous mode is meant to stay on in the field instead: every cpu
+ * samples the interrupted pc and, once a second, the enabled counters
+ * (events/<name>/enabled, as for a capture) into its own single producer
+ * ring. A deferrable work drains the rings every interval_ms, folds kernel
+ * samples into their function and user samples into their process, and sums
+ * the counters. Reading continuous/histogram returns what was gathered since
+ * the previous read and starts a new period.
+ *
+ * The time each cpu spends in the sampling interrupt is checked against
+ * budget (per mille of the cpu) on every pass; over budget that cpu samples
+ * half as often, well under it twice as often again. An idle cpu is sampled
+ * CONT_IDLE_STRIDE times less often so the mode costs few wakeups at rest.
+ *
+ * rate (Hz) is applied when the mode is enabled, budget and interval_ms at
+ * the next pass. The mode and a capture exclude each other.
+ */
+
+#include <linux/hash.h>
+#include <linux/kallsyms.h>
+#include <linux/pid.h>
+#include <linux/sort.h>
+#include <linux/workqueue.h>
+
+#define CONT_RING_SIZE		1024	// records per cpu, must be a power of 2
+#define CONT_HIST_BITS		11
+#define CONT_HIST_SIZE		(1 << CONT_HIST_BITS)
+#define CONT_HIST_PROBES	8
+#define CONT_MAX_COUNTERS	64
+#define CONT_MAX_STRIDE		64
+#define CONT_IDLE_STRIDE	8
+#define CONT_COUNTER_MS		1000	// well before a 32 bit cycle counter wraps
+#define CONT_IRQ_COST_NS	2000	// entry, exit and timer reprogramming, not seen by sched_clock()
+#define CONT_LINE_SIZE		80
+
+enum {CONT_KERNEL, CONT_USER, CONT_COUNTER};
+
+struct gator_cont_record {
+	u32 type;
+	u32 id;			// tgid of a user sample, key of a counter
+	u64 value;		// pc of a kernel sample, counter reading
+};
+
+struct gator_cont_cpu {
+	struct hrtimer hrtimer;
+	int active;
+	unsigned int stride;	// periods between samples, set by the aggregator
+	unsigned long next_counters;
+	struct gator_cont_record *ring;
+
+	// only written by the sampling interrupt
+	u32 head;
+	u32 dropped;
+	unsigned long cost_ns;
+
+	// only written by the aggregator
+	u32 tail;
+	u32 dropped_seen;
+	unsigned long cost_seen;
+};
+
+struct gator_cont_hist {
+	u64 value;		// function start or 0
+	u32 id;			// tgid or 0
+	u32 type;
+	unsigned long count;	// 0 for a free slot
+};
+
+struct gator_cont_counter {
+	u32 key;		// 0 for a free slot, key 0 is the timestamp
+	long long total;
+	long long last;
+};
+
+struct gator_cont_report {
+	char *text;
+	size_t len;
+	size_t size;
+};
+
+static unsigned long gator_cont_enabled;
+static unsigned long gator_cont_rate = 100;
+static unsigned long gator_cont_budget = 5;
+static unsigned long gator_cont_interval_ms = 1000;
+
+static u64 gator_cont_period_ns;
+static DEFINE_PER_CPU(struct gator_cont_cpu, gator_cont_cpu);
+static struct delayed_work gator_cont_work;
+
+// guarded by gator_cont_mutex
+static DEFINE_MUTEX(gator_cont_mutex);
+static struct gator_cont_hist *gator_cont_hist;
+static struct gator_cont_counter gator_cont_counters[CONT_MAX_COUNTERS];
+static unsigned long gator_cont_samples, gator_cont_dropped, gator_cont_lost;
+static ktime_t gator_cont_period_start, gator_cont_last;
+
+/******************************************************************************
+ * Sampling, in interrupt context on the sampled cpu
+ ******************************************************************************/
+static void gator_cont_push(struct gator_cont_cpu *gc, u32 type, u32 id, u64 value)
+{
+	struct gator_cont_record *rec;
+	u32 head = gc->head;
+
+	if (head - ACCESS_ONCE(gc->tail) >= CONT_RING_SIZE) {
+		gc->dropped++;
+		return;
+	}
+
+	rec = &gc->ring[head & (CONT_RING_SIZE - 1)];
+	rec->type = type;
+	rec->id = id;
+	rec->value = value;
+
+	// the record must be visible before the new head
+	smp_wmb();
+	gc->head = head + 1;
+}
+
+static void gator_cont_read_counters(struct gator_cont_cpu *gc)
+{
+	struct gator_interface *gi;
+	long long *buffer64;
+	int *buffer;
+	int i, len;
+
+	list_for_each_entry(gi, &gator_events, list) {
+		if (gi->read) {
+			len = gi->read(&buffer);
+			for (i = 0; i + 1 < len; i += 2)
+				gator_cont_push(gc, CONT_COUNTER, buffer[i], (s64)buffer[i + 1]);
+		} else if (gi->read64) {
+			len = gi->read64(&buffer64);
+			for (i = 0; i + 1 < len; i += 2)
+				gator_cont_push(gc, CONT_COUNTER, buffer64[i], buffer64[i + 1]);
+		}
+	}
+}
+
+static enum hrtimer_restart gator_cont_hrtimer_notify(struct hrtimer *hrtimer)
+{
+	struct gator_cont_cpu *gc = &__get_cpu_var(gator_cont_cpu);
+	struct pt_regs * const regs = get_irq_regs();
+	unsigned int periods = ACCESS_ONCE(gc->stride);
+	u64 start = sched_clock();
+
+	if (!regs || is_idle_task(current))
+		periods = min_t(unsigned int, periods * CONT_IDLE_STRIDE, CONT_MAX_STRIDE);
+	else if (user_mode(regs))
+		gator_cont_push(gc, CONT_USER, current->tgid, 0);
+	else
+		gator_cont_push(gc, CONT_KERNEL, 0, PC_REG);
+
+	if (time_after_eq(jiffies, gc->next_counters)) {
+		gc->next_counters = jiffies + msecs_to_jiffies(CONT_COUNTER_MS);
+		gator_cont_read_counters(gc);
+	}
+
+	gc->cost_ns += sched_clock() - start + CONT_IRQ_COST_NS;
+
+	hrtimer_forward_now(hrtimer, ns_to_ktime(gator_cont_period_ns * periods));
+	return HRTIMER_RESTART;
+}
+
+// This function runs in interrupt context and on the appropriate core
+static void gator_cont_online(void *unused)
+{
+	struct gator_cont_cpu *gc = &__get_cpu_var(gator_cont_cpu);
+	struct gator_interface *gi;
+	int *buffer;
+
+	if (gc->active || !gc->ring)
+		return;
+
+	// the first reading after online is not a delta, drop it
+	list_for_each_entry(gi, &gator_events, list)
+		if (gi->online)
+			gi->online(&buffer);
+
+	gc->active = 1;
+	gc->next_counters = jiffies + msecs_to_jiffies(CONT_COUNTER_MS);
+	hrtimer_init(&gc->hrtimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	gc->hrtimer.function = gator_cont_hrtimer_notify;
+	hrtimer_start(&gc->hrtimer, ns_to_ktime(gator_cont_period_ns), HRTIMER_MODE_REL_PINNED);
+}
+
+// This function runs in interrupt context and on the appropriate core
+static void gator_cont_offline(void *unused)
+{
+	struct gator_cont_cpu *gc = &__get_cpu_var(gator_cont_cpu);
+	struct gator_interface *gi;
+	int *buffer;
+
+	if (!gc->active)
+		return;
+
+	gc->active = 0;
+	hrtimer_cancel(&gc->hrtimer);
+
+	list_for_each_entry(gi, &gator_events, list)
+		if (gi->offline)
+			gi->offline(&buffer);
+}
+
+// These run in process context and may be running on a core other than core 'cpu'
+static void gator_cont_online_dispatch(int cpu)
+{
+	struct gator_interface *gi;
+
+	list_for_each_entry(gi, &gator_events, list)
+		if (gi->online_dispatch)
+			gi->online_dispatch(cpu);
+}
+
+static void gator_cont_offline_dispatch(int cpu)
+{
+	struct gator_interface *gi;
+
+	list_for_each_entry(gi, &gator_events, list)
+		if (gi->offline_dispatch)
+			gi->offline_dispatch(cpu);
+}
+
+/******************************************************************************
+ * Aggregation, in process context under gator_cont_mutex
+ ******************************************************************************/
+// kallsyms_lookup_size_offset() is not exported, take the offset from the text form
+static u64 gator_cont_func_start(unsigned long pc)
+{
+	char sym[KSYM_SYMBOL_LEN];
+	char *off;
+
+	sprint_symbol(sym, pc);
+	off = strchr(sym, '+');
+	if (!off)
+		return pc;
+
+	return pc - simple_strtoul(off + 1, NULL, 16);
+}
+
+static void gator_cont_hist_add(u32 type, u32 id, u64 value)
+{
+	struct gator_cont_hist *entry;
+	u32 hash = hash_64(value ^ ((u64)id << 32) ^ type, CONT_HIST_BITS);
+	int i;
+
+	gator_cont_samples++;
+
+	for (i = 0; i < CONT_HIST_PROBES; i++) {
+		entry = &gator_cont_hist[(hash + i) & (CONT_HIST_SIZE - 1)];
+		if (!entry->count) {
+			entry->type = type;
+			entry->id = id;
+			entry->value = value;
+			entry->count = 1;
+			return;
+		}
+		if (entry->type == type && entry->id == id && entry->value == value) {
+			entry->count++;
+			return;
+		}
+	}
+
+	gator_cont_lost++;
+}
+
+static void gator_cont_counter_add(u32 key, long long value)
+{
+	struct gator_cont_counter *counter;
+	int i;
+
+	for (i = 0; i < CONT_MAX_COUNTERS; i++) {
+		counter = &gator_cont_counters[i];
+		if (counter->key && counter->key != key)
+			continue;
+
+		counter->key = key;
+		counter->total += value;
+		counter->last = value;
+		return;
+	}
+}
+
+static void gator_cont_account(struct gator_cont_record *rec)
+{
+	switch (rec->type) {
+		case CONT_KERNEL:
+			gator_cont_hist_add(CONT_KERNEL, 0, gator_cont_func_start(rec->value));
+			break;
+		case CONT_USER:
+			gator_cont_hist_add(CONT_USER, rec->id, 0);
+			break;
+		case CONT_COUNTER:
+			gator_cont_counter_add(rec->id, rec->value);
+			break;
+	}
+}
+
+static void gator_cont_throttle(struct gator_cont_cpu *gc, u64 window_ns)
+{
+	unsigned long cost = ACCESS_ONCE(gc->cost_ns);
+	u64 used = (u64)(cost - gc->cost_seen) * 1000;
+	u64 allowed = window_ns * gator_cont_budget;
+
+	gc->cost_seen = cost;
+
+	// halving the stride doubles the cost, so only do it well under budget
+	if (used > allowed && gc->stride < CONT_MAX_STRIDE)
+		ACCESS_ONCE(gc->stride) = gc->stride * 2;
+	else if (used * 8 < allowed * 3 && gc->stride > 1)
+		ACCESS_ONCE(gc->stride) = gc->stride / 2;
+}
+
+static void gator_cont_aggregate(void)
+{
+	struct gator_cont_cpu *gc;
+	ktime_t now = ktime_get();
+	u64 window = ktime_to_ns(ktime_sub(now, gator_cont_last));
+	u32 head, tail, dropped;
+	int cpu;
+
+	for_each_present_cpu(cpu) {
+		gc = &per_cpu(gator_cont_cpu, cpu);
+		if (!gc->ring)
+			continue;
+
+		head = ACCESS_ONCE(gc->head);
+		// pairs with the barrier in gator_cont_push()
+		smp_rmb();
+		for (tail = gc->tail; tail != head; tail++)
+			gator_cont_account(&gc->ring[tail & (CONT_RING_SIZE - 1)]);
+		// the records must be consumed before their slots are handed back
+		smp_mb();
+		ACCESS_ONCE(gc->tail) = tail;
+
+		dropped = ACCESS_ONCE(gc->dropped);
+		gator_cont_dropped += dropped - gc->dropped_seen;
+		gc->dropped_seen = dropped;
+
+		gator_cont_throttle(gc, window);
+	}
+
+	gator_cont_last = now;
+}
+
+static unsigned long gator_cont_interval(void)
+{
+	return msecs_to_jiffies(clamp_val(gator_cont_interval_ms, 100, 60000));
+}
+
+static void gator_cont_work_fn(struct work_struct *work)
+{
+	mutex_lock(&gator_cont_mutex);
+	gator_cont_aggregate();
+	mutex_unlock(&gator_cont_mutex);
+
+	queue_delayed_work(system_power_efficient_wq, &gator_cont_work, gator_cont_interval());
+}
+
+/******************************************************************************
+ * cpu hotplug and pm notifiers
+ ******************************************************************************/
+static int __cpuinit gator_cont_hotcpu_notify(struct notifier_block *self, unsigned long action, void *hcpu)
+{
+	long cpu = (long)hcpu;
+
+	switch (action) {
+		case CPU_DOWN_PREPARE:
+		case CPU_DOWN_PREPARE_FROZEN:
+			smp_call_function_single(cpu, gator_cont_offline, NULL, 1);
+			gator_cont_offline_dispatch(cpu);
+			break;
+		case CPU_ONLINE:
+		case CPU_ONLINE_FROZEN:
+			gator_cont_online_dispatch(cpu);
+			smp_call_function_single(cpu, gator_cont_online, NULL, 1);
+			break;
+	}
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block __refdata gator_cont_hotcpu_notifier = {
+	.notifier_call = gator_cont_hotcpu_notify,
+};
+
+// the pmu loses its setup over suspend, take the counters down and up again
+static int gator_cont_pm_notify(struct notifier_block *nb, unsigned long event, void *dummy)
+{
+	int cpu;
+
+	switch (event) {
+		case PM_HIBERNATION_PREPARE:
+		case PM_SUSPEND_PREPARE:
+			unregister_hotcpu_notifier(&gator_cont_hotcpu_notifier);
+			on_each_cpu(gator_cont_offline, NULL, 1);
+			for_each_online_cpu(cpu) {
+				gator_cont_offline_dispatch(cpu);
+			}
+			break;
+		case PM_POST_HIBERNATION:
+		case PM_POST_SUSPEND:
+			for_each_online_cpu(cpu) {
+				gator_cont_online_dispatch(cpu);
+			}
+			on_each_cpu(gator_cont_online, NULL, 1);
+			register_hotcpu_notifier(&gator_cont_hotcpu_notifier);
+			break;
+	}
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block gator_cont_pm_notifier = {
+	.notifier_call = gator_cont_pm_notify,
+};
+
+/******************************************************************************
+ * Start and stop, under start_mutex
+ ******************************************************************************/
+static void gator_cont_free(void)
+{
+	struct gator_cont_cpu *gc;
+	int cpu;
+
+	mutex_lock(&gator_cont_mutex);
+	for_each_present_cpu(cpu) {
+		gc = &per_cpu(gator_cont_cpu, cpu);
+		vfree(gc->ring);
+		gc->ring = NULL;
+	}
+	vfree(gator_cont_hist);
+	gator_cont_hist = NULL;
+	mutex_unlock(&gator_cont_mutex);
+}
+
+static int gator_cont_alloc(void)
+{
+	struct gator_cont_cpu *gc;
+	int cpu;
+
+	gator_cont_hist = vzalloc(CONT_HIST_SIZE * sizeof(*gator_cont_hist));
+	if (!gator_cont_hist)
+		return -ENOMEM;
+
+	for_each_present_cpu(cpu) {
+		gc = &per_cpu(gator_cont_cpu, cpu);
+		memset(gc, 0, sizeof(*gc));
+		gc->stride = 1;
+		gc->ring = vmalloc(CONT_RING_SIZE * sizeof(*gc->ring));
+		if (!gc->ring) {
+			gator_cont_free();
+			return -ENOMEM;
+		}
+	}
+
+	memset(gator_cont_counters, 0, sizeof(gator_cont_counters));
+	gator_cont_samples = gator_cont_dropped = gator_cont_lost = 0;
+	gator_cont_period_start = gator_cont_last = ktime_get();
+
+	return 0;
+}
+
+static int gator_cont_start(void)
+{
+	struct gator_interface *gi;
+	int cpu, err;
+
+	if (gator_started || test_bit(0, &gator_buffer_opened))
+		return -EBUSY;
+
+	err = gator_cont_alloc();
+	if (err)
+		return err;
+
+	gator_cont_period_ns = NSEC_PER_SEC / clamp_val(gator_cont_rate, 1, 1000);
+
+	// start all events, only the enabled counters are set up
+	list_for_each_entry(gi, &gator_events, list) {
+		if (gi->start && gi->start() != 0) {
+			list_for_each_entry_continue_reverse(gi, &gator_events, list)
+				if (gi->stop)
+					gi->stop();
+			gator_cont_free();
+			return -EINVAL;
+		}
+	}
+
+	// before the cpus are brought up so that none is missed, going twice is harmless
+	register_hotcpu_notifier(&gator_cont_hotcpu_notifier);
+	register_pm_notifier(&gator_cont_pm_notifier);
+
+	for_each_online_cpu(cpu) {
+		gator_cont_online_dispatch(cpu);
+	}
+	on_each_cpu(gator_cont_online, NULL, 1);
+
+	INIT_DELAYED_WORK_DEFERRABLE(&gator_cont_work, gator_cont_work_fn);
+	queue_delayed_work(system_power_efficient_wq, &gator_cont_work, gator_cont_interval());
+
+	gator_cont_enabled = 1;
+	return 0;
+}
+
+static void gator_cont_stop(void)
+{
+	struct gator_interface *gi;
+	int cpu;
+
+	unregister_pm_notifier(&gator_cont_pm_notifier);
+	unregister_hotcpu_notifier(&gator_cont_hotcpu_notifier);
+
+	on_each_cpu(gator_cont_offline, NULL, 1);
+	for_each_online_cpu(cpu) {
+		gator_cont_offline_dispatch(cpu);
+	}
+
+	list_for_each_entry(gi, &gator_events, list)
+		if (gi->stop)
+			gi->stop();
+
+	cancel_delayed_work_sync(&gator_cont_work);
+	gator_cont_free();
+
+	gator_cont_enabled = 0;
+}
+
+static void gator_cont_shutdown(void)
+{
+	mutex_lock(&start_mutex);
+	if (gator_cont_enabled)
+		gator_cont_stop();
+	mutex_unlock(&start_mutex);
+}
+
+/******************************************************************************
+ * Filesystem
+ ******************************************************************************/
+static ssize_t gator_cont_enable_read(struct file *file, char __user *buf, size_t count, loff_t *offset)
+{
+	return gatorfs_ulong_to_user(gator_cont_enabled, buf, count, offset);
+}
+
+static ssize_t gator_cont_enable_write(struct file *file, char const __user *buf, size_t count, loff_t *offset)
+{
+	unsigned long val;
+	int retval;
+
+	if (*offset)
+		return -EINVAL;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	retval = gatorfs_ulong_from_user(&val, buf, count);
+	if (retval)
+		return retval;
+
+	mutex_lock(&start_mutex);
+	if (val && !gator_cont_enabled)
+		retval = gator_cont_start();
+	else if (!val && gator_cont_enabled)
+		gator_cont_stop();
+	mutex_unlock(&start_mutex);
+
+	if (retval)
+		return retval;
+	return count;
+}
+
+static const struct file_operations gator_cont_enable_fops = {
+	.read		= gator_cont_enable_read,
+	.write		= gator_cont_enable_write,
+};
+
+static int gator_cont_hist_cmp(const void *a, const void *b)
+{
+	unsigned long ca = ((const struct gator_cont_hist *)a)->count;
+	unsigned long cb = ((const struct gator_cont_hist *)b)->count;
+
+	return ca < cb ? 1 : ca > cb ? -1 : 0;
+}
+
+static __printf(2, 3) void gator_cont_print(struct gator_cont_report *r, const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	r->len += vscnprintf(r->text + r->len, r->size - r->len, fmt, args);
+	va_end(args);
+}
+
+static void gator_cont_print_entry(struct gator_cont_report *r, struct gator_cont_hist *entry)
+{
+	struct task_struct *task;
+
+	if (entry->type == CONT_KERNEL) {
+		gator_cont_print(r, "k %lu %ps\n", entry->count, (void *)(unsigned long)entry->value);
+		return;
+	}
+
+	rcu_read_lock();
+	task = pid_task(find_vpid(entry->id), PIDTYPE_PID);
+	gator_cont_print(r, "u %lu %u %s\n", entry->count, entry->id, task ? task->comm : "-");
+	rcu_read_unlock();
+}
+
+// the snapshot is taken once per open, reads return it
+static int gator_cont_hist_open(struct inode *inode, struct file *file)
+{
+	struct gator_cont_report *r;
+	struct gator_cont_hist *snap;
+	u64 period_ns;
+	ktime_t now;
+	int cpu, i, n = 0;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	r = kzalloc(sizeof(*r), GFP_KERNEL);
+	snap = vmalloc(CONT_HIST_SIZE * sizeof(*snap));
+	if (!r || !snap)
+		goto nomem;
+
+	r->size = CONT_LINE_SIZE * (CONT_HIST_SIZE + CONT_MAX_COUNTERS + nr_cpu_ids + 2);
+	r->text = vmalloc(r->size);
+	if (!r->text)
+		goto nomem;
+
+	mutex_lock(&gator_cont_mutex);
+
+	if (!gator_cont_hist) {
+		mutex_unlock(&gator_cont_mutex);
+		vfree(r->text);
+		vfree(snap);
+		kfree(r);
+		return -EINVAL;
+	}
+
+	gator_cont_aggregate();
+
+	for (i = 0; i < CONT_HIST_SIZE; i++)
+		if (gator_cont_hist[i].count)
+			snap[n++] = gator_cont_hist[i];
+	now = ktime_get();
+	period_ns = ktime_to_ns(ktime_sub(now, gator_cont_period_start));
+
+	gator_cont_print(r, "period_ms %llu\n", div_u64(period_ns, NSEC_PER_MSEC));
+	gator_cont_print(r, "samples %lu dropped %lu lost %lu\n",
+			 gator_cont_samples, gator_cont_dropped, gator_cont_lost);
+	for_each_present_cpu(cpu)
+		gator_cont_print(r, "cpu%d stride %u\n", cpu, per_cpu(gator_cont_cpu, cpu).stride);
+	for (i = 0; i < CONT_MAX_COUNTERS && gator_cont_counters[i].key; i++)
+		gator_cont_print(r, "counter %u %lld %lld\n", gator_cont_counters[i].key,
+				 gator_cont_counters[i].total, gator_cont_counters[i].last);
+
+	// the next read covers the time from here
+	memset(gator_cont_hist, 0, CONT_HIST_SIZE * sizeof(*gator_cont_hist));
+	memset(gator_cont_counters, 0, sizeof(gator_cont_counters));
+	gator_cont_samples = gator_cont_dropped = gator_cont_lost = 0;
+	gator_cont_period_start = now;
+
+	mutex_unlock(&gator_cont_mutex);
+
+	sort(snap, n, sizeof(*snap), gator_cont_hist_cmp, NULL);
+	for (i = 0; i < n; i++)
+		gator_cont_print_entry(r, &snap[i]);
+
+	vfree(snap);
+	file->private_data = r;
+	return 0;
+
+nomem:
+	if (r)
+		vfree(r->text);
+	vfree(snap);
+	kfree(r);
+	return -ENOMEM;
+}
+
+static ssize_t gator_cont_hist_read(struct file *file, char __user *buf, size_t count, loff_t *offset)
+{
+	struct gator_cont_report *r = file->private_data;
+
+	return simple_read_from_buffer(buf, count, offset, r->text, r->len);
+}
+
+static int gator_cont_hist_release(struct inode *inode, struct file *file)
+{
+	struct gator_cont_report *r = file->private_data;
+
+	vfree(r->text);
+	kfree(r);
+	return 0;
+}
+
+static const struct file_operations gator_cont_hist_fops = {
+	.open		= gator_cont_hist_open,
+	.read		= gator_cont_hist_read,
+	.release	= gator_cont_hist_release,
+};
+
+static void gator_cont_create_files(struct super_block *sb, struct dentry *root)
+{
+	struct dentry *dir;
+
+	dir = gatorfs_mkdir(sb, root, "continuous");
+	if (!dir)
+		return;
+
+	gatorfs_create_file(sb, dir, "enable", &gator_cont_enable_fops);
+	gatorfs_create_file_perm(sb, dir, "histogram", &gator_cont_hist_fops, 0400);
+	gatorfs_create_ulong(sb, dir, "rate", &gator_cont_rate);
+	gatorfs_create_ulong(sb, dir, "budget", &gator_cont_budget);
+	gatorfs_create_ulong(sb, dir, "interval_ms", &gator_cont_interval_ms);
+}
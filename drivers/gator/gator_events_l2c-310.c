@@ -11,6 +11,7 @@
 #include <linux/init.h>
 #include <linux/io.h>
 #include <asm/hardware/cache-l2x0.h>
+#include <asm/pmu.h>
 
 #include "gator.h"
 
@@ -26,6 +27,8 @@ static int l2c310_buffer[L2C310_COUNTERS_NUM * 2];
 
 static void __iomem *l2c310_base;
 
+static bool l2c310_reserved;
+
 
 
 static void gator_events_l2c310_reset_counters(void)
@@ -70,6 +73,13 @@ static int gator_events_l2c310_start(void)
 	};
 	int i;
 
+	/* perf may have the counters, go without them rather than fail */
+	if (reserve_pmu(ARM_PMU_DEVICE_L2X0)) {
+		pr_warning("gator: L2C-310 counters are in use\n");
+		return 0;
+	}
+	l2c310_reserved = true;
+
 	/* Counter event sources */
 	for (i = 0; i < L2C310_COUNTERS_NUM; i++)
 		writel((l2c310_counters[i].event & 0xf) << 2,
@@ -85,8 +95,14 @@ static int gator_events_l2c310_start(void)
 
 static void gator_events_l2c310_stop(void)
 {
+	if (!l2c310_reserved)
+		return;
+
 	/* Event counter disable */
 	writel(0, l2c310_base + L2X0_EVENT_CNT_CTRL);
+
+	release_pmu(ARM_PMU_DEVICE_L2X0);
+	l2c310_reserved = false;
 }
 
 static int gator_events_l2c310_read(int **buffer)
@@ -98,7 +114,7 @@ static int gator_events_l2c310_read(int **buffer)
 	int i;
 	int len = 0;
 
-	if (smp_processor_id())
+	if (smp_processor_id() || !l2c310_reserved)
 		return 0;
 
 	for (i = 0; i < L2C310_COUNTERS_NUM; i++) {
@@ -150,6 +150,7 @@ static DEFINE_PER_CPU(char *[NUM_GATOR_BUFS], gator_buffer);
 #include "gator_fs.c"
 #include "gator_ebs.c"
 #include "gator_pack.c"
+#include "gator_continuous.c"
 
 /******************************************************************************
  * Misc
@@ -709,6 +710,12 @@ static int gator_op_setup(void)
 
 	mutex_lock(&start_mutex);
 
+	// the continuous mode owns the counters and the sampling interrupt
+	if (gator_cont_enabled) {
+		err = -EBUSY;
+		goto setup_error;
+	}
+
 	gator_buffer_size[BACKTRACE_BUF] = BACKTRACE_BUFFER_SIZE;
 	gator_buffer_mask[BACKTRACE_BUF] = BACKTRACE_BUFFER_SIZE - 1;
 
@@ -1045,6 +1052,9 @@ void gator_op_create_files(struct super_block *sb, struct dentry *root)
 	// Annotate interface
 	gator_annotate_create_files(sb, root);
 
+	// Continuous profiling interface
+	gator_cont_create_files(sb, root);
+
 	// Linux Events
 	dir = gatorfs_mkdir(sb, root, "events");
 	list_for_each_entry(gi, &gator_events, list)
@@ -1074,11 +1084,12 @@ static int __init gator_module_init(void)
 
 static void __exit gator_module_exit(void)
 {
+	gator_cont_shutdown();
 	tracepoint_synchronize_unregister();
 	gatorfs_unregister();
 }
 
-module_init(gator_module_init);
+deferred_module_init(gator_module_init);
 module_exit(gator_module_exit);
 
 MODULE_LICENSE("GPL");
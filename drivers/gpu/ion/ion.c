@@ -15,6 +15,7 @@
  */
 
 #include <linux/device.h>
+#include <linux/dma-buf.h>
 #include <linux/file.h>
 #include <linux/fs.h>
 #include <linux/anon_inodes.h>
@@ -154,6 +155,8 @@ static struct ion_buffer *ion_buffer_create(struct ion_heap *heap,
 	}
 	buffer->dev = dev;
 	buffer->size = len;
+	/* the heap may have cleared it through a cached mapping */
+	buffer->cpu_dirty = true;
 	mutex_init(&buffer->lock);
 	ion_buffer_add(dev, buffer);
 	return buffer;
@@ -714,6 +717,282 @@ struct ion_handle *ion_import_uva(struct ion_client *client, unsigned long uva,
 	return handle;
 }
 
+/*
+ * dma_buf export. Cache ownership is tracked per buffer: mapping the buffer
+ * for a device only cleans the cpu caches when the cpu may have written it
+ * since the last device mapping, and begin_cpu_access only invalidates when
+ * a device may have written it. A buffer handed from camera to codec to
+ * display is therefore not cleaned again at every hop.
+ */
+static bool ion_buffer_cached(struct ion_buffer *buffer)
+{
+#ifdef CONFIG_ION_EXYNOS
+	return !(buffer->flags & ION_EXYNOS_NONCACHE_MASK);
+#else
+	return true;
+#endif
+}
+
+static int ion_sg_nents(struct scatterlist *sglist)
+{
+	struct scatterlist *sg;
+	int nents = 0;
+
+	for (sg = sglist; sg; sg = sg_next(sg))
+		nents++;
+	return nents;
+}
+
+static struct sg_table *ion_dma_buf_map(struct dma_buf_attachment *attachment,
+					enum dma_data_direction direction)
+{
+	struct ion_buffer *buffer = attachment->dmabuf->priv;
+	struct scatterlist *sg;
+	struct sg_table *table;
+	int i;
+
+	if (!buffer->heap->ops->map_dma)
+		return ERR_PTR(-ENODEV);
+
+	table = kzalloc(sizeof(*table), GFP_KERNEL);
+	if (!table)
+		return ERR_PTR(-ENOMEM);
+
+	mutex_lock(&buffer->lock);
+	if (buffer->dmap_cnt++ == 0) {
+		buffer->sglist = buffer->heap->ops->map_dma(buffer->heap,
+							    buffer);
+		if (IS_ERR_OR_NULL(buffer->sglist)) {
+			struct scatterlist *err = buffer->sglist;
+
+			buffer->dmap_cnt--;
+			buffer->sglist = NULL;
+			mutex_unlock(&buffer->lock);
+			kfree(table);
+			return err ? ERR_CAST(err) : ERR_PTR(-ENOMEM);
+		}
+	}
+
+	table->sgl = buffer->sglist;
+	table->nents = table->orig_nents = ion_sg_nents(buffer->sglist);
+	for_each_sg(table->sgl, sg, table->nents, i)
+		sg_dma_address(sg) = sg_phys(sg);
+
+	if (ion_buffer_cached(buffer)) {
+		if (buffer->cpu_dirty || buffer->umap_cnt) {
+			dma_sync_sg_for_device(NULL, table->sgl, table->nents,
+					       direction);
+			buffer->cpu_dirty = false;
+		}
+		if (direction != DMA_TO_DEVICE)
+			buffer->dev_dirty = true;
+	}
+	mutex_unlock(&buffer->lock);
+
+	return table;
+}
+
+static void ion_dma_buf_unmap(struct dma_buf_attachment *attachment,
+			      struct sg_table *table,
+			      enum dma_data_direction direction)
+{
+	struct ion_buffer *buffer = attachment->dmabuf->priv;
+
+	mutex_lock(&buffer->lock);
+	if (--buffer->dmap_cnt == 0) {
+		buffer->heap->ops->unmap_dma(buffer->heap, buffer);
+		buffer->sglist = NULL;
+	}
+	mutex_unlock(&buffer->lock);
+	kfree(table);
+}
+
+static int ion_dma_buf_begin_cpu_access(struct dma_buf *dmabuf, size_t start,
+					size_t len,
+					enum dma_data_direction direction)
+{
+	struct ion_buffer *buffer = dmabuf->priv;
+	struct scatterlist *sglist;
+
+	if (!ion_buffer_cached(buffer) || !buffer->heap->ops->map_dma)
+		return 0;
+
+	mutex_lock(&buffer->lock);
+	if (buffer->dev_dirty) {
+		sglist = buffer->sglist;
+		if (!sglist)
+			sglist = buffer->heap->ops->map_dma(buffer->heap,
+							    buffer);
+		if (IS_ERR_OR_NULL(sglist)) {
+			mutex_unlock(&buffer->lock);
+			return -ENOMEM;
+		}
+		dma_sync_sg_for_cpu(NULL, sglist, ion_sg_nents(sglist),
+				    DMA_FROM_DEVICE);
+		if (!buffer->sglist)
+			buffer->heap->ops->unmap_dma(buffer->heap, buffer);
+		buffer->dev_dirty = false;
+	}
+	mutex_unlock(&buffer->lock);
+	return 0;
+}
+
+static void ion_dma_buf_end_cpu_access(struct dma_buf *dmabuf, size_t start,
+				       size_t len,
+				       enum dma_data_direction direction)
+{
+	struct ion_buffer *buffer = dmabuf->priv;
+
+	/* the cpu only read the buffer for DMA_FROM_DEVICE */
+	if (direction != DMA_FROM_DEVICE) {
+		mutex_lock(&buffer->lock);
+		buffer->cpu_dirty = true;
+		mutex_unlock(&buffer->lock);
+	}
+}
+
+static void *ion_dma_buf_kmap(struct dma_buf *dmabuf, unsigned long offset)
+{
+	struct ion_buffer *buffer = dmabuf->priv;
+	void *vaddr;
+
+	if (!buffer->heap->ops->map_kernel)
+		return NULL;
+
+	mutex_lock(&buffer->lock);
+	if (buffer->kmap_cnt++ == 0) {
+		vaddr = buffer->heap->ops->map_kernel(buffer->heap, buffer);
+		if (IS_ERR_OR_NULL(vaddr)) {
+			buffer->kmap_cnt--;
+			mutex_unlock(&buffer->lock);
+			return NULL;
+		}
+		buffer->vaddr = vaddr;
+	}
+	/* writes through the kernel mapping are not tracked */
+	buffer->cpu_dirty = true;
+	vaddr = buffer->vaddr + offset * PAGE_SIZE;
+	mutex_unlock(&buffer->lock);
+
+	return vaddr;
+}
+
+static void ion_dma_buf_kunmap(struct dma_buf *dmabuf, unsigned long offset,
+			       void *ptr)
+{
+	struct ion_buffer *buffer = dmabuf->priv;
+
+	mutex_lock(&buffer->lock);
+	if (--buffer->kmap_cnt == 0) {
+		buffer->heap->ops->unmap_kernel(buffer->heap, buffer);
+		buffer->vaddr = NULL;
+	}
+	mutex_unlock(&buffer->lock);
+}
+
+static void *ion_dma_buf_kmap_atomic(struct dma_buf *dmabuf,
+				     unsigned long offset)
+{
+	/* map_kernel may sleep */
+	return NULL;
+}
+
+static void ion_dma_buf_vm_open(struct vm_area_struct *vma)
+{
+	struct ion_buffer *buffer = vma->vm_private_data;
+
+	mutex_lock(&buffer->lock);
+	buffer->umap_cnt++;
+	mutex_unlock(&buffer->lock);
+}
+
+static void ion_dma_buf_vm_close(struct vm_area_struct *vma)
+{
+	struct ion_buffer *buffer = vma->vm_private_data;
+
+	mutex_lock(&buffer->lock);
+	buffer->umap_cnt--;
+	mutex_unlock(&buffer->lock);
+}
+
+static struct vm_operations_struct ion_dma_buf_vm_ops = {
+	.open = ion_dma_buf_vm_open,
+	.close = ion_dma_buf_vm_close,
+};
+
+static int ion_dma_buf_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma)
+{
+	struct ion_buffer *buffer = dmabuf->priv;
+	int ret;
+
+	if (!buffer->heap->ops->map_user)
+		return -EINVAL;
+
+	mutex_lock(&buffer->lock);
+	ret = buffer->heap->ops->map_user(buffer->heap, buffer, vma);
+	mutex_unlock(&buffer->lock);
+	if (ret)
+		return ret;
+
+	/* the vma keeps the dma_buf file, and with it the buffer, alive */
+	vma->vm_ops = &ion_dma_buf_vm_ops;
+	vma->vm_private_data = buffer;
+	ion_dma_buf_vm_open(vma);
+	return 0;
+}
+
+static void ion_dma_buf_release(struct dma_buf *dmabuf)
+{
+	ion_buffer_put(dmabuf->priv);
+}
+
+static struct dma_buf_ops ion_dma_buf_ops = {
+	.map_dma_buf		= ion_dma_buf_map,
+	.unmap_dma_buf		= ion_dma_buf_unmap,
+	.release		= ion_dma_buf_release,
+	.begin_cpu_access	= ion_dma_buf_begin_cpu_access,
+	.end_cpu_access		= ion_dma_buf_end_cpu_access,
+	.kmap_atomic		= ion_dma_buf_kmap_atomic,
+	.kmap			= ion_dma_buf_kmap,
+	.kunmap			= ion_dma_buf_kunmap,
+	.mmap			= ion_dma_buf_mmap,
+};
+
+struct dma_buf *ion_share_dma_buf(struct ion_client *client,
+				  struct ion_handle *handle)
+{
+	struct ion_buffer *buffer;
+	struct dma_buf *dmabuf;
+
+	buffer = ion_share(client, handle);
+	if (IS_ERR(buffer))
+		return ERR_CAST(buffer);
+
+	ion_buffer_get(buffer);
+	dmabuf = dma_buf_export(buffer, &ion_dma_buf_ops, buffer->size,
+				O_RDWR);
+	if (IS_ERR(dmabuf))
+		ion_buffer_put(buffer);
+
+	return dmabuf;
+}
+
+int ion_share_dma_buf_fd(struct ion_client *client, struct ion_handle *handle)
+{
+	struct dma_buf *dmabuf;
+	int fd;
+
+	dmabuf = ion_share_dma_buf(client, handle);
+	if (IS_ERR(dmabuf))
+		return PTR_ERR(dmabuf);
+
+	fd = dma_buf_fd(dmabuf, O_CLOEXEC);
+	if (fd < 0)
+		dma_buf_put(dmabuf);
+
+	return fd;
+}
+
 static int ion_debug_client_show(struct seq_file *s, void *unused)
 {
 	struct ion_client *client = s->private;
@@ -1174,6 +1453,27 @@ static long ion_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 			return -EFAULT;
 		break;
 	}
+	case ION_IOC_SHARE_DMA_BUF:
+	{
+		struct ion_fd_data data;
+
+		if (copy_from_user(&data, (void __user *)arg, sizeof(data)))
+			return -EFAULT;
+		mutex_lock(&client->lock);
+		if (!ion_handle_validate(client, data.handle)) {
+			pr_err("%s: invalid handle passed to share ioctl.\n",
+			       __func__);
+			mutex_unlock(&client->lock);
+			return -EINVAL;
+		}
+		mutex_unlock(&client->lock);
+		data.fd = ion_share_dma_buf_fd(client, data.handle);
+		if (data.fd < 0)
+			return data.fd;
+		if (copy_to_user((void __user *)arg, &data, sizeof(data)))
+			return -EFAULT;
+		break;
+	}
 	case ION_IOC_IMPORT:
 	{
 		struct ion_fd_data data;
@@ -1285,6 +1585,9 @@ static int ion_debug_heap_show(struct seq_file *s, void *unused)
 		seq_printf(s, "%16.s %16u %16u\n", client->name, client->pid,
 			   size);
 	}
+
+	if (heap->debug_show)
+		heap->debug_show(heap, s);
 	return 0;
 }
 
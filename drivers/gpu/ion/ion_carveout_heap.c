@@ -20,17 +20,35 @@
 #include <linux/io.h>
 #include <linux/ion.h>
 #include <linux/mm.h>
+#include <linux/module.h>
 #include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include "ion_priv.h"
 
 #include <asm/mach/map.h>
+#include <asm/sizes.h>
+
+/*
+ * Camera and video buffers of a few megabytes are allocated and freed
+ * in between small overlay and metadata buffers.  With a single first
+ * fit the small ones end up scattered all over the carveout and after
+ * a while no hole is big enough for a large buffer, even with plenty
+ * free.  Buffers of at least large_size are taken from the top of the
+ * carveout and smaller ones from the bottom, so each kind packs against
+ * its own end and the free space stays in one piece in the middle.
+ */
+static unsigned long large_size = SZ_1M;
+module_param(large_size, ulong, 0644);
 
 struct ion_carveout_heap {
 	struct ion_heap heap;
 	struct gen_pool *pool;
 	ion_phys_addr_t base;
+	atomic_t nr_large;
+	atomic_t nr_small;
+	atomic_t nr_failed;
+	atomic_t nr_fragmented;	/* failed with enough free in total */
 };
 
 ion_phys_addr_t ion_carveout_allocate(struct ion_heap *heap,
@@ -39,10 +57,22 @@ ion_phys_addr_t ion_carveout_allocate(struct ion_heap *heap,
 {
 	struct ion_carveout_heap *carveout_heap =
 		container_of(heap, struct ion_carveout_heap, heap);
-	unsigned long offset = gen_pool_alloc(carveout_heap->pool, size);
+	unsigned long offset;
+
+	if (size >= large_size) {
+		offset = gen_pool_alloc_top(carveout_heap->pool, size);
+		atomic_inc(&carveout_heap->nr_large);
+	} else {
+		offset = gen_pool_alloc(carveout_heap->pool, size);
+		atomic_inc(&carveout_heap->nr_small);
+	}
 
-	if (!offset)
+	if (!offset) {
+		atomic_inc(&carveout_heap->nr_failed);
+		if (gen_pool_avail(carveout_heap->pool) >= size)
+			atomic_inc(&carveout_heap->nr_fragmented);
 		return ION_CARVEOUT_ALLOCATE_FAIL;
+	}
 
 	return offset;
 }
@@ -122,6 +152,26 @@ int ion_carveout_heap_map_user(struct ion_heap *heap, struct ion_buffer *buffer,
 			       pgprot_noncached(vma->vm_page_prot));
 }
 
+static int ion_carveout_heap_debug_show(struct ion_heap *heap,
+					struct seq_file *s)
+{
+	struct ion_carveout_heap *carveout_heap =
+		container_of(heap, struct ion_carveout_heap, heap);
+	size_t size = gen_pool_size(carveout_heap->pool);
+	size_t avail = gen_pool_avail(carveout_heap->pool);
+
+	seq_printf(s, "\ncarveout %zu allocated, %zu free, %zu largest free\n",
+		   size - avail, avail,
+		   gen_pool_largest_free(carveout_heap->pool));
+	seq_printf(s, "allocations %d large, %d small, %d failed, "
+		   "%d failed on fragmentation\n",
+		   atomic_read(&carveout_heap->nr_large),
+		   atomic_read(&carveout_heap->nr_small),
+		   atomic_read(&carveout_heap->nr_failed),
+		   atomic_read(&carveout_heap->nr_fragmented));
+	return 0;
+}
+
 static struct ion_heap_ops carveout_heap_ops = {
 	.allocate = ion_carveout_heap_allocate,
 	.free = ion_carveout_heap_free,
@@ -149,6 +199,7 @@ struct ion_heap *ion_carveout_heap_create(struct ion_platform_heap *heap_data)
 		     -1);
 	carveout_heap->heap.ops = &carveout_heap_ops;
 	carveout_heap->heap.type = ION_HEAP_TYPE_CARVEOUT;
+	carveout_heap->heap.debug_show = ion_carveout_heap_debug_show;
 
 	return &carveout_heap->heap;
 }
@@ -14,84 +14,315 @@
  *
  */
 
+#include <linux/dma-mapping.h>
 #include <linux/err.h>
+#include <linux/freezer.h>
+#include <linux/highmem.h>
 #include <linux/ion.h>
+#include <linux/kthread.h>
 #include <linux/mm.h>
 #include <linux/scatterlist.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/vmalloc.h>
+#include <linux/wait.h>
 #include "ion_priv.h"
 
+static gfp_t high_order_gfp_flags = (GFP_HIGHUSER | __GFP_ZERO |
+					    __GFP_NOWARN | __GFP_NORETRY |
+					    __GFP_COMP) & ~__GFP_WAIT;
+static gfp_t low_order_gfp_flags  = (GFP_HIGHUSER | __GFP_ZERO |
+					    __GFP_NOWARN | __GFP_COMP);
+static const unsigned int orders[] = {8, 4, 0};
+static const int num_orders = ARRAY_SIZE(orders);
+
+static int order_to_index(unsigned int order)
+{
+	int i;
+
+	for (i = 0; i < num_orders; i++)
+		if (order == orders[i])
+			return i;
+	BUG();
+	return -1;
+}
+
+static unsigned int order_to_size(int order)
+{
+	return PAGE_SIZE << order;
+}
+
+/*
+ * Pages are handed back to the pools by a kernel thread rather than by
+ * the task dropping the last reference, so that clearing and flushing a
+ * large gralloc or camera buffer does not stall the compositor or the
+ * camera HAL in ION_IOC_FREE or close().
+ */
+struct ion_system_heap {
+	struct ion_heap heap;
+	struct ion_page_pool *pools[ARRAY_SIZE(orders)];
+	struct shrinker shrinker;
+	spinlock_t free_lock;
+	struct list_head free_list;
+	size_t free_list_size;
+	wait_queue_head_t waitqueue;
+	struct task_struct *task;
+};
+
+struct ion_system_buffer {
+	struct sg_table table;
+	struct list_head list;
+	size_t size;
+};
+
+static struct ion_system_heap *to_system_heap(struct ion_heap *heap)
+{
+	return container_of(heap, struct ion_system_heap, heap);
+}
+
+static struct page *alloc_largest_available(struct ion_system_heap *heap,
+					    unsigned long size,
+					    unsigned int max_order)
+{
+	struct page *page;
+	int i;
+
+	for (i = 0; i < num_orders; i++) {
+		if (size < order_to_size(orders[i]))
+			continue;
+		if (max_order < orders[i])
+			continue;
+
+		page = ion_page_pool_alloc(heap->pools[i]);
+		if (!page)
+			continue;
+		return page;
+	}
+	return NULL;
+}
+
+static void ion_system_heap_return_pages(struct ion_system_heap *heap,
+					 struct sg_table *table)
+{
+	struct scatterlist *sg;
+	int i;
+
+	for_each_sg(table->sgl, sg, table->orig_nents, i) {
+		struct page *page = sg_page(sg);
+
+		ion_page_pool_free(heap->pools[
+				order_to_index(compound_order(page))], page);
+	}
+}
+
 static int ion_system_heap_allocate(struct ion_heap *heap,
 				     struct ion_buffer *buffer,
 				     unsigned long size, unsigned long align,
 				     unsigned long flags)
 {
-	buffer->priv_virt = vmalloc_user(size);
-	if (!buffer->priv_virt)
-		return -ENOMEM;
+	struct ion_system_heap *sys_heap = to_system_heap(heap);
+	struct ion_system_buffer *sys_buffer;
+	struct sg_table *table;
+	struct scatterlist *sg;
+	struct page *page, *tmp_page;
+	LIST_HEAD(pages);
+	unsigned long size_remaining = PAGE_ALIGN(size);
+	unsigned int max_order = orders[0];
+	int i = 0;
+
+	while (size_remaining > 0) {
+		page = alloc_largest_available(sys_heap, size_remaining,
+					       max_order);
+		if (!page)
+			goto err;
+		list_add_tail(&page->lru, &pages);
+		size_remaining -= PAGE_SIZE << compound_order(page);
+		max_order = compound_order(page);
+		i++;
+	}
+
+	sys_buffer = kzalloc(sizeof(*sys_buffer), GFP_KERNEL);
+	if (!sys_buffer)
+		goto err;
+	table = &sys_buffer->table;
+
+	if (sg_alloc_table(table, i, GFP_KERNEL))
+		goto err_free_buffer;
+
+	sg = table->sgl;
+	list_for_each_entry_safe(page, tmp_page, &pages, lru) {
+		sg_set_page(sg, page, PAGE_SIZE << compound_order(page), 0);
+		sg = sg_next(sg);
+		list_del(&page->lru);
+	}
+
+	sys_buffer->size = size;
+	buffer->priv_virt = sys_buffer;
+	buffer->flags = flags;
 	return 0;
+
+err_free_buffer:
+	kfree(sys_buffer);
+err:
+	list_for_each_entry_safe(page, tmp_page, &pages, lru) {
+		list_del(&page->lru);
+		ion_page_pool_free(sys_heap->pools[
+				order_to_index(compound_order(page))], page);
+	}
+	return -ENOMEM;
 }
 
 void ion_system_heap_free(struct ion_buffer *buffer)
 {
-	vfree(buffer->priv_virt);
+	struct ion_system_heap *sys_heap = to_system_heap(buffer->heap);
+	struct ion_system_buffer *sys_buffer = buffer->priv_virt;
+
+	spin_lock(&sys_heap->free_lock);
+	list_add_tail(&sys_buffer->list, &sys_heap->free_list);
+	sys_heap->free_list_size += sys_buffer->size;
+	spin_unlock(&sys_heap->free_lock);
+	wake_up(&sys_heap->waitqueue);
+}
+
+/*
+ * Pages go back into the pools zeroed and clean in the cache, which is
+ * the state ion_page_pool_alloc_pages() hands out fresh pages in.
+ */
+static void ion_system_heap_scrub(struct sg_table *table)
+{
+	struct scatterlist *sg;
+	int i, j;
+
+	for_each_sg(table->sgl, sg, table->orig_nents, i) {
+		struct page *page = sg_page(sg);
+		unsigned int npages = sg->length >> PAGE_SHIFT;
+
+		for (j = 0; j < npages; j++)
+			clear_highpage(page + j);
+		__dma_page_cpu_to_dev(page, 0, sg->length, DMA_BIDIRECTIONAL);
+	}
+}
+
+static void ion_system_heap_drain(struct ion_system_heap *sys_heap)
+{
+	struct ion_system_buffer *sys_buffer;
+
+	spin_lock(&sys_heap->free_lock);
+	while (!list_empty(&sys_heap->free_list)) {
+		sys_buffer = list_first_entry(&sys_heap->free_list,
+					      struct ion_system_buffer, list);
+		list_del(&sys_buffer->list);
+		sys_heap->free_list_size -= sys_buffer->size;
+		spin_unlock(&sys_heap->free_lock);
+
+		ion_system_heap_scrub(&sys_buffer->table);
+		ion_system_heap_return_pages(sys_heap, &sys_buffer->table);
+		sg_free_table(&sys_buffer->table);
+		kfree(sys_buffer);
+
+		spin_lock(&sys_heap->free_lock);
+	}
+	spin_unlock(&sys_heap->free_lock);
+}
+
+static int ion_system_heap_deferred_free(void *data)
+{
+	struct ion_system_heap *sys_heap = data;
+
+	set_freezable();
+	while (!kthread_should_stop()) {
+		wait_event_freezable(sys_heap->waitqueue,
+				     !list_empty(&sys_heap->free_list) ||
+				     kthread_should_stop());
+		ion_system_heap_drain(sys_heap);
+	}
+
+	return 0;
 }
 
 struct scatterlist *ion_system_heap_map_dma(struct ion_heap *heap,
 					    struct ion_buffer *buffer)
 {
-	struct scatterlist *sglist;
-	struct page *page;
-	int i;
-	int npages = PAGE_ALIGN(buffer->size) / PAGE_SIZE;
-	void *vaddr = buffer->priv_virt;
+	struct ion_system_buffer *sys_buffer = buffer->priv_virt;
 
-	sglist = vmalloc(npages * sizeof(struct scatterlist));
-	if (!sglist)
-		return ERR_PTR(-ENOMEM);
-	memset(sglist, 0, npages * sizeof(struct scatterlist));
-	sg_init_table(sglist, npages);
-	for (i = 0; i < npages; i++) {
-		page = vmalloc_to_page(vaddr);
-		if (!page)
-			goto end;
-		sg_set_page(&sglist[i], page, PAGE_SIZE, 0);
-		vaddr += PAGE_SIZE;
-	}
-	/* XXX do cache maintenance for dma? */
-	return sglist;
-end:
-	vfree(sglist);
-	return NULL;
+	return sys_buffer->table.sgl;
 }
 
 void ion_system_heap_unmap_dma(struct ion_heap *heap,
 			       struct ion_buffer *buffer)
 {
-	/* XXX undo cache maintenance for dma? */
-	if (buffer->sglist)
-		vfree(buffer->sglist);
 }
 
 void *ion_system_heap_map_kernel(struct ion_heap *heap,
 				 struct ion_buffer *buffer)
 {
-	return buffer->priv_virt;
+	struct ion_system_buffer *sys_buffer = buffer->priv_virt;
+	struct scatterlist *sg;
+	struct page **pages, **tmp;
+	int npages = PAGE_ALIGN(buffer->size) / PAGE_SIZE;
+	void *vaddr;
+	int i, j;
+
+	pages = vmalloc(sizeof(struct page *) * npages);
+	if (!pages)
+		return ERR_PTR(-ENOMEM);
+
+	tmp = pages;
+	for_each_sg(sys_buffer->table.sgl, sg, sys_buffer->table.orig_nents, i) {
+		int npages_this_entry = PAGE_ALIGN(sg->length) / PAGE_SIZE;
+		struct page *page = sg_page(sg);
+
+		for (j = 0; j < npages_this_entry; j++)
+			*(tmp++) = page++;
+	}
+
+	vaddr = vmap(pages, npages, VM_MAP, PAGE_KERNEL);
+	vfree(pages);
+
+	return vaddr ? vaddr : ERR_PTR(-ENOMEM);
 }
 
 void ion_system_heap_unmap_kernel(struct ion_heap *heap,
 				  struct ion_buffer *buffer)
 {
+	vunmap(buffer->vaddr);
 }
 
 int ion_system_heap_map_user(struct ion_heap *heap, struct ion_buffer *buffer,
 			     struct vm_area_struct *vma)
 {
-	return remap_vmalloc_range(vma, buffer->priv_virt, vma->vm_pgoff);
+	struct ion_system_buffer *sys_buffer = buffer->priv_virt;
+	unsigned long addr = vma->vm_start;
+	unsigned long offset = vma->vm_pgoff;
+	struct scatterlist *sg;
+	int i;
+
+	for_each_sg(sys_buffer->table.sgl, sg, sys_buffer->table.orig_nents, i) {
+		unsigned long npages = sg->length >> PAGE_SHIFT;
+		struct page *page = sg_page(sg);
+		int j;
+
+		if (offset >= npages) {
+			offset -= npages;
+			continue;
+		}
+
+		for (j = offset; j < npages; j++) {
+			int ret = vm_insert_page(vma, addr, page + j);
+
+			if (ret)
+				return ret;
+			addr += PAGE_SIZE;
+			if (addr >= vma->vm_end)
+				return 0;
+		}
+		offset = 0;
+	}
+
+	return 0;
 }
 
-static struct ion_heap_ops vmalloc_ops = {
+static struct ion_heap_ops system_heap_ops = {
 	.allocate = ion_system_heap_allocate,
 	.free = ion_system_heap_free,
 	.map_dma = ion_system_heap_map_dma,
@@ -101,21 +332,101 @@ static struct ion_heap_ops vmalloc_ops = {
 	.map_user = ion_system_heap_map_user,
 };
 
+static int ion_system_heap_shrink(struct shrinker *shrinker,
+				  struct shrink_control *sc)
+{
+	struct ion_system_heap *sys_heap = container_of(shrinker,
+							struct ion_system_heap,
+							shrinker);
+	int nr_total = 0;
+	int nr_freed = 0;
+	int i;
+
+	if (sc->nr_to_scan == 0)
+		goto end;
+
+	for (i = 0; i < num_orders; i++) {
+		nr_freed += ion_page_pool_shrink(sys_heap->pools[i],
+						 sc->gfp_mask,
+						 sc->nr_to_scan - nr_freed);
+		if (nr_freed >= sc->nr_to_scan)
+			break;
+	}
+
+end:
+	for (i = 0; i < num_orders; i++)
+		nr_total += ion_page_pool_shrink(sys_heap->pools[i],
+						 sc->gfp_mask, 0);
+	return nr_total;
+}
+
+static void ion_system_heap_destroy_pools(struct ion_system_heap *sys_heap)
+{
+	int i;
+
+	for (i = 0; i < num_orders; i++) {
+		struct ion_page_pool *pool = sys_heap->pools[i];
+
+		if (!pool)
+			continue;
+		ion_page_pool_shrink(pool, __GFP_HIGHMEM, INT_MAX);
+		ion_page_pool_destroy(pool);
+	}
+}
+
 struct ion_heap *ion_system_heap_create(struct ion_platform_heap *unused)
 {
-	struct ion_heap *heap;
+	struct ion_system_heap *sys_heap;
+	int i;
 
-	heap = kzalloc(sizeof(struct ion_heap), GFP_KERNEL);
-	if (!heap)
+	sys_heap = kzalloc(sizeof(struct ion_system_heap), GFP_KERNEL);
+	if (!sys_heap)
 		return ERR_PTR(-ENOMEM);
-	heap->ops = &vmalloc_ops;
-	heap->type = ION_HEAP_TYPE_SYSTEM;
-	return heap;
+	sys_heap->heap.ops = &system_heap_ops;
+	sys_heap->heap.type = ION_HEAP_TYPE_SYSTEM;
+
+	for (i = 0; i < num_orders; i++) {
+		gfp_t gfp_flags = low_order_gfp_flags;
+
+		if (orders[i] > 4)
+			gfp_flags = high_order_gfp_flags;
+		sys_heap->pools[i] = ion_page_pool_create(gfp_flags, orders[i]);
+		if (!sys_heap->pools[i])
+			goto err_create_pool;
+	}
+
+	spin_lock_init(&sys_heap->free_lock);
+	INIT_LIST_HEAD(&sys_heap->free_list);
+	init_waitqueue_head(&sys_heap->waitqueue);
+	sys_heap->task = kthread_run(ion_system_heap_deferred_free, sys_heap,
+				     "ion_system_heap");
+	if (IS_ERR(sys_heap->task)) {
+		pr_err("%s: creating thread for deferred free failed\n",
+		       __func__);
+		goto err_create_pool;
+	}
+
+	sys_heap->shrinker.shrink = ion_system_heap_shrink;
+	sys_heap->shrinker.seeks = DEFAULT_SEEKS;
+	register_shrinker(&sys_heap->shrinker);
+
+	return &sys_heap->heap;
+
+err_create_pool:
+	ion_system_heap_destroy_pools(sys_heap);
+	kfree(sys_heap);
+	return ERR_PTR(-ENOMEM);
 }
 
 void ion_system_heap_destroy(struct ion_heap *heap)
 {
-	kfree(heap);
+	struct ion_system_heap *sys_heap = to_system_heap(heap);
+
+	unregister_shrinker(&sys_heap->shrinker);
+	kthread_stop(sys_heap->task);
+	ion_system_heap_drain(sys_heap);
+	ion_system_heap_destroy_pools(sys_heap);
+	kfree(sys_heap);
 }
 
 static int ion_system_contig_heap_allocate(struct ion_heap *heap,
@@ -157,6 +468,24 @@ struct scatterlist *ion_system_contig_heap_map_dma(struct ion_heap *heap,
 	return sglist;
 }
 
+void ion_system_contig_heap_unmap_dma(struct ion_heap *heap,
+				      struct ion_buffer *buffer)
+{
+	if (buffer->sglist)
+		vfree(buffer->sglist);
+}
+
+void *ion_system_contig_heap_map_kernel(struct ion_heap *heap,
+					struct ion_buffer *buffer)
+{
+	return buffer->priv_virt;
+}
+
+void ion_system_contig_heap_unmap_kernel(struct ion_heap *heap,
+					 struct ion_buffer *buffer)
+{
+}
+
 int ion_system_contig_heap_map_user(struct ion_heap *heap,
 				    struct ion_buffer *buffer,
 				    struct vm_area_struct *vma)
@@ -173,9 +502,9 @@ static struct ion_heap_ops kmalloc_ops = {
 	.free = ion_system_contig_heap_free,
 	.phys = ion_system_contig_heap_phys,
 	.map_dma = ion_system_contig_heap_map_dma,
-	.unmap_dma = ion_system_heap_unmap_dma,
-	.map_kernel = ion_system_heap_map_kernel,
-	.unmap_kernel = ion_system_heap_unmap_kernel,
+	.unmap_dma = ion_system_contig_heap_unmap_dma,
+	.map_kernel = ion_system_contig_heap_map_kernel,
+	.unmap_kernel = ion_system_contig_heap_unmap_kernel,
 	.map_user = ion_system_contig_heap_map_user,
 };
 
@@ -16,11 +16,19 @@
 #include "mali_osk_profiling.h"
 #endif
 
+#ifdef CONFIG_MALI_DVFS	/* MALI_SEC */
+extern void mali_dvfs_vsync_event(int begin_wait);
+#endif
+
 _mali_osk_errcode_t _mali_ukk_vsync_event_report(_mali_uk_vsync_event_report_s *args)
 {
 	_mali_uk_vsync_event event = (_mali_uk_vsync_event)args->event;
 	MALI_IGNORE(event); /* event is not used for release code, and that is OK */
 
+#ifdef CONFIG_MALI_DVFS	/* MALI_SEC */
+	mali_dvfs_vsync_event(event == _MALI_UK_VSYNC_EVENT_BEGIN_WAIT);
+#endif
+
 #if defined(CONFIG_MALI400_PROFILING)
 	/*
 	 * Manually generate user space events in kernel space.
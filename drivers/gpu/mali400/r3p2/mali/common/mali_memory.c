@@ -114,9 +114,17 @@ typedef struct mali_mmu_page_table_allocations
 	_mali_osk_lock_t *lock;
 	_mali_osk_list_t partial;
 	_mali_osk_list_t full;
-	/* we never hold on to a empty allocation */
+	/* empty allocations kept at the tail of the partial list */
+	u32 num_empty;
 } mali_mmu_page_table_allocations;
 
+/*
+ * Page tables come and go with every session and mapping. Hold on to a few
+ * empty allocations so that a new session reuses already zeroed page table
+ * pages instead of going back to the allocators.
+ */
+#define MALI_MMU_PAGE_TABLE_CACHE_EMPTY_MAX 2
+
 static mali_kernel_mem_address_manager mali_address_manager =
 {
 	mali_address_manager_allocate, /* allocate */
@@ -1108,6 +1116,11 @@ _mali_osk_errcode_t mali_mmu_get_table_page(u32 *table_page, mali_io_address *ma
 		int page_number = _mali_osk_find_first_zero_bit(alloc->usage_map, alloc->num_pages);
 		MALI_DEBUG_PRINT(6, ("Partial page table allocation found, using page offset %d\n", page_number));
 		_mali_osk_set_nonatomic_bit(page_number, alloc->usage_map);
+		if (0 == alloc->usage_count)
+		{
+			/* reusing a cached empty allocation */
+			page_table_cache.num_empty--;
+		}
 		alloc->usage_count++;
 		if (alloc->num_pages == alloc->usage_count)
 		{
@@ -1181,6 +1194,25 @@ _mali_osk_errcode_t mali_mmu_get_table_page(u32 *table_page, mali_io_address *ma
 	}
 }
 
+/* Called with the page table cache lock held when alloc has become empty */
+static void mali_mmu_page_table_allocation_empty(mali_mmu_page_table_allocation * alloc)
+{
+	_mali_osk_list_del(&alloc->list);
+
+	if (page_table_cache.num_empty < MALI_MMU_PAGE_TABLE_CACHE_EMPTY_MAX)
+	{
+		/* keep it behind the partially used allocations, so these fill up first */
+		_mali_osk_list_addtail(&alloc->list, &page_table_cache.partial);
+		page_table_cache.num_empty++;
+		return;
+	}
+
+	/* release whole page alloc */
+	alloc->pages.release(&alloc->pages);
+	_mali_osk_free(alloc->usage_map);
+	_mali_osk_free(alloc);
+}
+
 void mali_mmu_release_table_page(u32 pa)
 {
 	mali_mmu_page_table_allocation * alloc, * temp_alloc;
@@ -1207,11 +1239,7 @@ void mali_mmu_release_table_page(u32 pa)
 
 			if (0 == alloc->usage_count)
 			{
-				/* empty, release whole page alloc */
-				_mali_osk_list_del(&alloc->list);
-				alloc->pages.release(&alloc->pages);
-				_mali_osk_free(alloc->usage_map);
-				_mali_osk_free(alloc);
+				mali_mmu_page_table_allocation_empty(alloc);
 			}
 		   	_mali_osk_lock_signal(page_table_cache.lock, _MALI_OSK_LOCKMODE_RW);
 			MALI_DEBUG_PRINT(4, ("(partial list)Released table page 0x%08X to the cache\n", pa));
@@ -1234,11 +1262,7 @@ void mali_mmu_release_table_page(u32 pa)
 
 			if (0 == alloc->usage_count)
 			{
-				/* empty, release whole page alloc */
-				_mali_osk_list_del(&alloc->list);
-				alloc->pages.release(&alloc->pages);
-				_mali_osk_free(alloc->usage_map);
-				_mali_osk_free(alloc);
+				mali_mmu_page_table_allocation_empty(alloc);
 			}
 			else
 			{
@@ -1264,6 +1288,7 @@ static _mali_osk_errcode_t mali_mmu_page_table_cache_create(void)
 	MALI_CHECK_NON_NULL( page_table_cache.lock, _MALI_OSK_ERR_FAULT );
 	_MALI_OSK_INIT_LIST_HEAD(&page_table_cache.partial);
 	_MALI_OSK_INIT_LIST_HEAD(&page_table_cache.full);
+	page_table_cache.num_empty = 0;
 	MALI_SUCCESS;
 }
 
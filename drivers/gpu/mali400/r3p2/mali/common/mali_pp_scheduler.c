@@ -425,33 +425,21 @@ MALI_STATIC_INLINE struct mali_group *mali_pp_scheduler_acquire_physical_group(v
 	return NULL;
 }
 
-static void mali_pp_scheduler_schedule(void)
+/*
+ * Hand out queued physical sub-jobs to available physical groups. The
+ * groups are moved to the working list and must be started with
+ * mali_pp_scheduler_start_physical_jobs() once the scheduler lock has been
+ * released. Groups are only taken from the virtual group when from_virtual
+ * is set, which requires the caller to hold the virtual group lock.
+ * Returns the number of sub-jobs claimed.
+ */
+static int mali_pp_scheduler_claim_physical_jobs(struct mali_group **groups, struct mali_pp_job **jobs,
+                                                 u32 *subjobs, mali_bool from_virtual)
 {
-	struct mali_group* physical_groups_to_start[MALI_MAX_NUMBER_OF_PP_GROUPS-1];
-	struct mali_pp_job* physical_jobs_to_start[MALI_MAX_NUMBER_OF_PP_GROUPS-1];
-	u32 physical_subjobs_to_start[MALI_MAX_NUMBER_OF_PP_GROUPS-1];
-	int num_physical_jobs_to_start = 0;
-	int i;
+	int num = 0;
 
-	if (mali_pp_scheduler_has_virtual_group())
-	{
-		/* Need to lock the virtual group because we might need to grab a physical group from it */
-		mali_group_lock(virtual_group);
-	}
-
-	mali_pp_scheduler_lock();
-	if (pause_count > 0)
-	{
-		/* Scheduler is suspended, don't schedule any jobs */
-		mali_pp_scheduler_unlock();
-		if (mali_pp_scheduler_has_virtual_group())
-		{
-			mali_group_unlock(virtual_group);
-		}
-		return;
-	}
+	MALI_ASSERT_PP_SCHEDULER_LOCKED();
 
-	/* Find physical job(s) to schedule first */
 	while (1)
 	{
 		struct mali_group *group;
@@ -468,6 +456,11 @@ static void mali_pp_scheduler_schedule(void)
 		MALI_DEBUG_ASSERT(mali_pp_job_has_unstarted_sub_jobs(job));
 		MALI_DEBUG_ASSERT(1 <= mali_pp_job_get_sub_job_count(job));
 
+		if (!from_virtual && _mali_osk_list_empty(&group_list_idle))
+		{
+			break; /* Only idle groups may be used, early out */
+		}
+
 		/* Acquire a physical group, either from the idle list or from the virtual group.
 		 * In case the group was acquired from the virtual group, it's state will be
 		 * LEAVING_VIRTUAL and must be set to IDLE before it can be used. */
@@ -492,14 +485,88 @@ static void mali_pp_scheduler_schedule(void)
 		_mali_osk_list_move(&(group->pp_scheduler_list), &group_list_working);
 
 		/* Keep track of this group, so that we actually can start the job once we are done with the scheduler lock we are now holding */
-		physical_groups_to_start[num_physical_jobs_to_start] = group;
-		physical_jobs_to_start[num_physical_jobs_to_start] = job;
-		physical_subjobs_to_start[num_physical_jobs_to_start] = subjob;
-		++num_physical_jobs_to_start;
+		groups[num] = group;
+		jobs[num] = job;
+		subjobs[num] = subjob;
+		++num;
+
+		MALI_DEBUG_ASSERT(num < MALI_MAX_NUMBER_OF_PP_GROUPS);
+	}
+
+	return num;
+}
+
+/*
+ * Start the sub-jobs claimed by mali_pp_scheduler_claim_physical_jobs().
+ * Must be called without the scheduler lock and without any physical group
+ * lock held.
+ *
+ * The reason we want to wait until we have released the scheduler lock is that job start actually
+ * may take quite a bit of time (quite many registers needs to be written). This will allow new jobs
+ * from user space to come in, and post processing of other PP jobs to happen at the same time as we
+ * start jobs.
+ */
+static void mali_pp_scheduler_start_physical_jobs(struct mali_group **groups, struct mali_pp_job **jobs,
+                                                  u32 *subjobs, int num)
+{
+	int i;
+
+	for (i = 0; i < num; i++)
+	{
+		struct mali_group *group = groups[i];
+		struct mali_pp_job *job  = jobs[i];
+		u32 sub_job              = subjobs[i];
+
+		MALI_DEBUG_ASSERT_POINTER(group);
+		MALI_DEBUG_ASSERT_POINTER(job);
+
+		mali_group_lock(group);
+
+		/* In case this group was acquired from a virtual core, update it's state to IDLE */
+		group->state = MALI_GROUP_STATE_IDLE;
+
+		mali_group_start_pp_job(group, job, sub_job);
+		MALI_DEBUG_PRINT(4, ("Mali PP scheduler: Physical job %u (0x%08X) part %u/%u started (from schedule)\n",
+		                     mali_pp_job_get_id(job), job, sub_job + 1,
+		                     mali_pp_job_get_sub_job_count(job)));
+
+		mali_group_unlock(group);
+
+		/* remove the return value from mali_group_start_xx_job, since we can't fail on Mali-300++ */
+	}
+}
+
+static void mali_pp_scheduler_schedule(void)
+{
+	struct mali_group* physical_groups_to_start[MALI_MAX_NUMBER_OF_PP_GROUPS-1];
+	struct mali_pp_job* physical_jobs_to_start[MALI_MAX_NUMBER_OF_PP_GROUPS-1];
+	u32 physical_subjobs_to_start[MALI_MAX_NUMBER_OF_PP_GROUPS-1];
+	int num_physical_jobs_to_start = 0;
 
-		MALI_DEBUG_ASSERT(num_physical_jobs_to_start < MALI_MAX_NUMBER_OF_PP_GROUPS);
+	if (mali_pp_scheduler_has_virtual_group())
+	{
+		/* Need to lock the virtual group because we might need to grab a physical group from it */
+		mali_group_lock(virtual_group);
+	}
+
+	mali_pp_scheduler_lock();
+	if (pause_count > 0)
+	{
+		/* Scheduler is suspended, don't schedule any jobs */
+		mali_pp_scheduler_unlock();
+		if (mali_pp_scheduler_has_virtual_group())
+		{
+			mali_group_unlock(virtual_group);
+		}
+		return;
 	}
 
+	/* Find physical job(s) to schedule first */
+	num_physical_jobs_to_start = mali_pp_scheduler_claim_physical_jobs(physical_groups_to_start,
+	                                                                   physical_jobs_to_start,
+	                                                                   physical_subjobs_to_start,
+	                                                                   MALI_TRUE);
+
 	/* See if we have a virtual job to schedule */
 	if (mali_pp_scheduler_has_virtual_group())
 	{
@@ -560,34 +627,11 @@ static void mali_pp_scheduler_schedule(void)
 	/*
 	 * Now we have released the scheduler lock, and we are ready to kick of the actual starting of the
 	 * physical jobs.
-	 * The reason we want to wait until we have released the scheduler lock is that job start actually
-	 * may take quite a bit of time (quite many registers needs to be written). This will allow new jobs
-	 * from user space to come in, and post processing of other PP jobs to happen at the same time as we
-	 * start jobs.
 	 */
-	for (i = 0; i < num_physical_jobs_to_start; i++)
-	{
-		struct mali_group *group = physical_groups_to_start[i];
-		struct mali_pp_job *job  = physical_jobs_to_start[i];
-		u32 sub_job              = physical_subjobs_to_start[i];
-
-		MALI_DEBUG_ASSERT_POINTER(group);
-		MALI_DEBUG_ASSERT_POINTER(job);
-
-		mali_group_lock(group);
-
-		/* In case this group was acquired from a virtual core, update it's state to IDLE */
-		group->state = MALI_GROUP_STATE_IDLE;
-
-		mali_group_start_pp_job(group, job, sub_job);
-		MALI_DEBUG_PRINT(4, ("Mali PP scheduler: Physical job %u (0x%08X) part %u/%u started (from schedule)\n",
-		                     mali_pp_job_get_id(job), job, sub_job + 1,
-		                     mali_pp_job_get_sub_job_count(job)));
-
-		mali_group_unlock(group);
-
-		/* remove the return value from mali_group_start_xx_job, since we can't fail on Mali-300++ */
-	}
+	mali_pp_scheduler_start_physical_jobs(physical_groups_to_start,
+	                                      physical_jobs_to_start,
+	                                      physical_subjobs_to_start,
+	                                      num_physical_jobs_to_start);
 }
 
 static void mali_pp_scheduler_return_job_to_user(struct mali_pp_job *job, mali_bool deferred)
@@ -689,6 +733,10 @@ void mali_pp_scheduler_job_done(struct mali_group *group, struct mali_pp_job *jo
 {
 	mali_bool job_is_done;
 	mali_bool barrier_enforced = MALI_FALSE;
+	struct mali_group* physical_groups_to_start[MALI_MAX_NUMBER_OF_PP_GROUPS-1];
+	struct mali_pp_job* physical_jobs_to_start[MALI_MAX_NUMBER_OF_PP_GROUPS-1];
+	u32 physical_subjobs_to_start[MALI_MAX_NUMBER_OF_PP_GROUPS-1];
+	int num_physical_jobs_to_start = 0;
 
 	MALI_DEBUG_PRINT(3, ("Mali PP scheduler: %s job %u (0x%08X) part %u/%u completed (%s)\n",
 	                     mali_pp_job_is_virtual(job) ? "Virtual" : "Physical",
@@ -773,9 +821,14 @@ void mali_pp_scheduler_job_done(struct mali_group *group, struct mali_pp_job *jo
 		return;
 	}
 
-	if (barrier_enforced)
+	if (barrier_enforced && mali_pp_scheduler_has_virtual_group())
 	{
-		/* A barrier was resolved, so schedule previously blocked jobs */
+		/*
+		 * A barrier was resolved, so schedule previously blocked jobs.
+		 * Scheduling the virtual group needs its lock, which can't be
+		 * taken here, so that is left to the scheduling work. Without a
+		 * virtual group the physical path below starts the jobs directly.
+		 */
 		_mali_osk_wq_schedule_work(pp_scheduler_wq_schedule);
 	}
 
@@ -883,6 +936,19 @@ void mali_pp_scheduler_job_done(struct mali_group *group, struct mali_pp_job *jo
 			/* Remove job from queue (if we now got the last subjob) */
 			mali_pp_scheduler_dequeue_physical_job(job);
 
+			if (barrier_enforced)
+			{
+				/*
+				 * Jobs released by the barrier go straight to the idle
+				 * groups, instead of waiting for the scheduling work to
+				 * run, so the next frame is not held up behind it.
+				 */
+				num_physical_jobs_to_start = mali_pp_scheduler_claim_physical_jobs(physical_groups_to_start,
+				                                                                   physical_jobs_to_start,
+				                                                                   physical_subjobs_to_start,
+				                                                                   MALI_FALSE);
+			}
+
 			mali_pp_scheduler_unlock();
 
 			/* Group is already on the working list, so start the job */
@@ -890,6 +956,19 @@ void mali_pp_scheduler_job_done(struct mali_group *group, struct mali_pp_job *jo
 			MALI_DEBUG_PRINT(4, ("Mali PP scheduler: Physical job %u (0x%08X) part %u/%u started (from job_done)\n",
 			                     mali_pp_job_get_id(job), job, sub_job + 1,
 			                     mali_pp_job_get_sub_job_count(job)));
+
+			if (0 < num_physical_jobs_to_start)
+			{
+				/* Physical group locks don't nest, start the others without ours */
+				mali_group_unlock(group);
+				mali_pp_scheduler_start_physical_jobs(physical_groups_to_start,
+				                                      physical_jobs_to_start,
+				                                      physical_subjobs_to_start,
+				                                      num_physical_jobs_to_start);
+
+				/* We need to return from this function with the group lock held */
+				mali_group_lock(group);
+			}
 		}
 		else if (mali_pp_scheduler_has_virtual_group())
 		{
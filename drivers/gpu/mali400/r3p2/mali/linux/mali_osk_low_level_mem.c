@@ -21,7 +21,9 @@
 #include <linux/slab.h>
 #include <linux/mm.h>
 #include <linux/dma-mapping.h>
+#include <linux/highmem.h>
 #include <linux/spinlock.h>
+#include <linux/workqueue.h>
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3,1,0)
 #include <linux/shrinker.h>
 #endif
@@ -78,21 +80,36 @@ struct MappingInfo
 typedef struct MappingInfo MappingInfo;
 
 
-static u32 _kernel_page_allocate(void);
+static u32 _kernel_page_allocate(gfp_t gfp_mask);
 static void _kernel_page_release(u32 physical_address);
 static AllocationList * _allocation_list_item_get(void);
 static void _allocation_list_item_release(AllocationList * item);
 
 
 /* Variable declarations */
+/*
+ * Page pool. Released pages go to the dirty list and are zeroed and cleaned
+ * from the CPU caches by mali_mem_pool_work before they move to
+ * pre_allocated_memory, so an allocation taking a page from the pool has
+ * nothing left to do. The work also tops the pool up to
+ * pre_allocated_memory_size_min while the GPU is allocating.
+ */
 static DEFINE_SPINLOCK(allocation_list_spinlock);
 static AllocationList * pre_allocated_memory = (AllocationList*) NULL ;
 static int pre_allocated_memory_size_current  = 0;
+static AllocationList * dirty_memory = (AllocationList*) NULL ;
+static int dirty_memory_size_current = 0;
 #ifdef MALI_OS_MEMORY_KERNEL_BUFFER_SIZE_IN_MB
 	static int pre_allocated_memory_size_max      = MALI_OS_MEMORY_KERNEL_BUFFER_SIZE_IN_MB * 1024 * 1024;
 #else
 	static int pre_allocated_memory_size_max      = 16 * 1024 * 1024; /* 6 MiB */
 #endif
+static int pre_allocated_memory_size_min = 2 * 1024 * 1024;
+
+#define MALI_PAGE_GFP (GFP_HIGHUSER | __GFP_ZERO | __GFP_NOWARN | __GFP_COLD)
+
+static void mali_mem_pool_refill(struct work_struct *work);
+static DECLARE_WORK(mali_mem_pool_work, mali_mem_pool_refill);
 
 static struct vm_operations_struct mali_kernel_vm_ops =
 {
@@ -125,10 +142,10 @@ static int mali_mem_shrink(struct shrinker *shrinker, struct shrink_control *sc)
 
 	if (0 == nr)
 	{
-		return pre_allocated_memory_size_current / PAGE_SIZE;
+		return (pre_allocated_memory_size_current + dirty_memory_size_current) / PAGE_SIZE;
 	}
 
-	if (0 == pre_allocated_memory_size_current)
+	if (0 == pre_allocated_memory_size_current + dirty_memory_size_current)
 	{
 		/* No pages availble */
 		return 0;
@@ -140,6 +157,19 @@ static int mali_mem_shrink(struct shrinker *shrinker, struct shrink_control *sc)
 		return -1;
 	}
 
+	/* Pages still waiting to be zeroed go first */
+	while (dirty_memory && nr > 0)
+	{
+		item = dirty_memory;
+		dirty_memory = item->next;
+
+		_kernel_page_release(item->physaddr);
+		_mali_osk_free(item);
+
+		dirty_memory_size_current -= PAGE_SIZE;
+		--nr;
+	}
+
 	while (pre_allocated_memory && nr > 0)
 	{
 		item = pre_allocated_memory;
@@ -153,7 +183,7 @@ static int mali_mem_shrink(struct shrinker *shrinker, struct shrink_control *sc)
 	}
 	spin_unlock_irqrestore(&allocation_list_spinlock,flags);
 
-	return pre_allocated_memory_size_current / PAGE_SIZE;
+	return (pre_allocated_memory_size_current + dirty_memory_size_current) / PAGE_SIZE;
 }
 
 struct shrinker mali_mem_shrinker = {
@@ -171,6 +201,17 @@ void mali_osk_low_level_mem_init(void)
 void mali_osk_low_level_mem_term(void)
 {
 	unregister_shrinker(&mali_mem_shrinker);
+	cancel_work_sync(&mali_mem_pool_work);
+
+	while ( NULL != dirty_memory )
+	{
+		AllocationList *item;
+		item = dirty_memory;
+		dirty_memory = item->next;
+		_kernel_page_release(item->physaddr);
+		_mali_osk_free( item );
+	}
+	dirty_memory_size_current = 0;
 
 	while ( NULL != pre_allocated_memory )
 	{
@@ -183,12 +224,12 @@ void mali_osk_low_level_mem_term(void)
 	pre_allocated_memory_size_current  = 0;
 }
 
-static u32 _kernel_page_allocate(void)
+static u32 _kernel_page_allocate(gfp_t gfp_mask)
 {
 	struct page *new_page;
 	u32 linux_phys_addr;
 
-	new_page = alloc_page(GFP_HIGHUSER | __GFP_ZERO | __GFP_REPEAT | __GFP_NOWARN | __GFP_COLD);
+	new_page = alloc_page(gfp_mask);
 
 	if ( NULL == new_page )
 	{
@@ -214,6 +255,69 @@ static void _kernel_page_release(u32 physical_address)
 	__free_page( unmap_page );
 }
 
+static void mali_mem_pool_refill(struct work_struct *work)
+{
+	AllocationList *item;
+	struct page *page;
+	unsigned long flags;
+
+	/* Zero the released pages and push the zeroes out of the CPU caches */
+	while (1)
+	{
+		spin_lock_irqsave(&allocation_list_spinlock, flags);
+		item = dirty_memory;
+		if (NULL != item)
+		{
+			dirty_memory = item->next;
+			dirty_memory_size_current -= PAGE_SIZE;
+		}
+		spin_unlock_irqrestore(&allocation_list_spinlock, flags);
+
+		if (NULL == item)
+		{
+			break;
+		}
+
+		/*
+		 * Pool pages may be highmem, which the dma_addr_t based sync
+		 * calls can't take. Clean through the page, like
+		 * _kernel_page_allocate() does.
+		 */
+		page = pfn_to_page(item->physaddr >> PAGE_SHIFT);
+		clear_highpage(page);
+		dma_map_page(NULL, page, 0, PAGE_SIZE, DMA_BIDIRECTIONAL);
+
+		spin_lock_irqsave(&allocation_list_spinlock, flags);
+		item->next = pre_allocated_memory;
+		pre_allocated_memory = item;
+		pre_allocated_memory_size_current += PAGE_SIZE;
+		spin_unlock_irqrestore(&allocation_list_spinlock, flags);
+	}
+
+	/* Top up, without pushing the system into reclaim for it */
+	while (pre_allocated_memory_size_current < pre_allocated_memory_size_min)
+	{
+		item = _mali_osk_malloc( sizeof(AllocationList) );
+		if ( NULL == item)
+		{
+			break;
+		}
+
+		item->physaddr = _kernel_page_allocate(MALI_PAGE_GFP | __GFP_NORETRY);
+		if ( INVALID_PAGE == item->physaddr )
+		{
+			_mali_osk_free( item );
+			break;
+		}
+
+		spin_lock_irqsave(&allocation_list_spinlock, flags);
+		item->next = pre_allocated_memory;
+		pre_allocated_memory = item;
+		pre_allocated_memory_size_current += PAGE_SIZE;
+		spin_unlock_irqrestore(&allocation_list_spinlock, flags);
+	}
+}
+
 static AllocationList * _allocation_list_item_get(void)
 {
 	AllocationList *item = NULL;
@@ -225,19 +329,26 @@ static AllocationList * _allocation_list_item_get(void)
 		item = pre_allocated_memory;
 		pre_allocated_memory = pre_allocated_memory->next;
 		pre_allocated_memory_size_current -= PAGE_SIZE;
+		if (pre_allocated_memory_size_current < pre_allocated_memory_size_min)
+		{
+			schedule_work(&mali_mem_pool_work);
+		}
 
 		spin_unlock_irqrestore(&allocation_list_spinlock,flags);
 		return item;
 	}
 	spin_unlock_irqrestore(&allocation_list_spinlock,flags);
 
+	/* The pool ran dry, refill it while we take the slow path */
+	schedule_work(&mali_mem_pool_work);
+
 	item = _mali_osk_malloc( sizeof(AllocationList) );
 	if ( NULL == item)
 	{
 		return NULL;
 	}
 
-	item->physaddr = _kernel_page_allocate();
+	item->physaddr = _kernel_page_allocate(MALI_PAGE_GFP | __GFP_REPEAT);
 	if ( INVALID_PAGE == item->physaddr )
 	{
 		/* Non-fatal error condition, out of memory. Upper levels will handle this. */
@@ -251,12 +362,14 @@ static void _allocation_list_item_release(AllocationList * item)
 {
 	unsigned long flags;
 	spin_lock_irqsave(&allocation_list_spinlock,flags);
-	if ( pre_allocated_memory_size_current < pre_allocated_memory_size_max)
+	if ( pre_allocated_memory_size_current + dirty_memory_size_current < pre_allocated_memory_size_max)
 	{
-		item->next = pre_allocated_memory;
-		pre_allocated_memory = item;
-		pre_allocated_memory_size_current += PAGE_SIZE;
+		/* The page still holds the old contents, zero it before reuse */
+		item->next = dirty_memory;
+		dirty_memory = item;
+		dirty_memory_size_current += PAGE_SIZE;
 		spin_unlock_irqrestore(&allocation_list_spinlock,flags);
+		schedule_work(&mali_mem_pool_work);
 		return;
 	}
 	spin_unlock_irqrestore(&allocation_list_spinlock,flags);
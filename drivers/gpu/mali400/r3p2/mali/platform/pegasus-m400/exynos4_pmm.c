@@ -22,7 +22,9 @@
 #include <linux/err.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
+#include <linux/pm_qos_params.h>
 #include <linux/regulator/consumer.h>
+#include <linux/dvfs_monitor.h>
 
 #if defined(CONFIG_MALI400_PROFILING)
 #include "mali_osk_profiling.h"
@@ -34,6 +36,13 @@
 
 #include <asm/io.h>
 #include <mach/regs-pmu.h>
+#include <mach/tmu.h>
+
+#if defined(CONFIG_BUSFREQ_OPP) && \
+	(defined(CONFIG_CPU_EXYNOS4212) || defined(CONFIG_CPU_EXYNOS4412))
+#include <mach/dev.h>
+#define MALI_BUS_VOTE 1
+#endif
 
 #include <linux/workqueue.h>
 
@@ -275,6 +284,8 @@ mali_io_address clk_register_map = 0;
 
 /* DVFS */
 static unsigned int mali_dvfs_utilization = 255;
+static unsigned int mali_dvfs_utilization_gp = 255;
+static unsigned int mali_dvfs_utilization_pp = 255;
 u64 mali_dvfs_time[MALI_DVFS_STEPS];
 #ifdef CONFIG_MALI_DVFS
 static void update_time_in_state(int level);
@@ -631,10 +642,39 @@ static void mali_platform_wating(u32 msec)
 	}
 }
 
+#ifdef MALI_BUS_VOTE
+/* bus frequency voted while the GPU runs at each step, 0 for none */
+static const unsigned long mali_dvfs_bus_vote[MALI_DVFS_STEPS] = {
+	0, 0, 267200, 400200, 400200
+};
+static struct device *mali_bus_dev;
+static struct device *mali_dev;
+static unsigned long mali_bus_voted;
+
+static void mali_bus_vote_update(unsigned long freq)
+{
+	if (!mali_dev || IS_ERR_OR_NULL(mali_bus_dev) || freq == mali_bus_voted)
+		return;
+
+	if (freq)
+		dev_lock(mali_bus_dev, mali_dev, freq);
+	else
+		dev_unlock(mali_bus_dev, mali_dev);
+
+	mali_bus_voted = freq;
+}
+#endif
+
 static mali_bool change_mali_dvfs_status(u32 step, mali_bool boostup )
 {
 	MALI_DEBUG_PRINT(4, ("> change_mali_dvfs_status: %d, %d \n",step, boostup));
 
+#ifdef MALI_BUS_VOTE
+	/* raise the bus before the GPU so the first frames aren't starved */
+	if (boostup)
+		mali_bus_vote_update(mali_dvfs_bus_vote[step]);
+#endif
+
 	if (!set_mali_dvfs_status(step, boostup)) {
 		MALI_DEBUG_PRINT(1, ("error on set_mali_dvfs_status: %d, %d \n",step, boostup));
 		return MALI_FALSE;
@@ -643,6 +683,11 @@ static mali_bool change_mali_dvfs_status(u32 step, mali_bool boostup )
 	/* wait until clock and voltage is stablized */
 	mali_platform_wating(MALI_DVFS_WATING); /* msec */
 
+#ifdef MALI_BUS_VOTE
+	if (!boostup)
+		mali_bus_vote_update(mali_dvfs_bus_vote[step]);
+#endif
+
 	return MALI_TRUE;
 }
 
@@ -811,16 +856,135 @@ module_param(mali_use_5th_step, uint, 0644);
 static unsigned int bottom_lock_step_enabled = 0;
 module_param(bottom_lock_step_enabled, uint, 0644);
 
+/* highest step allowed at each TMU throttling level */
+static const unsigned int mali_dvfs_thermal_steps[TMU_THROTTLE_END] = {
+#if defined(CONFIG_CPU_EXYNOS4212) || defined(CONFIG_CPU_EXYNOS4412)
+	MALI_DVFS_STEPS - 1, 3, 2, 1
+#else
+	MALI_DVFS_STEPS - 1, 2, 1, 0
+#endif
+};
+static unsigned int mali_dvfs_thermal_cap = MALI_DVFS_STEPS - 1;
+
+static int mali_dvfs_tmu_event(struct notifier_block *nb,
+		unsigned long event, void *data)
+{
+	unsigned int level = *(unsigned int *)data;
+
+	if (event != TMU_THROTTLE_CHANGE || level >= TMU_THROTTLE_END)
+		return NOTIFY_DONE;
+
+	mali_dvfs_thermal_cap = mali_dvfs_thermal_steps[level];
+	return NOTIFY_OK;
+}
+
+static struct notifier_block mali_dvfs_tmu_notifier = {
+	.notifier_call = mali_dvfs_tmu_event,
+};
+
+/*
+ * History governor: instead of stepping one level at a time on fixed
+ * thresholds, keep the work (utilization times clock) of the last few
+ * sampling periods and pick the lowest step whose capacity covers the
+ * busiest of them. A single heavy period raises the clock at once, while
+ * dropping it takes a whole history of light periods, so steady 60 fps
+ * content settles on one step instead of bouncing between two.
+ *
+ * When user space reported vsync waits during the period the renderer is
+ * frame paced and the idle time is slack up to the next vsync, so the
+ * step may run closer to full load and still meet the frame deadline.
+ */
+#define MALI_DVFS_HISTORY	4
+
+static unsigned int mali_dvfs_history_mode = 1;
+module_param(mali_dvfs_history_mode, uint, 0644);
+
+/* target load in percent of a step's capacity */
+static unsigned int mali_dvfs_target_load = 70;
+module_param(mali_dvfs_target_load, uint, 0644);
+static unsigned int mali_dvfs_vsync_target_load = 90;
+module_param(mali_dvfs_vsync_target_load, uint, 0644);
+
+static unsigned int mali_dvfs_history[MALI_DVFS_HISTORY];
+static unsigned int mali_dvfs_history_idx;
+static _mali_osk_atomic_t mali_dvfs_vsync_waits;
+
+void mali_dvfs_vsync_event(int begin_wait)
+{
+	if (begin_wait)
+		_mali_osk_atomic_inc(&mali_dvfs_vsync_waits);
+}
+
+static void mali_dvfs_history_reset(void)
+{
+	memset(mali_dvfs_history, 0, sizeof(mali_dvfs_history));
+	mali_dvfs_history_idx = 0;
+}
+
+static unsigned int mali_dvfs_history_level(unsigned int level,
+					    unsigned int utilization)
+{
+	unsigned int load, work, peak = 0, target, top;
+	int i;
+
+	/*
+	 * Time the GP and PP cores overlap counts once in the combined
+	 * figure; time one core spends waiting on the other is only half
+	 * recovered by a faster clock, because the job pipeline already
+	 * hides it across frames.
+	 */
+	load = (utilization + max(mali_dvfs_utilization_gp,
+				  mali_dvfs_utilization_pp)) / 2;
+
+	/* work in units of MHz * 256 so periods at different steps compare */
+	mali_dvfs_history[mali_dvfs_history_idx] =
+		load * mali_dvfs[level].clock;
+	mali_dvfs_history_idx = (mali_dvfs_history_idx + 1) % MALI_DVFS_HISTORY;
+
+	for (i = 0; i < MALI_DVFS_HISTORY; i++)
+		peak = max(peak, mali_dvfs_history[i]);
+
+	if (_mali_osk_atomic_read(&mali_dvfs_vsync_waits) > 0)
+		target = mali_dvfs_vsync_target_load;
+	else
+		target = mali_dvfs_target_load;
+	_mali_osk_atomic_init(&mali_dvfs_vsync_waits, 0);
+	target = clamp(target, 10U, 100U);
+
+	top = MALI_DVFS_STEPS - 1;
+	if (!mali_use_5th_step)
+		top = min(top, 3U);
+
+	for (i = 0; i < top; i++) {
+		work = mali_dvfs[i].clock * 256 / 100 * target;
+		if (work >= peak)
+			break;
+	}
+	return i;
+}
+
 static unsigned int decideNextStatus(unsigned int utilization)
 {
 	static unsigned int level = 0;
+	unsigned int qos_step;
 	int iStepCount = 0;
 	if (mali_runtime_resumed >= 0) {
 		level = mali_runtime_resumed;
 		mali_runtime_resumed = -1;
+		mali_dvfs_history_reset();
 	}
 
-	if (mali_dvfs_control == 0 && level == get_mali_dvfs_status()) {
+	if (mali_dvfs_control == 0 && level == get_mali_dvfs_status() &&
+			mali_dvfs_history_mode) {
+		level = mali_dvfs_history_level(level, utilization);
+
+		if (bottom_lock_step_enabled) {
+			if (_mali_osk_atomic_read(&bottomlock_status) > 0) {
+				if (level < bottom_lock_step)
+					level = bottom_lock_step;
+			}
+		}
+	} else if (mali_dvfs_control == 0 && level == get_mali_dvfs_status()) {
 		if (utilization > (int)(255 * mali_dvfs[maliDvfsStatus.currentStep].upthreshold / 100) &&
 				level < MALI_DVFS_STEPS - 1) {
 			level++;
@@ -847,6 +1011,15 @@ static unsigned int decideNextStatus(unsigned int utilization)
 		}
 	}
 
+	/* PM_QOS_GPU_STEP_MIN requests, taken at the next utilization sample */
+	qos_step = pm_qos_request(PM_QOS_GPU_STEP_MIN);
+	if (level < qos_step)
+		level = min_t(unsigned int, qos_step, MALI_DVFS_STEPS - 1);
+
+	/* the thermal ceiling wins over the bottom lock and the user */
+	if (level > mali_dvfs_thermal_cap)
+		level = mali_dvfs_thermal_cap;
+
 	return level;
 }
 
@@ -872,7 +1045,8 @@ static mali_bool mali_dvfs_status(unsigned int utilization)
 			boostup = 1;
 			stay_count = 5;
 		} else if (maliDvfsStatus.currentStep > nextStatus){
-			stay_count--;
+			/* the history governor already waited for the drop */
+			stay_count = mali_dvfs_history_mode ? 0 : stay_count - 1;
 		}
 		if( boostup == 1 || stay_count <= 0){
 			/*change mali dvfs status*/
@@ -904,6 +1078,7 @@ static void mali_dvfs_work_handler(struct work_struct *w)
 	bMaliDvfsRun=1;
 
 	MALI_DEBUG_PRINT(3, ("=== mali_dvfs_work_handler\n"));
+	dvfs_monitor_report_gpu(mali_dvfs_utilization * 100 / 255);
 
 	if(!mali_dvfs_status(mali_dvfs_utilization))
 	MALI_DEBUG_PRINT(1, ( "error on mali dvfs status in mali_dvfs_work_handler"));
@@ -922,19 +1097,26 @@ mali_bool init_mali_dvfs_status(void)
 		mali_dvfs_wq = create_singlethread_workqueue("mali_dvfs");
 
 	_mali_osk_atomic_init(&bottomlock_status, 0);
+	_mali_osk_atomic_init(&mali_dvfs_vsync_waits, 0);
 
 	/* add a error handling here */
 	maliDvfsStatus.currentStep = MALI_DVFS_DEFAULT_STEP;
 
+	if (exynos_tmu_register_notifier(&mali_dvfs_tmu_notifier))
+		MALI_PRINT(("failed to register tmu notifier\n"));
+
 	return MALI_TRUE;
 }
 
 void deinit_mali_dvfs_status(void)
 {
+	exynos_tmu_unregister_notifier(&mali_dvfs_tmu_notifier);
+
 	if (mali_dvfs_wq)
 		destroy_workqueue(mali_dvfs_wq);
 
 	_mali_osk_atomic_term(&bottomlock_status);
+	_mali_osk_atomic_term(&mali_dvfs_vsync_waits);
 
 	mali_dvfs_wq = NULL;
 }
@@ -1147,6 +1329,13 @@ _mali_osk_errcode_t mali_platform_init(struct device *dev)
 
 	atomic_set(&clk_active, 0);
 
+#ifdef MALI_BUS_VOTE
+	mali_dev = dev;
+	mali_bus_dev = dev_get("exynos-busfreq");
+	if (IS_ERR(mali_bus_dev))
+		MALI_PRINT(("no busfreq device, bus is not voted by GPU\n"));
+#endif
+
 #ifdef CONFIG_MALI_DVFS
 	/* Create sysfs for time-in-state */
 	if (device_create_file(dev, &dev_attr_time_in_state)) {
@@ -1201,6 +1390,9 @@ _mali_osk_errcode_t mali_platform_power_mode_change(struct device *dev, mali_pow
 						MALI_PROFILING_EVENT_REASON_SINGLE_GPU_FREQ_VOLT_CHANGE,
 						mali_gpu_clk, mali_gpu_vol/1000, 0, 0, 0);
 
+#endif
+#ifdef MALI_BUS_VOTE
+				mali_bus_vote_update(mali_dvfs_bus_vote[maliDvfsStatus.currentStep]);
 #endif
 				bPoweroff=0;
 			}
@@ -1222,6 +1414,10 @@ _mali_osk_errcode_t mali_platform_power_mode_change(struct device *dev, mali_pow
 
 #if !defined(CONFIG_PM_RUNTIME)
 				g3d_power_domain_control(0);
+#endif
+#ifdef MALI_BUS_VOTE
+				/* a powered down GPU holds no bus vote */
+				mali_bus_vote_update(0);
 #endif
 				bPoweroff=1;
 			}
@@ -1236,6 +1432,8 @@ void mali_gpu_utilization_handler(struct mali_gpu_utilization_data *data)
 	if (bPoweroff==0)
 	{
 #ifdef CONFIG_MALI_DVFS
+		mali_dvfs_utilization_gp = data->utilization_gp;
+		mali_dvfs_utilization_pp = data->utilization_pp;
 		if(!mali_dvfs_handler(data->utilization_gpu))
 			MALI_DEBUG_PRINT(1, ("error on mali dvfs status in utilization\n"));
 #endif
@@ -98,6 +98,9 @@ void mali_regulator_set_voltage(int min_uV, int max_uV);
 #ifdef CONFIG_MALI_DVFS
 ssize_t show_time_in_state(struct device *dev, struct device_attribute *attr, char *buf);
 ssize_t set_time_in_state(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+/* called for every vsync event user space reports, begin_wait is non zero
+ * when the renderer starts waiting for vsync */
+void mali_dvfs_vsync_event(int begin_wait);
 #ifdef CONFIG_CPU_EXYNOS4210
 #if MALI_GPU_BOTTOM_LOCK
 int mali_dvfs_bottom_lock_push(void);
@@ -20,6 +20,11 @@
 #define EVDEV_BUF_PACKETS	8
 #endif
 
+/* how long a packet in the mmap()ed ring keeps the system from suspending */
+#define EVDEV_RING_WAKE_TIMEOUT	(HZ / 2)
+/* largest mmap()ed ring, in events; the header page comes on top */
+#define EVDEV_RING_MAX_EVENTS	4096U
+
 #include <linux/poll.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
@@ -29,6 +34,9 @@
 #include <linux/major.h>
 #include <linux/device.h>
 #include <linux/wakelock.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
+#include <linux/log2.h>
 #include "input-compat.h"
 
 struct evdev {
@@ -56,6 +64,12 @@ struct evdev_client {
 	struct evdev *evdev;
 	struct list_head node;
 	int clkid;
+	struct input_event_ring *ring;	/* set once the file is mmap()ed */
+	struct input_event *ring_events;
+	unsigned int ring_size;
+	unsigned int ring_head;		/* next slot the kernel writes */
+	unsigned int ring_packet;	/* start of the packet being written */
+	bool ring_dropped;
 	unsigned int bufsize;
 	struct input_event buffer[];
 };
@@ -63,6 +77,52 @@ struct evdev_client {
 static struct evdev *evdev_table[EVDEV_MINORS];
 static DEFINE_MUTEX(evdev_table_mutex);
 
+/*
+ * Events for an mmap()ed client are written past the published head, which
+ * only moves at SYN_REPORT so the reader never sees half a packet. With no
+ * room left the packet in progress is thrown away and the next one written
+ * starts with SYN_DROPPED. Called with client->buffer_lock held.
+ */
+static void evdev_ring_event(struct evdev_client *client,
+			     struct input_event *event)
+{
+	struct input_event_ring *ring = client->ring;
+	unsigned int mask = client->ring_size - 1;
+	unsigned int tail = ACCESS_ONCE(ring->tail);
+	unsigned int need = client->ring_dropped ? 2 : 1;
+
+	if (client->ring_head - tail + need > client->ring_size) {
+		client->ring_head = client->ring_packet;
+		client->ring_dropped = true;
+		ring->dropped++;
+		return;
+	}
+
+	if (client->ring_dropped) {
+		struct input_event *dropped;
+
+		dropped = &client->ring_events[client->ring_head++ & mask];
+		dropped->time = event->time;
+		dropped->type = EV_SYN;
+		dropped->code = SYN_DROPPED;
+		dropped->value = 0;
+		client->ring_dropped = false;
+	}
+
+	client->ring_events[client->ring_head++ & mask] = *event;
+
+	if (event->type == EV_SYN && event->code == SYN_REPORT) {
+		/* the events must be visible before the new head */
+		smp_wmb();
+		ring->head = client->ring_head;
+		client->ring_packet = client->ring_head;
+		if (client->use_wake_lock)
+			wake_lock_timeout(&client->wake_lock,
+					  EVDEV_RING_WAKE_TIMEOUT);
+		kill_fasync(&client->fasync, SIGIO, POLL_IN);
+	}
+}
+
 static void evdev_pass_event(struct evdev_client *client,
 			     struct input_event *event,
 			     ktime_t mono, ktime_t real)
@@ -73,6 +133,12 @@ static void evdev_pass_event(struct evdev_client *client,
 	/* Interrupts are disabled, just acquire the lock. */
 	spin_lock(&client->buffer_lock);
 
+	if (client->ring) {
+		evdev_ring_event(client, event);
+		spin_unlock(&client->buffer_lock);
+		return;
+	}
+
 	client->buffer[client->head++] = *event;
 	client->head &= client->bufsize - 1;
 
@@ -114,7 +180,8 @@ static void evdev_event(struct input_handle *handle,
 	struct input_event event;
 	ktime_t time_mono, time_real;
 
-	time_mono = ktime_get();
+	/* the driver may have supplied the time of the interrupt */
+	time_mono = input_get_timestamp(handle->dev);
 	time_real = ktime_sub(time_mono, ktime_get_monotonic_offset());
 
 	event.type = type;
@@ -279,6 +346,7 @@ static int evdev_release(struct inode *inode, struct file *file)
 	evdev_detach_client(evdev, client);
 	if (client->use_wake_lock)
 		wake_lock_destroy(&client->wake_lock);
+	vfree(client->ring);
 	kfree(client);
 
 	evdev_close_device(evdev);
@@ -388,6 +456,49 @@ static ssize_t evdev_write(struct file *file, const char __user *buffer,
 	return retval;
 }
 
+static bool evdev_has_packet(struct evdev_client *client)
+{
+	struct input_event_ring *ring;
+	bool have_packet;
+
+	/* a failed mmap() frees the ring again, see evdev_mmap() */
+	spin_lock_irq(&client->buffer_lock);
+	ring = client->ring;
+	if (ring)
+		have_packet = ACCESS_ONCE(ring->head) != ACCESS_ONCE(ring->tail);
+	else
+		have_packet = client->packet_head != client->tail;
+	spin_unlock_irq(&client->buffer_lock);
+
+	return have_packet;
+}
+
+/*
+ * read() of an mmap()ed client consumes from the ring like the reader does.
+ * Called with buffer_lock held.
+ */
+static int evdev_fetch_ring_event(struct evdev_client *client,
+				  struct input_event_ring *ring,
+				  struct input_event *event)
+{
+	unsigned int tail;
+	int have_event;
+
+	tail = ACCESS_ONCE(ring->tail);
+	have_event = ring->head != tail;
+	if (have_event) {
+		/* read the event only after seeing the head that covers it */
+		smp_rmb();
+		*event = client->ring_events[tail & (client->ring_size - 1)];
+		smp_mb();
+		ring->tail = ++tail;
+	}
+	if (client->use_wake_lock && ring->head == tail)
+		wake_unlock(&client->wake_lock);
+
+	return have_event;
+}
+
 static int evdev_fetch_next_event(struct evdev_client *client,
 				  struct input_event *event)
 {
@@ -395,6 +506,11 @@ static int evdev_fetch_next_event(struct evdev_client *client,
 
 	spin_lock_irq(&client->buffer_lock);
 
+	if (client->ring) {
+		have_event = evdev_fetch_ring_event(client, client->ring, event);
+		goto out;
+	}
+
 	have_event = client->packet_head != client->tail;
 	if (have_event) {
 		*event = client->buffer[client->tail++];
@@ -404,6 +520,7 @@ static int evdev_fetch_next_event(struct evdev_client *client,
 			wake_unlock(&client->wake_lock);
 	}
 
+out:
 	spin_unlock_irq(&client->buffer_lock);
 
 	return have_event;
@@ -422,7 +539,7 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 
 	if (!(file->f_flags & O_NONBLOCK)) {
 		retval = wait_event_interruptible(evdev->wait,
-			 client->packet_head != client->tail || !evdev->exist);
+			 evdev_has_packet(client) || !evdev->exist);
 		if (retval)
 			return retval;
 	}
@@ -454,12 +571,78 @@ static unsigned int evdev_poll(struct file *file, poll_table *wait)
 	poll_wait(file, &evdev->wait, wait);
 
 	mask = evdev->exist ? POLLOUT | POLLWRNORM : POLLHUP | POLLERR;
-	if (client->packet_head != client->tail)
+	if (evdev_has_packet(client))
 		mask |= POLLIN | POLLRDNORM;
 
 	return mask;
 }
 
+/*
+ * Map the client's event ring, see struct input_event_ring. The mapping is
+ * a header page followed by the events, at least one page of them and at
+ * most EVDEV_RING_MAX_EVENTS; the ring takes the largest power of two that
+ * fits. Events still queued for read() are dropped and the first packet in
+ * the ring starts with SYN_DROPPED, so the reader resynchronizes its state.
+ * A client can be mapped only once.
+ */
+static int evdev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct evdev_client *client = file->private_data;
+	unsigned long size = vma->vm_end - vma->vm_start;
+	struct input_event_ring *ring;
+	unsigned int nr_events;
+	int error;
+
+	/* userspace has to see the kernel's own struct input_event */
+	if (input_event_size() != sizeof(struct input_event))
+		return -EINVAL;
+
+	if (vma->vm_pgoff || size <= PAGE_SIZE ||
+	    size > PAGE_SIZE + PAGE_ALIGN(EVDEV_RING_MAX_EVENTS *
+					  sizeof(struct input_event)))
+		return -EINVAL;
+
+	nr_events = rounddown_pow_of_two((size - PAGE_SIZE) /
+					 sizeof(struct input_event));
+	if (!nr_events)
+		return -EINVAL;
+
+	ring = vmalloc_user(size);
+	if (!ring)
+		return -ENOMEM;
+	ring->size = nr_events;
+	ring->data_offset = PAGE_SIZE;
+
+	spin_lock_irq(&client->buffer_lock);
+	if (client->ring) {
+		spin_unlock_irq(&client->buffer_lock);
+		vfree(ring);
+		return -EBUSY;
+	}
+	client->ring_events = (void *)ring + PAGE_SIZE;
+	client->ring_size = nr_events;
+	client->ring_head = client->ring_packet = 0;
+	client->ring_dropped = true;
+	client->ring = ring;
+	client->head = client->tail = client->packet_head = 0;
+	if (client->use_wake_lock)
+		wake_unlock(&client->wake_lock);
+	spin_unlock_irq(&client->buffer_lock);
+
+	/* the ring stays with the client until release */
+	error = remap_vmalloc_range(vma, ring, 0);
+	if (error) {
+		spin_lock_irq(&client->buffer_lock);
+		client->ring = NULL;
+		spin_unlock_irq(&client->buffer_lock);
+		vfree(ring);
+		return error;
+	}
+
+	vma->vm_flags |= VM_DONTEXPAND;
+	return 0;
+}
+
 #ifdef CONFIG_COMPAT
 
 #define BITS_PER_LONG_COMPAT (sizeof(compat_long_t) * 8)
@@ -918,6 +1101,7 @@ static const struct file_operations evdev_fops = {
 	.read		= evdev_read,
 	.write		= evdev_write,
 	.poll		= evdev_poll,
+	.mmap		= evdev_mmap,
 	.open		= evdev_open,
 	.release	= evdev_release,
 	.unlocked_ioctl	= evdev_ioctl,
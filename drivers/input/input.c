@@ -333,7 +333,29 @@ static void input_handle_event(struct input_dev *dev,
 
 	if (disposition & INPUT_PASS_TO_HANDLERS)
 		input_pass_event(dev, type, code, value);
+
+	/* the next packet gets a timestamp of its own */
+	if (type == EV_SYN && code == SYN_REPORT)
+		dev->timestamp.tv64 = 0;
+}
+
+/**
+ * input_get_timestamp() - time the events of the current packet happened
+ * @dev: input device the events come from
+ *
+ * Returns the monotonic time the driver supplied with input_set_timestamp()
+ * or, failing that, the time the first event of the packet was reported.
+ * All events up to the next SYN_REPORT share it. Called by input handlers
+ * with dev->event_lock held.
+ */
+ktime_t input_get_timestamp(struct input_dev *dev)
+{
+	if (!dev->timestamp.tv64)
+		dev->timestamp = ktime_get();
+
+	return dev->timestamp;
 }
+EXPORT_SYMBOL(input_get_timestamp);
 
 /**
  * input_event() - report new input event
@@ -85,6 +85,7 @@ struct samsung_keypad {
 	unsigned int rows;
 	unsigned int cols;
 	unsigned int row_state[SAMSUNG_MAX_COLS];
+	ktime_t irq_time;
 	unsigned short keycodes[];
 };
 
@@ -125,7 +126,7 @@ static void samsung_keypad_scan(struct samsung_keypad *keypad,
 }
 
 static bool samsung_keypad_report(struct samsung_keypad *keypad,
-				  unsigned int *row_state)
+				  unsigned int *row_state, ktime_t time)
 {
 	struct input_dev *input_dev = keypad->input_dev;
 	unsigned int changed;
@@ -140,6 +141,7 @@ static bool samsung_keypad_report(struct samsung_keypad *keypad,
 		if (!changed)
 			continue;
 
+		input_set_timestamp(input_dev, time);
 		for (row = 0; row < keypad->rows; row++) {
 			if (!(changed & (1 << row)))
 				continue;
@@ -163,10 +165,19 @@ static bool samsung_keypad_report(struct samsung_keypad *keypad,
 	return key_down;
 }
 
+static irqreturn_t samsung_keypad_hardirq(int irq, void *dev_id)
+{
+	struct samsung_keypad *keypad = dev_id;
+
+	keypad->irq_time = ktime_get();
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t samsung_keypad_irq(int irq, void *dev_id)
 {
 	struct samsung_keypad *keypad = dev_id;
 	unsigned int row_state[SAMSUNG_MAX_COLS];
+	ktime_t time = keypad->irq_time;
 	unsigned int val;
 	bool key_down;
 
@@ -178,10 +189,12 @@ static irqreturn_t samsung_keypad_irq(int irq, void *dev_id)
 		/* Clear interrupt. */
 		writel(~0x0, keypad->base + SAMSUNG_KEYIFSTSCLR);
 		samsung_keypad_scan(keypad, row_state);
-		key_down = samsung_keypad_report(keypad, row_state);
+		key_down = samsung_keypad_report(keypad, row_state, time);
 		if (key_down)
 			wait_event_timeout(keypad->wait, keypad->stopped,
 					   msecs_to_jiffies(50));
+		/* later scans are polled, stamp them when they start */
+		time = ktime_get();
 
 	} while (key_down && !keypad->stopped);
 
@@ -453,8 +466,9 @@ static int __devinit samsung_keypad_probe(struct platform_device *pdev)
 		goto err_put_clk;
 	}
 
-	error = request_threaded_irq(keypad->irq, NULL, samsung_keypad_irq,
-			IRQF_ONESHOT, dev_name(&pdev->dev), keypad);
+	error = request_threaded_irq(keypad->irq, samsung_keypad_hardirq,
+			samsung_keypad_irq, IRQF_ONESHOT,
+			dev_name(&pdev->dev), keypad);
 	if (error) {
 		dev_err(&pdev->dev, "failed to register keypad interrupt\n");
 		goto err_put_clk;
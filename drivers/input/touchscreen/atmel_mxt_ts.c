@@ -20,6 +20,9 @@
 #include <linux/input/mt.h>
 #include <linux/interrupt.h>
 #include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 /* Version */
 #define MXT_VER_20		20
@@ -212,6 +215,10 @@
 
 #define MXT_MAX_FINGER		10
 
+/* Latency histograms: bucket 0 is under 128us, each next one doubles */
+#define MXT_LAT_BUCKETS		10
+#define MXT_LAT_SHIFT		7
+
 struct mxt_info {
 	u8 family_id;
 	u8 variant_id;
@@ -247,6 +254,26 @@ struct mxt_finger {
 	int pressure;
 };
 
+struct mxt_latency {
+	unsigned int hist[MXT_LAT_BUCKETS];
+	unsigned int count;
+	u32 max_us;
+	u64 total_us;
+};
+
+enum {
+	MXT_LAT_IRQ_TO_I2C,	/* interrupt until the messages are read */
+	MXT_LAT_I2C_TO_SYNC,	/* read messages until input_sync() */
+	MXT_LAT_IRQ_TO_SYNC,	/* the whole kernel side of a touch frame */
+	MXT_NR_LAT,
+};
+
+static const char * const mxt_lat_names[MXT_NR_LAT] = {
+	[MXT_LAT_IRQ_TO_I2C]	= "irq_to_i2c",
+	[MXT_LAT_I2C_TO_SYNC]	= "i2c_to_sync",
+	[MXT_LAT_IRQ_TO_SYNC]	= "irq_to_sync",
+};
+
 /* Each client has this additional data */
 struct mxt_data {
 	struct i2c_client *client;
@@ -258,8 +285,26 @@ struct mxt_data {
 	unsigned int irq;
 	unsigned int max_x;
 	unsigned int max_y;
+
+	/* message processing, filled in from the object table */
+	u16 T5_address;
+	u8 T5_msg_size;
+	u16 T44_address;	/* 0 if the chip has no message count */
+	u8 T9_reportid_min;
+	u8 T9_reportid_max;
+	u8 max_reportid;
+	u8 *msg_buf;
+	bool update_input;
+	int last_id;
+
+	/* touch frame latency, see mxt_interrupt() */
+	ktime_t irq_time;
+	struct mxt_latency latency[MXT_NR_LAT];
+	struct dentry *debugfs;
 };
 
+static struct dentry *mxt_debugfs_root;
+
 static bool mxt_object_readable(unsigned int type)
 {
 	switch (type) {
@@ -521,6 +566,8 @@ static void mxt_input_report(struct mxt_data *data, int single_id)
 	int finger_num = 0;
 	int id;
 
+	input_set_timestamp(input_dev, data->irq_time);
+
 	for (id = 0; id < MXT_MAX_FINGER; id++) {
 		if (!finger[id].status)
 			continue;
@@ -567,13 +614,18 @@ static void mxt_input_touchevent(struct mxt_data *data,
 	int area;
 	int pressure;
 
+	/* a release still pending in this frame must reach userspace first */
+	if (finger[id].status == MXT_RELEASE)
+		mxt_input_report(data, id);
+
 	/* Check the touch is present on the screen */
 	if (!(status & MXT_DETECT)) {
 		if (status & MXT_RELEASE) {
 			dev_dbg(dev, "[%d] released\n", id);
 
 			finger[id].status = MXT_RELEASE;
-			mxt_input_report(data, id);
+			data->update_input = true;
+			data->last_id = id;
 		}
 		return;
 	}
@@ -603,42 +655,149 @@ static void mxt_input_touchevent(struct mxt_data *data,
 	finger[id].area = area;
 	finger[id].pressure = pressure;
 
-	mxt_input_report(data, id);
+	data->update_input = true;
+	data->last_id = id;
+}
+
+static void mxt_latency_add(struct mxt_data *data, int type, ktime_t from,
+			    ktime_t to)
+{
+	struct mxt_latency *lat = &data->latency[type];
+	s64 us = ktime_us_delta(to, from);
+	int bucket;
+
+	if (us < 0)
+		return;
+
+	bucket = min(fls64(us >> MXT_LAT_SHIFT), MXT_LAT_BUCKETS - 1);
+	lat->hist[bucket]++;
+	lat->count++;
+	lat->total_us += us;
+	if (us > lat->max_us)
+		lat->max_us = min_t(s64, us, U32_MAX);
+}
+
+static void mxt_proc_message(struct mxt_data *data, u8 *msg)
+{
+	struct mxt_message message;
+	u8 reportid = msg[0];
+
+	memset(&message, 0, sizeof(message));
+	memcpy(&message, msg, min_t(size_t, data->T5_msg_size,
+				    sizeof(message)));
+
+	if (reportid >= data->T9_reportid_min &&
+	    reportid <= data->T9_reportid_max)
+		mxt_input_touchevent(data, &message,
+				     reportid - data->T9_reportid_min);
+	else
+		mxt_dump_message(&data->client->dev, &message);
+}
+
+/*
+ * Read the pending message count from T44 and then every pending message in
+ * one burst from T5, which hands out the next message on each read. When T44
+ * sits right in front of T5 the count comes with the first message.
+ */
+static int mxt_read_messages_t44(struct mxt_data *data)
+{
+	struct i2c_client *client = data->client;
+	unsigned int size = data->T5_msg_size;
+	u8 *buf = data->msg_buf;
+	int count, done = 0;
+	int error;
+
+	if (data->T5_address == data->T44_address + 1) {
+		error = __mxt_read_reg(client, data->T44_address, 1 + size,
+				       buf);
+		if (error)
+			return error;
+		count = buf[0];
+		if (!count)
+			return 0;
+		memmove(buf, buf + 1, size);
+		done = 1;
+	} else {
+		error = __mxt_read_reg(client, data->T44_address, 1, buf);
+		if (error)
+			return error;
+		count = buf[0];
+	}
+
+	if (count > data->max_reportid) {
+		dev_warn(&client->dev, "T44 count %d exceeded max report id\n",
+			 count);
+		count = data->max_reportid;
+	}
+
+	if (count > done) {
+		error = __mxt_read_reg(client, data->T5_address,
+				       (count - done) * size,
+				       buf + done * size);
+		if (error)
+			return error;
+	}
+
+	return count;
+}
+
+static irqreturn_t mxt_hardirq(int irq, void *dev_id)
+{
+	struct mxt_data *data = dev_id;
+
+	data->irq_time = ktime_get();
+	return IRQ_WAKE_THREAD;
 }
 
 static irqreturn_t mxt_interrupt(int irq, void *dev_id)
 {
 	struct mxt_data *data = dev_id;
-	struct mxt_message message;
-	struct mxt_object *object;
 	struct device *dev = &data->client->dev;
-	int id;
-	u8 reportid;
-	u8 max_reportid;
-	u8 min_reportid;
+	ktime_t i2c_time, sync_time;
+	int count, i;
+	u8 *msg;
 
-	do {
-		if (mxt_read_message(data, &message)) {
-			dev_err(dev, "Failed to read message\n");
+	data->update_input = false;
+
+	if (data->T44_address) {
+		count = mxt_read_messages_t44(data);
+		if (count < 0) {
+			dev_err(dev, "Failed to read messages\n");
 			goto end;
 		}
+		i2c_time = ktime_get();
 
-		reportid = message.reportid;
-
-		/* whether reportid is thing of MXT_TOUCH_MULTI_T9 */
-		object = mxt_get_object(data, MXT_TOUCH_MULTI_T9);
-		if (!object)
-			goto end;
+		for (i = 0; i < count; i++) {
+			msg = data->msg_buf + i * data->T5_msg_size;
+			if (msg[0] != 0xff)
+				mxt_proc_message(data, msg);
+		}
+	} else {
+		/* no message count, read one message at a time until empty */
+		msg = data->msg_buf;
+		do {
+			if (__mxt_read_reg(data->client, data->T5_address,
+					   data->T5_msg_size, msg)) {
+				dev_err(dev, "Failed to read message\n");
+				goto end;
+			}
+			if (msg[0] != 0xff)
+				mxt_proc_message(data, msg);
+		} while (msg[0] != 0xff);
+		i2c_time = ktime_get();
+	}
 
-		max_reportid = object->max_reportid;
-		min_reportid = max_reportid - object->num_report_ids + 1;
-		id = reportid - min_reportid;
+	if (data->update_input) {
+		mxt_input_report(data, data->last_id);
+		sync_time = ktime_get();
 
-		if (reportid >= min_reportid && reportid <= max_reportid)
-			mxt_input_touchevent(data, &message, id);
-		else
-			mxt_dump_message(dev, &message);
-	} while (reportid != 0xff);
+		mxt_latency_add(data, MXT_LAT_IRQ_TO_I2C, data->irq_time,
+				i2c_time);
+		mxt_latency_add(data, MXT_LAT_I2C_TO_SYNC, i2c_time,
+				sync_time);
+		mxt_latency_add(data, MXT_LAT_IRQ_TO_SYNC, data->irq_time,
+				sync_time);
+	}
 
 end:
 	return IRQ_HANDLED;
@@ -812,8 +971,31 @@ static int mxt_get_object_table(struct mxt_data *data)
 					(object->instances + 1);
 			object->max_reportid = reportid;
 		}
+
+		switch (object->type) {
+		case MXT_GEN_MESSAGE_T5:
+			data->T5_address = object->start_address;
+			/* the checksum byte is only read when T5 has one */
+			data->T5_msg_size = min_t(unsigned int,
+						  object->size + 1,
+						  sizeof(struct mxt_message));
+			break;
+		case MXT_TOUCH_MULTI_T9:
+			data->T9_reportid_max = object->max_reportid;
+			data->T9_reportid_min = object->max_reportid -
+						object->num_report_ids *
+						(object->instances + 1) + 1;
+			break;
+		case MXT_SPT_MESSAGECOUNT_T44:
+			data->T44_address = object->start_address;
+			break;
+		}
 	}
 
+	data->max_reportid = reportid;
+	if (!data->T5_msg_size)
+		return -EINVAL;
+
 	return 0;
 }
 
@@ -837,10 +1019,23 @@ static int mxt_initialize(struct mxt_data *data)
 	}
 
 	/* Get object table information */
+	data->T44_address = 0;
+	data->T5_msg_size = 0;
+	data->T9_reportid_min = 0xff;
+	data->T9_reportid_max = 0;
 	error = mxt_get_object_table(data);
 	if (error)
 		return error;
 
+	/* worst case every report id has a message pending */
+	kfree(data->msg_buf);
+	data->msg_buf = kzalloc(max_t(unsigned int, data->max_reportid, 1) *
+				data->T5_msg_size + 1, GFP_KERNEL);
+	if (!data->msg_buf) {
+		dev_err(&client->dev, "Failed to allocate memory\n");
+		return -ENOMEM;
+	}
+
 	/* Check register init values */
 	error = mxt_check_reg_init(data);
 	if (error)
@@ -1092,6 +1287,62 @@ static void mxt_input_close(struct input_dev *dev)
 	mxt_stop(data);
 }
 
+/*
+ * <debugfs>/atmel_mxt_ts/<device> shows, for every touch frame reported,
+ * how long the kernel took from the interrupt to the messages being read
+ * and on to input_sync(). Writing anything clears the histograms.
+ */
+static int mxt_latency_show(struct seq_file *m, void *v)
+{
+	struct mxt_data *data = m->private;
+	struct mxt_latency *lat;
+	int i, j;
+
+	seq_printf(m, "%-12s %8s %8s %8s", "", "frames", "avg_us", "max_us");
+	for (j = 0; j < MXT_LAT_BUCKETS - 1; j++)
+		seq_printf(m, " <%5uus", 1U << (MXT_LAT_SHIFT + j));
+	seq_printf(m, " >=%4uus\n", 1U << (MXT_LAT_SHIFT + j - 1));
+
+	for (i = 0; i < MXT_NR_LAT; i++) {
+		lat = &data->latency[i];
+		seq_printf(m, "%-12s %8u %8llu %8u", mxt_lat_names[i],
+			   lat->count,
+			   lat->count ? div_u64(lat->total_us, lat->count) : 0,
+			   lat->max_us);
+		for (j = 0; j < MXT_LAT_BUCKETS; j++)
+			seq_printf(m, " %8u", lat->hist[j]);
+		seq_putc(m, '\n');
+	}
+
+	return 0;
+}
+
+static int mxt_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mxt_latency_show, inode->i_private);
+}
+
+static ssize_t mxt_latency_write(struct file *file, const char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+	struct mxt_data *data = m->private;
+
+	disable_irq(data->irq);
+	memset(data->latency, 0, sizeof(data->latency));
+	enable_irq(data->irq);
+
+	return count;
+}
+
+static const struct file_operations mxt_latency_fops = {
+	.open		= mxt_latency_open,
+	.read		= seq_read,
+	.write		= mxt_latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int __devinit mxt_probe(struct i2c_client *client,
 		const struct i2c_device_id *id)
 {
@@ -1154,8 +1405,9 @@ static int __devinit mxt_probe(struct i2c_client *client,
 	if (error)
 		goto err_free_object;
 
-	error = request_threaded_irq(client->irq, NULL, mxt_interrupt,
-			pdata->irqflags, client->dev.driver->name, data);
+	error = request_threaded_irq(client->irq, mxt_hardirq, mxt_interrupt,
+			pdata->irqflags | IRQF_ONESHOT,
+			client->dev.driver->name, data);
 	if (error) {
 		dev_err(&client->dev, "Failed to register interrupt\n");
 		goto err_free_object;
@@ -1173,6 +1425,12 @@ static int __devinit mxt_probe(struct i2c_client *client,
 	if (error)
 		goto err_unregister_device;
 
+	if (mxt_debugfs_root)
+		data->debugfs = debugfs_create_file(dev_name(&client->dev),
+						    S_IRUGO | S_IWUSR,
+						    mxt_debugfs_root, data,
+						    &mxt_latency_fops);
+
 	return 0;
 
 err_unregister_device:
@@ -1181,6 +1439,7 @@ err_unregister_device:
 err_free_irq:
 	free_irq(client->irq, data);
 err_free_object:
+	kfree(data->msg_buf);
 	kfree(data->object_table);
 err_free_mem:
 	input_free_device(input_dev);
@@ -1192,9 +1451,11 @@ static int __devexit mxt_remove(struct i2c_client *client)
 {
 	struct mxt_data *data = i2c_get_clientdata(client);
 
+	debugfs_remove(data->debugfs);
 	sysfs_remove_group(&client->dev.kobj, &mxt_attr_group);
 	free_irq(data->irq, data);
 	input_unregister_device(data->input_dev);
+	kfree(data->msg_buf);
 	kfree(data->object_table);
 	kfree(data);
 
@@ -1269,12 +1530,17 @@ static struct i2c_driver mxt_driver = {
 
 static int __init mxt_init(void)
 {
+	mxt_debugfs_root = debugfs_create_dir("atmel_mxt_ts", NULL);
+	if (IS_ERR(mxt_debugfs_root))
+		mxt_debugfs_root = NULL;
+
 	return i2c_add_driver(&mxt_driver);
 }
 
 static void __exit mxt_exit(void)
 {
 	i2c_del_driver(&mxt_driver);
+	debugfs_remove(mxt_debugfs_root);
 }
 
 module_init(mxt_init);
@@ -6044,6 +6044,15 @@ _cyttsp4_startup_exit:
 }
 #endif /* --CY_USE_TMA884 */
 
+static irqreturn_t cyttsp4_hardirq(int irq, void *handle)
+{
+	struct cyttsp4 *ts = handle;
+
+	/* the report is read in the thread, date it from the edge */
+	input_set_timestamp(ts->input, ktime_get());
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t cyttsp4_irq(int irq, void *handle)
 {
 	struct cyttsp4 *ts = handle;
@@ -6494,7 +6503,7 @@ void *cyttsp4_core_init(struct cyttsp4_bus_ops *bus_ops,
 #else
 	irq_flags = IRQF_TRIGGER_FALLING | IRQF_ONESHOT;
 #endif
-	retval = request_threaded_irq(ts->irq, NULL, cyttsp4_irq,
+	retval = request_threaded_irq(ts->irq, cyttsp4_hardirq, cyttsp4_irq,
 		irq_flags, ts->input->name, ts);
 	if (retval < 0) {
 		dev_err(ts->dev,
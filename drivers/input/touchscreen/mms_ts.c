@@ -3200,6 +3200,7 @@ static struct i2c_driver mms_ts_driver = {
 	.remove = __devexit_p(mms_ts_remove),
 	.driver = {
 		   .name = MELFAS_TS_NAME,
+		   .probe_type = PROBE_PREFER_ASYNCHRONOUS,
 #if defined(CONFIG_PM) && !defined(CONFIG_HAS_EARLYSUSPEND)
 		   .pm = &mms_ts_pm_ops,
 #endif
@@ -60,6 +60,7 @@ struct dm_crypt_io {
 	int error;
 	sector_t sector;
 	struct dm_crypt_io *base_io;
+	int cpu;			/* runs the crypt work */
 };
 
 struct dm_crypt_request {
@@ -111,6 +112,8 @@ struct crypt_cpu {
 	struct ablkcipher_request *req;
 	/* ESSIV: struct crypto_cipher *essiv_tfm */
 	void *iv_private;
+	/* last cpu a chunk of a large bio submitted here went to */
+	int next_cpu;
 	struct crypto_ablkcipher *tfms[0];
 };
 
@@ -177,6 +180,13 @@ struct crypt_config {
 #define MIN_IOS        16
 #define MIN_POOL_PAGES 32
 
+/*
+ * Bios are split into chunks of this many sectors. Chunks of a large bio
+ * are converted on all online cpus in turn, smaller bios stay on the cpu
+ * that submitted them.
+ */
+#define DM_CRYPT_SPLIT_SECTORS	256
+
 static struct kmem_cache *_crypt_io_pool;
 
 static void clone_init(struct dm_crypt_io *, struct bio *);
@@ -895,11 +905,33 @@ static struct dm_crypt_io *crypt_io_alloc(struct dm_target *ti,
 	io->sector = sector;
 	io->error = 0;
 	io->base_io = NULL;
+	io->cpu = raw_smp_processor_id();
 	atomic_set(&io->pending, 0);
 
 	return io;
 }
 
+/*
+ * A chunk of a split large bio goes to the cpu after the one that got the
+ * previous chunk from this submitter.
+ */
+static int crypt_pick_cpu(struct crypt_config *cc, struct bio *bio)
+{
+	struct crypt_cpu *cs;
+	int cpu = get_cpu();
+
+	if (bio_sectors(bio) >= DM_CRYPT_SPLIT_SECTORS) {
+		cs = per_cpu_ptr(cc->cpu, cpu);
+		cpu = cpumask_next(cs->next_cpu, cpu_online_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_online_mask);
+		cs->next_cpu = cpu;
+	}
+	put_cpu();
+
+	return cpu;
+}
+
 static void crypt_inc_pending(struct dm_crypt_io *io)
 {
 	atomic_inc(&io->pending);
@@ -1232,7 +1264,11 @@ static void kcryptd_queue_crypt(struct dm_crypt_io *io)
 	struct crypt_config *cc = io->target->private;
 
 	INIT_WORK(&io->work, kcryptd_crypt);
-	queue_work(cc->crypt_queue, &io->work);
+	/* a read completes on the irq cpu, convert it where it was issued */
+	if (cpu_online(io->cpu))
+		queue_work_on(io->cpu, cc->crypt_queue, &io->work);
+	else
+		queue_work(cc->crypt_queue, &io->work);
 }
 
 /*
@@ -1692,15 +1728,12 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		ti->error = "Couldn't create kcryptd io queue";
 		goto bad;
 	}
-#if 1
-	cc->crypt_queue = create_singlethread_workqueue("kcryptd");
-#else
+	/* one bound worker per cpu, see kcryptd_queue_crypt() */
 	cc->crypt_queue = alloc_workqueue("kcryptd",
 					  WQ_NON_REENTRANT|
 					  WQ_CPU_INTENSIVE|
 					  WQ_MEM_RECLAIM,
 					  1);
-#endif
 	if (!cc->crypt_queue) {
 		ti->error = "Couldn't create kcryptd queue";
 		goto bad;
@@ -1708,6 +1741,7 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 
 	ti->num_flush_requests = 1;
 	ti->discard_zeroes_data_unsupported = 1;
+	ti->split_io = DM_CRYPT_SPLIT_SECTORS;
 
 	return 0;
 
@@ -1736,6 +1770,7 @@ static int crypt_map(struct dm_target *ti, struct bio *bio,
 	}
 
 	io = crypt_io_alloc(ti, bio, dm_target_offset(ti, bio->bi_sector));
+	io->cpu = crypt_pick_cpu(ti->private, bio);
 
 	if (bio_data_dir(io->base_bio) == READ) {
 		if (kcryptd_io_read(io, GFP_NOWAIT))
@@ -4361,6 +4361,7 @@ static struct i2c_driver sii9234_mhl_tx_i2c_driver = {
 	.driver = {
 		   .owner = THIS_MODULE,
 		   .name = "sii9234_mhl_tx",
+		   .probe_type = PROBE_PREFER_ASYNCHRONOUS,
 #ifdef CONFIG_SLP
 		   .pm = &sii9234_pm_ops,
 #endif
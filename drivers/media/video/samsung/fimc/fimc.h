@@ -17,6 +17,7 @@
 #ifdef __KERNEL__
 #include <linux/wait.h>
 #include <linux/mutex.h>
+#include <linux/ktime.h>
 #include <linux/i2c.h>
 #include <linux/fb.h>
 #include <linux/videodev2.h>
@@ -277,9 +278,23 @@ struct fimc_buf_set {
 	atomic_t		mapped_cnt;
 	dma_addr_t		paddr_pktdata;
 	u32			*vaddr_pktdata;
+	ktime_t			stamp;		/* last qbuf or frame done */
 	struct list_head	list;
 };
 
+/* capture queue statistics, exported through the cap_stats attribute */
+struct fimc_cap_stats {
+	u32			queued;		/* buffers given to the hardware */
+	u32			done;		/* frames written */
+	u32			dequeued;
+	u32			dropped;	/* skipped or overflowed frames */
+	u32			max_depth;	/* most frames waiting for dqbuf */
+	u64			hw_lat_us;	/* qbuf to frame done, summed */
+	u32			hw_lat_max_us;
+	u64			out_lat_us;	/* frame done to dqbuf, summed */
+	u32			out_lat_max_us;
+};
+
 /* for capture device */
 struct fimc_capinfo {
 	struct v4l2_cropcap	cropcap;
@@ -501,6 +516,7 @@ struct fimc_control {
 	struct fimc_fbinfo		fb;		/* fimd info */
 	struct fimc_scaler		sc;		/* scaler info */
 	struct fimc_effect		fe;		/* fimc effect info */
+	struct fimc_cap_stats		cap_stats;
 
 	enum fimc_status		status;
 	enum fimc_log			log;
@@ -2041,8 +2041,12 @@ int fimc_reqbufs_capture_userptr(void *fh, struct v4l2_requestbuffers *b)
 
 int fimc_reqbufs_capture(void *fh, struct v4l2_requestbuffers *b)
 {
+	struct fimc_control *ctrl = fh;
 	int ret = 0;
 
+	/* statistics cover one set of buffers */
+	memset(&ctrl->cap_stats, 0, sizeof(ctrl->cap_stats));
+
 	if (b->memory == V4L2_MEMORY_MMAP)
 		ret = fimc_reqbufs_capture_mmap(fh, b);
 	else
@@ -3305,6 +3309,55 @@ static void fimc_buf2bs(struct fimc_buf_set *bs, struct fimc_buf *buf)
 	bs->length[FIMC_ADDR_CR] =  buf->length[FIMC_ADDR_CR];
 }
 
+/*
+ * Buffers only read by other hardware (MFC, FIMD overlay) can be queued
+ * with V4L2_BUF_FLAG_NO_CACHE_CLEAN/INVALIDATE to skip this.
+ */
+static void fimc_cap_sync_buf(struct fimc_buf_set *bs)
+{
+	size_t length = 0;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		if (bs->base[i])
+			length += bs->length[i];
+		else
+			break;
+	}
+
+	if (length > (unsigned long) L2_FLUSH_ALL) {
+		flush_cache_all();      /* L1 */
+		smp_call_function((smp_call_func_t)__cpuc_flush_kern_all, NULL, 1);
+		outer_flush_all();      /* L2 */
+	} else if (length > (unsigned long) L1_FLUSH_ALL) {
+		flush_cache_all();      /* L1 */
+		smp_call_function((smp_call_func_t)__cpuc_flush_kern_all, NULL, 1);
+
+		for (i = 0; i < 3; i++) {
+			phys_addr_t start = bs->base[i];
+			phys_addr_t end   = bs->base[i] +
+					    bs->length[i] - 1;
+
+			if (!start)
+				break;
+
+			outer_flush_range(start, end);  /* L2 */
+		}
+	} else {
+		for (i = 0; i < 3; i++) {
+			phys_addr_t start = bs->base[i];
+			phys_addr_t end   = bs->base[i] +
+					    bs->length[i] - 1;
+
+			if (!start)
+				break;
+
+			dmac_flush_range(phys_to_virt(start), phys_to_virt(end));
+			outer_flush_range(start, end);  /* L2 */
+		}
+	}
+}
+
 int fimc_qbuf_capture(void *fh, struct v4l2_buffer *b)
 {
 	struct fimc_control *ctrl = fh;
@@ -3313,7 +3366,6 @@ int fimc_qbuf_capture(void *fh, struct v4l2_buffer *b)
 	int idx = b->index;
 	int framecnt_seq;
 	int available_bufnum;
-	size_t length = 0;
 	int i;
 	unsigned long spin_flags;
 
@@ -3391,6 +3443,8 @@ int fimc_qbuf_capture(void *fh, struct v4l2_buffer *b)
 			spin_lock_irqsave(&ctrl->inq_lock, spin_flags);
 			fimc_hwset_output_buf_sequence(ctrl, idx, FIMC_FRAMECNT_SEQ_ENABLE);
 			cap->bufs[idx].state = VIDEOBUF_QUEUED;
+			cap->bufs[idx].stamp = ktime_get();
+			ctrl->cap_stats.queued++;
 			if (ctrl->status == FIMC_BUFFER_STOP) {
 				framecnt_seq = fimc_hwget_output_buf_sequence(ctrl);
 				available_bufnum =
@@ -3410,47 +3464,10 @@ int fimc_qbuf_capture(void *fh, struct v4l2_buffer *b)
 		fimc_add_inqueue(ctrl, b->index);
 	}
 
-	if (!cap->cacheable)
+	if (!cap->cacheable || (b->flags & V4L2_BUF_FLAG_NO_CACHE_CLEAN))
 		return 0;
 
-	for (i = 0; i < 3; i++) {
-		if (cap->bufs[b->index].base[i])
-			length += cap->bufs[b->index].length[i];
-		else
-			break;
-	}
-
-	if (length > (unsigned long) L2_FLUSH_ALL) {
-		flush_cache_all();      /* L1 */
-		smp_call_function((smp_call_func_t)__cpuc_flush_kern_all, NULL, 1);
-		outer_flush_all();      /* L2 */
-	} else if (length > (unsigned long) L1_FLUSH_ALL) {
-		flush_cache_all();      /* L1 */
-		smp_call_function((smp_call_func_t)__cpuc_flush_kern_all, NULL, 1);
-
-		for (i = 0; i < 3; i++) {
-			phys_addr_t start = cap->bufs[b->index].base[i];
-			phys_addr_t end   = cap->bufs[b->index].base[i] +
-					    cap->bufs[b->index].length[i] - 1;
-
-			if (!start)
-				break;
-
-			outer_flush_range(start, end);  /* L2 */
-		}
-	} else {
-		for (i = 0; i < 3; i++) {
-			phys_addr_t start = cap->bufs[b->index].base[i];
-			phys_addr_t end   = cap->bufs[b->index].base[i] +
-					    cap->bufs[b->index].length[i] - 1;
-
-			if (!start)
-				break;
-
-			dmac_flush_range(phys_to_virt(start), phys_to_virt(end));
-			outer_flush_range(start, end);  /* L2 */
-		}
-	}
+	fimc_cap_sync_buf(&cap->bufs[b->index]);
 
 	return 0;
 }
@@ -3473,8 +3490,9 @@ int fimc_dqbuf_capture(void *fh, struct v4l2_buffer *b)
 	struct fimc_control *ctrl = fh;
 	struct fimc_capinfo *cap = ctrl->cap;
 	struct fimc_buf_set *bs;
-	size_t length = 0;
-	int i, pp, ret = 0;
+	u32 flags = b->flags;
+	u32 lat;
+	int pp, ret = 0;
 	phys_addr_t start, end;
 
 	struct s3c_platform_fimc *pdata = to_fimc_plat(ctrl->dev);
@@ -3535,6 +3553,12 @@ int fimc_dqbuf_capture(void *fh, struct v4l2_buffer *b)
 			}
 
 			list_del(&bs->list);
+
+			lat = ktime_us_delta(ktime_get(), bs->stamp);
+			ctrl->cap_stats.dequeued++;
+			ctrl->cap_stats.out_lat_us += lat;
+			ctrl->cap_stats.out_lat_max_us =
+				max(ctrl->cap_stats.out_lat_max_us, lat);
 		}
 
 		spin_unlock_irqrestore(&ctrl->outq_lock, spin_flags);
@@ -3564,47 +3588,10 @@ int fimc_dqbuf_capture(void *fh, struct v4l2_buffer *b)
 		outer_flush_range(start, end);	/* L2 */
 	}
 
-	if (!cap->cacheable)
+	if (!cap->cacheable || (flags & V4L2_BUF_FLAG_NO_CACHE_INVALIDATE))
 		return ret;
 
-	for (i = 0; i < 3; i++) {
-		if (cap->bufs[b->index].base[i])
-			length += cap->bufs[b->index].length[i];
-		else
-			break;
-	}
-
-	if (length > (unsigned long) L2_FLUSH_ALL) {
-		flush_cache_all();      /* L1 */
-		smp_call_function((smp_call_func_t)__cpuc_flush_kern_all, NULL, 1);
-		outer_flush_all();      /* L2 */
-	} else if (length > (unsigned long) L1_FLUSH_ALL) {
-		flush_cache_all();      /* L1 */
-		smp_call_function((smp_call_func_t)__cpuc_flush_kern_all, NULL, 1);
-
-		for (i = 0; i < 3; i++) {
-			phys_addr_t start = cap->bufs[b->index].base[i];
-			phys_addr_t end   = cap->bufs[b->index].base[i] +
-					    cap->bufs[b->index].length[i] - 1;
-
-			if (!start)
-				break;
-
-			outer_flush_range(start, end);  /* L2 */
-		}
-	} else {
-		for (i = 0; i < 3; i++) {
-			phys_addr_t start = cap->bufs[b->index].base[i];
-			phys_addr_t end   = cap->bufs[b->index].base[i] +
-					    cap->bufs[b->index].length[i] - 1;
-
-			if (!start)
-				break;
-
-			dmac_flush_range(phys_to_virt(start), phys_to_virt(end));
-			outer_flush_range(start, end);  /* L2 */
-		}
-	}
+	fimc_cap_sync_buf(&cap->bufs[b->index]);
 
 	return ret;
 }
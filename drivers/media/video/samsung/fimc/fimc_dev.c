@@ -33,6 +33,7 @@
 #include <linux/delay.h>
 #include <linux/cma.h>
 #include <linux/dma-mapping.h>
+#include <linux/math64.h>
 #include <plat/fimc.h>
 #include <plat/clock.h>
 #include <mach/regs-pmu.h>
@@ -498,8 +499,11 @@ int fimc_hwget_number_of_bits(u32 framecnt_seq)
 static int fimc_add_outgoing_queue(struct fimc_control *ctrl, int i)
 {
 	struct fimc_capinfo *cap = ctrl->cap;
+	struct fimc_cap_stats *stats = &ctrl->cap_stats;
 	struct fimc_buf_set *tmp_buf;
 	struct list_head *count;
+	ktime_t now = ktime_get();
+	u32 lat, depth = 1;
 
 	spin_lock(&ctrl->outq_lock);
 
@@ -511,8 +515,16 @@ static int fimc_add_outgoing_queue(struct fimc_control *ctrl, int i)
 			spin_unlock(&ctrl->outq_lock);
 			return 0;
 		}
+		depth++;
 	}
 	list_add_tail(&cap->bufs[i].list, &cap->outgoing_q);
+
+	lat = ktime_us_delta(now, cap->bufs[i].stamp);
+	cap->bufs[i].stamp = now;
+	stats->done++;
+	stats->hw_lat_us += lat;
+	stats->hw_lat_max_us = max(stats->hw_lat_max_us, lat);
+	stats->max_depth = max(stats->max_depth, depth);
 	spin_unlock(&ctrl->outq_lock);
 
 	return 0;
@@ -542,6 +554,7 @@ static inline void fimc_irq_cap(struct fimc_control *ctrl)
 #endif
 	fimc_hwset_clear_irq(ctrl);
 	if (fimc_hwget_overflow_state(ctrl)) {
+		ctrl->cap_stats.dropped++;
 		ctrl->restart = true;
 		return;
 	}
@@ -564,6 +577,7 @@ static inline void fimc_irq_cap(struct fimc_control *ctrl)
 		fimc_info2("%s[%d]\n", __func__, pp);
 		if (pp == 0 || ctrl->restart) {
 			printk(KERN_INFO "%s[%d] SKIPPED\n", __func__, pp);
+			ctrl->cap_stats.dropped++;
 			if (ctrl->cap->nr_bufs == 1) {
 				fimc_stop_capture(ctrl);
 #ifndef FIMC_FRAME_START_END_IRQ_ENABLE
@@ -1114,6 +1128,26 @@ static int fimc_mmap(struct file *filp, struct vm_area_struct *vma)
 }
 
 #ifdef CONFIG_SLP_DMABUF
+/*
+ * A DMABUF plane is attached and mapped the first time it is queued and
+ * stays mapped while the same buffer keeps coming back, so a preview ring
+ * is only mapped once.
+ */
+static void _fimc_dmabuf_put_plane(struct vb2_buffer *vb, unsigned int plane)
+{
+	struct dma_buf_attachment *dba = vb->planes[plane].mem_priv;
+
+	if (dba) {
+		if (dba->priv)
+			dma_buf_unmap_attachment(dba, dba->priv,
+					DMA_BIDIRECTIONAL);
+		dma_buf_detach(vb->planes[plane].dbuf, dba);
+		dma_buf_put(vb->planes[plane].dbuf);
+		vb->planes[plane].dbuf = NULL;
+		vb->planes[plane].mem_priv = NULL;
+	}
+}
+
 /**
  * _fimc_dmabuf_put() - release memory associated with
  * a DMABUF shared buffer
@@ -1122,17 +1156,8 @@ static void _fimc_dmabuf_put(struct vb2_buffer *vb)
 {
 	unsigned int plane;
 
-	for (plane = 0; plane < vb->num_planes; ++plane) {
-		void *mem_priv = vb->planes[plane].mem_priv;
-
-		if (mem_priv) {
-			dma_buf_detach(vb->planes[plane].dbuf,
-					vb->planes[plane].mem_priv);
-			dma_buf_put(vb->planes[plane].dbuf);
-			vb->planes[plane].dbuf = NULL;
-			vb->planes[plane].mem_priv = NULL;
-		}
-	}
+	for (plane = 0; plane < vb->num_planes; ++plane)
+		_fimc_dmabuf_put_plane(vb, plane);
 }
 
 void _fimc_queue_free(struct fimc_control *ctrl, enum v4l2_buf_type type)
@@ -1305,7 +1330,8 @@ int _qbuf_dmabuf(struct fimc_control *ctrl, struct vb2_buffer *vb,
 			continue;
 		}
 
-		vb->planes[plane].mem_priv = NULL;
+		/* a different buffer in this slot, drop the old mapping */
+		_fimc_dmabuf_put_plane(vb, plane);
 
 		dba = dma_buf_attach(dbuf, ctrl->dev);
 		if (IS_ERR(dba)) {
@@ -1315,6 +1341,10 @@ int _qbuf_dmabuf(struct fimc_control *ctrl, struct vb2_buffer *vb,
 			goto err;
 		}
 
+		dba->priv = NULL;
+		vb->planes[plane].dbuf = dbuf;
+		vb->planes[plane].mem_priv = dba;
+
 		sg = dma_buf_map_attachment(dba, DMA_BIDIRECTIONAL);
 		if (IS_ERR(sg)) {
 			fimc_err("qbuf: failed acquiring dmabuf "
@@ -1324,9 +1354,6 @@ int _qbuf_dmabuf(struct fimc_control *ctrl, struct vb2_buffer *vb,
 		}
 		dba->priv = sg;
 
-		vb->planes[plane].dbuf = dbuf;
-		vb->planes[plane].mem_priv = dba;
-
 		vb->v4l2_planes[plane] = planes[plane];
 	}
 
@@ -1342,23 +1369,9 @@ int _dqbuf_dmabuf(struct fimc_control *ctrl, struct vb2_buffer *vb,
 		struct v4l2_buffer *b)
 {
 	struct v4l2_plane planes[VIDEO_MAX_PLANES];
-	struct sg_table *sg[VIDEO_MAX_PLANES];
-	struct dma_buf_attachment *dba[VIDEO_MAX_PLANES];
-	unsigned int plane;
-	int ret;
 
-	ret = _fill_v4l2_buffer(vb, b, planes);
-	if (ret)
-		return ret;
-
-	for (plane = 0; plane < vb->num_planes; ++plane) {
-		dba[plane] = vb->planes[plane].mem_priv;
-		sg[plane] = dba[plane]->priv;
-		dma_buf_unmap_attachment(dba[plane],
-			sg[plane], DMA_FROM_DEVICE);
-	}
-
-	return 0;
+	/* the mapping is kept for the next qbuf of this buffer */
+	return _fill_v4l2_buffer(vb, b, planes);
 }
 #endif
 
@@ -2176,6 +2189,30 @@ static DEVICE_ATTR(range_mode, 0644, \
 			fimc_show_range_mode,
 			fimc_store_range_mode);
 
+static ssize_t fimc_show_cap_stats(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct fimc_control *ctrl = get_fimc_ctrl(to_platform_device(dev)->id);
+	struct fimc_cap_stats st;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ctrl->outq_lock, flags);
+	st = ctrl->cap_stats;
+	spin_unlock_irqrestore(&ctrl->outq_lock, flags);
+
+	return sprintf(buf, "queued %u done %u dequeued %u dropped %u "
+			"max_depth %u\nhw_lat avg %llu max %u us\n"
+			"out_lat avg %llu max %u us\n",
+			st.queued, st.done, st.dequeued, st.dropped,
+			st.max_depth,
+			st.done ? div_u64(st.hw_lat_us, st.done) : 0,
+			st.hw_lat_max_us,
+			st.dequeued ? div_u64(st.out_lat_us, st.dequeued) : 0,
+			st.out_lat_max_us);
+}
+
+static DEVICE_ATTR(cap_stats, 0444, fimc_show_cap_stats, NULL);
+
 static int __devinit fimc_probe(struct platform_device *pdev)
 {
 	struct s3c_platform_fimc *pdata;
@@ -2242,6 +2279,11 @@ static int __devinit fimc_probe(struct platform_device *pdev)
 		fimc_err("failed to add sysfs entries for range mode\n");
 		goto err_create_file;
 	}
+	ret = device_create_file(&(pdev->dev), &dev_attr_cap_stats);
+	if (ret < 0) {
+		fimc_err("failed to add sysfs entries for capture stats\n");
+		goto err_create_stats;
+	}
 	printk(KERN_INFO "FIMC%d registered successfully\n", ctrl->id);
 #if (defined(CONFIG_EXYNOS_DEV_PD) && defined(CONFIG_PM_RUNTIME))
 	sprintf(buf, "fimc%d_iqr_wq_name", ctrl->id);
@@ -2270,6 +2312,9 @@ static int __devinit fimc_probe(struct platform_device *pdev)
 	return 0;
 
 err_wq:
+	 device_remove_file(&(pdev->dev), &dev_attr_cap_stats);
+
+err_create_stats:
 	 device_remove_file(&(pdev->dev), &dev_attr_range_mode);
 
 err_create_file:
@@ -2294,6 +2339,7 @@ static int fimc_remove(struct platform_device *pdev)
 {
 	fimc_unregister_controller(pdev);
 
+	device_remove_file(&(pdev->dev), &dev_attr_cap_stats);
 	device_remove_file(&(pdev->dev), &dev_attr_log_level);
 
 	kfree(fimc_dev);
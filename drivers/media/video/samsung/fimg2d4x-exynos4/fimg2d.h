@@ -22,7 +22,11 @@
 #include <linux/platform_device.h>
 #include <linux/atomic.h>
 #include <linux/dma-mapping.h>
+#include <linux/mmu_notifier.h>
 #include <asm/cacheflush.h>
+#ifdef CONFIG_SW_SYNC
+#include <linux/sw_sync.h>
+#endif
 
 #define FIMG2D_MINOR			(240)
 #define to_fimg2d_plat(d)		(to_platform_device(d)->dev.platform_data)
@@ -42,6 +46,7 @@
 #define FIMG2D_BITBLT_VERSION	_IOR(FIMG2D_IOCTL_MAGIC, 2, struct fimg2d_version)
 #define FIMG2D_BITBLT_SECURE	_IOW(FIMG2D_IOCTL_MAGIC, 3, unsigned int)
 #define FIMG2D_BITBLT_DBUFFER	_IOW(FIMG2D_IOCTL_MAGIC, 4, unsigned long)
+#define FIMG2D_BITBLT_BLIT_FENCE	_IOWR(FIMG2D_IOCTL_MAGIC, 5, struct fimg2d_blit_fence)
 
 #define SEQ_NO_BLT_SKIA                0x00000001
 #define SEQ_NO_BLT_HWC_SEC             0x00000012
@@ -58,7 +63,8 @@ struct fimg2d_version {
 
 /**
  * @BLIT_SYNC: sync mode, to wait for blit done irq
- * @BLIT_ASYNC: async mode, not to wait for blit done irq
+ * @BLIT_ASYNC: async mode, not to wait for blit done irq,
+ *              FIMG2D_BITBLT_SYNC waits for all async blits of the context
  *
  */
 enum blit_sync {
@@ -279,11 +285,13 @@ enum image_object {
 /**
  * @size: dma size of image
  * @cached: cached dma size of image
+ * @pt_clean: pagetable was checked and cleaned by an earlier blit
  */
 struct fimg2d_dma {
 	unsigned long addr;
 	size_t size;
 	size_t cached;
+	bool pt_clean;
 };
 
 #endif /* __KERNEL__ */
@@ -399,6 +407,17 @@ struct fimg2d_blit {
 	unsigned int seq_no;
 };
 
+/**
+ * @blit: blit request, always queued in async mode
+ * @acquire_fd: sync fence to wait for before the blit starts, -1 if none
+ * @release_fd: returns a sync fence signaled when the blit is done
+ */
+struct fimg2d_blit_fence {
+	struct fimg2d_blit blit;
+	int acquire_fd;
+	int release_fd;
+};
+
 #ifdef __KERNEL__
 
 /**
@@ -428,10 +447,29 @@ struct fimg2d_perf {
 #endif
 };
 
+#define FIMG2D_PT_CACHE_SIZE	8
+
+/**
+ * @start: first user address of a checked range
+ * @end: end of the range, 0 for an unused entry
+ * @write: pagetable was checked for write access
+ * @uncached: range is mapped uncached or write-combined
+ */
+struct fimg2d_pt_entry {
+	unsigned long start;
+	unsigned long end;
+	bool write;
+	bool uncached;
+};
+
 /**
  * @pgd: base address of arm mmu pagetable
  * @ncmd: request count in blit command queue
  * @wait_q: conext wait queue head
+ * @mn: drops pt_cache entries when the user pagetable changes
+ * @pt_lock: protects pt_cache and pt_next
+ * @pt_cache: user ranges whose pagetable is checked and cleaned
+ * @pt_next: next pt_cache entry to replace
 */
 struct fimg2d_context {
 	struct mm_struct *mm;
@@ -439,11 +477,26 @@ struct fimg2d_context {
 	wait_queue_head_t wait_q;
 	struct fimg2d_perf perf[MAX_PERF_DESCS];
 	unsigned long *pgd_clone;
+#ifdef CONFIG_MMU_NOTIFIER
+	struct mmu_notifier mn;
+#endif
+	spinlock_t pt_lock;
+	struct fimg2d_pt_entry pt_cache[FIMG2D_PT_CACHE_SIZE];
+	int pt_next;
+};
+
+/**
+ * @acquire: sync fence to wait for before the blit starts
+ * @release: returns the timeline value signaled when the blit is done
+ */
+struct fimg2d_fence {
+	struct sync_fence *acquire;
+	unsigned int release;
 };
 
 /**
  * @op: blit operation mode
- * @sync: sync/async blit mode (currently support sync mode only)
+ * @sync: sync/async blit mode, an async command holds a reference of ctx->mm
  * @image: array of image object.
  *         [0] is for src image
  *         [1] is for mask image
@@ -457,6 +510,8 @@ struct fimg2d_context {
  * @dma: array of dma info for each src, msk, tmp and dst
  * @ctx: context is created when user open fimg2d device.
  * @node: list head of blit command queue
+ * @acquire_fence: fence waited for by kfimg2dd before the blit starts
+ * @release: 1 if the blit done advances the fence timeline
  */
 struct fimg2d_bltcmd {
 	enum blit_op op;
@@ -468,6 +523,10 @@ struct fimg2d_bltcmd {
 	struct fimg2d_dma dma[MAX_IMAGES];
 	struct fimg2d_context *ctx;
 	struct list_head node;
+#ifdef CONFIG_SW_SYNC
+	struct sync_fence *acquire_fence;
+	int release;
+#endif
 };
 
 /**
@@ -484,6 +543,8 @@ struct fimg2d_bltcmd {
  * @wait_q: blit wait queue head
  * @cmd_q: blit command queue
  * @workqueue: workqueue_struct for kfimg2dd
+ * @timeline: sync timeline advanced by every fenced blit
+ * @timeline_max: last timeline value handed out, protected by bltlock
 */
 struct fimg2d_control {
 	atomic_t suspended;
@@ -505,6 +566,10 @@ struct fimg2d_control {
 	wait_queue_head_t wait_q;
 	struct list_head cmd_q;
 	struct workqueue_struct *work_q;
+#ifdef CONFIG_SW_SYNC
+	struct sw_sync_timeline *timeline;
+	unsigned int timeline_max;
+#endif
 
 	void (*blit)(struct fimg2d_control *info);
 	int (*configure)(struct fimg2d_control *info,
@@ -18,6 +18,7 @@
 #include <linux/dma-mapping.h>
 #include <asm/cacheflush.h>
 #include <plat/s5p-sysmmu.h>
+#include <mach/dev.h>
 #ifdef CONFIG_PM_RUNTIME
 #include <plat/devs.h>
 #include <linux/pm_runtime.h>
@@ -30,6 +31,7 @@
 #include "fimg2d_helper.h"
 
 #define BLIT_TIMEOUT	msecs_to_jiffies(500)
+#define FENCE_TIMEOUT	1000	/* msec */
 
 static inline void fimg2d4x_blit_wait(struct fimg2d_control *info, struct fimg2d_bltcmd *cmd)
 {
@@ -49,6 +51,25 @@ static void fimg2d4x_pre_bitblt(struct fimg2d_control *info, struct fimg2d_bltcm
 	/* TODO */
 }
 
+#ifdef CONFIG_SW_SYNC
+static int fimg2d4x_fence_wait(struct fimg2d_bltcmd *cmd)
+{
+	int ret;
+
+	if (!cmd->acquire_fence)
+		return 0;
+
+	ret = sync_fence_wait(cmd->acquire_fence, FENCE_TIMEOUT);
+	if (ret < 0)
+		printk(KERN_ERR "[%s] acquire fence wait error %d seq_no(%u)\n",
+				__func__, ret, cmd->seq_no);
+
+	sync_fence_put(cmd->acquire_fence);
+	cmd->acquire_fence = NULL;
+	return ret;
+}
+#endif
+
 void fimg2d4x_bitblt(struct fimg2d_control *info)
 {
 	struct fimg2d_context *ctx;
@@ -64,6 +85,17 @@ void fimg2d4x_bitblt(struct fimg2d_control *info)
 #endif
 	fimg2d_clk_on(info);
 
+	/* queued async blits run after the ioctl returned, hold the bus here */
+#ifdef CONFIG_BUSFREQ_OPP
+#if defined(CONFIG_CPU_EXYNOS4212) || defined(CONFIG_CPU_EXYNOS4412)
+#if defined(CONFIG_BUSFREQ_ELEVATION)
+	dev_lock(info->bus_dev, info->dev, 267160);
+#else
+	dev_lock(info->bus_dev, info->dev, 160160);
+#endif
+#endif
+#endif
+
 	while (1) {
 		spin_lock(&info->bltlock);
 		cmd = fimg2d_get_first_command(info);
@@ -76,6 +108,10 @@ void fimg2d4x_bitblt(struct fimg2d_control *info)
 
 		ctx = cmd->ctx;
 
+#ifdef CONFIG_SW_SYNC
+		if (fimg2d4x_fence_wait(cmd) < 0)
+			goto blitend;
+#endif
 		atomic_set(&info->busy, 1);
 
 		ret = info->configure(info, cmd);
@@ -103,8 +139,12 @@ void fimg2d4x_bitblt(struct fimg2d_control *info)
 		info->run(info);
 		fimg2d4x_blit_wait(info, cmd);
 
-		if (info->fault_addr)
+		if (info->fault_addr) {
 			fimg2d_mmutable_value_replace(cmd, info->fault_addr, 0);
+			/* nobody waits to report the fault of an async blit */
+			if (cmd->sync == BLIT_ASYNC)
+				info->fault_addr = 0;
+		}
 #ifdef PERF_PROFILE
 		perf_end(cmd->ctx, PERF_BLIT);
 #endif
@@ -113,6 +153,13 @@ void fimg2d4x_bitblt(struct fimg2d_control *info)
 			fimg2d_debug("sysmmu disable\n");
 		}
 blitend:
+#ifdef CONFIG_SW_SYNC
+		if (cmd->release)
+			sw_sync_timeline_inc(info->timeline, 1);
+#endif
+		if (cmd->sync == BLIT_ASYNC)
+			mmput(ctx->mm);
+
 		spin_lock(&info->bltlock);
 		fimg2d_dequeue(&cmd->node);
 		kfree(cmd);
@@ -124,6 +171,11 @@ blitend:
 		spin_unlock(&info->bltlock);
 	}
 
+#ifdef CONFIG_BUSFREQ_OPP
+#if defined(CONFIG_CPU_EXYNOS4212) || defined(CONFIG_CPU_EXYNOS4412)
+	dev_unlock(info->bus_dev, info->dev);
+#endif
+#endif
 	fimg2d_clk_off(info);
 #ifdef CONFIG_PM_RUNTIME
 	pm_runtime_put_sync(info->dev);
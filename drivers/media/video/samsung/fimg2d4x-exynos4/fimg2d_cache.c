@@ -13,6 +13,9 @@
 #include <asm/pgtable.h>
 #include <asm/cacheflush.h>
 #include <linux/dma-mapping.h>
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/mmu_notifier.h>
 
 #include "fimg2d.h"
 #include "fimg2d_cache.h"
@@ -26,6 +29,9 @@
 #define LV1_DESC_MASK		0x3
 #define LV2_DESC_MASK		0x2
 
+static void fimg2d_pt_cache_drop(struct fimg2d_context *ctx,
+				unsigned long start, unsigned long end);
+
 static inline unsigned long virt2phys(struct mm_struct *mm, unsigned long vaddr)
 {
 	unsigned long *pgd;
@@ -313,6 +319,159 @@ void fimg2d_mmutable_value_replace(struct fimg2d_bltcmd *cmd,
 
 	fimg2d_dma_sync_inner((unsigned long)lv2d, 4, DMA_BIDIRECTIONAL);
 	fimg2d_clean_outer_pagetable(cmd->ctx->mm, fault_addr, 4);
+	fimg2d_pt_cache_drop(cmd->ctx, fault_addr, fault_addr + PAGE_SIZE);
 
 	printk(KERN_INFO "MMU Level2 value replaced [0x%lx]", l2d_value);
 }
+
+/*
+ * The pagetable of a user range is checked and cleaned to memory on the
+ * first blit that uses it. It stays usable by sysmmu until the kernel
+ * changes one of its ptes, and every such change goes through the mmu
+ * notifier below, so later blits of the same buffer skip the page walks.
+ */
+static void fimg2d_pt_cache_drop(struct fimg2d_context *ctx,
+				unsigned long start, unsigned long end)
+{
+	struct fimg2d_pt_entry *e;
+	int i;
+
+	spin_lock(&ctx->pt_lock);
+	for (i = 0; i < FIMG2D_PT_CACHE_SIZE; i++) {
+		e = &ctx->pt_cache[i];
+		if (e->end && e->start < end && start < e->end)
+			e->end = 0;
+	}
+	spin_unlock(&ctx->pt_lock);
+}
+
+#ifdef CONFIG_MMU_NOTIFIER
+static void fimg2d_mn_release(struct mmu_notifier *mn, struct mm_struct *mm)
+{
+	struct fimg2d_context *ctx = container_of(mn, struct fimg2d_context, mn);
+
+	fimg2d_pt_cache_drop(ctx, 0, ULONG_MAX);
+}
+
+static int fimg2d_mn_clear_flush_young(struct mmu_notifier *mn,
+				struct mm_struct *mm, unsigned long addr)
+{
+	struct fimg2d_context *ctx = container_of(mn, struct fimg2d_context, mn);
+
+	/* an old pte is a faulting hardware pte on arm */
+	fimg2d_pt_cache_drop(ctx, addr, addr + PAGE_SIZE);
+	return 0;
+}
+
+static void fimg2d_mn_invalidate_page(struct mmu_notifier *mn,
+				struct mm_struct *mm, unsigned long addr)
+{
+	struct fimg2d_context *ctx = container_of(mn, struct fimg2d_context, mn);
+
+	fimg2d_pt_cache_drop(ctx, addr, addr + PAGE_SIZE);
+}
+
+static void fimg2d_mn_invalidate_range_start(struct mmu_notifier *mn,
+				struct mm_struct *mm,
+				unsigned long start, unsigned long end)
+{
+	struct fimg2d_context *ctx = container_of(mn, struct fimg2d_context, mn);
+
+	fimg2d_pt_cache_drop(ctx, start, end);
+}
+
+static const struct mmu_notifier_ops fimg2d_mn_ops = {
+	.release		= fimg2d_mn_release,
+	.clear_flush_young	= fimg2d_mn_clear_flush_young,
+	.invalidate_page	= fimg2d_mn_invalidate_page,
+	.invalidate_range_start	= fimg2d_mn_invalidate_range_start,
+};
+#endif
+
+int fimg2d_pt_cache_init(struct fimg2d_context *ctx)
+{
+	spin_lock_init(&ctx->pt_lock);
+	memset(ctx->pt_cache, 0, sizeof(ctx->pt_cache));
+	ctx->pt_next = 0;
+
+#ifdef CONFIG_MMU_NOTIFIER
+	ctx->mn.ops = &fimg2d_mn_ops;
+	return mmu_notifier_register(&ctx->mn, ctx->mm);
+#else
+	return 0;
+#endif
+}
+
+void fimg2d_pt_cache_exit(struct fimg2d_context *ctx)
+{
+#ifdef CONFIG_MMU_NOTIFIER
+	mmu_notifier_unregister(&ctx->mn, ctx->mm);
+#endif
+}
+
+/**
+ * fimg2d_pt_cache_lookup - [kernel] find a checked range
+ * @write: true if the blit writes to the range
+ * @uncached: returns true if the range needs no cache maintenance
+ */
+bool fimg2d_pt_cache_lookup(struct fimg2d_context *ctx, unsigned long addr,
+				size_t size, bool write, bool *uncached)
+{
+	struct fimg2d_pt_entry *e;
+	bool hit = false;
+	int i;
+
+	spin_lock(&ctx->pt_lock);
+	for (i = 0; i < FIMG2D_PT_CACHE_SIZE; i++) {
+		e = &ctx->pt_cache[i];
+		if (!e->end || addr < e->start || addr + size > e->end)
+			continue;
+		if (write && !e->write)
+			continue;
+		*uncached = e->uncached;
+		hit = true;
+		break;
+	}
+	spin_unlock(&ctx->pt_lock);
+
+	return hit;
+}
+
+/**
+ * fimg2d_pt_cache_add - [kernel] remember a checked and cleaned range
+ *
+ * Returns true if the whole range is mapped uncached or write-combined.
+ */
+bool fimg2d_pt_cache_add(struct fimg2d_context *ctx, unsigned long addr,
+				size_t size, bool write)
+{
+	struct mm_struct *mm = ctx->mm;
+	struct vm_area_struct *vma;
+	struct fimg2d_pt_entry *e;
+	pteval_t mt;
+	bool uncached = false;
+
+	down_read(&mm->mmap_sem);
+	vma = find_vma(mm, addr);
+	if (vma && vma->vm_start <= addr && addr + size <= vma->vm_end) {
+		mt = pgprot_val(vma->vm_page_prot) & L_PTE_MT_MASK;
+		uncached = (mt != L_PTE_MT_WRITEBACK &&
+				mt != L_PTE_MT_WRITEALLOC &&
+				mt != L_PTE_MT_WRITETHROUGH);
+	}
+	up_read(&mm->mmap_sem);
+
+#ifdef CONFIG_MMU_NOTIFIER
+	/* nothing would tell us when the range goes stale */
+	spin_lock(&ctx->pt_lock);
+	e = &ctx->pt_cache[ctx->pt_next];
+	ctx->pt_next = (ctx->pt_next + 1) % FIMG2D_PT_CACHE_SIZE;
+	e->start = addr;
+	e->end = addr + size;
+	e->write = write;
+	e->uncached = uncached;
+	spin_unlock(&ctx->pt_lock);
+#endif
+
+	return uncached;
+}
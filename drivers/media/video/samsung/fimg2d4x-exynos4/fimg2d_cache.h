@@ -105,3 +105,9 @@ enum pt_status fimg2d_migrate_pagetable(unsigned long *pgd_clone,
 					unsigned long vaddr, unsigned long paddr, size_t size);
 void fimg2d_mmutable_value_replace(struct fimg2d_bltcmd *cmd,
 					unsigned long fault_addr, unsigned long l2d_value);
+int fimg2d_pt_cache_init(struct fimg2d_context *ctx);
+void fimg2d_pt_cache_exit(struct fimg2d_context *ctx);
+bool fimg2d_pt_cache_lookup(struct fimg2d_context *ctx, unsigned long addr,
+				size_t size, bool write, bool *uncached);
+bool fimg2d_pt_cache_add(struct fimg2d_context *ctx, unsigned long addr,
+				size_t size, bool write);
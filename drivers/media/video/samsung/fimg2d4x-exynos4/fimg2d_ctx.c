@@ -205,6 +205,7 @@ static int fimg2d_check_dma_sync(struct fimg2d_bltcmd *cmd)
 	int clip_x, clip_w, clip_h, y, dir, i;
 	unsigned long clip_start;
 	unsigned long modified_addr;
+	bool uncached;
 
 	clp = &p->clipping;
 
@@ -212,6 +213,7 @@ static int fimg2d_check_dma_sync(struct fimg2d_bltcmd *cmd)
 		img = &cmd->image[i];
 		c = &cmd->dma[i];
 		r = &img->rect;
+		uncached = false;
 
 		if (!img->addr.type)
 			continue;
@@ -227,12 +229,19 @@ static int fimg2d_check_dma_sync(struct fimg2d_bltcmd *cmd)
 
 		/* check pagetable */
 		if (img->addr.type == ADDR_USER) {
-			if (i == IMAGE_DST)
-				pt = fimg2d_check_out_pagetable(mm, c->addr, c->size);
-			else
-				pt = fimg2d_check_in_pagetable(mm, c->addr, c->size);
-			if (pt == PT_FAULT)
-				return -1;
+			if (fimg2d_pt_cache_lookup(cmd->ctx, c->addr, c->size,
+						i == IMAGE_DST, &uncached)) {
+				c->pt_clean = true;
+			} else {
+				if (i == IMAGE_DST)
+					pt = fimg2d_check_out_pagetable(mm, c->addr, c->size);
+				else
+					pt = fimg2d_check_in_pagetable(mm, c->addr, c->size);
+				if (pt == PT_FAULT)
+					return -1;
+				uncached = fimg2d_pt_cache_add(cmd->ctx, c->addr,
+						c->size, i == IMAGE_DST);
+			}
 		} else if (img->addr.type == ADDR_USER_CONTIG) {
 			modified_addr = GET_MVA(img->addr.start, img->plane2.start);
 			pt = fimg2d_migrate_pagetable(cmd->ctx->pgd_clone,
@@ -242,7 +251,8 @@ static int fimg2d_check_dma_sync(struct fimg2d_bltcmd *cmd)
 			}
 		}
 
-		if (img->need_cacheopr && i != IMAGE_TMP) {
+		/* uncached and write-combined mappings have nothing to clean */
+		if (img->need_cacheopr && i != IMAGE_TMP && !uncached) {
 			c->cached = c->size;
 			cmd->dma_all += c->cached;
 		}
@@ -342,7 +352,7 @@ static int fimg2d_check_dma_sync(struct fimg2d_bltcmd *cmd)
 					modified_addr = c->addr;
 				}
 				fimg2d_clean_outer_pagetable_clone(cmd->ctx->pgd_clone, modified_addr, c->size);
-			} else {
+			} else if (!c->pt_clean) {
 				fimg2d_clean_outer_pagetable(mm, c->addr, c->size);
 			}
 
@@ -387,7 +397,8 @@ static int fimg2d_check_dma_sync(struct fimg2d_bltcmd *cmd)
 }
 
 int fimg2d_add_command(struct fimg2d_control *info, struct fimg2d_context *ctx,
-			struct fimg2d_blit *blit, enum addr_space type)
+			struct fimg2d_blit *blit, enum addr_space type,
+			struct fimg2d_fence *fence)
 {
 	int i, ret;
 	struct fimg2d_image *buf[MAX_IMAGES] = image_table(blit);
@@ -472,6 +483,16 @@ int fimg2d_add_command(struct fimg2d_control *info, struct fimg2d_context *ctx,
 		goto err_user;
 	}
 	atomic_inc(&ctx->ncmd);
+	/* async blit may outlive the caller, pin its pagetable */
+	if (cmd->sync == BLIT_ASYNC)
+		atomic_inc(&ctx->mm->mm_users);
+#ifdef CONFIG_SW_SYNC
+	if (fence) {
+		cmd->acquire_fence = fence->acquire;
+		cmd->release = 1;
+		fence->release = ++info->timeline_max;
+	}
+#endif
 	fimg2d_enqueue(&cmd->node, &info->cmd_q);
 	fimg2d_debug("ctx %p pgd %p ncmd(%d) seq_no(%u)\n",
 			cmd->ctx, (unsigned long *)cmd->ctx->mm->pgd,
@@ -39,4 +39,5 @@ static inline struct fimg2d_bltcmd *fimg2d_get_first_command(struct fimg2d_contr
 void fimg2d_add_context(struct fimg2d_control *info, struct fimg2d_context *ctx);
 void fimg2d_del_context(struct fimg2d_control *info, struct fimg2d_context *ctx);
 int fimg2d_add_command(struct fimg2d_control *info, struct fimg2d_context *ctx,
-			struct fimg2d_blit *blit, enum addr_space type);
+			struct fimg2d_blit *blit, enum addr_space type,
+			struct fimg2d_fence *fence);
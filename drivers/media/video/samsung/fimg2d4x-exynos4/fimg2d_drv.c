@@ -26,6 +26,7 @@
 #include <linux/wait.h>
 #include <linux/atomic.h>
 #include <linux/delay.h>
+#include <linux/file.h>
 #include <asm/cacheflush.h>
 #include <plat/cpu.h>
 #include <plat/fimg2d.h>
@@ -140,7 +141,8 @@ static void fimg2d_context_wait(struct fimg2d_context *ctx)
 	}
 }
 
-static void fimg2d_request_bitblt(struct fimg2d_context *ctx)
+static void fimg2d_request_bitblt(struct fimg2d_context *ctx,
+					enum blit_sync sync)
 {
 	spin_lock(&info->bltlock);
 	if (!atomic_read(&info->active)) {
@@ -149,8 +151,80 @@ static void fimg2d_request_bitblt(struct fimg2d_context *ctx)
 		queue_work(info->work_q, &fimg2d_work);
 	}
 	spin_unlock(&info->bltlock);
+
+	if (sync == BLIT_SYNC)
+		fimg2d_context_wait(ctx);
+}
+
+#ifdef CONFIG_SW_SYNC
+static int fimg2d_request_fence_bitblt(struct fimg2d_context *ctx,
+					struct fimg2d_blit_fence *req)
+{
+	struct fimg2d_image dst;
+	struct fimg2d_fence fence;
+	struct sync_fence *release;
+	struct sync_pt *pt;
+	int fd, ret;
+
+	if (!req->blit.dst)
+		return -EINVAL;
+	if (copy_from_user(&dst, (void *)req->blit.dst, sizeof(dst)))
+		return -EFAULT;
+
+	/* skia user blits hold page_alloc_slow_rwsem, keep them sync */
+	if (dst.addr.type == ADDR_USER && req->blit.seq_no == SEQ_NO_BLT_SKIA)
+		return -EINVAL;
+
+	fence.acquire = NULL;
+	if (req->acquire_fd >= 0) {
+		fence.acquire = sync_fence_fdget(req->acquire_fd);
+		if (!fence.acquire)
+			return -EINVAL;
+	}
+
+	fd = get_unused_fd();
+	if (fd < 0) {
+		ret = fd;
+		goto err_fd;
+	}
+
+	req->blit.sync = BLIT_ASYNC;
+	ret = fimg2d_add_command(info, ctx, &req->blit, dst.addr.type, &fence);
+	if (ret)
+		goto err_cmd;
+
+	/* the command owns the acquire fence from here */
+	fimg2d_request_bitblt(ctx, BLIT_ASYNC);
+
+	/* a point already passed by the timeline is created signaled */
+	pt = sw_sync_pt_create(info->timeline, fence.release);
+	if (!pt)
+		goto err_pt;
+
+	release = sync_fence_create("fimg2d", pt);
+	if (!release) {
+		sync_pt_free(pt);
+		goto err_pt;
+	}
+
+	sync_fence_install(release, fd);
+	req->release_fd = fd;
+	return 0;
+
+err_pt:
+	/* no fence to hand out, finish the blit before returning */
 	fimg2d_context_wait(ctx);
+	put_unused_fd(fd);
+	return -ENOMEM;
+
+err_cmd:
+	put_unused_fd(fd);
+err_fd:
+	if (fence.acquire)
+		sync_fence_put(fence.acquire);
+	return ret;
 }
+#endif
 
 static int fimg2d_open(struct inode *inode, struct file *file)
 {
@@ -170,6 +244,13 @@ static int fimg2d_open(struct inode *inode, struct file *file)
 
 	ctx->pgd_clone = kzalloc(L1_DESCRIPTOR_SIZE, GFP_KERNEL);
 
+	if (fimg2d_pt_cache_init(ctx)) {
+		printk(KERN_ERR "[%s] failed to register mmu notifier\n", __func__);
+		kfree(ctx->pgd_clone);
+		kfree(ctx);
+		return -ENOMEM;
+	}
+
 	fimg2d_add_context(info, ctx);
 	return 0;
 }
@@ -186,6 +267,7 @@ static int fimg2d_release(struct inode *inode, struct file *file)
 		mdelay(2);
 	}
 	fimg2d_del_context(info, ctx);
+	fimg2d_pt_cache_exit(ctx);
 
 	kfree(ctx->pgd_clone);
 	kfree(ctx);
@@ -208,6 +290,9 @@ static long fimg2d_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	struct fimg2d_context *ctx;
 	struct fimg2d_platdata *pdata;
 	struct fimg2d_blit blit;
+#ifdef CONFIG_SW_SYNC
+	struct fimg2d_blit_fence blit_fence;
+#endif
 	struct fimg2d_version ver;
 	struct fimg2d_image dst;
 
@@ -228,25 +313,20 @@ static long fimg2d_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			if (copy_from_user(&dst, (void *)blit.dst, sizeof(dst)))
 				return -EFAULT;
 
-#ifdef CONFIG_BUSFREQ_OPP
-#if defined(CONFIG_CPU_EXYNOS4212) || defined(CONFIG_CPU_EXYNOS4412)
-#if defined(CONFIG_BUSFREQ_ELEVATION)
-			dev_lock(info->bus_dev, info->dev, 267160);
-#else
-			dev_lock(info->bus_dev, info->dev, 160160);
-#endif
-#endif
-#endif
 		if ((blit.dst) && (dst.addr.type == ADDR_USER)
-				&& (blit.seq_no == SEQ_NO_BLT_SKIA))
+				&& (blit.seq_no == SEQ_NO_BLT_SKIA)) {
+			/* page_alloc_slow_rwsem is held only until blit done */
+			blit.sync = BLIT_SYNC;
 			if (!down_write_trylock(&page_alloc_slow_rwsem))
 				ret = -EAGAIN;
+		}
 
 		if (ret != -EAGAIN)
-			ret = fimg2d_add_command(info, ctx, &blit, dst.addr.type);
+			ret = fimg2d_add_command(info, ctx, &blit,
+						dst.addr.type, NULL);
 
 		if (!ret) {
-			fimg2d_request_bitblt(ctx);
+			fimg2d_request_bitblt(ctx, blit.sync);
 		}
 
 #ifdef PERF_PROFILE
@@ -258,13 +338,7 @@ static long fimg2d_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 				&& ret != -EAGAIN)
 			up_write(&page_alloc_slow_rwsem);
 
-#ifdef CONFIG_BUSFREQ_OPP
-#if defined(CONFIG_CPU_EXYNOS4212) || defined(CONFIG_CPU_EXYNOS4412)
-			dev_unlock(info->bus_dev, info->dev);
-#endif
-#endif
-
-		if (info->fault_addr) {
+		if (blit.sync == BLIT_SYNC && info->fault_addr) {
 			printk(KERN_INFO "Return by G2D fault handler");
 			info->fault_addr = 0;
 			ret = -EFAULT;
@@ -272,9 +346,26 @@ static long fimg2d_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 
 		break;
 
+#ifdef CONFIG_SW_SYNC
+	case FIMG2D_BITBLT_BLIT_FENCE:
+		if (info->secure)
+			return -EFAULT;
+
+		if (copy_from_user(&blit_fence, (void *)arg, sizeof(blit_fence)))
+			return -EFAULT;
+
+		ret = fimg2d_request_fence_bitblt(ctx, &blit_fence);
+		if (ret)
+			break;
+
+		if (copy_to_user((void *)arg, &blit_fence, sizeof(blit_fence)))
+			ret = -EFAULT;
+		break;
+#endif
+
 	case FIMG2D_BITBLT_SYNC:
 		fimg2d_debug("FIMG2D_BITBLT_SYNC ctx: %p\n", ctx);
-		/* FIXME: */
+		fimg2d_context_wait(ctx);
 		break;
 
 	case FIMG2D_BITBLT_VERSION:
@@ -362,6 +453,15 @@ static int fimg2d_setup_controller(struct fimg2d_control *info)
 	if (!info->work_q)
 		return -ENOMEM;
 
+#ifdef CONFIG_SW_SYNC
+	info->timeline = sw_sync_timeline_create("fimg2d");
+	if (!info->timeline) {
+		destroy_workqueue(info->work_q);
+		return -ENOMEM;
+	}
+	info->timeline_max = 0;
+#endif
+
 	return 0;
 }
 
@@ -485,6 +585,9 @@ err_region:
 	release_resource(res);
 
 err_res:
+#ifdef CONFIG_SW_SYNC
+	sync_timeline_destroy(&info->timeline->obj);
+#endif
 	destroy_workqueue(info->work_q);
 
 err_setup:
@@ -505,6 +608,9 @@ static int fimg2d_remove(struct platform_device *pdev)
 	}
 
 	destroy_workqueue(info->work_q);
+#ifdef CONFIG_SW_SYNC
+	sync_timeline_destroy(&info->timeline->obj);
+#endif
 	misc_deregister(&fimg2d_dev);
 	kfree(info);
 
@@ -19,6 +19,7 @@
 #include <linux/interrupt.h>
 #include <linux/spinlock.h>
 #include <linux/sched.h>
+#include <linux/ktime.h>
 
 #include <linux/videodev2.h>
 #include <linux/videodev2_exynos_media.h>
@@ -180,6 +181,7 @@ struct jpeg_ctx {
 	} param;
 
 	int			index;
+	enum jpeg_mode		mode;
 	unsigned long		payload[VIDEO_MAX_PLANES];
 	bool			input_cacheable;
 	bool			output_cacheable;
@@ -204,8 +206,7 @@ struct jpeg_dev {
 	struct v4l2_device	v4l2_dev;
 	struct video_device	*vfd_enc;
 	struct video_device	*vfd_dec;
-	struct v4l2_m2m_dev	*m2m_dev_enc;
-	struct v4l2_m2m_dev	*m2m_dev_dec;
+	struct v4l2_m2m_dev	*m2m_dev;
 	struct jpeg_ctx		*ctx;
 	struct vb2_alloc_ctx	*alloc_ctx;
 
@@ -220,6 +221,7 @@ struct jpeg_dev {
 	wait_queue_head_t	 wq;
 	void __iomem		*reg_base;	/* register i/o */
 	enum jpeg_mode		mode;
+	ktime_t			job_start;
 	const struct jpeg_vb2	*vb2;
 
 	unsigned long		hw_run;
@@ -83,10 +83,7 @@ static void jpeg_watchdog_worker(struct work_struct *work)
 	dev = container_of(work, struct jpeg_dev, watchdog_work);
 
 	clear_bit(0, &dev->hw_run);
-	if (dev->mode == ENCODING)
-		ctx = v4l2_m2m_get_curr_priv(dev->m2m_dev_enc);
-	else
-		ctx = v4l2_m2m_get_curr_priv(dev->m2m_dev_dec);
+	ctx = v4l2_m2m_get_curr_priv(dev->m2m_dev);
 
 	if (ctx) {
 		spin_lock_irqsave(&ctx->slock, flags);
@@ -95,16 +92,30 @@ static void jpeg_watchdog_worker(struct work_struct *work)
 
 		v4l2_m2m_buf_done(src_vb, VB2_BUF_STATE_ERROR);
 		v4l2_m2m_buf_done(dst_vb, VB2_BUF_STATE_ERROR);
-		if (dev->mode == ENCODING)
-			v4l2_m2m_job_finish(dev->m2m_dev_enc, ctx->m2m_ctx);
-		else
-			v4l2_m2m_job_finish(dev->m2m_dev_dec, ctx->m2m_ctx);
 		spin_unlock_irqrestore(&ctx->slock, flags);
+		v4l2_m2m_job_finish(dev->m2m_dev, ctx->m2m_ctx);
 	} else {
 		printk(KERN_ERR "watchdog_ctx is NULL\n");
 	}
 }
 #endif
+
+/* imported buffers are kept coherent by the exporter, not by us */
+static inline bool jpeg_vb_is_dmabuf(struct vb2_buffer *vb)
+{
+	return vb->v4l2_buf.memory == V4L2_MEMORY_DMABUF;
+}
+
+static inline unsigned int jpeg_io_modes(struct jpeg_ctx *ctx)
+{
+	unsigned int io_modes = VB2_MMAP | VB2_USERPTR;
+
+	if (ctx->dev->vb2->ops->attach_dmabuf)
+		io_modes |= VB2_DMABUF;
+
+	return io_modes;
+}
+
 static int jpeg_dec_queue_setup(struct vb2_queue *vq, unsigned int *num_buffers,
 			    unsigned int *num_planes, unsigned long sizes[],
 			    void *allocators[])
@@ -141,11 +152,11 @@ static int jpeg_dec_buf_prepare(struct vb2_buffer *vb)
 
 	if (vb->vb2_queue->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE) {
 		num_plane = ctx->param.dec_param.in_plane;
-		if (ctx->input_cacheable == 1)
+		if (ctx->input_cacheable == 1 && !jpeg_vb_is_dmabuf(vb))
 			ctx->dev->vb2->cache_flush(vb, num_plane);
 	} else if (vb->vb2_queue->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
 		num_plane = ctx->param.dec_param.out_plane;
-		if (ctx->output_cacheable == 1)
+		if (ctx->output_cacheable == 1 && !jpeg_vb_is_dmabuf(vb))
 			ctx->dev->vb2->cache_flush(vb, num_plane);
 	}
 
@@ -180,7 +191,7 @@ static int jpeg_dec_stop_streaming(struct vb2_queue *q)
 	struct jpeg_ctx *ctx = q->drv_priv;
 	struct jpeg_dev *dev = ctx->dev;
 
-	v4l2_m2m_get_next_job(dev->m2m_dev_dec, ctx->m2m_ctx);
+	v4l2_m2m_get_next_job(dev->m2m_dev, ctx->m2m_ctx);
 
 	return 0;
 }
@@ -223,11 +234,11 @@ static int jpeg_enc_buf_prepare(struct vb2_buffer *vb)
 
 	if (vb->vb2_queue->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE) {
 		num_plane = ctx->param.enc_param.in_plane;
-		if (ctx->input_cacheable == 1)
+		if (ctx->input_cacheable == 1 && !jpeg_vb_is_dmabuf(vb))
 			ctx->dev->vb2->cache_flush(vb, num_plane);
 	} else if (vb->vb2_queue->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
 		num_plane = ctx->param.enc_param.out_plane;
-		if (ctx->output_cacheable == 1)
+		if (ctx->output_cacheable == 1 && !jpeg_vb_is_dmabuf(vb))
 			ctx->dev->vb2->cache_flush(vb, num_plane);
 	}
 
@@ -262,7 +273,7 @@ static int jpeg_enc_stop_streaming(struct vb2_queue *q)
 	struct jpeg_ctx *ctx = q->drv_priv;
 	struct jpeg_dev *dev = ctx->dev;
 
-	v4l2_m2m_get_next_job(dev->m2m_dev_enc, ctx->m2m_ctx);
+	v4l2_m2m_get_next_job(dev->m2m_dev, ctx->m2m_ctx);
 
 	return 0;
 }
@@ -312,7 +323,7 @@ static int queue_init_dec(void *priv, struct vb2_queue *src_vq,
 
 	memset(src_vq, 0, sizeof(*src_vq));
 	src_vq->type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
-	src_vq->io_modes = VB2_MMAP | VB2_USERPTR;
+	src_vq->io_modes = jpeg_io_modes(ctx);
 	src_vq->drv_priv = ctx;
 	src_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
 	src_vq->ops = &jpeg_dec_vb2_qops;
@@ -324,7 +335,7 @@ static int queue_init_dec(void *priv, struct vb2_queue *src_vq,
 
 	memset(dst_vq, 0, sizeof(*dst_vq));
 	dst_vq->type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
-	dst_vq->io_modes = VB2_MMAP | VB2_USERPTR;
+	dst_vq->io_modes = jpeg_io_modes(ctx);
 	dst_vq->drv_priv = ctx;
 	dst_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
 	dst_vq->ops = &jpeg_dec_vb2_qops;
@@ -341,7 +352,7 @@ static int queue_init_enc(void *priv, struct vb2_queue *src_vq,
 
 	memset(src_vq, 0, sizeof(*src_vq));
 	src_vq->type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
-	src_vq->io_modes = VB2_MMAP | VB2_USERPTR;
+	src_vq->io_modes = jpeg_io_modes(ctx);
 	src_vq->drv_priv = ctx;
 	src_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
 	src_vq->ops = &jpeg_enc_vb2_qops;
@@ -353,7 +364,7 @@ static int queue_init_enc(void *priv, struct vb2_queue *src_vq,
 
 	memset(dst_vq, 0, sizeof(*dst_vq));
 	dst_vq->type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
-	dst_vq->io_modes = VB2_MMAP | VB2_USERPTR;
+	dst_vq->io_modes = jpeg_io_modes(ctx);
 	dst_vq->drv_priv = ctx;
 	dst_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
 	dst_vq->ops = &jpeg_enc_vb2_qops;
@@ -382,15 +393,19 @@ static int jpeg_m2m_open(struct file *file)
 
 	file->private_data = ctx;
 	ctx->dev = dev;
+	spin_lock_init(&ctx->slock);
 
-	if (node == JPEG_NODE_DECODER)
+	if (node == JPEG_NODE_DECODER) {
+		ctx->mode = DECODING;
 		ctx->m2m_ctx =
-			v4l2_m2m_ctx_init(dev->m2m_dev_dec, ctx,
+			v4l2_m2m_ctx_init(dev->m2m_dev, ctx,
 				queue_init_dec);
-	else
+	} else {
+		ctx->mode = ENCODING;
 		ctx->m2m_ctx =
-			v4l2_m2m_ctx_init(dev->m2m_dev_enc, ctx,
+			v4l2_m2m_ctx_init(dev->m2m_dev, ctx,
 				queue_init_enc);
+	}
 
 	if (IS_ERR(ctx->m2m_ctx)) {
 		int err = PTR_ERR(ctx->m2m_ctx);
@@ -428,9 +443,11 @@ static int jpeg_m2m_release(struct file *file)
 	if (test_bit(0, &ctx->dev->hw_run) == 0)
 		del_timer_sync(&ctx->dev->watchdog_timer);
 #endif
-	v4l2_m2m_ctx_release(ctx->m2m_ctx);
 	spin_unlock_irqrestore(&ctx->dev->slock, flags);
 
+	/* waits for a job of this context that is still on the hardware */
+	v4l2_m2m_ctx_release(ctx->m2m_ctx);
+
 #ifdef CONFIG_PM_RUNTIME
 #if defined (CONFIG_CPU_EXYNOS5250)
 	ctx->dev->vb2->suspend(ctx->dev->alloc_ctx);
@@ -531,6 +548,7 @@ static void jpeg_device_enc_run(void *priv)
 #ifdef CONFIG_JPEG_V2_2
 		jpeg_set_timer_count(dev->reg_base, enc_param.in_width * enc_param.in_height * 32 + 0xff);
 #endif
+	dev->job_start = ktime_get();
 	jpeg_set_enc_dec_mode(dev->reg_base, ENCODING);
 
 	spin_unlock_irqrestore(&ctx->dev->slock, flags);
@@ -598,33 +616,37 @@ static void jpeg_device_dec_run(void *priv)
 #ifdef CONFIG_JPEG_V2_2
 	jpeg_set_timer_count(dev->reg_base, dec_param.in_width * dec_param.in_height * 8 + 0xff);
 #endif
+	dev->job_start = ktime_get();
 	jpeg_set_enc_dec_mode(dev->reg_base, DECODING);
 
 	spin_unlock_irqrestore(&ctx->dev->slock, flags);
 }
 
-static void jpeg_job_enc_abort(void *priv)
+/*
+ * Encoder and decoder contexts share one job queue, there is only one
+ * codec in the hardware and the two nodes would otherwise program it
+ * under each other.
+ */
+static void jpeg_device_run(void *priv)
 {
 	struct jpeg_ctx *ctx = priv;
-	struct jpeg_dev *dev = ctx->dev;
-	v4l2_m2m_get_next_job(dev->m2m_dev_enc, ctx->m2m_ctx);
+
+	if (ctx->mode == ENCODING)
+		jpeg_device_enc_run(priv);
+	else
+		jpeg_device_dec_run(priv);
 }
 
-static void jpeg_job_dec_abort(void *priv)
+static void jpeg_job_abort(void *priv)
 {
 	struct jpeg_ctx *ctx = priv;
 	struct jpeg_dev *dev = ctx->dev;
-	v4l2_m2m_get_next_job(dev->m2m_dev_dec, ctx->m2m_ctx);
+	v4l2_m2m_get_next_job(dev->m2m_dev, ctx->m2m_ctx);
 }
 
-static struct v4l2_m2m_ops jpeg_m2m_enc_ops = {
-	.device_run	= jpeg_device_enc_run,
-	.job_abort	= jpeg_job_enc_abort,
-};
-
-static struct v4l2_m2m_ops jpeg_m2m_dec_ops = {
-	.device_run	= jpeg_device_dec_run,
-	.job_abort	= jpeg_job_dec_abort,
+static struct v4l2_m2m_ops jpeg_m2m_ops = {
+	.device_run	= jpeg_device_run,
+	.job_abort	= jpeg_job_abort,
 };
 
 int jpeg_int_pending(struct jpeg_dev *ctrl)
@@ -643,6 +665,7 @@ static irqreturn_t jpeg_irq(int irq, void *priv)
 	struct vb2_buffer *src_vb, *dst_vb;
 	struct jpeg_dev *ctrl = priv;
 	struct jpeg_ctx *ctx;
+	u32 hw_time;
 
 	spin_lock(&ctrl->slock);
 
@@ -650,10 +673,7 @@ static irqreturn_t jpeg_irq(int irq, void *priv)
 	jpeg_clean_interrupt(ctrl->reg_base);
 #endif
 
-	if (ctrl->mode == ENCODING)
-		ctx = v4l2_m2m_get_curr_priv(ctrl->m2m_dev_enc);
-	else
-		ctx = v4l2_m2m_get_curr_priv(ctrl->m2m_dev_dec);
+	ctx = v4l2_m2m_get_curr_priv(ctrl->m2m_dev);
 
 	if (ctx == 0) {
 		printk(KERN_ERR "ctx is null.\n");
@@ -695,6 +715,15 @@ static irqreturn_t jpeg_irq(int irq, void *priv)
 		ctrl->irq_ret = ERR_UNKNOWN;
 	}
 
+	/*
+	 * The hardware time of the job goes back with the capture buffer
+	 * in its reserved field, so a caller with several jobs in flight
+	 * knows which one took how long.
+	 */
+	hw_time = ktime_to_us(ktime_sub(ktime_get(), ctrl->job_start));
+	dst_vb->v4l2_buf.reserved = hw_time;
+	dst_vb->v4l2_buf.timestamp = src_vb->v4l2_buf.timestamp;
+
 	if (ctrl->irq_ret == OK_ENC_OR_DEC) {
 		v4l2_m2m_buf_done(src_vb, VB2_BUF_STATE_DONE);
 		v4l2_m2m_buf_done(dst_vb, VB2_BUF_STATE_DONE);
@@ -706,10 +735,12 @@ static irqreturn_t jpeg_irq(int irq, void *priv)
 #ifdef CONFIG_JPEG_V2_1
 		clear_bit(0, &ctx->dev->hw_run);
 #endif
-	if (ctrl->mode == ENCODING)
-		v4l2_m2m_job_finish(ctrl->m2m_dev_enc, ctx->m2m_ctx);
-	else
-		v4l2_m2m_job_finish(ctrl->m2m_dev_dec, ctx->m2m_ctx);
+	spin_unlock(&ctrl->slock);
+
+	/* starts the next queued job, which takes the lock itself */
+	v4l2_m2m_job_finish(ctrl->m2m_dev, ctx->m2m_ctx);
+	return IRQ_HANDLED;
+
 ctx_err:
 	spin_unlock(&ctrl->slock);
 	return IRQ_HANDLED;
@@ -813,6 +844,14 @@ static int jpeg_probe(struct platform_device *pdev)
 		goto err_v4l2;
 	}
 
+	dev->m2m_dev = v4l2_m2m_init(&jpeg_m2m_ops);
+	if (IS_ERR(dev->m2m_dev)) {
+		v4l2_err(&dev->v4l2_dev,
+			"failed to initialize v4l2-m2m device\n");
+		ret = PTR_ERR(dev->m2m_dev);
+		goto err_m2m_init;
+	}
+
 	/* encoder */
 	vfd = video_device_alloc();
 	if (!vfd) {
@@ -834,13 +873,6 @@ static int jpeg_probe(struct platform_device *pdev)
 		"JPEG driver is registered to /dev/video%d\n", vfd->num);
 
 	dev->vfd_enc = vfd;
-	dev->m2m_dev_enc = v4l2_m2m_init(&jpeg_m2m_enc_ops);
-	if (IS_ERR(dev->m2m_dev_enc)) {
-		v4l2_err(&dev->v4l2_dev,
-			"failed to initialize v4l2-m2m device\n");
-		ret = PTR_ERR(dev->m2m_dev_enc);
-		goto err_m2m_init_enc;
-	}
 	video_set_drvdata(vfd, dev);
 
 	/* decoder */
@@ -864,13 +896,6 @@ static int jpeg_probe(struct platform_device *pdev)
 		"JPEG driver is registered to /dev/video%d\n", vfd->num);
 
 	dev->vfd_dec = vfd;
-	dev->m2m_dev_dec = v4l2_m2m_init(&jpeg_m2m_dec_ops);
-	if (IS_ERR(dev->m2m_dev_dec)) {
-		v4l2_err(&dev->v4l2_dev,
-			"failed to initialize v4l2-m2m device\n");
-		ret = PTR_ERR(dev->m2m_dev_dec);
-		goto err_m2m_init_dec;
-	}
 	video_set_drvdata(vfd, dev);
 
 	platform_set_drvdata(pdev, dev);
@@ -910,16 +935,14 @@ static int jpeg_probe(struct platform_device *pdev)
 	return 0;
 
 err_video_reg:
-	v4l2_m2m_release(dev->m2m_dev_dec);
-err_m2m_init_dec:
 	video_unregister_device(dev->vfd_dec);
 	video_device_release(dev->vfd_dec);
 err_vd_alloc_dec:
-	v4l2_m2m_release(dev->m2m_dev_enc);
-err_m2m_init_enc:
 	video_unregister_device(dev->vfd_enc);
 	video_device_release(dev->vfd_enc);
 err_vd_alloc_enc:
+	v4l2_m2m_release(dev->m2m_dev);
+err_m2m_init:
 	v4l2_device_unregister(&dev->v4l2_dev);
 err_v4l2:
 	clk_disable(dev->clk);
@@ -948,11 +971,9 @@ static int jpeg_remove(struct platform_device *pdev)
 		flush_workqueue(dev->watchdog_workqueue);
 		destroy_workqueue(dev->watchdog_workqueue);
 #endif
-	v4l2_m2m_release(dev->m2m_dev_enc);
 	video_unregister_device(dev->vfd_enc);
-
-	v4l2_m2m_release(dev->m2m_dev_dec);
 	video_unregister_device(dev->vfd_dec);
+	v4l2_m2m_release(dev->m2m_dev);
 
 	v4l2_device_unregister(&dev->v4l2_dev);
 
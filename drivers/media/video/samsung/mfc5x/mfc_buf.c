@@ -15,6 +15,7 @@
 #include <linux/spinlock.h>
 #include <linux/mm.h>
 #include <linux/err.h>
+#include <linux/bitmap.h>
 
 #ifdef CONFIG_SLP
 #include <linux/cma.h>
@@ -203,8 +204,22 @@ static struct dma_buf_ops mfc_dmabuf_ops = {
 #undef DEBUG_ALLOC_FREE
 
 static struct list_head mfc_alloc_head[MFC_MAX_MEM_PORT_NUM];
-/* The free node list sorted by real address */
-static struct list_head mfc_free_head[MFC_MAX_MEM_PORT_NUM];
+
+/*
+ * Each port is managed by page bitmaps, one per contiguous region added
+ * with mfc_add_buf_pool(). A set bit is an allocated page. Released pages
+ * merge with their free neighbours by construction, so the region does not
+ * stay fragmented after instances are closed in any order.
+ */
+#define MFC_BUF_POOL_NUM	2
+
+struct mfc_buf_pool {
+	unsigned long base;	/* phys. or virt. addr of the first page */
+	unsigned int nr;	/* number of pages */
+	unsigned long *map;
+};
+
+static struct mfc_buf_pool mfc_buf_pool[MFC_MAX_MEM_PORT_NUM][MFC_BUF_POOL_NUM];
 
 #ifdef CONFIG_EXYNOS_CONTENT_PATH_PROTECTION
 static enum MFC_BUF_ALLOC_SCHEME buf_alloc_scheme = MBS_FIRST_FIT;
@@ -218,13 +233,181 @@ static spinlock_t lock;
 */
 
 
+static int mfc_add_buf_pool(unsigned long base, unsigned int size, int port)
+{
+	struct mfc_buf_pool *pool;
+	unsigned long start = PAGE_ALIGN(base);
+	int p;
+
+	if ((port >= MFC_MAX_MEM_PORT_NUM) || (base + size < start + PAGE_SIZE))
+		return -EINVAL;
+
+	for (p = 0; p < MFC_BUF_POOL_NUM; p++) {
+		pool = &mfc_buf_pool[port][p];
+		if (!pool->map)
+			break;
+	}
+
+	if (p == MFC_BUF_POOL_NUM)
+		return -ENOSPC;
+
+	pool->nr = (base + size - start) >> PAGE_SHIFT;
+	pool->map = kzalloc(BITS_TO_LONGS(pool->nr) * sizeof(unsigned long),
+			GFP_KERNEL);
+	if (unlikely(pool->map == NULL))
+		return -ENOMEM;
+
+	pool->base = start;
+
+	mfc_dbg("pool: 0x%08lx, pages: %d, port: %d\n",
+		pool->base, pool->nr, port);
+
+	return 0;
+}
+
+static void mfc_del_buf_pool(int port)
+{
+	struct mfc_buf_pool *pool;
+	int p;
+
+	for (p = 0; p < MFC_BUF_POOL_NUM; p++) {
+		pool = &mfc_buf_pool[port][p];
+		kfree(pool->map);
+		pool->map = NULL;
+		pool->nr = 0;
+	}
+}
+
+/* total free size and largest free area of a port, to tell fragmentation */
+static void mfc_buf_frag_stats(int port, unsigned int *total,
+	unsigned int *largest)
+{
+	struct mfc_buf_pool *pool;
+	unsigned long start, end;
+	int p;
+
+	*total = 0;
+	*largest = 0;
+
+	for (p = 0; p < MFC_BUF_POOL_NUM; p++) {
+		pool = &mfc_buf_pool[port][p];
+		if (!pool->map)
+			continue;
+
+		start = find_first_zero_bit(pool->map, pool->nr);
+		while (start < pool->nr) {
+			end = find_next_bit(pool->map, pool->nr, start);
+			*total += (end - start) << PAGE_SHIFT;
+			if (((end - start) << PAGE_SHIFT) > *largest)
+				*largest = (end - start) << PAGE_SHIFT;
+			start = find_next_zero_bit(pool->map, pool->nr, end);
+		}
+	}
+}
+
+static int mfc_put_free_buf(unsigned long addr, unsigned int size, int port)
+{
+	struct mfc_buf_pool *pool;
+	unsigned long first;
+	unsigned int nr;
+	int p;
+
+	if ((!size) || (port >= MFC_MAX_MEM_PORT_NUM))
+		return -EINVAL;
+
+	mfc_dbg("addr: 0x%08lx, size: %d, port: %d\n", addr, size, port);
+
+	for (p = 0; p < MFC_BUF_POOL_NUM; p++) {
+		pool = &mfc_buf_pool[port][p];
+		if (!pool->map || addr < pool->base)
+			continue;
+
+		first = (addr - pool->base) >> PAGE_SHIFT;
+		nr = PAGE_ALIGN(size) >> PAGE_SHIFT;
+		if (first + nr > pool->nr)
+			continue;
+
+		bitmap_clear(pool->map, first, nr);
+
+		return 0;
+	}
+
+	mfc_err("not a mfc buffer: 0x%08lx, size: %d, port: %d\n",
+		addr, size, port);
+
+	return -EINVAL;
+}
+
+/*
+ * Allocations are rounded up to pages and the returned address is aligned
+ * to @align, so the caller never has padding to give back. Free areas are
+ * walked in address order; best fit picks the smallest area that holds the
+ * request, first fit the lowest one.
+ */
+static unsigned long mfc_get_free_buf(unsigned int size, int align, int port)
+{
+	struct mfc_buf_pool *pool;
+	struct mfc_buf_pool *match = NULL;
+	unsigned long start, end, first;
+	unsigned long match_first = 0, match_len = 0;
+	unsigned int nr, total, largest;
+	int p;
+
+	mfc_dbg("size: %d, align: %d, port: %d\n",
+			size, align, port);
+
+	nr = PAGE_ALIGN(size) >> PAGE_SHIFT;
+
+	for (p = 0; p < MFC_BUF_POOL_NUM; p++) {
+		pool = &mfc_buf_pool[port][p];
+		if (!pool->map)
+			continue;
+
+		start = find_first_zero_bit(pool->map, pool->nr);
+		while (start < pool->nr) {
+			end = find_next_bit(pool->map, pool->nr, start);
+
+			first = (ALIGN(pool->base + (start << PAGE_SHIFT), align)
+					- pool->base) >> PAGE_SHIFT;
+
+			if ((first + nr <= end) &&
+				(!match || (end - start) < match_len)) {
+				match = pool;
+				match_first = first;
+				match_len = end - start;
+
+				if (buf_alloc_scheme == MBS_FIRST_FIT)
+					goto found;
+			}
+
+			start = find_next_zero_bit(pool->map, pool->nr, end);
+		}
+	}
+
+	if (match == NULL) {
+		mfc_buf_frag_stats(port, &total, &largest);
+		mfc_err("no suitable free area in mfc buffer, "
+			"size: %dKB, free: %dKB, largest: %dKB\n",
+			size >> 10, total >> 10, largest >> 10);
+
+		return 0;
+	}
+
+found:
+	bitmap_set(match->map, match_first, nr);
+
+	return match->base + (match_first << PAGE_SHIFT);
+}
+
 void mfc_print_buf(void)
 {
 #ifdef PRINT_BUF
 	struct list_head *pos;
 	struct mfc_alloc_buffer *alloc = NULL;
-	struct mfc_free_buffer *free = NULL;
-	int port, i;
+	struct mfc_buf_pool *pool;
+	unsigned long start, end;
+	unsigned int total, largest;
+	int port, i, p;
 
 	for (port = 0; port < mfc_mem_count(); port++) {
 		mfc_dbg("---- port %d buffer list ----", port);
@@ -272,177 +455,28 @@ void mfc_print_buf(void)
 		}
 
 		i = 0;
-		list_for_each(pos, &mfc_free_head[port]) {
-			free = list_entry(pos, struct mfc_free_buffer, list);
-			mfc_dbg("[F #%04d] addr: 0x%08lx, size: %d",
-				i, free->real, free->size);
-			i++;
-		}
-	}
-#endif
-}
-
-static int mfc_put_free_buf(unsigned long addr, unsigned int size, int port)
-{
-	struct list_head *pos, *nxt;
-	struct mfc_free_buffer *free;
-	struct mfc_free_buffer *next = NULL;
-	struct mfc_free_buffer *prev;
-	/* 0x00: not merged, 0x01: prev merged, 0x02: next merged */
-	int merged = 0x00;
-
-	if ((!size) || (port >= MFC_MAX_MEM_PORT_NUM))
-		return -EINVAL;
-
-	mfc_dbg("addr: 0x%08lx, size: %d, port: %d\n", addr, size, port);
-
-	list_for_each_safe(pos, nxt, &mfc_free_head[port]) {
-		next = list_entry(pos, struct mfc_free_buffer, list);
-
-		/*
-		 * When the allocated address must be align without VMEM,
-		 * the free buffer can be overlap
-		 * previous free buffer temporaily
-		 * Target buffer will be shrink after this operation
-		 */
-		if (addr <= next->real) {
-			prev = list_entry(pos->prev, struct mfc_free_buffer, list);
-
-			mfc_dbg("prev->addr: 0x%08lx, size: %d", prev->real, prev->size);
-			/* merge previous free buffer */
-			if (prev && ((prev->real + prev->size) == addr)) {
-				addr  = prev->real;
-				size += prev->size;
-
-				prev->size = size;
-
-				merged |= 0x01;
-				mfc_dbg("auto merge free buffer[p]: addr: 0x%08lx, size: %d",
-					prev->real, prev->size);
+		for (p = 0; p < MFC_BUF_POOL_NUM; p++) {
+			pool = &mfc_buf_pool[port][p];
+			if (!pool->map)
+				continue;
+
+			start = find_first_zero_bit(pool->map, pool->nr);
+			while (start < pool->nr) {
+				end = find_next_bit(pool->map, pool->nr, start);
+				mfc_dbg("[F #%04d] addr: 0x%08lx, size: %ld",
+					i, pool->base + (start << PAGE_SHIFT),
+					(end - start) << PAGE_SHIFT);
+				i++;
+				start = find_next_zero_bit(pool->map,
+						pool->nr, end);
 			}
-
-			mfc_dbg("next->addr: 0x%08lx, size: %d", next->real, next->size);
-			/* merge next free buffer */
-			if ((addr + size) == next->real) {
-				next->real  = addr;
-				next->size += size;
-
-				if (merged)
-					prev->size = next->size;
-
-				merged |= 0x02;
-				mfc_dbg("auto merge free buffer[n]: addr: 0x%08lx, size: %d",
-					next->real, next->size);
-			}
-
-			break;
 		}
-	}
-
-	if (!merged) {
-		free = (struct mfc_free_buffer *)
-			kzalloc(sizeof(struct mfc_free_buffer), GFP_KERNEL);
-
-		if (unlikely(free == NULL))
-			return -ENOMEM;
-
-		free->real = addr;
-		free->size = size;
-
-		list_add_tail(&free->list, pos);
-	}
 
-	/* bi-directional merged */
-	else if ((merged & 0x03) == 0x03) {
-		list_del(&next->list);
-		kfree(next);
+		mfc_buf_frag_stats(port, &total, &largest);
+		mfc_dbg("---- port %d free: %dKB in %d areas, largest: %dKB",
+			port, total >> 10, i, largest >> 10);
 	}
-
-	return 0;
-}
-
-static unsigned long mfc_get_free_buf(unsigned int size, int align, int port)
-{
-	struct list_head *pos, *nxt;
-	struct mfc_free_buffer *free;
-	struct mfc_free_buffer *match = NULL;
-	int align_size = 0;
-	unsigned long addr = 0;
-
-	mfc_dbg("size: %d, align: %d, port: %d\n",
-			size, align, port);
-
-	if (list_empty(&mfc_free_head[port])) {
-		mfc_err("no free node in mfc buffer\n");
-
-		return 0;
-	}
-
-	/* find best fit area */
-	list_for_each_safe(pos, nxt, &mfc_free_head[port]) {
-		free = list_entry(pos, struct mfc_free_buffer, list);
-
-#if (defined(CONFIG_VIDEO_MFC_VCM_UMP) || defined(CONFIG_S5P_VMEM))
-		/*
-		 * Align the start address.
-		 * We assume the start address of free buffer aligned with 4KB
-		 */
-		align_size = ALIGN(align_size + size, PAGE_SIZE) - size;
-
-		if (align > PAGE_SIZE) {
-			align_size  = ALIGN(free->real, align) - free->real;
-			align_size += ALIGN(align_size + size, PAGE_SIZE) - size;
-		} else {
-			align_size = ALIGN(align_size + size, PAGE_SIZE) - size;
-		}
-#else
-		align_size = ALIGN(free->real, align) - free->real;
 #endif
-		if (free->size >= (size + align_size)) {
-			if (buf_alloc_scheme == MBS_BEST_FIT) {
-				if (match != NULL) {
-					if (free->size < match->size)
-						match = free;
-				} else {
-					match = free;
-				}
-			} else if (buf_alloc_scheme == MBS_FIRST_FIT) {
-				match = free;
-				break;
-			}
-		}
-	}
-
-	if (match != NULL) {
-		addr = match->real;
-		align_size = ALIGN(addr, align) - addr;
-
-#if !(defined(CONFIG_VIDEO_MFC_VCM_UMP) || defined(CONFIG_S5P_VMEM))
-		if (align_size > 0) {
-			/*
-			 * When the allocated address must be align without VMEM,
-			 * the free buffer can be overlap
-			 * previous free buffer temporaily
-			 */
-			if (mfc_put_free_buf(match->real, align_size, port) < 0)
-				return 0;
-		}
-#endif
-		/* change allocated buffer address & size */
-		match->real += (size + align_size);
-		match->size -= (size + align_size);
-
-		if (match->size == 0) {
-			list_del(&match->list);
-			kfree(match);
-		}
-	} else {
-		mfc_err("no suitable free node in mfc buffer\n");
-
-		return 0;
-	}
-
-	return addr;
 }
 
 int mfc_init_buf(void)
@@ -454,27 +488,25 @@ int mfc_init_buf(void)
 
 #ifdef CONFIG_EXYNOS_CONTENT_PATH_PROTECTION
 	INIT_LIST_HEAD(&mfc_alloc_head[0]);
-	INIT_LIST_HEAD(&mfc_free_head[0]);
 
-	if (mfc_put_free_buf(mfc_mem_data_base(0),
+	if (mfc_add_buf_pool(mfc_mem_data_base(0),
 		mfc_mem_data_size(0), 0) < 0)
 		mfc_err("failed to add free buffer: [0x%08lx: %d]\n",
 			mfc_mem_data_base(0), mfc_mem_data_size(0));
 
-	if (mfc_put_free_buf(mfc_mem_data_base(1),
+	if (mfc_add_buf_pool(mfc_mem_data_base(1),
 		mfc_mem_data_size(1), 0) < 0)
 		mfc_dbg("failed to add free buffer: [0x%08lx: %d]\n",
 			mfc_mem_data_base(1), mfc_mem_data_size(1));
 
-	if (list_empty(&mfc_free_head[0]))
+	if (!mfc_buf_pool[0][0].map)
 		ret = -1;
 
 #else
 	for (port = 0; port < mfc_mem_count(); port++) {
 		INIT_LIST_HEAD(&mfc_alloc_head[port]);
-		INIT_LIST_HEAD(&mfc_free_head[port]);
 
-		if (mfc_put_free_buf(mfc_mem_data_base(port),
+		if (mfc_add_buf_pool(mfc_mem_data_base(port),
 			mfc_mem_data_size(port), port) < 0)
 			mfc_err("failed to add free buffer: [0x%08lx: %d]\n",
 				mfc_mem_data_base(port),
@@ -482,7 +514,7 @@ int mfc_init_buf(void)
 	}
 
 	for (port = 0; port < mfc_mem_count(); port++) {
-		if (list_empty(&mfc_free_head[port]))
+		if (!mfc_buf_pool[port][0].map)
 			ret = -1;
 	}
 #endif
@@ -500,7 +532,6 @@ void mfc_final_buf(void)
 {
 	struct list_head *pos, *nxt;
 	struct mfc_alloc_buffer *alloc;
-	struct mfc_free_buffer *free;
 	int port;
 	/*
 	unsigned long flags;
@@ -575,13 +606,8 @@ void mfc_final_buf(void)
 	spin_lock_irqsave(&lock, flags);
 	*/
 
-	for (port = 0; port < mfc_mem_count(); port++) {
-		list_for_each_safe(pos, nxt, &mfc_free_head[port]) {
-			free = list_entry(pos, struct mfc_free_buffer, list);
-			list_del(&free->list);
-			kfree(free);
-		}
-	}
+	for (port = 0; port < mfc_mem_count(); port++)
+		mfc_del_buf_pool(port);
 
 	/*
 	spin_unlock_irqrestore(&lock, flags);
@@ -595,41 +621,6 @@ void mfc_set_buf_alloc_scheme(enum MFC_BUF_ALLOC_SCHEME scheme)
 	buf_alloc_scheme = scheme;
 }
 
-void mfc_merge_buf(void)
-{
-	struct list_head *pos, *nxt;
-	struct mfc_free_buffer *n1;
-	struct mfc_free_buffer *n2;
-	int port;
-
-	for (port = 0; port < mfc_mem_count(); port++) {
-		list_for_each_safe(pos, nxt, &mfc_free_head[port]) {
-			n1 = list_entry(pos, struct mfc_free_buffer, list);
-			n2 = list_entry(nxt, struct mfc_free_buffer, list);
-
-			mfc_dbg("merge pre: n1: 0x%08lx, n2: 0x%08lx",
-				n1->real, n2->real);
-
-			if (!list_is_last(pos, &mfc_free_head[port])) {
-				if ((n1->real + n1->size) == n2->real) {
-					n2->real  = n1->real;
-					n2->size += n1->size;
-					list_del(&n1->list);
-					kfree(n1);
-				}
-			}
-
-			mfc_dbg("merge aft: n1: 0x%08lx, n2: 0x%08lx, last: %d",
-				n1->real, n2->real,
-				list_is_last(pos, &mfc_free_head[port]));
-		}
-	}
-
-#ifdef DEBUG_ALLOC_FREE
-	mfc_print_buf();
-#endif
-}
-
 /* FIXME: port auto select, return values */
 struct mfc_alloc_buffer *_mfc_alloc_buf(
 	struct mfc_inst_ctx *ctx, unsigned int size, int align, int flag)
@@ -174,18 +174,11 @@ struct mfc_alloc_buffer {
 #endif
 };
 
-struct mfc_free_buffer {
-	struct list_head list;
-	unsigned long real;	/* phys. or virt. addr for MFC	*/
-	unsigned int size;
-};
-
 void mfc_print_buf(void);
 
 int mfc_init_buf(void);
 void mfc_final_buf(void);
 void mfc_set_buf_alloc_scheme(enum MFC_BUF_ALLOC_SCHEME scheme);
-void mfc_merge_buf(void);
 struct mfc_alloc_buffer *_mfc_alloc_buf(
 	struct mfc_inst_ctx *ctx, unsigned int size, int align, int flag);
 int mfc_alloc_buf(
@@ -61,6 +61,7 @@
 #include "mfc_enc.h"
 #include "mfc_mem.h"
 #include "mfc_cmd.h"
+#include "mfc_sched.h"
 
 #ifdef SYSMMU_MFC_ON
 #include <plat/sysmmu.h>
@@ -542,6 +543,7 @@ static int mfc_release(struct inode *inode, struct file *file)
 	dev->inst_ctx[mfc_ctx->id] = NULL;
 	atomic_dec(&dev->inst_cnt);
 
+	mfc_sched_release(dev, mfc_ctx);
 	mfc_destroy_inst(mfc_ctx);
 
 	if (atomic_read(&dev->inst_cnt) == 0) {
@@ -612,6 +614,7 @@ static long mfc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	int port;
 
 	struct mfc_dev *dev;
+	ktime_t start;
 	int i;
 
 	mfc_ctx = (struct mfc_inst_ctx *)file->private_data;
@@ -637,6 +640,9 @@ static long mfc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 
 	mfc_dbg("cmd: 0x%08x\n", cmd);
 
+	if ((cmd == IOCTL_MFC_DEC_EXE) || (cmd == IOCTL_MFC_ENC_EXE))
+		mfc_sched_enter(dev, mfc_ctx);
+
 	switch (cmd) {
 
 	case IOCTL_MFC_DEC_INIT:
@@ -774,10 +780,12 @@ static long mfc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			break;
 		}
 
+		start = ktime_get();
 		mfc_clock_on(mfcdev);
 		in_param.ret_code = mfc_exec_decoding(mfc_ctx, &(in_param.args));
 		ret = in_param.ret_code;
 		mfc_clock_off(mfcdev);
+		mfc_sched_account(dev, mfc_ctx, start);
 #if SUPPORT_SLICE_ENCODING
 		dev->frame_sys = 1;
 		dev->frame_working_flag = 0;
@@ -849,10 +857,12 @@ static long mfc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			break;
 		}
 
+		start = ktime_get();
 		mfc_clock_on(mfcdev);
 		in_param.ret_code = mfc_exec_encoding(mfc_ctx, &(in_param.args));
 		ret = in_param.ret_code;
 		mfc_clock_off(mfcdev);
+		mfc_sched_account(dev, mfc_ctx, start);
 #if SUPPORT_SLICE_ENCODING
 		if (mfc_ctx->slice_flag == 0) {
 			dev->frame_sys = 1;
@@ -1028,6 +1038,9 @@ static long mfc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		ret = -EINVAL;
 	}
 
+	if ((cmd == IOCTL_MFC_DEC_EXE) || (cmd == IOCTL_MFC_ENC_EXE))
+		mfc_sched_leave(dev, mfc_ctx);
+
 out_ioctl:
 	ex_ret = copy_to_user((struct mfc_common_args *)arg,
 			&in_param,
@@ -1457,6 +1470,7 @@ static int __devinit mfc_probe(struct platform_device *pdev)
 	sprintf(mfcdev->name, "%s", MFC_DEV_NAME);
 
 	mutex_init(&mfcdev->lock);
+	mfc_sched_init(mfcdev);
 	init_waitqueue_head(&mfcdev->wait_sys);
 	init_waitqueue_head(&mfcdev->wait_codec[0]);
 	init_waitqueue_head(&mfcdev->wait_codec[1]);
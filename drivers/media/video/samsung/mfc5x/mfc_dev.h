@@ -15,6 +15,7 @@
 #define __MFC_DEV_H __FILE__
 
 #include <linux/mutex.h>
+#include <linux/wait.h>
 #include <linux/firmware.h>
 
 #include "mfc_inst.h"
@@ -57,6 +58,22 @@ struct mfc_mem {
 #endif
 };
 
+/*
+ * @fg_pending: foreground frame commands waiting for or holding the lock
+ * @last_id: instance of the last frame command run by the firmware
+ * @switch_time: usec spent in frame commands right after an instance switch
+ * @stay_time: usec spent in frame commands of the same instance
+ */
+struct mfc_sched {
+	wait_queue_head_t	wait;
+	atomic_t		fg_pending;
+	int			last_id;
+	unsigned int		switches;
+	u64			switch_time;
+	unsigned int		stays;
+	u64			stay_time;
+};
+
 struct mfc_fw {
 	const struct firmware	*info;
 	int			requesting;
@@ -91,6 +108,7 @@ struct mfc_dev {
 	struct mfc_inst_ctx	*inst_ctx[MFC_MAX_INSTANCE_NUM];
 
 	struct mutex		lock;
+	struct mfc_sched	sched;
 	wait_queue_head_t	wait_sys;
 	int			irq_sys;
 	/* FIXME: remove or use 2 codec channel */
@@ -154,6 +154,10 @@ struct mfc_inst_ctx {
 #ifdef SYSMMU_MFC_ON
 	unsigned long pgd;
 #endif
+	int sched_bg;			/* last frame issued by a background thread */
+	unsigned int sched_frames;	/* frame commands run */
+	u64 sched_time;			/* usec spent in frame commands */
+	unsigned int sched_deferred;	/* frames held back for foreground */
 #if defined(CONFIG_BUSFREQ)
 	int busfreq_flag;		/* context bus frequency flag */
 #endif
@@ -0,0 +1,120 @@
+/*
+ * linux/drivers/media/video/samsung/mfc5x/mfc_sched.c
+ *
+ * Copyright (c) 2010 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * Instance scheduler for Samsung MFC (Multi Function Codec - FIMV) driver
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/wait.h>
+#include <linux/jiffies.h>
+
+#include "mfc_sched.h"
+#include "mfc_log.h"
+
+/*
+ * All instances share one firmware and a frame command holds dev->lock
+ * until the frame is done, so the frame commands of instances run in
+ * the order their callers reach the lock. Background callers, such as
+ * thumbnail and media scanner threads running at a positive nice value,
+ * are held back here while a frame of a foreground instance is waiting
+ * or running. A background frame waits at most mfc_sched_bg_delay ms,
+ * so it is slowed down but never starved.
+ */
+static unsigned int mfc_sched_bg_delay = 30;
+module_param(mfc_sched_bg_delay, uint, 0644);
+MODULE_PARM_DESC(mfc_sched_bg_delay,
+	"Max. msec a background frame waits for foreground frames");
+
+void mfc_sched_init(struct mfc_dev *dev)
+{
+	init_waitqueue_head(&dev->sched.wait);
+	atomic_set(&dev->sched.fg_pending, 0);
+	dev->sched.last_id = -1;
+	dev->sched.switches = 0;
+	dev->sched.switch_time = 0;
+	dev->sched.stays = 0;
+	dev->sched.stay_time = 0;
+}
+
+void mfc_sched_enter(struct mfc_dev *dev, struct mfc_inst_ctx *ctx)
+{
+	/* the priority follows the calling thread of each frame */
+	ctx->sched_bg = task_nice(current) > 0;
+
+	if (!ctx->sched_bg) {
+		atomic_inc(&dev->sched.fg_pending);
+		return;
+	}
+
+	if (!atomic_read(&dev->sched.fg_pending))
+		return;
+
+	ctx->sched_deferred++;
+	if (!wait_event_timeout(dev->sched.wait,
+			!atomic_read(&dev->sched.fg_pending),
+			msecs_to_jiffies(mfc_sched_bg_delay)))
+		mfc_dbg("id: %d, background frame deadline passed\n", ctx->id);
+}
+
+void mfc_sched_leave(struct mfc_dev *dev, struct mfc_inst_ctx *ctx)
+{
+	if (ctx->sched_bg)
+		return;
+
+	if (atomic_dec_and_test(&dev->sched.fg_pending))
+		wake_up(&dev->sched.wait);
+}
+
+/*
+ * Called with dev->lock held after a frame command. The firmware reloads
+ * the instance context when the instance differs from the previous one,
+ * the frame times with and without that switch are kept apart.
+ */
+void mfc_sched_account(struct mfc_dev *dev, struct mfc_inst_ctx *ctx,
+		ktime_t start)
+{
+	s64 usec = ktime_us_delta(ktime_get(), start);
+
+	ctx->sched_frames++;
+	ctx->sched_time += usec;
+
+	if (dev->sched.last_id != ctx->id) {
+		dev->sched.switches++;
+		dev->sched.switch_time += usec;
+		dev->sched.last_id = ctx->id;
+	} else {
+		dev->sched.stays++;
+		dev->sched.stay_time += usec;
+	}
+}
+
+/* called with dev->lock held when the instance is closed */
+void mfc_sched_release(struct mfc_dev *dev, struct mfc_inst_ctx *ctx)
+{
+	/* the id may be reused by a new instance */
+	if (dev->sched.last_id == ctx->id)
+		dev->sched.last_id = -1;
+
+	if (!ctx->sched_frames)
+		return;
+
+	mfc_dbg("id: %d, frames: %d, avg: %lluus, deferred: %d%s\n",
+		ctx->id, ctx->sched_frames,
+		div_u64(ctx->sched_time, ctx->sched_frames),
+		ctx->sched_deferred, ctx->sched_bg ? " (background)" : "");
+
+	if (dev->sched.switches && dev->sched.stays)
+		mfc_dbg("switches: %d, avg: %lluus, stays: %d, avg: %lluus\n",
+			dev->sched.switches,
+			div_u64(dev->sched.switch_time, dev->sched.switches),
+			dev->sched.stays,
+			div_u64(dev->sched.stay_time, dev->sched.stays));
+}
@@ -0,0 +1,28 @@
+/*
+ * linux/drivers/media/video/samsung/mfc5x/mfc_sched.h
+ *
+ * Copyright (c) 2010 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * Instance scheduler for Samsung MFC (Multi Function Codec - FIMV) driver
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef __MFC_SCHED_H
+#define __MFC_SCHED_H __FILE__
+
+#include <linux/ktime.h>
+
+#include "mfc_dev.h"
+
+void mfc_sched_init(struct mfc_dev *dev);
+void mfc_sched_enter(struct mfc_dev *dev, struct mfc_inst_ctx *ctx);
+void mfc_sched_leave(struct mfc_dev *dev, struct mfc_inst_ctx *ctx);
+void mfc_sched_account(struct mfc_dev *dev, struct mfc_inst_ctx *ctx,
+		ktime_t start);
+void mfc_sched_release(struct mfc_dev *dev, struct mfc_inst_ctx *ctx);
+
+#endif /* __MFC_SCHED_H */
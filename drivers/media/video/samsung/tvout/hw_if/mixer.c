@@ -862,6 +862,7 @@ irqreturn_t s5p_mixer_irq(int irq, void *dev_id)
 					}
 				}
 			}
+			s5p_mixer_ctrl_mirror_vsync();
 			wake_up(&s5ptv_wq);
 		} else {
 			writel(temp_reg, mixer_base + S5P_MXR_INT_STATUS);
@@ -14,6 +14,7 @@
 #include <linux/slab.h>
 #include <linux/dma-mapping.h>
 #include <linux/delay.h>
+#include <linux/fb.h>
 
 #include <plat/clock.h>
 
@@ -91,8 +92,15 @@ struct s5p_mixer_ctrl_private_data {
 
 	bool running;
 	bool vsync_interrupt_enable;
+
+	/* FIMD window a graphic layer scans out, NULL when not mirroring */
+	struct fb_info			*mirror_fb;
+	enum s5p_mixer_layer		mirror_layer;
+	bool				mirror_vsync_saved;
 };
 
+static DEFINE_SPINLOCK(mirror_lock);
+
 static struct s5p_mixer_ctrl_private_data s5p_mixer_ctrl_private = {
 	.pow_name		= "mixer_pd",
 	.clk[ACLK] = {
@@ -474,28 +482,15 @@ int s5p_mixer_ctrl_set_priority(enum s5p_mixer_layer layer, u32 prio)
 	return 0;
 }
 
-int s5p_mixer_ctrl_set_dst_win_pos(enum s5p_mixer_layer layer,
-				int dst_x, int dst_y, u32 w, u32 h)
+void s5p_mixer_ctrl_get_screen_size(u32 *w, u32 *h)
 {
 	u32 w_t, h_t;
 	enum s5p_tvout_disp_mode std;
 	enum s5p_tvout_o_mode inf;
 
-	if ((layer != MIXER_GPR0_LAYER) && (layer != MIXER_GPR1_LAYER)) {
-		tvout_err("invalid layer\n");
-		return -1;
-	}
-
 	s5p_tvif_ctrl_get_std_if(&std, &inf);
 	tvout_dbg("standard no = %d, output mode no = %d\n", std, inf);
 
-	/*
-	 * When tvout resolution was overscanned, there is no
-	 * adjust method in H/W. So, framebuffer should be resized.
-	 * In this case - TV w/h is greater than FB w/h, grp layer's
-	 * dst offset must be changed to fix tv screen.
-	 */
-
 	switch (std) {
 	case TVOUT_NTSC_M:
 	case TVOUT_480P_60_16_9:
@@ -553,6 +548,29 @@ int s5p_mixer_ctrl_set_dst_win_pos(enum s5p_mixer_layer layer,
 		break;
 	}
 
+	*w = w_t;
+	*h = h_t;
+}
+
+int s5p_mixer_ctrl_set_dst_win_pos(enum s5p_mixer_layer layer,
+				int dst_x, int dst_y, u32 w, u32 h)
+{
+	u32 w_t, h_t;
+
+	if ((layer != MIXER_GPR0_LAYER) && (layer != MIXER_GPR1_LAYER)) {
+		tvout_err("invalid layer\n");
+		return -1;
+	}
+
+	/*
+	 * When tvout resolution was overscanned, there is no
+	 * adjust method in H/W. So, framebuffer should be resized.
+	 * In this case - TV w/h is greater than FB w/h, grp layer's
+	 * dst offset must be changed to fix tv screen.
+	 */
+
+	s5p_mixer_ctrl_get_screen_size(&w_t, &h_t);
+
 	if (dst_x < 0)
 		dst_x = 0;
 
@@ -843,6 +861,123 @@ int s5p_mixer_ctrl_scaling(enum s5p_mixer_layer layer,
 	return 0;
 }
 
+static dma_addr_t s5p_mixer_ctrl_mirror_addr(struct fb_info *fb)
+{
+	return fb->fix.smem_start + fb->var.yoffset * fb->fix.line_length +
+		fb->var.xoffset * (fb->var.bits_per_pixel / 8);
+}
+
+/*
+ * Let a graphic layer scan out the framebuffer of a FIMD window instead
+ * of composing a copy of it for the TV. The layer follows the panning of
+ * that window from the mixer vsync interrupt, and is doubled in both
+ * directions when the window fits the screen twice over, the only
+ * scaling the graphic layers have. Rows beyond the screen height are
+ * cut off. A NULL fb stops mirroring and leaves the layer where it was.
+ */
+int s5p_mixer_ctrl_set_mirror(enum s5p_mixer_layer layer, struct fb_info *fb)
+{
+	struct s5ptvfb_user_scaling scaling = { VERTICAL_X1, HORIZONTAL_X1 };
+	u32 w_t, h_t, w, h, scale = 1;
+	unsigned long flags;
+
+	if ((layer != MIXER_GPR0_LAYER) && (layer != MIXER_GPR1_LAYER)) {
+		tvout_err("invalid layer\n");
+		return -EINVAL;
+	}
+
+	if (!fb) {
+		spin_lock_irqsave(&mirror_lock, flags);
+		if (s5p_mixer_ctrl_private.mirror_fb &&
+		    s5p_mixer_ctrl_private.mirror_layer == layer) {
+			s5p_mixer_ctrl_private.mirror_fb = NULL;
+			spin_unlock_irqrestore(&mirror_lock, flags);
+			s5p_mixer_ctrl_set_vsync_interrupt(
+				s5p_mixer_ctrl_private.mirror_vsync_saved);
+		} else {
+			spin_unlock_irqrestore(&mirror_lock, flags);
+		}
+		return 0;
+	}
+
+	if (fb->var.bits_per_pixel != 16 && fb->var.bits_per_pixel != 32) {
+		tvout_err("can't mirror %d bpp\n", fb->var.bits_per_pixel);
+		return -EINVAL;
+	}
+
+	/* the source window width is also the line length of the layer */
+	w = fb->var.xres;
+	h = fb->var.yres;
+	if (fb->fix.line_length != w * (fb->var.bits_per_pixel / 8)) {
+		tvout_err("can't mirror a padded framebuffer\n");
+		return -EINVAL;
+	}
+
+	s5p_mixer_ctrl_get_screen_size(&w_t, &h_t);
+	if (w > w_t) {
+		tvout_err("fb of width %d is wider than the screen\n", w);
+		return -EINVAL;
+	}
+	h = min(h, h_t);
+
+	if (w * 2 <= w_t && h * 2 <= h_t) {
+		scaling.ver = VERTICAL_X2;
+		scaling.hor = HORIZONTAL_X2;
+		scale = 2;
+	}
+
+	spin_lock_irqsave(&mirror_lock, flags);
+	if (!s5p_mixer_ctrl_private.mirror_fb)
+		s5p_mixer_ctrl_private.mirror_vsync_saved =
+			s5p_mixer_ctrl_private.vsync_interrupt_enable;
+	s5p_mixer_ctrl_private.mirror_fb = NULL;
+	spin_unlock_irqrestore(&mirror_lock, flags);
+
+	s5p_mixer_ctrl_set_pixel_format(layer, fb->var.bits_per_pixel,
+		fb->var.transp.length);
+	s5p_mixer_ctrl_set_src_win_pos(layer, 0, 0, w, h);
+	s5p_mixer_ctrl_scaling(layer, scaling);
+	s5p_mixer_ctrl_set_dst_win_pos(layer, (w_t - w * scale) / 2,
+		(h_t - h * scale) / 2, w * scale, h * scale);
+	s5p_mixer_ctrl_set_buffer_address(layer,
+		s5p_mixer_ctrl_mirror_addr(fb));
+
+	spin_lock_irqsave(&mirror_lock, flags);
+	s5p_mixer_ctrl_private.mirror_layer = layer;
+	s5p_mixer_ctrl_private.mirror_fb = fb;
+	spin_unlock_irqrestore(&mirror_lock, flags);
+
+	s5p_mixer_ctrl_set_vsync_interrupt(true);
+
+	return s5p_mixer_ctrl_enable_layer(layer);
+}
+
+/*
+ * Called from the vsync interrupt. The graphic base address is latched
+ * at the next vsync, so the layer shows a buffer the frame after FIMD
+ * was panned to it.
+ */
+void s5p_mixer_ctrl_mirror_vsync(void)
+{
+	struct fb_info *fb;
+	enum s5p_mixer_layer layer;
+	dma_addr_t addr;
+
+	spin_lock(&mirror_lock);
+	fb = s5p_mixer_ctrl_private.mirror_fb;
+	if (!fb || !s5p_mixer_ctrl_private.running)
+		goto out;
+
+	layer = s5p_mixer_ctrl_private.mirror_layer;
+	addr = s5p_mixer_ctrl_mirror_addr(fb);
+	if (addr != s5p_mixer_ctrl_private.layer[layer].fb_addr) {
+		s5p_mixer_ctrl_private.layer[layer].fb_addr = addr;
+		s5p_mixer_set_grp_base_address(layer, addr);
+	}
+out:
+	spin_unlock(&mirror_lock);
+}
+
 int s5p_mixer_ctrl_mux_clk(struct clk *ptr)
 {
 	if (clk_set_parent(s5p_mixer_ctrl_private.clk[MUX].ptr, ptr)) {
@@ -26,6 +26,8 @@
 /****************************************
  * for Mixer control class
  ***************************************/
+struct fb_info;
+
 extern void s5p_mixer_ctrl_init_fb_addr_phy(enum s5p_mixer_layer layer,
 		dma_addr_t fb_addr);
 extern void s5p_mixer_ctrl_init_grp_layer(enum s5p_mixer_layer layer);
@@ -49,6 +51,10 @@ extern int s5p_mixer_ctrl_set_alpha_blending(enum s5p_mixer_layer layer,
 		enum s5ptvfb_alpha_t blend_mode, unsigned int alpha);
 extern int s5p_mixer_ctrl_scaling(enum s5p_mixer_layer,
 		struct s5ptvfb_user_scaling scaling);
+extern void s5p_mixer_ctrl_get_screen_size(u32 *w, u32 *h);
+extern int s5p_mixer_ctrl_set_mirror(enum s5p_mixer_layer layer,
+		struct fb_info *fb);
+extern void s5p_mixer_ctrl_mirror_vsync(void);
 extern int s5p_mixer_ctrl_mux_clk(struct clk *ptr);
 extern void s5p_mixer_ctrl_set_int_enable(bool en);
 extern void s5p_mixer_ctrl_set_vsync_interrupt(bool en);
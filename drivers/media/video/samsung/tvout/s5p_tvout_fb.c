@@ -46,6 +46,9 @@
 	_IOW('F', 219, u32)
 #define S5PTVFB_SCALING	\
 	_IOW('F', 222, struct s5ptvfb_user_scaling)
+/* fb index of the FIMD window to scan out, negative to stop */
+#define S5PTVFB_SET_MIRROR	\
+	_IOW('F', 223, int)
 
 struct s5ptvfb_window {
 	int				id;
@@ -453,6 +456,8 @@ static int s5p_tvout_fb_release(struct fb_info *fb, int user)
 	return 0;
 }
 
+struct fb_ops s5ptvfb_ops;
+
 static int s5p_tvout_fb_ioctl(struct fb_info *fb, unsigned int cmd,
 			unsigned long arg)
 {
@@ -551,12 +556,22 @@ static int s5p_tvout_fb_ioctl(struct fb_info *fb, unsigned int cmd,
 		else
 			s5p_mixer_ctrl_scaling(layer, p.user_scaling);
 		break;
+	case S5PTVFB_SET_MIRROR:
+		if ((int)argp < 0)
+			ret = s5p_mixer_ctrl_set_mirror(layer, NULL);
+		else if ((int)argp >= FB_MAX || !registered_fb[(int)argp] ||
+			 registered_fb[(int)argp]->fbops == &s5ptvfb_ops)
+			ret = -EINVAL;
+		else
+			ret = s5p_mixer_ctrl_set_mirror(layer,
+					registered_fb[(int)argp]);
+		break;
 	}
 #if defined(CONFIG_HAS_EARLYSUSPEND) && defined(CLOCK_GATING_ON_EARLY_SUSPEND)
 	s5p_tvout_mutex_unlock();
 #endif
 
-	return 0;
+	return ret;
 err_fb_ioctl:
 #if defined(CONFIG_HAS_EARLYSUSPEND) && defined(CLOCK_GATING_ON_EARLY_SUSPEND)
 	s5p_tvout_mutex_unlock();
@@ -38,23 +38,31 @@ UMP_KERNEL_API_EXPORT ump_secure_id ump_dd_secure_id_get(ump_dd_handle memh)
 
 
 
+/*
+ * Secure ID lookups take neither the secure ID map lock nor the lock of the
+ * descriptor mapping, every surface swap and gralloc lock goes through here.
+ * The table is read under RCU and the ump_dd_mem found in it is freed after a
+ * grace period, so it stays valid until rcu_read_unlock(). A reference is only
+ * taken while the count has not dropped to zero, memory on its way out can't
+ * be revived.
+ */
 UMP_KERNEL_API_EXPORT ump_dd_handle ump_dd_handle_create_from_secure_id(ump_secure_id secure_id)
 {
 	ump_dd_mem * mem;
 
-	_mali_osk_lock_wait(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
-
 	DBG_MSG(5, ("Getting handle from secure ID. ID: %u\n", secure_id));
-	if (0 != ump_descriptor_mapping_get(device.secure_id_map, (int)secure_id, (void**)&mem))
+
+	rcu_read_lock();
+	mem = ump_descriptor_mapping_get_rcu(device.secure_id_map, (int)secure_id);
+	if (NULL == mem || !_ump_osk_atomic_inc_not_zero(&mem->ref_count))
 	{
-		_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
+		rcu_read_unlock();
 		DBG_MSG(1, ("Secure ID not found. ID: %u\n", secure_id));
 		return UMP_DD_HANDLE_INVALID;
 	}
+	rcu_read_unlock();
 
-	ump_dd_reference_add(mem);
-
-	_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
+	DBG_MSG(4, ("Memory reference incremented. ID: %u\n", mem->secure_id));
 
 	return (ump_dd_handle)mem;
 }
@@ -63,17 +71,17 @@ UMP_KERNEL_API_EXPORT ump_dd_handle ump_dd_handle_get(ump_secure_id secure_id)
 {
 	ump_dd_mem * mem;
 
-	_mali_osk_lock_wait(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
-
 	DBG_MSG(5, ("Getting handle from secure ID. ID: %u\n", secure_id));
-	if (0 != ump_descriptor_mapping_get(device.secure_id_map, (int)secure_id, (void**)&mem))
+
+	rcu_read_lock();
+	mem = ump_descriptor_mapping_get_rcu(device.secure_id_map, (int)secure_id);
+	if (NULL == mem || 0 == _mali_osk_atomic_read(&mem->ref_count))
 	{
-		_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
+		rcu_read_unlock();
 		DBG_MSG(1, ("Secure ID not found. ID: %u\n", secure_id));
 		return UMP_DD_HANDLE_INVALID;
 	}
-
-	_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
+	rcu_read_unlock();
 
 	return (ump_dd_handle)mem;
 }
@@ -177,12 +185,10 @@ UMP_KERNEL_API_EXPORT void ump_dd_reference_release(ump_dd_handle memh)
 
 	DEBUG_ASSERT_POINTER(mem);
 
-	/* We must hold this mutex while doing the atomic_dec_and_read, to protect
-	that elements in the ump_descriptor_mapping table is always valid.  If they
-	are not, userspace may accidently map in this secure_ids right before its freed
-	giving a mapped backdoor into unallocated memory.*/
-	_mali_osk_lock_wait(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
-
+	/* Lookups by secure ID never take a reference once the count is zero, so
+	only the final release needs the mutex. It is taken before the descriptor
+	is freed so anyone who found the memory under the mutex is done with it,
+	and the ump_dd_mem itself outlives the lockless lookups by a grace period.*/
 	new_ref = _ump_osk_atomic_dec_and_read(&mem->ref_count);
 
 	DBG_MSG(4, ("Memory reference decremented. ID: %u, new value: %d\n", mem->secure_id, new_ref));
@@ -191,6 +197,7 @@ UMP_KERNEL_API_EXPORT void ump_dd_reference_release(ump_dd_handle memh)
 	{
 		DBG_MSG(3, ("Final release of memory. ID: %u\n", mem->secure_id));
 
+		_mali_osk_lock_wait(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
 		ump_descriptor_mapping_free(device.secure_id_map, (int)mem->secure_id);
 
 		_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
@@ -220,11 +227,7 @@ UMP_KERNEL_API_EXPORT void ump_dd_reference_release(ump_dd_handle memh)
 #endif
 		mem->release_func(mem->ctx, mem);
 
-		_mali_osk_free(mem);
-	}
-	else
-	{
-		_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
+		kfree_rcu(mem, rcu);
 	}
 }
 
@@ -91,14 +91,14 @@ int ump_descriptor_mapping_allocate_mapping(ump_descriptor_mapping * map, void *
 
  		_mali_osk_memcpy(new_table->usage, old_table->usage, (sizeof(unsigned long)*map->current_nr_mappings) / BITS_PER_LONG);
  		_mali_osk_memcpy(new_table->mappings, old_table->mappings, map->current_nr_mappings * sizeof(void*));
-		map->table = new_table;
+		rcu_assign_pointer(map->table, new_table);
 		map->current_nr_mappings = nr_mappings_new;
-		descriptor_table_free(old_table);
+		kfree_rcu(old_table, rcu);
 	}
 
 	/* we have found a valid descriptor, set the value and usage bit */
 	_mali_osk_set_nonatomic_bit(descriptor, map->table->usage);
-	map->table->mappings[descriptor] = target;
+	rcu_assign_pointer(map->table->mappings[descriptor], target);
 
 unlock_and_exit:
 	_mali_osk_lock_signal(map->lock, _MALI_OSK_LOCKMODE_RW);
@@ -120,13 +120,26 @@ int ump_descriptor_mapping_get(ump_descriptor_mapping * map, int descriptor, voi
 	return result;
 }
 
+void * ump_descriptor_mapping_get_rcu(ump_descriptor_mapping * map, int descriptor)
+{
+	ump_descriptor_table * table;
+
+	DEBUG_ASSERT(map);
+	table = rcu_dereference(map->table);
+	if ( (descriptor < 0) || (descriptor >= table->count) )
+		return NULL;
+
+	/* freed descriptors are cleared before their usage bit, NULL is never valid */
+	return rcu_dereference(table->mappings[descriptor]);
+}
+
 int ump_descriptor_mapping_set(ump_descriptor_mapping * map, int descriptor, void * target)
 {
  	int result = -1;/*-EFAULT;*/
  	_mali_osk_lock_wait(map->lock, _MALI_OSK_LOCKMODE_RO);
  	if ( (descriptor >= 0) && (descriptor < map->current_nr_mappings) && _mali_osk_test_bit(descriptor, map->table->usage) )
 	{
-		map->table->mappings[descriptor] = target;
+		rcu_assign_pointer(map->table->mappings[descriptor], target);
 		result = 0;
 	}
 	_mali_osk_lock_signal(map->lock, _MALI_OSK_LOCKMODE_RO);
@@ -154,6 +167,7 @@ static ump_descriptor_table * descriptor_table_alloc(int count)
 	{
 		table->usage = (u32*)((u8*)table + sizeof(ump_descriptor_table));
 		table->mappings = (void**)((u8*)table + sizeof(ump_descriptor_table) + ((sizeof(unsigned long) * count)/BITS_PER_LONG));
+		table->count = count;
 	}
 
 	return table;
@@ -16,6 +16,7 @@
 #define __UMP_KERNEL_DESCRIPTOR_MAPPING_H__
 
 #include "mali_osk.h"
+#include <linux/rcupdate.h>
 
 /**
  * The actual descriptor mapping table, never directly accessed by clients
@@ -24,6 +25,8 @@ typedef struct ump_descriptor_table
 {
 	u32 * usage; /**< Pointer to bitpattern indicating if a descriptor is valid/used or not */
 	void** mappings; /**< Array of the pointers the descriptors map to */
+	int count; /**< Number of entries in this table, lockless readers may still see an old one */
+	struct rcu_head rcu; /**< Tables replaced by a bigger one are freed after a grace period */
 } ump_descriptor_table;
 
 /**
@@ -71,6 +74,16 @@ int ump_descriptor_mapping_allocate_mapping(ump_descriptor_mapping * map, void *
  */
 int ump_descriptor_mapping_get(ump_descriptor_mapping * map, int descriptor, void** target);
 
+/**
+ * Get the value mapped to by a descriptor ID without taking any lock
+ * The caller must be inside rcu_read_lock(), and whatever the value points to
+ * has to be freed after a grace period if it is to be used past the lookup.
+ * @param map The map to lookup the descriptor id in
+ * @param descriptor The descriptor ID to lookup
+ * @return The stored value, NULL if the descriptor is not mapped
+ */
+void * ump_descriptor_mapping_get_rcu(ump_descriptor_mapping * map, int descriptor);
+
 /**
  * Set the value mapped to by a descriptor ID
  * @param map The map to lookup the descriptor id in
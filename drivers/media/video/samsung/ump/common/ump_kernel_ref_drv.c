@@ -60,9 +60,9 @@ UMP_KERNEL_API_EXPORT ump_dd_handle ump_dd_handle_create_from_phys_blocks(ump_dd
 		return UMP_DD_HANDLE_INVALID;
 	}
 
-	/* Find a secure ID for this allocation */
+	/* Find a secure ID for this allocation, mem is only published once it is set up */
 	_mali_osk_lock_wait(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
-	map_id = ump_descriptor_mapping_allocate_mapping(device.secure_id_map, (void*) mem);
+	map_id = ump_descriptor_mapping_allocate_mapping(device.secure_id_map, NULL);
 
 	if (map_id < 0)
 	{
@@ -96,6 +96,7 @@ UMP_KERNEL_API_EXPORT ump_dd_handle ump_dd_handle_create_from_phys_blocks(ump_dd
 	/* For now UMP handles created by ump_dd_handle_create_from_phys_blocks() is forced to be Uncached */
 	mem->is_cached = 0;
 
+	ump_descriptor_mapping_set(device.secure_id_map, map_id, (void*) mem);
 	_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
 	DBG_MSG(3, ("UMP memory created. ID: %u, size: %lu\n", mem->secure_id, mem->size_bytes));
 
@@ -136,9 +137,9 @@ _mali_osk_errcode_t _ump_ukk_allocate( _ump_uk_allocate_s *user_interaction )
 		return _MALI_OSK_ERR_NOMEM;
 	}
 
-	/* Create a secure ID for this allocation */
+	/* Create a secure ID for this allocation, new_allocation is only published once it is set up */
 	_mali_osk_lock_wait(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
-	map_id = ump_descriptor_mapping_allocate_mapping(device.secure_id_map, (void*)new_allocation);
+	map_id = ump_descriptor_mapping_allocate_mapping(device.secure_id_map, NULL);
 
 	if (map_id < 0)
 	{
@@ -180,6 +181,7 @@ _mali_osk_errcode_t _ump_ukk_allocate( _ump_uk_allocate_s *user_interaction )
 	new_allocation->ctx = device.backend->ctx;
 	new_allocation->release_func = device.backend->release;
 
+	ump_descriptor_mapping_set(device.secure_id_map, map_id, (void*)new_allocation);
 	_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
 
 	/* Initialize the session_memory_element, and add it to the session object */
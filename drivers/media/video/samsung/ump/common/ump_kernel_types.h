@@ -13,6 +13,7 @@
 
 #include "ump_kernel_interface.h"
 #include "mali_osk.h"
+#include <linux/rcupdate.h>
 
 /*
  * This struct is what is "behind" a ump_dd_handle
@@ -28,6 +29,7 @@ typedef struct ump_dd_mem
 	void * ctx;
 	void * backend_info;
 	int is_cached;
+	struct rcu_head rcu; /**< Freed after a grace period, lookups by secure ID are lockless */
 #ifdef CONFIG_DMA_SHARED_BUFFER
 	struct dma_buf_attachment *import_attach;
 	struct sg_table *sgt;
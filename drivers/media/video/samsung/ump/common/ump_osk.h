@@ -33,6 +33,9 @@ int _ump_osk_atomic_inc_and_read( _mali_osk_atomic_t *atom );
 
 int _ump_osk_atomic_dec_and_read( _mali_osk_atomic_t *atom );
 
+/* Increments unless the count already dropped to zero, returns non-zero if it did */
+int _ump_osk_atomic_inc_not_zero( _mali_osk_atomic_t *atom );
+
 _mali_osk_errcode_t _ump_osk_mem_mapregion_init( ump_memory_allocation *descriptor );
 
 _mali_osk_errcode_t _ump_osk_mem_mapregion_map( ump_memory_allocation * descriptor, u32 offset, u32 * phys_addr, unsigned long size );
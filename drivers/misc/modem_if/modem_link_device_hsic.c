@@ -36,6 +36,33 @@
 #include "modem_link_device_hsic.h"
 #include "modem_utils.h"
 
+/*
+ * Raw IP frames queued behind each other are packed into one bulk URB of at
+ * most tx_aggr_max bytes. The CP parses the raw pipe as a stream of HDLC
+ * framed packets, the same way the AP handles its RX URBs, so a transfer
+ * may carry more than one frame. tx_aggr_delay holds the first raw frame
+ * back for up to that many ms so that TCP ACKs and RTP packets sent close
+ * together share a transfer; the tx work runs at once when tx_aggr_max
+ * bytes are waiting.
+ */
+#define TX_AGGR_DELAY_MAX	10	/* ms */
+
+/*
+ * Merged skbs up to the default tx_aggr_max come from a per-cpu pool and
+ * go back to it when their URB completes, instead of a kmalloc and kfree
+ * of a page sized buffer for every transfer.
+ */
+#define TX_AGGR_POOL_SKB_SIZE	4096
+#define TX_AGGR_POOL_DEPTH	16
+
+static unsigned int tx_aggr_max = 4096;
+module_param(tx_aggr_max, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(tx_aggr_max, "max bytes of raw frames in one URB, 0: off");
+
+static unsigned int tx_aggr_delay;
+module_param(tx_aggr_delay, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(tx_aggr_delay, "ms to wait for more raw frames");
+
 static struct modem_ctl *if_usb_get_modemctl(struct link_pm_data *pm_data);
 static int link_pm_runtime_get_active(struct link_pm_data *pm_data);
 static int usb_tx_urb_with_skb(struct usb_device *usbdev, struct sk_buff *skb,
@@ -331,6 +358,19 @@ rx_submit:
 	}
 }
 
+/* how long the tx work may wait after @len more raw bytes were queued */
+static unsigned long usb_tx_aggr_delay(struct usb_link_device *usb_ld,
+					size_t len)
+{
+	int queued = atomic_add_return(len, &usb_ld->raw_tx_bytes);
+
+	if (!tx_aggr_max || !tx_aggr_delay || queued >= tx_aggr_max)
+		return 0;
+
+	return msecs_to_jiffies(min_t(unsigned int, tx_aggr_delay,
+				TX_AGGR_DELAY_MAX));
+}
+
 static int usb_send(struct link_device *ld, struct io_device *iod,
 			struct sk_buff *skb)
 {
@@ -380,16 +420,38 @@ static int usb_send(struct link_device *ld, struct io_device *iod,
 	}
 
 	/* en queue skb data */
+	skbpriv(skb)->pooled = false;
 	skb_queue_tail(txq, skb);
 	/* Hold wake_lock for getting schedule the tx_work */
 	wake_lock(&pm_data->tx_async_wake);
 
+	if (iod->format == IPC_RAW) {
+		unsigned long delay = usb_tx_aggr_delay(usb_ld, tx_size);
+
+		/* enough raw data for a full URB, stop waiting for more */
+		if (!delay && __cancel_delayed_work(&ld->tx_delayed_work))
+			queue_delayed_work(ld->tx_wq, &ld->tx_delayed_work, 0);
+		else if (!work_pending(&ld->tx_delayed_work.work))
+			queue_delayed_work(ld->tx_wq, &ld->tx_delayed_work,
+					delay);
+		return tx_size;
+	}
+
 	if (!work_pending(&ld->tx_delayed_work.work))
 		queue_delayed_work(ld->tx_wq, &ld->tx_delayed_work, 0);
 
 	return tx_size;
 }
 
+static void usb_tx_free_skb(struct usb_link_device *usb_ld,
+			struct sk_buff *skb)
+{
+	if (skbpriv(skb)->pooled)
+		skb_pool_free(usb_ld->tx_pool, skb);
+	else
+		dev_kfree_skb_any(skb);
+}
+
 static void usb_tx_complete(struct urb *urb)
 {
 	struct sk_buff *skb = urb->context;
@@ -408,7 +470,7 @@ static void usb_tx_complete(struct urb *urb)
 			mif_info("TX error (%d)\n", urb->status);
 	}
 
-	dev_kfree_skb_any(skb);
+	usb_tx_free_skb(usb_ld, skb);
 	if (urb->dev && usb_ld->if_usb_connected)
 		usb_mark_last_busy(urb->dev);
 	usb_free_urb(urb);
@@ -445,13 +507,85 @@ static int usb_tx_urb_with_skb(struct usb_device *usbdev, struct sk_buff *skb,
 }
 
 
-static int _usb_tx_work(struct sk_buff *skb)
+/*
+ * Dequeues the next raw frame and, when the frames behind it fit in
+ * tx_aggr_max bytes, copies them into one skb for a single URB. The skb
+ * private data of the first frame is kept for the merged skb. If the merged
+ * skb cannot be allocated the frames just go out one by one.
+ */
+static struct sk_buff *usb_tx_aggregate(struct usb_link_device *usb_ld,
+			struct sk_buff_head *txq, unsigned int *frames)
+{
+	struct sk_buff *skb;
+	struct sk_buff *next;
+	struct sk_buff *aggr;
+	unsigned long flags;
+	unsigned int len;
+	unsigned int cnt;
+	bool pooled;
+
+	*frames = 1;
+
+	skb = skb_dequeue(txq);
+	if (!skb)
+		return NULL;
+	atomic_sub(skb->len, &usb_ld->raw_tx_bytes);
+
+	if (!tx_aggr_max || skb->len >= tx_aggr_max)
+		return skb;
+
+	len = skb->len;
+	cnt = 1;
+	spin_lock_irqsave(&txq->lock, flags);
+	skb_queue_walk(txq, next) {
+		if (len + next->len > tx_aggr_max)
+			break;
+		len += next->len;
+		cnt++;
+	}
+	spin_unlock_irqrestore(&txq->lock, flags);
+
+	if (cnt == 1)
+		return skb;
+
+	pooled = usb_ld->tx_pool && len <= TX_AGGR_POOL_SKB_SIZE;
+	if (pooled)
+		aggr = skb_pool_alloc(usb_ld->tx_pool, GFP_KERNEL);
+	else
+		aggr = alloc_skb(len, GFP_KERNEL);
+	if (!aggr)
+		return skb;
+
+	memcpy(skb_put(aggr, skb->len), skb->data, skb->len);
+	memcpy(skbpriv(aggr), skbpriv(skb), sizeof(struct skbuff_private));
+	skbpriv(aggr)->pooled = pooled;
+	usb_tx_free_skb(usb_ld, skb);
+
+	/* only this work takes frames off the raw queue */
+	while (--cnt) {
+		next = skb_dequeue(txq);
+		if (!next)
+			break;
+		atomic_sub(next->len, &usb_ld->raw_tx_bytes);
+
+		memcpy(skb_put(aggr, next->len), next->data, next->len);
+		usb_tx_free_skb(usb_ld, next);
+		(*frames)++;
+	}
+
+	return aggr;
+}
+
+static int _usb_tx_work(struct sk_buff *skb, unsigned int frames)
 {
 	struct sk_buff_head *txq;
 	struct io_device *iod = skbpriv(skb)->iod;
 	struct link_device *ld = skbpriv(skb)->ld;
 	struct usb_link_device *usb_ld = to_usb_link_device(ld);
 	struct if_usb_devdata *pipe_data;
+	struct usb_tx_stats *stats;
+	unsigned int len = skb->len;
+	int ret;
 
 	switch (iod->format) {
 	case IPC_BOOT:
@@ -485,7 +619,15 @@ static int _usb_tx_work(struct sk_buff *skb)
 	if (iod->format == IPC_RAW)
 		mif_debug("TX[RAW]\n");
 */
-	return usb_tx_urb_with_skb(usb_ld->usbdev, skb,	pipe_data);
+	ret = usb_tx_urb_with_skb(usb_ld->usbdev, skb,	pipe_data);
+	if (ret)
+		return ret;
+
+	stats = &usb_ld->tx_stats[pipe_data - usb_ld->devdata];
+	stats->urbs++;
+	stats->frames += frames;
+	stats->bytes += len;
+	return 0;
 }
 
 
@@ -497,6 +639,7 @@ static void usb_tx_work(struct work_struct *work)
 	struct usb_link_device *usb_ld = to_usb_link_device(ld);
 	struct sk_buff *skb;
 	struct link_pm_data *pm_data = usb_ld->link_pm_data;
+	unsigned int frames;
 
 	if (!usb_ld->usbdev) {
 		mif_info("usbdev is invalid\n");
@@ -532,7 +675,7 @@ static void usb_tx_work(struct work_struct *work)
 		/* one by one for fair flow control */
 		skb = skb_dequeue(&ld->sk_fmt_tx_q);
 		if (skb)
-			ret = _usb_tx_work(skb);
+			ret = _usb_tx_work(skb, 1);
 
 		if (ret) {
 			mif_err("usb_tx_urb_with_skb for fmt_q %d\n", ret);
@@ -546,12 +689,13 @@ static void usb_tx_work(struct work_struct *work)
 			goto retry_tx_work;
 		}
 
-		skb = skb_dequeue(&ld->sk_raw_tx_q);
+		skb = usb_tx_aggregate(usb_ld, &ld->sk_raw_tx_q, &frames);
 		if (skb)
-			ret = _usb_tx_work(skb);
+			ret = _usb_tx_work(skb, frames);
 
 		if (ret) {
 			mif_err("usb_tx_urb_with_skb for raw_q %d\n", ret);
+			atomic_add(skb->len, &usb_ld->raw_tx_bytes);
 			skb_queue_head(&ld->sk_raw_tx_q, skb);
 
 			if (ret == -ENODEV || ret == -ENOENT)
@@ -1290,6 +1434,7 @@ static int __devinit if_usb_probe(struct usb_interface *intf,
 		 clear all tx q*/
 		skb_queue_purge(&usb_ld->ld.sk_fmt_tx_q);
 		skb_queue_purge(&usb_ld->ld.sk_raw_tx_q);
+		atomic_set(&usb_ld->raw_tx_bytes, 0);
 		break;
 	case IPC_CHANNEL:
 		pipe = intf->altsetting->desc.bInterfaceNumber / 2;
@@ -1439,6 +1584,49 @@ static int if_usb_init(struct link_device *ld)
 	return ret;
 }
 
+static const char * const tx_stats_name[IF_USB_DEVNUM_MAX] = {
+	[IF_USB_FMT_EP] = "fmt",
+	[IF_USB_RAW_EP] = "raw",
+	[IF_USB_RFS_EP] = "rfs",
+	[IF_USB_CMD_EP] = "cmd",
+};
+
+static ssize_t show_tx_stats(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct miscdevice *miscdev = dev_get_drvdata(dev);
+	struct link_pm_data *pm_data =
+		container_of(miscdev, struct link_pm_data, miscdev);
+	struct usb_link_device *usb_ld = pm_data->usb_ld;
+	struct usb_tx_stats *stats;
+	char *p = buf;
+	int i;
+
+	p += sprintf(p, "ch   urbs frames bytes\n");
+	for (i = 0; i < IF_USB_DEVNUM_MAX; i++) {
+		stats = &usb_ld->tx_stats[i];
+		p += sprintf(p, "%s %lu %lu %lu\n", tx_stats_name[i],
+			stats->urbs, stats->frames, stats->bytes);
+	}
+
+	return p - buf;
+}
+
+static ssize_t store_tx_stats(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct miscdevice *miscdev = dev_get_drvdata(dev);
+	struct link_pm_data *pm_data =
+		container_of(miscdev, struct link_pm_data, miscdev);
+
+	memset(pm_data->usb_ld->tx_stats, 0,
+		sizeof(pm_data->usb_ld->tx_stats));
+	return count;
+}
+
+static struct device_attribute attr_tx_stats =
+	__ATTR(tx_stats, S_IRUGO | S_IWUSR, show_tx_stats, store_tx_stats);
+
 static int usb_link_pm_init(struct usb_link_device *usb_ld, void *data)
 {
 	int r;
@@ -1485,6 +1673,9 @@ static int usb_link_pm_init(struct usb_link_device *usb_ld, void *data)
 		goto err_misc_register;
 	}
 
+	if (device_create_file(pm_data->miscdev.this_device, &attr_tx_stats))
+		mif_err("fail to create tx_stats\n");
+
 	r = request_irq(pm_data->irq_link_hostwake, link_pm_irq_handler,
 		IRQF_NO_SUSPEND | IRQF_TRIGGER_FALLING | IRQF_TRIGGER_RISING,
 		"hostwake", (void *)pm_data);
@@ -1567,6 +1758,9 @@ struct link_device *hsic_create_link_device(void *data)
 	}
 
 	INIT_DELAYED_WORK(&ld->tx_delayed_work, usb_tx_work);
+	/* without the pool merged skbs are plainly allocated */
+	usb_ld->tx_pool = skb_pool_create(TX_AGGR_POOL_SKB_SIZE,
+						TX_AGGR_POOL_DEPTH);
 	INIT_DELAYED_WORK(&usb_ld->rx_retry_work, usb_rx_retry_work);
 	usb_ld->rx_retry_cnt = 0;
 
@@ -1582,6 +1776,8 @@ struct link_device *hsic_create_link_device(void *data)
 	mif_info("%s : create_link_device DONE\n", usb_ld->ld.name);
 	return (void *)ld;
 err:
+	if (usb_ld->tx_pool)
+		skb_pool_destroy(usb_ld->tx_pool);
 	kfree(usb_ld);
 	return NULL;
 }
@@ -107,6 +107,13 @@ struct link_pm_data {
 	void (*ehci_reg_dump)(struct device *);
 };
 
+/* per pipe TX counters, a raw URB may carry several aggregated frames */
+struct usb_tx_stats {
+	unsigned long urbs;
+	unsigned long frames;
+	unsigned long bytes;
+};
+
 struct if_usb_devdata {
 	struct usb_interface *data_intf;
 	struct usb_link_device *usb_ld;
@@ -138,6 +145,11 @@ struct usb_link_device {
 	/* LINK PM DEVICE DATA */
 	struct link_pm_data *link_pm_data;
 
+	/* TX aggregation of the raw pipe */
+	atomic_t raw_tx_bytes;
+	struct usb_tx_stats tx_stats[IF_USB_DEVNUM_MAX];
+	struct skb_pool *tx_pool;
+
 	/*RX retry work by -ENOMEM*/
 	struct delayed_work rx_retry_work;
 	struct urb *retry_urb;
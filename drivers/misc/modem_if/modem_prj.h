@@ -18,6 +18,7 @@
 #include <linux/wait.h>
 #include <linux/miscdevice.h>
 #include <linux/skbuff.h>
+#include <linux/netdevice.h>
 #include <linux/interrupt.h>
 #include <linux/completion.h>
 #include <linux/wakelock.h>
@@ -353,8 +354,14 @@ struct sipc5_frame_data {
 	u8 hdr[SIPC5_MAX_HEADER_SIZE];
 };
 
+#define VNET_NAPI_WEIGHT	64
+
 struct vnet {
 	struct io_device *iod;
+
+	/* multi-PDP RX frames waiting for the NAPI poll */
+	struct napi_struct napi;
+	struct sk_buff_head rx_q;
 };
 
 /* for fragmented data from link devices */
@@ -377,6 +384,9 @@ struct skbuff_private {
 
 	/* for indicating that thers is only one IPC frame in an skb */
 	bool single_frame;
+
+	/* tx skb allocated from the link device's skb pool */
+	bool pooled;
 } __packed;
 
 static inline struct skbuff_private *skbpriv(struct sk_buff *skb)
@@ -193,6 +193,27 @@ static int rx_loopback(struct sk_buff *skb)
 	return ret;
 }
 
+/*
+ * The pieces of a multi-frame are linked on the frag_list of the first one
+ * instead of being copied into a buffer of the full length, so each byte is
+ * copied once out of the link device and once more to the user by
+ * misc_read().
+ */
+static void rx_chain_frame(struct sk_buff *head, struct sk_buff *skb)
+{
+	struct sk_buff **last = &skb_shinfo(head)->frag_list;
+
+	while (*last)
+		last = &(*last)->next;
+
+	skb->next = NULL;
+	*last = skb;
+
+	head->len += skb->len;
+	head->data_len += skb->len;
+	head->truesize += skb->truesize;
+}
+
 static int rx_fmt_frame(struct sk_buff *skb)
 {
 	struct link_device *ld = skbpriv(skb)->ld;
@@ -225,21 +246,24 @@ static int rx_fmt_frame(struct sk_buff *skb)
 		mif_err("%s->%s: start of multi-frame (ID:%d len:%d)\n",
 			ld->name, iod->name, id, fh->len);
 
-		rx_skb = rx_alloc_skb(fh->len, iod, ld);
-		if (!rx_skb) {
-			mif_err("%s: ERR! rx_alloc_skb fail\n", iod->name);
+		/*
+		 * The first piece becomes the head of the multi-frame. A clone
+		 * shares its skb_shared_info with the other frames split out of
+		 * the same link skb, so it gets a private copy first.
+		 */
+		if (skb_cloned(skb) && pskb_expand_head(skb, 0, 0, GFP_ATOMIC)) {
+			mif_err("%s: ERR! pskb_expand_head fail\n", iod->name);
+			dev_kfree_skb_any(skb);
 			return -ENOMEM;
 		}
 
+		rx_skb = skb;
 		iod->skb[id] = rx_skb;
 	} else {
 		rx_skb = iod->skb[id];
+		rx_chain_frame(rx_skb, skb);
 	}
 
-	/* Perform multi-frame processing */
-	memcpy(skb_put(rx_skb, skb->len), skb->data, skb->len);
-	dev_kfree_skb_any(skb);
-
 	if (ctrl & 0x80) {
 		/* The last frame has not arrived yet. */
 		mif_info("%s->%s: recv multi-frame (ID:%d rcvd:%d)\n",
@@ -269,6 +293,64 @@ static int rx_raw_misc(struct sk_buff *skb)
 	return 0;
 }
 
+/*
+ * Multi-PDP frames are not handed to the stack one by one with netif_rx().
+ * They are queued on the vnet and delivered from its NAPI poll, so a burst
+ * that a link device pulls out of one interrupt or one URB batch goes up
+ * through napi_gro_receive() in a single softirq and TCP streams get
+ * coalesced by GRO before they reach the protocol layers.
+ */
+static int vnet_rx_queue(struct net_device *ndev, struct sk_buff *skb)
+{
+	struct vnet *vnet = netdev_priv(ndev);
+
+	if (unlikely(!netif_running(ndev) ||
+		     skb_queue_len(&vnet->rx_q) >= netdev_max_backlog)) {
+		ndev->stats.rx_dropped++;
+		dev_kfree_skb_any(skb);
+		return NET_RX_DROP;
+	}
+
+	skb_queue_tail(&vnet->rx_q, skb);
+
+	if (in_interrupt()) {
+		napi_schedule(&vnet->napi);
+	} else {
+		/* Run the poll on the way out instead of waiting for ksoftirqd */
+		local_bh_disable();
+		napi_schedule(&vnet->napi);
+		local_bh_enable();
+	}
+
+	return NET_RX_SUCCESS;
+}
+
+static int vnet_poll(struct napi_struct *napi, int budget)
+{
+	struct vnet *vnet = container_of(napi, struct vnet, napi);
+	struct sk_buff *skb;
+	int rcvd = 0;
+
+	while (rcvd < budget) {
+		skb = skb_dequeue(&vnet->rx_q);
+		if (!skb)
+			break;
+
+		napi_gro_receive(napi, skb);
+		rcvd++;
+	}
+
+	if (rcvd < budget) {
+		napi_complete(napi);
+
+		/* A frame queued after the last dequeue found SCHED still set */
+		if (!skb_queue_empty(&vnet->rx_q))
+			napi_schedule(napi);
+	}
+
+	return rcvd;
+}
+
 static int rx_multi_pdp(struct sk_buff *skb)
 {
 	struct link_device *ld = skbpriv(skb)->ld;
@@ -308,15 +390,13 @@ static int rx_multi_pdp(struct sk_buff *skb)
 		skb->ip_summed = CHECKSUM_UNNECESSARY;
 		skb_reset_mac_header(skb);
 		skb_pull(skb, sizeof(struct ethhdr));
+	} else {
+		skb_reset_mac_header(skb);
 	}
 
-	if (in_interrupt())
-		ret = netif_rx(skb);
-	else
-		ret = netif_rx_ni(skb);
-
+	ret = vnet_rx_queue(ndev, skb);
 	if (ret != NET_RX_SUCCESS) {
-		mif_err("%s->%s: ERR! netif_rx fail (err %d)\n",
+		mif_err("%s->%s: ERR! vnet_rx_queue fail (err %d)\n",
 			ld->name, iod->name, ret);
 	}
 
@@ -1361,6 +1441,7 @@ static ssize_t misc_read(struct file *filp, char *buf, size_t count,
 	struct io_device *iod = (struct io_device *)filp->private_data;
 	struct sk_buff_head *rxq = &iod->sk_rx_q;
 	struct sk_buff *skb;
+	struct iovec iov;
 	int copied = 0;
 
 	if (skb_queue_empty(rxq)) {
@@ -1379,7 +1460,8 @@ static ssize_t misc_read(struct file *filp, char *buf, size_t count,
 #endif
 		getnstimeofday(&epoch);
 		mif_time_log(iod->mc->msd, epoch, NULL, 0);
-		mif_ipc_log(MIF_IPC_AP2RL, iod->mc->msd, skb->data, skb->len);
+		mif_ipc_log(MIF_IPC_AP2RL, iod->mc->msd, skb->data,
+			skb_headlen(skb));
 	}
 
 #if 0
@@ -1392,7 +1474,10 @@ static ssize_t misc_read(struct file *filp, char *buf, size_t count,
 
 	copied = skb->len > count ? count : skb->len;
 
-	if (copy_to_user(buf, skb->data, copied)) {
+	/* A reassembled multi-frame carries its pieces on the frag_list */
+	iov.iov_base = buf;
+	iov.iov_len = copied;
+	if (skb_copy_datagram_iovec(skb, 0, &iov, copied)) {
 		mif_err("%s: ERR! copy_to_user fail\n", iod->name);
 		dev_kfree_skb_any(skb);
 		return -EFAULT;
@@ -1402,7 +1487,7 @@ static ssize_t misc_read(struct file *filp, char *buf, size_t count,
 		iod->name, skb->len, copied, rxq->qlen);
 
 	if (skb->len > count) {
-		skb_pull(skb, count);
+		pskb_pull(skb, count);
 		skb_queue_head(rxq, skb);
 	} else {
 		dev_kfree_skb_any(skb);
@@ -1427,6 +1512,7 @@ static int vnet_open(struct net_device *ndev)
 
 	mif_err("%s\n", vnet->iod->name);
 
+	napi_enable(&vnet->napi);
 	netif_start_queue(ndev);
 	atomic_inc(&vnet->iod->opened);
 	return 0;
@@ -1440,6 +1526,8 @@ static int vnet_stop(struct net_device *ndev)
 
 	atomic_dec(&vnet->iod->opened);
 	netif_stop_queue(ndev);
+	napi_disable(&vnet->napi);
+	skb_queue_purge(&vnet->rx_q);
 	skb_queue_purge(&vnet->iod->sk_rx_q);
 	return 0;
 }
@@ -1548,6 +1636,7 @@ static void vnet_setup(struct net_device *ndev)
 	ndev->hard_header_len = 0;
 	ndev->tx_queue_len = 1000;
 	ndev->mtu = ETH_DATA_LEN;
+	ndev->features |= NETIF_F_GRO;
 	ndev->watchdog_timeo = 5 * HZ;
 }
 
@@ -1561,6 +1650,7 @@ static void vnet_setup_ether(struct net_device *ndev)
 	ndev->hard_header_len = 0;
 	ndev->tx_queue_len = 1000;
 	ndev->mtu = ETH_DATA_LEN;
+	ndev->features |= NETIF_F_GRO;
 	ndev->watchdog_timeo = 5 * HZ;
 }
 
@@ -1598,27 +1688,33 @@ int sipc5_init_io_device(struct io_device *iod)
 	case IODEV_NET:
 		skb_queue_head_init(&iod->sk_rx_q);
 		if (iod->use_handover)
-			iod->ndev = alloc_netdev(0, iod->name,
+			iod->ndev = alloc_netdev(sizeof(struct vnet), iod->name,
 						vnet_setup_ether);
 		else
-			iod->ndev = alloc_netdev(0, iod->name, vnet_setup);
+			iod->ndev = alloc_netdev(sizeof(struct vnet), iod->name,
+						vnet_setup);
 
 		if (!iod->ndev) {
 			mif_info("%s: ERR! alloc_netdev fail\n", iod->name);
 			return -ENOMEM;
 		}
 
+		mif_debug("iod 0x%p\n", iod);
+		vnet = netdev_priv(iod->ndev);
+		mif_debug("vnet 0x%p\n", vnet);
+		vnet->iod = iod;
+		skb_queue_head_init(&vnet->rx_q);
+		netif_napi_add(iod->ndev, &vnet->napi, vnet_poll,
+				VNET_NAPI_WEIGHT);
+
 		ret = register_netdev(iod->ndev);
 		if (ret) {
 			mif_info("%s: ERR! register_netdev fail\n", iod->name);
+			netif_napi_del(&vnet->napi);
 			free_netdev(iod->ndev);
+			iod->ndev = NULL;
 		}
 
-		mif_debug("iod 0x%p\n", iod);
-		vnet = netdev_priv(iod->ndev);
-		mif_debug("vnet 0x%p\n", vnet);
-		vnet->iod = iod;
-
 		break;
 
 	case IODEV_DUMMY:
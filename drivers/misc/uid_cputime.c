@@ -14,6 +14,7 @@
  */
 
 #include <linux/atomic.h>
+#include <linux/cpufreq_task_stats.h>
 #include <linux/err.h>
 #include <linux/hashtable.h>
 #include <linux/init.h>
@@ -21,26 +22,45 @@
 #include <linux/list.h>
 #include <linux/proc_fs.h>
 #include <linux/profile.h>
+#include <linux/rcupdate.h>
 #include <linux/sched.h>
 #include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/uaccess.h>
+#include <linux/uid_cputime.h>
 
 #define UID_HASH_BITS	10
-DECLARE_HASHTABLE(hash_table, UID_HASH_BITS);
+static DEFINE_HASHTABLE(hash_table, UID_HASH_BITS);
 
-static DEFINE_MUTEX(uid_lock);
+/*
+ * Entries are looked up under RCU from the tick, uid_lock only orders
+ * insertions and removals. Each entry's counters have a lock of their
+ * own, ticks of different cpus may charge the same uid.
+ */
+static DEFINE_SPINLOCK(uid_lock);
 static struct proc_dir_entry *parent;
 
+enum uid_state {
+	UID_STATE_FOREGROUND,
+	UID_STATE_BACKGROUND,
+	UID_STATE_COUNT,
+};
+
 struct uid_entry {
 	uid_t uid;
-	cputime_t utime;
-	cputime_t stime;
-	cputime_t active_utime;
-	cputime_t active_stime;
-	unsigned long long active_power;
-	unsigned long long power;
+	int state;
+	spinlock_t lock;
+	cputime_t utime[UID_STATE_COUNT];
+	cputime_t stime[UID_STATE_COUNT];
+	u64 read_bytes[UID_STATE_COUNT];
+	u64 write_bytes[UID_STATE_COUNT];
 	struct hlist_node hash;
+	struct rcu_head rcu;
+#ifdef CONFIG_CPU_FREQ_STAT_TASK
+	unsigned int max_state;
+	cputime_t time_in_state[0];
+#endif
 };
 
 static struct uid_entry *find_uid_entry(uid_t uid)
@@ -48,90 +68,125 @@ static struct uid_entry *find_uid_entry(uid_t uid)
 	struct uid_entry *uid_entry;
 	struct hlist_node *node;
 
-	hash_for_each_possible(hash_table, uid_entry, node, hash, uid) {
+	hash_for_each_possible_rcu(hash_table, uid_entry, node, hash, uid) {
 		if (uid_entry->uid == uid)
 			return uid_entry;
 	}
 	return NULL;
 }
 
+/* Called under rcu_read_lock(), from any context */
 static struct uid_entry *find_or_register_uid(uid_t uid)
 {
-	struct uid_entry *uid_entry;
+	struct uid_entry *uid_entry, *old;
+	unsigned int max_state = 0;
+	unsigned long flags;
 
 	uid_entry = find_uid_entry(uid);
 	if (uid_entry)
 		return uid_entry;
 
-	uid_entry = kzalloc(sizeof(struct uid_entry), GFP_ATOMIC);
+#ifdef CONFIG_CPU_FREQ_STAT_TASK
+	max_state = cpufreq_task_stats_nr_freqs();
+#endif
+	uid_entry = kzalloc(sizeof(struct uid_entry) +
+			    max_state * sizeof(cputime_t), GFP_ATOMIC);
 	if (!uid_entry)
 		return NULL;
 
 	uid_entry->uid = uid;
+	spin_lock_init(&uid_entry->lock);
+#ifdef CONFIG_CPU_FREQ_STAT_TASK
+	uid_entry->max_state = max_state;
+#endif
 
-	hash_add(hash_table, &uid_entry->hash, uid);
+	spin_lock_irqsave(&uid_lock, flags);
+	old = find_uid_entry(uid);
+	if (old) {
+		spin_unlock_irqrestore(&uid_lock, flags);
+		kfree(uid_entry);
+		return old;
+	}
+	hash_add_rcu(hash_table, &uid_entry->hash, uid);
+	spin_unlock_irqrestore(&uid_lock, flags);
 
 	return uid_entry;
 }
 
+/* Called with uid_entry->lock held, for the current task or an exiting one */
+static void uid_charge_io(struct uid_entry *uid_entry, struct task_struct *p)
+{
+#ifdef CONFIG_TASK_IO_ACCOUNTING
+	u64 read_bytes = p->ioac.read_bytes;
+	u64 write_bytes = p->ioac.write_bytes;
+
+	uid_entry->read_bytes[uid_entry->state] +=
+		read_bytes - p->uid_read_bytes;
+	uid_entry->write_bytes[uid_entry->state] +=
+		write_bytes - p->uid_write_bytes;
+	p->uid_read_bytes = read_bytes;
+	p->uid_write_bytes = write_bytes;
+#endif
+}
+
+void uid_cputime_account(struct task_struct *p, cputime_t cputime, bool user)
+{
+	struct uid_entry *uid_entry;
+	unsigned long flags;
+#ifdef CONFIG_CPU_FREQ_STAT_TASK
+	int index;
+#endif
+
+	rcu_read_lock();
+	uid_entry = find_or_register_uid(task_uid(p));
+	if (!uid_entry)
+		goto out;
+
+	spin_lock_irqsave(&uid_entry->lock, flags);
+	if (user)
+		uid_entry->utime[uid_entry->state] += cputime;
+	else
+		uid_entry->stime[uid_entry->state] += cputime;
+#ifdef CONFIG_CPU_FREQ_STAT_TASK
+	index = cpufreq_task_stats_index(task_cpu(p));
+	if (index >= 0 && index < uid_entry->max_state)
+		uid_entry->time_in_state[index] += cputime;
+#endif
+	uid_charge_io(uid_entry, p);
+	spin_unlock_irqrestore(&uid_entry->lock, flags);
+out:
+	rcu_read_unlock();
+}
+
+static inline unsigned long long uid_cputime_to_usecs(cputime_t time)
+{
+	return (unsigned long long)jiffies_to_msecs(cputime_to_jiffies(time)) *
+		USEC_PER_MSEC;
+}
+
 static int uid_stat_show(struct seq_file *m, void *v)
 {
 	struct uid_entry *uid_entry;
-	struct task_struct *task, *temp;
 	struct hlist_node *node;
-	cputime_t utime;
-	cputime_t stime;
+	cputime_t utime, stime;
 	unsigned long bkt;
 
-	mutex_lock(&uid_lock);
-
-	hash_for_each(hash_table, bkt, node, uid_entry, hash) {
-		uid_entry->active_stime = 0;
-		uid_entry->active_utime = 0;
-		uid_entry->active_power = 0;
-	}
-
-	read_lock(&tasklist_lock);
-	do_each_thread(temp, task) {
-		uid_entry = find_or_register_uid(task_uid(task));
-		if (!uid_entry) {
-			read_unlock(&tasklist_lock);
-			mutex_unlock(&uid_lock);
-			pr_err("%s: failed to find the uid_entry for uid %d\n",
-						__func__, task_uid(task));
-			return -ENOMEM;
-		}
-		/* if this task is exiting, we have already accounted for the
-		 * time and power. */
-#if 0 /* 3.0 fix */
-		if (task->cpu_power == ULLONG_MAX)
-			continue;
-#endif
-		task_times(task, &utime, &stime);
-		uid_entry->active_utime += utime;
-		uid_entry->active_stime += stime;
-#if 0 /* 3.0 fix */
-		uid_entry->active_power += task->cpu_power;
-#endif
-	} while_each_thread(temp, task);
-	read_unlock(&tasklist_lock);
-
-	hash_for_each(hash_table, bkt, node, uid_entry, hash) {
-		cputime_t total_utime = uid_entry->utime +
-							uid_entry->active_utime;
-		cputime_t total_stime = uid_entry->stime +
-							uid_entry->active_stime;
-		unsigned long long total_power = uid_entry->power +
-							uid_entry->active_power;
-		seq_printf(m, "%d: %llu %llu %llu\n", uid_entry->uid,
-				(unsigned long long)jiffies_to_msecs(
-					cputime_to_jiffies(total_utime)) * USEC_PER_MSEC,
-				(unsigned long long)jiffies_to_msecs(
-					cputime_to_jiffies(total_stime)) * USEC_PER_MSEC,
-				total_power);
+	rcu_read_lock();
+	hash_for_each_rcu(hash_table, bkt, node, uid_entry, hash) {
+		spin_lock_irq(&uid_entry->lock);
+		utime = uid_entry->utime[UID_STATE_FOREGROUND] +
+			uid_entry->utime[UID_STATE_BACKGROUND];
+		stime = uid_entry->stime[UID_STATE_FOREGROUND] +
+			uid_entry->stime[UID_STATE_BACKGROUND];
+		spin_unlock_irq(&uid_entry->lock);
+
+		/* the last column was the power of the 3.0 scheduler */
+		seq_printf(m, "%d: %llu %llu 0\n", uid_entry->uid,
+			   uid_cputime_to_usecs(utime),
+			   uid_cputime_to_usecs(stime));
 	}
+	rcu_read_unlock();
 
-	mutex_unlock(&uid_lock);
 	return 0;
 }
 
@@ -147,6 +202,134 @@ static const struct file_operations uid_stat_fops = {
 	.release	= single_release,
 };
 
+/*
+ * uid: state fg_utime fg_stime bg_utime bg_stime fg_read fg_write bg_read
+ * bg_write, times in microseconds and i/o in bytes.
+ */
+static int uid_state_show(struct seq_file *m, void *v)
+{
+	struct uid_entry *uid_entry;
+	struct hlist_node *node;
+	cputime_t utime[UID_STATE_COUNT], stime[UID_STATE_COUNT];
+	u64 read_bytes[UID_STATE_COUNT], write_bytes[UID_STATE_COUNT];
+	unsigned long bkt;
+	int i, state;
+
+	rcu_read_lock();
+	hash_for_each_rcu(hash_table, bkt, node, uid_entry, hash) {
+		spin_lock_irq(&uid_entry->lock);
+		state = uid_entry->state;
+		memcpy(utime, uid_entry->utime, sizeof(utime));
+		memcpy(stime, uid_entry->stime, sizeof(stime));
+		memcpy(read_bytes, uid_entry->read_bytes, sizeof(read_bytes));
+		memcpy(write_bytes, uid_entry->write_bytes,
+		       sizeof(write_bytes));
+		spin_unlock_irq(&uid_entry->lock);
+
+		seq_printf(m, "%d: %d", uid_entry->uid, state);
+		for (i = 0; i < UID_STATE_COUNT; i++)
+			seq_printf(m, " %llu %llu",
+				   uid_cputime_to_usecs(utime[i]),
+				   uid_cputime_to_usecs(stime[i]));
+		for (i = 0; i < UID_STATE_COUNT; i++)
+			seq_printf(m, " %llu %llu", read_bytes[i],
+				   write_bytes[i]);
+		seq_putc(m, '\n');
+	}
+	rcu_read_unlock();
+
+	return 0;
+}
+
+static int uid_state_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, uid_state_show, PDE(inode)->data);
+}
+
+/* "<uid> <state>", 0 for foreground and 1 for background */
+static ssize_t uid_state_write(struct file *file,
+			const char __user *buffer, size_t count, loff_t *ppos)
+{
+	struct uid_entry *uid_entry;
+	char input[32];
+	unsigned int uid;
+	int state;
+
+	if (count >= sizeof(input))
+		return -EINVAL;
+
+	if (copy_from_user(input, buffer, count))
+		return -EFAULT;
+	input[count] = '\0';
+
+	if (sscanf(input, "%u %d", &uid, &state) != 2 ||
+	    state < 0 || state >= UID_STATE_COUNT)
+		return -EINVAL;
+
+	rcu_read_lock();
+	uid_entry = find_or_register_uid(uid);
+	if (uid_entry) {
+		spin_lock_irq(&uid_entry->lock);
+		uid_entry->state = state;
+		spin_unlock_irq(&uid_entry->lock);
+	}
+	rcu_read_unlock();
+
+	return uid_entry ? count : -ENOMEM;
+}
+
+static const struct file_operations uid_state_fops = {
+	.open		= uid_state_open,
+	.read		= seq_read,
+	.write		= uid_state_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+#ifdef CONFIG_CPU_FREQ_STAT_TASK
+static int uid_time_in_state_show(struct seq_file *m, void *v)
+{
+	struct uid_entry *uid_entry;
+	struct hlist_node *node;
+	unsigned long bkt;
+	unsigned int i, max_state = cpufreq_task_stats_nr_freqs();
+
+	seq_puts(m, "uid:");
+	for (i = 0; i < max_state; i++)
+		seq_printf(m, " %u", cpufreq_task_stats_freq(i));
+	seq_putc(m, '\n');
+
+	rcu_read_lock();
+	hash_for_each_rcu(hash_table, bkt, node, uid_entry, hash) {
+		seq_printf(m, "%d:", uid_entry->uid);
+		for (i = 0; i < max_state; i++) {
+			cputime_t time = 0;
+
+			if (i < uid_entry->max_state)
+				time = uid_entry->time_in_state[i];
+			seq_printf(m, " %llu", (unsigned long long)
+				   cputime_to_clock_t(time));
+		}
+		seq_putc(m, '\n');
+	}
+	rcu_read_unlock();
+
+	return 0;
+}
+
+static int uid_time_in_state_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, uid_time_in_state_show, PDE(inode)->data);
+}
+
+static const struct file_operations uid_time_in_state_fops = {
+	.open		= uid_time_in_state_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
 static int uid_remove_open(struct inode *inode, struct file *file)
 {
 	return single_open(file, NULL, NULL);
@@ -179,17 +362,19 @@ static ssize_t uid_remove_write(struct file *file,
 		return -EINVAL;
 	}
 
-	mutex_lock(&uid_lock);
+	spin_lock_irq(&uid_lock);
 
 	for (; uid_start <= uid_end; uid_start++) {
 		hash_for_each_possible_safe(hash_table, uid_entry, node, tmp,
 							hash, uid_start) {
-			hash_del(&uid_entry->hash);
-			kfree(uid_entry);
+			if (uid_entry->uid != uid_start)
+				continue;
+			hash_del_rcu(&uid_entry->hash);
+			kfree_rcu(uid_entry, rcu);
 		}
 	}
 
-	mutex_unlock(&uid_lock);
+	spin_unlock_irq(&uid_lock);
 	return count;
 }
 
@@ -199,46 +384,37 @@ static const struct file_operations uid_remove_fops = {
 	.write		= uid_remove_write,
 };
 
+#ifdef CONFIG_TASK_IO_ACCOUNTING
+/* the i/o since the exiting task's last tick, its cpu time is all charged */
 static int process_notifier(struct notifier_block *self,
 			unsigned long cmd, void *v)
 {
 	struct task_struct *task = v;
 	struct uid_entry *uid_entry;
-	cputime_t utime, stime;
-	uid_t uid;
+	unsigned long flags;
 
 	if (!task)
 		return NOTIFY_OK;
 
-	mutex_lock(&uid_lock);
-	uid = task_uid(task);
-	uid_entry = find_or_register_uid(uid);
-	if (!uid_entry) {
-		pr_err("%s: failed to find uid %d\n", __func__, uid);
-		goto exit;
+	rcu_read_lock();
+	uid_entry = find_or_register_uid(task_uid(task));
+	if (uid_entry) {
+		spin_lock_irqsave(&uid_entry->lock, flags);
+		uid_charge_io(uid_entry, task);
+		spin_unlock_irqrestore(&uid_entry->lock, flags);
 	}
+	rcu_read_unlock();
 
-	task_times(task, &utime, &stime);
-	uid_entry->utime += utime;
-	uid_entry->stime += stime;
-#if 0 /* 3.0 fix */
-	uid_entry->power += task->cpu_power;
-	task->cpu_power = ULLONG_MAX;
-#endif
-
-exit:
-	mutex_unlock(&uid_lock);
 	return NOTIFY_OK;
 }
 
 static struct notifier_block process_notifier_block = {
 	.notifier_call	= process_notifier,
 };
+#endif
 
 static int __init proc_uid_cputime_init(void)
 {
-	hash_init(hash_table);
-
 	parent = proc_mkdir("uid_cputime", NULL);
 	if (!parent) {
 		pr_err("%s: failed to create proc entry\n", __func__);
@@ -251,7 +427,17 @@ static int __init proc_uid_cputime_init(void)
 	proc_create_data("show_uid_stat", S_IRUGO, parent, &uid_stat_fops,
 					NULL);
 
+	proc_create_data("uid_state", S_IRUGO | S_IWUSR, parent,
+					&uid_state_fops, NULL);
+
+#ifdef CONFIG_CPU_FREQ_STAT_TASK
+	proc_create_data("show_uid_time_in_state", S_IRUGO, parent,
+					&uid_time_in_state_fops, NULL);
+#endif
+
+#ifdef CONFIG_TASK_IO_ACCOUNTING
 	profile_event_register(PROFILE_TASK_EXIT, &process_notifier_block);
+#endif
 
 	return 0;
 }
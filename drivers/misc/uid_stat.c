@@ -16,9 +16,9 @@
 #include <asm/atomic.h>
 
 #include <linux/err.h>
+#include <linux/hashtable.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
-#include <linux/list.h>
 #include <linux/proc_fs.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
@@ -26,29 +26,28 @@
 #include <linux/uid_stat.h>
 #include <net/activity_stats.h>
 
+#define UID_HASH_BITS	8
+
+/* entries are never removed, uid_lock only orders insertions */
 static DEFINE_SPINLOCK(uid_lock);
-static LIST_HEAD(uid_list);
+static DEFINE_HASHTABLE(uid_hash, UID_HASH_BITS);
 static struct proc_dir_entry *parent;
 
 struct uid_stat {
-	struct list_head link;
+	struct hlist_node hash;
 	uid_t uid;
 	atomic_t tcp_rcv;
 	atomic_t tcp_snd;
 };
 
 static struct uid_stat *find_uid_stat(uid_t uid) {
-	unsigned long flags;
 	struct uid_stat *entry;
+	struct hlist_node *node;
 
-	spin_lock_irqsave(&uid_lock, flags);
-	list_for_each_entry(entry, &uid_list, link) {
-		if (entry->uid == uid) {
-			spin_unlock_irqrestore(&uid_lock, flags);
+	hash_for_each_possible_rcu(uid_hash, entry, node, hash, uid) {
+		if (entry->uid == uid)
 			return entry;
-		}
 	}
-	spin_unlock_irqrestore(&uid_lock, flags);
 	return NULL;
 }
 
@@ -92,7 +91,7 @@ static int tcp_rcv_read_proc(char *page, char **start, off_t off,
 static struct uid_stat *create_stat(uid_t uid) {
 	unsigned long flags;
 	char uid_s[32];
-	struct uid_stat *new_uid;
+	struct uid_stat *new_uid, *old;
 	struct proc_dir_entry *entry;
 
 	/* Create the uid stat struct and append it to the list. */
@@ -104,8 +103,15 @@ static struct uid_stat *create_stat(uid_t uid) {
 	atomic_set(&new_uid->tcp_rcv, INT_MIN);
 	atomic_set(&new_uid->tcp_snd, INT_MIN);
 
+	/* another sender of the same uid may have won the race */
 	spin_lock_irqsave(&uid_lock, flags);
-	list_add_tail(&new_uid->link, &uid_list);
+	old = find_uid_stat(uid);
+	if (old) {
+		spin_unlock_irqrestore(&uid_lock, flags);
+		kfree(new_uid);
+		return old;
+	}
+	hash_add_rcu(uid_hash, &new_uid->hash, uid);
 	spin_unlock_irqrestore(&uid_lock, flags);
 
 	sprintf(uid_s, "%d", uid);
@@ -169,6 +169,20 @@ enum {
 module_param(perdev_minors, int, 0444);
 MODULE_PARM_DESC(perdev_minors, "Minors numbers to allocate per device");
 
+/*
+ * A packed read costs an extra header write, so it only pays for a burst
+ * of small reads. Larger ones are issued on their own.
+ */
+static unsigned int packed_rd_sectors = 64;
+module_param(packed_rd_sectors, uint, 0644);
+MODULE_PARM_DESC(packed_rd_sectors, "Largest read in sectors to pack");
+
+static unsigned int packed_rd_min = 3;
+module_param(packed_rd_min, uint, 0644);
+MODULE_PARM_DESC(packed_rd_min, "Fewest queued reads worth a packed read");
+
+#define MMC_PACKED_BACKOFF	256	/* requests before packing again */
+
 static struct mmc_blk_data *mmc_blk_get(struct gendisk *disk)
 {
 	struct mmc_blk_data *md;
@@ -1403,6 +1417,52 @@ static void mmc_blk_rw_rq_prep(struct mmc_queue_req *mqrq,
 	mmc_queue_bounce_pre(mqrq);
 }
 
+/*
+ * Feed the time a completed transfer kept the bus busy into the cost
+ * averages of its direction. With requests pipelined, that is the time
+ * since it was issued or since the previous one completed, if later.
+ */
+static void mmc_blk_packed_account(struct mmc_queue *mq,
+				   struct mmc_queue_req *mq_rq)
+{
+	struct mmc_packed_stats *st =
+		&mq->packed_stats[rq_data_dir(mq_rq->req)];
+	ktime_t now = ktime_get();
+	ktime_t start = mq_rq->issue_time;
+	unsigned int sectors, cost;
+	s64 ns;
+
+	if (ktime_to_ns(mq->last_done) > ktime_to_ns(start))
+		start = mq->last_done;
+	mq->last_done = now;
+
+	if (mq_rq->packed_cmd != MMC_PACKED_NONE) {
+		sectors = mq_rq->packed_blocks;
+	} else {
+		sectors = mq_rq->brq.data.blocks;
+		/* only transfers that could have been packed compare */
+		if (sectors > packed_rd_sectors)
+			return;
+	}
+
+	ns = ktime_to_ns(ktime_sub(now, start));
+	if (!sectors || ns <= 0)
+		return;
+
+	cost = (unsigned int)min_t(s64, div_u64(ns, sectors), UINT_MAX / 8);
+
+	if (mq_rq->packed_cmd == MMC_PACKED_NONE) {
+		st->cost_single = st->cost_single ?
+			(st->cost_single * 7 + cost) / 8 : cost;
+		return;
+	}
+
+	st->cost_packed = st->cost_packed ?
+		(st->cost_packed * 7 + cost) / 8 : cost;
+	if (st->cost_single && st->cost_packed >= st->cost_single)
+		st->backoff = MMC_PACKED_BACKOFF;
+}
+
 static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
 {
 	struct request_queue *q = mq->queue;
@@ -1412,6 +1472,8 @@ static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
 	bool en_rel_wr = card->ext_csd.rel_param & EXT_CSD_WR_REL_PARAM_EN;
 	unsigned int req_sectors = 0, phys_segments = 0;
 	unsigned int max_blk_count, max_phys_segs;
+	struct mmc_packed_stats *stats;
+	struct request *prq, *tmp;
 	u8 put_back = 0;
 	u8 max_packed_rw = 0;
 	u8 reqs = 0;
@@ -1432,6 +1494,15 @@ static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
 	if (max_packed_rw == 0)
 		goto no_packed;
 
+	stats = &mq->packed_stats[rq_data_dir(cur)];
+	if (stats->backoff) {
+		stats->backoff--;
+		goto no_packed;
+	}
+
+	if (rq_data_dir(cur) == READ && blk_rq_sectors(cur) > packed_rd_sectors)
+		goto no_packed;
+
 #ifdef CONFIG_MMC_SELECTIVE_PACKED_CMD_POLICY
 	if (rq_data_dir(cur) == READ)
 		goto no_packed;
@@ -1495,6 +1566,12 @@ static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
 			break;
 		}
 
+		if (rq_data_dir(next) == READ &&
+				blk_rq_sectors(next) > packed_rd_sectors) {
+			put_back = 1;
+			break;
+		}
+
 		req_sectors += blk_rq_sectors(next);
 		if (req_sectors > max_blk_count) {
 			put_back = 1;
@@ -1518,6 +1595,18 @@ static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
 		spin_unlock_irq(q->queue_lock);
 	}
 
+	/* too few reads queued to pay for the header, give them back */
+	if (reqs > 0 && rq_data_dir(req) == READ && reqs + 1 < packed_rd_min) {
+		spin_lock_irq(q->queue_lock);
+		list_for_each_entry_safe_reverse(prq, tmp,
+				&mq->mqrq_cur->packed_list, queuelist) {
+			list_del_init(&prq->queuelist);
+			blk_requeue_request(q, prq);
+		}
+		spin_unlock_irq(q->queue_lock);
+		reqs = 0;
+	}
+
 	if (reqs > 0) {
 		list_add(&req->queuelist, &mq->mqrq_cur->packed_list);
 		mq->mqrq_cur->packed_num = ++reqs;
@@ -1854,6 +1943,7 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 #endif
 			else
 				mmc_blk_rw_rq_prep(mq->mqrq_cur, card, 0, mq);
+			mq->mqrq_cur->issue_time = ktime_get();
 			areq = &mq->mqrq_cur->mmc_active;
 		} else
 			areq = NULL;
@@ -1991,6 +2081,9 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 		}
 #endif
 
+		if (status == MMC_BLK_SUCCESS)
+			mmc_blk_packed_account(mq, mq_rq);
+
 		switch (status) {
 		case MMC_BLK_SUCCESS:
 		case MMC_BLK_PARTIAL:
@@ -2358,6 +2451,11 @@ static struct mmc_blk_data *mmc_blk_alloc_req(struct mmc_card *card,
 	     card->ext_csd.rel_sectors)) {
 		md->flags |= MMC_BLK_REL_WR;
 		blk_queue_flush(md->queue.queue, REQ_FLUSH | REQ_FUA);
+	} else if (mmc_card_mmc(card) &&
+		   (card->host->caps2 & MMC_CAP2_CACHE_CTRL) &&
+		   (card->ext_csd.cache_ctrl & 1)) {
+		/* writes are only durable once the card cache is flushed */
+		blk_queue_flush(md->queue.queue, REQ_FLUSH);
 	}
 
 	return md;
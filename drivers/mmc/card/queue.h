@@ -1,6 +1,8 @@
 #ifndef MMC_QUEUE_H
 #define MMC_QUEUE_H
 
+#include <linux/ktime.h>
+
 struct request;
 struct task_struct;
 
@@ -33,6 +35,18 @@ struct mmc_queue_req {
 	enum mmc_packed_cmd	packed_cmd;
 	int		packed_fail_idx;
 	u8		packed_num;
+	ktime_t		issue_time;
+};
+
+/*
+ * Measured cost of small transfers in one direction, as an average of
+ * ns per sector, issued on their own and packed. Packing is suspended
+ * for a while when it turns out no cheaper on this device.
+ */
+struct mmc_packed_stats {
+	unsigned int		cost_single;
+	unsigned int		cost_packed;
+	unsigned int		backoff;	/* requests left unpacked */
 };
 
 struct mmc_queue {
@@ -48,6 +62,8 @@ struct mmc_queue {
 	struct mmc_queue_req	*mqrq_prev;
 	/* Jiffies until which disable packed command. */
 	unsigned long		nopacked_period;
+	struct mmc_packed_stats	packed_stats[2];	/* READ, WRITE */
+	ktime_t			last_done;
 };
 
 extern int mmc_init_queue(struct mmc_queue *, struct mmc_card *, spinlock_t *,
@@ -169,6 +169,10 @@ mmc_start_request(struct mmc_host *host, struct mmc_request *mrq)
 
 	WARN_ON(!host->claimed);
 
+	/* anything written may sit in the card cache until the next flush */
+	if (mrq->data && (mrq->data->flags & MMC_DATA_WRITE) && host->card)
+		host->card->cache_dirty = 1;
+
 	mrq->cmd->error = 0;
 	mrq->cmd->mrq = mrq;
 	if (mrq->data) {
@@ -2343,7 +2347,9 @@ int mmc_card_can_sleep(struct mmc_host *host)
 EXPORT_SYMBOL(mmc_card_can_sleep);
 
 /*
- * Flush the cache to the non-volatile storage.
+ * Flush the cache to the non-volatile storage. Nothing is sent when no
+ * data was written since the last flush, so back-to-back flushes from
+ * different writers cost a single FLUSH_CACHE.
  */
 int mmc_flush_cache(struct mmc_card *card)
 {
@@ -2355,12 +2361,15 @@ int mmc_flush_cache(struct mmc_card *card)
 
 	if (mmc_card_mmc(card) &&
 			(card->ext_csd.cache_size > 0) &&
-			(card->ext_csd.cache_ctrl & 1)) {
+			(card->ext_csd.cache_ctrl & 1) &&
+			card->cache_dirty) {
 		err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
 				EXT_CSD_FLUSH_CACHE, 1, 0);
 		if (err)
 			pr_err("%s: cache flush error %d\n",
 					mmc_hostname(card->host), err);
+		else
+			card->cache_dirty = 0;
 	}
 
 	return err;
@@ -1479,6 +1479,8 @@ static int mmc_init_card(struct mmc_host *host, u32 ocr,
 			err = 0;
 		} else {
 			card->ext_csd.cache_ctrl = 1;
+			/* we cannot know what an earlier owner left behind */
+			card->cache_dirty = 1;
 		}
 	}
 
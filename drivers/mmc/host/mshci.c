@@ -53,6 +53,9 @@ static void mshci_set_clock(struct mshci_host *host,
 #define MSHCI_MAX_DMA_TRANS_SIZE	(0x400000)
 #define MSHCI_MAX_DMA_LIST		(MSHCI_MAX_DMA_TRANS_SIZE / \
 					 MSHCI_MAX_DMA_SINGLE_TRANS_SIZE)
+#define MSHCI_IDMA_TABLE_SIZE		(MSHCI_MAX_DMA_LIST * \
+					 sizeof(struct mshci_idmac))
+#define MSHCI_IDMA_TABLES		2
 
 static void mshci_dumpregs(struct mshci_host *host)
 {
@@ -452,11 +455,14 @@ static void mshci_set_mdma_desc(u8 *desc_vir, u8 *desc_phy,
 					sizeof(struct mshci_idmac);
 }
 
-static int mshci_mdma_table_pre(struct mshci_host *host,
-	struct mmc_data *data)
+/*
+ * Write the chained descriptors for the first sg_count entries of data
+ * into IDMAC table number table. The tables live in coherent memory, so
+ * a barrier before the controller is started is all that is needed.
+ */
+static void mshci_idma_build(struct mshci_host *host, struct mmc_data *data,
+	int sg_count, int table)
 {
-	int direction;
-
 	u8 *desc_vir, *desc_phy;
 	dma_addr_t addr;
 	int len;
@@ -466,6 +472,39 @@ static int mshci_mdma_table_pre(struct mshci_host *host,
 	u32 des_flag;
 	u32 size_idmac = sizeof(struct mshci_idmac);
 
+	desc_vir = host->idma_desc + table * MSHCI_IDMA_TABLE_SIZE;
+	desc_phy = (u8 *)host->idma_addr + table * MSHCI_IDMA_TABLE_SIZE;
+
+	for_each_sg(data->sg, sg, sg_count, i) {
+		addr = sg_dma_address(sg);
+		len = sg_dma_len(sg);
+
+		/* tran, valid */
+		des_flag = (MSHCI_IDMAC_OWN|MSHCI_IDMAC_CH);
+		des_flag |= (i == 0) ? MSHCI_IDMAC_FS : 0;
+
+		mshci_set_mdma_desc(desc_vir, desc_phy, des_flag, len, addr);
+		desc_vir += size_idmac;
+		desc_phy += size_idmac;
+
+		/*
+		 * If this triggers then we have a calculation bug
+		 * somewhere. :/
+		 */
+		WARN_ON(i >= MSHCI_MAX_DMA_LIST);
+	}
+
+	/*
+	* Add a terminating flag.
+	 */
+	((struct mshci_idmac *)(desc_vir-size_idmac))->des0 |= MSHCI_IDMAC_LD;
+}
+
+static int mshci_mdma_table_pre(struct mshci_host *host,
+	struct mmc_data *data)
+{
+	int direction;
+
 	if (data->flags & MMC_DATA_READ)
 		direction = DMA_FROM_DEVICE;
 	else
@@ -488,76 +527,25 @@ static int mshci_mdma_table_pre(struct mshci_host *host,
 		}
 
 		if (host->sg_count == 0)
-			goto fail;
+			return -EINVAL;
 	} else
 		host->sg_count = data->host_cookie;
 
-	desc_vir = host->idma_desc;
-
-	/* to know phy address */
-	host->idma_addr = dma_map_single(mmc_dev(host->mmc),
-				host->idma_desc,
-				/* cache flush for only transfer size */
-				(host->sg_count+1) * 16,
-				DMA_TO_DEVICE);
-	if (dma_mapping_error(mmc_dev(host->mmc), host->idma_addr))
-		goto unmap_entries;
-	BUG_ON(host->idma_addr & 0x3);
-
-	desc_phy = (u8 *)host->idma_addr;
-
-	for_each_sg(data->sg, sg, host->sg_count, i) {
-		addr = sg_dma_address(sg);
-		len = sg_dma_len(sg);
-
-		/* tran, valid */
-		des_flag = (MSHCI_IDMAC_OWN|MSHCI_IDMAC_CH);
-		des_flag |= (i == 0) ? MSHCI_IDMAC_FS : 0;
-
-		mshci_set_mdma_desc(desc_vir, desc_phy, des_flag, len, addr);
-		desc_vir += size_idmac;
-		desc_phy += size_idmac;
-
-		/*
-		 * If this triggers then we have a calculation bug
-		 * somewhere. :/
-		 */
-		WARN_ON((desc_vir - host->idma_desc) > MSHCI_MAX_DMA_LIST * \
-				size_idmac);
+	if (host->next_data.data == data) {
+		/* pre_req already wrote the descriptors */
+		host->idma_cur = host->next_data.table;
+		host->next_data.data = NULL;
+	} else {
+		/* keep off a table prepared for the following request */
+		if (host->next_data.data)
+			host->idma_cur = !host->next_data.table;
+		mshci_idma_build(host, data, host->sg_count, host->idma_cur);
 	}
 
-	/*
-	* Add a terminating flag.
-	 */
-	((struct mshci_idmac *)(desc_vir-size_idmac))->des0 |= MSHCI_IDMAC_LD;
-
-	/* it has to dma map again to resync vir data to phy data  */
-	host->idma_addr = dma_map_single(mmc_dev(host->mmc),
-				host->idma_desc,
-				/* cache flush for only transfer size */
-				(host->sg_count+1) * 16,
-				DMA_TO_DEVICE);
-	if (dma_mapping_error(mmc_dev(host->mmc), host->idma_addr))
-		goto unmap_entries;
-	BUG_ON(host->idma_addr & 0x3);
+	/* descriptors must be in memory before the IDMAC fetches them */
+	wmb();
 
 	return 0;
-
-unmap_entries:
-	if (host->ops->dma_unmap_sg && data->blocks >= 2048) {
-		/* if transfer size is bigger than 1MiB */
-		host->ops->dma_unmap_sg(host, mmc_dev(host->mmc),
-			data->sg, data->sg_len, direction, 2);
-	} else if (host->ops->dma_unmap_sg && data->blocks >= 128) {
-		/* if transfer size is bigger than 64KiB */
-		host->ops->dma_unmap_sg(host, mmc_dev(host->mmc),
-			data->sg, data->sg_len, direction, 1);
-	} else {
-		dma_unmap_sg(mmc_dev(host->mmc),
-			data->sg, data->sg_len, direction);
-	}
-fail:
-	return -EINVAL;
 }
 
 static void mshci_idma_table_post(struct mshci_host *host,
@@ -570,11 +558,6 @@ static void mshci_idma_table_post(struct mshci_host *host,
 	else
 		direction = DMA_TO_DEVICE;
 
-	dma_unmap_single(mmc_dev(host->mmc), host->idma_addr,
-				/* cache flush for only transfer size */
-				(host->sg_count+1) * 16,
-				DMA_TO_DEVICE);
-
 	if (!host->mmc->ops->post_req || !data->host_cookie) {
 		if (host->ops->dma_unmap_sg && data->blocks >= 2048) {
 			/* if transfer size is bigger than 1MiB */
@@ -670,7 +653,8 @@ check_done:
 			WARN_ON(1);
 			host->flags &= ~MSHCI_REQ_USE_DMA;
 		} else {
-			mshci_writel(host, host->idma_addr,
+			mshci_writel(host, host->idma_addr +
+				host->idma_cur * MSHCI_IDMA_TABLE_SIZE,
 				MSHCI_DBADDR);
 		}
 	}
@@ -1375,6 +1359,8 @@ static void mshci_pre_req(struct mmc_host *mmc, struct mmc_request *mrq,
 
 	if (data->host_cookie) {
 		data->host_cookie = 0;
+		if (host->next_data.data == data)
+			host->next_data.data = NULL;
 		goto out;
 	}
 
@@ -1421,10 +1407,23 @@ static void mshci_pre_req(struct mmc_host *mmc, struct mmc_request *mrq,
 			data->sg, data->sg_len, direction);
 	}
 
-	if (sg_count == 0)
+	if (sg_count == 0) {
 		data->host_cookie = 0;
-	else
-		data->host_cookie = sg_count;
+		goto out;
+	}
+
+	data->host_cookie = sg_count;
+
+	/*
+	 * Write the descriptors now as well, into the table the request
+	 * in flight is not using, so that starting this one only has to
+	 * point the IDMAC at them.
+	 */
+	if (host->flags & MSHCI_USE_IDMA) {
+		host->next_data.data = data;
+		host->next_data.table = !host->idma_cur;
+		mshci_idma_build(host, data, sg_count, host->next_data.table);
+	}
 out:
 	spin_unlock_irqrestore(&host->lock, host->sl_flags);
 	return;
@@ -1443,6 +1442,10 @@ static void mshci_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
 	if (!data)
 		goto out;
 
+	/* prepared but never started, e.g. on an aborted request */
+	if (host->next_data.data == data)
+		host->next_data.data = NULL;
+
 	if (data->flags & MMC_DATA_READ)
 		direction = DMA_FROM_DEVICE;
 	else
@@ -1999,11 +2002,15 @@ int mshci_add_host(struct mshci_host *host)
 
 	if (host->flags & MSHCI_USE_IDMA) {
 		/* We need to allocate descriptors for all sg entries
-		 * MSHCI_MAX_DMA_LIST transfer for each of those entries. */
-		host->idma_desc = kmalloc(MSHCI_MAX_DMA_LIST * \
-					sizeof(struct mshci_idmac), GFP_KERNEL);
+		 * MSHCI_MAX_DMA_LIST transfer for each of those entries,
+		 * twice over so that pre_req can fill one table while the
+		 * other is in use. */
+		host->idma_desc = dma_alloc_coherent(mmc_dev(mmc),
+					MSHCI_IDMA_TABLES * MSHCI_IDMA_TABLE_SIZE,
+					&host->idma_addr, GFP_KERNEL);
+		host->idma_cur = 0;
+		host->next_data.data = NULL;
 		if (!host->idma_desc) {
-			kfree(host->idma_desc);
 			printk(KERN_WARNING "%s: Unable to allocate IDMA "
 				"buffers. Falling back to standard DMA.\n",
 				mmc_hostname(mmc));
@@ -2213,7 +2220,10 @@ void mshci_remove_host(struct mshci_host *host, int dead)
 	tasklet_kill(&host->card_tasklet);
 	tasklet_kill(&host->finish_tasklet);
 
-	kfree(host->idma_desc);
+	if (host->idma_desc)
+		dma_free_coherent(mmc_dev(host->mmc),
+				  MSHCI_IDMA_TABLES * MSHCI_IDMA_TABLE_SIZE,
+				  host->idma_desc, host->idma_addr);
 
 	host->idma_desc = NULL;
 	host->align_buffer = NULL;
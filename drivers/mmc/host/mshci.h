@@ -384,10 +384,17 @@ struct mshci_host {
 
 	int			sg_count;	/* Mapped sg entries */
 
-	u8			*idma_desc;	/* ADMA descriptor table */
+	u8			*idma_desc;	/* ADMA descriptor tables */
 	u8			*align_buffer;	/* Bounce buffer */
 
-	dma_addr_t		idma_addr;	/* Mapped ADMA descr. table */
+	dma_addr_t		idma_addr;	/* Bus address of the tables */
+	int			idma_cur;	/* Table of the current req. */
+
+	struct {
+		struct mmc_data	*data;		/* Prepared by pre_req */
+		int		table;		/* Its descriptor table */
+	} next_data;
+
 	dma_addr_t		align_addr;	/* Mapped bounce buffer */
 
 	struct tasklet_struct	card_tasklet;	/* Tasklet structures */
@@ -606,7 +606,10 @@ static int __devinit sdhci_s3c_probe(struct platform_device *pdev)
 	 * transfers, not sure if this is a problem with this specific
 	 * SDHCI block, or a missing configuration that needs to be set. */
 	host->quirks |= SDHCI_QUIRK_NO_BUSY_IRQ;
-	
+
+	/* One interrupt per DMA data command, mostly for SDIO WLAN traffic */
+	host->quirks2 |= SDHCI_QUIRK2_COALESCE_CMD_IRQ;
+
 #ifdef CONFIG_WIMAX_CMC
 	/* This host supports the Auto CMD12 */
 	host->quirks |= SDHCI_QUIRK_MULTIBLOCK_READ_ACMD12;
@@ -45,6 +45,13 @@
 
 #define MAX_TUNING_LOOP 40
 
+/*
+ * Descriptors for all 128 sg entries and potentially one alignment
+ * transfer for each of those, 8 bytes apiece, plus the end.
+ */
+#define SDHCI_ADMA_SIZE		((128 * 2 + 1) * 8)
+#define SDHCI_ALIGN_SIZE	(128 * 4)
+
 static unsigned int debug_quirks = 0;
 
 static void sdhci_finish_data(struct sdhci_host *);
@@ -134,6 +141,27 @@ static void sdhci_clear_set_irqs(struct sdhci_host *host, u32 clear, u32 set)
 	ier |= set;
 	sdhci_writel(host, ier, SDHCI_INT_ENABLE);
 	sdhci_writel(host, ier, SDHCI_SIGNAL_ENABLE);
+	host->resp_irq_masked = 0;
+}
+
+/*
+ * With SDHCI_QUIRK2_COALESCE_CMD_IRQ a DMA data command raises no
+ * interrupt for its response, the status bit is still latched and gets
+ * handled together with the transfer complete one. Errors are signalled
+ * as usual. A stream of CMD53s sees half the interrupts that way.
+ */
+static void sdhci_set_resp_irq(struct sdhci_host *host, bool coalesce)
+{
+	u32 ier;
+
+	if (host->resp_irq_masked == coalesce)
+		return;
+
+	ier = sdhci_readl(host, SDHCI_INT_ENABLE);
+	if (coalesce)
+		ier &= ~SDHCI_INT_RESPONSE;
+	sdhci_writel(host, ier, SDHCI_SIGNAL_ENABLE);
+	host->resp_irq_masked = coalesce;
 }
 
 static void sdhci_unmask_irqs(struct sdhci_host *host, u32 irqs)
@@ -472,7 +500,7 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 	 */
 
 	host->align_addr = dma_map_single(mmc_dev(host->mmc),
-		host->align_buffer, 128 * 4, direction);
+		host->align_buffer, SDHCI_ALIGN_SIZE, direction);
 	if (dma_mapping_error(mmc_dev(host->mmc), host->align_addr))
 		goto fail;
 	BUG_ON(host->align_addr & 0x3);
@@ -531,7 +559,7 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 		 * If this triggers then we have a calculation bug
 		 * somewhere. :/
 		 */
-		WARN_ON((desc - host->adma_desc) > (128 * 2 + 1) * 4);
+		WARN_ON((desc - host->adma_desc) > SDHCI_ADMA_SIZE);
 	}
 
 	if (host->quirks & SDHCI_QUIRK_NO_ENDATTR_IN_NOPDESC) {
@@ -556,11 +584,11 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 	 */
 	if (data->flags & MMC_DATA_WRITE) {
 		dma_sync_single_for_device(mmc_dev(host->mmc),
-			host->align_addr, 128 * 4, direction);
+			host->align_addr, SDHCI_ALIGN_SIZE, direction);
 	}
 
 	host->adma_addr = dma_map_single(mmc_dev(host->mmc),
-		host->adma_desc, (128 * 2 + 1) * 4, DMA_TO_DEVICE);
+		host->adma_desc, SDHCI_ADMA_SIZE, DMA_TO_DEVICE);
 	if (dma_mapping_error(mmc_dev(host->mmc), host->adma_addr))
 		goto unmap_entries;
 	BUG_ON(host->adma_addr & 0x3);
@@ -572,7 +600,7 @@ unmap_entries:
 		data->sg_len, direction);
 unmap_align:
 	dma_unmap_single(mmc_dev(host->mmc), host->align_addr,
-		128 * 4, direction);
+		SDHCI_ALIGN_SIZE, direction);
 fail:
 	return -EINVAL;
 }
@@ -594,10 +622,10 @@ static void sdhci_adma_table_post(struct sdhci_host *host,
 		direction = DMA_TO_DEVICE;
 
 	dma_unmap_single(mmc_dev(host->mmc), host->adma_addr,
-		(128 * 2 + 1) * 4, DMA_TO_DEVICE);
+		SDHCI_ADMA_SIZE, DMA_TO_DEVICE);
 
 	dma_unmap_single(mmc_dev(host->mmc), host->align_addr,
-		128 * 4, direction);
+		SDHCI_ALIGN_SIZE, direction);
 
 	if (data->flags & MMC_DATA_READ) {
 		dma_sync_sg_for_cpu(mmc_dev(host->mmc), data->sg,
@@ -1031,6 +1059,10 @@ static void sdhci_send_command(struct sdhci_host *host, struct mmc_command *cmd)
 	if (cmd->data || (cmd->opcode == MMC_SEND_TUNING_BLOCK))
 		flags |= SDHCI_CMD_DATA;
 
+	if (host->quirks2 & SDHCI_QUIRK2_COALESCE_CMD_IRQ)
+		sdhci_set_resp_irq(host, cmd->data &&
+				   (host->flags & SDHCI_REQ_USE_DMA));
+
 	sdhci_writew(host, SDHCI_MAKE_CMD(cmd->opcode, flags), SDHCI_COMMAND);
 }
 
@@ -2546,8 +2578,8 @@ int sdhci_add_host(struct sdhci_host *host)
 		 * (128) and potentially one alignment transfer for
 		 * each of those entries.
 		 */
-		host->adma_desc = kmalloc((128 * 2 + 1) * 4, GFP_KERNEL);
-		host->align_buffer = kmalloc(128 * 4, GFP_KERNEL);
+		host->adma_desc = kmalloc(SDHCI_ADMA_SIZE, GFP_KERNEL);
+		host->align_buffer = kmalloc(SDHCI_ALIGN_SIZE, GFP_KERNEL);
 		if (!host->adma_desc || !host->align_buffer) {
 			kfree(host->adma_desc);
 			kfree(host->align_buffer);
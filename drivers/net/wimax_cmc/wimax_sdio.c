@@ -1778,7 +1778,7 @@ static void __exit adapter_deinit_module(void)
 	platform_driver_unregister(&wimax_driver);
 }
 
-module_init(adapter_init_module);
+deferred_module_init(adapter_init_module);
 module_exit(adapter_deinit_module);
 
 MODULE_AUTHOR(DRIVER_AUTHOR);
@@ -26,6 +26,9 @@
 #include <linux/workqueue.h>
 #include <linux/proc_fs.h>
 #include <linux/android_alarm.h>
+#ifdef CONFIG_HAS_EARLYSUSPEND
+#include <linux/earlysuspend.h>
+#endif
 #include <plat/adc.h>
 #include <linux/power/sec_battery_u1.h>
 
@@ -35,6 +38,14 @@
 #define POLLING_INTERVAL	(40 * 1000)
 #endif				/* CONFIG_TARGET_LOCALE_NA */
 
+/*
+ * With the screen off and no cable nothing can overheat or finish
+ * charging, so the battery is sampled POLLING_IDLE_FACTOR times less
+ * often until it runs low.
+ */
+#define POLLING_IDLE_FACTOR	4
+#define POLLING_IDLE_MIN_SOC	15
+
 #ifdef SEC_BATTERY_INDEPEDENT_VF_CHECK
 #if defined(CONFIG_TARGET_LOCALE_NAATT)
 #define VF_CHECK_INTERVAL	(5 * 1000)
@@ -369,6 +380,11 @@ struct sec_bat_info {
 	struct delayed_work vf_check_work;
 #endif
 	int batt_tmu_status;
+
+	bool lcd_off;
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	struct early_suspend early_suspend;
+#endif
 };
 
 static char *supply_list[] = {
@@ -1656,6 +1672,49 @@ static int sec_bat_enable_charging(struct sec_bat_info *info, bool enable)
 		return sec_bat_enable_charging_main(info, enable);
 }
 
+static bool sec_bat_is_idle(struct sec_bat_info *info)
+{
+	return info->lcd_off && info->cable_type == CABLE_TYPE_NONE &&
+		info->batt_health == POWER_SUPPLY_HEALTH_GOOD &&
+		info->batt_soc > POLLING_IDLE_MIN_SOC;
+}
+
+static unsigned int sec_bat_polling_interval(struct sec_bat_info *info)
+{
+	if (sec_bat_is_idle(info))
+		return info->polling_interval * POLLING_IDLE_FACTOR;
+
+	return info->polling_interval;
+}
+
+#ifdef SEC_BATTERY_INDEPEDENT_VF_CHECK
+/* without a cable a battery removal takes the power with it anyway */
+static unsigned int sec_bat_vf_check_interval(struct sec_bat_info *info)
+{
+	if (sec_bat_is_idle(info))
+		return max_t(unsigned int, VF_CHECK_INTERVAL,
+			     sec_bat_polling_interval(info));
+
+	return VF_CHECK_INTERVAL;
+}
+#endif
+
+/* back to the short intervals at once when the idle condition ends */
+static void sec_bat_polling_restart(struct sec_bat_info *info)
+{
+	if (info->initial_check_count)
+		return;
+
+	cancel_delayed_work(&info->polling_work);
+	schedule_delayed_work(&info->polling_work,
+			msecs_to_jiffies(sec_bat_polling_interval(info)));
+#ifdef SEC_BATTERY_INDEPEDENT_VF_CHECK
+	cancel_delayed_work(&info->vf_check_work);
+	schedule_delayed_work(&info->vf_check_work,
+			msecs_to_jiffies(sec_bat_vf_check_interval(info)));
+#endif
+}
+
 static void sec_bat_cable_work(struct work_struct *work)
 {
 	struct sec_bat_info *info = container_of(work, struct sec_bat_info,
@@ -1694,6 +1753,9 @@ static void sec_bat_cable_work(struct work_struct *work)
 	power_supply_changed(&info->psy_ac);
 	power_supply_changed(&info->psy_usb);
 
+	if (info->cable_type != CABLE_TYPE_NONE)
+		sec_bat_polling_restart(info);
+
 	wake_unlock(&info->cable_wake_lock);
 }
 
@@ -2322,7 +2384,7 @@ static void sec_bat_vf_check_work(struct work_struct *work)
 	}
 
 	schedule_delayed_work(&info->vf_check_work,
-			      msecs_to_jiffies(VF_CHECK_INTERVAL));
+			      msecs_to_jiffies(sec_bat_vf_check_interval(info)));
 }
 #endif
 
@@ -2339,9 +2401,28 @@ static void sec_bat_polling_work(struct work_struct *work)
 		info->initial_check_count--;
 	} else
 		schedule_delayed_work(&info->polling_work,
-				      msecs_to_jiffies(info->polling_interval));
+			msecs_to_jiffies(sec_bat_polling_interval(info)));
+}
+
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static void sec_bat_early_suspend(struct early_suspend *h)
+{
+	struct sec_bat_info *info =
+		container_of(h, struct sec_bat_info, early_suspend);
+
+	info->lcd_off = true;
 }
 
+static void sec_bat_late_resume(struct early_suspend *h)
+{
+	struct sec_bat_info *info =
+		container_of(h, struct sec_bat_info, early_suspend);
+
+	info->lcd_off = false;
+	sec_bat_polling_restart(info);
+}
+#endif
+
 #define SEC_BATTERY_ATTR(_name)			\
 {						\
 	.attr = { .name = #_name,		\
@@ -3303,6 +3384,13 @@ static __devinit int sec_bat_probe(struct platform_device *pdev)
 	schedule_delayed_work(&info->vf_check_work, 0);
 #endif
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	info->early_suspend.level = EARLY_SUSPEND_LEVEL_DISABLE_FB + 1;
+	info->early_suspend.suspend = sec_bat_early_suspend;
+	info->early_suspend.resume = sec_bat_late_resume;
+	register_early_suspend(&info->early_suspend);
+#endif
+
 #if defined(CONFIG_MACH_Q1_BD)
 	if (pdata->initial_check)
 		pdata->initial_check();
@@ -3335,6 +3423,10 @@ static int __devexit sec_bat_remove(struct platform_device *pdev)
 
 	remove_proc_entry("batt_info_proc", NULL);
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	unregister_early_suspend(&info->early_suspend);
+#endif
+
 	flush_workqueue(info->monitor_wqueue);
 	destroy_workqueue(info->monitor_wqueue);
 
@@ -3380,11 +3472,11 @@ static int sec_bat_resume(struct device *dev)
 	queue_work(info->monitor_wqueue, &info->monitor_work);
 
 	schedule_delayed_work(&info->polling_work,
-			      msecs_to_jiffies(info->polling_interval));
+			msecs_to_jiffies(sec_bat_polling_interval(info)));
 
 #ifdef SEC_BATTERY_INDEPEDENT_VF_CHECK
 	schedule_delayed_work(&info->vf_check_work,
-			      msecs_to_jiffies(VF_CHECK_INTERVAL));
+			msecs_to_jiffies(sec_bat_vf_check_interval(info)));
 #endif
 
 	return 0;
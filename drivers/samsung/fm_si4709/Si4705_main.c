@@ -865,7 +865,7 @@ void __exit Si4709_driver_exit(void)
 	misc_deregister(&Si4709_misc_device);
 }
 
-module_init(Si4709_driver_init);
+deferred_module_init(Si4709_driver_init);
 module_exit(Si4709_driver_exit);
 MODULE_AUTHOR("Varun Mahajan <m.varun@samsung.com>");
 MODULE_DESCRIPTION("Si4709 FM tuner driver");
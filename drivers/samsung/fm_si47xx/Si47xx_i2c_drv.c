@@ -760,7 +760,7 @@ void __exit Si47xx_i2c_drv_exit(void)
 	misc_deregister(&Si47xx_misc_device);
 }
 
-module_init(Si47xx_i2c_drv_init);
+deferred_module_init(Si47xx_i2c_drv_init);
 module_exit(Si47xx_i2c_drv_exit);
 MODULE_AUTHOR("ashton seo <ashton.seo@samsung.com>");
 MODULE_DESCRIPTION("Si47xx FM tuner driver");
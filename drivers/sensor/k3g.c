@@ -89,6 +89,8 @@
 /* max and min entry */
 #define MAX_ENTRY	20
 #define MAX_DELAY	(MAX_ENTRY * 9523809LL)
+/* batched watermark limit, the overrun check below needs some slack */
+#define MAX_BATCH_ENTRY	24
 
 #define K3G_MAJOR	102
 #define K3G_MINOR	4
@@ -138,6 +140,9 @@ struct k3g_data {
 	bool fifo_test;		/* is self_test or not? */
 	bool interruptible;	/* interrupt or polling? */
 	int entries;		/* number of fifo entries */
+	int batch;		/* report periods drained per interrupt */
+	u64 max_latency;	/* batching latency in ns, 0 for none */
+	ktime_t stamp;		/* time of the newest fifo entry */
 	int dps;		/* scale selection */
 	u8 fifo_data[sizeof(struct k3g_t) * 32]; /* fifo data entries */
 	u8 ctrl_regs[5];	/* saving register settings */
@@ -169,8 +174,8 @@ static int k3g_restart_fifo(struct k3g_data *k3g_data)
 		return res;
 	}
 
-	res = i2c_smbus_write_byte_data(k3g_data->client,
-			FIFO_CTRL_REG, FIFO_MODE | (k3g_data->entries - 1));
+	res = i2c_smbus_write_byte_data(k3g_data->client, FIFO_CTRL_REG,
+			FIFO_MODE | (k3g_data->entries * k3g_data->batch - 1));
 
 	if (res < 0)
 		pr_err("%s : failed to set fifo_mode\n", __func__);
@@ -197,6 +202,7 @@ static int k3g_read_gyro_values(struct i2c_client *client,
 	int err;
 	int len = sizeof(*data) * (total_read ? (total_read - 1) : 1);
 	struct k3g_data *k3g_data = i2c_get_clientdata(client);
+	u8 *last = k3g_data->fifo_data;
 	struct i2c_msg msg[2];
 	u8 reg_buf;
 
@@ -216,6 +222,12 @@ static int k3g_read_gyro_values(struct i2c_client *client,
 		err = i2c_transfer(client->adapter, msg, 2);
 		if (err != 2)
 			return (err < 0) ? err : -EIO;
+
+		/* keep the older entries for batched reporting */
+		if (len + sizeof(*data) <= sizeof(k3g_data->fifo_data)) {
+			last += len;
+			msg[1].buf = last;
+		}
 	}
 
 	reg_buf = AXISDATA_REG;
@@ -230,20 +242,38 @@ static int k3g_read_gyro_values(struct i2c_client *client,
 	if (err != 2)
 		return (err < 0) ? err : -EIO;
 
-	data->y = (k3g_data->fifo_data[1] << 8) | k3g_data->fifo_data[0];
-	data->z = (k3g_data->fifo_data[3] << 8) | k3g_data->fifo_data[2];
-	data->x = (k3g_data->fifo_data[5] << 8) | k3g_data->fifo_data[4];
+	data->y = (last[1] << 8) | last[0];
+	data->z = (last[3] << 8) | last[2];
+	data->x = (last[5] << 8) | last[4];
 
 	return 0;
 }
 
+static void k3g_report_sample(struct k3g_data *k3g_data, struct k3g_t *data,
+				ktime_t timestamp)
+{
+	input_set_timestamp(k3g_data->input_dev, timestamp);
+	#if defined(CONFIG_MACH_U1_NA_SPR) \
+	|| defined(CONFIG_MACH_U1_NA_USCC)
+	input_report_rel(k3g_data->input_dev, REL_RX, -data->x);
+	input_report_rel(k3g_data->input_dev, REL_RY, -data->y);
+	#else
+	input_report_rel(k3g_data->input_dev, REL_RX, data->x);
+	input_report_rel(k3g_data->input_dev, REL_RY, data->y);
+	#endif
+	input_report_rel(k3g_data->input_dev, REL_RZ, data->z);
+	input_sync(k3g_data->input_dev);
+}
+
 static int k3g_report_gyro_values(struct k3g_data *k3g_data)
 {
-	int res;
-	struct k3g_t data;
+	int res, i, n;
+	int wanted = k3g_data->entries * k3g_data->batch;
+	int total = wanted + k3g_data->drop_next_event;
+	struct k3g_t data, older;
+	u8 *buf;
 
-	res = k3g_read_gyro_values(k3g_data->client, &data,
-				k3g_data->entries + k3g_data->drop_next_event);
+	res = k3g_read_gyro_values(k3g_data->client, &data, total);
 	if (res < 0)
 		return res;
 
@@ -251,7 +281,7 @@ static int k3g_report_gyro_values(struct k3g_data *k3g_data)
 
 	k3g_data->drop_next_event = !res;
 
-	if (res >= 31 - k3g_data->entries) {
+	if (res >= 31 - wanted) {
 		/* reset fifo to start again - data isn't trustworthy,
 		 * our locked read might not have worked and we
 		 * could have done i2c read in mid register update
@@ -259,16 +289,19 @@ static int k3g_report_gyro_values(struct k3g_data *k3g_data)
 		return k3g_restart_fifo(k3g_data);
 	}
 
-	#if defined(CONFIG_MACH_U1_NA_SPR) \
-	|| defined(CONFIG_MACH_U1_NA_USCC)
-	input_report_rel(k3g_data->input_dev, REL_RX, -data.x);
-	input_report_rel(k3g_data->input_dev, REL_RY, -data.y);
-	#else
-	input_report_rel(k3g_data->input_dev, REL_RX, data.x);
-	input_report_rel(k3g_data->input_dev, REL_RY, data.y);
-	#endif
-	input_report_rel(k3g_data->input_dev, REL_RZ, data.z);
-	input_sync(k3g_data->input_dev);
+	/* the last entry of each earlier report period of a batch */
+	for (n = 1; n < k3g_data->batch; n++) {
+		i = total - 1 - (k3g_data->batch - n) * k3g_data->entries;
+		buf = k3g_data->fifo_data + i * sizeof(struct k3g_t);
+		older.x = (buf[1] << 8) | buf[0];
+		older.y = (buf[3] << 8) | buf[2];
+		older.z = (buf[5] << 8) | buf[4];
+		k3g_report_sample(k3g_data, &older,
+			ktime_sub_ns(k3g_data->stamp, (u64)(total - 1 - i) *
+					k3g_data->time_to_read));
+	}
+
+	k3g_report_sample(k3g_data, &data, k3g_data->stamp);
 
 	return res;
 }
@@ -286,6 +319,7 @@ static void k3g_work_func(struct work_struct *work)
 	struct k3g_data *k3g_data = container_of(work, struct k3g_data, work);
 
 	do {
+		k3g_data->stamp = ktime_get();
 		res = k3g_read_fifo_status(k3g_data);
 		if (res < 0)
 			return;
@@ -308,6 +342,14 @@ timer_set:
 		k3g_data->polling_delay, HRTIMER_MODE_REL);
 }
 
+static irqreturn_t k3g_interrupt(int irq, void *k3g_data_p)
+{
+	struct k3g_data *k3g_data = k3g_data_p;
+
+	k3g_data->stamp = ktime_get();
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t k3g_interrupt_thread(int irq, void *k3g_data_p)
 {
 	int res;
@@ -469,6 +511,22 @@ unlock:
 	return err ? err : size;
 }
 
+/* drain as many report periods per interrupt as max_latency allows */
+static void k3g_update_batch(struct k3g_data *k3g_data)
+{
+	u64 period = (u64)k3g_data->time_to_read * k3g_data->entries;
+	u64 periods = k3g_data->max_latency;
+
+	k3g_data->batch = 1;
+	if (!k3g_data->interruptible || !period)
+		return;
+
+	do_div(periods, period);
+	if (periods > 1)
+		k3g_data->batch = min_t(u64, periods,
+				MAX_BATCH_ENTRY / k3g_data->entries);
+}
+
 static ssize_t k3g_show_delay(struct device *dev,
 			struct device_attribute *attr, char *buf)
 {
@@ -532,6 +590,8 @@ static ssize_t k3g_set_delay(struct device *dev,
 						CTRL_REG1, ctrl);
 	}
 
+	k3g_update_batch(k3g_data);
+
 	/* (re)start fifo */
 	k3g_restart_fifo(k3g_data);
 
@@ -549,10 +609,44 @@ static ssize_t k3g_set_delay(struct device *dev,
 	return size;
 }
 
+static ssize_t k3g_show_max_latency(struct device *dev,
+			struct device_attribute *attr, char *buf)
+{
+	struct k3g_data *k3g_data  = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%lld\n", k3g_data->max_latency);
+}
+
+static ssize_t k3g_set_max_latency(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t size)
+{
+	struct k3g_data *k3g_data  = dev_get_drvdata(dev);
+	u64 latency;
+	int res;
+
+	res = kstrtoull(buf, 10, &latency);
+	if (res < 0)
+		return res;
+
+	mutex_lock(&k3g_data->lock);
+	k3g_data->max_latency = latency;
+	if (k3g_data->interruptible) {
+		disable_irq(k3g_data->client->irq);
+		k3g_update_batch(k3g_data);
+		k3g_restart_fifo(k3g_data);
+		enable_irq(k3g_data->client->irq);
+	}
+	mutex_unlock(&k3g_data->lock);
+
+	return size;
+}
+
 static DEVICE_ATTR(enable, S_IRUGO | S_IWUSR | S_IWGRP,
 			k3g_show_enable, k3g_set_enable);
 static DEVICE_ATTR(poll_delay, S_IRUGO | S_IWUSR | S_IWGRP,
 			k3g_show_delay, k3g_set_delay);
+static DEVICE_ATTR(max_latency, S_IRUGO | S_IWUSR | S_IWGRP,
+			k3g_show_max_latency, k3g_set_max_latency);
 
 
 /*************************************************************************/
@@ -1116,9 +1210,10 @@ static int k3g_probe(struct i2c_client *client,
 	i2c_set_clientdata(client, data);
 	dev_set_drvdata(&input_dev->dev, data);
 
+	data->batch = 1;
 	if (data->client->irq >= 0) { /* interrupt */
 		data->interruptible = true;
-		err = request_threaded_irq(data->client->irq, NULL,
+		err = request_threaded_irq(data->client->irq, k3g_interrupt,
 			k3g_interrupt_thread, IRQF_TRIGGER_HIGH | IRQF_ONESHOT,
 				"k3g", data);
 		if (err < 0) {
@@ -1165,6 +1260,13 @@ static int k3g_probe(struct i2c_client *client,
 		goto err_device_create_file2;
 	}
 
+	if (device_create_file(&input_dev->dev,
+				&dev_attr_max_latency) < 0) {
+		pr_err("%s: Failed to create device file(%s)!\n", __func__,
+				dev_attr_max_latency.attr.name);
+		goto err_device_create_file_latency;
+	}
+
 	/* register a char dev */
 	err = register_chrdev(K3G_MAJOR, "k3g", &k3g_fops);
 	if (err < 0) {
@@ -1239,6 +1341,8 @@ err_device_create:
 err_class_create:
 	unregister_chrdev(K3G_MAJOR, "k3g");
 err_register_chrdev:
+	device_remove_file(&input_dev->dev, &dev_attr_max_latency);
+err_device_create_file_latency:
 	device_remove_file(&input_dev->dev, &dev_attr_poll_delay);
 err_device_create_file2:
 	device_remove_file(&input_dev->dev, &dev_attr_enable);
@@ -1275,6 +1379,7 @@ static int k3g_remove(struct i2c_client *client)
 	unregister_chrdev(K3G_MAJOR, "k3g");
 	device_remove_file(&k3g_data->input_dev->dev, &dev_attr_enable);
 	device_remove_file(&k3g_data->input_dev->dev, &dev_attr_poll_delay);
+	device_remove_file(&k3g_data->input_dev->dev, &dev_attr_max_latency);
 
 	if (k3g_data->enable)
 		err = i2c_smbus_write_byte_data(k3g_data->client,
@@ -81,6 +81,8 @@ enum {
 #define CALIBRATION_FILE_PATH	"/efs/calibration_data"
 #endif
 #define CAL_DATA_AMOUNT	20
+/* fifo entries collected per batched poll, out of FIFO_DEPTH */
+#define FIFO_BATCH_ENTRY	28
 
 static const struct odr_delay {
 	u8 odr; /* odr reg setting */
@@ -127,12 +129,33 @@ struct lsm330dlc_accel_data {
 	struct work_struct work;
 	struct workqueue_struct *work_queue;
 	struct hrtimer timer;
+	ktime_t timer_delay;	/* poll_delay times batch */
+	u64 max_latency;	/* batching latency in ns, 0 for none */
+	int batch;		/* poll periods drained from the fifo at once */
+	ktime_t last_report;
+	u8 fifo_data[FIFO_DEPTH * 6];
 #endif
 	int position;
 	struct lsm330dlc_acc acc_xyz;
 	bool axis_adjust;
 };
 
+static void lsm330dlc_accel_unpack(const u8 *acc_data,
+				struct lsm330dlc_acc *acc)
+{
+	acc->x = (acc_data[1] << 8) | acc_data[0];
+	acc->y = (acc_data[3] << 8) | acc_data[2];
+	acc->z = (acc_data[5] << 8) | acc_data[4];
+
+	acc->x = acc->x >> 4;
+	acc->y = acc->y >> 4;
+	acc->z = acc->z >> 4;
+
+#if defined(CONFIG_MACH_M3_JPN_DCM)
+	acc->y = -acc->y;
+#endif
+}
+
  /* Read X,Y and Z-axis acceleration raw data */
 static int lsm330dlc_accel_read_raw_xyz(struct lsm330dlc_accel_data *data,
 				struct lsm330dlc_acc *acc)
@@ -149,17 +172,7 @@ static int lsm330dlc_accel_read_raw_xyz(struct lsm330dlc_accel_data *data,
 		return -EIO;
 	}
 
-	acc->x = (acc_data[1] << 8) | acc_data[0];
-	acc->y = (acc_data[3] << 8) | acc_data[2];
-	acc->z = (acc_data[5] << 8) | acc_data[4];
-
-	acc->x = acc->x >> 4;
-	acc->y = acc->y >> 4;
-	acc->z = acc->z >> 4;
-
-#if defined(CONFIG_MACH_M3_JPN_DCM)
-	acc->y = -acc->y;
-#endif
+	lsm330dlc_accel_unpack(acc_data, acc);
 
 	return 0;
 }
@@ -292,6 +305,56 @@ static int lsm330dlc_accel_do_calibrate(struct device *dev, bool do_calib)
 	return err;
 }
 
+#ifdef USES_INPUT_DEV
+static u64 lsm330dlc_accel_odr_ns(struct lsm330dlc_accel_data *data)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(odr_delay_table); i++)
+		if (odr_delay_table[i].odr ==
+				(data->ctrl_reg1_shadow & ODR_MASK))
+			return odr_delay_table[i].delay_ns;
+	return 0;
+}
+
+/*
+ * With a max_latency of several poll periods the samples are left to queue
+ * up in the fifo, in stream mode, and the timer only fires once per batch.
+ * The fifo holds FIFO_DEPTH samples at the current odr, which bounds the
+ * batch. Called with write_lock held and the timer stopped.
+ */
+static int lsm330dlc_accel_setup_fifo(struct lsm330dlc_accel_data *data)
+{
+	u64 poll_ns = ktime_to_ns(data->poll_delay);
+	u64 periods = data->max_latency;
+	u64 room = lsm330dlc_accel_odr_ns(data) * FIFO_BATCH_ENTRY;
+	int err;
+
+	data->batch = 1;
+	if (poll_ns && periods) {
+		do_div(periods, poll_ns);
+		do_div(room, poll_ns);
+		data->batch = clamp_t(u64, min(periods, room), 1, INT_MAX);
+	}
+	data->timer_delay = ns_to_ktime(poll_ns * data->batch);
+	data->last_report = ktime_set(0, 0);
+
+	/* going through bypass mode empties the fifo */
+	err = i2c_smbus_write_byte_data(data->client, FIFO_CTRL_REG,
+					BYPASS_MODE);
+	if (!err && data->batch > 1)
+		err = i2c_smbus_write_byte_data(data->client, FIFO_CTRL_REG,
+						STREAM_MODE);
+	if (!err)
+		err = i2c_smbus_write_byte_data(data->client, CTRL_REG5,
+					data->batch > 1 ? FIFO_EN : 0);
+	if (err)
+		pr_err("%s: i2c write fifo setting failed\n", __func__);
+
+	return err;
+}
+#endif
+
 static int lsm330dlc_accel_enable(struct lsm330dlc_accel_data *data)
 {
 	int err = 0;
@@ -313,7 +376,9 @@ static int lsm330dlc_accel_enable(struct lsm330dlc_accel_data *data)
 		if (err)
 			pr_err("%s: i2c write ctrl_reg4 failed\n", __func__);
 #ifdef USES_INPUT_DEV
-		hrtimer_start(&data->timer, data->poll_delay, HRTIMER_MODE_REL);
+		lsm330dlc_accel_setup_fifo(data);
+		hrtimer_start(&data->timer, data->timer_delay,
+			HRTIMER_MODE_REL);
 #endif
 	}
 
@@ -378,8 +443,10 @@ static int lsm330dlc_accel_set_delay(struct lsm330dlc_accel_data *data
 	 */
 	mutex_lock(&data->write_lock);
 #ifdef USES_INPUT_DEV
-	if (atomic_read(&data->opened))
+	if (atomic_read(&data->opened)) {
 		hrtimer_cancel(&data->timer);
+		cancel_work_sync(&data->work);
+	}
 #endif
 
 	for (i = 0; i < ARRAY_SIZE(odr_delay_table); i++) {
@@ -405,9 +472,11 @@ static int lsm330dlc_accel_set_delay(struct lsm330dlc_accel_data *data
 	}
 
 #ifdef USES_INPUT_DEV
-	if (atomic_read(&data->opened))
-		hrtimer_start(&data->timer, data->poll_delay,
+	if (atomic_read(&data->opened)) {
+		lsm330dlc_accel_setup_fifo(data);
+		hrtimer_start(&data->timer, data->timer_delay,
 			HRTIMER_MODE_REL);
+	}
 #endif
 	mutex_unlock(&data->write_lock);
 	return err;
@@ -532,8 +601,11 @@ static int lsm330dlc_accel_resume(struct device *dev)
 		res = i2c_smbus_write_byte_data(data->client, CTRL_REG1,
 						data->ctrl_reg1_shadow);
 #ifdef USES_INPUT_DEV
+		mutex_lock(&data->write_lock);
+		lsm330dlc_accel_setup_fifo(data);
+		mutex_unlock(&data->write_lock);
 		hrtimer_start(&data->timer,
-				data->poll_delay, HRTIMER_MODE_REL);
+				data->timer_delay, HRTIMER_MODE_REL);
 #endif
 	}
 
@@ -860,14 +932,51 @@ static ssize_t lsm330dlc_enable_store(struct device *dev,
 	return count;
 }
 
+static ssize_t lsm330dlc_max_latency_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct lsm330dlc_accel_data *data = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%lld\n", data->max_latency);
+}
+
+static ssize_t lsm330dlc_max_latency_store(struct device *dev,
+	struct device_attribute *attr,
+	const char *buf, size_t count)
+{
+	struct lsm330dlc_accel_data *data = dev_get_drvdata(dev);
+	u64 latency;
+	int err;
+
+	err = kstrtoull(buf, 10, &latency);
+	if (err < 0)
+		return err;
+
+	mutex_lock(&data->write_lock);
+	data->max_latency = latency;
+	if (atomic_read(&data->opened)) {
+		hrtimer_cancel(&data->timer);
+		cancel_work_sync(&data->work);
+		lsm330dlc_accel_setup_fifo(data);
+		hrtimer_start(&data->timer, data->timer_delay,
+			HRTIMER_MODE_REL);
+	}
+	mutex_unlock(&data->write_lock);
+
+	return count;
+}
+
 static DEVICE_ATTR(poll_delay, 0644,
 	lsm330dlc_accel_delay_show, lsm330dlc_accel_delay_store);
 static DEVICE_ATTR(enable, 0644,
 	lsm330dlc_enable_show, lsm330dlc_enable_store);
+static DEVICE_ATTR(max_latency, 0644,
+	lsm330dlc_max_latency_show, lsm330dlc_max_latency_store);
 
 static struct attribute *lsm330dlc_sysfs_attrs[] = {
 	&dev_attr_enable.attr,
 	&dev_attr_poll_delay.attr,
+	&dev_attr_max_latency.attr,
 	NULL
 };
 
@@ -1004,19 +1113,15 @@ static enum hrtimer_restart lsm330dlc_timer_func(struct hrtimer *timer)
 	struct lsm330dlc_accel_data *data
 		= container_of(timer, struct lsm330dlc_accel_data, timer);
 	queue_work(data->work_queue, &data->work);
-	hrtimer_forward_now(&data->timer, data->poll_delay);
+	hrtimer_forward_now(&data->timer, data->timer_delay);
 	return HRTIMER_RESTART;
 }
 
-static void lsm330dlc_work_func(struct work_struct *work)
+static void lsm330dlc_accel_report(struct lsm330dlc_accel_data *data)
 {
-	struct lsm330dlc_accel_data *data
-		= container_of(work, struct lsm330dlc_accel_data, work);
 	s16 raw[3] = {0,}, accel_adjusted[3] = {0,};
 	int i, j;
 
-	lsm330dlc_accel_read_xyz(data, &data->acc_xyz);
-
 	if (data->axis_adjust) {
 		raw[0] = data->acc_xyz.x;
 		raw[1] = data->acc_xyz.y;
@@ -1040,6 +1145,73 @@ static void lsm330dlc_work_func(struct work_struct *work)
 		accel_adjusted[0], accel_adjusted[1], accel_adjusted[2]);
 #endif
 }
+
+/*
+ * Report what queued up in the fifo since the last batch. Entries are read
+ * in one burst, the address wraps from OUT_Z_H back to OUT_X_L, and are
+ * thinned out to roughly one per poll period since the odr is the next
+ * faster rate. The newest entry is taken to be from now.
+ */
+static void lsm330dlc_accel_drain_fifo(struct lsm330dlc_accel_data *data)
+{
+	u64 odr_ns = lsm330dlc_accel_odr_ns(data);
+	s64 gap = ktime_to_ns(data->poll_delay) - (s64)(odr_ns / 2);
+	struct i2c_client *client = data->client;
+	u8 reg = OUT_X_L | AC;
+	struct i2c_msg msg[2] = {
+		{ .addr = client->addr, .flags = 0, .len = 1, .buf = &reg },
+		{ .addr = client->addr, .flags = I2C_M_RD,
+		  .buf = data->fifo_data },
+	};
+	ktime_t now, timestamp;
+	int src, count, i, err;
+
+	mutex_lock(&data->read_lock);
+	now = ktime_get();
+	src = i2c_smbus_read_byte_data(client, FIFO_SRC_REG);
+	if (src < 0) {
+		mutex_unlock(&data->read_lock);
+		return;
+	}
+	count = (src & FIFO_OVRN) ? FIFO_DEPTH : (src & FIFO_FSS_MASK);
+	if (count) {
+		msg[1].len = count * 6;
+		err = i2c_transfer(client->adapter, msg, 2);
+		if (err != 2)
+			count = 0;
+	}
+	mutex_unlock(&data->read_lock);
+
+	for (i = 0; i < count; i++) {
+		timestamp = ktime_sub_ns(now, (count - 1 - i) * odr_ns);
+		if (ktime_to_ns(ktime_sub(timestamp, data->last_report)) < gap)
+			continue;
+		data->last_report = timestamp;
+
+		lsm330dlc_accel_unpack(data->fifo_data + i * 6,
+				&data->acc_xyz);
+		data->acc_xyz.x -= data->cal_data.x;
+		data->acc_xyz.y -= data->cal_data.y;
+		data->acc_xyz.z -= data->cal_data.z;
+
+		input_set_timestamp(data->input_dev, timestamp);
+		lsm330dlc_accel_report(data);
+	}
+}
+
+static void lsm330dlc_work_func(struct work_struct *work)
+{
+	struct lsm330dlc_accel_data *data
+		= container_of(work, struct lsm330dlc_accel_data, work);
+
+	if (data->batch > 1) {
+		lsm330dlc_accel_drain_fifo(data);
+		return;
+	}
+
+	lsm330dlc_accel_read_xyz(data, &data->acc_xyz);
+	lsm330dlc_accel_report(data);
+}
 #endif
 
 static int lsm330dlc_accel_probe(struct i2c_client *client,
@@ -1095,6 +1267,8 @@ probe_retry:
 	hrtimer_init(&data->timer,
 		CLOCK_MONOTONIC, HRTIMER_MODE_REL);
 	data->poll_delay = ns_to_ktime(200 * NSEC_PER_MSEC);
+	data->timer_delay = data->poll_delay;
+	data->batch = 1;
 	data->timer.function = lsm330dlc_timer_func;
 	data->work_queue =
 		create_singlethread_workqueue("lsm330dlc_workqueue");
@@ -103,6 +103,8 @@
 /* max and min entry */
 #define MAX_ENTRY	20
 #define MAX_DELAY	(MAX_ENTRY * 10000000LL) /* 200ms */
+/* fifo watermark limit when batching, leaves headroom below 32 */
+#define MAX_BATCH_ENTRY	30
 
 /* default register setting for device init */
 static const char default_ctrl_regs_bypass[] = {
@@ -164,6 +166,9 @@ struct lsm330dlc_gyro_data {
 	bool self_test;		/* is self_test or not? */
 	bool interruptible;	/* interrupt or polling? */
 	int entries;		/* number of fifo entries */
+	int batch;		/* report periods drained per interrupt */
+	u64 max_latency;	/* batching latency in ns, 0 for none */
+	ktime_t irq_time;	/* when the watermark interrupt fired */
 	int dps;		/* scale selection */
 	int sensitivity_value;
 	/* fifo data entries */
@@ -228,8 +233,8 @@ static int lsm330dlc_gyro_restart_fifo(struct lsm330dlc_gyro_data *data)
 		return res;
 	}
 
-	res = i2c_smbus_write_byte_data(data->client,
-			FIFO_CTRL_REG, FIFO_MODE | (data->entries - 1));
+	res = i2c_smbus_write_byte_data(data->client, FIFO_CTRL_REG,
+			FIFO_MODE | (data->entries * data->batch - 1));
 
 	if (res < 0)
 		pr_err("%s : failed to set fifo_mode\n", __func__);
@@ -278,48 +283,90 @@ static int lsm330dlc_gyro_read_values(struct i2c_client *client,
 	return 0;
 }
 
+/* burst read of @count fifo entries, the address wraps at OUT_Z_H */
+static int lsm330dlc_gyro_read_fifo(struct lsm330dlc_gyro_data *data,
+				int count)
+{
+	struct i2c_client *client = data->client;
+	struct i2c_msg msg[2];
+	u8 reg_buf = AXISDATA_REG | AC;
+	int err;
+
+	msg[0].addr = client->addr;
+	msg[0].buf = &reg_buf;
+	msg[0].flags = 0;
+	msg[0].len = 1;
+
+	msg[1].addr = client->addr;
+	msg[1].flags = I2C_M_RD;
+	msg[1].buf = data->fifo_data;
+	msg[1].len = sizeof(struct gyro_t) * count;
+
+	err = i2c_transfer(client->adapter, msg, 2);
+	if (err != 2)
+		return (err < 0) ? err : -EIO;
+
+	return 0;
+}
+
 static int lsm330dlc_gyro_report_values\
 	(struct lsm330dlc_gyro_data *data)
 {
-	int res, i, j;
-	s16 raw[3] = {0,}, gyro_adjusted[3] = {0,};
+	int res, i, j, n;
+	int total = data->entries * data->batch;
+	s16 raw[3], gyro_adjusted[3];
+	ktime_t timestamp;
+	u8 *buf;
 
-	res = lsm330dlc_gyro_read_values(data->client,
-		&data->xyz_data, data->entries);
+	res = lsm330dlc_gyro_read_fifo(data, total);
 	if (res < 0)
 		return res;
 
-	data->xyz_data.x -= data->cal_data.x;
-	data->xyz_data.y -= data->cal_data.y;
-	data->xyz_data.z -= data->cal_data.z;
-
-	if (data->axis_adjust) {
-		raw[0] = data->xyz_data.x;
-		raw[1] = data->xyz_data.y;
-		raw[2] = data->xyz_data.z;
-		for (i = 0; i < 3; i++) {
-			for (j = 0; j < 3; j++)
-				gyro_adjusted[i]
-				+= position_map[data->position][i][j] * raw[j];
+	/* the last entry of every report period, the newest one at irq_time */
+	for (n = 1; n <= data->batch; n++) {
+		buf = data->fifo_data +
+			(n * data->entries - 1) * sizeof(struct gyro_t);
+		data->xyz_data.x = (buf[1] << 8) | buf[0];
+		data->xyz_data.y = (buf[3] << 8) | buf[2];
+		data->xyz_data.z = (buf[5] << 8) | buf[4];
+
+		data->xyz_data.x -= data->cal_data.x;
+		data->xyz_data.y -= data->cal_data.y;
+		data->xyz_data.z -= data->cal_data.z;
+
+		if (data->axis_adjust) {
+			raw[0] = data->xyz_data.x;
+			raw[1] = data->xyz_data.y;
+			raw[2] = data->xyz_data.z;
+			for (i = 0; i < 3; i++) {
+				gyro_adjusted[i] = 0;
+				for (j = 0; j < 3; j++)
+					gyro_adjusted[i] +=
+					position_map[data->position][i][j]
+					* raw[j];
+			}
+		} else {
+			gyro_adjusted[0] = data->xyz_data.x;
+			gyro_adjusted[1] = data->xyz_data.y;
+			gyro_adjusted[2] = data->xyz_data.z;
 		}
-	} else {
-		gyro_adjusted[0] = data->xyz_data.x;
-		gyro_adjusted[1] = data->xyz_data.y;
-		gyro_adjusted[2] = data->xyz_data.z;
-	}
 
-	input_report_rel(data->input_dev, REL_RX, gyro_adjusted[0]);
-	input_report_rel(data->input_dev, REL_RY, gyro_adjusted[1]);
-	input_report_rel(data->input_dev, REL_RZ, gyro_adjusted[2]);
-	input_sync(data->input_dev);
-
-	lsm330dlc_gyro_restart_fifo(data);
+		timestamp = ktime_sub_ns(data->irq_time,
+			(u64)(total - n * data->entries) * data->time_to_read);
+		input_set_timestamp(data->input_dev, timestamp);
+		input_report_rel(data->input_dev, REL_RX, gyro_adjusted[0]);
+		input_report_rel(data->input_dev, REL_RY, gyro_adjusted[1]);
+		input_report_rel(data->input_dev, REL_RZ, gyro_adjusted[2]);
+		input_sync(data->input_dev);
 
 #ifdef LOGGING_GYRO
-	pr_info("%s, x = %d, y = %d, z = %d\n"
+		pr_info("%s, x = %d, y = %d, z = %d\n"
 			, __func__, gyro_adjusted[0], gyro_adjusted[1],
 			gyro_adjusted[2]);
 #endif
+	}
+
+	lsm330dlc_gyro_restart_fifo(data);
 
 	return res;
 }
@@ -399,6 +446,14 @@ static void lsm330dlc_gyro_work_func(struct work_struct *work)
 #endif
 }
 
+static irqreturn_t lsm330dlc_gyro_interrupt(int irq, void *dev_id)
+{
+	struct lsm330dlc_gyro_data *data = dev_id;
+
+	data->irq_time = ktime_get();
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t lsm330dlc_gyro_interrupt_thread(int irq\
 	, void *lsm330dlc_gyro_data_p)
 {
@@ -639,6 +694,22 @@ unlock:
 	return err ? err : size;
 }
 
+/* drain as many report periods per interrupt as max_latency allows */
+static void lsm330dlc_gyro_update_batch(struct lsm330dlc_gyro_data *data)
+{
+	u64 period = (u64)data->time_to_read * data->entries;
+	u64 periods = data->max_latency;
+
+	data->batch = 1;
+	if (!data->interruptible || !period)
+		return;
+
+	do_div(periods, period);
+	if (periods > 1)
+		data->batch = min_t(u64, periods,
+				MAX_BATCH_ENTRY / data->entries);
+}
+
 static u64 lsm330dlc_gyro_get_delay_ns(struct lsm330dlc_gyro_data *k3)
 {
 	u64 delay = -1;
@@ -696,9 +767,11 @@ static int lsm330dlc_gyro_set_delay_ns(struct lsm330dlc_gyro_data *k3\
 		}
 	}
 
+	lsm330dlc_gyro_update_batch(k3);
+
 	if (k3->interruptible)
-		pr_info("%s, k3->entries=%d, odr_value=0x%x\n", __func__,
-			k3->entries, odr_value);
+		pr_info("%s, k3->entries=%d, batch=%d, odr_value=0x%x\n",
+			__func__, k3->entries, k3->batch, odr_value);
 
 	if (odr_value != (k3->ctrl_regs[0] & ODR_MASK)) {
 		ctrl = (k3->ctrl_regs[0] & ~ODR_MASK);
@@ -758,10 +831,46 @@ static ssize_t lsm330dlc_gyro_set_delay(struct device *dev,
 	return size;
 }
 
+static ssize_t lsm330dlc_gyro_show_max_latency(struct device *dev,
+			struct device_attribute *attr, char *buf)
+{
+	struct lsm330dlc_gyro_data *data  = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%lld\n", data->max_latency);
+}
+
+static ssize_t lsm330dlc_gyro_set_max_latency(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t size)
+{
+	struct lsm330dlc_gyro_data *data  = dev_get_drvdata(dev);
+	u64 latency;
+	int res;
+
+	res = kstrtoull(buf, 10, &latency);
+	if (res < 0)
+		return res;
+
+	mutex_lock(&data->lock);
+	data->max_latency = latency;
+	if (data->interruptible) {
+		disable_irq(data->client->irq);
+		lsm330dlc_gyro_update_batch(data);
+		if (data->enable)
+			lsm330dlc_gyro_restart_fifo(data);
+		enable_irq(data->client->irq);
+	}
+	mutex_unlock(&data->lock);
+
+	return size;
+}
+
 static DEVICE_ATTR(enable, S_IRUGO | S_IWUSR | S_IWGRP,
 			lsm330dlc_gyro_show_enable, lsm330dlc_gyro_set_enable);
 static DEVICE_ATTR(poll_delay, S_IRUGO | S_IWUSR | S_IWGRP,
 			lsm330dlc_gyro_show_delay, lsm330dlc_gyro_set_delay);
+static DEVICE_ATTR(max_latency, S_IRUGO | S_IWUSR | S_IWGRP,
+			lsm330dlc_gyro_show_max_latency,
+			lsm330dlc_gyro_set_max_latency);
 
 /*************************************************************************/
 /* lsm330dlc_gyro Sysfs															 */
@@ -1465,7 +1574,9 @@ static int lsm330dlc_gyro_probe(struct i2c_client *client,
 			sizeof(default_ctrl_regs_fifo));
 		data->interruptible = true;
 		data->entries = 1;
-		err = request_threaded_irq(data->client->irq, NULL,
+		data->batch = 1;
+		err = request_threaded_irq(data->client->irq,
+			lsm330dlc_gyro_interrupt,
 			lsm330dlc_gyro_interrupt_thread\
 			, IRQF_TRIGGER_RISING | IRQF_ONESHOT,\
 				"lsm330dlc_gyro", data);
@@ -1477,6 +1588,7 @@ static int lsm330dlc_gyro_probe(struct i2c_client *client,
 	} else { /* polling */
 		memcpy(&data->ctrl_regs, &default_ctrl_regs_bypass,
 			sizeof(default_ctrl_regs_bypass));
+		data->batch = 1;
 		data->ctrl_regs[2] = 0x00; /* disable interrupt */
 		/* hrtimer settings.  we poll for gyro values using a timer. */
 		hrtimer_init(&data->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
@@ -1510,6 +1622,13 @@ static int lsm330dlc_gyro_probe(struct i2c_client *client,
 		goto err_device_create_file2;
 	}
 
+	if (device_create_file(&input_dev->dev,
+				&dev_attr_max_latency) < 0) {
+		pr_err("%s: Failed to create device file(%s)!\n", __func__,
+				dev_attr_max_latency.attr.name);
+		goto err_device_create_file_latency;
+	}
+
 	/* create device node for lsm330dlc_gyro digital gyroscope */
 	data->dev = sensors_classdev_register("gyro_sensor");
 
@@ -1615,6 +1734,8 @@ err_device_create_file4:
 err_device_create_file3:
 	sensors_classdev_unregister(data->dev);
 err_device_create:
+	device_remove_file(&input_dev->dev, &dev_attr_max_latency);
+err_device_create_file_latency:
 	device_remove_file(&input_dev->dev, &dev_attr_poll_delay);
 err_device_create_file2:
 	device_remove_file(&input_dev->dev, &dev_attr_enable);
@@ -1669,6 +1790,7 @@ static int lsm330dlc_gyro_remove(struct i2c_client *client)
 
 	device_remove_file(&data->input_dev->dev, &dev_attr_enable);
 	device_remove_file(&data->input_dev->dev, &dev_attr_poll_delay);
+	device_remove_file(&data->input_dev->dev, &dev_attr_max_latency);
 	input_unregister_device(data->input_dev);
 	mutex_destroy(&data->lock);
 	kfree(data);
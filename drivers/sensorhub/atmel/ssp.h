@@ -232,6 +232,29 @@ struct sensor_value {
 	};
 };
 
+/*
+ * Layout of /dev/ssp_sensor as seen by its reader: a header page, then
+ * size records starting data_offset bytes in. value holds the sensor's
+ * struct sensor_value as parsed from the MCU frame.
+ */
+#define SSP_RING_EVENTS		1024	/* power of two */
+
+struct ssp_ring_header {
+	u32 head;	/* written by the kernel */
+	u32 tail;	/* written by the reader */
+	u32 size;
+	u32 data_offset;
+	u32 dropped;	/* events lost to a full ring */
+};
+
+struct ssp_ring_event {
+	u32 type;	/* SENSOR_TYPE */
+	u32 reserved;
+	s64 timestamp;	/* CLOCK_MONOTONIC ns of the frame */
+	s32 value[3];
+	u32 pad;
+};
+
 struct calibraion_data {
 	int x;
 	int y;
@@ -264,6 +287,12 @@ struct ssp_data {
 	struct calibraion_data accelcal;
 	struct calibraion_data gyrocal;
 	struct sensor_value buf[SENSOR_MAX];
+	struct miscdevice ring_device;
+	struct ssp_ring_header *pRingHdr;
+	struct ssp_ring_event *pRingEvents;
+	wait_queue_head_t ring_wait;
+	atomic_t aRingOpen;
+	char chRcvDataFrame[256];	/* SSP-AP message frame, u8 length */
 
 	bool bSspShutdown;
 	bool bCheckSuspend;
@@ -368,6 +397,10 @@ unsigned int get_sensor_scanning_info(struct ssp_data *);
 unsigned int get_firmware_rev(struct ssp_data *);
 int forced_to_download_binary(struct ssp_data *, int);
 int parse_dataframe(struct ssp_data *, char *, int);
+int initialize_sensor_ring(struct ssp_data *);
+void remove_sensor_ring(struct ssp_data *);
+void ssp_ring_push(struct ssp_data *, int, struct sensor_value *, ktime_t);
+void ssp_ring_flush(struct ssp_data *);
 void enable_debug_timer(struct ssp_data *);
 void disable_debug_timer(struct ssp_data *);
 int initialize_debug_timer(struct ssp_data *);
@@ -190,14 +190,28 @@ static void get_factoty_data(struct ssp_data *data, int iSensorData,
 	data->uFactorydataReady = uTemp;
 }
 
-int parse_dataframe(struct ssp_data *data, char *pchRcvDataFrame, int iLength)
+/*
+ * The event ring carries the values after calibration, as kept in buf by
+ * the report functions; the sensors that keep nothing there go out raw.
+ */
+static struct sensor_value *ssp_ring_value(struct ssp_data *data,
+	int iSensorData, struct sensor_value *sensorsdata)
 {
-	int iDataIdx, iSensorData;
-	struct sensor_value *sensorsdata;
+	switch (iSensorData) {
+	case GESTURE_SENSOR:
+	case PROXIMITY_RAW:
+		return sensorsdata;
+	default:
+		return &data->buf[iSensorData];
+	}
+}
 
-	sensorsdata = kzalloc(sizeof(*sensorsdata), GFP_KERNEL);
-	if (sensorsdata == NULL)
-		return ERROR;
+int parse_dataframe(struct ssp_data *data, char *pchRcvDataFrame, int iLength)
+{
+	int iDataIdx, iSensorData, iRet = SUCCESS;
+	struct sensor_value sensorsdata;
+	bool bRing = atomic_read(&data->aRingOpen);
+	ktime_t timestamp = ktime_get();
 
 	for (iDataIdx = 0; iDataIdx < iLength;) {
 		if (pchRcvDataFrame[iDataIdx] == MSG2AP_INST_BYPASS_DATA) {
@@ -207,14 +221,19 @@ int parse_dataframe(struct ssp_data *data, char *pchRcvDataFrame, int iLength)
 				(iSensorData >= (SENSOR_MAX - 1))) {
 				pr_err("[SSP]: %s - Mcu data frame1 error %d\n",
 					__func__, iSensorData);
-				kfree(sensorsdata);
-				return ERROR;
+				iRet = ERROR;
+				break;
 			}
 
+			memset(&sensorsdata, 0, sizeof(sensorsdata));
 			data->get_sensor_data[iSensorData](pchRcvDataFrame,
-				&iDataIdx, sensorsdata);
+				&iDataIdx, &sensorsdata);
 			data->report_sensor_data[iSensorData](data,
-				sensorsdata);
+				&sensorsdata);
+			if (bRing)
+				ssp_ring_push(data, iSensorData,
+					ssp_ring_value(data, iSensorData,
+						&sensorsdata), timestamp);
 		} else if (pchRcvDataFrame[iDataIdx] ==
 			MSG2AP_INST_SELFTEST_DATA) {
 			iDataIdx++;
@@ -223,8 +242,8 @@ int parse_dataframe(struct ssp_data *data, char *pchRcvDataFrame, int iLength)
 				(iSensorData >= SENSOR_FACTORY_MAX)) {
 				pr_err("[SSP]: %s - Mcu data frame2 error %d\n",
 					__func__, iSensorData);
-				kfree(sensorsdata);
-				return ERROR;
+				iRet = ERROR;
+				break;
 			}
 			get_factoty_data(data, iSensorData, pchRcvDataFrame,
 				&iDataIdx);
@@ -236,8 +255,8 @@ int parse_dataframe(struct ssp_data *data, char *pchRcvDataFrame, int iLength)
 			if (iSensorData) {
 				pr_err("[SSP]: %s - Mcu data frame3 error %d\n",
 					__func__, iSensorData);
-				kfree(sensorsdata);
-				return ERROR;
+				iRet = ERROR;
+				break;
 			}
 #ifdef CONFIG_SENSORS_SSP_SENSORHUB
 		} else if (pchRcvDataFrame[iDataIdx] ==
@@ -249,8 +268,12 @@ int parse_dataframe(struct ssp_data *data, char *pchRcvDataFrame, int iLength)
 		} else
 			iDataIdx++;
 	}
-	kfree(sensorsdata);
-	return SUCCESS;
+
+	/* one wakeup for the whole frame */
+	if (bRing)
+		ssp_ring_flush(data);
+
+	return iRet;
 }
 
 void initialize_function_pointer(struct ssp_data *data)
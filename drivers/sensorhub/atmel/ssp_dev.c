@@ -279,6 +279,12 @@ static int ssp_probe(struct i2c_client *client,
 	if (iRet)
 		goto err_akmd_device_register;
 
+	iRet = initialize_sensor_ring(data);
+	if (iRet < 0) {
+		pr_err("[SSP]: %s - could not create event ring\n", __func__);
+		goto err_sensor_ring;
+	}
+
 	iRet = initialize_debug_timer(data);
 	if (iRet < 0) {
 		pr_err("[SSP]: %s - could not create workqueue\n", __func__);
@@ -344,6 +350,8 @@ err_sysfs_create:
 err_setup_irq:
 	destroy_workqueue(data->debug_wq);
 err_create_workqueue:
+	remove_sensor_ring(data);
+err_sensor_ring:
 	misc_deregister(&data->akmd_device);
 err_akmd_device_register:
 	remove_input_dev(data);
@@ -393,6 +401,7 @@ static void ssp_shutdown(struct i2c_client *client)
 #endif
 
 	misc_deregister(&data->akmd_device);
+	remove_sensor_ring(data);
 
 	del_timer_sync(&data->debug_timer);
 	cancel_work_sync(&data->work_debug);
@@ -479,6 +488,7 @@ static struct i2c_driver ssp_driver = {
 	.id_table = ssp_id,
 	.driver = {
 		   .pm = &ssp_pm_ops,
+		   .probe_type = PROBE_PREFER_ASYNCHRONOUS,
 		   .owner = THIS_MODULE,
 		   .name = "ssp"
 		},
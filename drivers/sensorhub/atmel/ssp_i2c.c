@@ -482,24 +482,17 @@ err_read_fuserom:
 static int ssp_receive_msg(struct ssp_data *data,  u8 uLength)
 {
 	char chTxBuf = 0;
-	char *pchRcvDataFrame;	/* SSP-AP Massage data buffer */
+	/* SSP-AP Massage data buffer, only used from the irq thread */
+	char *pchRcvDataFrame = data->chRcvDataFrame;
 	int iRet = 0;
 
 	if (uLength > 0) {
-		pchRcvDataFrame = kzalloc((uLength * sizeof(char)), GFP_KERNEL);
-		if (pchRcvDataFrame == NULL) {
-			pr_err("[SSP]: %s - failed to allocate memory for data\n",
-				__func__);
-			iRet = -ENOMEM;
-			return iRet;
-		}
 		chTxBuf = MSG2SSP_SRM;
 		iRet = ssp_i2c_read(data, &chTxBuf, 1, pchRcvDataFrame,
 				(u16)uLength, 0);
 		if (iRet != SUCCESS) {
 			pr_err("[SSP]: %s - Fail to receive data %d\n",
 				__func__, iRet);
-			kfree(pchRcvDataFrame);
 			return ERROR;
 		}
 	} else {
@@ -510,7 +503,6 @@ static int ssp_receive_msg(struct ssp_data *data,  u8 uLength)
 
 	parse_dataframe(data, pchRcvDataFrame, uLength);
 
-	kfree(pchRcvDataFrame);
 	return uLength;
 }
 
@@ -0,0 +1,196 @@
+/*
+ *  Copyright (C) 2012, Samsung Electronics Co. Ltd. All Rights Reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ */
+#include "ssp.h"
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/poll.h>
+#include <linux/vmalloc.h>
+
+/*************************************************************************/
+/* SSP shared event ring                                                 */
+/*************************************************************************/
+
+/*
+ * While /dev/ssp_sensor is open every event of an MCU data frame is also
+ * appended here, so a single reader can take all sensors from one mapping
+ * instead of one input device each, and it is woken once per frame.
+ * The buffer is a header page followed by SSP_RING_EVENTS records; the
+ * kernel only moves head, the reader only moves tail, and a full ring
+ * drops new events and counts them.
+ */
+#define SSP_RING_BYTES	(PAGE_SIZE + \
+			SSP_RING_EVENTS * sizeof(struct ssp_ring_event))
+
+void ssp_ring_push(struct ssp_data *data, int iSensorType,
+	struct sensor_value *sensorsdata, ktime_t timestamp)
+{
+	struct ssp_ring_header *pHdr = data->pRingHdr;
+	struct ssp_ring_event *pEvent;
+	u32 uHead = pHdr->head;
+
+	if (uHead - ACCESS_ONCE(pHdr->tail) >= SSP_RING_EVENTS) {
+		pHdr->dropped++;
+		return;
+	}
+
+	pEvent = &data->pRingEvents[uHead & (SSP_RING_EVENTS - 1)];
+	pEvent->type = iSensorType;
+	pEvent->reserved = 0;
+	pEvent->timestamp = ktime_to_ns(timestamp);
+	memcpy(pEvent->value, sensorsdata, sizeof(pEvent->value));
+
+	/* the record must be visible before the new head */
+	smp_wmb();
+	pHdr->head = uHead + 1;
+}
+
+void ssp_ring_flush(struct ssp_data *data)
+{
+	wake_up_interruptible(&data->ring_wait);
+}
+
+static inline bool ssp_ring_empty(struct ssp_data *data)
+{
+	return ACCESS_ONCE(data->pRingHdr->head) == data->pRingHdr->tail;
+}
+
+static int ssp_ring_open(struct inode *inode, struct file *file)
+{
+	struct ssp_data *data = container_of(file->private_data,
+			struct ssp_data, ring_device);
+
+	/* one reader, the tail lives in its hands */
+	if (atomic_cmpxchg(&data->aRingOpen, 0, 1))
+		return -EBUSY;
+
+	data->pRingHdr->tail = data->pRingHdr->head;
+	data->pRingHdr->dropped = 0;
+
+	return nonseekable_open(inode, file);
+}
+
+static int ssp_ring_release(struct inode *inode, struct file *file)
+{
+	struct ssp_data *data = container_of(file->private_data,
+			struct ssp_data, ring_device);
+
+	atomic_set(&data->aRingOpen, 0);
+	return 0;
+}
+
+static ssize_t ssp_ring_read(struct file *file, char __user *buf,
+	size_t count, loff_t *pos)
+{
+	struct ssp_data *data = container_of(file->private_data,
+			struct ssp_data, ring_device);
+	struct ssp_ring_header *pHdr = data->pRingHdr;
+	struct ssp_ring_event *pEvent;
+	size_t uRead = 0;
+	int iRet;
+
+	if (count < sizeof(*pEvent))
+		return -EINVAL;
+
+	if (ssp_ring_empty(data)) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		iRet = wait_event_interruptible(data->ring_wait,
+				!ssp_ring_empty(data));
+		if (iRet)
+			return iRet;
+	}
+
+	while (uRead + sizeof(*pEvent) <= count && !ssp_ring_empty(data)) {
+		/* pairs with the barrier in ssp_ring_push() */
+		smp_rmb();
+		pEvent = &data->pRingEvents[pHdr->tail &
+				(SSP_RING_EVENTS - 1)];
+		if (copy_to_user(buf + uRead, pEvent, sizeof(*pEvent)))
+			return uRead ? uRead : -EFAULT;
+		pHdr->tail++;
+		uRead += sizeof(*pEvent);
+	}
+
+	return uRead;
+}
+
+static unsigned int ssp_ring_poll(struct file *file, poll_table *wait)
+{
+	struct ssp_data *data = container_of(file->private_data,
+			struct ssp_data, ring_device);
+
+	poll_wait(file, &data->ring_wait, wait);
+
+	return ssp_ring_empty(data) ? 0 : POLLIN | POLLRDNORM;
+}
+
+static int ssp_ring_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct ssp_data *data = container_of(file->private_data,
+			struct ssp_data, ring_device);
+
+	if (vma->vm_pgoff ||
+		vma->vm_end - vma->vm_start != PAGE_ALIGN(SSP_RING_BYTES))
+		return -EINVAL;
+
+	vma->vm_flags |= VM_DONTEXPAND;
+	return remap_vmalloc_range(vma, data->pRingHdr, 0);
+}
+
+static const struct file_operations ssp_ring_fops = {
+	.owner = THIS_MODULE,
+	.open = ssp_ring_open,
+	.release = ssp_ring_release,
+	.read = ssp_ring_read,
+	.poll = ssp_ring_poll,
+	.mmap = ssp_ring_mmap,
+	.llseek = no_llseek,
+};
+
+int initialize_sensor_ring(struct ssp_data *data)
+{
+	int iRet;
+
+	data->pRingHdr = vmalloc_user(SSP_RING_BYTES);
+	if (data->pRingHdr == NULL)
+		return -ENOMEM;
+
+	data->pRingHdr->size = SSP_RING_EVENTS;
+	data->pRingHdr->data_offset = PAGE_SIZE;
+	data->pRingEvents = (void *)data->pRingHdr + PAGE_SIZE;
+	init_waitqueue_head(&data->ring_wait);
+	atomic_set(&data->aRingOpen, 0);
+
+	data->ring_device.minor = MISC_DYNAMIC_MINOR;
+	data->ring_device.name = "ssp_sensor";
+	data->ring_device.fops = &ssp_ring_fops;
+
+	iRet = misc_register(&data->ring_device);
+	if (iRet < 0) {
+		pr_err("[SSP]: %s - misc_register failed %d\n", __func__, iRet);
+		vfree(data->pRingHdr);
+		data->pRingHdr = NULL;
+	}
+
+	return iRet;
+}
+
+void remove_sensor_ring(struct ssp_data *data)
+{
+	misc_deregister(&data->ring_device);
+	/* pages still mapped by a reader stay until it unmaps them */
+	vfree(data->pRingHdr);
+	data->pRingHdr = NULL;
+}
@@ -88,10 +88,16 @@ static int is_wakeup(enum android_alarm_type type)
 
 static void devalarm_start(struct devalarm *alrm, ktime_t exp)
 {
+	/*
+	 * Non-wakeup alarms get the timer slack of the task setting them, so
+	 * with the screen off they line up with the other timers around.
+	 */
 	if (is_wakeup(alrm->type))
 		alarm_start(&alrm->u.alrm, exp);
 	else
-		hrtimer_start(&alrm->u.hrt, exp, HRTIMER_MODE_ABS);
+		hrtimer_start_range_ns(&alrm->u.hrt, exp,
+				       task_timer_slack_ns(current),
+				       HRTIMER_MODE_ABS);
 }
 
 
@@ -27,6 +27,7 @@
 #include <linux/file.h>
 #include <linux/freezer.h>
 #include <linux/fs.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/miscdevice.h>
 #include <linux/mm.h>
@@ -42,6 +43,7 @@
 #include <linux/vmalloc.h>
 #include <linux/slab.h>
 #include <linux/security.h>
+#include <linux/ram_trace.h>
 
 #include "binder.h"
 #ifndef BINDER_IPC_32BIT
@@ -57,6 +59,11 @@ static HLIST_HEAD(binder_procs);
 static HLIST_HEAD(binder_deferred_list);
 static HLIST_HEAD(binder_dead_nodes);
 
+/* mapped buffer pages no buffer uses, oldest first */
+static DEFINE_SPINLOCK(binder_lru_lock);
+static LIST_HEAD(binder_lru);
+static int binder_lru_count;
+
 static struct dentry *binder_debugfs_dir_entry_root;
 static struct dentry *binder_debugfs_dir_entry_proc;
 static int binder_last_id;
@@ -192,6 +199,7 @@ static inline void binder_stats_created(enum binder_stat_types type)
 
 struct binder_transaction_log_entry {
 	int debug_id;
+	int debug_id_done;	/* debug_id once the entry is complete */
 	int call_type;
 	int from_proc;
 	int from_thread;
@@ -203,28 +211,69 @@ struct binder_transaction_log_entry {
 	int offsets_size;
 	const char *context_name;
 };
+/*
+ * Writers claim entries with an atomic counter and need no lock; the
+ * readers tell entries still being filled in by debug_id_done.
+ */
 struct binder_transaction_log {
-	int next;
-	int full;
+	atomic_t cur;
+	bool full;
 	struct binder_transaction_log_entry entry[32];
 };
-static struct binder_transaction_log binder_transaction_log;
-static struct binder_transaction_log binder_transaction_log_failed;
+static struct binder_transaction_log binder_transaction_log = {
+	.cur = ATOMIC_INIT(~0U),
+};
+static struct binder_transaction_log binder_transaction_log_failed = {
+	.cur = ATOMIC_INIT(~0U),
+};
 
 static struct binder_transaction_log_entry *binder_transaction_log_add(
 	struct binder_transaction_log *log)
 {
 	struct binder_transaction_log_entry *e;
-	e = &log->entry[log->next];
+	unsigned int cur = atomic_inc_return(&log->cur);
+
+	if (cur >= ARRAY_SIZE(log->entry))
+		log->full = true;
+	e = &log->entry[cur % ARRAY_SIZE(log->entry)];
+	ACCESS_ONCE(e->debug_id_done) = 0;
+	/* the reader must not see the old id done with the new contents */
+	smp_wmb();
 	memset(e, 0, sizeof(*e));
-	log->next++;
-	if (log->next == ARRAY_SIZE(log->entry)) {
-		log->next = 0;
-		log->full = 1;
-	}
 	return e;
 }
 
+static void binder_transaction_log_done(struct binder_transaction_log_entry *e,
+					int debug_id)
+{
+	smp_wmb();
+	ACCESS_ONCE(e->debug_id_done) = debug_id;
+}
+
+/*
+ * Latencies in powers of two of microseconds: bucket 0 counts those up
+ * to 2us, bucket n those from 2^n us, the last one everything slower.
+ */
+#define BINDER_LATENCY_BUCKETS	16
+
+struct binder_latency {
+	u32 bucket[BINDER_LATENCY_BUCKETS];
+};
+
+/* calls this slow also go to the persistent trace */
+#define BINDER_SLOW_US		(200 * USEC_PER_MSEC)
+
+static void binder_latency_add(struct binder_latency *lat, ktime_t start)
+{
+	s64 us = ktime_us_delta(ktime_get(), start);
+	int i = us < 2 ? 0 : min(ilog2(us), BINDER_LATENCY_BUCKETS - 1);
+
+	lat->bucket[i]++;
+	if (us >= BINDER_SLOW_US)
+		ram_trace_log(RAM_TRACE_BINDER, current->tgid,
+			      min_t(s64, us, U32_MAX), 0);
+}
+
 struct binder_context {
 	struct binder_node *binder_context_mgr_node;
 	uid_t binder_context_mgr_uid;
@@ -249,6 +298,12 @@ struct binder_work {
 	} type;
 };
 
+/* a scheduling policy with a kernel priority, lower prio is more urgent */
+struct binder_priority {
+	unsigned int sched_policy;
+	int prio;
+};
+
 struct binder_node {
 	int debug_id;
 	struct binder_work work;
@@ -270,7 +325,10 @@ struct binder_node {
 	unsigned has_async_transaction:1;
 	unsigned accept_fds:1;
 	unsigned min_priority:8;
+	unsigned sched_policy:2;
+	unsigned inherit_rt:1;
 	struct list_head async_todo;
+	struct binder_latency rtt;	/* calls until replied to */
 };
 
 struct binder_ref_death {
@@ -313,6 +371,12 @@ struct binder_buffer {
 	uint8_t data[0];
 };
 
+struct binder_lru_page {
+	struct list_head lru;	/* on binder_lru while no buffer uses it */
+	struct page *page_ptr;
+	struct binder_proc *proc;
+};
+
 enum binder_deferred_state {
 	BINDER_DEFERRED_PUT_FILES    = 0x01,
 	BINDER_DEFERRED_FLUSH        = 0x02,
@@ -335,12 +399,18 @@ struct binder_proc {
 	void *buffer;
 	ptrdiff_t user_buffer_offset;
 
+	/*
+	 * alloc_lock protects the buffer lists and trees, the pages and
+	 * free_async_space. It nests inside binder_main_lock, and is taken
+	 * without it to allocate the buffer of an incoming transaction.
+	 */
+	struct mutex alloc_lock;
 	struct list_head buffers;
 	struct rb_root free_buffers;
 	struct rb_root allocated_buffers;
 	size_t free_async_space;
 
-	struct page **pages;
+	struct binder_lru_page *pages;
 	size_t buffer_size;
 	uint32_t buffer_free;
 	struct list_head todo;
@@ -351,9 +421,14 @@ struct binder_proc {
 	int requested_threads;
 	int requested_threads_started;
 	int ready_threads;
-	long default_priority;
+	struct binder_priority default_priority;
 	struct dentry *debugfs_entry;
 	struct binder_context *context;
+	/* senders filling one of our buffers, under binder_main_lock */
+	int tmp_ref;
+	bool is_dead;
+	struct binder_latency rtt;	/* our calls until the reply is read */
+	struct binder_latency wait;	/* incoming calls until picked up */
 };
 
 enum {
@@ -394,13 +469,15 @@ struct binder_transaction {
 	struct binder_buffer *buffer;
 	unsigned int	code;
 	unsigned int	flags;
-	long	priority;
-	long	saved_priority;
+	struct binder_priority	priority;
+	struct binder_priority	saved_priority;
 	uid_t	sender_euid;
+	ktime_t	start;		/* of the call, carried over to its reply */
 };
 
 static void
 binder_defer_work(struct binder_proc *proc, enum binder_deferred_state defer);
+static void binder_proc_dec_tmpref(struct binder_proc *proc);
 
 /*
  * copied from get_unused_fd_flags
@@ -552,21 +629,138 @@ static inline void binder_unlock(const char *tag)
 	mutex_unlock(&binder_main_lock);
 }
 
-static void binder_set_nice(long nice)
+#ifndef NICE_TO_PRIO
+#define NICE_TO_PRIO(nice)	(MAX_RT_PRIO + (nice) + 20)
+#define PRIO_TO_NICE(prio)	((prio) - MAX_RT_PRIO - 20)
+#endif
+
+static bool is_rt_policy(int policy)
+{
+	return policy == SCHED_FIFO || policy == SCHED_RR;
+}
+
+static bool is_fair_policy(int policy)
+{
+	return policy == SCHED_NORMAL || policy == SCHED_BATCH;
+}
+
+/* nice for the fair policies, sched_priority for the rt ones */
+static int to_userspace_prio(int policy, int kernel_priority)
+{
+	if (is_fair_policy(policy))
+		return PRIO_TO_NICE(kernel_priority);
+	else
+		return MAX_USER_RT_PRIO - 1 - kernel_priority;
+}
+
+static int to_kernel_prio(int policy, int user_priority)
+{
+	if (is_fair_policy(policy))
+		return NICE_TO_PRIO(user_priority);
+	else
+		return MAX_USER_RT_PRIO - 1 - user_priority;
+}
+
+static void binder_get_priority(struct task_struct *task,
+				struct binder_priority *prio)
 {
-	long min_nice;
-	if (can_nice(current, nice)) {
-		set_user_nice(current, nice);
+	if (is_fair_policy(task->policy) || is_rt_policy(task->policy)) {
+		prio->sched_policy = task->policy;
+		prio->prio = task->normal_prio;
+	} else {
+		prio->sched_policy = SCHED_NORMAL;
+		prio->prio = NICE_TO_PRIO(0);
+	}
+}
+
+/*
+ * Moves the current thread to @desired, within what its RLIMIT_RTPRIO
+ * and RLIMIT_NICE allow unless it has CAP_SYS_NICE. Threads changed to
+ * an rt policy get SCHED_RESET_ON_FORK, so that inherited priorities do
+ * not leak into children.
+ */
+static void binder_set_priority(struct binder_priority desired)
+{
+	unsigned int policy = desired.sched_policy;
+	int priority;
+
+	if (current->policy == policy && current->normal_prio == desired.prio)
 		return;
+
+	priority = to_userspace_prio(policy, desired.prio);
+
+	if (is_rt_policy(policy) &&
+	    !has_capability_noaudit(current, CAP_SYS_NICE)) {
+		long max_rtprio = task_rlimit(current, RLIMIT_RTPRIO);
+
+		if (max_rtprio == 0) {
+			policy = SCHED_NORMAL;
+			priority = -20;
+		} else if (priority > max_rtprio) {
+			priority = max_rtprio;
+		}
+	}
+
+	if (is_fair_policy(policy) && !can_nice(current, priority)) {
+		long min_nice = 20 - task_rlimit(current, RLIMIT_NICE);
+
+		binder_debug(BINDER_DEBUG_PRIORITY_CAP,
+			     "%d: nice value %d not allowed use %ld instead\n",
+			      current->pid, priority, min_nice);
+		if (min_nice >= 20) {
+			binder_user_error("%d RLIMIT_NICE not set\n",
+					  current->pid);
+			return;
+		}
+		priority = min_nice;
+	}
+
+	if (current->policy != policy || is_rt_policy(policy)) {
+		struct sched_param params;
+
+		params.sched_priority = is_rt_policy(policy) ? priority : 0;
+		sched_setscheduler_nocheck(current,
+					   policy | SCHED_RESET_ON_FORK,
+					   &params);
 	}
-	min_nice = 20 - current->signal->rlim[RLIMIT_NICE].rlim_cur;
-	binder_debug(BINDER_DEBUG_PRIORITY_CAP,
-		     "%d: nice value %ld not allowed use %ld instead\n",
-		      current->pid, nice, min_nice);
-	set_user_nice(current, min_nice);
-	if (min_nice < 20)
+	if (is_fair_policy(policy))
+		set_user_nice(current, priority);
+}
+
+/*
+ * Called by the thread that picks up @t. A synchronous transaction runs
+ * at the better of the caller's priority and the node's minimum, rt
+ * callers passing on their policy only to nodes that inherit rt; a
+ * oneway one only gets the node's minimum. The old priority is put back
+ * once the thread replies.
+ */
+static void binder_transaction_priority(struct binder_transaction *t,
+					struct binder_node *node)
+{
+	struct binder_priority desired = t->priority;
+	struct binder_priority node_prio = {
+		.sched_policy = node->sched_policy,
+		.prio = node->min_priority,
+	};
+
+	binder_get_priority(current, &t->saved_priority);
+
+	if (t->flags & TF_ONE_WAY) {
+		if (node_prio.prio < t->saved_priority.prio)
+			binder_set_priority(node_prio);
 		return;
-	binder_user_error("%d RLIMIT_NICE not set\n", current->pid);
+	}
+
+	if (!node->inherit_rt && is_rt_policy(desired.sched_policy)) {
+		desired.sched_policy = SCHED_NORMAL;
+		desired.prio = NICE_TO_PRIO(0);
+	}
+	if (node_prio.prio < desired.prio ||
+	    (node_prio.prio == desired.prio &&
+	     node_prio.sched_policy == SCHED_FIFO))
+		desired = node_prio;
+
+	binder_set_priority(desired);
 }
 
 static size_t binder_buffer_size(struct binder_proc *proc,
@@ -640,13 +834,15 @@ static void binder_insert_allocated_buffer(struct binder_proc *proc,
 static struct binder_buffer *binder_buffer_lookup(struct binder_proc *proc,
 						  uintptr_t user_ptr)
 {
-	struct rb_node *n = proc->allocated_buffers.rb_node;
+	struct rb_node *n;
 	struct binder_buffer *buffer;
 	struct binder_buffer *kern_ptr;
 
 	kern_ptr = (struct binder_buffer *)(user_ptr - proc->user_buffer_offset
 		- offsetof(struct binder_buffer, data));
 
+	mutex_lock(&proc->alloc_lock);
+	n = proc->allocated_buffers.rb_node;
 	while (n) {
 		buffer = rb_entry(n, struct binder_buffer, rb_node);
 		BUG_ON(buffer->free);
@@ -656,11 +852,39 @@ static struct binder_buffer *binder_buffer_lookup(struct binder_proc *proc,
 		else if (kern_ptr > buffer)
 			n = n->rb_right;
 		else
-			return buffer;
+			break;
 	}
-	return NULL;
+	mutex_unlock(&proc->alloc_lock);
+	return n ? buffer : NULL;
+}
+
+static void binder_lru_add(struct binder_lru_page *page)
+{
+	spin_lock(&binder_lru_lock);
+	if (list_empty(&page->lru)) {
+		list_add_tail(&page->lru, &binder_lru);
+		binder_lru_count++;
+	}
+	spin_unlock(&binder_lru_lock);
+}
+
+static void binder_lru_del(struct binder_lru_page *page)
+{
+	spin_lock(&binder_lru_lock);
+	if (!list_empty(&page->lru)) {
+		list_del_init(&page->lru);
+		binder_lru_count--;
+	}
+	spin_unlock(&binder_lru_lock);
 }
 
+/*
+ * Pages are allocated and mapped the first time a buffer covers them.
+ * Freeing a buffer leaves its pages mapped on binder_lru, so the next
+ * transaction that lands there neither allocates nor touches the page
+ * tables; only binder_shrink() gives them back. Called with the proc's
+ * alloc_lock held, or from binder_mmap() before the proc has buffers.
+ */
 static int binder_update_page_range(struct binder_proc *proc, int allocate,
 				    void *start, void *end,
 				    struct vm_area_struct *vma)
@@ -668,8 +892,9 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 	void *page_addr;
 	unsigned long user_page_addr;
 	struct vm_struct tmp_area;
-	struct page **page;
+	struct binder_lru_page *page;
 	struct mm_struct *mm;
+	bool need_map = false;
 
 	binder_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "%d: %s pages %pK-%pK\n", proc->pid,
@@ -680,6 +905,19 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 
 	//trace_binder_update_page_range(proc, allocate, start, end);
 
+	if (allocate == 0)
+		goto free_range;
+
+	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
+		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+		if (page->page_ptr)
+			binder_lru_del(page);
+		else
+			need_map = true;
+	}
+	if (!need_map)
+		return 0;
+
 	if (vma)
 		mm = NULL;
 	else
@@ -695,9 +933,6 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 		}
 	}
 
-	if (allocate == 0)
-		goto free_range;
-
 	if (vma == NULL) {
 		pr_err("%d: binder_alloc_buf failed to map pages in userspace, no vma\n",
 			proc->pid);
@@ -709,16 +944,18 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 		struct page **page_array_ptr;
 		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
 
-		BUG_ON(*page);
-		*page = alloc_page(GFP_KERNEL | __GFP_HIGHMEM | __GFP_ZERO);
-		if (*page == NULL) {
+		if (page->page_ptr)
+			continue;
+		page->page_ptr = alloc_page(GFP_KERNEL | __GFP_HIGHMEM |
+					    __GFP_ZERO);
+		if (page->page_ptr == NULL) {
 			pr_err("%d: binder_alloc_buf failed for page at %pK\n",
 				proc->pid, page_addr);
 			goto err_alloc_page_failed;
 		}
 		tmp_area.addr = page_addr;
 		tmp_area.size = PAGE_SIZE + PAGE_SIZE /* guard page? */;
-		page_array_ptr = page;
+		page_array_ptr = &page->page_ptr;
 		ret = map_vm_area(&tmp_area, PAGE_KERNEL, &page_array_ptr);
 		if (ret) {
 			pr_err("%d: binder_alloc_buf failed to map page at %pK in kernel\n",
@@ -727,7 +964,7 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 		}
 		user_page_addr =
 			(uintptr_t)page_addr + proc->user_buffer_offset;
-		ret = vm_insert_page(vma, user_page_addr, page[0]);
+		ret = vm_insert_page(vma, user_page_addr, page->page_ptr);
 		if (ret) {
 			pr_err("%d: binder_alloc_buf failed to map page at %lx in userspace\n",
 			       proc->pid, user_page_addr);
@@ -742,21 +979,25 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 	return 0;
 
 free_range:
-	for (page_addr = end - PAGE_SIZE; page_addr >= start;
-	     page_addr -= PAGE_SIZE) {
+	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
 		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
-		if (vma)
-			zap_page_range(vma, (uintptr_t)page_addr +
-				proc->user_buffer_offset, PAGE_SIZE, NULL);
+		binder_lru_add(page);
+	}
+	return 0;
+
 err_vm_insert_page_failed:
-		unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
+	unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
 err_map_kernel_failed:
-		__free_page(*page);
-		*page = NULL;
+	__free_page(page->page_ptr);
+	page->page_ptr = NULL;
 err_alloc_page_failed:
-		;
-	}
 err_no_vma:
+	/* whatever is mapped in the range is free again */
+	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
+		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+		if (page->page_ptr)
+			binder_lru_add(page);
+	}
 	if (mm) {
 		up_write(&mm->mmap_sem);
 		mmput(mm);
@@ -764,13 +1005,83 @@ err_no_vma:
 	return -ENOMEM;
 }
 
-static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
-					      size_t data_size,
-					      size_t offsets_size,
-					      size_t extra_buffers_size,
-					      int is_async)
+/*
+ * Unmaps and frees a page taken off binder_lru, with the proc's
+ * alloc_lock held. Fails if the task's mmap_sem is busy.
+ */
+static bool binder_free_lru_page(struct binder_proc *proc,
+				 struct binder_lru_page *page)
+{
+	size_t index = page - proc->pages;
+	void *page_addr = proc->buffer + index * PAGE_SIZE;
+	struct vm_area_struct *vma;
+	struct mm_struct *mm;
+
+	mm = get_task_mm(proc->tsk);
+	if (mm) {
+		if (!down_read_trylock(&mm->mmap_sem)) {
+			mmput(mm);
+			return false;
+		}
+		vma = proc->vma;
+		if (vma && mm == proc->vma_vm_mm)
+			zap_page_range(vma, (uintptr_t)page_addr +
+				proc->user_buffer_offset, PAGE_SIZE, NULL);
+		up_read(&mm->mmap_sem);
+		mmput(mm);
+	}
+
+	unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
+	__free_page(page->page_ptr);
+	page->page_ptr = NULL;
+	return true;
+}
+
+static int binder_shrink(struct shrinker *s, struct shrink_control *sc)
 {
-	struct rb_node *n = proc->free_buffers.rb_node;
+	struct binder_lru_page *page;
+	struct binder_proc *proc;
+	unsigned long nr = sc->nr_to_scan;
+
+	while (nr--) {
+		spin_lock(&binder_lru_lock);
+		if (list_empty(&binder_lru)) {
+			spin_unlock(&binder_lru_lock);
+			break;
+		}
+		page = list_first_entry(&binder_lru, struct binder_lru_page,
+					lru);
+		proc = page->proc;
+		/* the proc may be mid-allocation, maybe in our reclaim */
+		if (!mutex_trylock(&proc->alloc_lock)) {
+			list_move_tail(&page->lru, &binder_lru);
+			spin_unlock(&binder_lru_lock);
+			continue;
+		}
+		list_del_init(&page->lru);
+		binder_lru_count--;
+		spin_unlock(&binder_lru_lock);
+
+		if (!binder_free_lru_page(proc, page))
+			binder_lru_add(page);
+		mutex_unlock(&proc->alloc_lock);
+	}
+
+	return ACCESS_ONCE(binder_lru_count);
+}
+
+static struct shrinker binder_shrinker = {
+	.shrink = binder_shrink,
+	.seeks = DEFAULT_SEEKS,
+};
+
+static struct binder_buffer *__binder_alloc_buf(struct binder_proc *proc,
+						size_t data_size,
+						size_t offsets_size,
+						size_t extra_buffers_size,
+						int is_async)
+{
+	struct rb_node *n;
 	struct binder_buffer *buffer;
 	size_t buffer_size;
 	struct rb_node *best_fit = NULL;
@@ -783,6 +1094,9 @@ static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 		       proc->pid);
 		return NULL;
 	}
+	/* pairs with binder_mmap(), which sets up the buffers first */
+	smp_rmb();
+	n = proc->free_buffers.rb_node;
 
 	data_offsets_size = ALIGN(data_size, sizeof(void *)) +
 		ALIGN(offsets_size, sizeof(void *));
@@ -867,6 +1181,9 @@ static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 	buffer->offsets_size = offsets_size;
 	buffer->extra_buffers_size = extra_buffers_size;
 	buffer->async_transaction = is_async;
+	buffer->allow_user_free = 0;
+	buffer->transaction = NULL;
+	buffer->target_node = NULL;
 	if (is_async) {
 		proc->free_async_space -= size + sizeof(struct binder_buffer);
 		binder_debug(BINDER_DEBUG_BUFFER_ALLOC_ASYNC,
@@ -877,6 +1194,25 @@ static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 	return buffer;
 }
 
+/*
+ * Called without binder_main_lock. The buffer belongs to the caller, and
+ * cannot be freed by userspace, until its transaction is queued.
+ */
+static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
+					      size_t data_size,
+					      size_t offsets_size,
+					      size_t extra_buffers_size,
+					      int is_async)
+{
+	struct binder_buffer *buffer;
+
+	mutex_lock(&proc->alloc_lock);
+	buffer = __binder_alloc_buf(proc, data_size, offsets_size,
+				    extra_buffers_size, is_async);
+	mutex_unlock(&proc->alloc_lock);
+	return buffer;
+}
+
 static void *buffer_start_page(struct binder_buffer *buffer)
 {
 	return (void *)((uintptr_t)buffer & PAGE_MASK);
@@ -932,8 +1268,8 @@ static void binder_delete_free_buffer(struct binder_proc *proc,
 	}
 }
 
-static void binder_free_buf(struct binder_proc *proc,
-			    struct binder_buffer *buffer)
+static void __binder_free_buf(struct binder_proc *proc,
+			      struct binder_buffer *buffer)
 {
 	size_t size, buffer_size;
 
@@ -987,6 +1323,14 @@ static void binder_free_buf(struct binder_proc *proc,
 	binder_insert_free_buffer(proc, buffer);
 }
 
+static void binder_free_buf(struct binder_proc *proc,
+			    struct binder_buffer *buffer)
+{
+	mutex_lock(&proc->alloc_lock);
+	__binder_free_buf(proc, buffer);
+	mutex_unlock(&proc->alloc_lock);
+}
+
 static struct binder_node *binder_get_node(struct binder_proc *proc,
 					   binder_uintptr_t ptr)
 {
@@ -1657,11 +2001,25 @@ static int binder_translate_binder(struct flat_binder_object *fp,
 
 	node = binder_get_node(proc, fp->binder);
 	if (!node) {
+		int policy = (fp->flags & FLAT_BINDER_FLAG_SCHED_POLICY_MASK) >>
+			FLAT_BINDER_FLAG_SCHED_POLICY_SHIFT;
+		int priority = fp->flags & FLAT_BINDER_FLAG_PRIORITY_MASK;
+
+		if (is_rt_policy(policy) &&
+		    (priority < 1 || priority >= MAX_USER_RT_PRIO)) {
+			binder_user_error("%d:%d sending u%016llx node with invalid rt priority %d\n",
+					  proc->pid, thread->pid,
+					  (u64)fp->binder, priority);
+			return -EINVAL;
+		}
+
 		node = binder_new_node(proc, fp->binder, fp->cookie);
 		if (!node)
 			return -ENOMEM;
 
-		node->min_priority = fp->flags & FLAT_BINDER_FLAG_PRIORITY_MASK;
+		node->sched_policy = policy;
+		node->min_priority = to_kernel_prio(policy, priority);
+		node->inherit_rt = !!(fp->flags & FLAT_BINDER_FLAG_INHERIT_RT);
 		node->accept_fds = !!(fp->flags & FLAT_BINDER_FLAG_ACCEPTS_FDS);
 	}
 	if (fp->cookie != node->cookie) {
@@ -1911,6 +2269,24 @@ static int binder_fixup_parent(struct binder_transaction *t,
 	return 0;
 }
 
+/*
+ * The innermost thread of target_proc that is waiting for a reply from
+ * @thread, directly or through a chain of nested calls; a new call is
+ * delivered to it rather than to an arbitrary thread of target_proc.
+ */
+static struct binder_thread *binder_find_caller(struct binder_thread *thread,
+						struct binder_proc *target_proc)
+{
+	struct binder_thread *target_thread = NULL;
+	struct binder_transaction *tmp;
+
+	for (tmp = thread->transaction_stack; tmp; tmp = tmp->from_parent) {
+		if (tmp->from && tmp->from->proc == target_proc)
+			target_thread = tmp->from;
+	}
+	return target_thread;
+}
+
 static void binder_transaction(struct binder_proc *proc,
 			       struct binder_thread *thread,
 			       struct binder_transaction_data *tr, int reply,
@@ -1933,8 +2309,11 @@ static void binder_transaction(struct binder_proc *proc,
 	struct binder_buffer_object *last_fixup_obj = NULL;
 	binder_size_t last_fixup_min_off = 0;
 	struct binder_context *context = proc->context;
+	const char *copy_error;
+	int t_debug_id = ++binder_last_id;
 
 	e = binder_transaction_log_add(&binder_transaction_log);
+	e->debug_id = t_debug_id;
 	e->call_type = reply ? 2 : !!(tr->flags & TF_ONE_WAY);
 	e->from_proc = proc->pid;
 	e->from_thread = thread->pid;
@@ -1951,7 +2330,7 @@ static void binder_transaction(struct binder_proc *proc,
 			return_error = BR_FAILED_REPLY;
 			goto err_empty_call_stack;
 		}
-		binder_set_nice(in_reply_to->saved_priority);
+		binder_set_priority(in_reply_to->saved_priority);
 		if (in_reply_to->to_thread != thread) {
 			binder_user_error("%d:%d got reply transaction with bad transaction stack, transaction %d has target %d:%d\n",
 				proc->pid, thread->pid, in_reply_to->debug_id,
@@ -2021,21 +2400,10 @@ static void binder_transaction(struct binder_proc *proc,
 				return_error = BR_FAILED_REPLY;
 				goto err_bad_call_stack;
 			}
-			while (tmp) {
-				if (tmp->from && tmp->from->proc == target_proc)
-					target_thread = tmp->from;
-				tmp = tmp->from_parent;
-			}
+			target_thread = binder_find_caller(thread,
+							   target_proc);
 		}
 	}
-	if (target_thread) {
-		e->to_thread = target_thread->pid;
-		target_list = &target_thread->todo;
-		target_wait = &target_thread->wait;
-	} else {
-		target_list = &target_proc->todo;
-		target_wait = &target_proc->wait;
-	}
 	e->to_proc = target_proc->pid;
 
 	/* TODO: reuse incoming transaction for reply */
@@ -2053,8 +2421,8 @@ static void binder_transaction(struct binder_proc *proc,
 	}
 	binder_stats_created(BINDER_STAT_TRANSACTION_COMPLETE);
 
-	t->debug_id = ++binder_last_id;
-	e->debug_id = t->debug_id;
+	t->debug_id = t_debug_id;
+	t->start = reply ? in_reply_to->start : ktime_get();
 
 	if (reply)
 		binder_debug(BINDER_DEBUG_TRANSACTION,
@@ -2081,46 +2449,78 @@ static void binder_transaction(struct binder_proc *proc,
 		t->from = NULL;
 	t->sender_euid = proc->tsk->cred->euid;
 	t->to_proc = target_proc;
-	t->to_thread = target_thread;
 	t->code = tr->code;
 	t->flags = tr->flags;
-	t->priority = task_nice(current);
+	binder_get_priority(current, &t->priority);
 
 	//trace_binder_transaction(reply, t, target_node);
 
+	/*
+	 * Allocating the buffer may have to reclaim pages and copying the
+	 * data in may fault, so do both without binder_main_lock. The
+	 * tmp_ref keeps target_proc and its buffer space, the strong
+	 * reference keeps target_node; target_thread is looked up again
+	 * afterwards as it may have exited meanwhile.
+	 */
+	if (target_node)
+		binder_inc_node(target_node, 1, 0, NULL);
+	target_proc->tmp_ref++;
+	binder_unlock(__func__);
+
+	copy_error = NULL;
 	t->buffer = binder_alloc_buf(target_proc, tr->data_size,
 		tr->offsets_size, extra_buffers_size,
 		!reply && (t->flags & TF_ONE_WAY));
+	if (t->buffer) {
+		off_start = (binder_size_t *)(t->buffer->data +
+				ALIGN(tr->data_size, sizeof(void *)));
+		offp = off_start;
+
+		if (copy_from_user(t->buffer->data,
+				   (const void __user *)(uintptr_t)
+				   tr->data.ptr.buffer, tr->data_size))
+			copy_error = "data";
+		else if (copy_from_user(offp, (const void __user *)(uintptr_t)
+					tr->data.ptr.offsets, tr->offsets_size))
+			copy_error = "offsets";
+	}
+
+	binder_lock(__func__);
+
 	if (t->buffer == NULL) {
+		if (target_node)
+			binder_dec_node(target_node, 1, 0);
 		return_error = BR_FAILED_REPLY;
 		goto err_binder_alloc_buf_failed;
 	}
-	t->buffer->allow_user_free = 0;
 	t->buffer->debug_id = t->debug_id;
 	t->buffer->transaction = t;
 	t->buffer->target_node = target_node;
 	//trace_binder_transaction_alloc_buf(t->buffer);
-	if (target_node)
-		binder_inc_node(target_node, 1, 0, NULL);
 
-	off_start = (binder_size_t *)(t->buffer->data +
-				      ALIGN(tr->data_size, sizeof(void *)));
-	offp = off_start;
-
-	if (copy_from_user(t->buffer->data, (const void __user *)(uintptr_t)
-			   tr->data.ptr.buffer, tr->data_size)) {
-		binder_user_error("%d:%d got transaction with invalid data ptr\n",
-				proc->pid, thread->pid);
-		return_error = BR_FAILED_REPLY;
+	if (target_proc->is_dead ||
+	    (reply && in_reply_to->from != target_thread)) {
+		return_error = BR_DEAD_REPLY;
 		goto err_copy_data_failed;
 	}
-	if (copy_from_user(offp, (const void __user *)(uintptr_t)
-			   tr->data.ptr.offsets, tr->offsets_size)) {
-		binder_user_error("%d:%d got transaction with invalid offsets ptr\n",
-				proc->pid, thread->pid);
+	if (copy_error) {
+		binder_user_error("%d:%d got transaction with invalid %s ptr\n",
+				proc->pid, thread->pid, copy_error);
 		return_error = BR_FAILED_REPLY;
 		goto err_copy_data_failed;
 	}
+
+	if (!reply && !(tr->flags & TF_ONE_WAY) && thread->transaction_stack)
+		target_thread = binder_find_caller(thread, target_proc);
+	t->to_thread = target_thread;
+	if (target_thread) {
+		e->to_thread = target_thread->pid;
+		target_list = &target_thread->todo;
+		target_wait = &target_thread->wait;
+	} else {
+		target_list = &target_proc->todo;
+		target_wait = &target_proc->wait;
+	}
 	if (!IS_ALIGNED(tr->offsets_size, sizeof(binder_size_t))) {
 		binder_user_error("%d:%d got transaction with invalid offsets size, %lld\n",
 				proc->pid, thread->pid, (u64)tr->offsets_size);
@@ -2265,6 +2665,9 @@ static void binder_transaction(struct binder_proc *proc,
 	}
 	if (reply) {
 		BUG_ON(t->buffer->async_transaction != 0);
+		if (in_reply_to->buffer && in_reply_to->buffer->target_node)
+			binder_latency_add(&in_reply_to->buffer->target_node->rtt,
+					   in_reply_to->start);
 		binder_pop_transaction(target_thread, in_reply_to);
 	} else if (!(t->flags & TF_ONE_WAY)) {
 		BUG_ON(t->buffer->async_transaction != 0);
@@ -2286,6 +2689,8 @@ static void binder_transaction(struct binder_proc *proc,
 	list_add_tail(&tcomplete->entry, &thread->todo);
 	if (target_wait)
 		wake_up_interruptible(target_wait);
+	binder_proc_dec_tmpref(target_proc);
+	binder_transaction_log_done(e, t_debug_id);
 	return;
 
 err_translate_failed:
@@ -2298,6 +2703,7 @@ err_copy_data_failed:
 	t->buffer->transaction = NULL;
 	binder_free_buf(target_proc, t->buffer);
 err_binder_alloc_buf_failed:
+	binder_proc_dec_tmpref(target_proc);
 	kfree(tcomplete);
 	binder_stats_deleted(BINDER_STAT_TRANSACTION_COMPLETE);
 err_alloc_tcomplete_failed:
@@ -2318,6 +2724,8 @@ err_no_context_mgr_node:
 		struct binder_transaction_log_entry *fe;
 		fe = binder_transaction_log_add(&binder_transaction_log_failed);
 		*fe = *e;
+		binder_transaction_log_done(e, t_debug_id);
+		binder_transaction_log_done(fe, t_debug_id);
 	}
 
 	BUG_ON(thread->return_error != BR_OK);
@@ -2790,7 +3198,7 @@ retry:
 			wait_event_interruptible(binder_user_error_wait,
 						 binder_stop_on_user_error < 2);
 		}
-		binder_set_nice(proc->default_priority);
+		binder_set_priority(proc->default_priority);
 		if (non_block) {
 			if (!binder_has_proc_work(proc, thread))
 				ret = -EAGAIN;
@@ -2961,17 +3369,13 @@ retry:
 			struct binder_node *target_node = t->buffer->target_node;
 			tr.target.ptr = target_node->ptr;
 			tr.cookie =  target_node->cookie;
-			t->saved_priority = task_nice(current);
-			if (t->priority < target_node->min_priority &&
-			    !(t->flags & TF_ONE_WAY))
-				binder_set_nice(t->priority);
-			else if (!(t->flags & TF_ONE_WAY) ||
-				 t->saved_priority > target_node->min_priority)
-				binder_set_nice(target_node->min_priority);
+			binder_transaction_priority(t, target_node);
+			binder_latency_add(&proc->wait, t->start);
 			cmd = BR_TRANSACTION;
 		} else {
 			tr.target.ptr = 0;
 			tr.cookie = 0;
+			binder_latency_add(&proc->rtt, t->start);
 			cmd = BR_REPLY;
 		}
 		tr.code = t->code;
@@ -3381,7 +3785,7 @@ static struct vm_operations_struct binder_vm_ops = {
 
 static int binder_mmap(struct file *filp, struct vm_area_struct *vma)
 {
-	int ret;
+	int ret, i;
 	struct vm_struct *area;
 	struct binder_proc *proc = filp->private_data;
 	const char *failure_string;
@@ -3438,6 +3842,10 @@ static int binder_mmap(struct file *filp, struct vm_area_struct *vma)
 		goto err_alloc_pages_failed;
 	}
 	proc->buffer_size = vma->vm_end - vma->vm_start;
+	for (i = 0; i < proc->buffer_size / PAGE_SIZE; i++) {
+		INIT_LIST_HEAD(&proc->pages[i].lru);
+		proc->pages[i].proc = proc;
+	}
 
 	vma->vm_ops = &binder_vm_ops;
 	vma->vm_private_data = proc;
@@ -3453,7 +3861,8 @@ static int binder_mmap(struct file *filp, struct vm_area_struct *vma)
 	buffer->free = 1;
 	binder_insert_free_buffer(proc, buffer);
 	proc->free_async_space = proc->buffer_size / 2;
-	barrier();
+	/* senders allocate without binder_main_lock once they see vma */
+	smp_wmb();
 	proc->files = get_files_struct(current);
 	proc->vma = vma;
 	proc->vma_vm_mm = vma->vm_mm;
@@ -3491,9 +3900,10 @@ static int binder_open(struct inode *nodp, struct file *filp)
 		return -ENOMEM;
 	get_task_struct(current->group_leader);
 	proc->tsk = current->group_leader;
+	mutex_init(&proc->alloc_lock);
 	INIT_LIST_HEAD(&proc->todo);
 	init_waitqueue_head(&proc->wait);
-	proc->default_priority = task_nice(current);
+	binder_get_priority(current, &proc->default_priority);
 	binder_dev = container_of(filp->private_data, struct binder_device,
 				  miscdev);
 	proc->context = &binder_dev->context;
@@ -3564,19 +3974,90 @@ static int binder_release(struct inode *nodp, struct file *filp)
 	return 0;
 }
 
+/*
+ * Frees what is left of a released proc once no sender is filling one of
+ * its buffers any more. Called with binder_main_lock held.
+ */
+static void binder_free_proc(struct binder_proc *proc)
+{
+	struct binder_transaction *t;
+	struct rb_node *n;
+	int buffers, page_count;
+
+	buffers = 0;
+	while ((n = rb_first(&proc->allocated_buffers))) {
+		struct binder_buffer *buffer;
+
+		buffer = rb_entry(n, struct binder_buffer, rb_node);
+
+		t = buffer->transaction;
+		if (t) {
+			t->buffer = NULL;
+			buffer->transaction = NULL;
+			pr_err("release proc %d, transaction %d, not freed\n",
+			       proc->pid, t->debug_id);
+			/*BUG();*/
+		}
+
+		binder_free_buf(proc, buffer);
+		buffers++;
+	}
+
+	binder_stats_deleted(BINDER_STAT_PROC);
+
+	/* the pages of freed buffers stay mapped until now */
+	page_count = 0;
+	mutex_lock(&proc->alloc_lock);
+	if (proc->pages) {
+		int i;
+
+		for (i = 0; i < proc->buffer_size / PAGE_SIZE; i++) {
+			void *page_addr;
+
+			binder_lru_del(&proc->pages[i]);
+			if (!proc->pages[i].page_ptr)
+				continue;
+
+			page_addr = proc->buffer + i * PAGE_SIZE;
+			binder_debug(BINDER_DEBUG_BUFFER_ALLOC,
+				     "%s: %d: page %d at %pK not freed\n",
+				     __func__, proc->pid, i, page_addr);
+			unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
+			__free_page(proc->pages[i].page_ptr);
+			page_count++;
+		}
+		kfree(proc->pages);
+		vfree(proc->buffer);
+	}
+	mutex_unlock(&proc->alloc_lock);
+
+	put_task_struct(proc->tsk);
+
+	binder_debug(BINDER_DEBUG_OPEN_CLOSE,
+		     "%s: %d buffers %d, pages %d\n",
+		     __func__, proc->pid, buffers, page_count);
+
+	kfree(proc);
+}
+
+static void binder_proc_dec_tmpref(struct binder_proc *proc)
+{
+	if (!--proc->tmp_ref && proc->is_dead)
+		binder_free_proc(proc);
+}
+
 static void binder_deferred_release(struct binder_proc *proc)
 {
 	struct hlist_node *pos;
-	struct binder_transaction *t;
 	struct binder_context *context = proc->context;
 	struct rb_node *n;
-	int threads, nodes, incoming_refs, outgoing_refs, buffers,
-		active_transactions, page_count;
+	int threads, nodes, incoming_refs, outgoing_refs, active_transactions;
 
 	BUG_ON(proc->vma);
 	BUG_ON(proc->files);
 
 	hlist_del(&proc->proc_node);
+	proc->is_dead = true;
 
 	if (context->binder_context_mgr_node &&
 	    context->binder_context_mgr_node->proc == proc) {
@@ -3648,57 +4129,13 @@ static void binder_deferred_release(struct binder_proc *proc)
 	binder_release_work(&proc->todo);
 	binder_release_work(&proc->delivered_death);
 
-	buffers = 0;
-	while ((n = rb_first(&proc->allocated_buffers))) {
-		struct binder_buffer *buffer;
-
-		buffer = rb_entry(n, struct binder_buffer, rb_node);
-
-		t = buffer->transaction;
-		if (t) {
-			t->buffer = NULL;
-			buffer->transaction = NULL;
-			pr_err("release proc %d, transaction %d, not freed\n",
-			       proc->pid, t->debug_id);
-			/*BUG();*/
-		}
-
-		binder_free_buf(proc, buffer);
-		buffers++;
-	}
-
-	binder_stats_deleted(BINDER_STAT_PROC);
-
-	page_count = 0;
-	if (proc->pages) {
-		int i;
-
-		for (i = 0; i < proc->buffer_size / PAGE_SIZE; i++) {
-			void *page_addr;
-
-			if (!proc->pages[i])
-				continue;
-
-			page_addr = proc->buffer + i * PAGE_SIZE;
-			binder_debug(BINDER_DEBUG_BUFFER_ALLOC,
-				     "%s: %d: page %d at %pK not freed\n",
-				     __func__, proc->pid, i, page_addr);
-			unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
-			__free_page(proc->pages[i]);
-			page_count++;
-		}
-		kfree(proc->pages);
-		vfree(proc->buffer);
-	}
-
-	put_task_struct(proc->tsk);
-
 	binder_debug(BINDER_DEBUG_OPEN_CLOSE,
-		     "%s: %d threads %d, nodes %d (ref %d), refs %d, active transactions %d, buffers %d, pages %d\n",
+		     "%s: %d threads %d, nodes %d (ref %d), refs %d, active transactions %d\n",
 		     __func__, proc->pid, threads, nodes, incoming_refs,
-		     outgoing_refs, active_transactions, buffers, page_count);
+		     outgoing_refs, active_transactions);
 
-	kfree(proc);
+	if (!proc->tmp_ref)
+		binder_free_proc(proc);
 }
 
 static void binder_deferred_func(struct work_struct *work)
@@ -3733,7 +4170,7 @@ static void binder_deferred_func(struct work_struct *work)
 			binder_deferred_flush(proc);
 
 		if (defer & BINDER_DEFERRED_RELEASE)
-			binder_deferred_release(proc); /* frees proc */
+			binder_deferred_release(proc); /* may free proc */
 
 		binder_unlock(__func__);
 		if (files)
@@ -3759,13 +4196,14 @@ static void print_binder_transaction(struct seq_file *m, const char *prefix,
 				     struct binder_transaction *t)
 {
 	seq_printf(m,
-		   "%s %d: %pK from %d:%d to %d:%d code %x flags %x pri %ld r%d",
+		   "%s %d: %pK from %d:%d to %d:%d code %x flags %x pri %u:%d r%d",
 		   prefix, t->debug_id, t,
 		   t->from ? t->from->proc->pid : 0,
 		   t->from ? t->from->pid : 0,
 		   t->to_proc ? t->to_proc->pid : 0,
 		   t->to_thread ? t->to_thread->pid : 0,
-		   t->code, t->flags, t->priority, t->need_reply);
+		   t->code, t->flags, t->priority.sched_policy,
+		   t->priority.prio, t->need_reply);
 	if (t->buffer == NULL) {
 		seq_puts(m, " buffer free\n");
 		return;
@@ -3856,6 +4294,27 @@ static void print_binder_thread(struct seq_file *m,
 		m->count = start_pos;
 }
 
+static void print_binder_latency(struct seq_file *m, const char *prefix,
+				 struct binder_latency *lat)
+{
+	int i;
+	u32 count = 0;
+
+	for (i = 0; i < BINDER_LATENCY_BUCKETS; i++)
+		count += lat->bucket[i];
+	if (!count)
+		return;
+
+	seq_printf(m, "%s", prefix);
+	for (i = 0; i < BINDER_LATENCY_BUCKETS; i++) {
+		if (lat->bucket[i])
+			seq_printf(m, " %s%luus:%u",
+				   i == BINDER_LATENCY_BUCKETS - 1 ? ">=" : "",
+				   i ? 1UL << i : 0UL, lat->bucket[i]);
+	}
+	seq_puts(m, "\n");
+}
+
 static void print_binder_node(struct seq_file *m, struct binder_node *node)
 {
 	struct binder_ref *ref;
@@ -3878,6 +4337,7 @@ static void print_binder_node(struct seq_file *m, struct binder_node *node)
 			seq_printf(m, " %d", ref->proc->pid);
 	}
 	seq_puts(m, "\n");
+	print_binder_latency(m, "    rtt", &node->rtt);
 	list_for_each_entry(w, &node->async_todo, entry)
 		print_binder_work(m, "    ",
 				  "    pending async transaction", w);
@@ -3918,9 +4378,11 @@ static void print_binder_proc(struct seq_file *m,
 			print_binder_ref(m, rb_entry(n, struct binder_ref,
 						     rb_node_desc));
 	}
+	mutex_lock(&proc->alloc_lock);
 	for (n = rb_first(&proc->allocated_buffers); n != NULL; n = rb_next(n))
 		print_binder_buffer(m, "  buffer",
 				    rb_entry(n, struct binder_buffer, rb_node));
+	mutex_unlock(&proc->alloc_lock);
 	list_for_each_entry(w, &proc->todo, entry)
 		print_binder_work(m, "  ", "  pending transaction", w);
 	list_for_each_entry(w, &proc->delivered_death, entry) {
@@ -4053,8 +4515,10 @@ static void print_binder_proc_stats(struct seq_file *m,
 	seq_printf(m, "  refs: %d s %d w %d\n", count, strong, weak);
 
 	count = 0;
+	mutex_lock(&proc->alloc_lock);
 	for (n = rb_first(&proc->allocated_buffers); n != NULL; n = rb_next(n))
 		count++;
+	mutex_unlock(&proc->alloc_lock);
 	seq_printf(m, "  buffers: %d\n", count);
 
 	count = 0;
@@ -4068,6 +4532,8 @@ static void print_binder_proc_stats(struct seq_file *m,
 		}
 	}
 	seq_printf(m, "  pending transactions: %d\n", count);
+	print_binder_latency(m, "  rtt", &proc->rtt);
+	print_binder_latency(m, "  wait", &proc->wait);
 
 	print_binder_stats(m, "  ", &proc->stats);
 }
@@ -4158,25 +4624,37 @@ static int binder_proc_show(struct seq_file *m, void *unused)
 static void print_binder_transaction_log_entry(struct seq_file *m,
 					struct binder_transaction_log_entry *e)
 {
+	int debug_id = ACCESS_ONCE(e->debug_id_done);
+
+	/* pairs with binder_transaction_log_done() */
+	smp_rmb();
 	seq_printf(m,
-		   "%d: %s from %d:%d to %d:%d context %s node %d handle %d size %d:%d\n",
+		   "%d: %s from %d:%d to %d:%d context %s node %d handle %d size %d:%d%s\n",
 		   e->debug_id, (e->call_type == 2) ? "reply" :
 		   ((e->call_type == 1) ? "async" : "call "), e->from_proc,
 		   e->from_thread, e->to_proc, e->to_thread, e->context_name,
-		   e->to_node, e->target_handle, e->data_size, e->offsets_size);
+		   e->to_node, e->target_handle, e->data_size, e->offsets_size,
+		   (!debug_id || debug_id != e->debug_id) ?
+		   " (incomplete)" : "");
 }
 
 static int binder_transaction_log_show(struct seq_file *m, void *unused)
 {
 	struct binder_transaction_log *log = m->private;
+	unsigned int log_cur = atomic_read(&log->cur);
+	unsigned int count, cur;
 	int i;
 
-	if (log->full) {
-		for (i = log->next; i < ARRAY_SIZE(log->entry); i++)
-			print_binder_transaction_log_entry(m, &log->entry[i]);
+	count = log_cur + 1;
+	cur = count < ARRAY_SIZE(log->entry) && !log->full ?
+		0 : count % ARRAY_SIZE(log->entry);
+	if (count > ARRAY_SIZE(log->entry) || log->full)
+		count = ARRAY_SIZE(log->entry);
+	for (i = 0; i < count; i++) {
+		unsigned int index = cur++ % ARRAY_SIZE(log->entry);
+
+		print_binder_transaction_log_entry(m, &log->entry[index]);
 	}
-	for (i = 0; i < log->next; i++)
-		print_binder_transaction_log_entry(m, &log->entry[i]);
 	return 0;
 }
 
@@ -4238,6 +4716,8 @@ int binder64_init(void)
 	if (!binder_deferred_workqueue)
 		return -ENOMEM;
 
+	register_shrinker(&binder_shrinker);
+
 	binder_debugfs_dir_entry_root = debugfs_create_dir("binder", NULL);
 	if (binder_debugfs_dir_entry_root)
 		binder_debugfs_dir_entry_proc = debugfs_create_dir("proc",
@@ -4299,6 +4779,7 @@ err_init_binder_device_failed:
 err_alloc_device_names_failed:
 	debugfs_remove_recursive(binder_debugfs_dir_entry_root);
 
+	unregister_shrinker(&binder_shrinker);
 	destroy_workqueue(binder_deferred_workqueue);
 
 	return ret;
@@ -17,6 +17,11 @@
  * percentage of the cached memory is locked this can be very inaccurate
  * and processes may not get killed until the normal oom killer is triggered.
  *
+ * Setting /sys/module/lowmemorykiller/parameters/vmpressure_enable also
+ * kills from the last adj bucket whenever the system wide vmpressure
+ * reaches vmpressure_level percent, or medium pressure once swap_full
+ * percent of swap is in use.
+ *
  * Copyright (C) 2007-2008 Google, Inc.
  *
  * This software is licensed under the terms of the GNU General Public
@@ -41,7 +46,13 @@
 #include <linux/swap.h>
 #include <linux/ratelimit.h>
 #include <linux/rcupdate.h>
+#include <linux/rbtree.h>
+#include <linux/spinlock.h>
+#include <linux/err.h>
+#include <linux/ktime.h>
+#include <linux/vmpressure.h>
 #include <linux/notifier.h>
+#include <linux/ram_trace.h>
 #ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_DO_NOT_KILL_PROCESS
 #include <linux/string.h>
 #endif
@@ -62,6 +73,24 @@ static int lowmem_minfree[6] = {
 };
 static int lowmem_minfree_size = 4;
 
+/* matches vmpressure_level_med, reclaim is struggling from here on */
+#define LOWMEM_VMPRESSURE_MEDIUM	60
+
+static bool lowmem_vmpressure_enable;
+static unsigned long lowmem_vmpressure_level = 95;
+static int lowmem_swap_full = 90;
+
+/* when reclaim first reported medium pressure, 0 if it is not */
+static atomic64_t lowmem_pressure_start = ATOMIC64_INIT(0);
+
+enum lowmem_trigger {
+	LOWMEM_TRIGGER_MINFREE,
+	LOWMEM_TRIGGER_VMPRESSURE,
+};
+
+#define CREATE_TRACE_POINTS
+#include "lowmemorykiller_trace.h"
+
 #ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_DO_NOT_KILL_PROCESS
 #define MAX_NOT_KILLABLE_PROCESSES	25
 
@@ -118,12 +147,292 @@ static unsigned long lowmem_deathpending_timeout;
 			pr_err_ratelimited(x);			\
 	} while (0)
 
-static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
+/*
+ * Index of thread group leaders ordered by descending oom_score_adj so that
+ * lowmem_shrink() only has to look at tasks it could actually kill, highest
+ * bucket first. Ties are broken by address, which makes the order total and
+ * lets a scan resume after dropping the lock. Each node carries the adj it
+ * was sorted by, since signal->oom_score_adj may change before the task is
+ * repositioned. Updated from fork, exit, exec and every oom_score_adj writer.
+ */
+static DEFINE_SPINLOCK(lowmem_adj_tree_lock);
+static struct rb_root lowmem_adj_tree = RB_ROOT;
+
+/* scan cost, exported read-only as module parameters */
+static unsigned long lowmem_scan_count;
+static unsigned long lowmem_scan_tasks;
+
+#define LOWMEM_SCAN_BATCH	16
+
+static bool lowmem_adj_before(int adj, struct task_struct *task,
+			      int other_adj, struct task_struct *other)
+{
+	if (adj != other_adj)
+		return adj > other_adj;
+	return task < other;
+}
+
+static void __lowmem_adj_tree_insert(struct task_struct *task)
+{
+	struct rb_node **link = &lowmem_adj_tree.rb_node;
+	struct rb_node *parent = NULL;
+	struct task_struct *entry;
+	int adj = task->signal->oom_score_adj;
+
+	while (*link) {
+		parent = *link;
+		entry = rb_entry(parent, struct task_struct, adj_node);
+		if (lowmem_adj_before(adj, task, entry->adj_node_key, entry))
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+
+	task->adj_node_key = adj;
+	rb_link_node(&task->adj_node, parent, link);
+	rb_insert_color(&task->adj_node, &lowmem_adj_tree);
+}
+
+static void __lowmem_adj_tree_erase(struct task_struct *task)
+{
+	if (RB_EMPTY_NODE(&task->adj_node))
+		return;
+
+	rb_erase(&task->adj_node, &lowmem_adj_tree);
+	RB_CLEAR_NODE(&task->adj_node);
+}
+
+/*
+ * The lock nests inside tasklist_lock, which is taken for reading from
+ * interrupts, so it must always be taken with interrupts disabled.
+ */
+void lowmem_adj_tree_add(struct task_struct *task)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&lowmem_adj_tree_lock, flags);
+	__lowmem_adj_tree_insert(task);
+	spin_unlock_irqrestore(&lowmem_adj_tree_lock, flags);
+}
+
+void lowmem_adj_tree_del(struct task_struct *task)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&lowmem_adj_tree_lock, flags);
+	__lowmem_adj_tree_erase(task);
+	spin_unlock_irqrestore(&lowmem_adj_tree_lock, flags);
+}
+
+/* Reposition @task's thread group after its oom_score_adj changed. */
+void lowmem_adj_tree_update(struct task_struct *task)
+{
+	struct task_struct *leader;
+	unsigned long flags;
+
+	rcu_read_lock();
+	spin_lock_irqsave(&lowmem_adj_tree_lock, flags);
+	leader = ACCESS_ONCE(task->group_leader);
+	if (!RB_EMPTY_NODE(&leader->adj_node) &&
+	    leader->adj_node_key != leader->signal->oom_score_adj) {
+		__lowmem_adj_tree_erase(leader);
+		__lowmem_adj_tree_insert(leader);
+	}
+	spin_unlock_irqrestore(&lowmem_adj_tree_lock, flags);
+	rcu_read_unlock();
+}
+
+/*
+ * Take references on up to LOWMEM_SCAN_BATCH tasks ordered after the cursor
+ * (@after_adj, @after) whose adj is at least @min_adj. Their adj is stored
+ * in @adj so the caller can move the cursor on. Returns the number taken.
+ */
+static int lowmem_adj_tree_collect(struct task_struct **tasks, int *adj,
+				   int after_adj, struct task_struct *after,
+				   int min_adj)
+{
+	struct rb_node *node, *next = NULL;
+	struct task_struct *entry;
+	int n = 0;
+
+	spin_lock_irq(&lowmem_adj_tree_lock);
+	node = lowmem_adj_tree.rb_node;
+	while (node) {
+		entry = rb_entry(node, struct task_struct, adj_node);
+		if (lowmem_adj_before(after_adj, after, entry->adj_node_key,
+				      entry)) {
+			next = node;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+
+	for (node = next; node && n < LOWMEM_SCAN_BATCH; node = rb_next(node)) {
+		entry = rb_entry(node, struct task_struct, adj_node);
+		if (entry->adj_node_key < min_adj)
+			break;
+		get_task_struct(entry);
+		tasks[n] = entry;
+		adj[n] = entry->adj_node_key;
+		n++;
+	}
+	spin_unlock_irq(&lowmem_adj_tree_lock);
+
+	return n;
+}
+
+/*
+ * Pick the largest task in the highest oom_score_adj bucket at or above
+ * @min_score_adj. Returns it with a reference held, NULL if there is none,
+ * or ERR_PTR(-EBUSY) while an earlier victim is still dying.
+ */
+static struct task_struct *lowmem_select(int min_score_adj, int *sizep,
+					 int *adjp)
 {
 	struct task_struct *tsk;
 	struct task_struct *selected = NULL;
-	int rem = 0;
+	struct task_struct *batch[LOWMEM_SCAN_BATCH];
+	int batch_adj[LOWMEM_SCAN_BATCH];
+	struct task_struct *cursor = NULL;
+	int cursor_adj = OOM_SCORE_ADJ_MAX + 1;
+	bool deathpending = false;
 	int tasksize;
+	int i, n;
+	int selected_tasksize = 0;
+	int selected_oom_score_adj = min_score_adj;
+
+	lowmem_scan_count++;
+
+	/*
+	 * Once a victim is picked only its own bucket can still beat it, so
+	 * the walk stops at the first task with a lower adj.
+	 */
+	while (!deathpending &&
+	       (n = lowmem_adj_tree_collect(batch, batch_adj, cursor_adj,
+					    cursor, selected_oom_score_adj))) {
+		/* only compared against, never dereferenced */
+		cursor = batch[n - 1];
+		cursor_adj = batch_adj[n - 1];
+		lowmem_scan_tasks += n;
+
+		rcu_read_lock();
+		for (i = 0; i < n && !deathpending; i++) {
+			struct task_struct *p;
+			int oom_score_adj;
+
+			tsk = batch[i];
+			if (tsk->flags & PF_KTHREAD)
+				continue;
+
+			p = find_lock_task_mm(tsk);
+			if (!p)
+				continue;
+
+			if (test_tsk_thread_flag(p, TIF_MEMDIE) &&
+			    time_before_eq(jiffies, lowmem_deathpending_timeout)) {
+				task_unlock(p);
+				deathpending = true;
+				break;
+			}
+			oom_score_adj = p->signal->oom_score_adj;
+			if (oom_score_adj < min_score_adj) {
+				task_unlock(p);
+				continue;
+			}
+			tasksize = get_mm_rss(p->mm);
+			task_unlock(p);
+			if (tasksize <= 0)
+				continue;
+			if (selected) {
+				if (oom_score_adj < selected_oom_score_adj)
+					continue;
+				if (oom_score_adj == selected_oom_score_adj &&
+				    tasksize <= selected_tasksize)
+					continue;
+			}
+
+#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_DO_NOT_KILL_PROCESS
+			if (is_in_donotkill_proc_list(p->comm)) {
+				lowmem_print_ratelimited(2, "[lmk] the process '%s' is inside the donotkill_proc_names\n", p->comm);
+				lowmem_print_ratelimited(2, "[lmk] set oom_score_adj from %d to %d for (%s)\n", p->signal->oom_score_adj, 0, p->comm);
+				p->signal->oom_score_adj = 0;
+				lowmem_adj_tree_update(p);
+				continue;
+			}
+#endif
+
+			get_task_struct(p);
+			if (selected)
+				put_task_struct(selected);
+			selected = p;
+			selected_tasksize = tasksize;
+			selected_oom_score_adj = oom_score_adj;
+			lowmem_print(2, "select '%s' (%d), adj %d, size %d, to kill\n",
+				     p->comm, p->pid, oom_score_adj, tasksize);
+		}
+		rcu_read_unlock();
+
+		for (i = 0; i < n; i++)
+			put_task_struct(batch[i]);
+	}
+
+	if (deathpending) {
+		if (selected)
+			put_task_struct(selected);
+		return ERR_PTR(-EBUSY);
+	}
+
+	*sizep = selected_tasksize;
+	*adjp = selected_oom_score_adj;
+	return selected;
+}
+
+/*
+ * Kill @selected and drop the reference lowmem_select() took. Returns false
+ * if the task turned out to be protected instead.
+ */
+static bool lowmem_kill(struct task_struct *selected, int tasksize, int adj,
+			enum lowmem_trigger trigger)
+{
+	s64 start = atomic64_read(&lowmem_pressure_start);
+	s64 latency_us = 0;
+
+#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_DO_NOT_KILL_PROCESS
+	if (is_in_donotkill_proc_list(selected->comm)) {
+		lowmem_print(1, "[lmk] the process '%s' is inside the donotkill_proc_names\n", selected->comm);
+		lowmem_print(2, "[lmk] set oom_score_adj from %d to %d for (%s)\n", selected->signal->oom_score_adj, 0, selected->comm);
+		selected->signal->oom_score_adj = 0;
+		lowmem_adj_tree_update(selected);
+		put_task_struct(selected);
+		/* give the system time to free up the memory */
+		msleep_interruptible(20);
+		return false;
+	}
+#endif
+
+	lowmem_deathpending_timeout = jiffies + HZ;
+	send_sig(SIGKILL, selected, 0);
+	set_tsk_thread_flag(selected, TIF_MEMDIE);
+
+	/* the pressure that led here is being dealt with */
+	if (start && atomic64_cmpxchg(&lowmem_pressure_start, start, 0) == start)
+		latency_us = div_s64(ktime_to_ns(ktime_get()) - start,
+				     NSEC_PER_USEC);
+	trace_lowmemory_kill(selected, adj,
+			     tasksize * (long)(PAGE_SIZE / 1024),
+			     latency_us, trigger);
+	ram_trace_log(RAM_TRACE_LMK, selected->pid, adj,
+		      tasksize * (PAGE_SIZE / 1024));
+	put_task_struct(selected);
+
+	return true;
+}
+
+static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
+{
+	struct task_struct *selected;
+	int rem = 0;
 	int i;
 	int min_score_adj = OOM_SCORE_ADJ_MAX + 1;
 	int minfree = 0;
@@ -158,95 +467,32 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 			     sc->nr_to_scan, sc->gfp_mask, rem);
 		return rem;
 	}
-	selected_oom_score_adj = min_score_adj;
 
-	rcu_read_lock();
-	for_each_process(tsk) {
-		struct task_struct *p;
-		int oom_score_adj;
-
-		if (tsk->flags & PF_KTHREAD)
-			continue;
-
-		p = find_lock_task_mm(tsk);
-		if (!p)
-			continue;
-
-		if (test_tsk_thread_flag(p, TIF_MEMDIE) &&
-		    time_before_eq(jiffies, lowmem_deathpending_timeout)) {
-			task_unlock(p);
-			rcu_read_unlock();
-			return 0;
-		}
-		oom_score_adj = p->signal->oom_score_adj;
-		if (oom_score_adj < min_score_adj) {
-			task_unlock(p);
-			continue;
-		}
-		tasksize = get_mm_rss(p->mm);
-		task_unlock(p);
-		if (tasksize <= 0)
-			continue;
-		if (selected) {
-			if (oom_score_adj < selected_oom_score_adj)
-				continue;
-			if (oom_score_adj == selected_oom_score_adj &&
-			    tasksize <= selected_tasksize)
-				continue;
-		}
-
-#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_DO_NOT_KILL_PROCESS
-		if (is_in_donotkill_proc_list(p->comm)) {
-			lowmem_print_ratelimited(2, "[lmk] the process '%s' is inside the donotkill_proc_names\n", p->comm);
-			lowmem_print_ratelimited(2, "[lmk] set oom_score_adj from %d to %d for (%s)\n", p->signal->oom_score_adj, 0, p->comm);
-			p->signal->oom_score_adj = 0;
-			continue;
-		}
-#endif
+	selected = lowmem_select(min_score_adj, &selected_tasksize,
+				 &selected_oom_score_adj);
+	if (IS_ERR(selected))
+		return 0;
 
-		selected = p;
-		selected_tasksize = tasksize;
-		selected_oom_score_adj = oom_score_adj;
-		lowmem_print(2, "select '%s' (%d), adj %d, size %d, to kill\n",
-			     p->comm, p->pid, oom_score_adj, tasksize);
-	}
 	if (selected) {
-#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_DO_NOT_KILL_PROCESS
-		if (!is_in_donotkill_proc_list(selected->comm)) {
-#endif
-			lowmem_print(1, "Killing '%s' (%d), adj %d,\n" \
-				"   to free %ldkB on behalf of '%s' (%d) because\n" \
-				"   cache %ldkB is below limit %ldkB for oom_score_adj %d\n" \
-				"   Free memory is %ldkB above reserved\n",
-			     selected->comm, selected->pid,
-			     selected_oom_score_adj,
-			     selected_tasksize * (long)(PAGE_SIZE / 1024),
-			     current->comm, current->pid,
-			     other_file * (long)(PAGE_SIZE / 1024),
-			     minfree * (long)(PAGE_SIZE / 1024),
-			     min_score_adj,
-			     other_free * (long)(PAGE_SIZE / 1024));
-			lowmem_deathpending_timeout = jiffies + HZ;
-			send_sig(SIGKILL, selected, 0);
-			set_tsk_thread_flag(selected, TIF_MEMDIE);
+		lowmem_print(1, "Killing '%s' (%d), adj %d,\n" \
+			"   to free %ldkB on behalf of '%s' (%d) because\n" \
+			"   cache %ldkB is below limit %ldkB for oom_score_adj %d\n" \
+			"   Free memory is %ldkB above reserved\n",
+		     selected->comm, selected->pid,
+		     selected_oom_score_adj,
+		     selected_tasksize * (long)(PAGE_SIZE / 1024),
+		     current->comm, current->pid,
+		     other_file * (long)(PAGE_SIZE / 1024),
+		     minfree * (long)(PAGE_SIZE / 1024),
+		     min_score_adj,
+		     other_free * (long)(PAGE_SIZE / 1024));
+		if (lowmem_kill(selected, selected_tasksize,
+				selected_oom_score_adj, LOWMEM_TRIGGER_MINFREE))
 			rem -= selected_tasksize;
-#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_DO_NOT_KILL_PROCESS
-		} else {
-			lowmem_print(1, "[lmk] the process '%s' is inside the donotkill_proc_names\n", selected->comm);
-			lowmem_print(2, "[lmk] set oom_score_adj from %d to %d for (%s)\n", selected->signal->oom_score_adj, 0, selected->comm);
-			selected->signal->oom_score_adj = 0;
-			rcu_read_unlock();
-			/* give the system time to free up the memory */
-			msleep_interruptible(20);
-
-		}
-
-#endif
 	}
 
 	lowmem_print(4, "lowmem_shrink %lu, %x, return %d\n",
 		     sc->nr_to_scan, sc->gfp_mask, rem);
-	rcu_read_unlock();
 	return rem;
 }
 
@@ -255,14 +501,85 @@ static struct shrinker lowmem_shrinker = {
 	.seeks = DEFAULT_SEEKS * 16
 };
 
+/* percentage of swap in use, 0 without swap */
+static int lowmem_swap_used(void)
+{
+	if (total_swap_pages <= 0)
+		return 0;
+
+	return (total_swap_pages - nr_swap_pages) * 100 / total_swap_pages;
+}
+
+/*
+ * vmpressure trigger: reclaim efficiency falling to lowmem_vmpressure_level
+ * kills from the least important bucket in lowmem_adj[] straight away,
+ * rather than waiting for free and file pages to drop below minfree, by
+ * which point direct reclaim has usually stalled the foreground for a
+ * while. Once swap (typically zram) is nearly full, reclaim can no longer
+ * make progress on anon memory, so medium pressure is enough.
+ */
+static int lowmem_vmpressure_notify(struct notifier_block *nb,
+				    unsigned long pressure, void *data)
+{
+	struct task_struct *selected;
+	int selected_tasksize = 0;
+	int selected_oom_score_adj;
+	int array_size = ARRAY_SIZE(lowmem_adj);
+	int swap_used = lowmem_swap_used();
+	unsigned long level = lowmem_vmpressure_level;
+
+	trace_lowmemory_pressure(pressure, swap_used);
+
+	if (pressure < LOWMEM_VMPRESSURE_MEDIUM) {
+		atomic64_set(&lowmem_pressure_start, 0);
+		return NOTIFY_OK;
+	}
+	atomic64_cmpxchg(&lowmem_pressure_start, 0,
+			 ktime_to_ns(ktime_get()));
+
+	if (!lowmem_vmpressure_enable)
+		return NOTIFY_OK;
+
+	if (swap_used >= lowmem_swap_full)
+		level = min_t(unsigned long, level, LOWMEM_VMPRESSURE_MEDIUM);
+	if (pressure < level)
+		return NOTIFY_OK;
+
+	if (lowmem_adj_size < array_size)
+		array_size = lowmem_adj_size;
+	if (array_size <= 0)
+		return NOTIFY_OK;
+
+	selected = lowmem_select(lowmem_adj[array_size - 1],
+				 &selected_tasksize, &selected_oom_score_adj);
+	if (IS_ERR_OR_NULL(selected))
+		return NOTIFY_OK;
+
+	lowmem_print(1, "Killing '%s' (%d), adj %d,\n" \
+		"   to free %ldkB because vmpressure is %lu%%, swap %d%% used\n",
+		selected->comm, selected->pid, selected_oom_score_adj,
+		selected_tasksize * (long)(PAGE_SIZE / 1024),
+		pressure, swap_used);
+	lowmem_kill(selected, selected_tasksize, selected_oom_score_adj,
+		    LOWMEM_TRIGGER_VMPRESSURE);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block lowmem_vmpressure_nb = {
+	.notifier_call = lowmem_vmpressure_notify,
+};
+
 static int __init lowmem_init(void)
 {
 	register_shrinker(&lowmem_shrinker);
+	vmpressure_notifier_register(&lowmem_vmpressure_nb);
 	return 0;
 }
 
 static void __exit lowmem_exit(void)
 {
+	vmpressure_notifier_unregister(&lowmem_vmpressure_nb);
 	unregister_shrinker(&lowmem_shrinker);
 }
 
@@ -357,6 +674,13 @@ module_param_array_named(adj, lowmem_adj, int, &lowmem_adj_size,
 module_param_array_named(minfree, lowmem_minfree, uint, &lowmem_minfree_size,
 			 S_IRUGO | S_IWUSR);
 module_param_named(debug_level, lowmem_debug_level, uint, S_IRUGO | S_IWUSR);
+module_param_named(vmpressure_enable, lowmem_vmpressure_enable, bool,
+		   S_IRUGO | S_IWUSR);
+module_param_named(vmpressure_level, lowmem_vmpressure_level, ulong,
+		   S_IRUGO | S_IWUSR);
+module_param_named(swap_full, lowmem_swap_full, int, S_IRUGO | S_IWUSR);
+module_param_named(scan_count, lowmem_scan_count, ulong, S_IRUGO);
+module_param_named(scan_tasks, lowmem_scan_tasks, ulong, S_IRUGO);
 
 #ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_DO_NOT_KILL_PROCESS
 module_param_named(donotkill_proc, donotkill_proc.enabled, uint, S_IRUGO | S_IWUSR);
@@ -0,0 +1,72 @@
+/*
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM lowmemorykiller
+
+#if !defined(_LOWMEMORYKILLER_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _LOWMEMORYKILLER_TRACE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(lowmemory_pressure,
+	TP_PROTO(unsigned long pressure, int swap_used),
+	TP_ARGS(pressure, swap_used),
+
+	TP_STRUCT__entry(
+		__field(unsigned long, pressure)
+		__field(int, swap_used)
+	),
+	TP_fast_assign(
+		__entry->pressure = pressure;
+		__entry->swap_used = swap_used;
+	),
+	TP_printk("pressure=%lu%% swap_used=%d%%",
+		  __entry->pressure, __entry->swap_used)
+);
+
+TRACE_EVENT(lowmemory_kill,
+	TP_PROTO(struct task_struct *task, int oom_score_adj, long freed_kb,
+		 s64 latency_us, int trigger),
+	TP_ARGS(task, oom_score_adj, freed_kb, latency_us, trigger),
+
+	TP_STRUCT__entry(
+		__array(char, comm, TASK_COMM_LEN)
+		__field(pid_t, pid)
+		__field(int, oom_score_adj)
+		__field(long, freed_kb)
+		__field(s64, latency_us)
+		__field(int, trigger)
+	),
+	TP_fast_assign(
+		memcpy(__entry->comm, task->comm, TASK_COMM_LEN);
+		__entry->pid = task->pid;
+		__entry->oom_score_adj = oom_score_adj;
+		__entry->freed_kb = freed_kb;
+		__entry->latency_us = latency_us;
+		__entry->trigger = trigger;
+	),
+	TP_printk("%s pid=%d adj=%d freed=%ldkB latency=%lldus trigger=%s",
+		  __entry->comm, __entry->pid, __entry->oom_score_adj,
+		  __entry->freed_kb, __entry->latency_us,
+		  __print_symbolic(__entry->trigger,
+				   { 0, "minfree" },
+				   { 1, "vmpressure" }))
+);
+
+#endif /* _LOWMEMORYKILLER_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_PATH .
+#define TRACE_INCLUDE_FILE lowmemorykiller_trace
+#include <trace/define_trace.h>
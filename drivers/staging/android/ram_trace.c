@@ -0,0 +1,289 @@
+/* drivers/android/ram_trace.c
+ *
+ * Binary event records kept in a RAM region across warm resets, so the
+ * last cpufreq changes, thermal state changes, low memory kills, slow
+ * binder calls and watchdog pets before a hang or a thermal reboot can
+ * be read back from /proc/last_ram_trace on the next boot.
+ *
+ * The region is reserved by the board the same way as the ram_console
+ * one. It holds a header followed by fixed size records used as a ring;
+ * every record carries a sequence number, so the order is recovered from
+ * the records themselves and writers never share anything but a counter.
+ * Each record is written back to memory as soon as it is complete, a
+ * watchdog reset does not give the caches a chance.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/proc_fs.h>
+#include <linux/ram_trace.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+#include <asm/cacheflush.h>
+#include <asm/outercache.h>
+
+/* one cache line each, the header takes the first slot */
+struct ram_trace_record {
+	u64	time;		/* local_clock() of the boot that wrote it */
+	u32	seq;		/* 0 while the record is being written */
+	u16	type;
+	u16	cpu;
+	u32	arg[3];
+	u32	reserved;
+};
+
+struct ram_trace_buffer {
+	u32	sig;
+	u32	nr_records;
+	u32	record_size;
+	u32	reserved[5];
+	struct ram_trace_record records[0];
+};
+
+#define RAM_TRACE_SIG	(0x54524244) /* DBRT */
+
+static struct ram_trace_buffer *ram_trace_buffer;
+static phys_addr_t ram_trace_phys;
+static u32 ram_trace_nr;
+static atomic_t ram_trace_seq = ATOMIC_INIT(0);
+
+static struct ram_trace_record *ram_trace_old;
+static unsigned int ram_trace_old_nr;
+
+static void notrace ram_trace_writeback(void *p, size_t size)
+{
+	phys_addr_t phys = ram_trace_phys + (p - (void *)ram_trace_buffer);
+
+	dmac_flush_range(p, p + size);
+	outer_clean_range(phys, phys + size);
+}
+
+void notrace ram_trace_log(enum ram_trace_type type, u32 a, u32 b, u32 c)
+{
+	struct ram_trace_buffer *buffer = ACCESS_ONCE(ram_trace_buffer);
+	struct ram_trace_record *rec;
+	u32 seq;
+
+	if (!buffer)
+		return;
+
+	seq = atomic_inc_return(&ram_trace_seq);
+	rec = &buffer->records[(seq - 1) % ram_trace_nr];
+
+	/* a record torn by the reset must not look valid */
+	rec->seq = 0;
+	barrier();
+	rec->time = local_clock();
+	rec->type = type;
+	rec->cpu = raw_smp_processor_id();
+	rec->arg[0] = a;
+	rec->arg[1] = b;
+	rec->arg[2] = c;
+	barrier();
+	rec->seq = seq;
+
+	ram_trace_writeback(rec, sizeof(*rec));
+}
+EXPORT_SYMBOL_GPL(ram_trace_log);
+
+static int ram_trace_cmp(const void *a, const void *b)
+{
+	const struct ram_trace_record *ra = a, *rb = b;
+
+	return ra->seq < rb->seq ? -1 : ra->seq > rb->seq;
+}
+
+static void ram_trace_save_old(struct ram_trace_buffer *buffer)
+{
+	struct ram_trace_record *rec;
+	unsigned int i, nr = 0;
+
+	if (buffer->sig != RAM_TRACE_SIG || buffer->nr_records != ram_trace_nr ||
+	    buffer->record_size != sizeof(*rec))
+		return;
+
+	ram_trace_old = vmalloc(ram_trace_nr * sizeof(*rec));
+	if (!ram_trace_old) {
+		pr_err("ram_trace: failed to allocate buffer for old records\n");
+		return;
+	}
+
+	for (i = 0; i < ram_trace_nr; i++) {
+		rec = &buffer->records[i];
+		if (rec->seq && rec->type > RAM_TRACE_NONE &&
+		    rec->type < RAM_TRACE_TYPE_MAX)
+			ram_trace_old[nr++] = *rec;
+	}
+
+	if (!nr) {
+		vfree(ram_trace_old);
+		ram_trace_old = NULL;
+		return;
+	}
+
+	sort(ram_trace_old, nr, sizeof(*rec), ram_trace_cmp, NULL);
+	ram_trace_old_nr = nr;
+}
+
+static int ram_trace_init(struct ram_trace_buffer *buffer, size_t buffer_size)
+{
+	if (buffer_size < sizeof(*buffer) + 16 * sizeof(buffer->records[0])) {
+		pr_err("ram_trace: buffer %zu too small\n", buffer_size);
+		return -EINVAL;
+	}
+
+	ram_trace_nr = (buffer_size - sizeof(*buffer)) /
+		       sizeof(buffer->records[0]);
+	ram_trace_save_old(buffer);
+
+	memset(buffer, 0, buffer_size);
+	buffer->sig = RAM_TRACE_SIG;
+	buffer->nr_records = ram_trace_nr;
+	buffer->record_size = sizeof(buffer->records[0]);
+
+	ram_trace_phys = virt_to_phys(buffer);
+	ram_trace_writeback(buffer, buffer_size);
+
+	smp_wmb();
+	ram_trace_buffer = buffer;
+
+	pr_info("ram_trace: %u records, %u saved from the last boot\n",
+		ram_trace_nr, ram_trace_old_nr);
+	return 0;
+}
+
+static int ram_trace_driver_probe(struct platform_device *pdev)
+{
+	struct resource *res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+
+	if (!res || !res->start || !res->end) {
+		pr_err("ram_trace: invalid resource\n");
+		return -ENXIO;
+	}
+
+	return ram_trace_init(phys_to_virt(res->start), resource_size(res));
+}
+
+static struct platform_driver ram_trace_driver = {
+	.probe = ram_trace_driver_probe,
+	.driver		= {
+		.name	= "ram_trace",
+	},
+};
+
+static int __init ram_trace_module_init(void)
+{
+	return platform_driver_register(&ram_trace_driver);
+}
+
+static const char * const ram_trace_names[RAM_TRACE_TYPE_MAX] = {
+	[RAM_TRACE_CPUFREQ]	= "cpufreq",
+	[RAM_TRACE_THERMAL]	= "thermal",
+	[RAM_TRACE_LMK]		= "lmk",
+	[RAM_TRACE_BINDER]	= "binder",
+	[RAM_TRACE_WATCHDOG]	= "watchdog",
+};
+
+static void *ram_trace_seq_start(struct seq_file *m, loff_t *pos)
+{
+	return *pos < ram_trace_old_nr ? &ram_trace_old[*pos] : NULL;
+}
+
+static void *ram_trace_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	++*pos;
+	return ram_trace_seq_start(m, pos);
+}
+
+static void ram_trace_seq_stop(struct seq_file *m, void *v)
+{
+}
+
+static int ram_trace_seq_show(struct seq_file *m, void *v)
+{
+	struct ram_trace_record *rec = v;
+	unsigned long rem;
+	u64 t = rec->time;
+
+	rem = do_div(t, NSEC_PER_SEC);
+	seq_printf(m, "[%5lu.%06lu] cpu%u %-8s ", (unsigned long)t,
+		   rem / NSEC_PER_USEC, rec->cpu, ram_trace_names[rec->type]);
+
+	switch (rec->type) {
+	case RAM_TRACE_CPUFREQ:
+		seq_printf(m, "cpu=%u %u -> %u kHz\n", rec->arg[0],
+			   rec->arg[1], rec->arg[2]);
+		break;
+	case RAM_TRACE_THERMAL:
+		seq_printf(m, "state=%u temp=%u\n", rec->arg[0], rec->arg[1]);
+		break;
+	case RAM_TRACE_LMK:
+		seq_printf(m, "pid=%u adj=%d size=%ukB\n", rec->arg[0],
+			   (int)rec->arg[1], rec->arg[2]);
+		break;
+	case RAM_TRACE_BINDER:
+		seq_printf(m, "pid=%u latency=%uus\n", rec->arg[0],
+			   rec->arg[1]);
+		break;
+	case RAM_TRACE_WATCHDOG:
+		seq_printf(m, "pet, %ums left\n", rec->arg[0]);
+		break;
+	}
+
+	return 0;
+}
+
+static const struct seq_operations ram_trace_seq_ops = {
+	.start	= ram_trace_seq_start,
+	.next	= ram_trace_seq_next,
+	.stop	= ram_trace_seq_stop,
+	.show	= ram_trace_seq_show,
+};
+
+static int ram_trace_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &ram_trace_seq_ops);
+}
+
+static const struct file_operations ram_trace_file_ops = {
+	.owner		= THIS_MODULE,
+	.open		= ram_trace_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
+static int __init ram_trace_late_init(void)
+{
+	if (!ram_trace_old_nr)
+		return 0;
+
+	if (!proc_create("last_ram_trace", S_IRUSR, NULL,
+			 &ram_trace_file_ops)) {
+		pr_err("ram_trace: failed to create proc entry\n");
+		vfree(ram_trace_old);
+		ram_trace_old = NULL;
+		ram_trace_old_nr = 0;
+	}
+
+	return 0;
+}
+
+postcore_initcall(ram_trace_module_init);
+late_initcall(ram_trace_late_init);
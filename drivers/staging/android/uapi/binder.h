@@ -37,8 +37,19 @@ enum {
 };
 
 enum {
+	/*
+	 * Minimum priority transactions to the node run at: a nice value
+	 * for SCHED_NORMAL and SCHED_BATCH, an rt priority from 1 to 99
+	 * for SCHED_FIFO and SCHED_RR.
+	 */
 	FLAT_BINDER_FLAG_PRIORITY_MASK = 0xff,
 	FLAT_BINDER_FLAG_ACCEPTS_FDS = 0x100,
+	/* scheduling policy of the minimum priority */
+	FLAT_BINDER_FLAG_SCHED_POLICY_SHIFT = 9,
+	FLAT_BINDER_FLAG_SCHED_POLICY_MASK =
+		3U << FLAT_BINDER_FLAG_SCHED_POLICY_SHIFT,
+	/* synchronous calls from rt threads keep their rt priority */
+	FLAT_BINDER_FLAG_INHERIT_RT = 0x800,
 };
 
 #ifdef BINDER_IPC_32BIT
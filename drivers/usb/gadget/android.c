@@ -362,8 +362,48 @@ ffs_aliases_store(struct device *pdev, struct device_attribute *attr,
 
 static DEVICE_ATTR(aliases, S_IRUGO | S_IWUSR, ffs_aliases_show,
 					       ffs_aliases_store);
+
+static struct android_usb_function ffs_function;
+
+static ssize_t ffs_bytes_show(struct device *pdev, char *buf, int in)
+{
+	struct functionfs_config *config = ffs_function.config;
+	struct android_dev *dev;
+	u64 bytes = 0;
+
+	dev = list_first_entry(&android_dev_list, struct android_dev,
+			list_item);
+
+	mutex_lock(&dev->mutex);
+	if (config->data)
+		bytes = atomic64_read(in ? &config->data->tx_bytes :
+					   &config->data->rx_bytes);
+	mutex_unlock(&dev->mutex);
+
+	return sprintf(buf, "%llu\n", bytes);
+}
+
+static ssize_t ffs_rx_bytes_show(struct device *pdev,
+				 struct device_attribute *attr, char *buf)
+{
+	return ffs_bytes_show(pdev, buf, 0);
+}
+
+static ssize_t ffs_tx_bytes_show(struct device *pdev,
+				 struct device_attribute *attr, char *buf)
+{
+	return ffs_bytes_show(pdev, buf, 1);
+}
+
+static struct device_attribute ffs_rx_bytes_attr =
+	__ATTR(rx_bytes, S_IRUGO, ffs_rx_bytes_show, NULL);
+static struct device_attribute ffs_tx_bytes_attr =
+	__ATTR(tx_bytes, S_IRUGO, ffs_tx_bytes_show, NULL);
+
 static struct device_attribute *ffs_function_attributes[] = {
 	&dev_attr_aliases,
+	&ffs_rx_bytes_attr,
+	&ffs_tx_bytes_attr,
 	NULL
 };
 
@@ -473,6 +513,31 @@ static void adb_android_function_disable(struct android_usb_function *f)
 		android_enable(dev);
 }
 
+static ssize_t adb_rx_bytes_show(struct device *pdev,
+				 struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%llu\n",
+		       (u64)atomic64_read(&_adb_dev->rx_bytes));
+}
+
+static ssize_t adb_tx_bytes_show(struct device *pdev,
+				 struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%llu\n",
+		       (u64)atomic64_read(&_adb_dev->tx_bytes));
+}
+
+static struct device_attribute adb_rx_bytes_attr =
+	__ATTR(rx_bytes, S_IRUGO, adb_rx_bytes_show, NULL);
+static struct device_attribute adb_tx_bytes_attr =
+	__ATTR(tx_bytes, S_IRUGO, adb_tx_bytes_show, NULL);
+
+static struct device_attribute *adb_function_attributes[] = {
+	&adb_rx_bytes_attr,
+	&adb_tx_bytes_attr,
+	NULL
+};
+
 static struct android_usb_function adb_function = {
 	.name		= "adb",
 	.enable		= adb_android_function_enable,
@@ -480,6 +545,7 @@ static struct android_usb_function adb_function = {
 	.init		= adb_function_init,
 	.cleanup	= adb_function_cleanup,
 	.bind_config	= adb_function_bind_config,
+	.attributes	= adb_function_attributes,
 };
 
 static void adb_ready_callback(void)
@@ -28,9 +28,17 @@
 #include <linux/miscdevice.h>
 
 #define ADB_BULK_BUFFER_SIZE           4096
+#define ADB_BULK_BUFFER_INIT_SIZE      16384
 
 /* number of tx requests to allocate */
-#define TX_REQ_MAX 4
+#define TX_REQ_MAX 8
+
+/* request sizes, taken when the function is bound */
+static unsigned int adb_rx_req_len = ADB_BULK_BUFFER_INIT_SIZE;
+module_param(adb_rx_req_len, uint, S_IRUGO | S_IWUSR);
+
+static unsigned int adb_tx_req_len = ADB_BULK_BUFFER_INIT_SIZE;
+module_param(adb_tx_req_len, uint, S_IRUGO | S_IWUSR);
 
 static const char adb_shortname[] = "android_adb";
 
@@ -55,6 +63,13 @@ struct adb_dev {
 	wait_queue_head_t write_wq;
 	struct usb_request *rx_req;
 	int rx_done;
+	unsigned rx_req_len;
+	unsigned tx_req_len;
+
+	/* bytes moved over the bulk endpoints */
+	atomic64_t rx_bytes;
+	atomic64_t tx_bytes;
+
 	bool notify_close;
 	bool close_notified;
 };
@@ -279,16 +294,31 @@ static int adb_create_bulk_endpoints(struct adb_dev *dev,
 	dev->ep_out = ep;
 
 	/* now allocate requests for our endpoints */
-	req = adb_request_new(dev->ep_out, ADB_BULK_BUFFER_SIZE);
+	dev->rx_req_len = max_t(unsigned, adb_rx_req_len, ADB_BULK_BUFFER_SIZE);
+	dev->tx_req_len = max_t(unsigned, adb_tx_req_len, ADB_BULK_BUFFER_SIZE);
+
+	/* large buffers are physically contiguous, settle for the old size */
+	req = adb_request_new(dev->ep_out, dev->rx_req_len);
+	if (!req) {
+		dev->rx_req_len = ADB_BULK_BUFFER_SIZE;
+		req = adb_request_new(dev->ep_out, dev->rx_req_len);
+	}
 	if (!req)
 		goto fail;
 	req->complete = adb_complete_out;
 	dev->rx_req = req;
 
+retry_tx_alloc:
 	for (i = 0; i < TX_REQ_MAX; i++) {
-		req = adb_request_new(dev->ep_in, ADB_BULK_BUFFER_SIZE);
-		if (!req)
-			goto fail;
+		req = adb_request_new(dev->ep_in, dev->tx_req_len);
+		if (!req) {
+			if (dev->tx_req_len <= ADB_BULK_BUFFER_SIZE)
+				goto fail;
+			while ((req = adb_req_get(dev, &dev->tx_idle)))
+				adb_request_free(req, dev->ep_in);
+			dev->tx_req_len = ADB_BULK_BUFFER_SIZE;
+			goto retry_tx_alloc;
+		}
 		req->complete = adb_complete_in;
 		adb_req_put(dev, &dev->tx_idle, req);
 	}
@@ -312,7 +342,7 @@ static ssize_t adb_read(struct file *fp, char __user *buf,
 	if (!_adb_dev)
 		return -ENODEV;
 
-	if (count > ADB_BULK_BUFFER_SIZE)
+	if (count > dev->rx_req_len)
 		return -EINVAL;
 
 	if (adb_lock(&dev->read_excl))
@@ -367,6 +397,8 @@ requeue_req:
 		r = xfer;
 		if (copy_to_user(buf, req->buf, xfer))
 			r = -EFAULT;
+		else
+			atomic64_add(xfer, &dev->rx_bytes);
 
 	} else
 		r = -EIO;
@@ -411,8 +443,8 @@ static ssize_t adb_write(struct file *fp, const char __user *buf,
 		}
 
 		if (req != 0) {
-			if (count > ADB_BULK_BUFFER_SIZE)
-				xfer = ADB_BULK_BUFFER_SIZE;
+			if (count > dev->tx_req_len)
+				xfer = dev->tx_req_len;
 			else
 				xfer = count;
 			if (copy_from_user(req->buf, buf, xfer)) {
@@ -431,6 +463,7 @@ static ssize_t adb_write(struct file *fp, const char __user *buf,
 
 			buf += xfer;
 			count -= xfer;
+			atomic64_add(xfer, &dev->tx_bytes);
 
 			/* zero this so we don't try to free it on error exit */
 			req = 0;
@@ -658,6 +691,8 @@ static int adb_setup(void)
 	atomic_set(&dev->open_excl, 0);
 	atomic_set(&dev->read_excl, 0);
 	atomic_set(&dev->write_excl, 0);
+	atomic64_set(&dev->rx_bytes, 0);
+	atomic64_set(&dev->tx_bytes, 0);
 
 	/* config is disabled by default if adb is present. */
 	dev->close_notified = true;
@@ -18,6 +18,7 @@
 /* #define DEBUG */
 /* #define VERBOSE_DEBUG */
 
+#include <linux/aio.h>
 #include <linux/blkdev.h>
 #include <linux/pagemap.h>
 #include <asm/unaligned.h>
@@ -231,6 +232,10 @@ struct ffs_data {
 	 * destroyed by ffs_epfiles_destroy().
 	 */
 	struct ffs_epfile		*epfiles;
+
+	/* Bytes moved over the non-control endpoints */
+	atomic64_t			rx_bytes;
+	atomic64_t			tx_bytes;
 };
 
 /* Reference counter handling */
@@ -852,6 +857,9 @@ first_try:
 			if (read && ret > 0 &&
 			    unlikely(copy_to_user(buf, data, ret)))
 				ret = -EFAULT;
+			if (ret > 0)
+				atomic64_add(ret, read ? &epfile->ffs->rx_bytes
+						       : &epfile->ffs->tx_bytes);
 		}
 	}
 
@@ -878,6 +886,235 @@ ffs_epfile_read(struct file *file, char __user *buf, size_t len, loff_t *ptr)
 	return ffs_epfile_io(file, buf, len, 1);
 }
 
+/*
+ * Asynchronous I/O.  Each kiocb gets a request and a bounce buffer of
+ * its own, so user space can keep several transfers queued on an
+ * endpoint.  The completion only kicks the kiocb; the retry method,
+ * run by the AIO core with the submitter's mm, copies read data out
+ * and returns the result, and the destructor frees the request once
+ * neither the UDC nor a cancel can still refer to it.
+ */
+struct ffs_io_data {
+	struct usb_ep			*ep;
+	struct usb_request		*req;
+	char				*buf;
+	const struct iovec		*iov;	/* reads only */
+	unsigned long			nr_segs;
+	int				read;
+	ssize_t				status;
+};
+
+static int ffs_epfile_aio_cancel(struct kiocb *iocb, struct io_event *e)
+{
+	struct ffs_epfile *epfile = iocb->ki_filp->private_data;
+	struct ffs_io_data *io_data = iocb->private;
+	int value;
+
+	ENTER();
+
+	spin_lock_irq(&epfile->ffs->eps_lock);
+	if (likely(epfile->ep && epfile->ep->ep == io_data->ep))
+		value = usb_ep_dequeue(io_data->ep, io_data->req);
+	else
+		value = -EINVAL;
+	spin_unlock_irq(&epfile->ffs->eps_lock);
+
+	aio_put_req(iocb);
+	return value;
+}
+
+static ssize_t ffs_epfile_aio_retry(struct kiocb *iocb)
+{
+	struct ffs_epfile *epfile = iocb->ki_filp->private_data;
+	struct ffs_io_data *io_data = iocb->private;
+	ssize_t ret = io_data->status, total = ret;
+	char *to_copy = io_data->buf;
+	unsigned long i;
+
+	ENTER();
+
+	if (io_data->read && ret > 0) {
+		ret = 0;
+		for (i = 0; i < io_data->nr_segs && total; i++) {
+			ssize_t this = min_t(ssize_t, io_data->iov[i].iov_len,
+					     total);
+
+			if (unlikely(copy_to_user(io_data->iov[i].iov_base,
+						  to_copy, this))) {
+				if (!ret)
+					ret = -EFAULT;
+				break;
+			}
+			total -= this;
+			ret += this;
+			to_copy += this;
+		}
+	}
+
+	if (ret > 0)
+		atomic64_add(ret, io_data->read ? &epfile->ffs->rx_bytes
+						: &epfile->ffs->tx_bytes);
+	return ret;
+}
+
+static void ffs_epfile_aio_dtor(struct kiocb *iocb)
+{
+	struct ffs_io_data *io_data = iocb->private;
+
+	usb_ep_free_request(io_data->ep, io_data->req);
+	kfree(io_data->buf);
+	kfree(io_data->iov);
+	kfree(io_data);
+	iocb->private = NULL;
+}
+
+static void ffs_epfile_aio_complete(struct usb_ep *_ep,
+				    struct usb_request *req)
+{
+	struct kiocb *iocb = req->context;
+	struct ffs_io_data *io_data = iocb->private;
+
+	ENTER();
+
+	io_data->status = req->status ? req->status : req->actual;
+	kick_iocb(iocb);
+}
+
+static ssize_t ffs_epfile_aio_io(struct kiocb *iocb, const struct iovec *iov,
+				 unsigned long nr_segs, int read)
+{
+	struct file *file = iocb->ki_filp;
+	struct ffs_epfile *epfile = file->private_data;
+	struct ffs_io_data *io_data;
+	struct usb_request *req;
+	size_t len = iocb->ki_left, done;
+	unsigned long i;
+	ssize_t ret;
+
+	/* readv(2) and writev(2) are a transfer per segment, as before */
+	if (is_sync_kiocb(iocb)) {
+		for (done = 0, i = 0; i < nr_segs; i++) {
+			ret = ffs_epfile_io(file, iov[i].iov_base,
+					    iov[i].iov_len, read);
+			if (ret < 0)
+				return done ? done : ret;
+			done += ret;
+			if (ret < iov[i].iov_len)
+				break;
+		}
+		return done;
+	}
+
+	if (WARN_ON(epfile->ffs->state != FFS_ACTIVE))
+		return -ENODEV;
+
+	/* Wait for endpoint to be enabled */
+	if (!epfile->ep) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		if (wait_event_interruptible(epfile->wait, epfile->ep))
+			return -EINTR;
+	}
+
+	io_data = kzalloc(sizeof *io_data, GFP_KERNEL);
+	if (unlikely(!io_data))
+		return -ENOMEM;
+	io_data->read = read;
+	io_data->nr_segs = nr_segs;
+
+	io_data->buf = kmalloc(len, GFP_KERNEL);
+	if (unlikely(!io_data->buf)) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
+	if (read) {
+		io_data->iov = kmemdup(iov, nr_segs * sizeof *iov, GFP_KERNEL);
+		if (unlikely(!io_data->iov)) {
+			ret = -ENOMEM;
+			goto error;
+		}
+	} else {
+		for (done = 0, i = 0; i < nr_segs; i++) {
+			if (unlikely(copy_from_user(io_data->buf + done,
+						    iov[i].iov_base,
+						    iov[i].iov_len))) {
+				ret = -EFAULT;
+				goto error;
+			}
+			done += iov[i].iov_len;
+		}
+	}
+
+	spin_lock_irq(&epfile->ffs->eps_lock);
+
+	/* Endpoint got disabled, or we would have to halt it */
+	if (unlikely(!epfile->ep)) {
+		ret = -ENODEV;
+		goto error_unlock;
+	}
+	if (!read == !epfile->in) {
+		ret = -EINVAL;
+		goto error_unlock;
+	}
+
+	req = usb_ep_alloc_request(epfile->ep->ep, GFP_ATOMIC);
+	if (unlikely(!req)) {
+		ret = -ENOMEM;
+		goto error_unlock;
+	}
+
+	io_data->ep  = epfile->ep->ep;
+	io_data->req = req;
+	req->buf      = io_data->buf;
+	req->length   = len;
+	req->context  = iocb;
+	req->complete = ffs_epfile_aio_complete;
+
+	iocb->private  = io_data;
+	iocb->ki_retry = ffs_epfile_aio_retry;
+	iocb->ki_cancel = ffs_epfile_aio_cancel;
+	iocb->ki_dtor  = ffs_epfile_aio_dtor;
+
+	ret = usb_ep_queue(io_data->ep, req, GFP_ATOMIC);
+	if (unlikely(ret)) {
+		iocb->private  = NULL;
+		iocb->ki_cancel = NULL;
+		iocb->ki_dtor  = NULL;
+		usb_ep_free_request(io_data->ep, req);
+		goto error_unlock;
+	}
+
+	spin_unlock_irq(&epfile->ffs->eps_lock);
+	return -EIOCBRETRY;
+
+error_unlock:
+	spin_unlock_irq(&epfile->ffs->eps_lock);
+error:
+	kfree(io_data->buf);
+	kfree(io_data->iov);
+	kfree(io_data);
+	return ret;
+}
+
+static ssize_t
+ffs_epfile_aio_write(struct kiocb *iocb, const struct iovec *iov,
+		     unsigned long nr_segs, loff_t pos)
+{
+	ENTER();
+
+	return ffs_epfile_aio_io(iocb, iov, nr_segs, 0);
+}
+
+static ssize_t
+ffs_epfile_aio_read(struct kiocb *iocb, const struct iovec *iov,
+		    unsigned long nr_segs, loff_t pos)
+{
+	ENTER();
+
+	return ffs_epfile_aio_io(iocb, iov, nr_segs, 1);
+}
+
 static int
 ffs_epfile_open(struct inode *inode, struct file *file)
 {
@@ -974,6 +1211,8 @@ static const struct file_operations ffs_epfile_operations = {
 	.open =		ffs_epfile_open,
 	.write =	ffs_epfile_write,
 	.read =		ffs_epfile_read,
+	.aio_write =	ffs_epfile_aio_write,
+	.aio_read =	ffs_epfile_aio_read,
 	.release =	ffs_epfile_release,
 	.unlocked_ioctl =	ffs_epfile_ioctl,
 };
@@ -1309,6 +1548,8 @@ static struct ffs_data *ffs_data_new(void)
 
 	atomic_set(&ffs->ref, 1);
 	atomic_set(&ffs->opened, 0);
+	atomic64_set(&ffs->rx_bytes, 0);
+	atomic64_set(&ffs->tx_bytes, 0);
 	ffs->state = FFS_READ_DESCRIPTORS;
 	mutex_init(&ffs->mutex);
 	spin_lock_init(&ffs->eps_lock);
@@ -284,6 +284,7 @@
 #include <linux/kref.h>
 #include <linux/kthread.h>
 #include <linux/limits.h>
+#include <linux/pagemap.h>
 #include <linux/rwsem.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
@@ -972,6 +973,30 @@ static int do_read_cd(struct fsg_common *common)
 
 /*-------------------------------------------------------------------------*/
 
+/*
+ * Start the backing store on everything a READ asks for, so that the
+ * later buffers are being read while the earlier ones are on the bus
+ * and vfs_read() mostly finds its pages ready.
+ */
+static void fsg_lun_readahead(struct fsg_lun *curlun, loff_t file_offset,
+			      u32 amount)
+{
+	struct file	*filp = curlun->filp;
+	pgoff_t		index = file_offset >> PAGE_CACHE_SHIFT;
+	loff_t		end;
+
+	/* a single buffer is read right away anyway */
+	if (amount <= FSG_BUFLEN || !filp->f_mapping)
+		return;
+
+	end = min(file_offset + amount, curlun->file_length);
+	if (end <= file_offset)
+		return;
+
+	page_cache_sync_readahead(filp->f_mapping, &filp->f_ra, filp, index,
+			((end - 1) >> PAGE_CACHE_SHIFT) - index + 1);
+}
+
 static int do_read(struct fsg_common *common)
 {
 	struct fsg_lun		*curlun = common->curlun;
@@ -1029,6 +1054,8 @@ static int do_read(struct fsg_common *common)
 	if (curlun->cdrom)
 		amount_left <<= 2;
 
+	fsg_lun_readahead(curlun, file_offset, amount_left);
+
 	for (;;) {
 		/*
 		 * Figure out how much we need to read:
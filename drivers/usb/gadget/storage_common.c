@@ -260,7 +260,7 @@ static struct fsg_lun *fsg_lun_from_dev(struct device *dev)
 #define DELAYED_STATUS	(EP0_BUFSIZE + 999)	/* An impossibly large value */
 
 /* Number of buffers we will use.  2 is enough for double-buffering */
-#define FSG_NUM_BUFFERS	2
+#define FSG_NUM_BUFFERS	CONFIG_USB_GADGET_STORAGE_NUM_BUFFERS
 
 /* Default size of buffer length. */
 #define FSG_BUFLEN	((u32)16384)
@@ -707,6 +707,11 @@ static int fsg_lun_open(struct fsg_lun *curlun, const char *filename)
 		goto out;
 	}
 
+	/* hosts read in long sequential runs, as POSIX_FADV_SEQUENTIAL */
+	if (filp->f_mapping)
+		filp->f_ra.ra_pages =
+			filp->f_mapping->backing_dev_info->ra_pages * 2;
+
 	get_file(filp);
 	curlun->ro = ro;
 	curlun->filp = filp;
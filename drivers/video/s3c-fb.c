@@ -39,6 +39,9 @@
 #include <plat/regs-fb-v4.h>
 #include <plat/fb.h>
 #include <plat/cpu.h>
+#ifdef CONFIG_S5P_BTS
+#include <plat/bts.h>
+#endif
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
 #include <linux/earlysuspend.h>
@@ -1129,6 +1132,9 @@ static irqreturn_t s3cfb_irq_fifo(int irq, void *dev_id)
 	if (irq_sts_reg & VIDINTCON1_INT_FIFO) {
 
 		printk("FIMD Under-run : %d\n",cnt++);
+#ifdef CONFIG_S5P_BTS
+		exynos_bts_fifo_underrun();
+#endif
 		irq_sts_reg = (irq_sts_reg & VIDINTCON1_INT_FIFO);
 		writel(irq_sts_reg, regs + VIDINTCON1);
 	}
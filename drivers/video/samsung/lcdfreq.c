@@ -2,6 +2,10 @@
  *
  * EXYNOS4 - support LCD PixelClock change at runtime
  *
+ * Besides the level a user locks, the panel drops to the LIMIT refresh
+ * rate on its own once no frame has been committed for auto_ms, and it is
+ * back at the normal rate on the next frame or touch.
+ *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License version 2 as
  * published by the Free Software Foundation.
@@ -15,6 +19,8 @@
 #include <linux/clk.h>
 #include <linux/spinlock.h>
 #include <linux/fb.h>
+#include <linux/input.h>
+#include <linux/workqueue.h>
 
 #include <plat/clock.h>
 #include <plat/clock-clksrc.h>
@@ -76,6 +82,13 @@ struct lcdfreq_info {
 
 	struct delayed_work	work;
 
+	/* automatic mode, auto_ms of 0 turns it off */
+	unsigned int		auto_ms;
+	bool			auto_limit;	/* LIMIT set by the idle timer */
+	unsigned long		last_frame;
+	struct delayed_work	auto_work;
+	struct input_handler	input_handler;
+
 	void __iomem		*ielcd_reg;
 
 	int			blank;
@@ -83,6 +96,10 @@ struct lcdfreq_info {
 	struct early_suspend	early_suspend;
 };
 
+#define LCDFREQ_AUTO_MS		3000
+
+static struct lcdfreq_info *lcdfreq_auto_info;
+
 static inline struct lcdfreq_info *dev_get_lcdfreq(struct device *dev)
 {
 	struct fb_info *fb = dev_get_drvdata(dev);
@@ -165,7 +182,7 @@ static int set_div(struct device *dev, u32 div)
 			if (VSTATUS_IS_FRONT(get_vstatus(dev))) {
 				writel(reg, clksrc->reg_div.reg);
 				spin_unlock_irqrestore(&info->slock, flags);
-				dev_info(dev, "%x, %d\n", __raw_readl(clksrc->reg_div.reg), 1000000-count);
+				dev_dbg(dev, "%x, %d\n", __raw_readl(clksrc->reg_div.reg), 1000000-count);
 				return 0;
 			}
 		}
@@ -324,6 +341,133 @@ static int lcdfreq_lock_free(struct device *dev)
 	return ret;
 }
 
+static void lcdfreq_auto_fn(struct work_struct *work)
+{
+	struct lcdfreq_info *info =
+		container_of(work, struct lcdfreq_info, auto_work.work);
+	unsigned long timeout = msecs_to_jiffies(info->auto_ms);
+	unsigned long last = ACCESS_ONCE(info->last_frame);
+	unsigned long idle = jiffies - last;
+
+	if (info->auto_limit) {
+		/* a new frame or touch while idle */
+		info->auto_limit = false;
+		if (info->level == LIMIT && !atomic_read(&info->usage))
+			set_lcdfreq_div(info->dev, NORMAL);
+		if (info->auto_ms)
+			queue_delayed_work(system_nrt_wq, &info->auto_work,
+					timeout);
+		return;
+	}
+
+	if (!info->auto_ms)
+		return;
+
+	if (idle < timeout) {
+		queue_delayed_work(system_nrt_wq, &info->auto_work,
+				timeout - idle);
+		return;
+	}
+
+	if (info->enable && info->level == NORMAL &&
+			!atomic_read(&info->usage)) {
+		if (!set_lcdfreq_div(info->dev, LIMIT))
+			info->auto_limit = true;
+	}
+
+	/* pairs with lcdfreq_auto_kick(): a frame came in meanwhile */
+	smp_mb();
+	if (info->auto_limit && ACCESS_ONCE(info->last_frame) != last)
+		queue_delayed_work(system_nrt_wq, &info->auto_work, 0);
+}
+
+static void lcdfreq_auto_kick(struct lcdfreq_info *info)
+{
+	if (!info->auto_ms || !info->enable)
+		return;
+
+	ACCESS_ONCE(info->last_frame) = jiffies;
+
+	smp_mb();
+	if (ACCESS_ONCE(info->auto_limit)) {
+		cancel_delayed_work(&info->auto_work);
+		queue_delayed_work(system_nrt_wq, &info->auto_work, 0);
+	} else if (!delayed_work_pending(&info->auto_work)) {
+		queue_delayed_work(system_nrt_wq, &info->auto_work,
+				msecs_to_jiffies(info->auto_ms));
+	}
+}
+
+/* called by s3cfb for every frame it puts on the screen, may be atomic */
+void lcdfreq_frame_update(void)
+{
+	struct lcdfreq_info *info = lcdfreq_auto_info;
+
+	if (info)
+		lcdfreq_auto_kick(info);
+}
+
+static void lcdfreq_input_event(struct input_handle *handle,
+		unsigned int type, unsigned int code, int value)
+{
+	struct lcdfreq_info *info = handle->private;
+
+	if (type == EV_ABS || (type == EV_KEY && value))
+		lcdfreq_auto_kick(info);
+}
+
+static int lcdfreq_input_connect(struct input_handler *handler,
+		struct input_dev *dev, const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "lcdfreq";
+	handle->private = container_of(handler, struct lcdfreq_info,
+			input_handler);
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err2;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err1;
+
+	return 0;
+err1:
+	input_unregister_handle(handle);
+err2:
+	kfree(handle);
+	return error;
+}
+
+static void lcdfreq_input_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id lcdfreq_input_ids[] = {
+	/* multi-touch touchscreen */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			BIT_MASK(ABS_MT_POSITION_X) |
+			BIT_MASK(ABS_MT_POSITION_Y) },
+	},
+	{ },
+};
+
 static ssize_t level_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -379,12 +523,44 @@ static ssize_t usage_show(struct device *dev,
 	return sprintf(buf, "%d\n", atomic_read(&info->usage));
 }
 
+static ssize_t auto_ms_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct lcdfreq_info *info = dev_get_lcdfreq(dev);
+
+	return sprintf(buf, "%u\n", info->auto_ms);
+}
+
+static ssize_t auto_ms_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct lcdfreq_info *info = dev_get_lcdfreq(dev);
+	unsigned int value;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &value);
+	if (ret)
+		return ret;
+
+	info->auto_ms = value;
+
+	/* back to normal now if the automatic mode was turned off */
+	if (!value && info->auto_limit)
+		queue_delayed_work(system_nrt_wq, &info->auto_work, 0);
+	else
+		lcdfreq_auto_kick(info);
+
+	return count;
+}
+
 static DEVICE_ATTR(level, S_IRUGO|S_IWUSR, level_show, level_store);
 static DEVICE_ATTR(usage, S_IRUGO, usage_show, NULL);
+static DEVICE_ATTR(auto_ms, S_IRUGO|S_IWUSR, auto_ms_show, auto_ms_store);
 
 static struct attribute *lcdfreq_attributes[] = {
 	&dev_attr_level.attr,
 	&dev_attr_usage.attr,
+	&dev_attr_auto_ms.attr,
 	NULL,
 };
 
@@ -400,9 +576,12 @@ static void lcdfreq_early_suspend(struct early_suspend *h)
 
 	dev_info(lcdfreq->dev, "%s\n", __func__);
 
+	cancel_delayed_work_sync(&lcdfreq->auto_work);
+
 	mutex_lock(&lcdfreq->lock);
 	lcdfreq->enable = false;
 	lcdfreq->level = NORMAL;
+	lcdfreq->auto_limit = false;
 	atomic_set(&lcdfreq->usage, 0);
 	mutex_unlock(&lcdfreq->lock);
 
@@ -420,6 +599,8 @@ static void lcdfreq_late_resume(struct early_suspend *h)
 	lcdfreq->enable = true;
 	mutex_unlock(&lcdfreq->lock);
 
+	lcdfreq_auto_kick(lcdfreq);
+
 	return;
 }
 
@@ -567,6 +748,8 @@ static int lcdfreq_probe(struct platform_device *pdev)
 	spin_lock_init(&info->slock);
 
 	INIT_DELAYED_WORK_DEFERRABLE(&info->work, lcdfreq_status_work);
+	INIT_DELAYED_WORK_DEFERRABLE(&info->auto_work, lcdfreq_auto_fn);
+	info->auto_ms = LCDFREQ_AUTO_MS;
 
 	ret = sysfs_create_group(&fb->dev->kobj, &lcdfreq_attr_group);
 	if (ret < 0) {
@@ -586,6 +769,18 @@ static int lcdfreq_probe(struct platform_device *pdev)
 	info->ielcd_reg = ioremap(IELCD_REG_BASE, IELCD_MAP_SIZE);
 	info->enable = true;
 
+	info->input_handler.event = lcdfreq_input_event;
+	info->input_handler.connect = lcdfreq_input_connect;
+	info->input_handler.disconnect = lcdfreq_input_disconnect;
+	info->input_handler.name = "lcdfreq";
+	info->input_handler.id_table = lcdfreq_input_ids;
+	if (input_register_handler(&info->input_handler))
+		dev_err(info->dev, "%s: no input handler\n", __func__);
+
+	info->last_frame = jiffies;
+	lcdfreq_auto_info = info;
+	lcdfreq_auto_kick(info);
+
 	dev_info(info->dev, "%s is done\n", __func__);
 
 	return 0;
@@ -193,6 +193,24 @@ struct s3cfb_vsync {
 	struct task_struct      *thread;
 };
 
+/**
+ * struct s3cfb_update_stats - window config commit statistics
+ * @commits:           configs latched by the hardware
+ * @dropped:           configs replaced by a newer one before being latched
+ * @missed_vsync:      extra vsyncs waited for before a config latched
+ * @latency_last:      commit to scanout latency of the last config in usec
+ * @latency_max:       worst commit to scanout latency in usec
+ * @latency_total:     sum of the latencies in usec, for the average
+ */
+struct s3cfb_update_stats {
+	unsigned int		commits;
+	unsigned int		dropped;
+	unsigned int		missed_vsync;
+	u32			latency_last;
+	u32			latency_max;
+	u64			latency_total;
+};
+
 #ifdef CONFIG_FB_S5P_SYSMMU
 struct sysmmu_flag {
 	bool			enabled;
@@ -237,6 +255,7 @@ struct s3cfb_global {
 	struct sw_sync_timeline *timeline;
 	int			timeline_max;
 	unsigned int		support_fence;
+	struct s3cfb_update_stats update_stats;
 #ifdef CONFIG_HAS_WAKELOCK
 	struct early_suspend	early_suspend;
 	struct wake_lock	idle_lock;
@@ -343,6 +362,7 @@ struct s3c_fb_win_config_data {
 
 struct s3c_reg_data {
 	struct list_head	list;
+	ktime_t			queued;
 	u32			shadowcon;
 	u32			wincon[S3C_FB_MAX_WIN];
 	u32			win_rgborder[S3C_FB_MAX_WIN];
@@ -487,6 +507,7 @@ extern int s3cfb_wait_for_vsync(struct s3cfb_global *fbdev, u32 timeout);
 
 /* LCD */
 extern void s3cfb_set_lcd_info(struct s3cfb_global *ctrl);
+extern void lcdfreq_frame_update(void);
 
 #ifdef CONFIG_FB_S5P_MIPI_DSIM
 extern int s3cfb_vsync_status_check(void);
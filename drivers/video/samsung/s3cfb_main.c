@@ -407,6 +407,34 @@ static ssize_t vsync_event_show(struct device *dev,
 
 static DEVICE_ATTR(vsync_event, 0444, vsync_event_show, NULL);
 
+static ssize_t update_stats_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct s3cfb_global *fbdev = fbfimd->fbdev[0];
+	struct s3cfb_update_stats *stats = &fbdev->update_stats;
+	u32 average = 0;
+
+	if (stats->commits)
+		average = div_u64(stats->latency_total, stats->commits);
+
+	return snprintf(buf, PAGE_SIZE,
+			"commits %u\ndropped %u\nmissed_vsync %u\n"
+			"latency_last %u\nlatency_avg %u\nlatency_max %u\n",
+			stats->commits, stats->dropped, stats->missed_vsync,
+			stats->latency_last, average, stats->latency_max);
+}
+
+static ssize_t update_stats_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct s3cfb_global *fbdev = fbfimd->fbdev[0];
+
+	memset(&fbdev->update_stats, 0, sizeof(fbdev->update_stats));
+	return len;
+}
+
+static DEVICE_ATTR(update_stats, 0644, update_stats_show, update_stats_store);
+
 #ifdef CONFIG_FB_S5P_VSYNC_SYSFS
 static ssize_t vsync_time_show(struct device *dev,
 	struct device_attribute *attr, char *buf)
@@ -466,16 +494,37 @@ static void s3c_fb_update_regs_handler(struct kthread_work *work)
 		container_of(work, struct s3cfb_global, update_regs_work);
 	struct s3c_reg_data *data, *next;
 	struct list_head saved_list;
+	unsigned int dropped = 0;
 
 	mutex_lock(&fbdev->update_regs_list_lock);
 	saved_list = fbdev->update_regs_list;
 	list_replace_init(&fbdev->update_regs_list, &saved_list);
 	mutex_unlock(&fbdev->update_regs_list_lock);
 
+	if (list_empty(&saved_list))
+		return;
+
+	/*
+	 * Configs queued while the previous one waited for its vsync would
+	 * each cost one more frame. Only the newest one is programmed, the
+	 * others never reach the screen and their fences are signaled
+	 * together with it.
+	 */
 	list_for_each_entry_safe(data, next, &saved_list, list) {
-		s3c_fb_update_regs(fbdev, data);
+		if (list_is_last(&data->list, &saved_list))
+			break;
 		list_del(&data->list);
 		kfree(data);
+		dropped++;
+	}
+
+	s3c_fb_update_regs(fbdev, data);
+	list_del(&data->list);
+	kfree(data);
+
+	if (dropped) {
+		sw_sync_timeline_inc(fbdev->timeline, dropped);
+		fbdev->update_stats.dropped += dropped;
 	}
 }
 
@@ -1311,6 +1360,10 @@ static int s3cfb_probe(struct platform_device *pdev)
 		if (ret < 0)
 			dev_err(fbdev[0]->dev, "failed to add sysfs entries\n");
 
+		ret = device_create_file(fbdev[i]->dev, &dev_attr_update_stats);
+		if (ret < 0)
+			dev_err(fbdev[0]->dev, "failed to add sysfs entries\n");
+
 #ifdef CONFIG_FB_S5P_VSYNC_SYSFS
 		ret = device_create_file(fbdev[i]->dev, &dev_attr_vsync_time);
 		if (ret < 0)
@@ -1155,6 +1155,7 @@ int s3cfb_pan_display(struct fb_var_screeninfo *var, struct fb_info *fb)
 		fb->node, win->id, var->yoffset);
 
 	s3cfb_set_buffer_address(fbdev, win->id);
+	lcdfreq_frame_update();
 
 	if (win->id == pdata->default_win)
 		spin_unlock(&fbdev->slock);
@@ -1559,6 +1560,9 @@ void s3c_fb_update_regs(struct s3cfb_global *fbdev, struct s3c_reg_data *regs)
 	unsigned short i;
 	bool wait_for_vsync;
 	struct s3cfb_window *win;
+	struct s3cfb_update_stats *stats = &fbdev->update_stats;
+	unsigned int vsyncs = 0;
+	u32 latency;
 
 #if defined(CONFIG_CPU_EXYNOS4212) || defined(CONFIG_CPU_EXYNOS4412)
 #ifdef CONFIG_BUSFREQ_OPP
@@ -1623,6 +1627,7 @@ void s3c_fb_update_regs(struct s3cfb_global *fbdev, struct s3c_reg_data *regs)
 		if (!fbdev->regs)
 			break;
 
+		vsyncs++;
 		wait_for_vsync = false;
 
 		for (i = 0; i < pdata->nr_wins; i++) {
@@ -1636,6 +1641,16 @@ void s3c_fb_update_regs(struct s3cfb_global *fbdev, struct s3c_reg_data *regs)
 	} while (wait_for_vsync);
 
 		sw_sync_timeline_inc(fbdev->timeline, 1);
+
+		/* the config is on screen from the vsync we just woke up on */
+		latency = ktime_to_us(ktime_sub(ktime_get(), regs->queued));
+		stats->commits++;
+		if (vsyncs > 1)
+			stats->missed_vsync += vsyncs - 1;
+		stats->latency_last = latency;
+		if (latency > stats->latency_max)
+			stats->latency_max = latency;
+		stats->latency_total += latency;
 	}
 
 #ifdef CONFIG_FB_S5P_SYSMMU
@@ -2004,6 +2019,7 @@ static int s3c_fb_set_win_config(struct s3cfb_global *fbdev,
 		sync_fence_install(fence, fd);
 		win_data->fence = fd;
 
+		regs->queued = ktime_get();
 		list_add_tail(&regs->list, &fbdev->update_regs_list);
 		mutex_unlock(&fbdev->update_regs_list_lock);
 		queue_kthread_work(&fbdev->update_regs_worker,
@@ -2222,6 +2238,7 @@ int s3cfb_ioctl(struct fb_info *fb, unsigned int cmd, unsigned long arg)
 		ret = s3c_fb_set_win_config(fbdev, &p.win_data);
 		if (ret)
 			break;
+		lcdfreq_frame_update();
 
 		if (copy_to_user((struct s3c_fb_win_config_data __user *)arg,
 				 &p.win_data,
@@ -13,6 +13,8 @@
 #include <linux/errno.h>
 #include <linux/mutex.h>
 #include <linux/wait.h>
+#include <linux/completion.h>
+#include <linux/sched.h>
 #include <linux/ctype.h>
 #include <linux/io.h>
 #include <linux/delay.h>
@@ -69,6 +71,8 @@
 #define ELVSS_MODE0_MIN_VOLTAGE	62
 #define ELVSS_MODE1_MIN_VOLTAGE	52
 
+#define GAMMA_LEVEL_MAX		25
+
 struct str_elvss {
 	u8 reference;
 	u8 limit;
@@ -103,11 +107,21 @@ struct lcd_info {
 	struct str_smart_dim		smart;
 	struct str_elvss		elvss;
 	struct mutex			bl_lock;
+
+	/* register values of every level, from the mtp at probe */
+	u8				gamma_regs[GAMMA_LEVEL_MAX][GAMMA_PARAM_SIZE];
+	u8				elvss_regs[GAMMA_LEVEL_MAX][3];
 #endif
 	unsigned int			irq;
 	unsigned int			connected;
 
 	struct dsim_global		*dsim;
+
+	/* brightness updates go to the dsim as one batch */
+	struct dsim_batch		batch;
+	struct dsim_cmd			batch_cmds[4];
+	struct task_struct		*batch_owner;
+	struct completion		batch_done;
 };
 
 extern void (*lcd_early_suspend)(void);
@@ -121,11 +135,26 @@ static int s6e39a0_write(struct lcd_info *lcd, const unsigned char *seq, int len
 	if (!lcd->connected)
 		return 0;
 
-	mutex_lock(&lcd->lock);
-
 	size = len;
 	wbuf = seq;
 
+	if (lcd->batch_owner == current &&
+	    lcd->batch.nr_cmds < ARRAY_SIZE(lcd->batch_cmds)) {
+		struct dsim_cmd *cmd = &lcd->batch_cmds[lcd->batch.nr_cmds++];
+
+		if (size == 1)
+			cmd->data_id = DCS_WR_NO_PARA;
+		else if (size == 2)
+			cmd->data_id = DCS_WR_1_PARA;
+		else
+			cmd->data_id = DCS_LONG_WR;
+		cmd->len = size;
+		cmd->buf = wbuf;
+		return 0;
+	}
+
+	mutex_lock(&lcd->lock);
+
 	if (size == 1)
 		lcd->dsim->ops->cmd_write(lcd->dsim, DCS_WR_NO_PARA, wbuf[0], 0);
 	else if (size == 2)
@@ -379,123 +408,21 @@ read_retry:
 	return ret;
 }
 
-static u32 transform_gamma(u32 brightness)
-{
-	u32 gamma;
-
-	switch (brightness) {
-	case 0:
-		gamma = 30;
-		break;
-	case 1 ... 29:
-		gamma = 30;
-		break;
-	case 30 ... 34:
-		gamma = 40;
-		break;
-	case 35 ... 44:
-		gamma = 70;
-		break;
-	case 45 ... 54:
-		gamma = 80;
-		break;
-	case 55 ... 64:
-		gamma = 90;
-		break;
-	case 65 ... 74:
-		gamma = 100;
-		break;
-	case 75 ... 83:
-		gamma = 110;
-		break;
-	case 84 ... 93:
-		gamma = 120;
-		break;
-	case 94 ... 103:
-		gamma = 130;
-		break;
-	case 104 ... 113:
-		gamma = 140;
-		break;
-	case 114 ... 122:
-		gamma = 150;
-		break;
-	case 123 ... 132:
-		gamma = 160;
-		break;
-	case 133 ... 142:
-		gamma = 170;
-		break;
-	case 143 ... 152:
-		gamma = 180;
-		break;
-	case 153 ... 162:
-		gamma = 190;
-		break;
-	case 163 ... 171:
-		gamma = 200;
-		break;
-	case 172 ... 181:
-		gamma = 210;
-		break;
-	case 182 ... 191:
-		gamma = 220;
-		break;
-	case 192 ... 201:
-		gamma = 230;
-		break;
-	case 202 ... 210:
-		gamma = 240;
-		break;
-	case 211 ... 220:
-		gamma = 250;
-		break;
-	case 221 ... 230:
-		gamma = 260;
-		break;
-	case 231 ... 240:
-		gamma = 270;
-		break;
-	case 241 ... 250:
-		gamma = 280;
-		break;
-	case 251 ... 255:
-		gamma = 290;
-		break;
-	default:
-		gamma = 150;
-		break;
-	}
-	return gamma - 1;
-}
+/* candela of each level of get_backlight_level_from_brightness() */
+static const u32 candela_table[GAMMA_LEVEL_MAX] = {
+	30,	40,	70,	80,	90,	100,	110,	120,
+	130,	140,	150,	160,	170,	180,	190,	200,
+	210,	220,	230,	240,	250,	260,	270,	280,
+	290
+};
 
-static int s6e8aa0_update_brightness(struct lcd_info *lcd, u32 brightness)
+static int s6e8aa0_update_brightness(struct lcd_info *lcd)
 {
-	int ret = 0;
-	u8 gamma_regs[GAMMA_PARAM_SIZE] = {0,};
-	u32 gamma;
-#if 0
-	int i;
-#endif
-
-	gamma_regs[0] = 0xFA;
-	gamma_regs[1] = 0x01;
-
-	gamma = brightness;
-
-	calc_gamma_table(&lcd->smart, gamma, gamma_regs+2);
-
-	s6e39a0_write(lcd, gamma_regs, GAMMA_PARAM_SIZE);
+	s6e39a0_write(lcd, lcd->gamma_regs[lcd->bl], GAMMA_PARAM_SIZE);
 
 	s6e39a0_write(lcd, SEQ_GAMMA_UPDATE, sizeof(SEQ_GAMMA_UPDATE));
 
-#if 0
-	printk(KERN_INFO "##### print gamma reg #####\n");
-	for (i = 0; i < 26; i++)
-		printk(KERN_INFO "[%02d] : %02x\n", i, gamma_regs[i]);
-#endif
-
-	return ret;
+	return 0;
 }
 
 static u8 get_offset_brightness(u32 candela)
@@ -541,30 +468,75 @@ static u8 get_elvss_value(struct lcd_info *lcd, u32 candela)
 	return ref;
 }
 
-static int s6e8aa0_update_elvss(struct lcd_info *lcd, u32 candela)
+static int s6e8aa0_update_elvss(struct lcd_info *lcd)
 {
-	u8 elvss_cmd[3];
-	u8 elvss;
+	s6e39a0_write(lcd, lcd->elvss_regs[lcd->bl], ARRAY_SIZE(lcd->elvss_regs[0]));
 
-	elvss = get_elvss_value(lcd, candela);
-	if (!elvss) {
-		printk(KERN_ERR "[ERROR:LCD]:%s:get_elvss_value() failed\n", __func__);
-		return -EPERM;
+	return 0;
+}
+
+/*
+ * The smart dimming math only depends on the mtp, so every level is
+ * worked out once here and a brightness change is a table lookup.
+ */
+static void init_gamma_table(struct lcd_info *lcd)
+{
+	u32 i, gamma;
+
+	for (i = 0; i < GAMMA_LEVEL_MAX; i++) {
+		gamma = candela_table[i] - 1;
+
+		lcd->gamma_regs[i][0] = 0xFA;
+		lcd->gamma_regs[i][1] = 0x01;
+		calc_gamma_table(&lcd->smart, gamma, &lcd->gamma_regs[i][2]);
+
+		lcd->elvss_regs[i][0] = 0xb1;
+		lcd->elvss_regs[i][1] = 0x04;
+		lcd->elvss_regs[i][2] = get_elvss_value(lcd, gamma);
 	}
+}
 
-	elvss_cmd[0] = 0xb1;
-	elvss_cmd[1] = 0x04;
-	elvss_cmd[2] = elvss;
+static void s6e39a0_batch_complete(struct dsim_batch *batch, int ret)
+{
+	struct lcd_info *lcd = batch->priv;
 
-	printk(KERN_DEBUG "elvss reg : %02x\n", elvss_cmd[2]);
-	s6e39a0_write(lcd, elvss_cmd, sizeof(elvss_cmd));
+	complete(&lcd->batch_done);
+}
 
-	return 0;
+/* collect the writes of this task into one dsim batch */
+static void s6e39a0_batch_begin(struct lcd_info *lcd)
+{
+	if (!lcd->connected || !lcd->dsim->ops->cmd_write_batch)
+		return;
+
+	/* the previous batch owns the packet list until it is sent */
+	wait_for_completion(&lcd->batch_done);
+
+	lcd->batch.nr_cmds = 0;
+	lcd->batch_owner = current;
+}
+
+static void s6e39a0_batch_end(struct lcd_info *lcd, u32 sync)
+{
+	if (lcd->batch_owner != current)
+		return;
+
+	lcd->batch_owner = NULL;
+
+	if (!lcd->batch.nr_cmds ||
+	    lcd->dsim->ops->cmd_write_batch(lcd->dsim, &lcd->batch)) {
+		complete(&lcd->batch_done);
+		return;
+	}
+
+	if (sync) {
+		wait_for_completion(&lcd->batch_done);
+		complete(&lcd->batch_done);
+	}
 }
 
 static int s6e39a0_adb_brightness_update(struct lcd_info *lcd, u32 br, u32 force)
 {
-	u32 gamma;
 	int ret = 0;
 
 	mutex_lock(&lcd->bl_lock);
@@ -572,17 +544,20 @@ static int s6e39a0_adb_brightness_update(struct lcd_info *lcd, u32 br, u32 force
 	lcd->bl = get_backlight_level_from_brightness(br);
 
 	if ((force) || ((lcd->ldi_enable) && (lcd->current_bl != lcd->bl))) {
-		gamma = transform_gamma(br);
+		s6e39a0_batch_begin(lcd);
 
-		ret = s6e8aa0_update_brightness(lcd, gamma);
+		ret = s6e8aa0_update_brightness(lcd);
 
 		ret = s6e39a0_set_acl(lcd);
 
 		if (lcd->support_elvss)
-			ret = s6e8aa0_update_elvss(lcd, gamma);
+			ret = s6e8aa0_update_elvss(lcd);
+
+		/* a forced update is part of power on, it has to be out first */
+		s6e39a0_batch_end(lcd, force);
 
 		lcd->current_bl = lcd->bl;
-		dev_info(&lcd->ld->dev, "brightness=%d, gamma=%d\n", br, gamma);
+		dev_info(&lcd->ld->dev, "brightness=%d, gamma=%d\n", br, candela_table[lcd->bl] - 1);
 	}
 
 	mutex_unlock(&lcd->bl_lock);
@@ -711,6 +686,14 @@ static int s6e39a0_power_off(struct lcd_info *lcd)
 
 	lcd->ldi_enable = 0;
 
+#ifdef SMART_DIMMING
+	/* let a brightness update still queued reach the panel first */
+	mutex_lock(&lcd->bl_lock);
+	wait_for_completion(&lcd->batch_done);
+	complete(&lcd->batch_done);
+	mutex_unlock(&lcd->bl_lock);
+#endif
+
 	ret = s6e39a0_ldi_disable(lcd);
 
 	msleep(120);
@@ -1012,6 +995,14 @@ static int s6e39a0_probe(struct device *dev)
 
 	mutex_init(&lcd->lock);
 
+#ifdef SMART_DIMMING
+	lcd->batch.cmds = lcd->batch_cmds;
+	lcd->batch.complete = s6e39a0_batch_complete;
+	lcd->batch.priv = lcd;
+	init_completion(&lcd->batch_done);
+	complete(&lcd->batch_done);
+#endif
+
 	s6e39a0_read_id(lcd, idbuf);
 
 	dev_info(&lcd->ld->dev, "ID : %x, %x, %x\n", idbuf[0], idbuf[1], idbuf[2]);
@@ -1032,6 +1023,8 @@ static int s6e39a0_probe(struct device *dev)
 
 	calc_voltage_table(&lcd->smart, mtp_data);
 
+	init_gamma_table(lcd);
+
 	mutex_init(&lcd->bl_lock);
 
 	s6e39a0_adb_brightness_update(lcd, lcd->bd->props.brightness, 1);
@@ -13,6 +13,8 @@
 #include <linux/errno.h>
 #include <linux/mutex.h>
 #include <linux/wait.h>
+#include <linux/completion.h>
+#include <linux/sched.h>
 #include <linux/ctype.h>
 #include <linux/io.h>
 #include <linux/delay.h>
@@ -133,6 +135,12 @@ struct lcd_info {
 	unsigned int			oled_detection_count;
 #endif
 	struct dsim_global		*dsim;
+
+	/* brightness updates go to the dsim as one batch */
+	struct dsim_batch		batch;
+	struct dsim_cmd			batch_cmds[8];
+	struct task_struct		*batch_owner;
+	struct completion		batch_done;
 };
 
 struct lcd_info *lcd_ptr;
@@ -231,11 +239,26 @@ static int s6e8ax0_write(struct lcd_info *lcd, const unsigned char *seq, int len
 	if (!lcd->connected)
 		return 0;
 
-	mutex_lock(&lcd->lock);
-
 	size = len;
 	wbuf = seq;
 
+	if (lcd->batch_owner == current &&
+	    lcd->batch.nr_cmds < ARRAY_SIZE(lcd->batch_cmds)) {
+		struct dsim_cmd *cmd = &lcd->batch_cmds[lcd->batch.nr_cmds++];
+
+		if (size == 1)
+			cmd->data_id = DCS_WR_NO_PARA;
+		else if (size == 2)
+			cmd->data_id = DCS_WR_1_PARA;
+		else
+			cmd->data_id = DCS_LONG_WR;
+		cmd->len = size;
+		cmd->buf = wbuf;
+		return 0;
+	}
+
+	mutex_lock(&lcd->lock);
+
 	if (size == 1)
 		lcd->dsim->ops->cmd_write(lcd->dsim, DCS_WR_NO_PARA, wbuf[0], 0);
 	else if (size == 2)
@@ -248,6 +271,49 @@ static int s6e8ax0_write(struct lcd_info *lcd, const unsigned char *seq, int len
 	return 0;
 }
 
+static void s6e8ax0_batch_complete(struct dsim_batch *batch, int ret)
+{
+	struct lcd_info *lcd = batch->priv;
+
+	complete(&lcd->batch_done);
+}
+
+/*
+ * Collect the writes of this task into one dsim batch until
+ * s6e8ax0_batch_end(). The tables written are never freed, the packets
+ * only need to point at them.
+ */
+static void s6e8ax0_batch_begin(struct lcd_info *lcd)
+{
+	if (!lcd->connected || !lcd->dsim->ops->cmd_write_batch)
+		return;
+
+	/* the previous batch owns the packet list until it is sent */
+	wait_for_completion(&lcd->batch_done);
+
+	lcd->batch.nr_cmds = 0;
+	lcd->batch_owner = current;
+}
+
+static void s6e8ax0_batch_end(struct lcd_info *lcd, u8 sync)
+{
+	if (lcd->batch_owner != current)
+		return;
+
+	lcd->batch_owner = NULL;
+
+	if (!lcd->batch.nr_cmds ||
+	    lcd->dsim->ops->cmd_write_batch(lcd->dsim, &lcd->batch)) {
+		complete(&lcd->batch_done);
+		return;
+	}
+
+	if (sync) {
+		wait_for_completion(&lcd->batch_done);
+		complete(&lcd->batch_done);
+	}
+}
+
 static int _s6e8ax0_read(struct lcd_info *lcd, const u8 addr, u16 count, u8 *buf)
 {
 	int ret = 0;
@@ -1012,6 +1078,8 @@ static int update_brightness(struct lcd_info *lcd, u8 force)
 	lcd->bl = get_backlight_level_from_brightness(brightness);
 
 	if ((force) || ((lcd->ldi_enable) && (lcd->current_bl != lcd->bl))) {
+		s6e8ax0_batch_begin(lcd);
+
 		s6e8ax0_gamma_ctl(lcd);
 
 #ifdef CONFIG_AID_DIMMING
@@ -1021,6 +1089,9 @@ static int update_brightness(struct lcd_info *lcd, u8 force)
 
 		s6e8ax0_set_elvss(lcd, force);
 
+		/* a forced update is part of power on, it has to be out first */
+		s6e8ax0_batch_end(lcd, force);
+
 		lcd->current_bl = lcd->bl;
 
 		dev_info(&lcd->ld->dev, "brightness=%d, bl=%d, candela=%d\n", brightness, lcd->bl, candela_table[lcd->bl]);
@@ -1149,6 +1220,12 @@ static int s6e8ax0_power_off(struct lcd_info *lcd)
 
 	lcd->ldi_enable = 0;
 
+	/* let a brightness update still queued reach the panel first */
+	mutex_lock(&lcd->bl_lock);
+	wait_for_completion(&lcd->batch_done);
+	complete(&lcd->batch_done);
+	mutex_unlock(&lcd->bl_lock);
+
 	ret = s6e8ax0_ldi_disable(lcd);
 
 	msleep(135);
@@ -1755,6 +1832,12 @@ static int s6e8ax0_probe(struct device *dev)
 	mutex_init(&lcd->lock);
 	mutex_init(&lcd->bl_lock);
 
+	lcd->batch.cmds = lcd->batch_cmds;
+	lcd->batch.complete = s6e8ax0_batch_complete;
+	lcd->batch.priv = lcd;
+	init_completion(&lcd->batch_done);
+	complete(&lcd->batch_done);
+
 	s6e8ax0_read_id(lcd, lcd->id);
 
 	dev_info(&lcd->ld->dev, "ID: %x, %x, %x\n", lcd->id[0], lcd->id[1], lcd->id[2]);
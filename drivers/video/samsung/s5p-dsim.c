@@ -89,6 +89,8 @@ static DECLARE_COMPLETION(dsim_wr_comp);
 #define DSIM_TIMEOUT				msecs_to_jiffies(250)
 #define DSIM_RX_FIFO_READ_DONE		0x30800002
 #define DSIM_MAX_RX_FIFO			20
+#define DSIM_SFR_PAYLOAD_SZ			512
+#define DSIM_BATCH_VBLANK_TIMEOUT		msecs_to_jiffies(34)
 
 #define S5P_DSIM_INT_SFR_FIFO_EMPTY		29
 #define S5P_DSIM_INT_BTA			25
@@ -122,8 +124,11 @@ static void s5p_dsim_frame_done_interrupt_enable(struct dsim_global *dsim, u8 en
 
 	intmsk = readl(dsim->reg_base + S5P_DSIM_INTMSK);
 
-	if (state == 0)	/* enable Frame Done interrupts */
+	if (state == 0) {	/* enable Frame Done interrupts */
 		intmsk &= ~(0x01 << S5P_DSIM_INT_MSK_FRAME_DONE);
+		/* somebody else wants it now, the batches stop owning it */
+		dsim->batch_frame_done = 0;
+	}
 	else	/* disable Frame Done interrupts */
 		intmsk |= (0x01 << S5P_DSIM_INT_MSK_FRAME_DONE);
 
@@ -290,6 +295,257 @@ unsigned char s5p_dsim_wr_data(void *ptr,
 	}
 }
 
+/*
+ * Command batches. A brightness step or a gamma table is a handful of
+ * packets that belong together, the panel driver queues them and goes
+ * on. They are written at the next frame done, so they go out in the
+ * blanking that follows, and the fifos are filled with as many packets
+ * as fit before waiting once for them to drain, not once per long packet.
+ */
+static int s5p_dsim_batch_cmd_size(const struct dsim_cmd *cmd)
+{
+	switch (cmd->data_id) {
+	case GEN_SHORT_WR_NO_PARA:
+	case DCS_WR_NO_PARA:
+		return 0;
+	case GEN_SHORT_WR_1_PARA:
+	case DCS_WR_1_PARA:
+		return cmd->len >= 1 ? 0 : -EINVAL;
+	case GEN_SHORT_WR_2_PARA:
+		return cmd->len >= 2 ? 0 : -EINVAL;
+	case GEN_LONG_WR:
+	case DCS_LONG_WR:
+		if (!cmd->len || cmd->len > DSIM_SFR_PAYLOAD_SZ)
+			return -EINVAL;
+		return ALIGN(cmd->len, 4);
+	default:
+		return -EINVAL;
+	}
+}
+
+static void s5p_dsim_batch_wr_cmd(unsigned int dsim_base,
+	const struct dsim_cmd *cmd)
+{
+	u32 word;
+	u16 i;
+
+	switch (cmd->data_id) {
+	case GEN_LONG_WR:
+	case DCS_LONG_WR:
+		for (i = 0; i < cmd->len; i += 4) {
+			word = 0;
+			memcpy(&word, cmd->buf + i, min_t(u16, 4, cmd->len - i));
+			s5p_dsim_wr_tx_data(dsim_base, word);
+		}
+		s5p_dsim_wr_tx_header(dsim_base, cmd->data_id,
+			cmd->len & 0xff, cmd->len >> 8);
+		break;
+	default:
+		s5p_dsim_wr_tx_header(dsim_base, cmd->data_id,
+			cmd->len > 0 ? cmd->buf[0] : 0,
+			cmd->len > 1 ? cmd->buf[1] : 0);
+		break;
+	}
+}
+
+/* wait for the header and payload fifos to be empty */
+static int s5p_dsim_batch_drain(struct dsim_global *dsim)
+{
+	unsigned int dsim_base = dsim->reg_base;
+	unsigned int empty = SFR_HEADER_EMPTY | SFR_PAYLOAD_EMPTY;
+
+	for (;;) {
+		INIT_COMPLETION(dsim_wr_comp);
+		s5p_dsim_clear_interrupt(dsim_base, 0x01<<S5P_DSIM_INT_SFR_FIFO_EMPTY);
+
+		if ((s5p_dsim_get_fifo_state(dsim_base) & empty) == empty)
+			return 0;
+
+		if (!wait_for_completion_timeout(&dsim_wr_comp, DSIM_TIMEOUT))
+			return -ETIMEDOUT;
+	}
+}
+
+static int s5p_dsim_batch_wr(struct dsim_global *dsim, struct dsim_batch *batch)
+{
+	unsigned int headers = 0, payload = 0, i;
+	int size, ret = 0;
+
+	if (dsim->state == DSIM_STATE_ULPS || !dsim->mipi_ddi_pd->resume_complete)
+		return -EIO;
+
+	mutex_lock(&dsim_rd_wr_mutex);
+
+	for (i = 0; i < batch->nr_cmds; i++) {
+		size = s5p_dsim_batch_cmd_size(&batch->cmds[i]);
+
+		if (headers == DSIM_HEADER_FIFO_SZ ||
+		    payload + size > DSIM_SFR_PAYLOAD_SZ) {
+			ret = s5p_dsim_batch_drain(dsim);
+			if (ret)
+				break;
+			headers = 0;
+			payload = 0;
+		}
+
+		s5p_dsim_batch_wr_cmd(dsim->reg_base, &batch->cmds[i]);
+		headers++;
+		payload += size;
+	}
+
+	if (!ret)
+		ret = s5p_dsim_batch_drain(dsim);
+
+	mutex_unlock(&dsim_rd_wr_mutex);
+
+	return ret;
+}
+
+static void dsim_batch_work_handler(struct work_struct *work)
+{
+	struct dsim_global *dsim =
+		container_of(work, struct dsim_global, batch_work);
+	struct dsim_batch_stats *stats = &dsim->batch_stats;
+	struct dsim_batch *batch, *n;
+	unsigned long flags;
+	unsigned int us;
+	ktime_t start;
+	LIST_HEAD(list);
+	int ret;
+
+	spin_lock_irqsave(&dsim->slock, flags);
+	list_splice_init(&dsim->batch_list, &list);
+	spin_unlock_irqrestore(&dsim->slock, flags);
+
+	list_for_each_entry_safe(batch, n, &list, list) {
+		list_del_init(&batch->list);
+
+		start = ktime_get();
+		us = ktime_to_us(ktime_sub(start, batch->queued));
+		if (us > stats->max_wait_us)
+			stats->max_wait_us = us;
+
+		ret = s5p_dsim_batch_wr(dsim, batch);
+
+		us = ktime_to_us(ktime_sub(ktime_get(), start));
+		stats->batches++;
+		stats->cmds += batch->nr_cmds;
+		stats->last_us = us;
+		stats->total_us += us;
+		if (us > stats->max_us)
+			stats->max_us = us;
+
+		if (ret) {
+			stats->errors++;
+			dev_err(dsim->dev, "%s: batch of %u failed, %d\n",
+				__func__, batch->nr_cmds, ret);
+		}
+
+		if (batch->complete)
+			batch->complete(batch, ret);
+	}
+}
+
+/* no frame done in time, the panel may not be scanning out */
+static void dsim_batch_timer_handler(unsigned long data)
+{
+	struct dsim_global *dsim = (struct dsim_global *)data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&dsim->slock, flags);
+	if (dsim->batch_vblank) {
+		dsim->batch_vblank = 0;
+		dsim->batch_stats.vblank_timeouts++;
+		queue_work(system_nrt_wq, &dsim->batch_work);
+	}
+	spin_unlock_irqrestore(&dsim->slock, flags);
+}
+
+/*
+ * Called from the isr on frame done. Returns true when the interrupt was
+ * only enabled for the batches, the hs clock toggling is left alone then.
+ */
+static bool s5p_dsim_batch_frame_done(struct dsim_global *dsim)
+{
+	bool own;
+
+	spin_lock(&dsim->slock);
+
+	if (dsim->batch_vblank) {
+		dsim->batch_vblank = 0;
+		del_timer(&dsim->batch_timer);
+		queue_work(system_nrt_wq, &dsim->batch_work);
+	}
+
+	own = dsim->batch_frame_done;
+	if (own) {
+		s5p_dsim_frame_done_interrupt_enable(dsim, 0);
+		dsim->batch_frame_done = 0;
+	}
+
+	spin_unlock(&dsim->slock);
+
+	return own;
+}
+
+/* write out whatever is queued now, without waiting for frame done */
+static void s5p_dsim_batch_flush(struct dsim_global *dsim)
+{
+	unsigned long flags;
+
+	del_timer_sync(&dsim->batch_timer);
+
+	spin_lock_irqsave(&dsim->slock, flags);
+	dsim->batch_vblank = 0;
+	spin_unlock_irqrestore(&dsim->slock, flags);
+
+	queue_work(system_nrt_wq, &dsim->batch_work);
+	flush_work(&dsim->batch_work);
+}
+
+int s5p_dsim_wr_batch(void *ptr, struct dsim_batch *batch)
+{
+	struct dsim_global *dsim = ptr;
+	unsigned long flags;
+	unsigned int i;
+	int now;
+
+	for (i = 0; i < batch->nr_cmds; i++) {
+		if (s5p_dsim_batch_cmd_size(&batch->cmds[i]) < 0) {
+			dev_warn(dsim->dev, "%s: bad packet %u, data id %x len %u\n",
+				__func__, i, batch->cmds[i].data_id, batch->cmds[i].len);
+			return -EINVAL;
+		}
+	}
+
+	batch->queued = ktime_get();
+
+	spin_lock_irqsave(&dsim->slock, flags);
+
+	list_add_tail(&batch->list, &dsim->batch_list);
+
+	/* without a panel scanning out there is no frame done to wait for */
+	now = !dsim->dsim_lcd_info->lcd_enabled ||
+		!dsim->mipi_ddi_pd->resume_complete;
+
+	if (!now && !dsim->batch_vblank) {
+		dsim->batch_vblank = 1;
+		if (readl(dsim->reg_base + S5P_DSIM_INTMSK) &
+		    (0x01 << S5P_DSIM_INT_MSK_FRAME_DONE)) {
+			s5p_dsim_frame_done_interrupt_enable(dsim, 1);
+			dsim->batch_frame_done = 1;
+		}
+		mod_timer(&dsim->batch_timer, jiffies + DSIM_BATCH_VBLANK_TIMEOUT);
+	}
+
+	spin_unlock_irqrestore(&dsim->slock, flags);
+
+	if (now)
+		queue_work(system_nrt_wq, &dsim->batch_work);
+
+	return 0;
+}
+
 int s5p_dsim_rd_data(void *ptr, u8 addr, u16 count, u8 *buf)
 {
 	u32 i, temp;
@@ -575,6 +831,8 @@ static irqreturn_t s5p_dsim_isr(int irq, void *dev_id)
 				break;
 			case S5P_DSIM_INT_MSK_FRAME_DONE:
 				/* printk("S5P_DSIM_INT_MSK_FRAME_DONE\n"); */
+				if (s5p_dsim_batch_frame_done(dsim))
+					break;
 				if (dsim->dsim_lcd_info->lcd_enabled && dsim->mipi_ddi_pd->resume_complete) {
 					if (completion_done(&dsim_wr_comp) && completion_done(&dsim_rd_comp)) {
 						if (s3cfb_vsync_status_check()) {
@@ -1192,6 +1450,8 @@ void s5p_dsim_early_suspend(void)
 	if (dsim->mipi_ddi_pd->resume_complete == 0)
 		return;
 
+	s5p_dsim_batch_flush(dsim);
+
 	dsim->mipi_ddi_pd->resume_complete = 0;
 	dsim->dsim_lcd_info->lcd_enabled = 0;
 
@@ -1291,6 +1551,8 @@ static int s5p_dsim_suspend(struct platform_device *pdev, pm_message_t state)
 
 	dev_info(&pdev->dev, "%s\n", __func__);
 
+	s5p_dsim_batch_flush(dsim);
+
 	dsim->mipi_ddi_pd->resume_complete = 0;
 
 	if (dsim->mipi_drv->suspend)
@@ -1420,8 +1682,27 @@ static ssize_t dsim_dump_show(struct device *dev,
 }
 static DEVICE_ATTR(dsim_dump, 0444, dsim_dump_show, NULL);
 
+static ssize_t dsim_batch_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct dsim_global *dsim = dev_get_drvdata(dev);
+	struct dsim_batch_stats *stats = &dsim->batch_stats;
+	u64 avg = stats->total_us;
+
+	if (stats->batches)
+		do_div(avg, stats->batches);
+
+	return sprintf(buf, "batches %lu\ncmds %lu\nerrors %lu\n"
+		"vblank_timeouts %lu\nlast_us %u\nmax_us %u\navg_us %llu\n"
+		"max_wait_us %u\n", stats->batches, stats->cmds, stats->errors,
+		stats->vblank_timeouts, stats->last_us, stats->max_us, avg,
+		stats->max_wait_us);
+}
+static DEVICE_ATTR(dsim_batch, 0444, dsim_batch_show, NULL);
+
 static struct dsim_ops s5p_dsim_ops = {
 	.cmd_write	= s5p_dsim_wr_data,
+	.cmd_write_batch = s5p_dsim_wr_batch,
 	.cmd_read	= s5p_dsim_rd_data,
 	.cmd_dcs_read	= s5p_dsim_dcs_rd_data,
 	.suspend	= s5p_dsim_early_suspend,
@@ -1530,6 +1811,10 @@ static int s5p_dsim_probe(struct platform_device *pdev)
 	mutex_init(&dsim_rd_wr_mutex);
 	spin_lock_init(&dsim->slock);
 
+	INIT_LIST_HEAD(&dsim->batch_list);
+	INIT_WORK(&dsim->batch_work, dsim_batch_work_handler);
+	setup_timer(&dsim->batch_timer, dsim_batch_timer_handler, (unsigned long)dsim);
+
 	dsim->mipi_ddi_pd->resume_complete = 1;
 	dsim->dsim_lcd_info->lcd_enabled = 1;
 
@@ -1580,6 +1865,10 @@ static int s5p_dsim_probe(struct platform_device *pdev)
 	if (ret < 0)
 		dev_err(&pdev->dev, "failed to add sysfs entries, %d\n", __LINE__);
 
+	ret = device_create_file(&(pdev->dev), &dev_attr_dsim_batch);
+	if (ret < 0)
+		dev_err(&pdev->dev, "failed to add sysfs entries, %d\n", __LINE__);
+
 	if (!dsim->dsim_info->hs_toggle) {
 		ret = device_create_file(&dsim->panel, &dev_attr_hs_toggle);
 		if (ret < 0)
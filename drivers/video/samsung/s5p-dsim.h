@@ -17,6 +17,10 @@
 #define _S5P_DSIM_H
 
 #include <linux/device.h>
+#include <linux/ktime.h>
+#include <linux/list.h>
+#include <linux/timer.h>
+#include <linux/workqueue.h>
 
 enum dsim_read_id {
 	Ack = 0x02,
@@ -41,8 +45,45 @@ struct mipi_lcd_driver {
 	s32	(*resume)(struct device *dev);
 };
 
+/*
+ * One write packet of a batch. Short packets take their parameters from
+ * the first two bytes of buf, long ones send len bytes of it.
+ */
+struct dsim_cmd {
+	u8		data_id;
+	u16		len;
+	const u8	*buf;
+};
+
+/*
+ * A list of packets written out back to back at the next frame done.
+ * cmds and the batch itself belong to the dsim driver until complete is
+ * called, from process context, with 0 or a negative error.
+ */
+struct dsim_batch {
+	const struct dsim_cmd	*cmds;
+	unsigned int		nr_cmds;
+	void			(*complete)(struct dsim_batch *batch, int ret);
+	void			*priv;
+
+	struct list_head	list;
+	ktime_t			queued;
+};
+
+struct dsim_batch_stats {
+	unsigned long	batches;
+	unsigned long	cmds;
+	unsigned long	errors;
+	unsigned long	vblank_timeouts;
+	unsigned int	last_us;	/* first packet to fifos drained */
+	unsigned int	max_us;
+	u64		total_us;
+	unsigned int	max_wait_us;	/* queued to first packet */
+};
+
 struct dsim_ops {
 	u8	(*cmd_write)(void *ptr, u32 data0, u32 data1, u32 data2);
+	int	(*cmd_write_batch)(void *ptr, struct dsim_batch *batch);
 	int	(*cmd_read)(void *ptr, u8 addr, u16 count, u8 *buf);
 	int	(*cmd_dcs_read)(void *ptr, u8 addr, u16 count, u8 *buf);
 	void	(*suspend)(void);
@@ -92,7 +92,12 @@
  */
 
 /* Epoll private bits inside the event mask */
-#define EP_PRIVATE_BITS (EPOLLWAKEUP | EPOLLONESHOT | EPOLLET)
+#define EP_PRIVATE_BITS (EPOLLWAKEUP | EPOLLONESHOT | EPOLLET | EPOLLEXCLUSIVE)
+
+#define EPOLLINOUT_BITS (POLLIN | POLLOUT)
+
+#define EPOLLEXCLUSIVE_OK_BITS (EPOLLINOUT_BITS | POLLERR | POLLHUP | \
+				EPOLLWAKEUP | EPOLLET | EPOLLEXCLUSIVE)
 
 /* Maximum number of nesting allowed inside epoll sets */
 #define EP_MAX_NESTS 4
@@ -213,6 +218,12 @@ struct eventpoll {
 	/* used to optimize loop detection check */
 	int visited;
 	struct list_head visited_list_link;
+
+	/* set with EPIOCSPARAMS, 0 when waiters return right away */
+	unsigned int coalesce_usecs;
+
+	/* counters for EPIOCGSTATS, updated under ->lock */
+	struct epoll_stats stats;
 };
 
 /* Wait structure used by the poll hooks */
@@ -787,10 +798,47 @@ static unsigned int ep_eventpoll_poll(struct file *file, poll_table *wait)
 	return pollflags != -1 ? pollflags : 0;
 }
 
+static long ep_eventpoll_ioctl(struct file *file, unsigned int cmd,
+			       unsigned long arg)
+{
+	struct eventpoll *ep = file->private_data;
+	void __user *uarg = (void __user *)arg;
+	struct epoll_params params;
+	struct epoll_stats stats;
+
+	switch (cmd) {
+	case EPIOCSPARAMS:
+		if (copy_from_user(&params, uarg, sizeof(params)))
+			return -EFAULT;
+		if (params.__pad ||
+		    params.coalesce_usecs > EPOLL_MAX_COALESCE_USECS)
+			return -EINVAL;
+		ACCESS_ONCE(ep->coalesce_usecs) = params.coalesce_usecs;
+		return 0;
+	case EPIOCGPARAMS:
+		memset(&params, 0, sizeof(params));
+		params.coalesce_usecs = ACCESS_ONCE(ep->coalesce_usecs);
+		if (copy_to_user(uarg, &params, sizeof(params)))
+			return -EFAULT;
+		return 0;
+	case EPIOCGSTATS:
+		spin_lock_irq(&ep->lock);
+		stats = ep->stats;
+		spin_unlock_irq(&ep->lock);
+		if (copy_to_user(uarg, &stats, sizeof(stats)))
+			return -EFAULT;
+		return 0;
+	}
+
+	return -ENOTTY;
+}
+
 /* File callbacks that implement the eventpoll file behaviour */
 static const struct file_operations eventpoll_fops = {
 	.release	= ep_eventpoll_release,
 	.poll		= ep_eventpoll_poll,
+	.unlocked_ioctl	= ep_eventpoll_ioctl,
+	.compat_ioctl	= ep_eventpoll_ioctl,
 	.llseek		= noop_llseek,
 };
 
@@ -899,7 +947,7 @@ static struct epitem *ep_find(struct eventpoll *ep, struct file *file, int fd)
  */
 static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *key)
 {
-	int pwake = 0;
+	int pwake = 0, ewake = 0;
 	unsigned long flags;
 	struct epitem *epi = ep_item_from_wait(wait);
 	struct eventpoll *ep = epi->ep;
@@ -967,8 +1015,11 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
 	 * wait list.
 	 */
-	if (waitqueue_active(&ep->wq))
+	if (waitqueue_active(&ep->wq)) {
+		ewake = 1;
+		ep->stats.wakeups++;
 		wake_up_locked(&ep->wq);
+	}
 	if (waitqueue_active(&ep->poll_wait))
 		pwake++;
 
@@ -979,7 +1030,15 @@ out_unlock:
 	if (pwake)
 		ep_poll_safewake(&ep->poll_wait);
 
-	return 1;
+	/*
+	 * An exclusive entry only counts towards the one exclusive wakeup
+	 * of the file's wait queue if it actually woke somebody up, so the
+	 * next epoll descriptor in line gets the event otherwise.
+	 */
+	if (!(epi->event.events & EPOLLEXCLUSIVE))
+		ewake = 1;
+
+	return ewake;
 }
 
 /*
@@ -996,7 +1055,10 @@ static void ep_ptable_queue_proc(struct file *file, wait_queue_head_t *whead,
 		init_waitqueue_func_entry(&pwq->wait, ep_poll_callback);
 		pwq->whead = whead;
 		pwq->base = epi;
-		add_wait_queue(whead, &pwq->wait);
+		if (epi->event.events & EPOLLEXCLUSIVE)
+			add_wait_queue_exclusive(whead, &pwq->wait);
+		else
+			add_wait_queue(whead, &pwq->wait);
 		list_add_tail(&pwq->llink, &epi->pwqlist);
 		epi->nwait++;
 	} else {
@@ -1470,7 +1532,8 @@ static inline struct timespec ep_set_mstimeout(long ms)
 static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 		   int maxevents, long timeout)
 {
-	int res = 0, eavail, timed_out = 0;
+	int res = 0, eavail, timed_out = 0, waited = 0;
+	unsigned int coalesce_usecs;
 	unsigned long flags;
 	long slack = 0;
 	wait_queue_t wait;
@@ -1503,6 +1566,8 @@ fetch_events:
 		 */
 		init_waitqueue_entry(&wait, current);
 		__add_wait_queue_exclusive(&ep->wq, &wait);
+		ep->stats.waits++;
+		waited = 1;
 
 		for (;;) {
 			/*
@@ -1534,6 +1599,26 @@ check_events:
 
 	spin_unlock_irqrestore(&ep->lock, flags);
 
+	/*
+	 * Woken by the first of possibly several files becoming ready: let
+	 * the others catch up before going to userspace. Nobody wakes us
+	 * while we are off the wait queue, a signal cuts the delay short.
+	 */
+	coalesce_usecs = ACCESS_ONCE(ep->coalesce_usecs);
+	if (coalesce_usecs && waited && eavail && !res && !timed_out) {
+		ktime_t delay = ktime_add_us(ktime_get(), coalesce_usecs);
+
+		if (to && ktime_to_ns(delay) > ktime_to_ns(*to))
+			delay = *to;
+		set_current_state(TASK_INTERRUPTIBLE);
+		schedule_hrtimeout_range(&delay, 0, HRTIMER_MODE_ABS);
+
+		spin_lock_irqsave(&ep->lock, flags);
+		ep->stats.coalesced++;
+		spin_unlock_irqrestore(&ep->lock, flags);
+		waited = 0;
+	}
+
 	/*
 	 * Try to transfer events to user space. In case we get 0 events and
 	 * there's still timeout left over, we go trying again in search of
@@ -1543,6 +1628,12 @@ check_events:
 	    !(res = ep_send_events(ep, events, maxevents)) && !timed_out)
 		goto fetch_events;
 
+	if (res > 0) {
+		spin_lock_irqsave(&ep->lock, flags);
+		ep->stats.events += res;
+		spin_unlock_irqrestore(&ep->lock, flags);
+	}
+
 	return res;
 }
 
@@ -1758,6 +1849,19 @@ if (!god_mode_enabled) {
 	 */
 	ep = file->private_data;
 
+	/*
+	 * An exclusive wakeup is only defined for files that are not epoll
+	 * descriptors themselves, with a subset of the event bits, and it
+	 * can't be changed or enabled afterwards.
+	 */
+	if (ep_op_has_event(op) && (epds.events & EPOLLEXCLUSIVE)) {
+		if (op == EPOLL_CTL_MOD)
+			goto error_tgt_fput;
+		if (op == EPOLL_CTL_ADD && (is_file_epoll(tfile) ||
+				(epds.events & ~EPOLLEXCLUSIVE_OK_BITS)))
+			goto error_tgt_fput;
+	}
+
 	/*
 	 * When we insert an epoll file descriptor, inside another epoll file
 	 * descriptor, there is the change of creating closed loops, which are
@@ -1812,8 +1916,10 @@ if (!god_mode_enabled) {
 		break;
 	case EPOLL_CTL_MOD:
 		if (epi) {
-			epds.events |= POLLERR | POLLHUP;
-			error = ep_modify(ep, epi, &epds);
+			if (!(epi->event.events & EPOLLEXCLUSIVE)) {
+				epds.events |= POLLERR | POLLHUP;
+				error = ep_modify(ep, epi, &epds);
+			}
 		} else
 			error = -ENOENT;
 		break;
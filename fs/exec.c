@@ -58,6 +58,7 @@
 #include <linux/pipe_fs_i.h>
 #include <linux/oom.h>
 #include <linux/compat.h>
+#include <linux/vmacache.h>
 
 #include <asm/uaccess.h>
 #include <asm/mmu_context.h>
@@ -854,6 +855,8 @@ static int exec_mmap(struct mm_struct *mm)
 	tsk->mm = mm;
 	tsk->active_mm = mm;
 	activate_mm(active_mm, mm);
+	tsk->mm->vmacache_seqnum = 0;
+	vmacache_flush(tsk);
 	task_unlock(tsk);
 	arch_pick_mmap_layout(mm);
 	if (old_mm) {
@@ -966,6 +969,8 @@ static int de_thread(struct task_struct *tsk)
 
 		tsk->group_leader = tsk;
 		leader->group_leader = tsk;
+		lowmem_adj_tree_del(leader);
+		lowmem_adj_tree_add(tsk);
 
 		tsk->exit_signal = SIGCHLD;
 		leader->exit_signal = -1;
@@ -58,6 +58,7 @@
 #define MAX_PATH_LENGTH         260     /* max len of path name including NULL */
 #define DOS_NAME_LENGTH         11      /* DOS file name length excluding NULL */
 #define DOS_PATH_LENGTH         80      /* DOS path name length excluding NULL */
+#define MAX_CLU_EXTENTS         8       /* cached FAT chain runs per file */
 
 /* file attributes */
 #define ATTR_NORMAL             0x0000
@@ -136,6 +137,13 @@ typedef struct {
 	u8       flags;
 } CHAIN_T;
 
+/* contiguous run of a FAT chain: clusters off..off+len-1 of the file */
+typedef struct {
+	s32       off;
+	u32      clu;
+	u32      len;
+} CLU_EXTENT_T;
+
 /* file id structure */
 typedef struct {
 	CHAIN_T     dir;
@@ -148,6 +156,9 @@ typedef struct {
 	s64       rwoffset;
 	s32       hint_last_off;
 	u32      hint_last_clu;
+	CLU_EXTENT_T extent[MAX_CLU_EXTENTS];
+	u8       num_extents;
+	u8       next_extent;
 } FILE_ID_T;
 
 typedef struct {
@@ -44,9 +44,6 @@
 /*  Global Variable Definitions                                         */
 /*----------------------------------------------------------------------*/
 
-#define sm_P(s)
-#define sm_V(s)
-
 static s32 __FAT_read(struct super_block *sb, u32 loc, u32 *content);
 static s32 __FAT_write(struct super_block *sb, u32 loc, u32 content);
 
@@ -77,6 +74,8 @@ s32 buf_init(struct super_block *sb)
 
 	int i;
 
+	p_fs->FAT_ra_start = p_fs->FAT_ra_end = 0;
+
 	/* LRU list */
 	p_fs->FAT_cache_lru_list.next = p_fs->FAT_cache_lru_list.prev = &p_fs->FAT_cache_lru_list;
 
@@ -138,28 +137,12 @@ s32 buf_shutdown(struct super_block *sb)
   */
 s32 FAT_read(struct super_block *sb, u32 loc, u32 *content)
 {
-	s32 ret;
-
-	sm_P(&f_sem);
-
-	ret = __FAT_read(sb, loc, content);
-
-	sm_V(&f_sem);
-
-	return ret;
+	return __FAT_read(sb, loc, content);
 } /* end of FAT_read */
 
 s32 FAT_write(struct super_block *sb, u32 loc, u32 content)
 {
-	s32 ret;
-
-	sm_P(&f_sem);
-
-	ret = __FAT_write(sb, loc, content);
-
-	sm_V(&f_sem);
-
-	return ret;
+	return __FAT_write(sb, loc, content);
 } /* end of FAT_write */
 
 static s32 __FAT_read(struct super_block *sb, u32 loc, u32 *content)
@@ -381,11 +364,34 @@ static s32 __FAT_write(struct super_block *sb, u32 loc, u32 content)
 	return 0;
 } /* end of __FAT_write */
 
+/* start reading the FAT sectors following a miss at sec */
+static void FAT_readahead(struct super_block *sb, u32 sec)
+{
+	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
+	BD_INFO_T *p_bd = &(EXFAT_SB(sb)->bd_info);
+	u32 end = p_fs->FAT1_start_sector + p_fs->num_FAT_sectors;
+
+	/* still inside the window issued by the previous miss */
+	if ((sec >= p_fs->FAT_ra_start) && (sec < p_fs->FAT_ra_end))
+		return;
+
+	p_fs->FAT_ra_start = sec;
+	p_fs->FAT_ra_end = min(sec + FAT_RA_SECTORS, end);
+
+	for (sec++; sec < p_fs->FAT_ra_end; sec++)
+		__breadahead(sb->s_bdev, sec, p_bd->sector_size);
+} /* end of FAT_readahead */
+
 u8 *FAT_getblk(struct super_block *sb, u32 sec)
 {
 	BUF_CACHE_T *bp;
 	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
 
+	/* chain walks hit the same sector many times in a row */
+	bp = p_fs->FAT_cache_lru_list.next;
+	if ((bp->sec == sec) && (bp->drv == p_fs->drv) && bp->buf_bh)
+		return bp->buf_bh->b_data;
+
 	bp = FAT_cache_find(sb, sec);
 	if (bp != NULL) {
 		move_to_mru(bp, &p_fs->FAT_cache_lru_list);
@@ -402,6 +408,10 @@ u8 *FAT_getblk(struct super_block *sb, u32 sec)
 
 	FAT_cache_insert_hash(sb, bp);
 
+	if ((sec >= p_fs->FAT1_start_sector) &&
+	    (sec < p_fs->FAT1_start_sector + p_fs->num_FAT_sectors))
+		FAT_readahead(sb, sec);
+
 	if (sector_read(sb, sec, &(bp->buf_bh), 1) != FFS_SUCCESS) {
 		FAT_cache_remove_hash(bp);
 		bp->drv = -1;
@@ -430,8 +440,6 @@ void FAT_release_all(struct super_block *sb)
 	BUF_CACHE_T *bp;
 	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
 
-	sm_P(&f_sem);
-
 	bp = p_fs->FAT_cache_lru_list.next;
 	while (bp != &p_fs->FAT_cache_lru_list) {
 		if (bp->drv == p_fs->drv) {
@@ -446,8 +454,6 @@ void FAT_release_all(struct super_block *sb)
 		}
 		bp = bp->next;
 	}
-
-	sm_V(&f_sem);
 } /* end of FAT_release_all */
 
 void FAT_sync(struct super_block *sb)
@@ -455,8 +461,6 @@ void FAT_sync(struct super_block *sb)
 	BUF_CACHE_T *bp;
 	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
 
-	sm_P(&f_sem);
-
 	bp = p_fs->FAT_cache_lru_list.next;
 	while (bp != &p_fs->FAT_cache_lru_list) {
 		if ((bp->drv == p_fs->drv) && (bp->flag & DIRTYBIT)) {
@@ -465,8 +469,6 @@ void FAT_sync(struct super_block *sb)
 		}
 		bp = bp->next;
 	}
-
-	sm_V(&f_sem);
 } /* end of FAT_sync */
 
 static BUF_CACHE_T *FAT_cache_find(struct super_block *sb, u32 sec)
@@ -531,15 +533,7 @@ static void FAT_cache_remove_hash(BUF_CACHE_T *bp)
 
 u8 *buf_getblk(struct super_block *sb, u32 sec)
 {
-	u8 *buf;
-
-	sm_P(&b_sem);
-
-	buf = __buf_getblk(sb, sec);
-
-	sm_V(&b_sem);
-
-	return buf;
+	return __buf_getblk(sb, sec);
 } /* end of buf_getblk */
 
 static u8 *__buf_getblk(struct super_block *sb, u32 sec)
@@ -547,6 +541,10 @@ static u8 *__buf_getblk(struct super_block *sb, u32 sec)
 	BUF_CACHE_T *bp;
 	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
 
+	bp = p_fs->buf_cache_lru_list.next;
+	if ((bp->sec == sec) && (bp->drv == p_fs->drv) && bp->buf_bh)
+		return bp->buf_bh->b_data;
+
 	bp = buf_cache_find(sb, sec);
 	if (bp != NULL) {
 		move_to_mru(bp, &p_fs->buf_cache_lru_list);
@@ -582,45 +580,33 @@ void buf_modify(struct super_block *sb, u32 sec)
 {
 	BUF_CACHE_T *bp;
 
-	sm_P(&b_sem);
-
 	bp = buf_cache_find(sb, sec);
 	if (likely(bp != NULL))
 		sector_write(sb, sec, bp->buf_bh, 0);
 
 	WARN(!bp, "[EXFAT] failed to find buffer_cache(sector:%u).\n", sec);
-
-	sm_V(&b_sem);
 } /* end of buf_modify */
 
 void buf_lock(struct super_block *sb, u32 sec)
 {
 	BUF_CACHE_T *bp;
 
-	sm_P(&b_sem);
-
 	bp = buf_cache_find(sb, sec);
 	if (likely(bp != NULL))
 		bp->flag |= LOCKBIT;
 
 	WARN(!bp, "[EXFAT] failed to find buffer_cache(sector:%u).\n", sec);
-
-	sm_V(&b_sem);
 } /* end of buf_lock */
 
 void buf_unlock(struct super_block *sb, u32 sec)
 {
 	BUF_CACHE_T *bp;
 
-	sm_P(&b_sem);
-
 	bp = buf_cache_find(sb, sec);
 	if (likely(bp != NULL))
 		bp->flag &= ~(LOCKBIT);
 
 	WARN(!bp, "[EXFAT] failed to find buffer_cache(sector:%u).\n", sec);
-
-	sm_V(&b_sem);
 } /* end of buf_unlock */
 
 void buf_release(struct super_block *sb, u32 sec)
@@ -628,8 +614,6 @@ void buf_release(struct super_block *sb, u32 sec)
 	BUF_CACHE_T *bp;
 	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
 
-	sm_P(&b_sem);
-
 	bp = buf_cache_find(sb, sec);
 	if (likely(bp != NULL)) {
 		bp->drv = -1;
@@ -643,8 +627,6 @@ void buf_release(struct super_block *sb, u32 sec)
 
 		move_to_lru(bp, &p_fs->buf_cache_lru_list);
 	}
-
-	sm_V(&b_sem);
 } /* end of buf_release */
 
 void buf_release_all(struct super_block *sb)
@@ -652,8 +634,6 @@ void buf_release_all(struct super_block *sb)
 	BUF_CACHE_T *bp;
 	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
 
-	sm_P(&b_sem);
-
 	bp = p_fs->buf_cache_lru_list.next;
 	while (bp != &p_fs->buf_cache_lru_list) {
 		if (bp->drv == p_fs->drv) {
@@ -668,8 +648,6 @@ void buf_release_all(struct super_block *sb)
 		}
 		bp = bp->next;
 	}
-
-	sm_V(&b_sem);
 } /* end of buf_release_all */
 
 void buf_sync(struct super_block *sb)
@@ -677,8 +655,6 @@ void buf_sync(struct super_block *sb)
 	BUF_CACHE_T *bp;
 	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
 
-	sm_P(&b_sem);
-
 	bp = p_fs->buf_cache_lru_list.next;
 	while (bp != &p_fs->buf_cache_lru_list) {
 		if ((bp->drv == p_fs->drv) && (bp->flag & DIRTYBIT)) {
@@ -687,8 +663,6 @@ void buf_sync(struct super_block *sb)
 		}
 		bp = bp->next;
 	}
-
-	sm_V(&b_sem);
 } /* end of buf_sync */
 
 static BUF_CACHE_T *buf_cache_find(struct super_block *sb, u32 sec)
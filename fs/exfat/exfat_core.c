@@ -44,6 +44,7 @@
 #include <linux/version.h>
 #include <linux/param.h>
 #include <linux/log2.h>
+#include <linux/bitops.h>
 
 #include "exfat_bitmap.h"
 #include "exfat_config.h"
@@ -89,22 +90,6 @@ static char *reserved_names[] = {
 	NULL
 };
 
-static u8 free_bit[] = {
-	0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, /*   0 ~  19 */
-	0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 5, 0, 1, 0, 2, 0, 1, 0, 3, /*  20 ~  39 */
-	0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, /*  40 ~  59 */
-	0, 1, 0, 6, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, /*  60 ~  79 */
-	0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 5, 0, 1, 0, 2, /*  80 ~  99 */
-	0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, /* 100 ~ 119 */
-	0, 1, 0, 2, 0, 1, 0, 7, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, /* 120 ~ 139 */
-	0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 5, /* 140 ~ 159 */
-	0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, /* 160 ~ 179 */
-	0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 6, 0, 1, 0, 2, 0, 1, 0, 3, /* 180 ~ 199 */
-	0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, /* 200 ~ 219 */
-	0, 1, 0, 5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, /* 220 ~ 239 */
-	0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0                 /* 240 ~ 254 */
-};
-
 static u8 used_bit[] = {
 	0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 1, 2, 2, 3, /*   0 ~  19 */
 	2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, 1, 2, 2, 3, 2, 3, 3, 4, /*  20 ~  39 */
@@ -351,6 +336,7 @@ s32 ffsLookupFile(struct inode *inode, char *path, FILE_ID_T *fid)
 		fid->type = TYPE_DIR;
 		fid->rwoffset = 0;
 		fid->hint_last_off = -1;
+		fid->num_extents = 0;
 
 		fid->attr = ATTR_SUBDIR;
 		fid->flags = 0x01;
@@ -372,6 +358,7 @@ s32 ffsLookupFile(struct inode *inode, char *path, FILE_ID_T *fid)
 		fid->type = p_fs->fs_func->get_entry_type(ep);
 		fid->rwoffset = 0;
 		fid->hint_last_off = -1;
+		fid->num_extents = 0;
 		fid->attr = p_fs->fs_func->get_entry_attr(ep);
 
 		fid->size = p_fs->fs_func->get_entry_size(ep2);
@@ -824,6 +811,7 @@ s32 ffsTruncateFile(struct inode *inode, u64 old_size, u64 new_size)
 
 	/* hint information */
 	fid->hint_last_off = -1;
+	fid->num_extents = 0;
 	if (fid->rwoffset > fid->size)
 		fid->rwoffset = fid->size;
 
@@ -1282,10 +1270,70 @@ s32 ffsSetStat(struct inode *inode, DIR_ENTRY_T *info)
 	return FFS_SUCCESS;
 } /* end of ffsSetStat */
 
+/* find the cached run that gets closest to cluster off of the file, and
+ * move *pos and *clu there if it is beyond *pos
+ */
+static void extent_cache_lookup(FILE_ID_T *fid, s32 off, s32 *pos, u32 *clu)
+{
+	int i;
+	s32 last;
+	CLU_EXTENT_T *ext;
+
+	for (i = 0; i < fid->num_extents; i++) {
+		ext = &(fid->extent[i]);
+		if (ext->off > off)
+			continue;
+
+		if (off < ext->off + (s32) ext->len) {
+			*pos = off;
+			*clu = ext->clu + (off - ext->off);
+			return;
+		}
+
+		last = ext->off + (s32) ext->len - 1;
+		if (last > *pos) {
+			*pos = last;
+			*clu = ext->clu + ext->len - 1;
+		}
+	}
+} /* end of extent_cache_lookup */
+
+static void extent_cache_add(FILE_ID_T *fid, s32 off, u32 clu, u32 len)
+{
+	int i;
+	s32 end;
+	CLU_EXTENT_T *ext;
+
+	if (len < 2)
+		return;
+
+	for (i = 0; i < fid->num_extents; i++) {
+		ext = &(fid->extent[i]);
+		if ((ext->off > off) || (off > ext->off + (s32) ext->len) ||
+		    (ext->clu + (off - ext->off) != clu))
+			continue;
+
+		/* same run seen again, maybe grown by appends */
+		end = max(ext->off + (s32) ext->len, off + (s32) len);
+		ext->len = end - ext->off;
+		return;
+	}
+
+	if (fid->num_extents < MAX_CLU_EXTENTS)
+		ext = &(fid->extent[fid->num_extents++]);
+	else
+		ext = &(fid->extent[fid->next_extent++ % MAX_CLU_EXTENTS]);
+
+	ext->off = off;
+	ext->clu = clu;
+	ext->len = len;
+} /* end of extent_cache_add */
+
 s32 ffsMapCluster(struct inode *inode, s32 clu_offset, u32 *clu)
 {
 	s32 num_clusters, num_alloced, modified = FALSE;
-	u32 last_clu, sector = 0;
+	s32 pos, run_off;
+	u32 last_clu, run_clu, run_len, sector = 0;
 	CHAIN_T new_clu;
 	DENTRY_T *ep;
 	ENTRY_SET_CACHE_T *es = NULL;
@@ -1312,19 +1360,40 @@ s32 ffsMapCluster(struct inode *inode, s32 clu_offset, u32 *clu)
 				*clu += clu_offset;
 		}
 	} else {
+		pos = 0;
+
 		/* hint information */
 		if ((clu_offset > 0) && (fid->hint_last_off > 0) &&
 			(clu_offset >= fid->hint_last_off)) {
-			clu_offset -= fid->hint_last_off;
+			pos = fid->hint_last_off;
 			*clu = fid->hint_last_clu;
 		}
 
+		if ((clu_offset > 0) && (*clu != CLUSTER_32(~0)))
+			extent_cache_lookup(fid, clu_offset, &pos, clu);
+
+		clu_offset -= pos;
+		run_off = pos;
+		run_clu = *clu;
+		run_len = 1;
+
 		while ((clu_offset > 0) && (*clu != CLUSTER_32(~0))) {
 			last_clu = *clu;
 			if (FAT_read(sb, *clu, clu) == -1)
 				return FFS_MEDIAERR;
 			clu_offset--;
+
+			if (*clu == last_clu + 1) {
+				run_len++;
+				continue;
+			}
+			extent_cache_add(fid, run_off, run_clu, run_len);
+			run_off += run_len;
+			run_clu = *clu;
+			run_len = 1;
 		}
+		if (run_clu != CLUSTER_32(~0))
+			extent_cache_add(fid, run_off, run_clu, run_len);
 	}
 
 	if (*clu == CLUSTER_32(~0)) {
@@ -1892,26 +1961,21 @@ s32 exfat_alloc_cluster(struct super_block *sb, s32 num_alloc, CHAIN_T *p_chain)
 		}
 		last_clu = new_clu;
 
-		if ((--num_alloc) == 0) {
-			p_fs->clu_srch_ptr = hint_clu;
-			if (p_fs->used_clusters != (u32) ~0)
-				p_fs->used_clusters += num_clusters;
-
-			p_chain->size += num_clusters;
-			return num_clusters;
-		}
-
 		hint_clu = new_clu + 1;
 		if (hint_clu >= p_fs->num_clusters) {
 			hint_clu = 2;
 
-			if (p_chain->flags == 0x03) {
+			if ((num_alloc > 1) && (p_chain->flags == 0x03)) {
 				exfat_chain_cont_cluster(sb, p_chain->dir, num_clusters);
 				p_chain->flags = 0x01;
 			}
 		}
+
+		if ((--num_alloc) == 0)
+			break;
 	}
 
+	/* the next search starts right after the last allocation */
 	p_fs->clu_srch_ptr = hint_clu;
 	if (p_fs->used_clusters != (u32) ~0)
 		p_fs->used_clusters += num_clusters;
@@ -2258,40 +2322,35 @@ s32 clr_alloc_bitmap(struct super_block *sb, u32 clu)
 #endif /* CONFIG_EXFAT_DISCARD */
 } /* end of clr_alloc_bitmap */
 
+/* returns the first free cluster at or after bitmap index clu, wrapping
+ * around once, or CLUSTER_32(~0) when the volume is full
+ */
 u32 test_alloc_bitmap(struct super_block *sb, u32 clu)
 {
-	int i, map_i, map_b;
-	u32 clu_base, clu_free;
-	u8 k, clu_mask;
+	int i, map_i;
+	u32 bits, limit, off, total, free;
 	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
 	BD_INFO_T *p_bd = &(EXFAT_SB(sb)->bd_info);
 
-	clu_base = (clu & ~(0x7)) + 2;
-	clu_mask = (1 << (clu - clu_base + 2)) - 1;
+	bits = p_bd->sector_size << 3;
+	total = p_fs->num_clusters - 2;
+	if (clu >= total)
+		clu = 0;
 
 	map_i = clu >> (p_bd->sector_size_bits + 3);
-	map_b = (clu >> 3) & p_bd->sector_size_mask;
+	off = clu & (bits - 1);
 
-	for (i = 2; i < p_fs->num_clusters; i += 8) {
-		k = *(((u8 *) p_fs->vol_amap[map_i]->b_data) + map_b);
-		if (clu_mask > 0) {
-			k |= clu_mask;
-			clu_mask = 0;
-		}
-		if (k < 0xFF) {
-			clu_free = clu_base + free_bit[k];
-			if (clu_free < p_fs->num_clusters)
-				return clu_free;
-		}
-		clu_base += 8;
+	/* one extra pass rescans the part of the first sector before clu */
+	for (i = 0; i <= p_fs->map_sectors; i++) {
+		limit = min(bits, total - (u32) map_i * bits);
+		free = find_next_zero_bit_le(p_fs->vol_amap[map_i]->b_data,
+					     limit, off);
+		if (free < limit)
+			return (u32) map_i * bits + free + 2;
 
-		if (((++map_b) >= p_bd->sector_size) || (clu_base >= p_fs->num_clusters)) {
-			if ((++map_i) >= p_fs->map_sectors) {
-				clu_base = 2;
-				map_i = 0;
-			}
-			map_b = 0;
-		}
+		off = 0;
+		if ((++map_i) >= p_fs->map_sectors)
+			map_i = 0;
 	}
 
 	return CLUSTER_32(~0);
@@ -4755,6 +4814,7 @@ s32 create_dir(struct inode *inode, CHAIN_T *p_dir, UNI_NAME_T *p_uniname, FILE_
 	fid->type = TYPE_DIR;
 	fid->rwoffset = 0;
 	fid->hint_last_off = -1;
+	fid->num_extents = 0;
 
 	return FFS_SUCCESS;
 } /* end of create_dir */
@@ -4799,6 +4859,7 @@ s32 create_file(struct inode *inode, CHAIN_T *p_dir, UNI_NAME_T *p_uniname, u8 m
 	fid->type = TYPE_FILE;
 	fid->rwoffset = 0;
 	fid->hint_last_off = -1;
+	fid->num_extents = 0;
 
 	return FFS_SUCCESS;
 } /* end of create_file */
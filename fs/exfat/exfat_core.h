@@ -489,6 +489,8 @@ typedef struct __FS_INFO_T {
 	BUF_CACHE_T FAT_cache_array[FAT_CACHE_SIZE];
 	BUF_CACHE_T FAT_cache_lru_list;
 	BUF_CACHE_T FAT_cache_hash_list[FAT_CACHE_HASH_SIZE];
+	u32      FAT_ra_start;           /* FAT readahead window */
+	u32      FAT_ra_end;
 
 	/* buf cache */
 	BUF_CACHE_T buf_cache_array[BUF_CACHE_SIZE];
@@ -56,14 +56,4 @@
 /*  Buffer Manager                                                      */
 /*----------------------------------------------------------------------*/
 
-/* FAT cache */
-DEFINE_SEMAPHORE(f_sem);
-BUF_CACHE_T FAT_cache_array[FAT_CACHE_SIZE];
-BUF_CACHE_T FAT_cache_lru_list;
-BUF_CACHE_T FAT_cache_hash_list[FAT_CACHE_HASH_SIZE];
-
-/* buf cache */
-DEFINE_SEMAPHORE(b_sem);
-BUF_CACHE_T buf_cache_array[BUF_CACHE_SIZE];
-BUF_CACHE_T buf_cache_lru_list;
-BUF_CACHE_T buf_cache_hash_list[BUF_CACHE_HASH_SIZE];
+/* the FAT and buf caches live in FS_INFO_T, serialised by its v_sem */
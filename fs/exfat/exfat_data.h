@@ -51,8 +51,11 @@
 /* cache size (in number of sectors)                */
 /* (should be an exponential value of 2)            */
 #define FAT_CACHE_SIZE          128
-#define FAT_CACHE_HASH_SIZE     64
+#define FAT_CACHE_HASH_SIZE     128
 #define BUF_CACHE_SIZE          256
-#define BUF_CACHE_HASH_SIZE     64
+#define BUF_CACHE_HASH_SIZE     256
+
+/* FAT sectors read ahead on a FAT cache miss       */
+#define FAT_RA_SECTORS          32
 
 #endif /* _EXFAT_DATA_H */
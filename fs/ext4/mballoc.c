@@ -158,6 +158,15 @@
  * can be used for allocation. ext4_mb_good_group explains how the groups are
  * checked.
  *
+ * Initialized groups are also kept on per order lists by the order of their
+ * largest free extent. A power of 2 request that is not a stream request
+ * first tries the group those lists give for the smallest order that fits,
+ * so small files stop walking every group from the goal, and only falls back
+ * to the scan above if that group did not work out. This can be switched off
+ * via /sys/fs/ext4/<partition>/mb_optimize_scan. With mb_stats set, the
+ * allocator counters, including the groups considered and scanned, can be
+ * read from /proc/fs/ext4/<partition>/mb_stats.
+ *
  * Both the prealloc space are getting populated as above. So for the first
  * request we will hit the buddy cache which will result in this prealloc
  * space getting filled. The prealloc space is then later used for the
@@ -684,22 +693,39 @@ static void ext4_mb_mark_free_simple(struct super_block *sb,
 
 /*
  * Cache the order of the largest free extent we have available in this block
- * group.
+ * group, and keep the group on the sbi list for that order so that cr 0
+ * requests can go straight to a group that fits. Called with the group
+ * locked; groups without free space are on no list.
  */
 static void
 mb_set_largest_free_order(struct super_block *sb, struct ext4_group_info *grp)
 {
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
 	int i;
 	int bits;
 
-	grp->bb_largest_free_order = -1; /* uninit */
-
 	bits = sb->s_blocksize_bits + 1;
 	for (i = bits; i >= 0; i--) {
-		if (grp->bb_counters[i] > 0) {
-			grp->bb_largest_free_order = i;
+		if (grp->bb_counters[i] > 0)
 			break;
-		}
+	}
+
+	if (i == grp->bb_largest_free_order)
+		return;
+
+	if (grp->bb_largest_free_order >= 0) {
+		write_lock(&sbi->s_mb_largest_free_orders_locks[
+					grp->bb_largest_free_order]);
+		list_del_init(&grp->bb_largest_free_order_node);
+		write_unlock(&sbi->s_mb_largest_free_orders_locks[
+					grp->bb_largest_free_order]);
+	}
+	grp->bb_largest_free_order = i;
+	if (i >= 0) {
+		write_lock(&sbi->s_mb_largest_free_orders_locks[i]);
+		list_add_tail(&grp->bb_largest_free_order_node,
+			      &sbi->s_mb_largest_free_orders[i]);
+		write_unlock(&sbi->s_mb_largest_free_orders_locks[i]);
 	}
 }
 
@@ -1912,6 +1938,94 @@ static int ext4_mb_good_group(struct ext4_allocation_context *ac,
 	return 0;
 }
 
+/*
+ * Pick a group for a cr 0 request from the largest free order lists,
+ * starting with the smallest order that still fits so big free extents
+ * are left for big requests. This only does the checks of
+ * ext4_mb_good_group() that need no initialization, the caller checks
+ * again under the group lock. Returns ngroups if nothing fits.
+ */
+static ext4_group_t
+ext4_mb_find_group_by_order(struct ext4_allocation_context *ac,
+			    ext4_group_t ngroups)
+{
+	struct super_block *sb = ac->ac_sb;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	int flex_size = ext4_flex_bg_size(sbi);
+	struct ext4_group_info *grp;
+	ext4_group_t group = ngroups;
+	int i;
+
+	for (i = ac->ac_2order; i <= sb->s_blocksize_bits + 1; i++) {
+		if (list_empty(&sbi->s_mb_largest_free_orders[i]))
+			continue;
+
+		read_lock(&sbi->s_mb_largest_free_orders_locks[i]);
+		list_for_each_entry(grp, &sbi->s_mb_largest_free_orders[i],
+				    bb_largest_free_order_node) {
+			ac->ac_groups_considered++;
+			if (grp->bb_group >= ngroups ||
+			    EXT4_MB_GRP_NEED_INIT(grp) || grp->bb_free == 0)
+				continue;
+			/* Avoid using the first bg of a flexgroup for data files */
+			if ((ac->ac_flags & EXT4_MB_HINT_DATA) &&
+			    (flex_size >= EXT4_FLEX_SIZE_DIR_ALLOC_SCHEME) &&
+			    ((grp->bb_group % flex_size) == 0))
+				continue;
+			group = grp->bb_group;
+			break;
+		}
+		read_unlock(&sbi->s_mb_largest_free_orders_locks[i]);
+
+		if (group < ngroups)
+			break;
+	}
+
+	return group;
+}
+
+/*
+ * Load the buddy of a group that passed ext4_mb_good_group(), check it
+ * again under the group lock and scan it the way cr asks for.
+ */
+static int ext4_mb_scan_group(struct ext4_allocation_context *ac,
+			      struct ext4_buddy *e4b, ext4_group_t group, int cr)
+{
+	struct super_block *sb = ac->ac_sb;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	int err;
+
+	err = ext4_mb_load_buddy(sb, group, e4b);
+	if (err)
+		return err;
+
+	ext4_lock_group(sb, group);
+
+	/*
+	 * We need to check again after locking the
+	 * block group
+	 */
+	if (!ext4_mb_good_group(ac, group, cr)) {
+		ext4_unlock_group(sb, group);
+		ext4_mb_unload_buddy(e4b);
+		return 0;
+	}
+
+	ac->ac_groups_scanned++;
+	if (cr == 0)
+		ext4_mb_simple_scan_group(ac, e4b);
+	else if (cr == 1 && sbi->s_stripe &&
+			!(ac->ac_g_ex.fe_len % sbi->s_stripe))
+		ext4_mb_scan_aligned(ac, e4b);
+	else
+		ext4_mb_complex_scan_group(ac, e4b);
+
+	ext4_unlock_group(sb, group);
+	ext4_mb_unload_buddy(e4b);
+
+	return 0;
+}
+
 static noinline_for_stack int
 ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 {
@@ -1970,6 +2084,29 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 
 	/* Let's just scan groups to find more-less suitable blocks */
 	cr = ac->ac_2order ? 0 : 1;
+
+	/*
+	 * A 2^N request can be served by any group whose largest free
+	 * extent is at least 2^N, try the one the order lists give us
+	 * before walking the groups from the goal.
+	 */
+	if (cr == 0 && sbi->s_mb_optimize_scan &&
+	    !(ac->ac_flags & EXT4_MB_STREAM_ALLOC)) {
+		ac->ac_criteria = 0;
+		group = ext4_mb_find_group_by_order(ac, ngroups);
+		if (group < ngroups) {
+			err = ext4_mb_scan_group(ac, &e4b, group, 0);
+			if (err)
+				goto out;
+			if (sbi->s_mb_stats) {
+				if (ac->ac_status != AC_STATUS_CONTINUE)
+					atomic_inc(&sbi->s_bal_order_hits);
+				else
+					atomic_inc(&sbi->s_bal_order_misses);
+			}
+		}
+	}
+
 	/*
 	 * cr == 0 try to get exact allocation,
 	 * cr == 3  try to get anything
@@ -1992,37 +2129,14 @@ repeat:
 				group = 0;
 
 			/* This now checks without needing the buddy page */
+			ac->ac_groups_considered++;
 			if (!ext4_mb_good_group(ac, group, cr))
 				continue;
 
-			err = ext4_mb_load_buddy(sb, group, &e4b);
+			err = ext4_mb_scan_group(ac, &e4b, group, cr);
 			if (err)
 				goto out;
 
-			ext4_lock_group(sb, group);
-
-			/*
-			 * We need to check again after locking the
-			 * block group
-			 */
-			if (!ext4_mb_good_group(ac, group, cr)) {
-				ext4_unlock_group(sb, group);
-				ext4_mb_unload_buddy(&e4b);
-				continue;
-			}
-
-			ac->ac_groups_scanned++;
-			if (cr == 0)
-				ext4_mb_simple_scan_group(ac, &e4b);
-			else if (cr == 1 && sbi->s_stripe &&
-					!(ac->ac_g_ex.fe_len % sbi->s_stripe))
-				ext4_mb_scan_aligned(ac, &e4b);
-			else
-				ext4_mb_complex_scan_group(ac, &e4b);
-
-			ext4_unlock_group(sb, group);
-			ext4_mb_unload_buddy(&e4b);
-
 			if (ac->ac_status != AC_STATUS_CONTINUE)
 				break;
 		}
@@ -2156,6 +2270,61 @@ static const struct file_operations ext4_mb_seq_groups_fops = {
 	.release	= seq_release,
 };
 
+/*
+ * The buddy allocator counters as they are now, the same ones that are
+ * printed at unmount. Only counted while mb_stats is set in sysfs.
+ */
+static int ext4_mb_seq_stats_show(struct seq_file *seq, void *v)
+{
+	struct super_block *sb = seq->private;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	unsigned int reqs = atomic_read(&sbi->s_bal_reqs);
+	unsigned int scanned = atomic_read(&sbi->s_bal_groups_scanned);
+
+	seq_printf(seq, "mb_stats: %u\n", sbi->s_mb_stats);
+	seq_printf(seq, "mb_optimize_scan: %u\n", sbi->s_mb_optimize_scan);
+	seq_printf(seq, "reqs: %u\n", reqs);
+	seq_printf(seq, "success: %u\n", atomic_read(&sbi->s_bal_success));
+	seq_printf(seq, "blocks: %u\n", atomic_read(&sbi->s_bal_allocated));
+	seq_printf(seq, "extents_scanned: %u\n",
+		   atomic_read(&sbi->s_bal_ex_scanned));
+	seq_printf(seq, "goal_hits: %u\n", atomic_read(&sbi->s_bal_goals));
+	seq_printf(seq, "2^n_hits: %u\n", atomic_read(&sbi->s_bal_2orders));
+	seq_printf(seq, "breaks: %u\n", atomic_read(&sbi->s_bal_breaks));
+	seq_printf(seq, "lost: %u\n", atomic_read(&sbi->s_mb_lost_chunks));
+	seq_printf(seq, "groups_considered: %u\n",
+		   atomic_read(&sbi->s_bal_groups_considered));
+	seq_printf(seq, "groups_scanned: %u\n", scanned);
+	seq_printf(seq, "groups_scanned_per_req: %u\n",
+		   reqs ? scanned / reqs : 0);
+	seq_printf(seq, "order_list_hits: %u\n",
+		   atomic_read(&sbi->s_bal_order_hits));
+	seq_printf(seq, "order_list_misses: %u\n",
+		   atomic_read(&sbi->s_bal_order_misses));
+	seq_printf(seq, "buddies_generated: %lu\n",
+		   sbi->s_mb_buddies_generated);
+	seq_printf(seq, "buddies_time_used: %llu\n",
+		   sbi->s_mb_generation_time);
+	seq_printf(seq, "preallocated: %u\n",
+		   atomic_read(&sbi->s_mb_preallocated));
+	seq_printf(seq, "discarded: %u\n", atomic_read(&sbi->s_mb_discarded));
+
+	return 0;
+}
+
+static int ext4_mb_seq_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ext4_mb_seq_stats_show, PDE(inode)->data);
+}
+
+static const struct file_operations ext4_mb_seq_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= ext4_mb_seq_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static struct kmem_cache *get_groupinfo_cache(int blocksize_bits)
 {
 	int cache_index = blocksize_bits - EXT4_MIN_BLOCK_LOG_SIZE;
@@ -2222,6 +2391,8 @@ int ext4_mb_add_groupinfo(struct super_block *sb, ext4_group_t group,
 	init_rwsem(&meta_group_info[i]->alloc_sem);
 	meta_group_info[i]->bb_free_root = RB_ROOT;
 	meta_group_info[i]->bb_largest_free_order = -1;  /* uninit */
+	meta_group_info[i]->bb_group = group;
+	INIT_LIST_HEAD(&meta_group_info[i]->bb_largest_free_order_node);
 
 #ifdef DOUBLE_CHECK
 	{
@@ -2406,6 +2577,27 @@ int ext4_mb_init(struct super_block *sb, int needs_recovery)
 		goto out;
 	}
 
+	i = (sb->s_blocksize_bits + 2) *
+		sizeof(*sbi->s_mb_largest_free_orders);
+	sbi->s_mb_largest_free_orders = kmalloc(i, GFP_KERNEL);
+	if (sbi->s_mb_largest_free_orders == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	i = (sb->s_blocksize_bits + 2) *
+		sizeof(*sbi->s_mb_largest_free_orders_locks);
+	sbi->s_mb_largest_free_orders_locks = kmalloc(i, GFP_KERNEL);
+	if (sbi->s_mb_largest_free_orders_locks == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i <= sb->s_blocksize_bits + 1; i++) {
+		INIT_LIST_HEAD(&sbi->s_mb_largest_free_orders[i]);
+		rwlock_init(&sbi->s_mb_largest_free_orders_locks[i]);
+	}
+
 	ret = ext4_groupinfo_create_slab(sb->s_blocksize);
 	if (ret < 0)
 		goto out;
@@ -2433,6 +2625,7 @@ int ext4_mb_init(struct super_block *sb, int needs_recovery)
 	sbi->s_mb_stats = MB_DEFAULT_STATS;
 	sbi->s_mb_stream_request = MB_DEFAULT_STREAM_THRESHOLD;
 	sbi->s_mb_order2_reqs = MB_DEFAULT_ORDER2_REQS;
+	sbi->s_mb_optimize_scan = MB_DEFAULT_OPTIMIZE_SCAN;
 	/*
 	 * The default group preallocation is 512, which for 4k block
 	 * sizes translates to 2 megabytes.  However for bigalloc file
@@ -2479,9 +2672,12 @@ int ext4_mb_init(struct super_block *sb, int needs_recovery)
 	if (ret != 0)
 		goto out_free_locality_groups;
 
-	if (sbi->s_proc)
+	if (sbi->s_proc) {
 		proc_create_data("mb_groups", S_IRUGO, sbi->s_proc,
 				 &ext4_mb_seq_groups_fops, sb);
+		proc_create_data("mb_stats", S_IRUGO, sbi->s_proc,
+				 &ext4_mb_seq_stats_fops, sb);
+	}
 
 	return 0;
 
@@ -2491,6 +2687,10 @@ out_free_locality_groups:
 out_free_groupinfo_slab:
 	ext4_groupinfo_destroy_slabs();
 out:
+	kfree(sbi->s_mb_largest_free_orders);
+	sbi->s_mb_largest_free_orders = NULL;
+	kfree(sbi->s_mb_largest_free_orders_locks);
+	sbi->s_mb_largest_free_orders_locks = NULL;
 	kfree(sbi->s_mb_offsets);
 	sbi->s_mb_offsets = NULL;
 	kfree(sbi->s_mb_maxs);
@@ -2525,8 +2725,10 @@ int ext4_mb_release(struct super_block *sb)
 	struct ext4_sb_info *sbi = EXT4_SB(sb);
 	struct kmem_cache *cachep = get_groupinfo_cache(sb->s_blocksize_bits);
 
-	if (sbi->s_proc)
+	if (sbi->s_proc) {
+		remove_proc_entry("mb_stats", sbi->s_proc);
 		remove_proc_entry("mb_groups", sbi->s_proc);
+	}
 
 	if (sbi->s_group_info) {
 		for (i = 0; i < ngroups; i++) {
@@ -2546,6 +2748,8 @@ int ext4_mb_release(struct super_block *sb)
 			kfree(sbi->s_group_info[i]);
 		ext4_kvfree(sbi->s_group_info);
 	}
+	kfree(sbi->s_mb_largest_free_orders);
+	kfree(sbi->s_mb_largest_free_orders_locks);
 	kfree(sbi->s_mb_offsets);
 	kfree(sbi->s_mb_maxs);
 	if (sbi->s_buddy_cache)
@@ -3064,6 +3268,9 @@ static void ext4_mb_collect_stats(struct ext4_allocation_context *ac)
 			atomic_inc(&sbi->s_bal_goals);
 		if (ac->ac_found > sbi->s_mb_max_to_scan)
 			atomic_inc(&sbi->s_bal_breaks);
+		atomic_add(ac->ac_groups_scanned, &sbi->s_bal_groups_scanned);
+		atomic_add(ac->ac_groups_considered,
+			   &sbi->s_bal_groups_considered);
 	}
 
 	if (ac->ac_op == EXT4_MB_HISTORY_ALLOC)
@@ -94,6 +94,12 @@ extern u8 mb_enable_debug;
  */
 #define MB_DEFAULT_GROUP_PREALLOC	512
 
+/*
+ * whether 2^N requests pick their group from the largest free order
+ * lists before falling back to the linear scan from the goal
+ */
+#define MB_DEFAULT_OPTIMIZE_SCAN	1
+
 
 struct ext4_free_data {
 	/* MUST be the first member */
@@ -183,6 +189,7 @@ struct ext4_allocation_context {
 	/* number of iterations done. we have to track to limit searching */
 	unsigned long ac_ex_scanned;
 	__u16 ac_groups_scanned;
+	__u16 ac_groups_considered;
 	__u16 ac_found;
 	__u16 ac_tail;
 	__u16 ac_buddy;
@@ -273,47 +273,292 @@ int f2fs_reserve_block(struct dnode_of_data *dn, pgoff_t index)
 	return err;
 }
 
-static int check_extent_cache(struct inode *inode, pgoff_t pgofs,
-					struct buffer_head *bh_result)
+static struct kmem_cache *extent_node_slab;
+
+static struct extent_node *__lookup_extent_node(struct f2fs_inode_info *fi,
+							pgoff_t fofs)
+{
+	struct rb_node *node = fi->ext_tree.rb_node;
+	struct extent_node *en;
+
+	while (node) {
+		en = rb_entry(node, struct extent_node, rb_node);
+		if (fofs < en->fofs)
+			node = node->rb_left;
+		else if (fofs >= en->fofs + en->len)
+			node = node->rb_right;
+		else
+			return en;
+	}
+	return NULL;
+}
+
+/* the first extent starting after fofs */
+static struct extent_node *__next_extent_node(struct f2fs_inode_info *fi,
+							pgoff_t fofs)
+{
+	struct rb_node *node = fi->ext_tree.rb_node;
+	struct extent_node *en, *next = NULL;
+
+	while (node) {
+		en = rb_entry(node, struct extent_node, rb_node);
+		if (fofs < en->fofs) {
+			next = en;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+	return next;
+}
+
+static struct extent_node *__attach_extent_node(struct f2fs_sb_info *sbi,
+		struct f2fs_inode_info *fi, unsigned int fofs,
+		u32 blk_addr, unsigned int len)
+{
+	struct rb_node **p = &fi->ext_tree.rb_node;
+	struct rb_node *parent = NULL;
+	struct extent_node *en;
+
+	/* we are under ext_lock, and the cache can be rebuilt from dnodes */
+	en = kmem_cache_alloc(extent_node_slab, GFP_ATOMIC);
+	if (!en)
+		return NULL;
+
+	en->fi = fi;
+	en->fofs = fofs;
+	en->blk_addr = blk_addr;
+	en->len = len;
+
+	while (*p) {
+		parent = *p;
+		if (fofs < rb_entry(parent, struct extent_node, rb_node)->fofs)
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+	rb_link_node(&en->rb_node, parent, p);
+	rb_insert_color(&en->rb_node, &fi->ext_tree);
+
+	spin_lock(&sbi->extent_lock);
+	list_add_tail(&en->list, &sbi->extent_list);
+	spin_unlock(&sbi->extent_lock);
+	atomic_inc(&sbi->total_ext_node);
+	return en;
+}
+
+static void __detach_extent_node(struct f2fs_sb_info *sbi,
+		struct f2fs_inode_info *fi, struct extent_node *en)
 {
+	rb_erase(&en->rb_node, &fi->ext_tree);
+
+	spin_lock(&sbi->extent_lock);
+	list_del(&en->list);
+	spin_unlock(&sbi->extent_lock);
+	atomic_dec(&sbi->total_ext_node);
+	kmem_cache_free(extent_node_slab, en);
+}
+
+/*
+ * Look up pgofs in the largest extent first, and in the extent tree after.
+ * On a hit, blkaddr gets its block address and count the number of blocks
+ * that follow it contiguously, pgofs included.
+ */
+static bool lookup_extent_cache(struct inode *inode, pgoff_t pgofs,
+				block_t *blkaddr, unsigned int *count)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
 	struct f2fs_inode_info *fi = F2FS_I(inode);
-	pgoff_t start_fofs, end_fofs;
-	block_t start_blkaddr;
+	struct extent_node *en;
+	bool hit = false;
 
-	if (is_inode_flag_set(fi, FI_NO_EXTENT))
-		return 0;
+	stat_inc_total_hit(inode->i_sb);
 
 	read_lock(&fi->ext.ext_lock);
-	if (fi->ext.len == 0) {
-		read_unlock(&fi->ext.ext_lock);
-		return 0;
+	if (!is_inode_flag_set(fi, FI_NO_EXTENT) && fi->ext.len &&
+			pgofs >= fi->ext.fofs &&
+			pgofs < fi->ext.fofs + fi->ext.len) {
+		*blkaddr = fi->ext.blk_addr + pgofs - fi->ext.fofs;
+		*count = fi->ext.fofs + fi->ext.len - pgofs;
+		hit = true;
+		goto out;
 	}
 
-	stat_inc_total_hit(inode->i_sb);
+	en = __lookup_extent_node(fi, pgofs);
+	if (en) {
+		*blkaddr = en->blk_addr + pgofs - en->fofs;
+		*count = en->fofs + en->len - pgofs;
+		hit = true;
 
-	start_fofs = fi->ext.fofs;
-	end_fofs = fi->ext.fofs + fi->ext.len - 1;
-	start_blkaddr = fi->ext.blk_addr;
+		spin_lock(&sbi->extent_lock);
+		list_move_tail(&en->list, &sbi->extent_list);
+		spin_unlock(&sbi->extent_lock);
+	}
+out:
+	read_unlock(&fi->ext.ext_lock);
+	if (hit)
+		stat_inc_read_hit(inode->i_sb);
+	return hit;
+}
+
+/*
+ * Cache the run of contiguous blocks starting at dn->ofs_in_node, which
+ * maps fofs. The caller holds the dnode page locked, so none of its block
+ * addresses can change, and update_extent_cache() can not race with us.
+ */
+static void cache_dnode_extent(struct dnode_of_data *dn, pgoff_t fofs)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(dn->inode->i_sb);
+	struct f2fs_inode_info *fi = F2FS_I(dn->inode);
+	struct extent_node *en;
+	block_t blkaddr = dn->data_blkaddr;
+	unsigned int end_offset, ofs, len = 1;
 
-	if (pgofs >= start_fofs && pgofs <= end_fofs) {
-		unsigned int blkbits = inode->i_sb->s_blocksize_bits;
-		size_t count;
+	if (blkaddr == NULL_ADDR || blkaddr == NEW_ADDR)
+		return;
 
-		clear_buffer_new(bh_result);
-		map_bh(bh_result, inode->i_sb,
-				start_blkaddr + pgofs - start_fofs);
-		count = end_fofs - pgofs + 1;
-		if (count < (UINT_MAX >> blkbits))
-			bh_result->b_size = (count << blkbits);
-		else
-			bh_result->b_size = UINT_MAX;
+	end_offset = IS_INODE(dn->node_page) ?
+			ADDRS_PER_INODE(fi) : ADDRS_PER_BLOCK;
+	for (ofs = dn->ofs_in_node + 1; ofs < end_offset; ofs++, len++)
+		if (datablock_addr(dn->node_page, ofs) != blkaddr + len)
+			break;
 
-		stat_inc_read_hit(inode->i_sb);
-		read_unlock(&fi->ext.ext_lock);
-		return 1;
+	write_lock(&fi->ext.ext_lock);
+	if (__lookup_extent_node(fi, fofs))
+		goto out;
+
+	en = __next_extent_node(fi, fofs);
+	if (en && en->fofs < fofs + len)
+		len = en->fofs - fofs;
+
+	en = fofs ? __lookup_extent_node(fi, fofs - 1) : NULL;
+	if (en && en->blk_addr + en->len == blkaddr)
+		en->len += len;
+	else
+		__attach_extent_node(sbi, fi, fofs, blkaddr, len);
+out:
+	write_unlock(&fi->ext.ext_lock);
+}
+
+/*
+ * The block address of fofs changed to blk_addr. Split the extent that
+ * covers fofs around it, and merge a valid blk_addr into its neighbours or
+ * add it as a new extent.
+ */
+static void update_extent_tree(struct inode *inode, pgoff_t fofs,
+							block_t blk_addr)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+	struct extent_node *en, *prev, *next;
+	unsigned int end_fofs;
+
+	write_lock(&fi->ext.ext_lock);
+	en = __lookup_extent_node(fi, fofs);
+	if (en) {
+		end_fofs = en->fofs + en->len - 1;
+		if (fofs == en->fofs && fofs == end_fofs) {
+			__detach_extent_node(sbi, fi, en);
+		} else if (fofs == en->fofs) {
+			en->fofs++;
+			en->blk_addr++;
+			en->len--;
+		} else {
+			/* the tail is only a cache, so it is fine to lose it */
+			if (fofs < end_fofs)
+				__attach_extent_node(sbi, fi, fofs + 1,
+					en->blk_addr + fofs + 1 - en->fofs,
+					end_fofs - fofs);
+			en->len = fofs - en->fofs;
+		}
 	}
-	read_unlock(&fi->ext.ext_lock);
-	return 0;
+
+	if (blk_addr == NULL_ADDR)
+		goto out;
+
+	prev = fofs ? __lookup_extent_node(fi, fofs - 1) : NULL;
+	next = __lookup_extent_node(fi, fofs + 1);
+	if (prev && prev->blk_addr + prev->len == blk_addr) {
+		prev->len++;
+		if (next && next->blk_addr == blk_addr + 1) {
+			prev->len += next->len;
+			__detach_extent_node(sbi, fi, next);
+		}
+	} else if (next && next->blk_addr == blk_addr + 1) {
+		next->fofs--;
+		next->blk_addr--;
+		next->len++;
+	} else {
+		__attach_extent_node(sbi, fi, fofs, blk_addr, 1);
+	}
+out:
+	write_unlock(&fi->ext.ext_lock);
+}
+
+void f2fs_drop_extent_tree(struct inode *inode)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+	struct rb_node *node;
+
+	write_lock(&fi->ext.ext_lock);
+	while ((node = rb_first(&fi->ext_tree)))
+		__detach_extent_node(sbi, fi,
+				rb_entry(node, struct extent_node, rb_node));
+	write_unlock(&fi->ext.ext_lock);
+}
+
+/*
+ * Free the least recently used extent nodes. The lru lock nests inside
+ * ext_lock everywhere else, so we can only trylock the owners from here and
+ * skip the inodes that are busy.
+ */
+int f2fs_shrink_extent_cache(struct shrinker *shrink,
+				struct shrink_control *sc)
+{
+	struct f2fs_sb_info *sbi = container_of(shrink, struct f2fs_sb_info,
+							extent_shrinker);
+	struct extent_node *en, *tmp;
+	int nr_to_scan = sc->nr_to_scan;
+
+	if (nr_to_scan) {
+		spin_lock(&sbi->extent_lock);
+		list_for_each_entry_safe(en, tmp, &sbi->extent_list, list) {
+			struct f2fs_inode_info *fi = en->fi;
+
+			if (!nr_to_scan--)
+				break;
+			if (!write_trylock(&fi->ext.ext_lock))
+				continue;
+			rb_erase(&en->rb_node, &fi->ext_tree);
+			list_del(&en->list);
+			write_unlock(&fi->ext.ext_lock);
+			atomic_dec(&sbi->total_ext_node);
+			kmem_cache_free(extent_node_slab, en);
+		}
+		spin_unlock(&sbi->extent_lock);
+	}
+	return (atomic_read(&sbi->total_ext_node) / 100) *
+					sysctl_vfs_cache_pressure;
+}
+
+static int check_extent_cache(struct inode *inode, pgoff_t pgofs,
+					struct buffer_head *bh_result)
+{
+	unsigned int blkbits = inode->i_sb->s_blocksize_bits;
+	unsigned int count;
+	block_t blkaddr;
+
+	if (!lookup_extent_cache(inode, pgofs, &blkaddr, &count))
+		return 0;
+
+	clear_buffer_new(bh_result);
+	map_bh(bh_result, inode->i_sb, blkaddr);
+	if (count < (UINT_MAX >> blkbits))
+		bh_result->b_size = (count << blkbits);
+	else
+		bh_result->b_size = UINT_MAX;
+	return 1;
 }
 
 void update_extent_cache(block_t blk_addr, struct dnode_of_data *dn)
@@ -330,6 +575,8 @@ void update_extent_cache(block_t blk_addr, struct dnode_of_data *dn)
 	/* Update the page address in the parent node */
 	__set_data_blkaddr(dn, blk_addr);
 
+	update_extent_tree(dn->inode, fofs, blk_addr);
+
 	if (is_inode_flag_set(fi, FI_NO_EXTENT))
 		return;
 
@@ -396,12 +643,37 @@ end_update:
 	return;
 }
 
+/*
+ * Get the block address of index from the extent cache, or from its dnode
+ * when it is not cached yet.
+ */
+static int get_data_blkaddr(struct inode *inode, pgoff_t index,
+							block_t *blkaddr)
+{
+	struct dnode_of_data dn;
+	unsigned int count;
+	int err;
+
+	if (lookup_extent_cache(inode, index, blkaddr, &count))
+		return 0;
+
+	set_new_dnode(&dn, inode, NULL, NULL, 0);
+	err = get_dnode_of_data(&dn, index, LOOKUP_NODE);
+	if (err)
+		return err;
+	cache_dnode_extent(&dn, index);
+	f2fs_put_dnode(&dn);
+
+	*blkaddr = dn.data_blkaddr;
+	return 0;
+}
+
 struct page *find_data_page(struct inode *inode, pgoff_t index, bool sync)
 {
 	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
 	struct address_space *mapping = inode->i_mapping;
-	struct dnode_of_data dn;
 	struct page *page;
+	block_t blkaddr;
 	int err;
 
 	page = find_get_page(mapping, index);
@@ -409,17 +681,15 @@ struct page *find_data_page(struct inode *inode, pgoff_t index, bool sync)
 		return page;
 	f2fs_put_page(page, 0);
 
-	set_new_dnode(&dn, inode, NULL, NULL, 0);
-	err = get_dnode_of_data(&dn, index, LOOKUP_NODE);
+	err = get_data_blkaddr(inode, index, &blkaddr);
 	if (err)
 		return ERR_PTR(err);
-	f2fs_put_dnode(&dn);
 
-	if (dn.data_blkaddr == NULL_ADDR)
+	if (blkaddr == NULL_ADDR)
 		return ERR_PTR(-ENOENT);
 
 	/* By fallocate(), there is no cached page, but with NEW_ADDR */
-	if (unlikely(dn.data_blkaddr == NEW_ADDR))
+	if (unlikely(blkaddr == NEW_ADDR))
 		return ERR_PTR(-EINVAL);
 
 	page = grab_cache_page_write_begin(mapping, index, AOP_FLAG_NOFS);
@@ -431,7 +701,7 @@ struct page *find_data_page(struct inode *inode, pgoff_t index, bool sync)
 		return page;
 	}
 
-	err = f2fs_submit_page_bio(sbi, page, dn.data_blkaddr,
+	err = f2fs_submit_page_bio(sbi, page, blkaddr,
 					sync ? READ_SYNC : READA);
 	if (err)
 		return ERR_PTR(err);
@@ -455,8 +725,8 @@ struct page *get_lock_data_page(struct inode *inode, pgoff_t index)
 {
 	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
 	struct address_space *mapping = inode->i_mapping;
-	struct dnode_of_data dn;
 	struct page *page;
+	block_t blkaddr;
 	int err;
 
 repeat:
@@ -464,15 +734,13 @@ repeat:
 	if (!page)
 		return ERR_PTR(-ENOMEM);
 
-	set_new_dnode(&dn, inode, NULL, NULL, 0);
-	err = get_dnode_of_data(&dn, index, LOOKUP_NODE);
+	err = get_data_blkaddr(inode, index, &blkaddr);
 	if (err) {
 		f2fs_put_page(page, 1);
 		return ERR_PTR(err);
 	}
-	f2fs_put_dnode(&dn);
 
-	if (unlikely(dn.data_blkaddr == NULL_ADDR)) {
+	if (unlikely(blkaddr == NULL_ADDR)) {
 		f2fs_put_page(page, 1);
 		return ERR_PTR(-ENOENT);
 	}
@@ -486,13 +754,13 @@ repeat:
 	 * In such the case, its blkaddr can be remained as NEW_ADDR.
 	 * see, f2fs_add_link -> get_new_data_page -> init_inode_metadata.
 	 */
-	if (dn.data_blkaddr == NEW_ADDR) {
+	if (blkaddr == NEW_ADDR) {
 		zero_user_segment(page, 0, PAGE_CACHE_SIZE);
 		SetPageUptodate(page);
 		return page;
 	}
 
-	err = f2fs_submit_page_bio(sbi, page, dn.data_blkaddr, READ_SYNC);
+	err = f2fs_submit_page_bio(sbi, page, blkaddr, READ_SYNC);
 	if (err)
 		return ERR_PTR(err);
 
@@ -646,6 +914,8 @@ static int get_data_block(struct inode *inode, sector_t iblock,
 		goto put_out;
 
 	if (dn.data_blkaddr != NULL_ADDR) {
+		if (!create)
+			cache_dnode_extent(&dn, pgofs);
 		map_bh(bh_result, inode->i_sb, dn.data_blkaddr);
 	} else if (create) {
 		err = __allocate_data_block(&dn);
@@ -762,6 +1032,10 @@ int do_write_data_page(struct page *page, struct f2fs_io_info *fio)
 
 	set_page_writeback(page);
 
+	/* GC moves are not updates */
+	if (old_blkaddr != NEW_ADDR && !is_cold_data(page))
+		f2fs_update_heat(inode);
+
 	/*
 	 * If current allocation needs SSR,
 	 * it had better in-place writes for updated data.
@@ -1087,3 +1361,17 @@ const struct address_space_operations f2fs_dblock_aops = {
 	.direct_IO	= f2fs_direct_IO,
 	.bmap		= f2fs_bmap,
 };
+
+int __init create_extent_cache(void)
+{
+	extent_node_slab = f2fs_kmem_cache_create("f2fs_extent_node",
+			sizeof(struct extent_node), NULL);
+	if (!extent_node_slab)
+		return -ENOMEM;
+	return 0;
+}
+
+void destroy_extent_cache(void)
+{
+	kmem_cache_destroy(extent_node_slab);
+}
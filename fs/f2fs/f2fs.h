@@ -41,6 +41,7 @@
 #define F2FS_MOUNT_DISABLE_EXT_IDENTIFY	0x00000040
 #define F2FS_MOUNT_INLINE_XATTR		0x00000080
 #define F2FS_MOUNT_INLINE_DATA		0x00000100
+#define F2FS_MOUNT_INLINE_DENTRY	0x00000200
 
 #define clear_opt(sbi, option)	(sbi->mount_opt.opt &= ~F2FS_MOUNT_##option)
 #define set_opt(sbi, option)	(sbi->mount_opt.opt |= F2FS_MOUNT_##option)
@@ -60,20 +61,10 @@ struct f2fs_mount_info {
 	unsigned int	opt;
 };
 
-#define CRCPOLY_LE 0xedb88320
-
+/* the same bitwise LE crc32, without inversion, as the slice-by-8 one */
 static inline __u32 f2fs_crc32(void *buf, size_t len)
 {
-	unsigned char *p = (unsigned char *)buf;
-	__u32 crc = F2FS_SUPER_MAGIC;
-	int i;
-
-	while (len--) {
-		crc ^= *p++;
-		for (i = 0; i < 8; i++)
-			crc = (crc >> 1) ^ ((crc & 1) ? CRCPOLY_LE : 0);
-	}
-	return crc;
+	return crc32_le(F2FS_SUPER_MAGIC, buf, len);
 }
 
 static inline bool f2fs_crc_valid(__u32 blk_crc, void *buf, size_t buf_size)
@@ -182,6 +173,20 @@ struct extent_info {
 	unsigned int len;	/* length of the extent */
 };
 
+/*
+ * Besides the largest extent kept in the inode, the contiguous runs found in
+ * dnodes are cached in a per-inode rb-tree, protected by ext.ext_lock. All
+ * the nodes of a filesystem are also put on one lru list for the shrinker.
+ */
+struct extent_node {
+	struct rb_node rb_node;		/* rb node located in the inode's tree */
+	struct list_head list;		/* node in the global lru list */
+	struct f2fs_inode_info *fi;	/* inode owning this extent */
+	unsigned int fofs;		/* start offset in a file */
+	u32 blk_addr;			/* start block address of the extent */
+	unsigned int len;		/* length of the extent */
+};
+
 /*
  * i_advise uses FADVISE_XXX_BIT. We can add additional hints later.
  */
@@ -204,6 +209,9 @@ struct f2fs_inode_info {
 	nid_t i_xattr_nid;		/* node id that contains xattrs */
 	unsigned long long xattr_ver;	/* cp version of xattr modification */
 	struct extent_info ext;		/* in-memory extent cache entry */
+	struct rb_root ext_tree;	/* extent nodes, see struct extent_node */
+	unsigned int i_update_heat;	/* recent overwrites, see f2fs_update_heat */
+	unsigned long i_update_stamp;	/* jiffies the heat was last decayed */
 };
 
 static inline void get_extent_info(struct extent_info *ext,
@@ -455,6 +463,19 @@ struct f2fs_sb_info {
 	/* maximum # of trials to find a victim segment for SSR and GC */
 	unsigned int max_victim_search;
 
+	/* overwrites within hot_update_interval seconds that make data hot */
+	unsigned int hot_update_thresh;
+	unsigned int hot_update_interval;
+
+	/* protects the cold extension list in raw_super */
+	struct rw_semaphore sb_lock;
+
+	/* for the extent cache */
+	struct list_head extent_list;		/* lru list of extent nodes */
+	spinlock_t extent_lock;			/* for extent_list */
+	atomic_t total_ext_node;		/* # of extent nodes */
+	struct shrinker extent_shrinker;	/* reclaims extent nodes */
+
 	/*
 	 * for stat information.
 	 * one is for the LFS mode, and the other is for the SSR mode.
@@ -465,6 +486,8 @@ struct f2fs_sb_info {
 	unsigned int block_count[2];		/* # of allocated blocks */
 	int total_hit_ext, read_hit_ext;	/* extent cache hit ratio */
 	int inline_inode;			/* # of inline_data inodes */
+	int inline_dir;				/* # of inline_dentry inodes */
+	int total_lookup, inline_lookup;	/* inline dentry hit ratio */
 	int bg_gc;				/* background gc calls */
 	unsigned int n_dirty_dirs;		/* # of dir inodes */
 #endif
@@ -932,6 +955,7 @@ enum {
 	FI_NO_EXTENT,		/* not to use the extent cache */
 	FI_INLINE_XATTR,	/* used for inline xattr */
 	FI_INLINE_DATA,		/* used for inline data*/
+	FI_INLINE_DENTRY,	/* used for inline dentry */
 };
 
 static inline void set_inode_flag(struct f2fs_inode_info *fi, int flag)
@@ -971,6 +995,8 @@ static inline void get_inline_info(struct f2fs_inode_info *fi,
 		set_inode_flag(fi, FI_INLINE_XATTR);
 	if (ri->i_inline & F2FS_INLINE_DATA)
 		set_inode_flag(fi, FI_INLINE_DATA);
+	if (ri->i_inline & F2FS_INLINE_DENTRY)
+		set_inode_flag(fi, FI_INLINE_DENTRY);
 }
 
 static inline void set_raw_inline(struct f2fs_inode_info *fi,
@@ -982,6 +1008,8 @@ static inline void set_raw_inline(struct f2fs_inode_info *fi,
 		ri->i_inline |= F2FS_INLINE_XATTR;
 	if (is_inode_flag_set(fi, FI_INLINE_DATA))
 		ri->i_inline |= F2FS_INLINE_DATA;
+	if (is_inode_flag_set(fi, FI_INLINE_DENTRY))
+		ri->i_inline |= F2FS_INLINE_DENTRY;
 }
 
 static inline unsigned int addrs_per_inode(struct f2fs_inode_info *fi)
@@ -1012,6 +1040,11 @@ static inline int f2fs_has_inline_data(struct inode *inode)
 	return is_inode_flag_set(F2FS_I(inode), FI_INLINE_DATA);
 }
 
+static inline int f2fs_has_inline_dentry(struct inode *inode)
+{
+	return is_inode_flag_set(F2FS_I(inode), FI_INLINE_DENTRY);
+}
+
 static inline void *inline_data_addr(struct page *page)
 {
 	struct f2fs_inode *ri;
@@ -1062,6 +1095,16 @@ struct dentry *f2fs_get_parent(struct dentry *child);
 /*
  * dir.c
  */
+extern unsigned char f2fs_filetype_table[F2FS_FT_MAX];
+void set_de_type(struct f2fs_dir_entry *, struct inode *);
+struct f2fs_dir_entry *find_target_dentry(const char *, size_t, f2fs_hash_t,
+			int *, const void *, struct f2fs_dir_entry *,
+			__u8 (*)[F2FS_SLOT_LEN], int);
+struct page *init_inode_metadata(struct inode *, struct inode *,
+						const struct qstr *);
+void update_parent_metadata(struct inode *, struct inode *, unsigned int);
+int room_for_filename(const void *, int, int);
+void f2fs_drop_nlink(struct inode *, struct inode *, struct page *);
 struct f2fs_dir_entry *f2fs_find_entry(struct inode *, struct qstr *,
 							struct page **);
 struct f2fs_dir_entry *f2fs_parent_dir(struct inode *, struct page **);
@@ -1070,7 +1113,8 @@ void f2fs_set_link(struct inode *, struct f2fs_dir_entry *,
 				struct page *, struct inode *);
 int update_dent_inode(struct inode *, const struct qstr *);
 int __f2fs_add_link(struct inode *, const struct qstr *, struct inode *);
-void f2fs_delete_entry(struct f2fs_dir_entry *, struct page *, struct inode *);
+void f2fs_delete_entry(struct f2fs_dir_entry *, struct page *,
+				struct inode *, struct inode *);
 int f2fs_make_empty(struct inode *, struct inode *);
 bool f2fs_empty_dir(struct inode *);
 
@@ -1191,6 +1235,10 @@ void f2fs_submit_page_mbio(struct f2fs_sb_info *, struct page *, block_t,
 int reserve_new_block(struct dnode_of_data *);
 int f2fs_reserve_block(struct dnode_of_data *, pgoff_t);
 void update_extent_cache(block_t, struct dnode_of_data *);
+void f2fs_drop_extent_tree(struct inode *);
+int f2fs_shrink_extent_cache(struct shrinker *, struct shrink_control *);
+int __init create_extent_cache(void);
+void destroy_extent_cache(void);
 struct page *find_data_page(struct inode *, pgoff_t, bool);
 struct page *get_lock_data_page(struct inode *, pgoff_t);
 struct page *get_new_data_page(struct inode *, struct page *, pgoff_t, bool);
@@ -1223,11 +1271,12 @@ struct f2fs_stat_info {
 	struct mutex stat_lock;
 	int all_area_segs, sit_area_segs, nat_area_segs, ssa_area_segs;
 	int main_area_segs, main_area_sections, main_area_zones;
-	int hit_ext, total_ext;
+	int hit_ext, total_ext, ext_node;
 	int ndirty_node, ndirty_dent, ndirty_dirs, ndirty_meta;
 	int nats, sits, fnids;
 	int total_count, utilization;
-	int bg_gc, inline_inode;
+	int bg_gc, inline_inode, inline_dir;
+	int total_lookup, inline_lookup;
 	unsigned int valid_count, valid_node_count, valid_inode_count;
 	unsigned int bimodal, avg_vblocks;
 	int util_free, util_valid, util_invalid;
@@ -1266,6 +1315,22 @@ static inline struct f2fs_stat_info *F2FS_STAT(struct f2fs_sb_info *sbi)
 		if (f2fs_has_inline_data(inode))			\
 			((F2FS_SB(inode->i_sb))->inline_inode--);	\
 	} while (0)
+#define stat_inc_inline_dir(inode)					\
+	do {								\
+		if (f2fs_has_inline_dentry(inode))			\
+			((F2FS_SB(inode->i_sb))->inline_dir++);		\
+	} while (0)
+#define stat_dec_inline_dir(inode)					\
+	do {								\
+		if (f2fs_has_inline_dentry(inode))			\
+			((F2FS_SB(inode->i_sb))->inline_dir--);		\
+	} while (0)
+#define stat_inc_dir_lookup(dir)					\
+	do {								\
+		((F2FS_SB(dir->i_sb))->total_lookup++);			\
+		if (f2fs_has_inline_dentry(dir))			\
+			((F2FS_SB(dir->i_sb))->inline_lookup++);	\
+	} while (0)
 
 #define stat_inc_seg_type(sbi, curseg)					\
 		((sbi)->segment_count[(curseg)->alloc_type]++)
@@ -1312,6 +1377,9 @@ void f2fs_destroy_root_stats(void);
 #define stat_inc_read_hit(sb)
 #define stat_inc_inline_inode(inode)
 #define stat_dec_inline_inode(inode)
+#define stat_inc_inline_dir(inode)
+#define stat_dec_inline_dir(inode)
+#define stat_inc_dir_lookup(dir)
 #define stat_inc_seg_type(sbi, curseg)
 #define stat_inc_block_count(sbi, curseg)
 #define stat_inc_seg_count(si, type)
@@ -1343,4 +1411,13 @@ int f2fs_read_inline_data(struct inode *, struct page *);
 int f2fs_convert_inline_data(struct inode *, pgoff_t);
 int f2fs_write_inline_data(struct inode *, struct page *, unsigned int);
 int recover_inline_data(struct inode *, struct page *);
+struct f2fs_dir_entry *find_in_inline_dir(struct inode *, struct qstr *,
+							struct page **);
+struct f2fs_dir_entry *f2fs_parent_inline_dir(struct inode *, struct page **);
+int make_empty_inline_dir(struct inode *, struct inode *, struct page *);
+int f2fs_add_inline_entry(struct inode *, const struct qstr *, struct inode *);
+void f2fs_delete_inline_entry(struct f2fs_dir_entry *, struct page *,
+						struct inode *, struct inode *);
+bool f2fs_empty_inline_dir(struct inode *);
+int f2fs_read_inline_dir(struct file *, void *, filldir_t);
 #endif
@@ -32,6 +32,7 @@ static int gc_thread_func(void *data)
 	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
 	wait_queue_head_t *wq = &sbi->gc_thread->gc_wait_queue_head;
 	long wait_ms;
+	int ret;
 
 	wait_ms = gc_th->min_sleep_time;
 
@@ -72,15 +73,22 @@ static int gc_thread_func(void *data)
 			continue;
 		}
 
-		if (has_enough_invalid_blocks(sbi))
+		if (need_urgent_gc(sbi))
+			wait_ms = gc_th->urgent_sleep_time;
+		else if (has_enough_invalid_blocks(sbi))
 			wait_ms = decrease_sleep_time(gc_th, wait_ms);
 		else
 			wait_ms = increase_sleep_time(gc_th, wait_ms);
 
 		stat_inc_bggc_count(sbi);
 
-		/* if return value is not zero, no victim was selected */
-		if (f2fs_gc(sbi))
+		ret = f2fs_gc(sbi);
+		if (ret == -EBUSY)
+			/* foreground IO arrived, back off */
+			wait_ms = min_t(long, wait_ms * 2,
+					gc_th->max_sleep_time);
+		else if (ret)
+			/* no victim was selected */
 			wait_ms = gc_th->no_gc_sleep_time;
 
 		/* balancing f2fs's metadata periodically */
@@ -107,6 +115,7 @@ int start_gc_thread(struct f2fs_sb_info *sbi)
 	gc_th->min_sleep_time = DEF_GC_THREAD_MIN_SLEEP_TIME;
 	gc_th->max_sleep_time = DEF_GC_THREAD_MAX_SLEEP_TIME;
 	gc_th->no_gc_sleep_time = DEF_GC_THREAD_NOGC_SLEEP_TIME;
+	gc_th->urgent_sleep_time = DEF_GC_THREAD_URGENT_SLEEP_TIME;
 
 	gc_th->gc_idle = 0;
 
@@ -415,6 +424,10 @@ next_step:
 		if (gc_type == BG_GC && has_not_enough_free_secs(sbi, 0))
 			return;
 
+		/* and when foreground IO shows up */
+		if (gc_type == BG_GC && has_foreground_io(sbi))
+			return;
+
 		if (check_valid_map(sbi, segno, off) == 0)
 			continue;
 
@@ -580,6 +593,10 @@ next_step:
 		if (gc_type == BG_GC && has_not_enough_free_secs(sbi, 0))
 			return;
 
+		/* and when foreground IO shows up */
+		if (gc_type == BG_GC && has_foreground_io(sbi))
+			return;
+
 		if (check_valid_map(sbi, segno, off) == 0)
 			continue;
 
@@ -711,9 +728,19 @@ gc_more:
 		goto stop;
 	ret = 0;
 
-	for (i = 0; i < sbi->segs_per_sec; i++)
+	for (i = 0; i < sbi->segs_per_sec; i++) {
 		do_garbage_collect(sbi, segno + i, &ilist, gc_type);
 
+		/*
+		 * The victim stays in victim_secmap, so foreground GC picks
+		 * up what is left of it if space runs out meanwhile.
+		 */
+		if (gc_type == BG_GC && has_foreground_io(sbi)) {
+			ret = -EBUSY;
+			goto stop;
+		}
+	}
+
 	if (gc_type == FG_GC) {
 		sbi->cur_victim_sec = NULL_SEGNO;
 		nfree++;
@@ -16,6 +16,7 @@
 #define DEF_GC_THREAD_MIN_SLEEP_TIME	30000	/* milliseconds */
 #define DEF_GC_THREAD_MAX_SLEEP_TIME	60000
 #define DEF_GC_THREAD_NOGC_SLEEP_TIME	300000	/* wait 5 min */
+#define DEF_GC_THREAD_URGENT_SLEEP_TIME	500	/* short of free sections */
 #define LIMIT_INVALID_BLOCK	40 /* percentage over total user space */
 #define LIMIT_FREE_BLOCK	40 /* percentage over invalid + free space */
 
@@ -30,6 +31,7 @@ struct f2fs_gc_kthread {
 	unsigned int min_sleep_time;
 	unsigned int max_sleep_time;
 	unsigned int no_gc_sleep_time;
+	unsigned int urgent_sleep_time;
 
 	/* for changing gc mode */
 	unsigned int gc_idle;
@@ -108,3 +110,24 @@ static inline int is_idle(struct f2fs_sb_info *sbi)
 	struct request_list *rl = &q->rq;
 	return !(rl->count[BLK_RW_SYNC]) && !(rl->count[BLK_RW_ASYNC]);
 }
+
+/*
+ * Background GC only has async readahead outstanding when it checks this;
+ * it waits for its own sync reads. Pending sync requests therefore belong
+ * to a foreground reader or fsync, and background GC gets out of the way.
+ */
+static inline bool has_foreground_io(struct f2fs_sb_info *sbi)
+{
+	struct request_queue *q = bdev_get_queue(sbi->sb->s_bdev);
+
+	return q->rq.count[BLK_RW_SYNC] != 0;
+}
+
+/*
+ * Less than one reserve of free sections is left before writers have to
+ * run foreground GC: use idle windows more often to stay ahead of them.
+ */
+static inline bool need_urgent_gc(struct f2fs_sb_info *sbi)
+{
+	return has_not_enough_free_secs(sbi, -reserved_sections(sbi));
+}
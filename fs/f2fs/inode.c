@@ -281,8 +281,10 @@ void f2fs_evict_inode(struct inode *inode)
 	f2fs_lock_op(sbi);
 	remove_inode_page(inode);
 	stat_dec_inline_inode(inode);
+	stat_dec_inline_dir(inode);
 	f2fs_unlock_op(sbi);
 
 no_delete:
+	f2fs_drop_extent_tree(inode);
 	end_writeback(inode);
 }
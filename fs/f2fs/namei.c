@@ -98,14 +98,17 @@ static inline void set_cold_files(struct f2fs_sb_info *sbi, struct inode *inode,
 {
 	int i;
 	__u8 (*extlist)[8] = sbi->raw_super->extension_list;
+	int count;
 
-	int count = le32_to_cpu(sbi->raw_super->extension_count);
+	down_read(&sbi->sb_lock);
+	count = le32_to_cpu(sbi->raw_super->extension_count);
 	for (i = 0; i < count; i++) {
 		if (is_multimedia_file(name, extlist[i])) {
 			file_set_cold(inode);
 			break;
 		}
 	}
+	up_read(&sbi->sb_lock);
 }
 
 static int f2fs_create(struct inode *dir, struct dentry *dentry, umode_t mode,
@@ -236,7 +239,7 @@ static int f2fs_unlink(struct inode *dir, struct dentry *dentry)
 		f2fs_put_page(page, 0);
 		goto fail;
 	}
-	f2fs_delete_entry(de, page, inode);
+	f2fs_delete_entry(de, page, dir, inode);
 	f2fs_unlock_op(sbi);
 
 	/* In order to evict this inode,  we set it dirty */
@@ -302,6 +305,9 @@ static int f2fs_mkdir(struct inode *dir, struct dentry *dentry, umode_t mode)
 	inode->i_mapping->a_ops = &f2fs_dblock_aops;
 	mapping_set_gfp_mask(inode->i_mapping, GFP_F2FS_ZERO);
 
+	if (test_opt(sbi, INLINE_DENTRY))
+		set_inode_flag(F2FS_I(inode), FI_INLINE_DENTRY);
+
 	set_inode_flag(F2FS_I(inode), FI_INC_LINK);
 	f2fs_lock_op(sbi);
 	err = f2fs_add_link(dentry, inode);
@@ -385,6 +391,7 @@ static int f2fs_rename(struct inode *old_dir, struct dentry *old_dentry,
 	struct f2fs_dir_entry *old_dir_entry = NULL;
 	struct f2fs_dir_entry *old_entry;
 	struct f2fs_dir_entry *new_entry;
+	bool old_inline;
 	int err = -ENOENT;
 
 	f2fs_balance_fs(sbi);
@@ -392,6 +399,7 @@ static int f2fs_rename(struct inode *old_dir, struct dentry *old_dentry,
 	old_entry = f2fs_find_entry(old_dir, &old_dentry->d_name, &old_page);
 	if (!old_entry)
 		goto out;
+	old_inline = f2fs_has_inline_dentry(old_dir);
 
 	if (S_ISDIR(old_inode->i_mode)) {
 		err = -EIO;
@@ -444,6 +452,15 @@ static int f2fs_rename(struct inode *old_dir, struct dentry *old_dentry,
 		if (err)
 			goto out_dir;
 
+		/* the new name may have moved the inline dentries of old_dir */
+		if (old_inline && !f2fs_has_inline_dentry(old_dir)) {
+			kunmap(old_page);
+			f2fs_put_page(old_page, 0);
+			old_entry = f2fs_find_entry(old_dir,
+					&old_dentry->d_name, &old_page);
+			f2fs_bug_on(!old_entry);
+		}
+
 		if (old_dir_entry) {
 			inc_nlink(new_dir);
 			update_inode_page(new_dir);
@@ -453,7 +470,7 @@ static int f2fs_rename(struct inode *old_dir, struct dentry *old_dentry,
 	old_inode->i_ctime = CURRENT_TIME;
 	mark_inode_dirty(old_inode);
 
-	f2fs_delete_entry(old_entry, old_page, NULL);
+	f2fs_delete_entry(old_entry, old_page, old_dir, NULL);
 
 	if (old_dir_entry) {
 		if (old_dir != new_dir) {
@@ -829,6 +829,8 @@ static int __get_segment_type_6(struct page *page, enum page_type p_type)
 			return CURSEG_HOT_DATA;
 		else if (is_cold_data(page) || file_is_cold(inode))
 			return CURSEG_COLD_DATA;
+		else if (file_is_hot(inode))
+			return CURSEG_HOT_DATA;
 		else
 			return CURSEG_WARM_DATA;
 	} else {
@@ -525,6 +525,43 @@ static inline bool need_inplace_update(struct inode *inode)
 	return false;
 }
 
+/*
+ * Runtime hot data detection: overwrites of already allocated blocks heat
+ * a file up, and the heat halves for every hot_update_interval seconds
+ * that pass. Once it reaches hot_update_thresh the file's updates go to
+ * the hot data log, so blocks that are invalidated again soon stop being
+ * mixed with stable data in warm segments that GC then has to copy.
+ */
+#define DEF_HOT_UPDATE_THRESH		16
+#define DEF_HOT_UPDATE_INTERVAL		30	/* seconds */
+
+static inline void f2fs_update_heat(struct inode *inode)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+	unsigned long interval = sbi->hot_update_interval * HZ;
+	unsigned long periods;
+
+	if (interval) {
+		periods = (jiffies - fi->i_update_stamp) / interval;
+		if (periods) {
+			fi->i_update_heat = periods < 32 ?
+					fi->i_update_heat >> periods : 0;
+			fi->i_update_stamp = jiffies;
+		}
+	}
+
+	if (fi->i_update_heat < UINT_MAX)
+		fi->i_update_heat++;
+}
+
+static inline bool file_is_hot(struct inode *inode)
+{
+	unsigned int thresh = F2FS_SB(inode->i_sb)->hot_update_thresh;
+
+	return thresh && F2FS_I(inode)->i_update_heat >= thresh;
+}
+
 static inline unsigned int curseg_segno(struct f2fs_sb_info *sbi,
 		int type)
 {
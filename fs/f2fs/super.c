@@ -51,6 +51,7 @@ enum {
 	Opt_disable_ext_identify,
 	Opt_inline_xattr,
 	Opt_inline_data,
+	Opt_inline_dentry,
 	Opt_err,
 };
 
@@ -67,6 +68,7 @@ static match_table_t f2fs_tokens = {
 	{Opt_disable_ext_identify, "disable_ext_identify"},
 	{Opt_inline_xattr, "inline_xattr"},
 	{Opt_inline_data, "inline_data"},
+	{Opt_inline_dentry, "inline_dentry"},
 	{Opt_err, NULL},
 };
 
@@ -179,11 +181,90 @@ F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_min_sleep_time, min_sleep_time);
 F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_max_sleep_time, max_sleep_time);
 F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_no_gc_sleep_time, no_gc_sleep_time);
 F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_idle, gc_idle);
+F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_urgent_sleep_time,
+						urgent_sleep_time);
 F2FS_RW_ATTR(SM_INFO, f2fs_sm_info, reclaim_segments, rec_prefree_segments);
 F2FS_RW_ATTR(SM_INFO, f2fs_sm_info, max_small_discards, max_discards);
 F2FS_RW_ATTR(SM_INFO, f2fs_sm_info, ipu_policy, ipu_policy);
 F2FS_RW_ATTR(SM_INFO, f2fs_sm_info, min_ipu_util, min_ipu_util);
 F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, max_victim_search, max_victim_search);
+F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, hot_update_thresh, hot_update_thresh);
+F2FS_RW_ATTR(F2FS_SBI, f2fs_sb_info, hot_update_interval, hot_update_interval);
+
+/*
+ * Extensions whose files are created cold, one per line. Writing "ext"
+ * adds an extension and "!ext" removes it; the change is not written
+ * back to the on-disk superblock.
+ */
+static ssize_t f2fs_extension_show(struct f2fs_attr *a,
+			struct f2fs_sb_info *sbi, char *buf)
+{
+	__u8 (*extlist)[8] = sbi->raw_super->extension_list;
+	int i, count;
+	ssize_t len = 0;
+
+	down_read(&sbi->sb_lock);
+	count = le32_to_cpu(sbi->raw_super->extension_count);
+	for (i = 0; i < count; i++)
+		len += snprintf(buf + len, PAGE_SIZE - len, "%.8s\n",
+				(char *)extlist[i]);
+	up_read(&sbi->sb_lock);
+
+	return len;
+}
+
+static ssize_t f2fs_extension_store(struct f2fs_attr *a,
+			struct f2fs_sb_info *sbi,
+			const char *buf, size_t count)
+{
+	__u8 (*extlist)[8] = sbi->raw_super->extension_list;
+	char name[8];
+	bool remove = false;
+	const char *p;
+	int i, nr;
+	size_t len;
+
+	p = skip_spaces(buf);
+	if (*p == '!') {
+		remove = true;
+		p++;
+	}
+
+	len = strcspn(p, " \t\n");
+	if (!len || len >= sizeof(name))
+		return -EINVAL;
+	memcpy(name, p, len);
+	name[len] = '\0';
+
+	down_write(&sbi->sb_lock);
+	nr = le32_to_cpu(sbi->raw_super->extension_count);
+	for (i = 0; i < nr; i++)
+		if (!strncasecmp((char *)extlist[i], name, sizeof(name)))
+			break;
+
+	if (remove) {
+		if (i < nr) {
+			memmove(extlist[i], extlist[i + 1],
+				(nr - i - 1) * sizeof(extlist[0]));
+			memset(extlist[nr - 1], 0, sizeof(extlist[0]));
+			sbi->raw_super->extension_count = cpu_to_le32(nr - 1);
+		}
+	} else if (i == nr) {
+		if (nr == F2FS_MAX_EXTENSION) {
+			up_write(&sbi->sb_lock);
+			return -ENOSPC;
+		}
+		memset(extlist[nr], 0, sizeof(extlist[0]));
+		memcpy(extlist[nr], name, len);
+		sbi->raw_super->extension_count = cpu_to_le32(nr + 1);
+	}
+	up_write(&sbi->sb_lock);
+
+	return count;
+}
+
+F2FS_ATTR_OFFSET(F2FS_SBI, extension_list, 0644,
+		f2fs_extension_show, f2fs_extension_store, 0);
 
 #define ATTR_LIST(name) (&f2fs_attr_##name.attr)
 static struct attribute *f2fs_attrs[] = {
@@ -191,11 +272,15 @@ static struct attribute *f2fs_attrs[] = {
 	ATTR_LIST(gc_max_sleep_time),
 	ATTR_LIST(gc_no_gc_sleep_time),
 	ATTR_LIST(gc_idle),
+	ATTR_LIST(gc_urgent_sleep_time),
 	ATTR_LIST(reclaim_segments),
 	ATTR_LIST(max_small_discards),
 	ATTR_LIST(ipu_policy),
 	ATTR_LIST(min_ipu_util),
 	ATTR_LIST(max_victim_search),
+	ATTR_LIST(hot_update_thresh),
+	ATTR_LIST(hot_update_interval),
+	ATTR_LIST(extension_list),
 	NULL,
 };
 
@@ -327,6 +412,9 @@ static int parse_options(struct super_block *sb, char *options)
 		case Opt_inline_data:
 			set_opt(sbi, INLINE_DATA);
 			break;
+		case Opt_inline_dentry:
+			set_opt(sbi, INLINE_DENTRY);
+			break;
 		default:
 			f2fs_msg(sb, KERN_ERR,
 				"Unrecognized mount option \"%s\" or missing value",
@@ -353,6 +441,9 @@ static struct inode *f2fs_alloc_inode(struct super_block *sb)
 	fi->i_current_depth = 1;
 	fi->i_advise = 0;
 	rwlock_init(&fi->ext.ext_lock);
+	fi->ext_tree = RB_ROOT;
+	fi->i_update_heat = 0;
+	fi->i_update_stamp = jiffies;
 
 	set_inode_flag(fi, FI_NEW_INODE);
 
@@ -401,6 +492,8 @@ static void f2fs_put_super(struct super_block *sb)
 {
 	struct f2fs_sb_info *sbi = F2FS_SB(sb);
 
+	unregister_shrinker(&sbi->extent_shrinker);
+
 	if (sbi->s_proc) {
 		remove_proc_entry("segment_info", sbi->s_proc);
 		remove_proc_entry(sb->s_id, f2fs_proc_root);
@@ -526,6 +619,8 @@ static int f2fs_show_options(struct seq_file *seq, struct dentry *root)
 		seq_puts(seq, ",disable_ext_identify");
 	if (test_opt(sbi, INLINE_DATA))
 		seq_puts(seq, ",inline_data");
+	if (test_opt(sbi, INLINE_DENTRY))
+		seq_puts(seq, ",inline_dentry");
 	seq_printf(seq, ",active_logs=%u", sbi->active_logs);
 
 	return 0;
@@ -782,6 +877,8 @@ static void init_sb_info(struct f2fs_sb_info *sbi)
 	sbi->meta_ino_num = le32_to_cpu(raw_super->meta_ino);
 	sbi->cur_victim_sec = NULL_SECNO;
 	sbi->max_victim_search = DEF_MAX_VICTIM_SEARCH;
+	sbi->hot_update_thresh = DEF_HOT_UPDATE_THRESH;
+	sbi->hot_update_interval = DEF_HOT_UPDATE_INTERVAL;
 
 	for (i = 0; i < NR_COUNT_TYPE; i++)
 		atomic_set(&sbi->nr_pages[i], 0);
@@ -906,6 +1003,7 @@ static int f2fs_fill_super(struct super_block *sb, void *data, int silent)
 	}
 
 	init_rwsem(&sbi->cp_rwsem);
+	init_rwsem(&sbi->sb_lock);
 	init_waitqueue_head(&sbi->cp_wait);
 	init_sb_info(sbi);
 
@@ -941,6 +1039,9 @@ static int f2fs_fill_super(struct super_block *sb, void *data, int silent)
 	sbi->alloc_valid_block_count = 0;
 	INIT_LIST_HEAD(&sbi->dir_inode_list);
 	spin_lock_init(&sbi->dir_inode_lock);
+	INIT_LIST_HEAD(&sbi->extent_list);
+	spin_lock_init(&sbi->extent_lock);
+	atomic_set(&sbi->total_ext_node, 0);
 
 	init_orphan_info(sbi);
 
@@ -1034,6 +1135,10 @@ static int f2fs_fill_super(struct super_block *sb, void *data, int silent)
 	if (err)
 		goto fail;
 
+	sbi->extent_shrinker.shrink = f2fs_shrink_extent_cache;
+	sbi->extent_shrinker.seeks = DEFAULT_SEEKS;
+	register_shrinker(&sbi->extent_shrinker);
+
 	return 0;
 fail:
 	if (sbi->s_proc) {
@@ -1116,10 +1221,13 @@ static int __init init_f2fs_fs(void)
 	err = create_checkpoint_caches();
 	if (err)
 		goto free_gc_caches;
+	err = create_extent_cache();
+	if (err)
+		goto free_checkpoint_caches;
 	f2fs_kset = kset_create_and_add("f2fs", NULL, fs_kobj);
 	if (!f2fs_kset) {
 		err = -ENOMEM;
-		goto free_checkpoint_caches;
+		goto free_extent_cache;
 	}
 	err = register_filesystem(&f2fs_fs_type);
 	if (err)
@@ -1130,6 +1238,8 @@ static int __init init_f2fs_fs(void)
 
 free_kset:
 	kset_unregister(f2fs_kset);
+free_extent_cache:
+	destroy_extent_cache();
 free_checkpoint_caches:
 	destroy_checkpoint_caches();
 free_gc_caches:
@@ -1149,6 +1259,7 @@ static void __exit exit_f2fs_fs(void)
 	remove_proc_entry("fs/f2fs", NULL);
 	f2fs_destroy_root_stats();
 	unregister_filesystem(&f2fs_fs_type);
+	destroy_extent_cache();
 	destroy_checkpoint_caches();
 	destroy_gc_caches();
 	destroy_segment_manager_caches();
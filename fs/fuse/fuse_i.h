@@ -23,9 +23,14 @@
 #include <linux/poll.h>
 #include <linux/workqueue.h>
 
-/** Max number of pages that can be used in a single read request */
+/** Default max number of pages in a request, also kept inline in it */
 #define FUSE_MAX_PAGES_PER_REQ 32
 
+/** Largest max_pages a filesystem may ask for in INIT */
+#define FUSE_MAX_MAX_PAGES 256
+
+#define FUSE_SUPER_MAGIC 0x65735546
+
 /** Bias for fi->writectr, meaning new writepages must not be sent */
 #define FUSE_NOWRITE INT_MIN
 
@@ -141,6 +146,9 @@ struct fuse_file {
 
 	/** Has flock been performed on this file? */
 	bool flock:1;
+
+	/** Lower file that data I/O is passed through to, if any */
+	struct file *passthrough_filp;
 };
 
 /** One input argument of a request */
@@ -291,7 +299,13 @@ struct fuse_req {
 	} misc;
 
 	/** page vector */
-	struct page *pages[FUSE_MAX_PAGES_PER_REQ];
+	struct page **pages;
+
+	/** size of the page vector */
+	unsigned max_pages;
+
+	/** inline page vector, used unless more pages were asked for */
+	struct page *inline_pages[FUSE_MAX_PAGES_PER_REQ];
 
 	/** number of pages in vector */
 	unsigned num_pages;
@@ -308,6 +322,9 @@ struct fuse_req {
 	/** Path used for completing d_canonical_path */
 	struct path *canonical_path;
 
+	/** Lower file from the reply to OPEN or CREATE */
+	struct file *passthrough_filp;
+
 	/** Link on fi->writepages */
 	struct list_head writepages_entry;
 
@@ -350,6 +367,9 @@ struct fuse_conn {
 	/** Maximum write size */
 	unsigned max_write;
 
+	/** Maximum number of pages in a read or write request */
+	unsigned max_pages;
+
 	/** Readers of the connection are waiting on this */
 	wait_queue_head_t waitq;
 
@@ -484,6 +504,14 @@ struct fuse_conn {
 	/** Are BSD file locking primitives not implemented by fs? */
 	unsigned no_flock:1;
 
+	/** Buffer writes in the page cache and write them back in
+	    batches.  Only set in INIT */
+	unsigned writeback_cache:1;
+
+	/** Can OPEN and CREATE replies pass a lower file?  Only set
+	    in INIT */
+	unsigned passthrough:1;
+
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
@@ -657,7 +685,12 @@ void fuse_ctl_cleanup(void);
  */
 struct fuse_req *fuse_request_alloc(void);
 
-struct fuse_req *fuse_request_alloc_nofs(void);
+/**
+ * Allocate a request with room for npages pages
+ */
+struct fuse_req *fuse_request_alloc_pages(unsigned npages);
+
+struct fuse_req *fuse_request_alloc_nofs(unsigned npages);
 
 /**
  * Free a request
@@ -669,6 +702,11 @@ void fuse_request_free(struct fuse_req *req);
  */
 struct fuse_req *fuse_get_req(struct fuse_conn *fc);
 
+/**
+ * Get a request with room for npages pages, may fail with -ENOMEM
+ */
+struct fuse_req *fuse_get_req_pages(struct fuse_conn *fc, unsigned npages);
+
 /**
  * Gets a requests for a file operation, always succeeds
  */
@@ -784,4 +822,15 @@ int fuse_dev_release(struct inode *inode, struct file *file);
 
 void fuse_write_update_size(struct inode *inode, loff_t pos);
 
+/* passthrough.c */
+void fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_req *req);
+void fuse_passthrough_open(struct fuse_file *ff, struct fuse_req *req);
+void fuse_passthrough_release(struct fuse_file *ff);
+ssize_t fuse_passthrough_aio_read(struct kiocb *iocb, const struct iovec *iov,
+				  unsigned long nr_segs, loff_t pos);
+ssize_t fuse_passthrough_aio_write(struct kiocb *iocb,
+				   const struct iovec *iov,
+				   unsigned long nr_segs, loff_t pos);
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+
 #endif /* _FS_FUSE_I_H */
@@ -0,0 +1,198 @@
+/*
+  FUSE: Filesystem in Userspace
+  Passthrough of read, write and mmap to a lower file
+
+  The server may answer OPEN and CREATE with FOPEN_PASSTHROUGH and the
+  descriptor of a file it opened itself.  The kernel takes a reference
+  on that file while the reply is being written, still in the context of
+  the server, and from then on data I/O on the fuse file goes straight
+  to the lower one.  Permission checks stay with the server at open
+  time, the lower file carries the server's credentials.
+
+  This program can be distributed under the terms of the GNU GPL.
+  See the file COPYING.
+*/
+
+#include "fuse_i.h"
+
+#include <linux/aio.h>
+#include <linux/file.h>
+#include <linux/fsnotify.h>
+#include <linux/mm.h>
+#include <linux/pagemap.h>
+#include <linux/uio.h>
+
+/*
+ * Called while the server's reply to OPEN or CREATE is copied in, in
+ * the context of the server, which is the only place the descriptor
+ * means anything.
+ */
+void fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_req *req)
+{
+	struct fuse_open_out *outarg;
+	struct file *lower;
+	struct inode *lower_inode;
+	unsigned idx;
+
+	if (!fc->passthrough || req->out.h.error)
+		return;
+
+	if (req->in.h.opcode == FUSE_OPEN)
+		idx = 0;
+	else if (req->in.h.opcode == FUSE_CREATE)
+		idx = 1;
+	else
+		return;
+
+	if (req->out.numargs <= idx ||
+	    req->out.args[idx].size != sizeof(*outarg))
+		return;
+
+	outarg = req->out.args[idx].value;
+	if (!(outarg->open_flags & FOPEN_PASSTHROUGH))
+		return;
+	outarg->open_flags &= ~FOPEN_PASSTHROUGH;
+
+	lower = fget(outarg->passthrough_fd);
+	if (!lower) {
+		pr_warn("fuse: passthrough fd %u is not open\n",
+			outarg->passthrough_fd);
+		return;
+	}
+
+	/* no stacking onto fuse, and only files with a page cache of their own */
+	lower_inode = lower->f_path.dentry->d_inode;
+	if (!S_ISREG(lower_inode->i_mode) ||
+	    lower_inode->i_sb->s_magic == FUSE_SUPER_MAGIC ||
+	    !lower->f_op || !lower->f_op->aio_read) {
+		pr_warn("fuse: passthrough fd %u can't be used\n",
+			outarg->passthrough_fd);
+		fput(lower);
+		return;
+	}
+
+	outarg->open_flags |= FOPEN_PASSTHROUGH;
+	req->passthrough_filp = lower;
+}
+
+/* Hand the lower file found in the OPEN or CREATE reply to the new file */
+void fuse_passthrough_open(struct fuse_file *ff, struct fuse_req *req)
+{
+	ff->passthrough_filp = req->passthrough_filp;
+	req->passthrough_filp = NULL;
+}
+
+void fuse_passthrough_release(struct fuse_file *ff)
+{
+	if (ff->passthrough_filp) {
+		fput(ff->passthrough_filp);
+		ff->passthrough_filp = NULL;
+	}
+}
+
+static ssize_t fuse_passthrough_rw(struct kiocb *iocb, const struct iovec *iov,
+				   unsigned long nr_segs, loff_t pos, int rw)
+{
+	struct fuse_file *ff = iocb->ki_filp->private_data;
+	struct file *lower = ff->passthrough_filp;
+	struct kiocb kiocb;
+	ssize_t ret;
+
+	if (rw == WRITE) {
+		if (!(lower->f_mode & FMODE_WRITE))
+			return -EBADF;
+		if (!lower->f_op->aio_write)
+			return -EINVAL;
+	} else if (!(lower->f_mode & FMODE_READ)) {
+		return -EBADF;
+	}
+
+	init_sync_kiocb(&kiocb, lower);
+	kiocb.ki_pos = pos;
+	kiocb.ki_left = iocb->ki_left;
+	kiocb.ki_nbytes = iocb->ki_nbytes;
+
+	for (;;) {
+		if (rw == WRITE)
+			ret = lower->f_op->aio_write(&kiocb, iov, nr_segs,
+						     kiocb.ki_pos);
+		else
+			ret = lower->f_op->aio_read(&kiocb, iov, nr_segs,
+						    kiocb.ki_pos);
+		if (ret != -EIOCBRETRY)
+			break;
+		wait_on_retry_sync_kiocb(&kiocb);
+	}
+
+	if (ret == -EIOCBQUEUED)
+		ret = wait_on_sync_kiocb(&kiocb);
+	iocb->ki_pos = kiocb.ki_pos;
+
+	if (ret > 0) {
+		if (rw == WRITE)
+			fsnotify_modify(lower);
+		else
+			fsnotify_access(lower);
+	}
+
+	return ret;
+}
+
+ssize_t fuse_passthrough_aio_read(struct kiocb *iocb, const struct iovec *iov,
+				  unsigned long nr_segs, loff_t pos)
+{
+	return fuse_passthrough_rw(iocb, iov, nr_segs, pos, READ);
+}
+
+ssize_t fuse_passthrough_aio_write(struct kiocb *iocb,
+				   const struct iovec *iov,
+				   unsigned long nr_segs, loff_t pos)
+{
+	struct inode *inode = iocb->ki_filp->f_mapping->host;
+	ssize_t ret;
+
+	ret = fuse_passthrough_rw(iocb, iov, nr_segs, pos, WRITE);
+	if (ret > 0) {
+		/*
+		 * Appending writes go wherever the lower file put them,
+		 * the new size and position come from the lower kiocb
+		 */
+		fuse_write_update_size(inode, iocb->ki_pos);
+		invalidate_mapping_pages(inode->i_mapping,
+					 (iocb->ki_pos - ret) >> PAGE_CACHE_SHIFT,
+					 (iocb->ki_pos - 1) >> PAGE_CACHE_SHIFT);
+	}
+	fuse_invalidate_attr(inode);
+
+	return ret;
+}
+
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_file *ff = file->private_data;
+	struct file *lower = ff->passthrough_filp;
+	int err;
+
+	if (!lower->f_op->mmap)
+		return -ENODEV;
+
+	if ((vma->vm_flags & VM_SHARED) && (vma->vm_flags & VM_MAYWRITE) &&
+	    !(lower->f_mode & FMODE_WRITE))
+		return -EACCES;
+
+	/*
+	 * The vma is handed over to the lower file as in sdcardfs, faults
+	 * then never come through here.  mmap_region() put the reference
+	 * it took on our file into vm_file, that one is swapped.
+	 */
+	err = lower->f_op->mmap(lower, vma);
+	if (err)
+		return err;
+
+	file_accessed(file);
+	get_file(lower);
+	vma->vm_file = lower;
+	fput(file);
+
+	return 0;
+}
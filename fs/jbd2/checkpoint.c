@@ -23,6 +23,7 @@
 #include <linux/errno.h>
 #include <linux/slab.h>
 #include <linux/blkdev.h>
+#include <linux/sort.h>
 #include <trace/events/jbd2.h>
 
 /*
@@ -227,12 +228,30 @@ restart:
 	return ret;
 }
 
+static int bh_blocknr_cmp(const void *a, const void *b)
+{
+	const struct buffer_head *bha = *(const struct buffer_head **)a;
+	const struct buffer_head *bhb = *(const struct buffer_head **)b;
+
+	if (bha->b_blocknr < bhb->b_blocknr)
+		return -1;
+	return bha->b_blocknr > bhb->b_blocknr;
+}
+
+/*
+ * The checkpoint list is in the order the buffers were journaled, which
+ * has little to do with where they live on disk. Submit the batch by
+ * block number under one plug so adjacent buffers end up in one request.
+ */
 static void
 __flush_batch(journal_t *journal, int *batch_count)
 {
 	int i;
 	struct blk_plug plug;
 
+	sort(journal->j_chkpt_bhs, *batch_count,
+	     sizeof(journal->j_chkpt_bhs[0]), bh_blocknr_cmp, NULL);
+
 	blk_start_plug(&plug);
 	for (i = 0; i < *batch_count; i++)
 		write_dirty_buffer(journal->j_chkpt_bhs[i], WRITE_SYNC);
@@ -200,7 +200,13 @@ static int journal_submit_data_buffers(journal_t *journal,
 	struct jbd2_inode *jinode;
 	int err, ret = 0;
 	struct address_space *mapping;
+	struct blk_plug plug;
 
+	/*
+	 * One plug for all the inodes of the transaction, so requests for
+	 * small files that sit next to each other on disk can be merged.
+	 */
+	blk_start_plug(&plug);
 	spin_lock(&journal->j_list_lock);
 	list_for_each_entry(jinode, &commit_transaction->t_inode_list, i_list) {
 		mapping = jinode->i_vfs_inode->i_mapping;
@@ -223,6 +229,7 @@ static int journal_submit_data_buffers(journal_t *journal,
 		wake_up_bit(&jinode->i_flags, __JI_COMMIT_RUNNING);
 	}
 	spin_unlock(&journal->j_list_lock);
+	blk_finish_plug(&plug);
 	return ret;
 }
 
@@ -44,6 +44,7 @@
 #include <linux/backing-dev.h>
 #include <linux/bitops.h>
 #include <linux/ratelimit.h>
+#include <linux/hrtimer.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/jbd2.h>
@@ -692,6 +693,60 @@ wait_commit:
 }
 EXPORT_SYMBOL(jbd2_complete_transaction);
 
+/*
+ * Like jbd2_complete_transaction(), but the first caller to ask for the
+ * running transaction holds the commit back for about one commit time,
+ * bounded by j_min_batch_time and j_max_batch_time, so that fsyncs from
+ * other tasks arriving meanwhile are covered by the same commit. Those
+ * only wait for it. As in jbd2_journal_stop(), a task that was also the
+ * previous one to batch is streaming syncs and commits at once.
+ */
+int jbd2_complete_transaction_batched(journal_t *journal, tid_t tid)
+{
+	transaction_t *transaction;
+	u64 commit_time, trans_time;
+	ktime_t expires;
+	pid_t pid = current->pid;
+
+	write_lock(&journal->j_state_lock);
+	transaction = journal->j_running_transaction;
+	if (!transaction || transaction->t_tid != tid ||
+	    journal->j_commit_request == tid) {
+		write_unlock(&journal->j_state_lock);
+		return jbd2_complete_transaction(journal, tid);
+	}
+	if (transaction->t_fsync_batch) {
+		write_unlock(&journal->j_state_lock);
+		return jbd2_log_wait_commit(journal, tid);
+	}
+	if (journal->j_last_sync_writer == pid) {
+		__jbd2_log_start_commit(journal, tid);
+		write_unlock(&journal->j_state_lock);
+		return jbd2_log_wait_commit(journal, tid);
+	}
+	journal->j_last_sync_writer = pid;
+	transaction->t_fsync_batch = 1;
+
+	commit_time = journal->j_average_commit_time;
+	trans_time = ktime_to_ns(ktime_sub(ktime_get(),
+					   transaction->t_start_time));
+	write_unlock(&journal->j_state_lock);
+
+	commit_time = max_t(u64, commit_time, 1000*journal->j_min_batch_time);
+	commit_time = min_t(u64, commit_time, 1000*journal->j_max_batch_time);
+
+	if (trans_time < commit_time) {
+		expires = ktime_add_ns(ktime_get(), commit_time);
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		schedule_hrtimeout(&expires, HRTIMER_MODE_ABS);
+	}
+
+	/* a stale tid is left alone, the transaction is committing anyway */
+	jbd2_log_start_commit(journal, tid);
+	return jbd2_log_wait_commit(journal, tid);
+}
+EXPORT_SYMBOL(jbd2_complete_transaction_batched);
+
 /*
  * Log buffer allocation routines:
  */
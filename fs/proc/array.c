@@ -81,6 +81,7 @@
 #include <linux/pid_namespace.h>
 #include <linux/ptrace.h>
 #include <linux/tracehook.h>
+#include <linux/pidstats.h>
 
 #include <asm/pgtable.h>
 #include <asm/processor.h>
@@ -533,6 +534,70 @@ int proc_tgid_stat(struct seq_file *m, struct pid_namespace *ns,
 	return do_task_stat(m, ns, pid, task, 1);
 }
 
+/*
+ * The /proc/pidstats record of a thread group, the same values as
+ * do_task_stat() with whole set and proc_pid_statm(), without the
+ * formatting and without the fields that need ptrace access.
+ */
+void proc_pid_record(struct pid_namespace *ns, struct task_struct *task,
+			struct pidstats_record *rec)
+{
+	unsigned long shared = 0, text = 0, data = 0, resident = 0;
+	unsigned long long start_time;
+	cputime_t utime, stime;
+	struct mm_struct *mm;
+	unsigned long flags;
+
+	memset(rec, 0, sizeof(*rec));
+	rec->size = sizeof(*rec);
+	rec->pid = task_tgid_nr_ns(task, ns);
+	rec->uid = task_uid(task);
+	rec->flags = task->flags;
+	rec->state = *get_task_state(task);
+	rec->nice = task_nice(task);
+	rec->policy = task->policy;
+	rec->rt_priority = task->rt_priority;
+	get_task_comm(rec->comm, task);
+
+	if (lock_task_sighand(task, &flags)) {
+		struct signal_struct *sig = task->signal;
+		struct task_struct *t = task;
+
+		do {
+			rec->min_flt += t->min_flt;
+			rec->maj_flt += t->maj_flt;
+			t = next_thread(t);
+		} while (t != task);
+		rec->min_flt += sig->min_flt;
+		rec->maj_flt += sig->maj_flt;
+		thread_group_times(task, &utime, &stime);
+		rec->utime = cputime_to_clock_t(utime);
+		rec->stime = cputime_to_clock_t(stime);
+
+		rec->num_threads = get_nr_threads(task);
+		rec->oom_score_adj = sig->oom_score_adj;
+		rec->ppid = task_tgid_nr_ns(task->real_parent, ns);
+
+		unlock_task_sighand(task, &flags);
+	}
+
+	start_time =
+		(unsigned long long)task->real_start_time.tv_sec * NSEC_PER_SEC
+				+ task->real_start_time.tv_nsec;
+	rec->start_time = nsec_to_clock_t(start_time);
+
+	mm = get_task_mm(task);
+	if (mm) {
+		rec->vsize = task_vsize(mm);
+		task_statm(mm, &shared, &text, &data, &resident);
+		rec->rss = resident;
+		rec->shared = shared;
+		rec->text = text;
+		rec->data = data;
+		mmput(mm);
+	}
+}
+
 int proc_pid_statm(struct seq_file *m, struct pid_namespace *ns,
 			struct pid *pid, struct task_struct *task)
 {
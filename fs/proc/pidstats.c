@@ -0,0 +1,103 @@
+/*
+ *  linux/fs/proc/pidstats.c
+ *
+ *  /proc/pidstats: one binary record per process, in a single read.
+ *  Process scanners otherwise open, format and parse stat, statm and
+ *  oom_score_adj of every pid on every pass.
+ */
+
+#include <linux/fs.h>
+#include <linux/init.h>
+#include <linux/pid_namespace.h>
+#include <linux/pidstats.h>
+#include <linux/proc_fs.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include "internal.h"
+
+/* *pos is the next tgid to look at, so a reader resumes where it left */
+static struct task_struct *pidstats_find(struct pid_namespace *ns, loff_t *pos)
+{
+	struct task_struct *task = NULL;
+	struct pid *pid;
+	pid_t tgid = *pos;
+
+	if (*pos >= PID_MAX_LIMIT)
+		return NULL;
+
+	rcu_read_lock();
+	while ((pid = find_ge_pid(tgid ? tgid : 1, ns))) {
+		tgid = pid_nr_ns(pid, ns);
+		task = pid_task(pid, PIDTYPE_PID);
+		/* the same test as proc_pid_readdir(), see next_tgid() */
+		if (task && has_group_leader_pid(task)) {
+			get_task_struct(task);
+			break;
+		}
+		task = NULL;
+		tgid++;
+	}
+	rcu_read_unlock();
+
+	*pos = task ? tgid : PID_MAX_LIMIT;
+	return task;
+}
+
+static void *pidstats_start(struct seq_file *m, loff_t *pos)
+{
+	return pidstats_find(m->private, pos);
+}
+
+static void *pidstats_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	put_task_struct(v);
+	++*pos;
+	return pidstats_find(m->private, pos);
+}
+
+static void pidstats_stop(struct seq_file *m, void *v)
+{
+	if (v)
+		put_task_struct(v);
+}
+
+static int pidstats_show(struct seq_file *m, void *v)
+{
+	struct pidstats_record rec;
+
+	proc_pid_record(m->private, v, &rec);
+	seq_write(m, &rec, sizeof(rec));
+	return 0;
+}
+
+static const struct seq_operations pidstats_seq_ops = {
+	.start	= pidstats_start,
+	.next	= pidstats_next,
+	.stop	= pidstats_stop,
+	.show	= pidstats_show,
+};
+
+static int pidstats_open(struct inode *inode, struct file *file)
+{
+	int ret;
+
+	ret = seq_open(file, &pidstats_seq_ops);
+	if (!ret)
+		((struct seq_file *)file->private_data)->private =
+			inode->i_sb->s_fs_info;
+	return ret;
+}
+
+static const struct file_operations proc_pidstats_operations = {
+	.open		= pidstats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
+static int __init proc_pidstats_init(void)
+{
+	proc_create("pidstats", 0, NULL, &proc_pidstats_operations);
+	return 0;
+}
+module_init(proc_pidstats_init);
@@ -48,11 +48,8 @@ void setup_derived_state(struct inode *inode, perm_t perm, userid_t userid,
 	info->data->under_obb = false;
 }
 
-/* While renaming, there is a point where we want the path from dentry,
- * but the name from newdentry
- */
-void get_derived_permission_new(struct dentry *parent, struct dentry *dentry,
-				const struct qstr *name)
+static void __get_derived_permission(struct dentry *parent,
+			struct dentry *dentry, const struct qstr *name)
 {
 	struct sdcardfs_inode_info *info = SDCARDFS_I(dentry->d_inode);
 	struct sdcardfs_inode_info *parent_info = SDCARDFS_I(parent->d_inode);
@@ -141,11 +138,54 @@ void get_derived_permission_new(struct dentry *parent, struct dentry *dentry,
 	}
 }
 
+/* While renaming, there is a point where we want the path from dentry,
+ * but the name from newdentry
+ */
+void get_derived_permission_new(struct dentry *parent, struct dentry *dentry,
+				const struct qstr *name)
+{
+	struct sdcardfs_dentry_info *di = SDCARDFS_D(dentry);
+	unsigned int gen = atomic_read(&sdcardfs_perm_gen);
+
+	/* pairs with sdcardfs_invalidate_perms() */
+	smp_rmb();
+	__get_derived_permission(parent, dentry, name);
+	SDCARDFS_I(dentry->d_inode)->data->perm_dentry = dentry;
+	if (di)
+		di->perm_gen = gen;
+}
+
+/*
+ * The derived state only changes with the package list or with the
+ * position of the dentry in the tree, so a dentry whose inode was last
+ * derived through it at the current generation is still up to date.
+ */
+static bool derived_permission_current(struct dentry *dentry)
+{
+	struct sdcardfs_dentry_info *di = SDCARDFS_D(dentry);
+
+	return di && di->perm_gen == atomic_read(&sdcardfs_perm_gen) &&
+		SDCARDFS_I(dentry->d_inode)->data->perm_dentry == dentry;
+}
+
 void get_derived_permission(struct dentry *parent, struct dentry *dentry)
 {
+	if (derived_permission_current(dentry))
+		return;
 	get_derived_permission_new(parent, dentry, &dentry->d_name);
 }
 
+/*
+ * Called after anything the derived state depends on has changed, before
+ * the cached dentries affected are fixed up. Every derivation that starts
+ * afterwards is redone instead of being taken from the cache.
+ */
+void sdcardfs_invalidate_perms(void)
+{
+	smp_wmb();
+	atomic_inc(&sdcardfs_perm_gen);
+}
+
 static appid_t get_type(const char *name)
 {
 	const char *ext = strrchr(name, '.');
@@ -23,19 +23,12 @@
 #include <linux/backing-dev.h>
 #endif
 
-static ssize_t sdcardfs_read(struct file *file, char __user *buf,
-			   size_t count, loff_t *ppos)
+/* pass the fadvise hint of the upper file on to the lower one */
+static void sdcardfs_copy_fadv(struct file *file, struct file *lower_file)
 {
-	int err;
-	struct file *lower_file;
-	struct dentry *dentry = file->f_path.dentry;
 #ifdef CONFIG_SDCARD_FS_FADV_NOACTIVE
 	struct backing_dev_info *bdi;
-#endif
 
-	lower_file = sdcardfs_lower_file(file);
-
-#ifdef CONFIG_SDCARD_FS_FADV_NOACTIVE
 	if (file->f_mode & FMODE_NOACTIVE) {
 		if (!(lower_file->f_mode & FMODE_NOACTIVE)) {
 			bdi = lower_file->f_mapping->backing_dev_info;
@@ -46,6 +39,29 @@ static ssize_t sdcardfs_read(struct file *file, char __user *buf,
 		}
 	}
 #endif
+}
+
+/* update our inode times+sizes upon a successful lower write */
+static void sdcardfs_copy_write_attrs(struct inode *inode,
+				      struct file *lower_file)
+{
+	if (sizeof(loff_t) > sizeof(long))
+		mutex_lock(&inode->i_mutex);
+	fsstack_copy_inode_size(inode, lower_file->f_path.dentry->d_inode);
+	fsstack_copy_attr_times(inode, lower_file->f_path.dentry->d_inode);
+	if (sizeof(loff_t) > sizeof(long))
+		mutex_unlock(&inode->i_mutex);
+}
+
+static ssize_t sdcardfs_read(struct file *file, char __user *buf,
+			   size_t count, loff_t *ppos)
+{
+	int err;
+	struct file *lower_file;
+	struct dentry *dentry = file->f_path.dentry;
+
+	lower_file = sdcardfs_lower_file(file);
+	sdcardfs_copy_fadv(file, lower_file);
 
 	err = vfs_read(lower_file, buf, count, ppos);
 	/* update our inode atime upon a successful lower read */
@@ -72,16 +88,113 @@ static ssize_t sdcardfs_write(struct file *file, const char __user *buf,
 
 	lower_file = sdcardfs_lower_file(file);
 	err = vfs_write(lower_file, buf, count, ppos);
-	/* update our inode times+sizes upon a successful lower write */
-	if (err >= 0) {
-		if (sizeof(loff_t) > sizeof(long))
-			mutex_lock(&inode->i_mutex);
-		fsstack_copy_inode_size(inode, lower_file->f_path.dentry->d_inode);
-		fsstack_copy_attr_times(inode, lower_file->f_path.dentry->d_inode);
-		if (sizeof(loff_t) > sizeof(long))
-			mutex_unlock(&inode->i_mutex);
+	if (err >= 0)
+		sdcardfs_copy_write_attrs(inode, lower_file);
+
+	return err;
+}
+
+/*
+ * The aio and splice methods hand the request to the lower file as it is,
+ * so that readv/writev, io_submit and sendfile run on the lower page cache
+ * in one pass instead of segment by segment through our ->read and ->write.
+ * The kiocb is pointed at the lower file for the duration of the call.
+ */
+static ssize_t sdcardfs_aio_read(struct kiocb *iocb, const struct iovec *iov,
+				 unsigned long nr_segs, loff_t pos)
+{
+	ssize_t err;
+	struct file *file = iocb->ki_filp;
+	struct file *lower_file;
+
+	lower_file = sdcardfs_lower_file(file);
+	if (!lower_file->f_op || !lower_file->f_op->aio_read)
+		return -EINVAL;
+
+	sdcardfs_copy_fadv(file, lower_file);
+
+	get_file(lower_file); /* prevent lower_file from being released */
+	iocb->ki_filp = lower_file;
+	err = lower_file->f_op->aio_read(iocb, iov, nr_segs, pos);
+	iocb->ki_filp = file;
+	fput(lower_file);
+
+	if (err >= 0 || err == -EIOCBQUEUED)
+		fsstack_copy_attr_atime(file->f_path.dentry->d_inode,
+					lower_file->f_path.dentry->d_inode);
+	return err;
+}
+
+static ssize_t sdcardfs_aio_write(struct kiocb *iocb, const struct iovec *iov,
+				  unsigned long nr_segs, loff_t pos)
+{
+	ssize_t err;
+	struct file *file = iocb->ki_filp;
+	struct dentry *dentry = file->f_path.dentry;
+	struct file *lower_file;
+
+	/* check disk space */
+	if (!check_min_free_space(dentry, iov_length(iov, nr_segs), 0)) {
+		pr_err("No minimum free space.\n");
+		return -ENOSPC;
 	}
 
+	lower_file = sdcardfs_lower_file(file);
+	if (!lower_file->f_op || !lower_file->f_op->aio_write)
+		return -EINVAL;
+
+	get_file(lower_file); /* prevent lower_file from being released */
+	iocb->ki_filp = lower_file;
+	err = lower_file->f_op->aio_write(iocb, iov, nr_segs, pos);
+	iocb->ki_filp = file;
+	fput(lower_file);
+
+	if (err >= 0 || err == -EIOCBQUEUED)
+		sdcardfs_copy_write_attrs(dentry->d_inode, lower_file);
+	return err;
+}
+
+static ssize_t sdcardfs_splice_read(struct file *file, loff_t *ppos,
+				    struct pipe_inode_info *pipe, size_t len,
+				    unsigned int flags)
+{
+	ssize_t err;
+	struct file *lower_file;
+
+	lower_file = sdcardfs_lower_file(file);
+	if (!lower_file->f_op || !lower_file->f_op->splice_read)
+		return -EINVAL;
+
+	sdcardfs_copy_fadv(file, lower_file);
+
+	err = lower_file->f_op->splice_read(lower_file, ppos, pipe, len, flags);
+	if (err >= 0)
+		fsstack_copy_attr_atime(file->f_path.dentry->d_inode,
+					lower_file->f_path.dentry->d_inode);
+	return err;
+}
+
+static ssize_t sdcardfs_splice_write(struct pipe_inode_info *pipe,
+				     struct file *file, loff_t *ppos,
+				     size_t len, unsigned int flags)
+{
+	ssize_t err;
+	struct dentry *dentry = file->f_path.dentry;
+	struct file *lower_file;
+
+	/* check disk space */
+	if (!check_min_free_space(dentry, len, 0)) {
+		pr_err("No minimum free space.\n");
+		return -ENOSPC;
+	}
+
+	lower_file = sdcardfs_lower_file(file);
+	if (!lower_file->f_op || !lower_file->f_op->splice_write)
+		return -EINVAL;
+
+	err = lower_file->f_op->splice_write(pipe, lower_file, ppos, len, flags);
+	if (err >= 0)
+		sdcardfs_copy_write_attrs(dentry->d_inode, lower_file);
 	return err;
 }
 
@@ -165,7 +278,6 @@ static int sdcardfs_mmap(struct file *file, struct vm_area_struct *vma)
 	int err = 0;
 	bool willwrite;
 	struct file *lower_file;
-	const struct vm_operations_struct *saved_vm_ops = NULL;
 
 	/* this might be deferred to mmap's writepage */
 	willwrite = ((vma->vm_flags | VM_SHARED | VM_WRITE) == vma->vm_flags);
@@ -188,33 +300,25 @@ static int sdcardfs_mmap(struct file *file, struct vm_area_struct *vma)
 	}
 
 	/*
-	 * find and save lower vm_ops.
-	 *
-	 * XXX: the VFS should have a cleaner way of finding the lower vm_ops
+	 * Let the lower file set the vma up with its own vm_ops, and hand
+	 * the vma over to it. Faults and page_mkwrite then go straight to
+	 * the lower mapping with no stop in this layer, and the vma sits in
+	 * the i_mmap tree of the lower mapping, where truncation of the
+	 * lower file finds it. mmap_region() put the reference it took on
+	 * our file into vm_file, so that one is swapped for the lower file.
 	 */
-	if (!SDCARDFS_F(file)->lower_vm_ops) {
-		err = lower_file->f_op->mmap(lower_file, vma);
-		if (err) {
-			pr_err("sdcardfs: lower mmap failed %d\n", err);
-			goto out;
-		}
-		saved_vm_ops = vma->vm_ops; /* save: came from lower ->mmap */
+	err = lower_file->f_op->mmap(lower_file, vma);
+	if (err) {
+		pr_err("sdcardfs: lower mmap failed %d\n", err);
+		goto out;
 	}
 
-	/*
-	 * Next 3 lines are all I need from generic_file_mmap.  I definitely
-	 * don't want its test for ->readpage which returns -ENOEXEC.
-	 */
 	file_accessed(file);
-	vma->vm_ops = &sdcardfs_vm_ops;
-	vma->vm_flags |= VM_CAN_NONLINEAR;
-
 	file->f_mapping->a_ops = &sdcardfs_aops; /* set our aops */
-	if (!SDCARDFS_F(file)->lower_vm_ops) /* save for our ->fault */
-		SDCARDFS_F(file)->lower_vm_ops = saved_vm_ops;
-	vma->vm_private_data = file;
+
 	get_file(lower_file);
 	vma->vm_file = lower_file;
+	fput(file);
 
 out:
 	return err;
@@ -365,6 +469,10 @@ const struct file_operations sdcardfs_main_fops = {
 	.llseek		= generic_file_llseek,
 	.read		= sdcardfs_read,
 	.write		= sdcardfs_write,
+	.aio_read	= sdcardfs_aio_read,
+	.aio_write	= sdcardfs_aio_write,
+	.splice_read	= sdcardfs_splice_read,
+	.splice_write	= sdcardfs_splice_write,
 	.unlocked_ioctl	= sdcardfs_unlocked_ioctl,
 #ifdef CONFIG_COMPAT
 	.compat_ioctl	= sdcardfs_compat_ioctl,
@@ -42,6 +42,9 @@ static DEFINE_HASHTABLE(package_to_appid, 8);
 static DEFINE_HASHTABLE(package_to_userid, 8);
 static DEFINE_HASHTABLE(ext_to_groupid, 8);
 
+/* bumped whenever the derived permissions of cached dentries may change */
+atomic_t sdcardfs_perm_gen = ATOMIC_INIT(1);
+
 
 static struct kmem_cache *hashtable_entry_cachep;
 
@@ -258,6 +261,7 @@ static void fixup_all_perms_name(const struct qstr *key)
 		.flags = BY_NAME,
 		.name = QSTR_INIT(key->name, key->len),
 	};
+	sdcardfs_invalidate_perms();
 	list_for_each_entry(sbinfo, &sdcardfs_super_list, list) {
 		if (sbinfo_has_sdcard_magic(sbinfo))
 			fixup_perms_recursive(sbinfo->sb->s_root, &limit);
@@ -272,6 +276,7 @@ static void fixup_all_perms_name_userid(const struct qstr *key, userid_t userid)
 		.name = QSTR_INIT(key->name, key->len),
 		.userid = userid,
 	};
+	sdcardfs_invalidate_perms();
 	list_for_each_entry(sbinfo, &sdcardfs_super_list, list) {
 		if (sbinfo_has_sdcard_magic(sbinfo))
 			fixup_perms_recursive(sbinfo->sb->s_root, &limit);
@@ -285,6 +290,7 @@ static void fixup_all_perms_userid(userid_t userid)
 		.flags = BY_USERID,
 		.userid = userid,
 	};
+	sdcardfs_invalidate_perms();
 	list_for_each_entry(sbinfo, &sdcardfs_super_list, list) {
 		if (sbinfo_has_sdcard_magic(sbinfo))
 			fixup_perms_recursive(sbinfo->sb->s_root, &limit);
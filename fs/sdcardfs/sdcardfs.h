@@ -160,7 +160,6 @@ extern const struct inode_operations sdcardfs_symlink_iops;
 extern const struct super_operations sdcardfs_sops;
 extern const struct dentry_operations sdcardfs_ci_dops;
 extern const struct address_space_operations sdcardfs_aops, sdcardfs_dummy_aops;
-extern const struct vm_operations_struct sdcardfs_vm_ops;
 
 extern int sdcardfs_init_inode_cache(void);
 extern void sdcardfs_destroy_inode_cache(void);
@@ -178,7 +177,6 @@ extern int sdcardfs_interpose(struct dentry *dentry, struct super_block *sb,
 /* file private data */
 struct sdcardfs_file_info {
 	struct file *lower_file;
-	const struct vm_operations_struct *lower_vm_ops;
 };
 
 struct sdcardfs_inode_data {
@@ -191,6 +189,9 @@ struct sdcardfs_inode_data {
 	bool under_android;
 	bool under_cache;
 	bool under_obb;
+
+	/* dentry the state above was last derived through */
+	struct dentry *perm_dentry;
 };
 
 /* sdcardfs inode data in memory */
@@ -212,6 +213,8 @@ struct sdcardfs_dentry_info {
 	spinlock_t lock;	/* protects lower_path */
 	struct path lower_path;
 	struct path orig_path;
+	/* package list generation the derived state was computed at */
+	unsigned int perm_gen;
 };
 
 struct sdcardfs_mount_options {
@@ -513,6 +516,7 @@ extern appid_t get_appid(const char *app_name);
 extern appid_t get_ext_gid(const char *app_name);
 extern appid_t is_excluded(const char *app_name, userid_t userid);
 extern int check_caller_access_to_name(struct inode *parent_node, const struct qstr *name);
+extern atomic_t sdcardfs_perm_gen;
 extern int packagelist_init(void);
 extern void packagelist_exit(void);
 
@@ -532,6 +536,7 @@ extern void get_derived_permission_new(struct dentry *parent, struct dentry *den
 extern void fixup_perms_recursive(struct dentry *dentry, struct limit_search *limit);
 
 extern void update_derived_permission_lock(struct dentry *dentry);
+extern void sdcardfs_invalidate_perms(void);
 void fixup_lower_ownership(struct dentry *dentry, const char *name);
 extern int need_graft_path(struct dentry *dentry);
 extern int is_base_obbpath(struct dentry *dentry);
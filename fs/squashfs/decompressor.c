@@ -25,6 +25,7 @@
 #include <linux/mutex.h>
 #include <linux/slab.h>
 #include <linux/buffer_head.h>
+#include <linux/percpu.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -52,6 +53,12 @@ static const struct squashfs_decompressor squashfs_xz_comp_ops = {
 };
 #endif
 
+#ifndef CONFIG_SQUASHFS_LZ4
+static const struct squashfs_decompressor squashfs_lz4_comp_ops = {
+	NULL, NULL, NULL, LZ4_COMPRESSION, "lz4", 0
+};
+#endif
+
 #ifndef CONFIG_SQUASHFS_ZLIB
 static const struct squashfs_decompressor squashfs_zlib_comp_ops = {
 	NULL, NULL, NULL, ZLIB_COMPRESSION, "zlib", 0
@@ -66,6 +73,7 @@ static const struct squashfs_decompressor *decompressor[] = {
 	&squashfs_zlib_comp_ops,
 	&squashfs_lzo_comp_ops,
 	&squashfs_xz_comp_ops,
+	&squashfs_lz4_comp_ops,
 	&squashfs_lzma_unsupported_comp_ops,
 	&squashfs_unknown_comp_ops
 };
@@ -83,11 +91,17 @@ const struct squashfs_decompressor *squashfs_lookup_decompressor(int id)
 }
 
 
-void *squashfs_decompressor_init(struct super_block *sb, unsigned short flags)
+/*
+ * Decompressor streams are either one per mount, serialised by
+ * read_data_mutex, or with "threads=percpu" one per possible cpu, used
+ * with preemption disabled.  The wrappers therefore must not sleep, the
+ * buffers are waited on by squashfs_read_data() before they are called.
+ */
+int squashfs_decompressor_setup(struct super_block *sb, unsigned short flags)
 {
 	struct squashfs_sb_info *msblk = sb->s_fs_info;
 	void *strm, *buffer = NULL;
-	int length = 0;
+	int length = 0, err = 0, cpu;
 
 	/*
 	 * Read decompressor specific options from file system if present
@@ -95,22 +109,86 @@ void *squashfs_decompressor_init(struct super_block *sb, unsigned short flags)
 	if (SQUASHFS_COMP_OPTS(flags)) {
 		buffer = kmalloc(PAGE_CACHE_SIZE, GFP_KERNEL);
 		if (buffer == NULL)
-			return ERR_PTR(-ENOMEM);
+			return -ENOMEM;
 
 		length = squashfs_read_data(sb, &buffer,
 			sizeof(struct squashfs_super_block), 0, NULL,
 			PAGE_CACHE_SIZE, 1);
 
 		if (length < 0) {
-			strm = ERR_PTR(length);
+			err = length;
 			goto finished;
 		}
 	}
 
-	strm = msblk->decompressor->init(msblk, buffer, length);
+	if (!msblk->percpu) {
+		strm = msblk->decompressor->init(msblk, buffer, length);
+		if (IS_ERR(strm))
+			err = PTR_ERR(strm);
+		else
+			msblk->stream = strm;
+		goto finished;
+	}
+
+	msblk->percpu_stream = alloc_percpu(void *);
+	if (msblk->percpu_stream == NULL) {
+		err = -ENOMEM;
+		goto finished;
+	}
+
+	for_each_possible_cpu(cpu) {
+		strm = msblk->decompressor->init(msblk, buffer, length);
+		if (IS_ERR(strm)) {
+			err = PTR_ERR(strm);
+			squashfs_decompressor_destroy(msblk);
+			break;
+		}
+		*per_cpu_ptr(msblk->percpu_stream, cpu) = strm;
+	}
 
 finished:
 	kfree(buffer);
 
-	return strm;
+	return err;
+}
+
+
+void squashfs_decompressor_destroy(struct squashfs_sb_info *msblk)
+{
+	int cpu;
+
+	if (msblk->percpu_stream) {
+		for_each_possible_cpu(cpu)
+			msblk->decompressor->free(
+				*per_cpu_ptr(msblk->percpu_stream, cpu));
+		free_percpu(msblk->percpu_stream);
+		msblk->percpu_stream = NULL;
+	} else if (msblk->stream) {
+		msblk->decompressor->free(msblk->stream);
+		msblk->stream = NULL;
+	}
+}
+
+
+int squashfs_decompress(struct squashfs_sb_info *msblk, void **buffer,
+	struct buffer_head **bh, int b, int offset, int length, int srclength,
+	int pages)
+{
+	void **strm;
+	int res;
+
+	if (msblk->percpu_stream == NULL) {
+		mutex_lock(&msblk->read_data_mutex);
+		res = msblk->decompressor->decompress(msblk, msblk->stream,
+			buffer, bh, b, offset, length, srclength, pages);
+		mutex_unlock(&msblk->read_data_mutex);
+		return res;
+	}
+
+	strm = get_cpu_ptr(msblk->percpu_stream);
+	res = msblk->decompressor->decompress(msblk, *strm, buffer, bh, b,
+		offset, length, srclength, pages);
+	put_cpu_ptr(msblk->percpu_stream);
+
+	return res;
 }
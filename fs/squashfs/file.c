@@ -371,6 +371,90 @@ static int read_blocklist(struct inode *inode, int index, u64 *block)
 }
 
 
+/*
+ * Decompress a datablock straight into the page cache pages it covers,
+ * which saves the copy out of the read_page cache and the wait for its
+ * single entry.  That is only done when every one of those pages can be
+ * grabbed and none of them is uptodate, otherwise -EAGAIN tells the
+ * caller to go through the cache.  On success all pages, the one
+ * readpage was called for included, are unlocked.
+ */
+static int squashfs_readpage_block(struct page *target_page, u64 block,
+	int bsize)
+{
+	struct inode *inode = target_page->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int mask = (1 << (msblk->block_log - PAGE_CACHE_SHIFT)) - 1;
+	int start_index = target_page->index & ~mask;
+	int end_index = min_t(int, start_index | mask,
+		(i_size_read(inode) - 1) >> PAGE_CACHE_SHIFT);
+	int pages = end_index - start_index + 1;
+	int i, offset, missing = 0, res = -EAGAIN;
+	struct page **page;
+	void **pageaddr;
+
+	page = kcalloc(pages, sizeof(*page), GFP_KERNEL);
+	pageaddr = kcalloc(pages, sizeof(*pageaddr), GFP_KERNEL);
+	if (page == NULL || pageaddr == NULL)
+		goto out;
+
+	for (i = 0; i < pages; i++) {
+		if (start_index + i == target_page->index) {
+			page[i] = target_page;
+			continue;
+		}
+
+		page[i] = grab_cache_page_nowait(target_page->mapping,
+							start_index + i);
+		if (page[i] == NULL || PageUptodate(page[i]))
+			missing++;
+	}
+
+	if (missing)
+		goto release_pages;
+
+	for (i = 0; i < pages; i++)
+		pageaddr[i] = kmap(page[i]);
+
+	res = squashfs_read_data(inode->i_sb, pageaddr, block, bsize, NULL,
+		pages << PAGE_CACHE_SHIFT, pages);
+
+	/* the last page is only partly covered at the end of the file */
+	if (res >= 0) {
+		for (i = res >> PAGE_CACHE_SHIFT, offset = res & ~PAGE_CACHE_MASK;
+				i < pages; i++, offset = 0)
+			memset(pageaddr[i] + offset, 0,
+				PAGE_CACHE_SIZE - offset);
+	}
+
+	for (i = 0; i < pages; i++) {
+		kunmap(page[i]);
+		if (res < 0)
+			continue;
+		flush_dcache_page(page[i]);
+		SetPageUptodate(page[i]);
+	}
+
+	if (res >= 0) {
+		unlock_page(target_page);
+		res = 0;
+	}
+
+release_pages:
+	for (i = 0; i < pages; i++) {
+		if (page[i] == NULL || page[i] == target_page)
+			continue;
+		unlock_page(page[i]);
+		page_cache_release(page[i]);
+	}
+
+out:
+	kfree(pageaddr);
+	kfree(page);
+	return res;
+}
+
+
 static int squashfs_readpage(struct file *file, struct page *page)
 {
 	struct inode *inode = page->mapping->host;
@@ -409,6 +493,13 @@ static int squashfs_readpage(struct file *file, struct page *page)
 				 msblk->block_size;
 			sparse = 1;
 		} else {
+			int res = squashfs_readpage_block(page, block, bsize);
+
+			if (res == 0)
+				return 0;
+			if (res != -EAGAIN)
+				goto error_out;
+
 			/*
 			 * Read and decompress datablock.
 			 */
@@ -36,6 +36,8 @@
 #include <linux/module.h>
 #include <linux/magic.h>
 #include <linux/xattr.h>
+#include <linux/parser.h>
+#include <linux/seq_file.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -47,6 +49,46 @@
 static struct file_system_type squashfs_fs_type;
 static const struct super_operations squashfs_super_ops;
 
+enum {
+	Opt_threads_single, Opt_threads_percpu, Opt_err
+};
+
+static const match_table_t tokens = {
+	{Opt_threads_single, "threads=single"},
+	{Opt_threads_percpu, "threads=percpu"},
+	{Opt_err, NULL}
+};
+
+static int squashfs_parse_options(struct squashfs_sb_info *msblk,
+	char *options)
+{
+	substring_t args[MAX_OPT_ARGS];
+	char *p;
+
+	if (!options)
+		return 0;
+
+	while ((p = strsep(&options, ",")) != NULL) {
+		if (!*p)
+			continue;
+
+		switch (match_token(p, tokens, args)) {
+		case Opt_threads_single:
+			msblk->percpu = false;
+			break;
+		case Opt_threads_percpu:
+			msblk->percpu = true;
+			break;
+		default:
+			ERROR("Unrecognized mount option \"%s\"\n", p);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+
 static const struct squashfs_decompressor *supported_squashfs_filesystem(short
 	major, short minor, short id)
 {
@@ -101,6 +143,13 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 	mutex_init(&msblk->read_data_mutex);
 	mutex_init(&msblk->meta_index_mutex);
 
+	err = squashfs_parse_options(msblk, data);
+	if (err) {
+		kfree(sb->s_fs_info);
+		sb->s_fs_info = NULL;
+		return err;
+	}
+
 	/*
 	 * msblk->bytes_used is checked in squashfs_read_table to ensure reads
 	 * are not beyond filesystem end.  But as we're using
@@ -212,12 +261,9 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 		goto failed_mount;
 	}
 
-	msblk->stream = squashfs_decompressor_init(sb, flags);
-	if (IS_ERR(msblk->stream)) {
-		err = PTR_ERR(msblk->stream);
-		msblk->stream = NULL;
+	err = squashfs_decompressor_setup(sb, flags);
+	if (err)
 		goto failed_mount;
-	}
 
 	/* Handle xattrs */
 	sb->s_xattr = squashfs_xattr_handlers;
@@ -336,7 +382,7 @@ failed_mount:
 	squashfs_cache_delete(msblk->block_cache);
 	squashfs_cache_delete(msblk->fragment_cache);
 	squashfs_cache_delete(msblk->read_page);
-	squashfs_decompressor_free(msblk, msblk->stream);
+	squashfs_decompressor_destroy(msblk);
 	kfree(msblk->inode_lookup_table);
 	kfree(msblk->fragment_index);
 	kfree(msblk->id_table);
@@ -369,6 +415,17 @@ static int squashfs_statfs(struct dentry *dentry, struct kstatfs *buf)
 }
 
 
+static int squashfs_show_options(struct seq_file *seq, struct dentry *root)
+{
+	struct squashfs_sb_info *msblk = root->d_sb->s_fs_info;
+
+	if (msblk->percpu)
+		seq_puts(seq, ",threads=percpu");
+
+	return 0;
+}
+
+
 static int squashfs_remount(struct super_block *sb, int *flags, char *data)
 {
 	*flags |= MS_RDONLY;
@@ -383,7 +440,7 @@ static void squashfs_put_super(struct super_block *sb)
 		squashfs_cache_delete(sbi->block_cache);
 		squashfs_cache_delete(sbi->fragment_cache);
 		squashfs_cache_delete(sbi->read_page);
-		squashfs_decompressor_free(sbi, sbi->stream);
+		squashfs_decompressor_destroy(sbi);
 		kfree(sbi->id_table);
 		kfree(sbi->fragment_index);
 		kfree(sbi->meta_index);
@@ -489,6 +546,7 @@ static const struct super_operations squashfs_super_ops = {
 	.alloc_inode = squashfs_alloc_inode,
 	.destroy_inode = squashfs_destroy_inode,
 	.statfs = squashfs_statfs,
+	.show_options = squashfs_show_options,
 	.put_super = squashfs_put_super,
 	.remount_fs = squashfs_remount
 };
@@ -296,10 +296,10 @@ static void yaffs_handle_chunk_wr_error(struct yaffs_dev *dev, int nand_chunk,
  *  Simple hash function. Needs to have a reasonable spread
  */
 
-static inline int yaffs_hash_fn(int n)
+static inline int yaffs_hash_fn(struct yaffs_dev *dev, int n)
 {
 	n = abs(n);
-	return n % YAFFS_NOBJECT_BUCKETS;
+	return n & (dev->n_obj_buckets - 1);
 }
 
 /*
@@ -742,9 +742,24 @@ static void yaffs_free_tnode(struct yaffs_dev *dev, struct yaffs_tnode *tn)
 	dev->checkpoint_blocks_required = 0;	/* force recalculation */
 }
 
+static void yaffs_free_obj_buckets(struct yaffs_dev *dev)
+{
+	if (dev->obj_bucket != dev->obj_bucket_initial) {
+		if (dev->obj_bucket_alt)
+			vfree(dev->obj_bucket);
+		else
+			kfree(dev->obj_bucket);
+	}
+
+	dev->obj_bucket_alt = 0;
+	dev->obj_bucket = dev->obj_bucket_initial;
+	dev->n_obj_buckets = YAFFS_NOBJECT_BUCKETS;
+}
+
 static void yaffs_deinit_tnodes_and_objs(struct yaffs_dev *dev)
 {
 	yaffs_deinit_raw_tnodes_and_objs(dev);
+	yaffs_free_obj_buckets(dev);
 	dev->n_obj = 0;
 	dev->n_tnodes = 0;
 }
@@ -1645,7 +1660,7 @@ static void yaffs_unhash_obj(struct yaffs_obj *obj)
 	/* If it is still linked into the bucket list, free from the list */
 	if (!list_empty(&obj->hash_link)) {
 		list_del_init(&obj->hash_link);
-		bucket = yaffs_hash_fn(obj->obj_id);
+		bucket = yaffs_hash_fn(dev, obj->obj_id);
 		dev->obj_bucket[bucket].count--;
 	}
 }
@@ -1892,7 +1907,7 @@ static int yaffs_find_nice_bucket(struct yaffs_dev *dev)
 
 	for (i = 0; i < 10 && lowest > 4; i++) {
 		dev->bucket_finder++;
-		dev->bucket_finder %= YAFFS_NOBJECT_BUCKETS;
+		dev->bucket_finder &= dev->n_obj_buckets - 1;
 		if (dev->obj_bucket[dev->bucket_finder].count < lowest) {
 			lowest = dev->obj_bucket[dev->bucket_finder].count;
 			l = dev->bucket_finder;
@@ -1920,7 +1935,7 @@ static int yaffs_new_obj_id(struct yaffs_dev *dev)
 
 	while (!found) {
 		found = 1;
-		n += YAFFS_NOBJECT_BUCKETS;
+		n += dev->n_obj_buckets;
 		if (1 || dev->obj_bucket[bucket].count > 0) {
 			list_for_each(i, &dev->obj_bucket[bucket].list) {
 				/* If there is already one in the list */
@@ -1935,18 +1950,87 @@ static int yaffs_new_obj_id(struct yaffs_dev *dev)
 	return n;
 }
 
+/*
+ * Double the object hash and move every object over. Lookups on a big
+ * partition would otherwise walk chains of hundreds of objects. If the
+ * memory isn't there we just carry on with the table we have.
+ */
+static void yaffs_grow_obj_hash(struct yaffs_dev *dev)
+{
+	struct yaffs_obj_bucket *old_bucket = dev->obj_bucket;
+	u32 old_n = dev->n_obj_buckets;
+	unsigned old_alt = dev->obj_bucket_alt;
+	struct yaffs_obj_bucket *new_bucket;
+	u32 new_n = old_n * 2;
+	unsigned new_alt = 0;
+	struct yaffs_obj *obj;
+	struct list_head *lh;
+	struct list_head *n;
+	u32 i;
+	int bucket;
+
+	new_bucket = kmalloc(new_n * sizeof(*new_bucket), GFP_NOFS);
+	if (!new_bucket) {
+		new_bucket = vmalloc(new_n * sizeof(*new_bucket));
+		new_alt = 1;
+	}
+	if (!new_bucket) {
+		yaffs_trace(YAFFS_TRACE_ALLOCATE,
+			"Could not grow object hash to %u buckets", new_n);
+		return;
+	}
+
+	for (i = 0; i < new_n; i++) {
+		INIT_LIST_HEAD(&new_bucket[i].list);
+		new_bucket[i].count = 0;
+	}
+
+	dev->obj_bucket = new_bucket;
+	dev->n_obj_buckets = new_n;
+	dev->obj_bucket_alt = new_alt;
+
+	for (i = 0; i < old_n; i++) {
+		list_for_each_safe(lh, n, &old_bucket[i].list) {
+			obj = list_entry(lh, struct yaffs_obj, hash_link);
+			bucket = yaffs_hash_fn(dev, obj->obj_id);
+			list_move(&obj->hash_link, &new_bucket[bucket].list);
+			new_bucket[bucket].count++;
+		}
+	}
+
+	if (old_bucket != dev->obj_bucket_initial) {
+		if (old_alt)
+			vfree(old_bucket);
+		else
+			kfree(old_bucket);
+	}
+
+	yaffs_trace(YAFFS_TRACE_ALLOCATE,
+		"Object hash grown to %u buckets for %d objects",
+		new_n, dev->n_obj);
+}
+
+/*
+ * Must not be called while walking the hash, a new object may make it
+ * grow and move everything to other buckets.
+ */
 static void yaffs_hash_obj(struct yaffs_obj *in)
 {
-	int bucket = yaffs_hash_fn(in->obj_id);
 	struct yaffs_dev *dev = in->my_dev;
+	int bucket;
+
+	if (dev->n_obj_buckets < YAFFS_MAX_NOBJECT_BUCKETS &&
+	    dev->n_obj > dev->n_obj_buckets * YAFFS_OBJECT_BUCKET_LOAD)
+		yaffs_grow_obj_hash(dev);
 
+	bucket = yaffs_hash_fn(dev, in->obj_id);
 	list_add(&in->hash_link, &dev->obj_bucket[bucket].list);
 	dev->obj_bucket[bucket].count++;
 }
 
 struct yaffs_obj *yaffs_find_by_number(struct yaffs_dev *dev, u32 number)
 {
-	int bucket = yaffs_hash_fn(number);
+	int bucket = yaffs_hash_fn(dev, number);
 	struct list_head *i;
 	struct yaffs_obj *in;
 
@@ -2056,7 +2140,10 @@ static void yaffs_init_tnodes_and_objs(struct yaffs_dev *dev)
 
 	yaffs_init_raw_tnodes_and_objs(dev);
 
-	for (i = 0; i < YAFFS_NOBJECT_BUCKETS; i++) {
+	dev->obj_bucket = dev->obj_bucket_initial;
+	dev->n_obj_buckets = YAFFS_NOBJECT_BUCKETS;
+	dev->obj_bucket_alt = 0;
+	for (i = 0; i < dev->n_obj_buckets; i++) {
 		INIT_LIST_HEAD(&dev->obj_bucket[i].list);
 		dev->obj_bucket[i].count = 0;
 	}
@@ -4383,7 +4470,7 @@ static void yaffs_fix_hanging_objs(struct yaffs_dev *dev)
 	 * Make sure it is rooted.
 	 */
 
-	for (i = 0; i < YAFFS_NOBJECT_BUCKETS; i++) {
+	for (i = 0; i < dev->n_obj_buckets; i++) {
 		list_for_each_safe(lh, n, &dev->obj_bucket[i].list) {
 			if (lh) {
 				obj =
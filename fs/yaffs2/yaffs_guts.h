@@ -55,7 +55,14 @@
 #define YAFFS_ALLOCATION_NTNODES	100
 #define YAFFS_ALLOCATION_NLINKS		100
 
+/*
+ * The object hash starts with YAFFS_NOBJECT_BUCKETS buckets and doubles
+ * whenever the average chain gets longer than YAFFS_OBJECT_BUCKET_LOAD,
+ * up to YAFFS_MAX_NOBJECT_BUCKETS. Both sizes must be powers of 2.
+ */
 #define YAFFS_NOBJECT_BUCKETS		256
+#define YAFFS_MAX_NOBJECT_BUCKETS	16384
+#define YAFFS_OBJECT_BUCKET_LOAD	4
 
 #define YAFFS_OBJECT_SPACE		0x40000
 #define YAFFS_MAX_OBJECT_ID		(YAFFS_OBJECT_SPACE -1)
@@ -653,7 +660,10 @@ struct yaffs_dev {
 
 	int n_hardlinks;
 
-	struct yaffs_obj_bucket obj_bucket[YAFFS_NOBJECT_BUCKETS];
+	struct yaffs_obj_bucket *obj_bucket;
+	u32 n_obj_buckets;
+	unsigned obj_bucket_alt:1;	/* was allocated using alternative strategy */
+	struct yaffs_obj_bucket obj_bucket_initial[YAFFS_NOBJECT_BUCKETS];
 	u32 bucket_finder;
 
 	int n_free_chunks;
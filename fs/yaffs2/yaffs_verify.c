@@ -412,7 +412,7 @@ void yaffs_verify_objects(struct yaffs_dev *dev)
 
 	/* Iterate through the objects in each hash entry */
 
-	for (i = 0; i < YAFFS_NOBJECT_BUCKETS; i++) {
+	for (i = 0; i < dev->n_obj_buckets; i++) {
 		list_for_each(lh, &dev->obj_bucket[i].list) {
 			if (lh) {
 				obj =
@@ -566,7 +566,7 @@ static int yaffs2_wr_checkpt_objs(struct yaffs_dev *dev)
 	 * dumping them to the checkpointing stream.
 	 */
 
-	for (i = 0; ok && i < YAFFS_NOBJECT_BUCKETS; i++) {
+	for (i = 0; ok && i < dev->n_obj_buckets; i++) {
 		list_for_each(lh, &dev->obj_bucket[i].list) {
 			if (lh) {
 				obj =
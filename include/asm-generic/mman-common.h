@@ -52,6 +52,9 @@
 					   overrides the coredump filter bits */
 #define MADV_DODUMP	17		/* Clear the MADV_NODUMP flag */
 
+#define MADV_HOTPIN	18		/* Keep the file's page cache from reclaim */
+#define MADV_NOHOTPIN	19		/* Clear the MADV_HOTPIN mark */
+
 /* compatibility flags */
 #define MAP_FILE	0
 
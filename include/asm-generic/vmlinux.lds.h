@@ -640,6 +640,11 @@
 		*(.con_initcall.init)					\
 		VMLINUX_SYMBOL(__con_initcall_end) = .;
 
+#define DEFERRED_INITCALL						\
+		VMLINUX_SYMBOL(__deferred_initcall_start) = .;		\
+		*(.initcall_deferred.init)				\
+		VMLINUX_SYMBOL(__deferred_initcall_end) = .;
+
 #define SECURITY_INITCALL						\
 		VMLINUX_SYMBOL(__security_initcall_start) = .;		\
 		*(.security_initcall.init)				\
@@ -791,6 +796,7 @@
 		INIT_DATA						\
 		INIT_SETUP(initsetup_align)				\
 		INIT_CALLS						\
+		DEFERRED_INITCALL					\
 		CON_INITCALL						\
 		SECURITY_INITCALL					\
 		INIT_RAM_FS						\
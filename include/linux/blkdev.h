@@ -130,9 +130,12 @@ struct request {
 	struct gendisk *rq_disk;
 	struct hd_struct *part;
 	unsigned long start_time;
-#ifdef CONFIG_BLK_CGROUP
+#if defined(CONFIG_BLK_CGROUP) || defined(CONFIG_BLK_LATENCY_HIST)
 	unsigned long long start_time_ns;
 	unsigned long long io_start_time_ns;    /* when passed to hardware */
+#endif
+#ifdef CONFIG_BLK_LATENCY_HIST
+	unsigned int io_start_bytes;		/* size when passed to hardware */
 #endif
 	/* Number of scatter-gather DMA addr+len pairs after
 	 * physical address coalescing is performed.
@@ -400,6 +403,10 @@ struct request_queue {
 	/* Throttle data */
 	struct throtl_data *td;
 #endif
+
+#ifdef CONFIG_BLK_LATENCY_HIST
+	struct blk_latency_hist __percpu *latency_hist;
+#endif
 };
 
 #define QUEUE_FLAG_QUEUED	1	/* uses generic tag queueing */
@@ -1166,7 +1173,7 @@ static inline void put_dev_sector(Sector p)
 struct work_struct;
 int kblockd_schedule_work(struct request_queue *q, struct work_struct *work);
 
-#ifdef CONFIG_BLK_CGROUP
+#if defined(CONFIG_BLK_CGROUP) || defined(CONFIG_BLK_LATENCY_HIST)
 /*
  * This should not be using sched_clock(). A real patch is in progress
  * to fix this up, until that is in place we need to disable preemption
@@ -1184,6 +1191,9 @@ static inline void set_io_start_time_ns(struct request *req)
 	preempt_disable();
 	req->io_start_time_ns = sched_clock();
 	preempt_enable();
+#ifdef CONFIG_BLK_LATENCY_HIST
+	req->io_start_bytes = blk_rq_bytes(req);
+#endif
 }
 
 static inline uint64_t rq_start_time_ns(struct request *req)
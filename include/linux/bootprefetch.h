@@ -0,0 +1,37 @@
+/*
+ * include/linux/bootprefetch.h
+ *
+ * Record the file pages read during boot and replay them as large sorted
+ * readahead batches on the next boot.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LINUX_BOOTPREFETCH_H
+#define _LINUX_BOOTPREFETCH_H
+
+#include <linux/types.h>
+
+struct file;
+
+#ifdef CONFIG_BOOT_PREFETCH
+extern bool boot_prefetch_recording;
+
+void __boot_prefetch_record(struct file *file, pgoff_t index,
+			    unsigned long nr);
+
+/* called from the read and fault paths for every page range accessed */
+static inline void boot_prefetch_record(struct file *file, pgoff_t index,
+					unsigned long nr)
+{
+	if (unlikely(boot_prefetch_recording))
+		__boot_prefetch_record(file, index, nr);
+}
+#else
+static inline void boot_prefetch_record(struct file *file, pgoff_t index,
+					unsigned long nr) {}
+#endif
+
+#endif /* _LINUX_BOOTPREFETCH_H */
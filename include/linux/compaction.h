@@ -90,6 +90,17 @@ static inline bool compaction_deferred(struct zone *zone, int order)
 
 #endif /* CONFIG_COMPACTION */
 
+#ifdef CONFIG_COMPACTION_BACKGROUND
+extern int sysctl_compaction_reserve_order;
+extern int sysctl_compaction_reserve_blocks;
+/* called after a high-order allocation from @zone */
+extern void wakeup_kcompactd(struct zone *zone, int order);
+#else
+static inline void wakeup_kcompactd(struct zone *zone, int order)
+{
+}
+#endif
+
 #if defined(CONFIG_COMPACTION) && defined(CONFIG_SYSFS) && defined(CONFIG_NUMA)
 extern int compaction_register_node(struct node *node);
 extern void compaction_unregister_node(struct node *node);
@@ -0,0 +1,40 @@
+/*
+ * include/linux/cpufreq_input_boost.h
+ *
+ * Frequency floor and minimum online cpus on touch and key input, shared
+ * by the cpufreq governors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LINUX_CPUFREQ_INPUT_BOOST_H
+#define _LINUX_CPUFREQ_INPUT_BOOST_H
+
+struct cpufreq_policy;
+
+#ifdef CONFIG_CPU_FREQ_INPUT_BOOST
+/*
+ * Governors that honour the boost bracket their lifetime on a policy with
+ * cpufreq_input_boost_start()/cpufreq_input_boost_stop(). The boost then
+ * raises such a policy to the floor as soon as input arrives, and the
+ * governor must not choose anything below cpufreq_input_boost_freq()
+ * until the boost runs out.
+ */
+void cpufreq_input_boost_start(struct cpufreq_policy *policy);
+void cpufreq_input_boost_stop(struct cpufreq_policy *policy);
+
+/* frequency floor in kHz while a boost is active, 0 otherwise */
+unsigned int cpufreq_input_boost_freq(void);
+#else
+static inline void cpufreq_input_boost_start(struct cpufreq_policy *policy) {}
+static inline void cpufreq_input_boost_stop(struct cpufreq_policy *policy) {}
+
+static inline unsigned int cpufreq_input_boost_freq(void)
+{
+	return 0;
+}
+#endif
+
+#endif /* _LINUX_CPUFREQ_INPUT_BOOST_H */
@@ -0,0 +1,51 @@
+/*
+ * include/linux/cpufreq_task_stats.h
+ *
+ * Per-task cpu time at each cpu frequency, maintained by cpufreq_stats.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LINUX_CPUFREQ_TASK_STATS_H
+#define _LINUX_CPUFREQ_TASK_STATS_H
+
+#include <linux/types.h>
+#include <asm/cputime.h>
+
+struct pid;
+struct pid_namespace;
+struct seq_file;
+struct task_struct;
+
+#ifdef CONFIG_CPU_FREQ_STAT_TASK
+/*
+ * Frequencies of every policy share one index space, so that the arrays of
+ * tasks running on different policies can be summed per uid. A task's
+ * array is sized when it forks; tasks forked before the cpufreq driver
+ * registered its tables are not accounted.
+ */
+unsigned int cpufreq_task_stats_nr_freqs(void);
+unsigned int cpufreq_task_stats_freq(unsigned int index);
+/* index of the frequency @cpu runs at, or -1 */
+int cpufreq_task_stats_index(unsigned int cpu);
+
+void cpufreq_task_stats_init(struct task_struct *p);
+void cpufreq_task_stats_alloc(struct task_struct *p);
+void cpufreq_task_stats_free(struct task_struct *p);
+
+/* called from the tick with the cpu time just charged to @p */
+void cpufreq_task_stats_account(struct task_struct *p, cputime_t cputime);
+
+int proc_time_in_state_show(struct seq_file *m, struct pid_namespace *ns,
+			    struct pid *pid, struct task_struct *p);
+#else
+static inline void cpufreq_task_stats_init(struct task_struct *p) {}
+static inline void cpufreq_task_stats_alloc(struct task_struct *p) {}
+static inline void cpufreq_task_stats_free(struct task_struct *p) {}
+static inline void cpufreq_task_stats_account(struct task_struct *p,
+					      cputime_t cputime) {}
+#endif
+
+#endif /* _LINUX_CPUFREQ_TASK_STATS_H */
@@ -180,6 +180,18 @@ extern int bus_unregister_notifier(struct bus_type *bus,
 extern struct kset *bus_get_kset(struct bus_type *bus);
 extern struct klist *bus_get_device_klist(struct bus_type *bus);
 
+/*
+ * A driver registered during boot with PROBE_PREFER_ASYNCHRONOUS has its
+ * devices probed from the async pool, so a slow probe no longer holds up
+ * the initcalls behind it. Only for drivers nothing else looks for
+ * before wait_for_device_probe() or the start of init; devices added
+ * after the driver are still probed synchronously.
+ */
+enum probe_type {
+	PROBE_DEFAULT_STRATEGY,
+	PROBE_PREFER_ASYNCHRONOUS,
+};
+
 /**
  * struct device_driver - The basic device driver structure
  * @name:	Name of the device driver.
@@ -187,6 +199,7 @@ extern struct klist *bus_get_device_klist(struct bus_type *bus);
  * @owner:	The module owner.
  * @mod_name:	Used for built-in modules.
  * @suppress_bind_attrs: Disables bind/unbind via sysfs.
+ * @probe_type: Whether the devices may be probed asynchronously at boot.
  * @of_match_table: The open firmware table.
  * @probe:	Called to query the existence of a specific device,
  *		whether this driver can work with it, and bind the driver
@@ -219,6 +232,7 @@ struct device_driver {
 	const char		*mod_name;	/* used for built-in modules */
 
 	bool suppress_bind_attrs;	/* disables bind/unbind via sysfs */
+	enum probe_type probe_type;
 
 	const struct of_device_id	*of_match_table;
 
@@ -0,0 +1,69 @@
+/*
+ * include/linux/dvfs_monitor.h
+ *
+ * Records read from /dev/dvfs_mon, one per change of the cpu frequency,
+ * the online cpus, the GPU load or the temperature.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LINUX_DVFS_MONITOR_H
+#define _LINUX_DVFS_MONITOR_H
+
+#include <linux/types.h>
+
+#define DVFS_MON_VERSION	1
+#define DVFS_MON_MAX_CPUS	8
+
+/* what caused the record, in dvfs_mon_record.events */
+#define DVFS_MON_EV_FREQ	(1 << 0)
+#define DVFS_MON_EV_HOTPLUG	(1 << 1)
+#define DVFS_MON_EV_GPU		(1 << 2)
+#define DVFS_MON_EV_TEMP	(1 << 3)
+
+#define DVFS_MON_UNKNOWN	0xffffffff
+
+struct dvfs_mon_cpu {
+	__u32	freq;		/* kHz */
+	__u8	online;
+	__u8	load;		/* busy percent since the record before */
+	__u16	reserved;
+};
+
+/*
+ * A read blocks until there is a record newer than the reader's last
+ * one and returns only the latest, the gap in seq tells how many were
+ * skipped. poll() reports POLLIN when a read would not block. Fields a
+ * newer version adds go at the end, readers check version and size.
+ */
+struct dvfs_mon_record {
+	__u32	version;
+	__u32	size;
+	__u64	time_ns;
+	__u32	seq;
+	__u32	events;
+	__u32	nr_running;
+	__u32	gpu_load;	/* percent, or DVFS_MON_UNKNOWN */
+	__u32	temp;		/* celsius, or DVFS_MON_UNKNOWN */
+	__u32	nr_cpus;
+	struct dvfs_mon_cpu cpu[DVFS_MON_MAX_CPUS];
+};
+
+#ifdef __KERNEL__
+#ifdef CONFIG_CPU_FREQ_DVFS_MONITOR
+void dvfs_monitor_report_gpu(unsigned int load);
+void dvfs_monitor_report_temp(unsigned int temp);
+#else
+static inline void dvfs_monitor_report_gpu(unsigned int load)
+{
+}
+
+static inline void dvfs_monitor_report_temp(unsigned int temp)
+{
+}
+#endif
+#endif /* __KERNEL__ */
+
+#endif /* _LINUX_DVFS_MONITOR_H */
@@ -16,6 +16,7 @@
 
 /* For O_CLOEXEC */
 #include <linux/fcntl.h>
+#include <linux/ioctl.h>
 #include <linux/types.h>
 
 /* Flags for epoll_create1.  */
@@ -26,6 +27,13 @@
 #define EPOLL_CTL_DEL 2
 #define EPOLL_CTL_MOD 3
 
+/*
+ * Set exclusive wakeup mode for the target file descriptor. When several
+ * epoll descriptors watch the same file with it, an event wakes one of
+ * their waiters rather than all of them. Only valid with EPOLL_CTL_ADD.
+ */
+#define EPOLLEXCLUSIVE (1 << 28)
+
 /*
  * Request the handling of system wakeup events so as to prevent system suspends
  * from happening while those events are being processed.
@@ -61,6 +69,34 @@ struct epoll_event {
 	__u64 data;
 } EPOLL_PACKED;
 
+/*
+ * Parameters of an epoll descriptor, set and read with ioctl() on it.
+ *
+ * coalesce_usecs: once a waiter was woken by an event, it keeps gathering
+ * events for up to this long before returning them, so that descriptors
+ * becoming ready together cost one wakeup. Bounded by the wait's own
+ * timeout and by EPOLL_MAX_COALESCE_USECS, 0 disables it.
+ */
+struct epoll_params {
+	__u32 coalesce_usecs;
+	__u32 __pad;
+};
+
+#define EPOLL_MAX_COALESCE_USECS	10000
+
+/* counters of an epoll descriptor since it was created */
+struct epoll_stats {
+	__u64 wakeups;		/* waiters woken by ready files */
+	__u64 waits;		/* times epoll_wait() had to sleep */
+	__u64 coalesced;	/* wakeups followed by a coalescing delay */
+	__u64 events;		/* events returned to userspace */
+};
+
+#define EPOLL_IOC_TYPE	0x8A
+#define EPIOCSPARAMS	_IOW(EPOLL_IOC_TYPE, 0x01, struct epoll_params)
+#define EPIOCGPARAMS	_IOR(EPOLL_IOC_TYPE, 0x02, struct epoll_params)
+#define EPIOCGSTATS	_IOR(EPOLL_IOC_TYPE, 0x03, struct epoll_stats)
+
 #ifdef __KERNEL__
 
 /* Forward declarations to avoid compiler errors */
@@ -0,0 +1,129 @@
+/*
+ *  linux/include/linux/exynos_hotplug.h
+ *
+ *  Copyright (c) 2011 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * EXYNOS - dynamic CPU hotplug core
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LINUX_EXYNOS_HOTPLUG_H
+#define _LINUX_EXYNOS_HOTPLUG_H
+
+#include <linux/cpu.h>
+#include <linux/errno.h>
+#include <linux/threads.h>
+
+/**
+ * struct exynos_hotplug_stats - one sample taken by the hotplug core
+ * @nr_online:		number of online cpus when the sample was taken
+ * @load:		sum of the busy percentage of every online cpu
+ * @nr_running:		average runnable tasks on the whole system since the
+ *			previous sample
+ * @cur_freq:		current frequency of cpu0 in kHz
+ * @min_freq:		lowest valid entry of the cpufreq table
+ * @max_freq:		highest valid entry of the cpufreq table
+ * @rq_min_cpu:		secondary online cpu with the shortest runqueue
+ * @rq_min:		runqueue length of @rq_min_cpu
+ * @cpu_load:		busy percentage of every online cpu
+ * @cpu_nr_running:	average runqueue length of every online cpu
+ */
+struct exynos_hotplug_stats {
+	unsigned int nr_online;
+	unsigned int load;
+	unsigned long nr_running;
+	unsigned int cur_freq;
+	unsigned int min_freq;
+	unsigned int max_freq;
+	unsigned int rq_min_cpu;
+	unsigned long rq_min;
+	unsigned int cpu_load[NR_CPUS];
+	unsigned long cpu_nr_running[NR_CPUS];
+};
+
+/**
+ * struct exynos_hotplug_policy - a sampled hotplug decision maker
+ * @name:		name used in messages
+ * @rate:		jiffies until the next sample, may be changed by
+ *			@evaluate
+ * @evaluate:		returns the number of cpus that should be online,
+ *			or 0 to leave things as they are. The core clamps
+ *			the result to the current locks and limits and picks
+ *			which cpus to plug; one cpu is plugged per sample.
+ * @reset:		optional, drops any history after the policy was
+ *			paused
+ */
+struct exynos_hotplug_policy {
+	const char *name;
+	unsigned long rate;
+	unsigned int (*evaluate)(const struct exynos_hotplug_stats *stats);
+	void (*reset)(void);
+};
+
+#ifdef CONFIG_EXYNOS_HOTPLUG_CORE
+int exynos_hotplug_register_policy(struct exynos_hotplug_policy *policy,
+				   unsigned long delay);
+
+/*
+ * Governors that make their own hotplug decisions bracket their lifetime
+ * with these so the sampled policy stands aside, and plug cpus through
+ * exynos_hotplug_cpu_up()/exynos_hotplug_cpu_down() so every request is
+ * serialised and checked against the locks below.
+ */
+void exynos_hotplug_governor_start(void);
+void exynos_hotplug_governor_stop(void);
+int exynos_hotplug_cpu_up(unsigned int cpu);
+int exynos_hotplug_cpu_down(unsigned int cpu);
+
+/* return -EINVAL when
+ * 1. num_core is invalid value
+ * 2. already locked with smaller num_core value
+ */
+int exynos_hotplug_lock(unsigned int num_core);
+int exynos_hotplug_unlock(unsigned int num_core);
+
+void exynos_hotplug_min_lock(unsigned int num_core);
+void exynos_hotplug_min_unlock(void);
+
+/* minimum online cpus while an input boost is active, 0 to release */
+void exynos_hotplug_boost(unsigned int num_core);
+#else
+static inline int exynos_hotplug_register_policy(
+			struct exynos_hotplug_policy *policy, unsigned long delay)
+{
+	return -ENODEV;
+}
+
+static inline void exynos_hotplug_governor_start(void) {}
+static inline void exynos_hotplug_governor_stop(void) {}
+
+static inline int exynos_hotplug_cpu_up(unsigned int cpu)
+{
+	return cpu_up(cpu);
+}
+
+static inline int exynos_hotplug_cpu_down(unsigned int cpu)
+{
+	return cpu_down(cpu);
+}
+
+static inline int exynos_hotplug_lock(unsigned int num_core)
+{
+	return 0;
+}
+
+static inline int exynos_hotplug_unlock(unsigned int num_core)
+{
+	return 0;
+}
+
+static inline void exynos_hotplug_min_lock(unsigned int num_core) {}
+static inline void exynos_hotplug_min_unlock(void) {}
+static inline void exynos_hotplug_boost(unsigned int num_core) {}
+#endif
+
+#endif /* _LINUX_EXYNOS_HOTPLUG_H */
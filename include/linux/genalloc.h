@@ -75,9 +75,11 @@ extern void gen_pool_destroy(struct gen_pool *);
 extern unsigned long gen_pool_alloc(struct gen_pool *, size_t);
 extern unsigned long gen_pool_alloc_aligned(struct gen_pool *, size_t,
                        unsigned);
+extern unsigned long gen_pool_alloc_top(struct gen_pool *, size_t);
 extern void gen_pool_free(struct gen_pool *, unsigned long, size_t);
 extern void gen_pool_for_each_chunk(struct gen_pool *,
 	void (*)(struct gen_pool *, struct gen_pool_chunk *, void *), void *);
 extern size_t gen_pool_avail(struct gen_pool *);
 extern size_t gen_pool_size(struct gen_pool *);
+extern size_t gen_pool_largest_free(struct gen_pool *);
 #endif /* __GENALLOC_H__ */
@@ -407,6 +407,9 @@ extern void pm_restore_gfp_mask(void);
 /* The below functions must be run on a range from a single zone. */
 extern int alloc_contig_range(unsigned long start, unsigned long end,
 				unsigned migratetype);
+extern int __alloc_contig_range(unsigned long start, unsigned long end,
+				unsigned migratetype, bool fast,
+				unsigned long *busy_pfn);
 extern void free_contig_range(unsigned long pfn, unsigned nr_pages);
 /* CMA stuff */
 extern void init_cma_reserved_pageblock(struct page *page);
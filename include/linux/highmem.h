@@ -221,6 +221,12 @@ alloc_zeroed_user_highpage_movable(struct vm_area_struct *vma,
 #ifndef CONFIG_DMA_CMA
 	return __alloc_zeroed_user_highpage(__GFP_MOVABLE, vma, vaddr);
 #else
+	/*
+	 * Locked memory is what gets pinned for dma from userspace and
+	 * would hold up contiguous allocations: keep it out of CMA.
+	 */
+	if (vma->vm_flags & VM_LOCKED)
+		return __alloc_zeroed_user_highpage(__GFP_MOVABLE, vma, vaddr);
 	return __alloc_zeroed_user_highpage(__GFP_MOVABLE|__GFP_CMA, vma,
 						vaddr);
 #endif
@@ -0,0 +1,45 @@
+/*
+ * include/linux/hotpin.h
+ *
+ * File mappings whose page cache is kept out of reclaim up to a bound.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LINUX_HOTPIN_H
+#define _LINUX_HOTPIN_H
+
+#include <linux/fs.h>
+#include <linux/pagemap.h>
+
+struct ctl_table;
+struct vm_area_struct;
+
+#ifdef CONFIG_FILE_HOTPIN
+extern atomic_long_t nr_hotpin_pages;
+extern unsigned long sysctl_hotpin_max_pages;
+extern int sysctl_hotpin_min_priority;
+
+/* called with mapping->tree_lock held as pages enter or leave the cache */
+static inline void hotpin_account(struct address_space *mapping, long nr)
+{
+	if (unlikely(mapping_hotpin(mapping)))
+		atomic_long_add(nr, &nr_hotpin_pages);
+}
+
+long hotpin_madvise(struct vm_area_struct *vma, int behavior);
+bool hotpin_page_protected(struct page *page, int priority);
+int hotpin_pages_handler(struct ctl_table *table, int write,
+			 void __user *buffer, size_t *length, loff_t *ppos);
+#else
+static inline void hotpin_account(struct address_space *mapping, long nr) {}
+
+static inline bool hotpin_page_protected(struct page *page, int priority)
+{
+	return false;
+}
+#endif
+
+#endif /* _LINUX_HOTPIN_H */
@@ -141,6 +141,7 @@ typedef void (*exitcall_t)(void);
 
 extern initcall_t __con_initcall_start[], __con_initcall_end[];
 extern initcall_t __security_initcall_start[], __security_initcall_end[];
+extern initcall_t __deferred_initcall_start[], __deferred_initcall_end[];
 
 /* Used for contructor calls. */
 typedef void (*ctor_fn_t)(void);
@@ -214,6 +215,20 @@ extern bool initcall_debug;
 #define late_initcall(fn)		__define_initcall("7",fn,7)
 #define late_initcall_sync(fn)		__define_initcall("7s",fn,7s)
 
+/*
+ * Deferred initcalls run once userspace reports the boot complete,
+ * after everything above. They are for drivers nothing needs before the
+ * first frame; without CONFIG_DEFERRED_INITCALLS they keep their usual
+ * level.
+ */
+#ifdef CONFIG_DEFERRED_INITCALLS
+#define deferred_module_init(fn)	__define_initcall("_deferred",fn,deferred)
+#define deferred_late_initcall(fn)	__define_initcall("_deferred",fn,deferred)
+#else
+#define deferred_module_init(fn)	device_initcall(fn)
+#define deferred_late_initcall(fn)	late_initcall(fn)
+#endif
+
 #define __initcall(fn) device_initcall(fn)
 
 #define __exitcall(fn) \
@@ -293,6 +308,8 @@ void __init parse_early_options(char *cmdline);
 #define fs_initcall(fn)			module_init(fn)
 #define device_initcall(fn)		module_init(fn)
 #define late_initcall(fn)		module_init(fn)
+#define deferred_module_init(fn)	module_init(fn)
+#define deferred_late_initcall(fn)	module_init(fn)
 
 #define security_initcall(fn)		module_init(fn)
 
@@ -30,6 +30,22 @@ struct input_event {
 	__s32 value;
 };
 
+/*
+ * mmap() of an event device switches the file to an event ring shared with
+ * the reader: this header, then at data_offset a power of two number of
+ * events. The kernel advances head a whole packet at a time, the reader
+ * consumes from tail and advances it; both run freely and index the ring
+ * modulo size. When the ring is full the kernel drops events and the next
+ * packet starts with SYN_DROPPED, as with read().
+ */
+struct input_event_ring {
+	__u32 head;
+	__u32 tail;
+	__u32 size;
+	__u32 data_offset;
+	__u32 dropped;
+};
+
 /*
  * Protocol version.
  */
@@ -1183,6 +1199,7 @@ struct ff_effect {
 #include <linux/device.h>
 #include <linux/fs.h>
 #include <linux/timer.h>
+#include <linux/ktime.h>
 #include <linux/mod_devicetable.h>
 
 /**
@@ -1262,6 +1279,9 @@ struct ff_effect {
  * @going_away: marks devices that are in a middle of unregistering and
  *	causes input_open_device*() fail with -ENODEV.
  * @sync: set to %true when there were no new events since last EV_SYN
+ * @timestamp: monotonic time the events of the current packet happened,
+ *	set by the driver with input_set_timestamp() or taken when the
+ *	first event of the packet is reported; cleared by SYN_REPORT
  * @dev: driver model's view of this device
  * @h_list: list of input handles associated with the device. When
  *	accessing the list dev->mutex must be held
@@ -1331,6 +1351,8 @@ struct input_dev {
 
 	bool sync;
 
+	ktime_t timestamp;
+
 	struct device dev;
 
 	struct list_head	h_list;
@@ -1547,6 +1569,24 @@ static inline void input_report_switch(struct input_dev *dev, unsigned int code,
 	input_event(dev, EV_SW, code, !!value);
 }
 
+/**
+ * input_set_timestamp() - set the time the events being reported happened
+ * @dev: input device the events come from
+ * @timestamp: monotonic time, typically ktime_get() in the hard interrupt
+ *
+ * Drivers that read events from a threaded handler or a workqueue call this
+ * before reporting them, so that userspace sees when the hardware raised the
+ * interrupt rather than when the events went through the input core. It
+ * applies until the next input_sync().
+ */
+static inline void input_set_timestamp(struct input_dev *dev,
+				       ktime_t timestamp)
+{
+	dev->timestamp = timestamp;
+}
+
+ktime_t input_get_timestamp(struct input_dev *dev);
+
 static inline void input_sync(struct input_dev *dev)
 {
 	input_event(dev, EV_SYN, SYN_REPORT, 0);
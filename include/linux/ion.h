@@ -61,6 +61,7 @@ struct ion_heap;
 struct ion_mapper;
 struct ion_client;
 struct ion_buffer;
+struct dma_buf;
 
 /* This should be removed some day when phys_addr_t's are fully
    plumbed in the kernel, and all instances of ion_phys_addr_t should
@@ -268,6 +269,26 @@ int ion_share_fd(struct ion_client *client, struct ion_handle *handle);
  */
 struct ion_handle *ion_import_fd(struct ion_client *client, int fd);
 
+/**
+ * ion_share_dma_buf() - export a handle as a dma_buf
+ * @client:	the client
+ * @handle:	the handle to share
+ *
+ * The dma_buf holds its own reference to the buffer and can be attached by
+ * any dma_buf importer (mali, ump, fimc, mfc).  CPU caches are only
+ * maintained when ownership actually moves between the cpu and the devices,
+ * see ion_dma_buf_map().
+ */
+struct dma_buf *ion_share_dma_buf(struct ion_client *client,
+				  struct ion_handle *handle);
+
+/**
+ * ion_share_dma_buf_fd() - same as ion_share_dma_buf(), returned as an fd
+ * @client:	the client
+ * @handle:	the handle to share
+ */
+int ion_share_dma_buf_fd(struct ion_client *client, struct ion_handle *handle);
+
 /**
  * ion_import_uva() - given a virtual address from user, that is mmapped on an
  *                    fd obtained via ION_IOCTL_SHARE ioctl, import it
@@ -416,4 +437,13 @@ struct ion_custom_data {
  */
 #define ION_IOC_CUSTOM		_IOWR(ION_IOC_MAGIC, 6, struct ion_custom_data)
 
+/**
+ * DOC: ION_IOC_SHARE_DMA_BUF - creates a dma_buf file descriptor
+ *
+ * Takes an ion_fd_data struct with the handle field populated with a valid
+ * opaque handle.  Returns the struct with the fd field set to a dma_buf file
+ * descriptor which can be passed to any driver importing dma_bufs.
+ */
+#define ION_IOC_SHARE_DMA_BUF	_IOWR(ION_IOC_MAGIC, 7, struct ion_fd_data)
+
 #endif /* _LINUX_ION_H */
@@ -509,6 +509,25 @@ static inline void irq_set_percpu_devid_flags(unsigned int irq)
 			     IRQ_NOPROBE | IRQ_PER_CPU_DEVID);
 }
 
+#ifdef CONFIG_IRQ_BALANCE_KERNEL
+/*
+ * Tell the interrupt balancer that @irq is demultiplexed from @parent_irq,
+ * so moving it means moving @parent_irq and everything chained behind it.
+ */
+extern int irq_set_parent(unsigned int irq, unsigned int parent_irq);
+/* Keep @irq and its threaded handler on the balancer's latency cpu. */
+extern int irq_set_latency_critical(unsigned int irq, bool on);
+#else
+static inline int irq_set_parent(unsigned int irq, unsigned int parent_irq)
+{
+	return 0;
+}
+static inline int irq_set_latency_critical(unsigned int irq, bool on)
+{
+	return 0;
+}
+#endif
+
 /* Handle dynamic irq creation and destruction */
 extern unsigned int create_irq_nr(unsigned int irq_want, int node);
 extern int create_irq(void);
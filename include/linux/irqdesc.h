@@ -37,6 +37,9 @@ struct module;
  * @threads_active:	number of irqaction threads currently running
  * @wait_for_threads:	wait queue for sync_irq to wait for threaded handlers
  * @dir:		/proc/irq/ procfs entry
+ * @parent_irq:		interrupt this one is chained behind, or 0
+ * @balance_last:	interrupt count at the last balancer pass
+ * @latency_critical:	balancer keeps this irq on the latency cpu
  * @name:		flow handler name for /proc/interrupts output
  */
 struct irq_desc {
@@ -70,6 +73,11 @@ struct irq_desc {
 	wait_queue_head_t       wait_for_threads;
 #ifdef CONFIG_PROC_FS
 	struct proc_dir_entry	*dir;
+#endif
+#ifdef CONFIG_IRQ_BALANCE_KERNEL
+	unsigned int		parent_irq;
+	unsigned int		balance_last;
+	bool			latency_critical;
 #endif
 	struct module		*owner;
 	const char		*name;
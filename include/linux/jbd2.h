@@ -598,6 +598,12 @@ struct transaction_s
 	 */
 	unsigned int t_synchronous_commit:1;
 
+	/*
+	 * An fsync is holding the commit back for other fsyncs to join.
+	 * [j_state_lock]
+	 */
+	int			t_fsync_batch;
+
 	/* Disk flush needs to be sent to fs partition [no locking] */
 	int			t_need_data_flush;
 
@@ -1181,6 +1187,7 @@ int jbd2_journal_start_commit(journal_t *journal, tid_t *tid);
 int jbd2_journal_force_commit_nested(journal_t *journal);
 int jbd2_log_wait_commit(journal_t *journal, tid_t tid);
 int jbd2_complete_transaction(journal_t *journal, tid_t tid);
+int jbd2_complete_transaction_batched(journal_t *journal, tid_t tid);
 int jbd2_log_do_checkpoint(journal_t *journal);
 int jbd2_trans_will_send_data_barrier(journal_t *journal, tid_t tid);
 
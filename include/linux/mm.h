@@ -1481,6 +1481,8 @@ unsigned long max_sane_readahead(unsigned long nr);
 unsigned long ra_submit(struct file_ra_state *ra,
 			struct address_space *mapping,
 			struct file *filp);
+unsigned long ra_window(struct file_ra_state *ra);
+void ra_window_miss(struct address_space *mapping, struct file_ra_state *ra);
 
 /* Generic expand stack which grows the stack according to GROWS{UP,DOWN} */
 extern int expand_stack(struct vm_area_struct *vma, unsigned long address);
@@ -217,6 +217,8 @@ struct mmc_card {
 #define MMC_POWEROFF_SHORT		2
 #define MMC_POWEROFF_LONG		3
 
+	unsigned int		cache_dirty:1;	/* written since last cache flush */
+
 	unsigned int		erase_size;	/* erase size in sectors */
  	unsigned int		erase_shift;	/* if erase unit is power 2 */
  	unsigned int		pref_erase;	/* in sectors */
@@ -227,8 +227,15 @@ enum zone_watermarks {
 };
 
 #define min_wmark_pages(z) (z->watermark[WMARK_MIN])
-#define low_wmark_pages(z) (z->watermark[WMARK_LOW])
-#define high_wmark_pages(z) (z->watermark[WMARK_HIGH])
+#define low_wmark_pages(z) (z->watermark[WMARK_LOW] + z->watermark_boost)
+#define high_wmark_pages(z) (z->watermark[WMARK_HIGH] + z->watermark_boost)
+
+/*
+ * Free blocks of orders 1..PCP_HIGH_ORDERS are kept per cpu as well, at most
+ * PCP_HIGH_BLOCKS of order 1 and half as many of each order above.
+ */
+#define PCP_HIGH_ORDERS		3
+#define PCP_HIGH_BLOCKS		4
 
 struct per_cpu_pages {
 	int count;		/* number of pages in the list */
@@ -237,6 +244,10 @@ struct per_cpu_pages {
 
 	/* Lists of pages, one per migrate type stored on the pcp-lists */
 	struct list_head lists[MIGRATE_PCPTYPES];
+
+	/* Blocks of order i + 1, of any pcp migrate type */
+	int high_count[PCP_HIGH_ORDERS];
+	struct list_head high_lists[PCP_HIGH_ORDERS];
 };
 
 struct per_cpu_pageset {
@@ -342,6 +353,13 @@ struct zone {
 	/* zone watermarks, access with *_wmark_pages(zone) macros */
 	unsigned long watermark[NR_WMARK];
 
+	/*
+	 * Raised after direct reclaim stalls and pageblock fallbacks so that
+	 * kswapd wakes earlier and reclaims further, decayed by kswapd. Only
+	 * the low and high watermarks include it, under zone->lock.
+	 */
+	unsigned long watermark_boost;
+
 	/*
 	 * When free pages are below this point, additional steps are taken
 	 * when reading the number of free pages to avoid per-cpu counter
@@ -412,6 +430,12 @@ struct zone {
 	int			compact_order_failed;
 #endif
 
+#ifdef CONFIG_COMPACTION_BACKGROUND
+	/* kcompactd backoff, kept apart from the direct compaction one */
+	unsigned int		kcompactd_considered;
+	unsigned int		kcompactd_defer_shift;
+#endif
+
 	ZONE_PADDING(_pad1_)
 
 	/* Fields commonly accessed by the page reclaim scanner */
@@ -496,6 +520,9 @@ typedef enum {
 	ZONE_CONGESTED,			/* zone has many dirty pages backed by
 					 * a congested BDI
 					 */
+	ZONE_BOOSTED_WATERMARK,		/* watermark was boosted under
+					 * zone->lock, kswapd wants a kick
+					 */
 } zone_flags_t;
 
 static inline void zone_set_flag(struct zone *zone, zone_flags_t flag)
@@ -513,6 +540,12 @@ static inline void zone_clear_flag(struct zone *zone, zone_flags_t flag)
 	clear_bit(flag, &zone->flags);
 }
 
+static inline int zone_test_and_clear_flag(struct zone *zone,
+					   zone_flags_t flag)
+{
+	return test_and_clear_bit(flag, &zone->flags);
+}
+
 static inline int zone_is_reclaim_congested(const struct zone *zone)
 {
 	return test_bit(ZONE_CONGESTED, &zone->flags);
@@ -843,6 +876,7 @@ struct ctl_table;
 int min_free_kbytes_sysctl_handler(struct ctl_table *, int,
 					void __user *, size_t *, loff_t *);
 extern int sysctl_lowmem_reserve_ratio[MAX_NR_ZONES-1];
+extern int watermark_boost_factor;
 int lowmem_reserve_ratio_sysctl_handler(struct ctl_table *, int,
 					void __user *, size_t *, loff_t *);
 int percpu_pagelist_fraction_sysctl_handler(struct ctl_table *, int,
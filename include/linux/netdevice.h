@@ -660,6 +660,9 @@ static inline void rps_reset_sock_flow(struct rps_sock_flow_table *table,
 
 extern struct rps_sock_flow_table __rcu *rps_sock_flow_table;
 
+/* packets per RPS_AUTO_WINDOW on one cpu before it steers flows, 0: off */
+extern int rps_auto_threshold;
+
 #ifdef CONFIG_RFS_ACCEL
 extern bool rps_may_expire_flow(struct net_device *dev, u16 rxq_index,
 				u32 flow_id, u16 filter_id);
@@ -1737,6 +1740,11 @@ struct softnet_data {
 #ifdef CONFIG_RPS
 	struct softnet_data	*rps_ipi_list;
 
+	/* receive load seen by automatic steering, local cpu only */
+	unsigned long		rps_auto_window;
+	unsigned int		rps_auto_count;
+	bool			rps_auto_busy;
+
 	/* Elements below can be accessed between CPUs for RPS */
 	struct call_single_data	csd ____cacheline_aligned_in_smp;
 	struct softnet_data	*rps_ipi_next;
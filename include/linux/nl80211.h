@@ -1458,6 +1458,14 @@ enum nl80211_commands {
  *	data is in the format defined for the payload of the QoS Map Set element
  *	in IEEE Std 802.11-2012, 8.4.2.97.
  *
+ * @NL80211_ATTR_BSS_CHANGED_SINCE: u32 scan generation, as reported in
+ *	%NL80211_ATTR_GENERATION by an earlier %NL80211_CMD_GET_SCAN dump.
+ *	Given to %NL80211_CMD_GET_SCAN, only the BSSes that appeared or
+ *	changed after that generation are dumped, and each of them carries
+ *	the attribute back. If a BSS was removed since, the full list is
+ *	dumped instead without the attribute, and entries missing from it
+ *	are gone.
+ *
  * @NL80211_ATTR_MAX: highest attribute number currently defined
  * @__NL80211_ATTR_AFTER_LAST: internal use
  */
@@ -1787,6 +1795,8 @@ enum nl80211_attrs {
 
 	NL80211_ATTR_QOS_MAP,
 
+	NL80211_ATTR_BSS_CHANGED_SINCE,
+
 	/* add attributes here, update the policy in nl80211.c */
 
 	__NL80211_ATTR_AFTER_LAST,
@@ -0,0 +1,40 @@
+#ifndef _LINUX_PIDSTATS_H
+#define _LINUX_PIDSTATS_H
+
+/*
+ * Records read from /proc/pidstats, one per process in the pid namespace
+ * of the proc mount, in pid order. They carry the fields of
+ * /proc/<pid>/stat, statm and oom_score_adj that process scanners poll.
+ *
+ * Records only grow at the end. Readers must step by @size and ignore
+ * bytes past the fields they know.
+ */
+
+#include <linux/types.h>
+
+struct pidstats_record {
+	__u32	size;		/* of this record */
+	__s32	pid;
+	__s32	ppid;
+	__u32	uid;
+	__u32	flags;		/* PF_* */
+	__u32	num_threads;
+	__s32	oom_score_adj;
+	__u8	state;		/* as in /proc/<pid>/stat */
+	__s8	nice;
+	__u8	policy;
+	__u8	rt_priority;
+	__u64	utime;		/* clock ticks, all threads */
+	__u64	stime;
+	__u64	start_time;	/* clock ticks after boot */
+	__u64	min_flt;
+	__u64	maj_flt;
+	__u64	vsize;		/* bytes */
+	__u64	rss;		/* pages */
+	__u64	shared;		/* pages */
+	__u64	text;		/* pages */
+	__u64	data;		/* pages */
+	char	comm[16];
+};
+
+#endif /* _LINUX_PIDSTATS_H */
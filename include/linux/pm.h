@@ -605,6 +605,10 @@ extern void __suspend_report_result(const char *function, void *fn, int ret);
 	} while (0)
 
 extern int device_pm_wait_for_dev(struct device *sub, struct device *dev);
+extern int device_pm_add_dependency(struct device *consumer,
+				    struct device *supplier);
+extern void device_pm_remove_dependency(struct device *consumer,
+					struct device *supplier);
 
 extern int pm_generic_prepare(struct device *dev);
 extern int pm_generic_suspend(struct device *dev);
@@ -632,6 +636,15 @@ static inline int device_pm_wait_for_dev(struct device *a, struct device *b)
 	return 0;
 }
 
+static inline int device_pm_add_dependency(struct device *consumer,
+					   struct device *supplier)
+{
+	return 0;
+}
+
+static inline void device_pm_remove_dependency(struct device *consumer,
+					       struct device *supplier) {}
+
 #define pm_generic_prepare	NULL
 #define pm_generic_suspend	NULL
 #define pm_generic_resume	NULL
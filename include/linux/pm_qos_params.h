@@ -16,8 +16,12 @@
 #define PM_QOS_DISPLAY_FREQUENCY 5
 #define PM_QOS_BUS_QOS 6
 #define PM_QOS_DVFS_RESPONSE_LATENCY 7
+#define PM_QOS_CPU_FREQ_MIN 8
+#define PM_QOS_CPU_FREQ_MAX 9
+#define PM_QOS_CPU_ONLINE_MIN 10
+#define PM_QOS_GPU_STEP_MIN 11
 
-#define PM_QOS_NUM_CLASSES 8
+#define PM_QOS_NUM_CLASSES 12
 #define PM_QOS_DEFAULT_VALUE -1
 
 #define PM_QOS_CPU_DMA_LAT_DEFAULT_VALUE	(2000 * USEC_PER_SEC)
@@ -26,10 +30,22 @@
 #define PM_QOS_BUS_DMA_THROUGHPUT_DEFAULT_VALUE 0
 #define PM_QOS_DISPLAY_FREQUENCY_DEFAULT_VALUE	0
 #define PM_QOS_DVFS_RESPONSE_LAT_DEFAULT_VALUE	(2000 * USEC_PER_SEC)
+#define PM_QOS_CPU_FREQ_MIN_DEFAULT_VALUE	0
+#define PM_QOS_CPU_FREQ_MAX_DEFAULT_VALUE	INT_MAX
+#define PM_QOS_CPU_ONLINE_MIN_DEFAULT_VALUE	0
+#define PM_QOS_GPU_STEP_MIN_DEFAULT_VALUE	0
 
+/*
+ * owner is where the request was added from, pid the process that opened
+ * the misc device for it and stamp the jiffies of its last change, all
+ * only for the debugfs listing.
+ */
 struct pm_qos_request_list {
 	struct plist_node list;
 	int pm_qos_class;
+	void *owner;
+	pid_t pid;
+	unsigned long stamp;
 };
 
 void pm_qos_add_request(struct pm_qos_request_list *l, int pm_qos_class, s32 value);
@@ -0,0 +1,40 @@
+/*
+ * include/linux/ram_trace.h
+ *
+ * Binary event records kept in a RAM region that survives a warm reset.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ */
+
+#ifndef _LINUX_RAM_TRACE_H
+#define _LINUX_RAM_TRACE_H
+
+#include <linux/types.h>
+
+enum ram_trace_type {
+	RAM_TRACE_NONE,
+	RAM_TRACE_CPUFREQ,	/* cpu, old kHz, new kHz */
+	RAM_TRACE_THERMAL,	/* tmu state, temperature */
+	RAM_TRACE_LMK,		/* pid, oom_score_adj, size in kB */
+	RAM_TRACE_BINDER,	/* pid, latency in us */
+	RAM_TRACE_WATCHDOG,	/* ms that were left on the watchdog */
+	RAM_TRACE_TYPE_MAX,
+};
+
+#ifdef CONFIG_ANDROID_RAM_TRACE
+/*
+ * Safe from any context, including interrupts. Records are small and
+ * written straight through to memory, so keep the rate to events that
+ * matter after the fact rather than anything per tick.
+ */
+void ram_trace_log(enum ram_trace_type type, u32 a, u32 b, u32 c);
+#else
+static inline void ram_trace_log(enum ram_trace_type type, u32 a, u32 b,
+				 u32 c)
+{
+}
+#endif
+
+#endif /* _LINUX_RAM_TRACE_H */
@@ -137,6 +137,18 @@ extern int nr_threads;
 DECLARE_PER_CPU(unsigned long, process_counts);
 extern int nr_processes(void);
 extern unsigned long get_cpu_nr_running(unsigned int cpu);
+
+/*
+ * Runqueue length averages, see kernel/sched/sched_avg.c. Each reader
+ * keeps its own snapshot; pass -1 as cpu for the system-wide sum.
+ */
+struct sched_nr_snapshot {
+	u64 stamp;
+	u64 integral;
+};
+extern void sched_nr_running_snapshot(int cpu, struct sched_nr_snapshot *snap);
+extern unsigned int sched_nr_running_avg(int cpu,
+					 struct sched_nr_snapshot *prev);
 extern unsigned long nr_running(void);
 extern unsigned long nr_uninterruptible(void);
 extern unsigned long nr_iowait(void);
@@ -155,6 +167,7 @@ struct task_group;
 #ifdef CONFIG_SCHED_DEBUG
 extern void proc_sched_show_task(struct task_struct *p, struct seq_file *m);
 extern void proc_sched_set_task(struct task_struct *p);
+extern void proc_sched_set_lat_hist(struct task_struct *p);
 extern void
 print_cfs_rq(struct seq_file *m, int cpu, struct cfs_rq *cfs_rq);
 #else
@@ -165,6 +178,9 @@ proc_sched_show_task(struct task_struct *p, struct seq_file *m)
 static inline void proc_sched_set_task(struct task_struct *p)
 {
 }
+static inline void proc_sched_set_lat_hist(struct task_struct *p)
+{
+}
 static inline void
 print_cfs_rq(struct seq_file *m, int cpu, struct cfs_rq *cfs_rq)
 {
@@ -282,6 +298,10 @@ static inline void select_nohz_load_balancer(int stop_tick) { }
 static inline void set_cpu_sd_state_idle(void) { }
 #endif
 
+#ifdef CONFIG_NO_HZ_ADAPTIVE
+extern bool sched_single_fair_task(void);
+#endif
+
 /*
  * Only dump TASK_* tasks. (0 for all tasks)
  */
@@ -1180,6 +1200,17 @@ struct load_weight {
 };
 
 #ifdef CONFIG_SCHEDSTATS
+/*
+ * Log2 histogram of the time from becoming runnable to running: bucket 0
+ * counts waits under 1024ns, bucket n waits under 1024ns << n, and the
+ * last one everything longer.
+ */
+#define SCHED_LAT_BUCKETS	20
+
+struct sched_lat_hist {
+	u32			count[SCHED_LAT_BUCKETS];
+};
+
 struct sched_statistics {
 	u64			wait_start;
 	u64			wait_max;
@@ -1212,6 +1243,9 @@ struct sched_statistics {
 	u64			nr_wakeups_affine_attempts;
 	u64			nr_wakeups_passive;
 	u64			nr_wakeups_idle;
+
+	int			lat_hist_on;
+	struct sched_lat_hist	lat_hist;
 };
 #endif
 
@@ -1273,6 +1307,10 @@ enum perf_event_task_context {
 	perf_nr_task_contexts,
 };
 
+#define VMACACHE_BITS 2
+#define VMACACHE_SIZE (1U << VMACACHE_BITS)
+#define VMACACHE_MASK (VMACACHE_SIZE - 1)
+
 struct task_struct {
 	volatile long state;	/* -1 unrunnable, 0 runnable, >0 stopped */
 	void *stack;
@@ -1336,8 +1374,16 @@ struct task_struct {
 #ifdef CONFIG_SMP
 	struct plist_node pushable_tasks;
 #endif
+#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER
+	/* lowmemorykiller index by oom_score_adj, group leaders only */
+	struct rb_node adj_node;
+	int adj_node_key;
+#endif
 
 	struct mm_struct *mm, *active_mm;
+	/* per-thread vma caching */
+	u32 vmacache_seqnum;
+	struct vm_area_struct *vmacache[VMACACHE_SIZE];
 #ifdef CONFIG_COMPAT_BRK
 	unsigned brk_randomized:1;
 #endif
@@ -1410,6 +1456,14 @@ struct task_struct {
 	cputime_t gtime;
 #ifndef CONFIG_VIRT_CPU_ACCOUNTING
 	cputime_t prev_utime, prev_stime;
+#endif
+#ifdef CONFIG_CPU_FREQ_STAT_TASK
+	cputime_t *time_in_state;	/* indexed like cpufreq_task_stats_freq() */
+	unsigned int max_state;
+#endif
+#ifdef CONFIG_UID_CPUTIME
+	/* the part of ioac that uid_cputime already charged to the uid */
+	u64 uid_read_bytes, uid_write_bytes;
 #endif
 	unsigned long nvcsw, nivcsw; /* context switch counts */
 	struct timespec start_time; 		/* monotonic time */
@@ -1670,6 +1724,23 @@ static inline int rt_task(struct task_struct *p)
 	return rt_prio(p->prio);
 }
 
+extern unsigned long (*timer_slack_adjust)(struct task_struct *task,
+					   unsigned long slack_ns);
+
+/*
+ * Slack for the timers a task arms to sleep on. The timer slack cgroup
+ * may widen it, e.g. while the screen is off, so the wakeups coalesce.
+ */
+static inline unsigned long task_timer_slack_ns(struct task_struct *tsk)
+{
+	unsigned long (*adjust)(struct task_struct *, unsigned long);
+
+	adjust = ACCESS_ONCE(timer_slack_adjust);
+	if (adjust)
+		return adjust(tsk, tsk->timer_slack_ns);
+	return tsk->timer_slack_ns;
+}
+
 static inline struct pid *task_pid(struct task_struct *task)
 {
 	return task->pids[PIDTYPE_PID].pid;
@@ -2103,6 +2174,7 @@ extern enum sched_tunable_scaling sysctl_sched_tunable_scaling;
 #ifdef CONFIG_SCHED_DEBUG
 extern unsigned int sysctl_sched_migration_cost;
 extern unsigned int sysctl_sched_nr_migrate;
+extern unsigned int sysctl_sched_packing_load;
 extern unsigned int sysctl_sched_time_avg;
 extern unsigned int sysctl_timer_migration;
 extern unsigned int sysctl_sched_shares_window;
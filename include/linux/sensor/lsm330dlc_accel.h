@@ -128,6 +128,16 @@
 #define LIR_INT1		(1 << 3)
 #define D4D_INT1		(1 << 2)
 
+/* FIFO_CTRL_REG */
+#define BYPASS_MODE		0x00
+#define STREAM_MODE		0x80
+
+/* FIFO_SRC_REG */
+#define FIFO_OVRN		(1 << 6)
+#define FIFO_EMPTY		(1 << 5)
+#define FIFO_FSS_MASK		0x1F
+#define FIFO_DEPTH		32
+
 /* STATUS_REG */
 #define ZYXOR			(1 << 7)
 #define ZOR			(1 << 6)
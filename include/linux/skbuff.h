@@ -575,6 +575,13 @@ static inline struct sk_buff *alloc_skb_fclone(unsigned int size,
 extern void skb_recycle(struct sk_buff *skb);
 extern bool skb_recycle_check(struct sk_buff *skb, int skb_size);
 
+struct skb_pool;
+extern struct skb_pool *skb_pool_create(unsigned int skb_size,
+					unsigned int max_per_cpu);
+extern void skb_pool_destroy(struct skb_pool *pool);
+extern struct sk_buff *skb_pool_alloc(struct skb_pool *pool, gfp_t gfp_mask);
+extern void skb_pool_free(struct skb_pool *pool, struct sk_buff *skb);
+
 extern struct sk_buff *skb_morph(struct sk_buff *dst, struct sk_buff *src);
 extern int skb_copy_ubufs(struct sk_buff *skb, gfp_t gfp_mask);
 extern struct sk_buff *skb_clone(struct sk_buff *skb,
@@ -43,6 +43,9 @@ enum stat_item {
 	CPU_PARTIAL_DRAIN,	/* Drain cpu partial to node partial */
 	NR_SLUB_STAT_ITEMS };
 
+/* The fast and slow path counts are kept for profiling without SLUB_STATS */
+#define NR_SLUB_PROF_ITEMS	(FREE_SLOWPATH + 1)
+
 struct kmem_cache_cpu {
 	void **freelist;	/* Pointer to next available object */
 	unsigned long tid;	/* Globally unique transaction id */
@@ -52,6 +55,9 @@ struct kmem_cache_cpu {
 #ifdef CONFIG_SLUB_STATS
 	unsigned stat[NR_SLUB_STAT_ITEMS];
 #endif
+#ifdef CONFIG_SLUB_PROFILE
+	unsigned prof[NR_SLUB_PROF_ITEMS];
+#endif
 };
 
 struct kmem_cache_node {
@@ -108,6 +114,11 @@ struct kmem_cache {
 	 * Defragmentation by allocating from a remote node.
 	 */
 	int remote_node_defrag_ratio;
+#endif
+#ifdef CONFIG_SLUB_PROFILE
+	int cpu_partial_base;	/* cpu_partial before autotuning */
+	unsigned long prof_last[NR_SLUB_PROF_ITEMS];	/* last sample */
+	unsigned long prof_rate[NR_SLUB_PROF_ITEMS];	/* per second */
 #endif
 	struct kmem_cache_node *node[MAX_NUMNODES];
 };
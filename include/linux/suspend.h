@@ -228,6 +228,16 @@ static inline void suspend_set_ops(const struct platform_suspend_ops *ops) {}
 static inline int pm_suspend(suspend_state_t state) { return -ENOSYS; }
 #endif /* !CONFIG_SUSPEND */
 
+#ifdef CONFIG_SUSPEND_TIME
+/* resume time of one device and of the whole device resume phase */
+extern void suspend_time_device_resumed(struct device *dev, s64 usecs);
+extern void suspend_time_resumed(s64 usecs);
+#else
+static inline void suspend_time_device_resumed(struct device *dev,
+					       s64 usecs) {}
+static inline void suspend_time_resumed(s64 usecs) {}
+#endif
+
 /* struct pbe is used for creating lists of pages that should be restored
  * atomically during the resume from disk, because the page frames they have
  * occupied before the suspend are in use.
@@ -47,6 +47,9 @@ enum tick_nohz_mode {
  * @iowait_sleeptime:	Sum of the time slept in idle with sched tick stopped, with IO outstanding
  * @sleep_length:	Duration of the current idle sleep
  * @do_timer_lst:	CPU was the last one doing do_timer before going idle
+ * @stretch:		Tick periods the adaptive tick programmed ahead
+ * @stretch_jiffies:	jiffies at the last tick, for accounting skipped ones
+ * @stretch_last:	Expiry time of the last tick
  */
 struct tick_sched {
 	struct hrtimer			sched_timer;
@@ -69,6 +72,11 @@ struct tick_sched {
 	unsigned long			next_jiffies;
 	ktime_t				idle_expires;
 	int				do_timer_last;
+#ifdef CONFIG_NO_HZ_ADAPTIVE
+	unsigned int			stretch;
+	unsigned long			stretch_jiffies;
+	ktime_t				stretch_last;
+#endif
 };
 
 extern void __init tick_init(void);
@@ -143,4 +151,12 @@ static inline u64 get_cpu_idle_time_us(int cpu, u64 *unused) { return -1; }
 static inline u64 get_cpu_iowait_time_us(int cpu, u64 *unused) { return -1; }
 # endif /* !NO_HZ */
 
+# ifdef CONFIG_NO_HZ_ADAPTIVE
+extern void tick_nohz_stretch_kick(int cpu);
+extern void tick_nohz_stretch_restart(void);
+# else
+static inline void tick_nohz_stretch_kick(int cpu) { }
+static inline void tick_nohz_stretch_restart(void) { }
+# endif
+
 #endif
@@ -0,0 +1,31 @@
+/*
+ * include/linux/uid_cputime.h
+ *
+ * Per-uid cpu time and storage i/o, charged as it happens.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ */
+
+#ifndef _LINUX_UID_CPUTIME_H
+#define _LINUX_UID_CPUTIME_H
+
+#include <linux/sched.h>
+
+#ifdef CONFIG_UID_CPUTIME
+static inline void uid_cputime_init_task(struct task_struct *p)
+{
+	p->uid_read_bytes = 0;
+	p->uid_write_bytes = 0;
+}
+
+/* called from the tick with the cpu time just charged to @p */
+void uid_cputime_account(struct task_struct *p, cputime_t cputime, bool user);
+#else
+static inline void uid_cputime_init_task(struct task_struct *p) {}
+static inline void uid_cputime_account(struct task_struct *p,
+				       cputime_t cputime, bool user) {}
+#endif
+
+#endif /* _LINUX_UID_CPUTIME_H */
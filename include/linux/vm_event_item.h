@@ -37,6 +37,9 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		KSWAPD_LOW_WMARK_HIT_QUICKLY, KSWAPD_HIGH_WMARK_HIT_QUICKLY,
 		KSWAPD_SKIP_CONGESTION_WAIT,
 		PAGEOUTRUN, ALLOCSTALL, PGROTATED,
+		ALLOCSTALL_US,		/* time spent in direct reclaim */
+		WATERMARK_BOOST_STALL,	/* boosts after direct reclaim */
+		WATERMARK_BOOST_FRAG,	/* boosts after a pageblock fallback */
 #ifdef CONFIG_COMPACTION
 		COMPACTBLOCKS, COMPACTPAGES, COMPACTPAGEFAILED,
 		COMPACTSTALL, COMPACTFAIL, COMPACTSUCCESS,
@@ -52,6 +55,20 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		UNEVICTABLE_PGCLEARED,	/* on COW, page truncate */
 		UNEVICTABLE_PGSTRANDED,	/* unable to isolate on unlock */
 		UNEVICTABLE_MLOCKFREED,
+#ifdef CONFIG_SWAP
+		SWAP_RA,		/* swapped in ahead of a fault */
+		SWAP_RA_HIT,		/* ... and faulted on while cached */
+#endif
+#ifdef CONFIG_WORKINGSET_REFAULT
+		WORKINGSET_REFAULT,	/* evicted file page read back in */
+		WORKINGSET_ACTIVATE,	/* ... soon enough to start active */
+#endif
+#ifdef CONFIG_FILE_HOTPIN
+		HOTPIN_PROTECTED,	/* spared from reclaim */
+		HOTPIN_RELEASED,	/* reclaimed past the pinning limits */
+#endif
+		VMACACHE_FIND_CALLS,	/* find_vma() cache lookups */
+		VMACACHE_FIND_HITS,	/* ... served from the cache */
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 		THP_FAULT_ALLOC,
 		THP_FAULT_FALLBACK,
@@ -0,0 +1,36 @@
+/*
+ * include/linux/workingset.h
+ *
+ * Page cache refault detection.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LINUX_WORKINGSET_H
+#define _LINUX_WORKINGSET_H
+
+#include <linux/types.h>
+
+struct address_space;
+struct page;
+
+#ifdef CONFIG_WORKINGSET_REFAULT
+/* called by reclaim with the mapping's tree_lock held */
+void workingset_eviction(struct address_space *mapping, struct page *page);
+/* true if a page just read back in at @index should start out active */
+bool workingset_refault(struct address_space *mapping, pgoff_t index);
+void workingset_activation(struct page *page);
+#else
+static inline void workingset_eviction(struct address_space *mapping,
+				       struct page *page) {}
+static inline bool workingset_refault(struct address_space *mapping,
+				      pgoff_t index)
+{
+	return false;
+}
+static inline void workingset_activation(struct page *page) {}
+#endif
+
+#endif /* _LINUX_WORKINGSET_H */
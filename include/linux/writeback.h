@@ -153,6 +153,13 @@ extern int dirty_bytes_handler(struct ctl_table *table, int write,
 struct ctl_table;
 int dirty_writeback_centisecs_handler(struct ctl_table *, int,
 				      void __user *, size_t *, loff_t *);
+#ifdef CONFIG_HAS_EARLYSUSPEND
+extern int dynamic_dirty_writeback;
+extern unsigned int dirty_writeback_active_interval;
+extern unsigned int dirty_writeback_suspend_interval;
+int dynamic_dirty_writeback_handler(struct ctl_table *, int,
+				    void __user *, size_t *, loff_t *);
+#endif
 
 void global_dirty_limits(unsigned long *pbackground, unsigned long *pdirty);
 unsigned long bdi_dirty_limit(struct backing_dev_info *bdi,
@@ -0,0 +1,280 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM dvfs
+
+#if !defined(_TRACE_DVFS_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_DVFS_H
+
+#include <linux/tracepoint.h>
+
+/*
+ * Decision loops of the cpufreq governors, the cpu hotplug policies and
+ * the bus frequency scaling. Each loop traces its inputs and what it
+ * decided, and the code that carries a decision out traces how long it
+ * took, so frequency and core count timelines can be lined up against
+ * everything else in a trace.
+ */
+
+/* This file can get included multiple times, TRACE_HEADER_MULTI_READ at top */
+#ifndef _DVFS_EVENT_AVOID_DOUBLE_DEFINING
+#define _DVFS_EVENT_AVOID_DOUBLE_DEFINING
+
+enum dvfs_reason {
+	DVFS_HOLD,
+	DVFS_UP,
+	DVFS_DOWN,
+	DVFS_BOOST,
+	DVFS_THERMAL,
+};
+#endif
+
+#define show_dvfs_reason(reason)				\
+	__print_symbolic(reason,				\
+			 { DVFS_HOLD,		"hold" },	\
+			 { DVFS_UP,		"up" },		\
+			 { DVFS_DOWN,		"down" },	\
+			 { DVFS_BOOST,		"boost" },	\
+			 { DVFS_THERMAL,	"thermal" })
+
+TRACE_EVENT(dvfs_governor,
+
+	TP_PROTO(const char *governor, unsigned int cpu, unsigned int load,
+		 unsigned int cur_freq, unsigned int target_freq,
+		 unsigned int threshold, int reason),
+
+	TP_ARGS(governor, cpu, load, cur_freq, target_freq, threshold, reason),
+
+	TP_STRUCT__entry(
+		__string(	governor,	governor	)
+		__field(	u32,		cpu		)
+		__field(	u32,		load		)
+		__field(	u32,		cur_freq	)
+		__field(	u32,		target_freq	)
+		__field(	u32,		threshold	)
+		__field(	int,		reason		)
+	),
+
+	TP_fast_assign(
+		__assign_str(governor, governor);
+		__entry->cpu = cpu;
+		__entry->load = load;
+		__entry->cur_freq = cur_freq;
+		__entry->target_freq = target_freq;
+		__entry->threshold = threshold;
+		__entry->reason = reason;
+	),
+
+	TP_printk("%s cpu=%u load=%u threshold=%u cur=%u target=%u reason=%s",
+		  __get_str(governor), __entry->cpu, __entry->load,
+		  __entry->threshold, __entry->cur_freq, __entry->target_freq,
+		  show_dvfs_reason(__entry->reason))
+);
+
+TRACE_EVENT(dvfs_freq_change,
+
+	TP_PROTO(unsigned int cpu, unsigned int target_freq,
+		 unsigned int old_freq, unsigned int new_freq, int ret,
+		 unsigned int latency_us),
+
+	TP_ARGS(cpu, target_freq, old_freq, new_freq, ret, latency_us),
+
+	TP_STRUCT__entry(
+		__field(	u32,		cpu		)
+		__field(	u32,		target_freq	)
+		__field(	u32,		old_freq	)
+		__field(	u32,		new_freq	)
+		__field(	int,		ret		)
+		__field(	u32,		latency_us	)
+	),
+
+	TP_fast_assign(
+		__entry->cpu = cpu;
+		__entry->target_freq = target_freq;
+		__entry->old_freq = old_freq;
+		__entry->new_freq = new_freq;
+		__entry->ret = ret;
+		__entry->latency_us = latency_us;
+	),
+
+	TP_printk("cpu=%u target=%u old=%u new=%u ret=%d latency_us=%u",
+		  __entry->cpu, __entry->target_freq, __entry->old_freq,
+		  __entry->new_freq, __entry->ret, __entry->latency_us)
+);
+
+/* rq values are runqueue averages in hundredths of a task */
+TRACE_EVENT(dvfs_hotplug_check,
+
+	TP_PROTO(const char *source, unsigned int online, unsigned int freq,
+		 unsigned int freq_threshold, unsigned int rq,
+		 unsigned int rq_threshold, int reason),
+
+	TP_ARGS(source, online, freq, freq_threshold, rq, rq_threshold, reason),
+
+	TP_STRUCT__entry(
+		__string(	source,		source		)
+		__field(	u32,		online		)
+		__field(	u32,		freq		)
+		__field(	u32,		freq_threshold	)
+		__field(	u32,		rq		)
+		__field(	u32,		rq_threshold	)
+		__field(	int,		reason		)
+	),
+
+	TP_fast_assign(
+		__assign_str(source, source);
+		__entry->online = online;
+		__entry->freq = freq;
+		__entry->freq_threshold = freq_threshold;
+		__entry->rq = rq;
+		__entry->rq_threshold = rq_threshold;
+		__entry->reason = reason;
+	),
+
+	TP_printk("%s online=%u freq=%u/%u rq=%u/%u reason=%s",
+		  __get_str(source), __entry->online, __entry->freq,
+		  __entry->freq_threshold, __entry->rq, __entry->rq_threshold,
+		  show_dvfs_reason(__entry->reason))
+);
+
+TRACE_EVENT(dvfs_hotplug_evaluate,
+
+	TP_PROTO(const char *policy, unsigned int online, unsigned int target,
+		 unsigned int load, unsigned int nr_running,
+		 unsigned int cur_freq),
+
+	TP_ARGS(policy, online, target, load, nr_running, cur_freq),
+
+	TP_STRUCT__entry(
+		__string(	policy,		policy		)
+		__field(	u32,		online		)
+		__field(	u32,		target		)
+		__field(	u32,		load		)
+		__field(	u32,		nr_running	)
+		__field(	u32,		cur_freq	)
+	),
+
+	TP_fast_assign(
+		__assign_str(policy, policy);
+		__entry->online = online;
+		__entry->target = target;
+		__entry->load = load;
+		__entry->nr_running = nr_running;
+		__entry->cur_freq = cur_freq;
+	),
+
+	TP_printk("%s online=%u target=%u load=%u nr_running=%u freq=%u",
+		  __get_str(policy), __entry->online, __entry->target,
+		  __entry->load, __entry->nr_running, __entry->cur_freq)
+);
+
+TRACE_EVENT(dvfs_hotplug_cpu,
+
+	TP_PROTO(unsigned int cpu, bool up, int ret, unsigned int latency_us),
+
+	TP_ARGS(cpu, up, ret, latency_us),
+
+	TP_STRUCT__entry(
+		__field(	u32,		cpu		)
+		__field(	bool,		up		)
+		__field(	int,		ret		)
+		__field(	u32,		latency_us	)
+	),
+
+	TP_fast_assign(
+		__entry->cpu = cpu;
+		__entry->up = up;
+		__entry->ret = ret;
+		__entry->latency_us = latency_us;
+	),
+
+	TP_printk("cpu=%u %s ret=%d latency_us=%u", __entry->cpu,
+		  __entry->up ? "up" : "down", __entry->ret,
+		  __entry->latency_us)
+);
+
+/* loads are in percent, frequencies as the OPP table has them */
+TRACE_EVENT(dvfs_busfreq,
+
+	TP_PROTO(unsigned int cpu_load, unsigned int dmc_load,
+		 unsigned int dmc_load_avg, unsigned long cpu_freq,
+		 unsigned long dmc_freq, unsigned long lock_freq,
+		 unsigned long new_freq),
+
+	TP_ARGS(cpu_load, dmc_load, dmc_load_avg, cpu_freq, dmc_freq,
+		lock_freq, new_freq),
+
+	TP_STRUCT__entry(
+		__field(	u32,		cpu_load	)
+		__field(	u32,		dmc_load	)
+		__field(	u32,		dmc_load_avg	)
+		__field(	unsigned long,	cpu_freq	)
+		__field(	unsigned long,	dmc_freq	)
+		__field(	unsigned long,	lock_freq	)
+		__field(	unsigned long,	new_freq	)
+	),
+
+	TP_fast_assign(
+		__entry->cpu_load = cpu_load;
+		__entry->dmc_load = dmc_load;
+		__entry->dmc_load_avg = dmc_load_avg;
+		__entry->cpu_freq = cpu_freq;
+		__entry->dmc_freq = dmc_freq;
+		__entry->lock_freq = lock_freq;
+		__entry->new_freq = new_freq;
+	),
+
+	TP_printk("cpu_load=%u dmc_load=%u dmc_avg=%u cpu=%lu dmc=%lu lock=%lu new=%lu",
+		  __entry->cpu_load, __entry->dmc_load, __entry->dmc_load_avg,
+		  __entry->cpu_freq, __entry->dmc_freq, __entry->lock_freq,
+		  __entry->new_freq)
+);
+
+TRACE_EVENT(dvfs_busfreq_change,
+
+	TP_PROTO(unsigned long old_freq, unsigned long new_freq,
+		 unsigned int latency_us),
+
+	TP_ARGS(old_freq, new_freq, latency_us),
+
+	TP_STRUCT__entry(
+		__field(	unsigned long,	old_freq	)
+		__field(	unsigned long,	new_freq	)
+		__field(	u32,		latency_us	)
+	),
+
+	TP_fast_assign(
+		__entry->old_freq = old_freq;
+		__entry->new_freq = new_freq;
+		__entry->latency_us = latency_us;
+	),
+
+	TP_printk("old=%lu new=%lu latency_us=%u", __entry->old_freq,
+		  __entry->new_freq, __entry->latency_us)
+);
+
+/* one PPMU window, load in percent of the cycles counted */
+TRACE_EVENT(dvfs_ppmu,
+
+	TP_PROTO(unsigned int id, unsigned int load, unsigned int ccnt),
+
+	TP_ARGS(id, load, ccnt),
+
+	TP_STRUCT__entry(
+		__field(	u32,		id		)
+		__field(	u32,		load		)
+		__field(	u32,		ccnt		)
+	),
+
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->load = load;
+		__entry->ccnt = ccnt;
+	),
+
+	TP_printk("ppmu=%u load=%u ccnt=%u", __entry->id, __entry->load,
+		  __entry->ccnt)
+);
+
+#endif /* _TRACE_DVFS_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -487,6 +487,8 @@ extern char __initramfs_start[];
 extern unsigned long __initramfs_size;
 #include <linux/initrd.h>
 #include <linux/kexec.h>
+#include <linux/async.h>
+#include <linux/ktime.h>
 
 static void __init free_initrd(void)
 {
@@ -569,8 +571,34 @@ static void __init clean_rootfs(void)
 }
 #endif
 
-static int __init populate_rootfs(void)
+/*
+ * The initramfs is unpacked from the async pool, alongside the device
+ * initcalls, instead of holding them up at rootfs level. Nothing in
+ * those needs the rootfs contents; usermode helpers and the start of
+ * init wait for it in wait_for_initramfs(). "initramfs_async=0" goes
+ * back to unpacking it in line.
+ */
+static bool initramfs_async = true;
+static LIST_HEAD(initramfs_domain);
+
+static int __init initramfs_async_setup(char *str)
+{
+	strtobool(str, &initramfs_async);
+	return 1;
+}
+__setup("initramfs_async=", initramfs_async_setup);
+
+void wait_for_initramfs(void)
+{
+	if (!initramfs_async)
+		return;
+	async_synchronize_full_domain(&initramfs_domain);
+}
+EXPORT_SYMBOL_GPL(wait_for_initramfs);
+
+static void __init do_populate_rootfs(void *unused, async_cookie_t cookie)
 {
+	ktime_t calltime = ktime_get();
 	char *err = unpack_to_rootfs(__initramfs_start, __initramfs_size);
 	if (err)
 		panic(err);	/* Failed to decompress INTERNAL initramfs */
@@ -582,7 +610,7 @@ static int __init populate_rootfs(void)
 			initrd_end - initrd_start);
 		if (!err) {
 			free_initrd();
-			return 0;
+			goto done;
 		} else {
 			clean_rootfs();
 			unpack_to_rootfs(__initramfs_start, __initramfs_size);
@@ -606,6 +634,18 @@ static int __init populate_rootfs(void)
 		free_initrd();
 #endif
 	}
+done:
+	printk(KERN_INFO "Initramfs unpacked in %lld usecs\n",
+	       ktime_to_us(ktime_sub(ktime_get(), calltime)));
+}
+
+static int __init populate_rootfs(void)
+{
+	if (initramfs_async)
+		async_schedule_domain(do_populate_rootfs, NULL,
+				      &initramfs_domain);
+	else
+		do_populate_rootfs(NULL, 0);
 	return 0;
 }
 rootfs_initcall(populate_rootfs);
@@ -70,6 +70,8 @@
 #include <linux/perf_event.h>
 #include <linux/random.h>
 #include <linux/boottime.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include <asm/io.h>
 #include <asm/bugs.h>
@@ -668,6 +670,71 @@ core_param(initcall_debug, initcall_debug, bool, 0644);
 
 static char msgbuf[64];
 
+/*
+ * Every built-in initcall is timed and the slowest ones are listed once
+ * the boot initcalls and the async probes behind them are done, so the
+ * candidates for deferring or probing asynchronously show up in a normal
+ * boot log. "initcall_report=0" turns it off.
+ */
+#define INITCALL_REPORT_MAX	32
+
+struct initcall_time {
+	initcall_t fn;
+	s64 usecs;
+};
+
+static struct initcall_time initcall_slowest[INITCALL_REPORT_MAX] __initdata;
+static s64 initcall_total_usecs __initdata;
+static unsigned int initcall_count __initdata;
+static unsigned int initcall_report_nr = 10;
+
+static int __init initcall_report_setup(char *str)
+{
+	int nr = 0;
+
+	get_option(&str, &nr);
+	initcall_report_nr = clamp(nr, 0, INITCALL_REPORT_MAX);
+	return 1;
+}
+__setup("initcall_report=", initcall_report_setup);
+
+/* only reached while initcall_report_nr says the table is still there */
+static void __ref initcall_record(initcall_t fn, s64 usecs)
+{
+	int i;
+
+	initcall_total_usecs += usecs;
+	initcall_count++;
+
+	for (i = initcall_report_nr - 1; i >= 0; i--) {
+		if (initcall_slowest[i].fn && initcall_slowest[i].usecs >= usecs)
+			break;
+		if (i + 1 < initcall_report_nr)
+			initcall_slowest[i + 1] = initcall_slowest[i];
+	}
+	if (++i < initcall_report_nr) {
+		initcall_slowest[i].fn = fn;
+		initcall_slowest[i].usecs = usecs;
+	}
+}
+
+static void __init initcall_report(void)
+{
+	unsigned int i;
+
+	if (!initcall_report_nr)
+		return;
+
+	printk(KERN_INFO "initcall: %u calls took %lld usecs\n",
+	       initcall_count, initcall_total_usecs);
+	for (i = 0; i < initcall_report_nr && initcall_slowest[i].fn; i++)
+		printk(KERN_INFO "initcall: %6lld usecs %pF\n",
+		       initcall_slowest[i].usecs, initcall_slowest[i].fn);
+
+	/* modules go through do_one_initcall() too, the table is gone by then */
+	initcall_report_nr = 0;
+}
+
 static int __init_or_module do_one_initcall_debug(initcall_t fn)
 {
 	ktime_t calltime, delta, rettime;
@@ -690,13 +757,17 @@ int __init_or_module do_one_initcall(initcall_t fn)
 {
 	int count = preempt_count();
 	int ret;
+	ktime_t calltime;
 
 	boottime_mark_symbolic(fn);
 
+	calltime = ktime_get();
 	if (initcall_debug)
 		ret = do_one_initcall_debug(fn);
 	else
 		ret = fn();
+	if (initcall_report_nr)
+		initcall_record(fn, ktime_to_us(ktime_sub(ktime_get(), calltime)));
 
 	msgbuf[0] = 0;
 
@@ -777,6 +848,158 @@ static void __init do_initcalls(void)
 		do_initcall_level(level);
 }
 
+#ifdef CONFIG_DEFERRED_INITCALLS
+/*
+ * Deferred initcalls keep the init sections alive until they have run,
+ * either when userspace writes to /proc/deferred_initcalls or when
+ * deferred_initcall_timeout seconds have passed since init started.
+ * Calls named in "initcall_nodefer=" run right after the boot initcalls
+ * instead and are cleared from the table, "all" runs every one of them.
+ */
+static char *initcall_nodefer __initdata;
+static int deferred_initcall_timeout = 60;
+static bool deferred_initcalls_done;
+static DEFINE_MUTEX(deferred_initcalls_lock);
+
+static int __init initcall_nodefer_setup(char *str)
+{
+	initcall_nodefer = str;
+	return 1;
+}
+__setup("initcall_nodefer=", initcall_nodefer_setup);
+
+static int __init deferred_initcall_timeout_setup(char *str)
+{
+	get_option(&str, &deferred_initcall_timeout);
+	return 1;
+}
+__setup("deferred_initcall_timeout=", deferred_initcall_timeout_setup);
+
+static bool __init initcall_nodefer_match(initcall_t fn)
+{
+	char name[KSYM_SYMBOL_LEN];
+	const char *p = initcall_nodefer;
+	size_t len;
+
+	if (!p)
+		return false;
+	if (!strcmp(p, "all"))
+		return true;
+
+	len = snprintf(name, sizeof(name), "%pf", fn);
+	while (p) {
+		if (!strncmp(p, name, len) && (p[len] == ',' || !p[len]))
+			return true;
+		p = strchr(p, ',');
+		if (p)
+			p++;
+	}
+	return false;
+}
+
+static void __init do_nodefer_initcalls(void)
+{
+	initcall_t *fn;
+
+	for (fn = __deferred_initcall_start; fn < __deferred_initcall_end; fn++) {
+		if (initcall_nodefer_match(*fn)) {
+			do_one_initcall(*fn);
+			*fn = NULL;
+		}
+	}
+}
+
+static bool __ref deferred_initcalls_pending(void)
+{
+	initcall_t *fn;
+
+	for (fn = __deferred_initcall_start; fn < __deferred_initcall_end; fn++)
+		if (*fn)
+			return true;
+	return false;
+}
+
+/* the table and the calls are init memory, freed right after they ran */
+static void __ref do_deferred_initcalls(void)
+{
+	initcall_t *fn;
+
+	mutex_lock(&deferred_initcalls_lock);
+	if (deferred_initcalls_done)
+		goto out;
+
+	pr_info("Running deferred initcalls\n");
+	for (fn = __deferred_initcall_start; fn < __deferred_initcall_end; fn++)
+		if (*fn)
+			do_one_initcall(*fn);
+
+	/* also picks up async probes the calls above started */
+	async_synchronize_full();
+	deferred_initcalls_done = true;
+	free_initmem();
+out:
+	mutex_unlock(&deferred_initcalls_lock);
+}
+
+static void deferred_initcalls_timeout_fn(struct work_struct *work)
+{
+	if (!deferred_initcalls_done)
+		pr_info("Deferred initcalls not triggered by userspace\n");
+	do_deferred_initcalls();
+}
+
+static DECLARE_DELAYED_WORK(deferred_initcalls_work,
+			    deferred_initcalls_timeout_fn);
+
+static ssize_t deferred_initcalls_write(struct file *file,
+					const char __user *buf, size_t count,
+					loff_t *ppos)
+{
+	do_deferred_initcalls();
+	return count;
+}
+
+static ssize_t deferred_initcalls_read(struct file *file, char __user *buf,
+				       size_t count, loff_t *ppos)
+{
+	char tmp[4];
+	int len = sprintf(tmp, "%d\n", deferred_initcalls_done);
+
+	return simple_read_from_buffer(buf, count, ppos, tmp, len);
+}
+
+static const struct file_operations deferred_initcalls_fops = {
+	.read		= deferred_initcalls_read,
+	.write		= deferred_initcalls_write,
+	.llseek		= default_llseek,
+};
+
+/* called from init_post() in place of free_initmem() */
+static void deferred_initcalls_start(void)
+{
+	if (!deferred_initcalls_pending()) {
+		deferred_initcalls_done = true;
+		free_initmem();
+		return;
+	}
+
+	proc_create("deferred_initcalls", S_IRUGO | S_IWUSR, NULL,
+		    &deferred_initcalls_fops);
+	if (deferred_initcall_timeout > 0)
+		schedule_delayed_work(&deferred_initcalls_work,
+				      deferred_initcall_timeout * HZ);
+}
+#else
+static inline void do_nodefer_initcalls(void)
+{
+}
+
+static inline void deferred_initcalls_start(void)
+{
+	free_initmem();
+}
+#endif
+
 /*
  * Ok, the machine is now initialized. None of the devices
  * have been touched yet, but the CPU subsystem is up and
@@ -794,6 +1017,7 @@ static void __init do_basic_setup(void)
 	do_ctors();
 	usermodehelper_enable();
 	do_initcalls();
+	do_nodefer_initcalls();
 	random_int_secret_init();
 }
 
@@ -821,7 +1045,7 @@ static noinline int init_post(void)
 	/* need to finish all async __init code before freeing the memory */
 	async_synchronize_full();
 	boottime_deactivate();
-	free_initmem();
+	deferred_initcalls_start();
 	mark_rodata_ro();
 	system_state = SYSTEM_RUNNING;
 	numa_default_policy();
@@ -887,6 +1111,9 @@ static int __init kernel_init(void * unused)
 
 	do_basic_setup();
 
+	/* the rootfs may still be being unpacked in the background */
+	wait_for_initramfs();
+
 	/* Open the /dev/console on the rootfs, this should never fail */
 	if (sys_open((const char __user *) "/dev/console", O_RDWR, 0) < 0)
 		printk(KERN_WARNING "Warning: unable to open an initial console.\n");
@@ -907,6 +1134,16 @@ static int __init kernel_init(void * unused)
 		prepare_namespace();
 	}
 
+	/*
+	 * Drivers that probe asynchronously may still be running here; the
+	 * report waits for them so their time shows up as the gap between
+	 * the sum of the initcalls and the boot time.
+	 */
+	if (initcall_report_nr) {
+		async_synchronize_full();
+		initcall_report();
+	}
+
 	/*
 	 * Ok, we have completed the initial bootup, and
 	 * we're essentially up and running. Get rid of the
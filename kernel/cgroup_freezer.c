@@ -21,6 +21,7 @@
 #include <linux/uaccess.h>
 #include <linux/freezer.h>
 #include <linux/seq_file.h>
+#include <linux/ktime.h>
 
 enum freezer_state {
 	CGROUP_THAWED = 0,
@@ -28,10 +29,22 @@ enum freezer_state {
 	CGROUP_FROZEN,
 };
 
+/* how long freezing all tasks or thawing them took, in microseconds */
+struct freezer_stat {
+	unsigned int count;
+	u64 last_us;
+	u64 max_us;
+	u64 total_us;
+};
+
 struct freezer {
 	struct cgroup_subsys_state css;
 	enum freezer_state state;
 	spinlock_t lock; /* protects _writes_ to state */
+	int nr_to_freeze; /* tasks asked to freeze that haven't yet */
+	ktime_t freeze_start;
+	struct freezer_stat freeze_stat;
+	struct freezer_stat thaw_stat;
 };
 
 static inline struct freezer *cgroup_freezer(
@@ -104,6 +117,10 @@ struct cgroup_subsys freezer_subsys;
  * freezer->lock
  *  sighand->siglock (if the cgroup is freezing)
  *
+ * cgroup_freezer_frozen() (from the refrigerator, without cgroup_mutex):
+ * freezer->lock
+ *  read_lock css_set_lock (cgroup iterator start, once the last task froze)
+ *
  * freezer_read():
  * cgroup_mutex
  *  freezer->lock
@@ -204,11 +221,22 @@ static void freezer_fork(struct cgroup_subsys *ss, struct task_struct *task)
 	BUG_ON(freezer->state == CGROUP_FROZEN);
 
 	/* Locking avoids race with FREEZING -> THAWED transitions. */
-	if (freezer->state == CGROUP_FREEZING)
-		freeze_task(task);
+	if (freezer->state == CGROUP_FREEZING && freeze_task(task))
+		freezer->nr_to_freeze++;
 	spin_unlock_irq(&freezer->lock);
 }
 
+static void freezer_stat_add(struct freezer_stat *stat, ktime_t start)
+{
+	u64 us = ktime_us_delta(ktime_get(), start);
+
+	stat->count++;
+	stat->last_us = us;
+	stat->total_us += us;
+	if (us > stat->max_us)
+		stat->max_us = us;
+}
+
 /*
  * caller must hold freezer->lock
  */
@@ -230,8 +258,11 @@ static void update_if_frozen(struct cgroup *cgroup,
 	if (old_state == CGROUP_THAWED) {
 		BUG_ON(nfrozen > 0);
 	} else if (old_state == CGROUP_FREEZING) {
-		if (nfrozen == ntotal)
+		if (nfrozen == ntotal) {
 			freezer->state = CGROUP_FROZEN;
+			freezer_stat_add(&freezer->freeze_stat,
+					 freezer->freeze_start);
+		}
 	} else { /* old_state == CGROUP_FROZEN */
 		BUG_ON(nfrozen != ntotal);
 	}
@@ -239,6 +270,40 @@ static void update_if_frozen(struct cgroup *cgroup,
 	cgroup_iter_end(cgroup, &it);
 }
 
+/*
+ * Called by a task of a freezing cgroup once it is in the refrigerator.
+ * Freezing happens as each task is about to return to user space, the
+ * last one to get there moves the cgroup to FROZEN, without anyone
+ * having to poll freezer.state for it.
+ */
+void cgroup_freezer_frozen(struct task_struct *task)
+{
+	struct freezer *freezer;
+	unsigned long flags;
+
+	/*
+	 * The task can't be moved while it is freezing and the cgroup
+	 * isn't destroyed before an RCU grace period after its last task
+	 * left, so holding the RCU read lock is enough to keep the
+	 * freezer around.
+	 */
+	rcu_read_lock();
+	freezer = task_freezer(task);
+	if (!freezer->css.cgroup->parent)
+		goto out;
+
+	spin_lock_irqsave(&freezer->lock, flags);
+	/*
+	 * Tasks frozen by an earlier write can make the count go below
+	 * zero, update_if_frozen() has the final word either way.
+	 */
+	if (freezer->state == CGROUP_FREEZING && --freezer->nr_to_freeze <= 0)
+		update_if_frozen(freezer->css.cgroup, freezer);
+	spin_unlock_irqrestore(&freezer->lock, flags);
+out:
+	rcu_read_unlock();
+}
+
 static int freezer_read(struct cgroup *cgroup, struct cftype *cft,
 			struct seq_file *m)
 {
@@ -271,12 +336,14 @@ static int try_to_freeze_cgroup(struct cgroup *cgroup, struct freezer *freezer)
 	struct task_struct *task;
 	unsigned int num_cant_freeze_now = 0;
 
+	freezer->nr_to_freeze = 0;
 	cgroup_iter_start(cgroup, &it);
 	while ((task = cgroup_iter_next(cgroup, &it))) {
 		if (!freeze_task(task))
 			continue;
 		if (frozen(task))
 			continue;
+		freezer->nr_to_freeze++;
 		if (!freezing(task) && !freezer_should_skip(task))
 			num_cant_freeze_now++;
 	}
@@ -300,26 +367,44 @@ static int freezer_change_state(struct cgroup *cgroup,
 				enum freezer_state goal_state)
 {
 	struct freezer *freezer;
+	ktime_t start;
 	int retval = 0;
 
 	freezer = cgroup_freezer(cgroup);
 
 	spin_lock_irq(&freezer->lock);
 
-	update_if_frozen(cgroup, freezer);
+	/*
+	 * Only a freezing cgroup can have changed state behind our back,
+	 * a thawed or frozen one is left alone when asked for the state
+	 * it is in already, which keeps repeated writes from background
+	 * app management cheap.
+	 */
+	if (freezer->state == CGROUP_FREEZING)
+		update_if_frozen(cgroup, freezer);
 
 	switch (goal_state) {
 	case CGROUP_THAWED:
-		if (freezer->state != CGROUP_THAWED)
-			atomic_dec(&system_freezing_cnt);
+		if (freezer->state == CGROUP_THAWED)
+			break;
+		atomic_dec(&system_freezing_cnt);
 		freezer->state = CGROUP_THAWED;
+		start = ktime_get();
 		unfreeze_cgroup(cgroup, freezer);
+		freezer_stat_add(&freezer->thaw_stat, start);
 		break;
 	case CGROUP_FROZEN:
-		if (freezer->state == CGROUP_THAWED)
+		if (freezer->state == CGROUP_FROZEN)
+			break;
+		if (freezer->state == CGROUP_THAWED) {
 			atomic_inc(&system_freezing_cnt);
+			freezer->freeze_start = ktime_get();
+		}
 		freezer->state = CGROUP_FREEZING;
 		retval = try_to_freeze_cgroup(cgroup, freezer);
+		/* nothing left to wait for, don't make anyone read the state */
+		if (!freezer->nr_to_freeze)
+			update_if_frozen(cgroup, freezer);
 		break;
 	default:
 		BUG();
@@ -351,12 +436,41 @@ static int freezer_write(struct cgroup *cgroup,
 	return retval;
 }
 
+static void freezer_stat_show(struct seq_file *m, const char *name,
+			      struct freezer_stat *stat)
+{
+	seq_printf(m, "%s_count %u\n", name, stat->count);
+	seq_printf(m, "%s_last_us %llu\n", name, stat->last_us);
+	seq_printf(m, "%s_max_us %llu\n", name, stat->max_us);
+	seq_printf(m, "%s_total_us %llu\n", name, stat->total_us);
+}
+
+static int freezer_stat_read(struct cgroup *cgroup, struct cftype *cft,
+			     struct seq_file *m)
+{
+	struct freezer *freezer = cgroup_freezer(cgroup);
+	struct freezer_stat freeze_stat, thaw_stat;
+
+	spin_lock_irq(&freezer->lock);
+	freeze_stat = freezer->freeze_stat;
+	thaw_stat = freezer->thaw_stat;
+	spin_unlock_irq(&freezer->lock);
+
+	freezer_stat_show(m, "freeze", &freeze_stat);
+	freezer_stat_show(m, "thaw", &thaw_stat);
+	return 0;
+}
+
 static struct cftype files[] = {
 	{
 		.name = "state",
 		.read_seq_string = freezer_read,
 		.write_string = freezer_write,
 	},
+	{
+		.name = "stat",
+		.read_seq_string = freezer_stat_read,
+	},
 };
 
 static int freezer_populate(struct cgroup_subsys *ss, struct cgroup *cgroup)
@@ -15,6 +15,7 @@
  * GNU General Public License for more details.
  */
 #include <linux/cgroup.h>
+#include <linux/earlysuspend.h>
 #include <linux/init_task.h>
 #include <linux/module.h>
 #include <linux/slab.h>
@@ -25,6 +26,8 @@ struct timer_slack_cgroup {
 	struct cgroup_subsys_state css;
 	unsigned long min_slack_ns;
 	unsigned long max_slack_ns;
+	/* slack at least this large for non-RT tasks while the screen is off */
+	unsigned long screen_off_slack_ns;
 };
 
 enum {
@@ -69,6 +72,45 @@ static int cgroup_timer_slack_check(struct task_struct *task,
 	return 0;
 }
 
+/*
+ * Installed as timer_slack_adjust while the screen is off only, so timers
+ * armed with the screen on pay nothing for it.
+ */
+static unsigned long cgroup_timer_slack_adjust(struct task_struct *task,
+		unsigned long slack_ns)
+{
+	struct cgroup_subsys_state *css;
+	unsigned long screen_off_slack_ns;
+
+	if (rt_task(task))
+		return slack_ns;
+
+	rcu_read_lock();
+	css = task_subsys_state(task, timer_slack_subsys.subsys_id);
+	screen_off_slack_ns = container_of(css, struct timer_slack_cgroup,
+					   css)->screen_off_slack_ns;
+	rcu_read_unlock();
+
+	return max(slack_ns, screen_off_slack_ns);
+}
+
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static void tslack_early_suspend(struct early_suspend *h)
+{
+	timer_slack_adjust = cgroup_timer_slack_adjust;
+}
+
+static void tslack_late_resume(struct early_suspend *h)
+{
+	timer_slack_adjust = NULL;
+}
+
+static struct early_suspend tslack_early_suspend_handler = {
+	.suspend = tslack_early_suspend,
+	.resume = tslack_late_resume,
+};
+#endif
+
 static struct cgroup_subsys_state *
 tslack_cgroup_create(struct cgroup_subsys *subsys, struct cgroup *cgroup)
 {
@@ -83,9 +125,12 @@ tslack_cgroup_create(struct cgroup_subsys *subsys, struct cgroup *cgroup)
 		parent = cgroup_to_tslack_cgroup(cgroup->parent);
 		tslack_cgroup->min_slack_ns = parent->min_slack_ns;
 		tslack_cgroup->max_slack_ns = parent->max_slack_ns;
+		tslack_cgroup->screen_off_slack_ns =
+			parent->screen_off_slack_ns;
 	} else {
 		tslack_cgroup->min_slack_ns = 0UL;
 		tslack_cgroup->max_slack_ns = ULONG_MAX;
+		tslack_cgroup->screen_off_slack_ns = 0UL;
 	}
 
 	return &tslack_cgroup->css;
@@ -157,6 +202,25 @@ static u64 tslack_read_range(struct cgroup *cgroup, struct cftype *cft)
 	};
 }
 
+static u64 tslack_read_screen_off_slack_ns(struct cgroup *cgroup,
+		struct cftype *cft)
+{
+	return cgroup_to_tslack_cgroup(cgroup)->screen_off_slack_ns;
+}
+
+static int tslack_write_screen_off_slack_ns(struct cgroup *cgroup,
+		struct cftype *cft, u64 val)
+{
+	struct timer_slack_cgroup *tslack_cgroup;
+
+	tslack_cgroup = cgroup_to_tslack_cgroup(cgroup);
+	if (val > tslack_cgroup->max_slack_ns)
+		return -EPERM;
+
+	tslack_cgroup->screen_off_slack_ns = val;
+	return 0;
+}
+
 static int validate_change(struct cgroup *cgroup, u64 val, int type)
 {
 	struct timer_slack_cgroup *tslack_cgroup, *child;
@@ -235,6 +299,11 @@ static struct cftype files[] = {
 		.read_u64 = tslack_read_range,
 		.write_u64 = tslack_write_range,
 	},
+	{
+		.name = "screen_off_slack_ns",
+		.read_u64 = tslack_read_screen_off_slack_ns,
+		.write_u64 = tslack_write_screen_off_slack_ns,
+	},
 };
 
 static int tslack_cgroup_populate(struct cgroup_subsys *subsys,
@@ -264,14 +333,23 @@ static int __init init_cgroup_timer_slack(void)
 	timer_slack_check = cgroup_timer_slack_check;
 
 	err = cgroup_load_subsys(&timer_slack_subsys);
-	if (err)
+	if (err) {
 		timer_slack_check = NULL;
-	return err;
+		return err;
+	}
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	register_early_suspend(&tslack_early_suspend_handler);
+#endif
+	return 0;
 }
 
 static void __exit exit_cgroup_timer_slack(void)
 {
 	BUG_ON(timer_slack_check != cgroup_timer_slack_check);
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	unregister_early_suspend(&tslack_early_suspend_handler);
+#endif
+	timer_slack_adjust = NULL;
 	timer_slack_check = NULL;
 	cgroup_unload_subsys(&timer_slack_subsys);
 }
@@ -93,6 +93,8 @@ struct cpuset {
 
 	unsigned long flags;		/* "unsigned long" so bitops work */
 	cpumask_var_t cpus_allowed;	/* CPUs allowed to tasks in cpuset */
+	cpumask_var_t cpus_requested;	/* CPUs written to "cpus", hotplug
+					   doesn't touch them */
 	nodemask_t mems_allowed;	/* Memory Nodes allowed to tasks */
 
 	struct cpuset *parent;		/* my parent */
@@ -367,7 +369,13 @@ static struct cpuset *alloc_trial_cpuset(const struct cpuset *cs)
 		kfree(trial);
 		return NULL;
 	}
+	if (!alloc_cpumask_var(&trial->cpus_requested, GFP_KERNEL)) {
+		free_cpumask_var(trial->cpus_allowed);
+		kfree(trial);
+		return NULL;
+	}
 	cpumask_copy(trial->cpus_allowed, cs->cpus_allowed);
+	cpumask_copy(trial->cpus_requested, cs->cpus_requested);
 
 	return trial;
 }
@@ -378,6 +386,7 @@ static struct cpuset *alloc_trial_cpuset(const struct cpuset *cs)
  */
 static void free_trial_cpuset(struct cpuset *trial)
 {
+	free_cpumask_var(trial->cpus_requested);
 	free_cpumask_var(trial->cpus_allowed);
 	kfree(trial);
 }
@@ -425,13 +434,14 @@ static int validate_change(const struct cpuset *cur, const struct cpuset *trial)
 
 	/*
 	 * If either I or some sibling (!= me) is exclusive, we can't
-	 * overlap
+	 * overlap.  The requested cpus are compared, so bringing cpus
+	 * back online can't make exclusive siblings overlap.
 	 */
 	list_for_each_entry(cont, &par->css.cgroup->children, sibling) {
 		c = cgroup_cs(cont);
 		if ((is_cpu_exclusive(trial) || is_cpu_exclusive(c)) &&
 		    c != cur &&
-		    cpumask_intersects(trial->cpus_allowed, c->cpus_allowed))
+		    cpumask_intersects(trial->cpus_requested, c->cpus_requested))
 			return -EINVAL;
 		if ((is_mem_exclusive(trial) || is_mem_exclusive(c)) &&
 		    c != cur &&
@@ -876,24 +886,35 @@ static int update_cpumask(struct cpuset *cs, struct cpuset *trialcs,
 	 * Since cpulist_parse() fails on an empty mask, we special case
 	 * that parsing.  The validate_change() call ensures that cpusets
 	 * with tasks have cpus.
+	 *
+	 * The cpus written are kept as they are in cpus_requested, and
+	 * may name cpus that are offline right now; cpus_allowed is the
+	 * part of them that is active, and hotplug recomputes it from
+	 * cpus_requested both ways.
 	 */
 	if (!*buf) {
-		cpumask_clear(trialcs->cpus_allowed);
+		cpumask_clear(trialcs->cpus_requested);
 	} else {
-		retval = cpulist_parse(buf, trialcs->cpus_allowed);
+		retval = cpulist_parse(buf, trialcs->cpus_requested);
 		if (retval < 0)
 			return retval;
 
-		if (!cpumask_subset(trialcs->cpus_allowed, cpu_active_mask))
+		if (!cpumask_subset(trialcs->cpus_requested, cpu_present_mask))
 			return -EINVAL;
 	}
+	cpumask_and(trialcs->cpus_allowed, trialcs->cpus_requested,
+		    cpu_active_mask);
 	retval = validate_change(cs, trialcs);
 	if (retval < 0)
 		return retval;
 
-	/* Nothing to do if the cpus didn't change */
-	if (cpumask_equal(cs->cpus_allowed, trialcs->cpus_allowed))
+	/* Nothing to do if the active cpus didn't change */
+	if (cpumask_equal(cs->cpus_allowed, trialcs->cpus_allowed)) {
+		mutex_lock(&callback_mutex);
+		cpumask_copy(cs->cpus_requested, trialcs->cpus_requested);
+		mutex_unlock(&callback_mutex);
 		return 0;
+	}
 
 	retval = heap_init(&heap, PAGE_SIZE, GFP_KERNEL, NULL);
 	if (retval)
@@ -903,6 +924,7 @@ static int update_cpumask(struct cpuset *cs, struct cpuset *trialcs,
 
 	mutex_lock(&callback_mutex);
 	cpumask_copy(cs->cpus_allowed, trialcs->cpus_allowed);
+	cpumask_copy(cs->cpus_requested, trialcs->cpus_requested);
 	mutex_unlock(&callback_mutex);
 
 	/*
@@ -1461,6 +1483,7 @@ static void cpuset_attach(struct cgroup_subsys *ss, struct cgroup *cgrp,
 typedef enum {
 	FILE_MEMORY_MIGRATE,
 	FILE_CPULIST,
+	FILE_EFFECTIVE_CPULIST,
 	FILE_MEMLIST,
 	FILE_CPU_EXCLUSIVE,
 	FILE_MEM_EXCLUSIVE,
@@ -1588,12 +1611,14 @@ out:
  * across a page fault.
  */
 
-static size_t cpuset_sprintf_cpulist(char *page, struct cpuset *cs)
+static size_t cpuset_sprintf_cpulist(char *page, struct cpuset *cs,
+				     bool effective)
 {
 	size_t count;
 
 	mutex_lock(&callback_mutex);
-	count = cpulist_scnprintf(page, PAGE_SIZE, cs->cpus_allowed);
+	count = cpulist_scnprintf(page, PAGE_SIZE, effective ?
+				  cs->cpus_allowed : cs->cpus_requested);
 	mutex_unlock(&callback_mutex);
 
 	return count;
@@ -1629,7 +1654,10 @@ static ssize_t cpuset_common_file_read(struct cgroup *cont,
 
 	switch (type) {
 	case FILE_CPULIST:
-		s += cpuset_sprintf_cpulist(s, cs);
+		s += cpuset_sprintf_cpulist(s, cs, false);
+		break;
+	case FILE_EFFECTIVE_CPULIST:
+		s += cpuset_sprintf_cpulist(s, cs, true);
 		break;
 	case FILE_MEMLIST:
 		s += cpuset_sprintf_memlist(s, cs);
@@ -1706,6 +1734,12 @@ static struct cftype files[] = {
 		.private = FILE_CPULIST,
 	},
 
+	{
+		.name = "effective_cpus",
+		.read = cpuset_common_file_read,
+		.private = FILE_EFFECTIVE_CPULIST,
+	},
+
 	{
 		.name = "mems",
 		.read = cpuset_common_file_read,
@@ -1834,6 +1868,7 @@ static void cpuset_post_clone(struct cgroup_subsys *ss,
 	mutex_lock(&callback_mutex);
 	cs->mems_allowed = parent_cs->mems_allowed;
 	cpumask_copy(cs->cpus_allowed, parent_cs->cpus_allowed);
+	cpumask_copy(cs->cpus_requested, parent_cs->cpus_requested);
 	mutex_unlock(&callback_mutex);
 	return;
 }
@@ -1862,6 +1897,11 @@ static struct cgroup_subsys_state *cpuset_create(
 		kfree(cs);
 		return ERR_PTR(-ENOMEM);
 	}
+	if (!alloc_cpumask_var(&cs->cpus_requested, GFP_KERNEL)) {
+		free_cpumask_var(cs->cpus_allowed);
+		kfree(cs);
+		return ERR_PTR(-ENOMEM);
+	}
 
 	cs->flags = 0;
 	if (is_spread_page(parent))
@@ -1870,6 +1910,7 @@ static struct cgroup_subsys_state *cpuset_create(
 		set_bit(CS_SPREAD_SLAB, &cs->flags);
 	set_bit(CS_SCHED_LOAD_BALANCE, &cs->flags);
 	cpumask_clear(cs->cpus_allowed);
+	cpumask_clear(cs->cpus_requested);
 	nodes_clear(cs->mems_allowed);
 	fmeter_init(&cs->fmeter);
 	cs->relax_domain_level = -1;
@@ -1893,6 +1934,7 @@ static void cpuset_destroy(struct cgroup_subsys *ss, struct cgroup *cont)
 		update_flag(CS_SCHED_LOAD_BALANCE, cs, 0);
 
 	number_of_cpusets--;
+	free_cpumask_var(cs->cpus_requested);
 	free_cpumask_var(cs->cpus_allowed);
 	kfree(cs);
 }
@@ -1921,8 +1963,11 @@ int __init cpuset_init(void)
 
 	if (!alloc_cpumask_var(&top_cpuset.cpus_allowed, GFP_KERNEL))
 		BUG();
+	if (!alloc_cpumask_var(&top_cpuset.cpus_requested, GFP_KERNEL))
+		BUG();
 
 	cpumask_setall(top_cpuset.cpus_allowed);
+	cpumask_setall(top_cpuset.cpus_requested);
 	nodes_setall(top_cpuset.mems_allowed);
 
 	fmeter_init(&top_cpuset.fmeter);
@@ -2017,15 +2062,23 @@ static void remove_tasks_in_empty_cpuset(struct cpuset *cs)
 }
 
 /*
- * Walk the specified cpuset subtree and look for empty cpusets.
+ * Walk the specified cpuset subtree, bring every cpuset's cpus_allowed
+ * in line with the active cpus and look for empty cpusets.
  * The tasks of such cpuset must be moved to a parent cpuset.
  *
+ * cpus_allowed is recomputed from cpus_requested rather than only
+ * trimmed, so cpus coming back online return to every cpuset that asked
+ * for them.  Without that, each cycle of the cpu hotplug governors
+ * shrank the cpusets a little more, until background groups were left
+ * on cpu0 for good.
+ *
  * Called with cgroup_mutex held.  We take callback_mutex to modify
  * cpus_allowed and mems_allowed.
  *
  * This walk processes the tree from top to bottom, completing one layer
  * before dropping down to the next.  It always processes a node before
- * any of its children.
+ * any of its children, so a parent's cpus are up to date by the time
+ * its children are restored against them.
  *
  * For now, since we lack memory hot unplug, we'll never see a cpuset
  * that has tasks along with an empty 'mems'.  But if we did see such
@@ -2038,6 +2091,7 @@ static void scan_for_empty_cpusets(struct cpuset *root)
 	struct cpuset *child;	/* scans child cpusets of cp */
 	struct cgroup *cont;
 	static nodemask_t oldmems;	/* protected by cgroup_mutex */
+	static cpumask_t newcpus;	/* protected by cgroup_mutex */
 
 	list_add_tail((struct list_head *)&root->stack_list, &queue);
 
@@ -2049,17 +2103,24 @@ static void scan_for_empty_cpusets(struct cpuset *root)
 			list_add_tail(&child->stack_list, &queue);
 		}
 
-		/* Continue past cpusets with all cpus, mems online */
-		if (cpumask_subset(cp->cpus_allowed, cpu_active_mask) &&
+		/* the top cpuset was set to the active cpus by our caller */
+		if (cp == &top_cpuset)
+			cpumask_copy(&newcpus, cp->cpus_allowed);
+		else
+			cpumask_and(&newcpus, cp->cpus_requested,
+				    cp->parent->cpus_allowed);
+		cpumask_and(&newcpus, &newcpus, cpu_active_mask);
+
+		/* Continue past cpusets whose cpus and mems are unchanged */
+		if (cpumask_equal(cp->cpus_allowed, &newcpus) &&
 		    nodes_subset(cp->mems_allowed, node_states[N_HIGH_MEMORY]))
 			continue;
 
 		oldmems = cp->mems_allowed;
 
-		/* Remove offline cpus and mems from this cpuset. */
+		/* Restore requested cpus, remove offline ones and mems. */
 		mutex_lock(&callback_mutex);
-		cpumask_and(cp->cpus_allowed, cp->cpus_allowed,
-			    cpu_active_mask);
+		cpumask_copy(cp->cpus_allowed, &newcpus);
 		nodes_and(cp->mems_allowed, cp->mems_allowed,
 						node_states[N_HIGH_MEMORY]);
 		mutex_unlock(&callback_mutex);
@@ -2099,6 +2160,7 @@ void cpuset_update_active_cpus(void)
 	cgroup_lock();
 	mutex_lock(&callback_mutex);
 	cpumask_copy(top_cpuset.cpus_allowed, cpu_active_mask);
+	cpumask_copy(top_cpuset.cpus_requested, cpu_active_mask);
 	mutex_unlock(&callback_mutex);
 	scan_for_empty_cpusets(&top_cpuset);
 	ndoms = generate_sched_domains(&doms, &attr);
@@ -2153,6 +2215,7 @@ static int cpuset_track_online_nodes(struct notifier_block *self,
 void __init cpuset_init_smp(void)
 {
 	cpumask_copy(top_cpuset.cpus_allowed, cpu_active_mask);
+	cpumask_copy(top_cpuset.cpus_requested, cpu_active_mask);
 	top_cpuset.mems_allowed = node_states[N_HIGH_MEMORY];
 
 	hotplug_memory_notifier(cpuset_track_online_nodes, 10);
@@ -71,6 +71,8 @@ bool __refrigerator(bool check_kthr_stop)
 
 		if (!(current->flags & PF_FROZEN))
 			break;
+		if (!was_frozen)
+			cgroup_freezer_frozen(current);
 		was_frozen = true;
 		schedule();
 	}
@@ -61,6 +61,8 @@
 #include <linux/nsproxy.h>
 #include <linux/ptrace.h>
 #include <linux/hugetlb.h>
+#include <linux/bootmem.h>
+#include <linux/log2.h>
 
 #include <asm/futex.h>
 
@@ -68,8 +70,6 @@
 
 int __read_mostly futex_cmpxchg_enabled;
 
-#define FUTEX_HASHBITS (CONFIG_BASE_SMALL ? 4 : 8)
-
 /*
  * Futex flags used to encode options to functions and preserve them across
  * restarts.
@@ -149,7 +149,52 @@ struct futex_hash_bucket {
 	struct plist_head chain;
 };
 
-static struct futex_hash_bucket futex_queues[1<<FUTEX_HASHBITS];
+static struct futex_hash_bucket *futex_queues __read_mostly;
+static unsigned long futex_hashsize __read_mostly;
+
+static void futex_hash_init(struct futex_hash_bucket *hb, unsigned long size)
+{
+	unsigned long i;
+
+	for (i = 0; i < size; i++) {
+		plist_head_init(&hb[i].chain);
+		spin_lock_init(&hb[i].lock);
+	}
+}
+
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+/*
+ * A multithreaded process hashes its private futexes in a table of its
+ * own, so its waiters never share a bucket lock with another process.
+ * The table is set up when the first thread is cloned, while no task can
+ * be queued on one of the process' private futexes, and stays until the
+ * mm goes away. If it cannot be allocated then, the process keeps using
+ * the global table for good: switching tables under a waiter would lose
+ * its wakeup.
+ */
+void futex_mm_hash_alloc(struct mm_struct *mm)
+{
+	struct futex_hash_bucket *hb;
+	unsigned int size;
+
+	if (mm->futex_hash || atomic_read(&mm->mm_users) != 1)
+		return;
+
+	size = roundup_pow_of_two(16 * num_possible_cpus());
+	hb = kmalloc(size * sizeof(*hb), GFP_KERNEL | __GFP_NOWARN);
+	if (!hb)
+		return;
+
+	futex_hash_init(hb, size);
+	mm->futex_hash_mask = size - 1;
+	mm->futex_hash = hb;
+}
+
+void futex_mm_hash_free(struct mm_struct *mm)
+{
+	kfree(mm->futex_hash);
+}
+#endif
 
 /*
  * We hash on the keys returned from get_futex_key (see below).
@@ -159,7 +204,15 @@ static struct futex_hash_bucket *hash_futex(union futex_key *key)
 	u32 hash = jhash2((u32*)&key->both.word,
 			  (sizeof(key->both.word)+sizeof(key->both.ptr))/4,
 			  key->both.offset);
-	return &futex_queues[hash & ((1 << FUTEX_HASHBITS)-1)];
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+	struct mm_struct *mm = key->private.mm;
+
+	/* neither FUT_OFF_INODE nor FUT_OFF_MMSHARED: process private */
+	if (!(key->both.offset & (FUT_OFF_INODE | FUT_OFF_MMSHARED)) &&
+	    mm->futex_hash)
+		return &mm->futex_hash[hash & mm->futex_hash_mask];
+#endif
+	return &futex_queues[hash & (futex_hashsize - 1)];
 }
 
 /*
@@ -2106,7 +2159,7 @@ static int futex_wait(u32 __user *uaddr, unsigned int flags, u32 val,
 				      HRTIMER_MODE_ABS);
 		hrtimer_init_sleeper(to, current);
 		hrtimer_set_expires_range_ns(&to->timer, *abs_time,
-					     current->timer_slack_ns);
+					     task_timer_slack_ns(current));
 	}
 
 retry:
@@ -2502,7 +2555,7 @@ static int futex_wait_requeue_pi(u32 __user *uaddr, unsigned int flags,
 				      HRTIMER_MODE_ABS);
 		hrtimer_init_sleeper(to, current);
 		hrtimer_set_expires_range_ns(&to->timer, *abs_time,
-					     current->timer_slack_ns);
+					     task_timer_slack_ns(current));
 	}
 
 	/*
@@ -2937,8 +2990,9 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 
 static int __init futex_init(void)
 {
+	unsigned int futex_shift;
+	unsigned long size;
 	u32 curval;
-	int i;
 
 	/*
 	 * This will fail and we want it. Some arch implementations do
@@ -2953,10 +3007,22 @@ static int __init futex_init(void)
 	if (cmpxchg_futex_value_locked(&curval, NULL, 0, 0) == -EFAULT)
 		futex_cmpxchg_enabled = 1;
 
-	for (i = 0; i < ARRAY_SIZE(futex_queues); i++) {
-		plist_head_init(&futex_queues[i].chain);
-		spin_lock_init(&futex_queues[i].lock);
-	}
+	/*
+	 * Every cpu can have waiters of its own being queued and woken, so
+	 * scale the table with the cpus, but keep it to one bucket for every
+	 * 16 pages of memory on small systems.
+	 */
+#if CONFIG_BASE_SMALL
+	size = 16;
+#else
+	size = roundup_pow_of_two(256 * num_possible_cpus());
+	size = min(size, roundup_pow_of_two(max(totalram_pages / 16, 16UL)));
+#endif
+	futex_queues = alloc_large_system_hash("futex", sizeof(*futex_queues),
+					       size, 0, 0, &futex_shift, NULL,
+					       size);
+	futex_hashsize = 1UL << futex_shift;
+	futex_hash_init(futex_queues, futex_hashsize);
 
 	return 0;
 }
@@ -0,0 +1,348 @@
+/*
+ * linux/kernel/irq/balance.c
+ *
+ * In-kernel interrupt balancing.
+ *
+ * Every interval the interrupts that fired since the last pass are grouped
+ * by the line that really routes them to a cpu: an interrupt demultiplexed
+ * by a chained handler (see irq_set_parent()) moves with its parent, so a
+ * group is the topmost parent plus every interrupt chained behind it.
+ * Groups are placed busiest first on the online cpu that has taken the
+ * fewest interrupts so far. A group stays where it is unless its cpu is
+ * busier than the best one by more than the group's own rate, so a single
+ * dominant interrupt does not bounce between two cpus. Latency critical
+ * groups go to latency_cpu, which the other groups avoid while any other
+ * cpu is online. Threaded handlers pick up the new affinity the next time
+ * they run.
+ *
+ * A cpu going down is taken out of the picture before it is unplugged, so
+ * its interrupts are spread over the remaining cpus instead of all breaking
+ * affinity onto the first online one.
+ */
+
+#include <linux/irq.h>
+#include <linux/module.h>
+#include <linux/interrupt.h>
+#include <linux/kernel_stat.h>
+#include <linux/moduleparam.h>
+#include <linux/workqueue.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/cpu.h>
+
+#include "internals.h"
+
+#undef MODULE_PARAM_PREFIX
+#define MODULE_PARAM_PREFIX "irqbalance."
+
+#define IRQ_BALANCE_MAX_DEPTH	4	/* levels of chained interrupts */
+
+static bool irq_balance_enabled = true;
+module_param_named(enabled, irq_balance_enabled, bool, 0644);
+
+static unsigned int irq_balance_interval_ms = 2000;
+module_param_named(interval_ms, irq_balance_interval_ms, uint, 0644);
+
+static int irq_balance_latency_cpu;
+module_param_named(latency_cpu, irq_balance_latency_cpu, int, 0644);
+
+struct irq_balance_group {
+	unsigned long	load;		/* interrupts since the last pass */
+	bool		active;		/* some member has a handler */
+	bool		chained;	/* members other than the parent */
+	bool		fixed;		/* some member must not move */
+	bool		latency;	/* some member is latency critical */
+};
+
+/* indexed by the group's topmost irq, guarded by irq_balance_mutex */
+static struct irq_balance_group *irq_groups;
+static unsigned int *irq_order;
+static unsigned long *irq_cpu_load;
+static cpumask_var_t irq_balance_cpus;
+static int irq_balance_outgoing = -1;
+static DEFINE_MUTEX(irq_balance_mutex);
+
+static void irq_balance_fn(struct work_struct *work);
+static struct delayed_work irq_balance_work;
+
+int irq_set_parent(unsigned int irq, unsigned int parent_irq)
+{
+	unsigned long flags;
+	struct irq_desc *desc = irq_get_desc_lock(irq, &flags, 0);
+
+	if (!desc)
+		return -EINVAL;
+
+	desc->parent_irq = parent_irq;
+	irq_put_desc_unlock(desc, flags);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(irq_set_parent);
+
+int irq_set_latency_critical(unsigned int irq, bool on)
+{
+	unsigned long flags;
+	struct irq_desc *desc = irq_get_desc_lock(irq, &flags, 0);
+
+	if (!desc)
+		return -EINVAL;
+
+	desc->latency_critical = on;
+	irq_put_desc_unlock(desc, flags);
+
+	/* place it now rather than at the end of the interval */
+	if (irq_groups && cancel_delayed_work(&irq_balance_work))
+		queue_delayed_work(system_power_efficient_wq,
+				   &irq_balance_work, 0);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(irq_set_latency_critical);
+
+static unsigned int irq_balance_top(unsigned int irq)
+{
+	struct irq_desc *desc;
+	int depth;
+
+	for (depth = 0; depth < IRQ_BALANCE_MAX_DEPTH; depth++) {
+		desc = irq_to_desc(irq);
+		if (!desc || !desc->parent_irq)
+			break;
+		irq = desc->parent_irq;
+	}
+	return irq;
+}
+
+static bool irq_balance_action_fixed(struct irq_desc *desc)
+{
+	struct irqaction *action;
+
+	if (!irqd_can_balance(&desc->irq_data))
+		return true;
+
+	/* clock events are tied to the cpus their timers were set up for */
+	for (action = desc->action; action; action = action->next)
+		if (action->flags & IRQF_TIMER)
+			return true;
+	return false;
+}
+
+static void irq_balance_move(struct irq_balance_group *g, unsigned int top,
+			     int cpu)
+{
+	const struct cpumask *mask = cpumask_of(cpu);
+	struct irq_desc *desc;
+	unsigned long flags;
+	int irq;
+
+	if (irq_set_affinity(top, mask))
+		return;
+	if (!g->chained)
+		return;
+
+	/* the interrupts behind a chained handler follow it in hardware */
+	for_each_irq_desc(irq, desc) {
+		if (irq == top || !desc->action || irq_balance_top(irq) != top)
+			continue;
+
+		raw_spin_lock_irqsave(&desc->lock, flags);
+		cpumask_copy(desc->irq_data.affinity, mask);
+		irq_set_thread_affinity(desc);
+		raw_spin_unlock_irqrestore(&desc->lock, flags);
+	}
+}
+
+static int irq_balance_least(const struct cpumask *cpus)
+{
+	int cpu, best = -1;
+
+	for_each_cpu(cpu, cpus)
+		if (best < 0 || irq_cpu_load[cpu] < irq_cpu_load[best])
+			best = cpu;
+	return best;
+}
+
+static int irq_order_cmp(const void *a, const void *b)
+{
+	unsigned long la = irq_groups[*(const unsigned int *)a].load;
+	unsigned long lb = irq_groups[*(const unsigned int *)b].load;
+
+	return la < lb ? 1 : la > lb ? -1 : 0;
+}
+
+/* gather the per-group interrupt counts, returns the number of groups */
+static unsigned int irq_balance_scan(void)
+{
+	struct irq_balance_group *g;
+	struct irq_desc *desc;
+	unsigned int count, top, nr = 0;
+	int irq;
+
+	memset(irq_groups, 0, nr_irqs * sizeof(*irq_groups));
+
+	for_each_irq_desc(irq, desc) {
+		if (!desc->action)
+			continue;
+
+		top = irq_balance_top(irq);
+		g = &irq_groups[top];
+		if (!g->active) {
+			g->active = true;
+			irq_order[nr++] = top;
+		}
+
+		count = kstat_irqs(irq);
+		g->load += count - desc->balance_last;
+		desc->balance_last = count;
+
+		if (top != irq)
+			g->chained = true;
+		if (irq_balance_action_fixed(desc))
+			g->fixed = true;
+		if (desc->latency_critical)
+			g->latency = true;
+	}
+
+	return nr;
+}
+
+static void irq_balance_run(void)
+{
+	struct cpumask *cpus = irq_balance_cpus;
+	struct irq_balance_group *g;
+	const struct cpumask *aff;
+	unsigned int i, nr, top;
+	int cur, best, lat_cpu;
+	bool stay;
+
+	nr = irq_balance_scan();
+
+	cpumask_copy(cpus, cpu_online_mask);
+	if (irq_balance_outgoing >= 0)
+		cpumask_clear_cpu(irq_balance_outgoing, cpus);
+	if (cpumask_empty(cpus))
+		return;
+
+	memset(irq_cpu_load, 0, nr_cpu_ids * sizeof(*irq_cpu_load));
+
+	lat_cpu = irq_balance_latency_cpu;
+	if (lat_cpu < 0 || lat_cpu >= nr_cpu_ids ||
+	    !cpumask_test_cpu(lat_cpu, cpus))
+		lat_cpu = cpumask_first(cpus);
+
+	/* account for what cannot move and place what must stay responsive */
+	for (i = 0; i < nr; i++) {
+		top = irq_order[i];
+		g = &irq_groups[top];
+
+		if (!g->fixed && !irq_can_set_affinity(top))
+			g->fixed = true;
+
+		if (g->fixed) {
+			cur = cpumask_any_and(irq_get_irq_data(top)->affinity,
+					      cpu_online_mask);
+			if (cur < nr_cpu_ids)
+				irq_cpu_load[cur] += g->load;
+		} else if (g->latency) {
+			aff = irq_get_irq_data(top)->affinity;
+			if (!cpumask_equal(aff, cpumask_of(lat_cpu)))
+				irq_balance_move(g, top, lat_cpu);
+			irq_cpu_load[lat_cpu] += g->load;
+		}
+	}
+
+	if (cpumask_weight(cpus) > 1)
+		cpumask_clear_cpu(lat_cpu, cpus);
+
+	sort(irq_order, nr, sizeof(*irq_order), irq_order_cmp, NULL);
+
+	for (i = 0; i < nr; i++) {
+		top = irq_order[i];
+		g = &irq_groups[top];
+		if (g->fixed || g->latency)
+			continue;
+
+		best = irq_balance_least(cpus);
+		aff = irq_get_irq_data(top)->affinity;
+		cur = cpumask_any_and(aff, cpu_online_mask);
+
+		/*
+		 * A quiet interrupt is left alone as long as it targets an
+		 * allowed cpu; a busy one is pinned to a single cpu, and only
+		 * moved when that takes load off a busier cpu.
+		 */
+		stay = cur < nr_cpu_ids && cpumask_test_cpu(cur, cpus);
+		if (stay && g->load)
+			stay = cpumask_weight(aff) == 1 &&
+			       irq_cpu_load[cur] <= irq_cpu_load[best] + g->load;
+
+		if (!stay) {
+			irq_balance_move(g, top, best);
+			cur = best;
+		}
+		irq_cpu_load[cur] += g->load;
+	}
+}
+
+static void irq_balance_fn(struct work_struct *work)
+{
+	mutex_lock(&irq_balance_mutex);
+	if (irq_balance_enabled)
+		irq_balance_run();
+	mutex_unlock(&irq_balance_mutex);
+
+	queue_delayed_work(system_power_efficient_wq, &irq_balance_work,
+			   msecs_to_jiffies(irq_balance_interval_ms));
+}
+
+static int __cpuinit irq_balance_cpu_callback(struct notifier_block *nfb,
+					      unsigned long action,
+					      void *hcpu)
+{
+	int cpu = (long)hcpu;
+
+	/* suspend unplugs everything anyway, leave that to migrate_irqs() */
+	switch (action) {
+	case CPU_DOWN_PREPARE:
+		mutex_lock(&irq_balance_mutex);
+		irq_balance_outgoing = cpu;
+		if (irq_balance_enabled)
+			irq_balance_run();
+		mutex_unlock(&irq_balance_mutex);
+		break;
+	case CPU_DOWN_FAILED:
+	case CPU_DEAD:
+	case CPU_ONLINE:
+		mutex_lock(&irq_balance_mutex);
+		irq_balance_outgoing = -1;
+		if (irq_balance_enabled)
+			irq_balance_run();
+		mutex_unlock(&irq_balance_mutex);
+		break;
+	}
+
+	return NOTIFY_OK;
+}
+
+static int __init irq_balance_init(void)
+{
+	irq_groups = kcalloc(nr_irqs, sizeof(*irq_groups), GFP_KERNEL);
+	irq_order = kcalloc(nr_irqs, sizeof(*irq_order), GFP_KERNEL);
+	irq_cpu_load = kcalloc(nr_cpu_ids, sizeof(*irq_cpu_load), GFP_KERNEL);
+	if (!irq_groups || !irq_order || !irq_cpu_load ||
+	    !zalloc_cpumask_var(&irq_balance_cpus, GFP_KERNEL)) {
+		kfree(irq_cpu_load);
+		kfree(irq_order);
+		kfree(irq_groups);
+		irq_groups = NULL;
+		return -ENOMEM;
+	}
+
+	INIT_DELAYED_WORK_DEFERRABLE(&irq_balance_work, irq_balance_fn);
+	hotcpu_notifier(irq_balance_cpu_callback, 0);
+	queue_delayed_work(system_power_efficient_wq, &irq_balance_work,
+			   msecs_to_jiffies(irq_balance_interval_ms));
+
+	return 0;
+}
+late_initcall(irq_balance_init);
@@ -260,6 +260,44 @@ static const struct file_operations irq_node_proc_fops = {
 	.llseek		= seq_lseek,
 	.release	= single_release,
 };
+
+#ifdef CONFIG_IRQ_BALANCE_KERNEL
+static int irq_latency_proc_show(struct seq_file *m, void *v)
+{
+	struct irq_desc *desc = irq_to_desc((long) m->private);
+
+	seq_printf(m, "%d\n", desc->latency_critical);
+	return 0;
+}
+
+static ssize_t irq_latency_proc_write(struct file *file,
+		const char __user *buffer, size_t count, loff_t *pos)
+{
+	unsigned int irq = (int)(long)PDE(file->f_path.dentry->d_inode)->data;
+	unsigned int val;
+	int err;
+
+	err = kstrtouint_from_user(buffer, count, 0, &val);
+	if (err)
+		return err;
+
+	err = irq_set_latency_critical(irq, val);
+	return err ? err : count;
+}
+
+static int irq_latency_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_latency_proc_show, PDE(inode)->data);
+}
+
+static const struct file_operations irq_latency_proc_fops = {
+	.open		= irq_latency_proc_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+	.write		= irq_latency_proc_write,
+};
+#endif
 #endif
 
 static int irq_spurious_proc_show(struct seq_file *m, void *v)
@@ -366,6 +404,12 @@ void register_irq_proc(unsigned int irq, struct irq_desc *desc)
 
 	proc_create_data("node", 0444, desc->dir,
 			 &irq_node_proc_fops, (void *)(long)irq);
+
+#ifdef CONFIG_IRQ_BALANCE_KERNEL
+	/* create /proc/irq/<irq>/latency_critical */
+	proc_create_data("latency_critical", 0600, desc->dir,
+			 &irq_latency_proc_fops, (void *)(long)irq);
+#endif
 #endif
 
 	proc_create_data("spurious", 0444, desc->dir,
@@ -386,6 +430,9 @@ void unregister_irq_proc(unsigned int irq, struct irq_desc *desc)
 	remove_proc_entry("affinity_hint", desc->dir);
 	remove_proc_entry("smp_affinity_list", desc->dir);
 	remove_proc_entry("node", desc->dir);
+#ifdef CONFIG_IRQ_BALANCE_KERNEL
+	remove_proc_entry("latency_critical", desc->dir);
+#endif
 #endif
 	remove_proc_entry("spurious", desc->dir);
 
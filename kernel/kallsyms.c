@@ -23,6 +23,9 @@
 #include <linux/mm.h>
 #include <linux/ctype.h>
 #include <linux/slab.h>
+#include <linux/jhash.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
 
 #include <asm/sections.h>
 
@@ -168,6 +171,79 @@ static unsigned int get_symbol_offset(unsigned long pos)
 	return name - kallsyms_names;
 }
 
+#ifdef CONFIG_KALLSYMS_NAME_HASH
+/*
+ * Chained hash of the symbol names: kallsyms_hash[] holds the first
+ * symbol of each bucket and kallsyms_hash_next[] the next one, both as
+ * index + 1 so that 0 ends a chain. Until it is built lookups fall back
+ * to the linear scan.
+ */
+static u32 *kallsyms_hash;
+static u32 *kallsyms_hash_next;
+static unsigned int kallsyms_hash_bits;
+
+static inline u32 kallsyms_name_hash(const char *name)
+{
+	return jhash(name, strlen(name), 0) >> (32 - kallsyms_hash_bits);
+}
+
+static int __init kallsyms_hash_init(void)
+{
+	char namebuf[KSYM_NAME_LEN];
+	unsigned long i;
+	unsigned int off;
+	u32 *hash, *next, h;
+
+	if (kallsyms_num_syms < 2)
+		return 0;
+
+	kallsyms_hash_bits = ilog2(kallsyms_num_syms);
+	hash = vzalloc(sizeof(*hash) << kallsyms_hash_bits);
+	next = vmalloc(sizeof(*next) * kallsyms_num_syms);
+	if (!hash || !next) {
+		vfree(hash);
+		vfree(next);
+		return -ENOMEM;
+	}
+
+	for (i = 0, off = 0; i < kallsyms_num_syms; i++) {
+		off = kallsyms_expand_symbol(off, namebuf);
+		h = kallsyms_name_hash(namebuf);
+		next[i] = hash[h];
+		hash[h] = i + 1;
+	}
+
+	kallsyms_hash_next = next;
+	smp_wmb();
+	kallsyms_hash = hash;
+	return 0;
+}
+
+static unsigned long kallsyms_hash_lookup(const char *name)
+{
+	char namebuf[KSYM_NAME_LEN];
+	unsigned long addr = 0;
+	u32 i;
+
+	/*
+	 * Chains run from the highest index down and the linear scan
+	 * returns the first match, so keep the last one found.
+	 */
+	for (i = kallsyms_hash[kallsyms_name_hash(name)]; i;
+	     i = kallsyms_hash_next[i - 1]) {
+		kallsyms_expand_symbol(get_symbol_offset(i - 1), namebuf);
+		if (strcmp(namebuf, name) == 0)
+			addr = kallsyms_addresses[i - 1];
+	}
+	return addr;
+}
+#else
+static inline int kallsyms_hash_init(void)
+{
+	return 0;
+}
+#endif
+
 /* Lookup the address for this symbol. Returns 0 if not found. */
 unsigned long kallsyms_lookup_name(const char *name)
 {
@@ -175,6 +251,14 @@ unsigned long kallsyms_lookup_name(const char *name)
 	unsigned long i;
 	unsigned int off;
 
+#ifdef CONFIG_KALLSYMS_NAME_HASH
+	if (ACCESS_ONCE(kallsyms_hash)) {
+		smp_rmb();
+		i = kallsyms_hash_lookup(name);
+		return i ? i : module_kallsyms_lookup_name(name);
+	}
+#endif
+
 	for (i = 0, off = 0; i < kallsyms_num_syms; i++) {
 		off = kallsyms_expand_symbol(off, namebuf);
 
@@ -583,6 +667,8 @@ static const struct file_operations kallsyms_operations = {
 static int __init kallsyms_init(void)
 {
 	proc_create("kallsyms", 0444, NULL, &kallsyms_operations);
+	if (kallsyms_hash_init())
+		pr_warn("kallsyms: no memory for the name hash\n");
 	return 0;
 }
 device_initcall(kallsyms_init);
@@ -33,6 +33,7 @@
 #include <linux/mount.h>
 #include <linux/kernel.h>
 #include <linux/init.h>
+#include <linux/initrd.h>
 #include <linux/resource.h>
 #include <linux/notifier.h>
 #include <linux/suspend.h>
@@ -209,6 +210,9 @@ static int ____call_usermodehelper(void *data)
 
 	commit_creds(new);
 
+	/* helpers started during boot live in the initramfs */
+	wait_for_initramfs();
+
 	retval = kernel_execve(sub_info->path,
 			       (const char *const *)sub_info->argv,
 			       (const char *const *)sub_info->envp);
@@ -58,6 +58,7 @@
 #include <linux/jump_label.h>
 #include <linux/pfn.h>
 #include <linux/bsearch.h>
+#include <linux/sort.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/module.h>
@@ -2302,6 +2303,13 @@ static void layout_symtab(struct module *mod, struct load_info *info)
 	pr_debug("\t%s\n", info->secstrings + strsect->sh_name);
 }
 
+static int cmp_sym_value(const void *va, const void *vb)
+{
+	const Elf_Sym *a = va, *b = vb;
+
+	return a->st_value < b->st_value ? -1 : a->st_value > b->st_value;
+}
+
 static void add_kallsyms(struct module *mod, const struct load_info *info)
 {
 	unsigned int i, ndst;
@@ -2333,6 +2341,14 @@ static void add_kallsyms(struct module *mod, const struct load_info *info)
 		}
 	}
 	mod->core_num_syms = ndst;
+
+	/*
+	 * Nothing relocates against the core copy, keep it in address order
+	 * so get_ksymbol() can bisect once the module is live. Entry 0 stays
+	 * the null symbol.
+	 */
+	if (ndst > 2)
+		sort(dst + 1, ndst - 1, sizeof(*dst), cmp_sym_value, NULL);
 }
 #else
 static inline void layout_symtab(struct module *mod, struct load_info *info)
@@ -3123,6 +3139,53 @@ static inline int is_arm_mapping_symbol(const char *str)
 	       && (str[2] == '\0' || str[2] == '.');
 }
 
+static inline bool ksymbol_is_named(struct module *mod, unsigned int i)
+{
+	const char *name = mod->strtab + mod->symtab[i].st_name;
+
+	return *name != '\0' && !is_arm_mapping_symbol(name);
+}
+
+/* the core symtab is sorted by address, see add_kallsyms() */
+static const char *get_core_ksymbol(struct module *mod,
+				    unsigned long addr,
+				    unsigned long nextval,
+				    unsigned long *size,
+				    unsigned long *offset)
+{
+	unsigned int lo = 1, hi = mod->num_symtab, mid, best, i;
+
+	/* first symbol above addr */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (mod->symtab[mid].st_value <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (i = lo; i < mod->num_symtab; i++) {
+		if (ksymbol_is_named(mod, i)) {
+			if (mod->symtab[i].st_value < nextval)
+				nextval = mod->symtab[i].st_value;
+			break;
+		}
+	}
+
+	for (best = lo - 1; best; best--)
+		if (ksymbol_is_named(mod, best))
+			break;
+
+	if (!best)
+		return NULL;
+
+	if (size)
+		*size = nextval - mod->symtab[best].st_value;
+	if (offset)
+		*offset = addr - mod->symtab[best].st_value;
+	return mod->strtab + mod->symtab[best].st_name;
+}
+
 static const char *get_ksymbol(struct module *mod,
 			       unsigned long addr,
 			       unsigned long *size,
@@ -3137,6 +3200,9 @@ static const char *get_ksymbol(struct module *mod,
 	else
 		nextval = (unsigned long)mod->module_core+mod->core_text_size;
 
+	if (mod->symtab == mod->core_symtab)
+		return get_core_ksymbol(mod, addr, nextval, size, offset);
+
 	/* Scan for closest preceding symbol, and next symbol. (ELF
 	   starts real symbols at 1). */
 	for (i = 1; i < mod->num_symtab; i++) {
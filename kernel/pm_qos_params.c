@@ -41,6 +41,9 @@
 #include <linux/platform_device.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/jiffies.h>
 
 #include <linux/uaccess.h>
 
@@ -143,6 +146,51 @@ static struct pm_qos_object dvfs_res_lat_pm_qos = {
 	.type = PM_QOS_MIN
 };
 
+/*
+ * cpufreq applies the frequency floor and ceiling to every policy on top
+ * of its user limits, the hotplug core keeps at least cpu_online_min cpus
+ * online and the GPU DVFS never goes below gpu_step_min.
+ */
+static BLOCKING_NOTIFIER_HEAD(cpu_freq_min_notifier);
+static struct pm_qos_object cpu_freq_min_pm_qos = {
+	.requests = PLIST_HEAD_INIT(cpu_freq_min_pm_qos.requests),
+	.notifiers = &cpu_freq_min_notifier,
+	.name = "cpu_freq_min",
+	.target_value = PM_QOS_CPU_FREQ_MIN_DEFAULT_VALUE,
+	.default_value = PM_QOS_CPU_FREQ_MIN_DEFAULT_VALUE,
+	.type = PM_QOS_MAX,
+};
+
+static BLOCKING_NOTIFIER_HEAD(cpu_freq_max_notifier);
+static struct pm_qos_object cpu_freq_max_pm_qos = {
+	.requests = PLIST_HEAD_INIT(cpu_freq_max_pm_qos.requests),
+	.notifiers = &cpu_freq_max_notifier,
+	.name = "cpu_freq_max",
+	.target_value = PM_QOS_CPU_FREQ_MAX_DEFAULT_VALUE,
+	.default_value = PM_QOS_CPU_FREQ_MAX_DEFAULT_VALUE,
+	.type = PM_QOS_MIN,
+};
+
+static BLOCKING_NOTIFIER_HEAD(cpu_online_min_notifier);
+static struct pm_qos_object cpu_online_min_pm_qos = {
+	.requests = PLIST_HEAD_INIT(cpu_online_min_pm_qos.requests),
+	.notifiers = &cpu_online_min_notifier,
+	.name = "cpu_online_min",
+	.target_value = PM_QOS_CPU_ONLINE_MIN_DEFAULT_VALUE,
+	.default_value = PM_QOS_CPU_ONLINE_MIN_DEFAULT_VALUE,
+	.type = PM_QOS_MAX,
+};
+
+static BLOCKING_NOTIFIER_HEAD(gpu_step_min_notifier);
+static struct pm_qos_object gpu_step_min_pm_qos = {
+	.requests = PLIST_HEAD_INIT(gpu_step_min_pm_qos.requests),
+	.notifiers = &gpu_step_min_notifier,
+	.name = "gpu_step_min",
+	.target_value = PM_QOS_GPU_STEP_MIN_DEFAULT_VALUE,
+	.default_value = PM_QOS_GPU_STEP_MIN_DEFAULT_VALUE,
+	.type = PM_QOS_MAX,
+};
+
 static struct pm_qos_object *pm_qos_array[] = {
 	&null_pm_qos,
 	&cpu_dma_pm_qos,
@@ -152,6 +200,10 @@ static struct pm_qos_object *pm_qos_array[] = {
 	&display_frequency_pm_qos,
 	&bus_qos_pm_qos,
 	&dvfs_res_lat_pm_qos,
+	&cpu_freq_min_pm_qos,
+	&cpu_freq_max_pm_qos,
+	&cpu_online_min_pm_qos,
+	&gpu_step_min_pm_qos,
 };
 
 static ssize_t pm_qos_power_write(struct file *filp, const char __user *buf,
@@ -300,6 +352,9 @@ void pm_qos_add_request(struct pm_qos_request_list *dep,
 		new_value = value;
 	plist_node_init(&dep->list, new_value);
 	dep->pm_qos_class = pm_qos_class;
+	dep->owner = __builtin_return_address(0);
+	dep->pid = 0;
+	dep->stamp = jiffies;
 	update_target(o, &dep->list, 0, PM_QOS_DEFAULT_VALUE);
 }
 EXPORT_SYMBOL_GPL(pm_qos_add_request);
@@ -335,8 +390,10 @@ void pm_qos_update_request(struct pm_qos_request_list *pm_qos_req,
 	else
 		temp = new_value;
 
-	if (temp != pm_qos_req->list.prio)
+	if (temp != pm_qos_req->list.prio) {
+		pm_qos_req->stamp = jiffies;
 		update_target(o, &pm_qos_req->list, 0, temp);
+	}
 }
 EXPORT_SYMBOL_GPL(pm_qos_update_request);
 
@@ -416,6 +473,7 @@ static int pm_qos_power_open(struct inode *inode, struct file *filp)
 			return -ENOMEM;
 
 		pm_qos_add_request(req, pm_qos_class, PM_QOS_DEFAULT_VALUE);
+		req->pid = task_tgid_vnr(current);
 		filp->private_data = req;
 
 		if (filp->private_data)
@@ -498,6 +556,49 @@ static ssize_t pm_qos_power_write(struct file *filp, const char __user *buf,
 	return count;
 }
 
+#ifdef CONFIG_DEBUG_FS
+/*
+ * Every class with its target and the requests behind it, so a request
+ * that was never dropped can be traced back to whoever added it.
+ */
+static int pm_qos_debug_show(struct seq_file *s, void *unused)
+{
+	struct pm_qos_request_list *req;
+	struct pm_qos_object *o;
+	unsigned long flags;
+	int pm_qos_class;
+
+	spin_lock_irqsave(&pm_qos_lock, flags);
+	for (pm_qos_class = 1;
+		pm_qos_class < PM_QOS_NUM_CLASSES; pm_qos_class++) {
+		o = pm_qos_array[pm_qos_class];
+		seq_printf(s, "%s: %d\n", o->name, pm_qos_read_value(o));
+		plist_for_each_entry(req, &o->requests, list) {
+			seq_printf(s, "  %d %ums ago by %pS", req->list.prio,
+				   jiffies_to_msecs(jiffies - req->stamp),
+				   req->owner);
+			if (req->pid)
+				seq_printf(s, " pid %d", req->pid);
+			seq_putc(s, '\n');
+		}
+	}
+	spin_unlock_irqrestore(&pm_qos_lock, flags);
+
+	return 0;
+}
+
+static int pm_qos_debug_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pm_qos_debug_show, inode->i_private);
+}
+
+static const struct file_operations pm_qos_debug_fops = {
+	.open		= pm_qos_debug_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
 
 static int __init pm_qos_power_init(void)
 {
@@ -532,6 +633,26 @@ static int __init pm_qos_power_init(void)
 		printk(KERN_ERR
 			"pm_qos_param: dvfs_response_frequency setup failed\n");
 
+	ret = register_pm_qos_misc(&cpu_freq_min_pm_qos);
+	if (ret < 0)
+		printk(KERN_ERR "pm_qos_param: cpu_freq_min setup failed\n");
+
+	ret = register_pm_qos_misc(&cpu_freq_max_pm_qos);
+	if (ret < 0)
+		printk(KERN_ERR "pm_qos_param: cpu_freq_max setup failed\n");
+
+	ret = register_pm_qos_misc(&cpu_online_min_pm_qos);
+	if (ret < 0)
+		printk(KERN_ERR "pm_qos_param: cpu_online_min setup failed\n");
+
+	ret = register_pm_qos_misc(&gpu_step_min_pm_qos);
+	if (ret < 0)
+		printk(KERN_ERR "pm_qos_param: gpu_step_min setup failed\n");
+
+#ifdef CONFIG_DEBUG_FS
+	debugfs_create_file("pm_qos", S_IRUGO, NULL, NULL, &pm_qos_debug_fops);
+#endif
+
 	return ret;
 }
 
@@ -13,10 +13,12 @@
  *
  */
 
+#include <linux/debugfs.h>
 #include <linux/earlysuspend.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/rtc.h>
+#include <linux/seq_file.h>
 #include <linux/syscalls.h> /* sys_sync */
 #include <linux/wakelock.h>
 #include <linux/workqueue.h>
@@ -48,6 +50,15 @@ EXPORT_SYMBOL(optimize_comp_on);
 module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 static int debug_mask_delay_ms = 0;
 module_param_named(debug_mask_delay_ms, debug_mask_delay_ms, int, S_IRUGO | S_IWUSR | S_IWGRP);
+/* call the handlers of one level in parallel */
+static bool parallel_handlers = true;
+module_param_named(parallel_handlers, parallel_handlers, bool, S_IRUGO | S_IWUSR | S_IWGRP);
+
+#define EARLY_SUSPEND_MAX_ACTIVE	4
+
+static struct workqueue_struct *early_suspend_wq;
+static bool handlers_resuming;
+static s64 last_suspend_usecs, last_resume_usecs;
 
 static DEFINE_MUTEX(early_suspend_lock);
 static LIST_HEAD(early_suspend_handlers);
@@ -72,6 +83,89 @@ static void (*earlysuspend_func)(struct early_suspend *h);
 static void (*stallfunc)(struct early_suspend *h);
 static int earlysuspend_timeout_ms = 7000; //7s
 
+static void early_suspend_call(struct early_suspend *h, bool resume)
+{
+	void (*fn)(struct early_suspend *h) = resume ? h->resume : h->suspend;
+	const char *what = resume ? "late_resume" : "early_suspend";
+	ktime_t starttime;
+	long usecs;
+
+	if (debug_mask & DEBUG_VERBOSE)
+		pr_info("%s: calling %pf\n", what, fn);
+
+	//backup suspend/resume addr.
+	earlysuspend_func = fn;
+	starttime = ktime_get();
+	fn(h);
+	usecs = ktime_to_us(ktime_sub(ktime_get(), starttime));
+
+	if (resume)
+		h->resume_usecs = usecs;
+	else
+		h->suspend_usecs = usecs;
+
+	if (debug_mask & DEBUG_VERBOSE) {
+		pr_info("%s: %pf complete after %ld.%03ld msecs\n", what, fn,
+			usecs / USEC_PER_MSEC, usecs % USEC_PER_MSEC);
+		if (debug_mask_delay_ms > 0) {
+			printk("sleep %d ms for debug. \n", debug_mask_delay_ms);
+			msleep(debug_mask_delay_ms);
+		}
+	}
+}
+
+static void early_suspend_handler_work(struct work_struct *work)
+{
+	early_suspend_call(container_of(work, struct early_suspend, work),
+			   handlers_resuming);
+}
+
+/*
+ * Call the suspend handlers in level order, or the resume handlers in the
+ * reverse order. The handlers of one level run in parallel on a bounded
+ * workqueue and the next level starts when they have all returned.
+ * Caller must hold early_suspend_lock.
+ */
+static void early_suspend_call_handlers(bool resume)
+{
+	struct list_head *p;
+	bool queued = false;
+	int level = 0;
+	ktime_t starttime = ktime_get();
+	s64 usecs;
+
+	handlers_resuming = resume;
+	for (p = resume ? early_suspend_handlers.prev : early_suspend_handlers.next;
+	     p != &early_suspend_handlers; p = resume ? p->prev : p->next) {
+		struct early_suspend *pos;
+
+		pos = list_entry(p, struct early_suspend, link);
+		if (!(resume ? pos->resume : pos->suspend))
+			continue;
+
+		if (queued && pos->level != level) {
+			flush_workqueue(early_suspend_wq);
+			queued = false;
+		}
+		level = pos->level;
+
+		if (parallel_handlers && early_suspend_wq) {
+			queue_work(early_suspend_wq, &pos->work);
+			queued = true;
+		} else {
+			early_suspend_call(pos, resume);
+		}
+	}
+	if (queued)
+		flush_workqueue(early_suspend_wq);
+
+	usecs = ktime_to_us(ktime_sub(ktime_get(), starttime));
+	if (resume)
+		last_resume_usecs = usecs;
+	else
+		last_suspend_usecs = usecs;
+}
+
 void register_early_suspend(struct early_suspend *handler)
 {
 	struct list_head *pos;
@@ -84,6 +178,7 @@ void register_early_suspend(struct early_suspend *handler)
 			break;
 	}
 	list_add_tail(&handler->link, pos);
+	INIT_WORK(&handler->work, early_suspend_handler_work);
 	if ((state & SUSPENDED) && handler->suspend)
 		handler->suspend(handler);
 	mutex_unlock(&early_suspend_lock);
@@ -100,13 +195,8 @@ EXPORT_SYMBOL(unregister_early_suspend);
 
 static void early_suspend(struct work_struct *work)
 {
-	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
-	ktime_t calltime;
-	u64 usecs64;
-	int usecs;
-	ktime_t starttime;
 
 	mutex_lock(&early_suspend_lock);
 	spin_lock_irqsave(&state_lock, irqflags);
@@ -135,34 +225,8 @@ static void early_suspend(struct work_struct *work)
 			ktime_set(earlysuspend_timeout_ms / 1000, (earlysuspend_timeout_ms % 1000) * 1000000),
 			HRTIMER_MODE_REL);
 
-	list_for_each_entry(pos, &early_suspend_handlers, link) {
-		if (pos->suspend != NULL) {
-			if (debug_mask & DEBUG_VERBOSE){
-				pr_info("early_suspend: calling %pf\n", pos->suspend);
-				starttime = ktime_get();
-				
-			}
-			//backup suspend addr.
-			earlysuspend_func = pos->suspend;
-			pos->suspend(pos);
+	early_suspend_call_handlers(false);
 
-			if (debug_mask & DEBUG_VERBOSE){
-				calltime = ktime_get();
-				usecs64 = ktime_to_ns(ktime_sub(calltime, starttime));
-				do_div(usecs64, NSEC_PER_USEC);
-				usecs = usecs64;
-				if (usecs == 0)
-					usecs = 1;
-				pr_info("early_suspend: %pf complete after %ld.%03ld msecs\n",
-					pos->suspend, usecs / USEC_PER_MSEC, usecs % USEC_PER_MSEC);
-				if(debug_mask_delay_ms > 0){
-				    printk("sleep %d ms for debug. \n", debug_mask_delay_ms);
-				    msleep(debug_mask_delay_ms);
-				}
-			}
-		}
-	}
-	
 	hrtimer_cancel(&earlysuspend_timer);
 	standby_level = STANDBY_WITH_POWER;
 	mutex_unlock(&early_suspend_lock);
@@ -184,13 +248,8 @@ abort:
 
 static void late_resume(struct work_struct *work)
 {
-	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
-	ktime_t calltime;
-	u64 usecs64;
-	int usecs;
-	ktime_t starttime;
 
 	mutex_lock(&early_suspend_lock);
 	spin_lock_irqsave(&state_lock, irqflags);
@@ -217,35 +276,8 @@ static void late_resume(struct work_struct *work)
 			ktime_set(earlysuspend_timeout_ms / 1000, (earlysuspend_timeout_ms % 1000) * 1000000),
 			HRTIMER_MODE_REL);
 	
-	list_for_each_entry_reverse(pos, &early_suspend_handlers, link) {
-		if (pos->resume != NULL) {
-			if (debug_mask & DEBUG_VERBOSE){
-				pr_info("late_resume: calling %pf\n", pos->resume);
-				starttime = ktime_get();
-			}
-			//backup resume addr.
-			earlysuspend_func = pos->resume;
-			pos->resume(pos);
+	early_suspend_call_handlers(true);
 
-			if (debug_mask & DEBUG_VERBOSE){
-				calltime = ktime_get();
-				usecs64 = ktime_to_ns(ktime_sub(calltime, starttime));
-				do_div(usecs64, NSEC_PER_USEC);
-				usecs = usecs64;
-				if (usecs == 0)
-					usecs = 1;
-				pr_info("late_resume: %pf complete after %ld.%03ld msecs\n",
-					pos->resume, usecs / USEC_PER_MSEC, usecs % USEC_PER_MSEC);
-				if(debug_mask_delay_ms > 0){
-				    printk("sleep %d ms for debug. \n", debug_mask_delay_ms);
-				    msleep(debug_mask_delay_ms);
-				}
-			}
-	
-		}
-	}
-	
-	
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: done\n");
 
@@ -300,6 +332,44 @@ suspend_state_t get_suspend_state(void)
 	return requested_suspend_state;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int early_suspend_time_show(struct seq_file *s, void *unused)
+{
+	struct early_suspend *pos;
+
+	mutex_lock(&early_suspend_lock);
+	seq_printf(s, "early suspend %lld usecs, late resume %lld usecs\n",
+		   last_suspend_usecs, last_resume_usecs);
+	seq_printf(s, "level  suspend_us   resume_us  handler\n");
+	list_for_each_entry(pos, &early_suspend_handlers, link)
+		seq_printf(s, "%5d %11lld %11lld  %pf\n", pos->level,
+			   pos->suspend_usecs, pos->resume_usecs,
+			   pos->suspend ? pos->suspend : pos->resume);
+	mutex_unlock(&early_suspend_lock);
+	return 0;
+}
+
+static int early_suspend_time_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, early_suspend_time_show, NULL);
+}
+
+static const struct file_operations early_suspend_time_fops = {
+	.open		= early_suspend_time_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init early_suspend_debug_init(void)
+{
+	debugfs_create_file("early_suspend_time", S_IRUGO, NULL, NULL,
+			    &early_suspend_time_fops);
+	return 0;
+}
+late_initcall(early_suspend_debug_init);
+#endif
+
 static enum hrtimer_restart earlysuspend_timer_func(struct hrtimer *timer)
 {
 	//record the lastest time stall function point.
@@ -723,6 +793,12 @@ static int __init earlysuspend_init(void)
 //	mode = POWER_SUSPEND_PANEL;	// Yank555.lu : Default to display panel mode
 	mode = POWER_SUSPEND_HYBRID;	// Yank555.lu : Default to display panel / autosleep hybrid mode
 
+	/* without it the handlers are simply called one after the other */
+	early_suspend_wq = alloc_workqueue("early_suspend", WQ_UNBOUND,
+					   EARLY_SUSPEND_MAX_ACTIVE);
+	if (!early_suspend_wq)
+		pr_err("%s: no workqueue, handlers run serially\n", __func__);
+
 	stallfunc = NULL;
 	hrtimer_init(&earlysuspend_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
 	earlysuspend_timer.function = earlysuspend_timer_func;
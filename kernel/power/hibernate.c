@@ -661,6 +661,12 @@ int hibernate(void)
 			flags |= SF_PLATFORM_MODE;
 		if (nocompress)
 			flags |= SF_NOCOMPRESS_MODE;
+		else {
+			flags |= SF_CRC32_MODE;
+#ifdef CONFIG_HIBERNATION_LZ4
+			flags |= SF_LZ4_MODE;
+#endif
+		}
 		pr_debug("PM: writing image.\n");
 		error = swsusp_write(flags);
 		swsusp_free();
@@ -15,16 +15,52 @@
  */
 
 #include <linux/debugfs.h>
+#include <linux/device.h>
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
 #include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/suspend.h>
 #include <linux/syscore_ops.h>
 #include <linux/time.h>
 
 static struct timespec suspend_time_before;
 static unsigned int time_in_suspend_bins[32];
 
+#define RESUME_SLOWEST	8
+
+/* slowest resume callbacks of the last resume, slowest first */
+static struct resume_time {
+	char name[32];
+	s64 usecs;
+} resume_slowest[RESUME_SLOWEST];
+static s64 resume_total_usecs;
+static DEFINE_SPINLOCK(resume_time_lock);
+
+/* called for every device resumed, from async threads too */
+void suspend_time_device_resumed(struct device *dev, s64 usecs)
+{
+	int i;
+
+	spin_lock(&resume_time_lock);
+	if (usecs > resume_slowest[RESUME_SLOWEST - 1].usecs) {
+		for (i = RESUME_SLOWEST - 1;
+		     i > 0 && resume_slowest[i - 1].usecs < usecs; i--)
+			resume_slowest[i] = resume_slowest[i - 1];
+		strlcpy(resume_slowest[i].name, dev_name(dev),
+			sizeof(resume_slowest[i].name));
+		resume_slowest[i].usecs = usecs;
+	}
+	spin_unlock(&resume_time_lock);
+}
+
+void suspend_time_resumed(s64 usecs)
+{
+	resume_total_usecs = usecs;
+}
+
 #ifdef CONFIG_DEBUG_FS
 static int suspend_time_debug_show(struct seq_file *s, void *data)
 {
@@ -53,6 +89,36 @@ static const struct file_operations suspend_time_debug_fops = {
 	.release	= single_release,
 };
 
+static int resume_time_debug_show(struct seq_file *s, void *data)
+{
+	struct resume_time slowest[RESUME_SLOWEST];
+	int i;
+
+	spin_lock(&resume_time_lock);
+	memcpy(slowest, resume_slowest, sizeof(slowest));
+	spin_unlock(&resume_time_lock);
+
+	seq_printf(s, "device resume total %lld usecs\n", resume_total_usecs);
+	seq_printf(s, "device                           usecs\n");
+	seq_printf(s, "--------------------------------------\n");
+	for (i = 0; i < RESUME_SLOWEST && slowest[i].usecs; i++)
+		seq_printf(s, "%-32s %5lld\n", slowest[i].name,
+			   slowest[i].usecs);
+	return 0;
+}
+
+static int resume_time_debug_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, resume_time_debug_show, NULL);
+}
+
+static const struct file_operations resume_time_debug_fops = {
+	.open		= resume_time_debug_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int __init suspend_time_debug_init(void)
 {
 	struct dentry *d;
@@ -64,6 +130,13 @@ static int __init suspend_time_debug_init(void)
 		return -ENOMEM;
 	}
 
+	d = debugfs_create_file("resume_time", 0444, NULL, NULL,
+		&resume_time_debug_fops);
+	if (!d) {
+		pr_err("Failed to create resume_time debug file\n");
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
@@ -87,6 +160,10 @@ static void suspend_time_syscore_resume(void)
 
 	time_in_suspend_bins[fls(after.tv_sec)]++;
 
+	/* devices resume after this, start a new breakdown */
+	memset(resume_slowest, 0, sizeof(resume_slowest));
+	resume_total_usecs = 0;
+
 	pr_info("Suspended for %lu.%03lu seconds\n", after.tv_sec,
 		after.tv_nsec / NSEC_PER_MSEC);
 }
@@ -163,7 +163,7 @@ static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 	lock->stat.total_time = ktime_add(lock->stat.total_time, duration);
 	if (ktime_to_ns(duration) > ktime_to_ns(lock->stat.max_time))
 		lock->stat.max_time = duration;
-	lock->stat.last_time = ktime_get();
+	lock->stat.last_time = expired ? ktime_get() : now;
 	if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND) {
 		duration = ktime_sub(now, last_sleep_time_update);
 		lock->stat.prevent_suspend_time = ktime_add(
@@ -235,23 +235,52 @@ static void print_active_locks(int type)
 	}
 }
 
+/*
+ * The active list of a type holds the locks without a timeout first and
+ * then the auto expiring ones ordered by expiry, so the next lock to
+ * expire and the longest timeout sit at the two ends of the list.
+ *
+ * Caller must acquire the list_lock spinlock
+ */
+static void add_active_lock_locked(struct wake_lock *lock, int type)
+{
+	struct list_head *head = &active_wake_locks[type];
+	struct list_head *pos;
+
+	if (!(lock->flags & WAKE_LOCK_AUTO_EXPIRE)) {
+		list_add(&lock->link, head);
+		return;
+	}
+
+	/* a new timeout is usually the latest one, search from the tail */
+	for (pos = head->prev; pos != head; pos = pos->prev) {
+		struct wake_lock *l = list_entry(pos, struct wake_lock, link);
+
+		if (!(l->flags & WAKE_LOCK_AUTO_EXPIRE) ||
+		    !time_before(lock->expires, l->expires))
+			break;
+	}
+	list_add(&lock->link, pos);
+}
+
 static long has_wake_lock_locked(int type)
 {
-	struct wake_lock *lock, *n;
-	long max_timeout = 0;
+	struct list_head *head = &active_wake_locks[type];
+	struct wake_lock *lock;
+	unsigned long now = jiffies;
 
 	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
-	list_for_each_entry_safe(lock, n, &active_wake_locks[type], link) {
-		if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
-			long timeout = lock->expires - jiffies;
-			if (timeout <= 0)
-				expire_wake_lock(lock);
-			else if (timeout > max_timeout)
-				max_timeout = timeout;
-		} else
+	while (!list_empty(head)) {
+		lock = list_first_entry(head, struct wake_lock, link);
+		if (!(lock->flags & WAKE_LOCK_AUTO_EXPIRE))
 			return -1;
+		if ((long)(lock->expires - now) > 0) {
+			lock = list_entry(head->prev, struct wake_lock, link);
+			return lock->expires - now;
+		}
+		expire_wake_lock(lock);
 	}
-	return max_timeout;
+	return 0;
 }
 #ifdef CONFIG_FAST_BOOT
 extern bool fake_shut_down;
@@ -472,14 +501,13 @@ static void wake_lock_internal(
 				(timeout % HZ) * MSEC_PER_SEC / HZ);
 		lock->expires = jiffies + timeout;
 		lock->flags |= WAKE_LOCK_AUTO_EXPIRE;
-		list_add_tail(&lock->link, &active_wake_locks[type]);
 	} else {
 		if (debug_mask & DEBUG_WAKE_LOCK)
 			pr_info("wake_lock: %s, type %d\n", lock->name, type);
 		lock->expires = LONG_MAX;
 		lock->flags &= ~WAKE_LOCK_AUTO_EXPIRE;
-		list_add(&lock->link, &active_wake_locks[type]);
 	}
+	add_active_lock_locked(lock, type);
 	if (type == WAKE_LOCK_SUSPEND) {
 		current_event_num++;
 #ifdef CONFIG_WAKELOCK_STAT
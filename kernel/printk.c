@@ -41,6 +41,7 @@
 #include <linux/cpu.h>
 #include <linux/notifier.h>
 #include <linux/rculist.h>
+#include <linux/kthread.h>
 #include <trace/stm.h>
 
 #include <asm/uaccess.h>
@@ -683,6 +684,25 @@ static size_t log_prefix(const char *p, unsigned int *level, char *special)
 	return len;
 }
 
+/*
+ * Interrupts are off while consoles write, so hand them at most
+ * CONSOLE_CHUNK bytes at a time, cut at the end of a line if there is one.
+ */
+#define CONSOLE_CHUNK		128
+
+static unsigned console_chunk_end(unsigned start, unsigned end)
+{
+	unsigned i;
+
+	if (end - start <= CONSOLE_CHUNK)
+		return end;
+
+	for (i = start + CONSOLE_CHUNK; i != start; i--)
+		if (LOG_BUF(i - 1) == '\n')
+			return i;
+	return start + CONSOLE_CHUNK;
+}
+
 /*
  * Call the console drivers, asking them to write out
  * log_buf[start] to log_buf[end - 1].
@@ -926,7 +946,18 @@ static const char recursion_bug_msg [] =
 		KERN_CRIT "BUG: recent printk recursion!\n";
 static int recursion_bug;
 static int new_text_line = 1;
-static char printk_buf[1024];
+
+/*
+ * Messages are formatted into a buffer of the printing cpu, with interrupts
+ * off but outside logbuf_lock, which is only taken to copy the result into
+ * log_buf. printk_nesting catches a printk from within the formatting.
+ */
+#define PRINTK_LINE_MAX		1024
+
+static DEFINE_PER_CPU(char [PRINTK_LINE_MAX], printk_buf);
+static DEFINE_PER_CPU(int, printk_nesting);
+
+static bool printk_defer_output(unsigned long flags);
 
 int printk_delay_msec __read_mostly;
 
@@ -948,9 +979,9 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	int current_log_level = default_message_loglevel;
 	unsigned long flags;
 	int this_cpu;
-	char *p;
+	char *buf, *p;
 	size_t plen;
-	char special;
+	char special = 0;
 
 	boot_delay_msec();
 	printk_delay();
@@ -962,7 +993,8 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	/*
 	 * Ouch, printk recursed into itself!
 	 */
-	if (unlikely(printk_cpu == this_cpu)) {
+	if (unlikely(printk_cpu == this_cpu ||
+		     __this_cpu_read(printk_nesting))) {
 		/*
 		 * If a crash is occurring during printk() on this CPU,
 		 * then try to get the crash message out but make sure
@@ -977,46 +1009,46 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 		zap_locks();
 	}
 
-	lockdep_off();
-	raw_spin_lock(&logbuf_lock);
-	printk_cpu = this_cpu;
+	__this_cpu_inc(printk_nesting);
+	buf = __get_cpu_var(printk_buf);
 
 	if (recursion_bug) {
 		recursion_bug = 0;
-		strcpy(printk_buf, recursion_bug_msg);
+		strcpy(buf, recursion_bug_msg);
 		printed_len = strlen(recursion_bug_msg);
 	}
 	/* Emit the output into the temporary buffer */
-	printed_len += vscnprintf(printk_buf + printed_len,
-				  sizeof(printk_buf) - printed_len, fmt, args);
+	printed_len += vscnprintf(buf + printed_len,
+				  PRINTK_LINE_MAX - printed_len, fmt, args);
 
 #ifdef	CONFIG_PRINTK_LL
-	printascii(printk_buf);
+	printascii(buf);
 #endif
 
-	p = printk_buf;
+	p = buf;
 
 	/* Read log level and handle special printk prefix */
 	plen = log_prefix(p, &current_log_level, &special);
 	if (plen) {
 		p += plen;
 
-		switch (special) {
-		case 'c': /* Strip <c> KERN_CONT, continue line */
-			plen = 0;
-			break;
-		case 'd': /* Strip <d> KERN_DEFAULT, start new line */
+		/* Strip <c> KERN_CONT and <d> KERN_DEFAULT */
+		if (special == 'c' || special == 'd')
 			plen = 0;
-		default:
-			if (!new_text_line) {
-				emit_log_char('\n');
-				new_text_line = 1;
-			}
-		}
 	}
 
 	/* Send printk buffer to MIPI STM trace hardware too if enable */
-	stm_dup_printk(printk_buf, printed_len);
+	stm_dup_printk(buf, printed_len);
+
+	lockdep_off();
+	raw_spin_lock(&logbuf_lock);
+	printk_cpu = this_cpu;
+
+	/* A level or KERN_DEFAULT, but not KERN_CONT, starts a new line */
+	if ((plen || special == 'd') && !new_text_line) {
+		emit_log_char('\n');
+		new_text_line = 1;
+	}
 
 	/*
 	 * Copy the output into log_buf. If the caller didn't provide
@@ -1031,7 +1063,7 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 				int i;
 
 				for (i = 0; i < plen; i++)
-					emit_log_char(printk_buf[i]);
+					emit_log_char(buf[i]);
 				printed_len += plen;
 			} else {
 				/* Add log prefix */
@@ -1067,6 +1099,7 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 		if (*p == '\n')
 			new_text_line = 1;
 	}
+	__this_cpu_dec(printk_nesting);
 
 	/*
 	 * Try to acquire and then immediately release the
@@ -1078,7 +1111,10 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	 * will release 'logbuf_lock' regardless of whether it
 	 * actually gets the semaphore or not.
 	 */
-	if (console_trylock_for_printk(this_cpu))
+	if (printk_defer_output(flags)) {
+		printk_cpu = UINT_MAX;
+		raw_spin_unlock(&logbuf_lock);
+	} else if (console_trylock_for_printk(this_cpu))
 		console_unlock();
 
 	lockdep_on();
@@ -1096,6 +1132,11 @@ static void call_console_drivers(unsigned start, unsigned end)
 {
 }
 
+static unsigned console_chunk_end(unsigned start, unsigned end)
+{
+	return end;
+}
+
 #endif
 
 static int __add_preferred_console(char *name, int idx, char *options,
@@ -1341,10 +1382,14 @@ int is_console_locked(void)
 
 #define PRINTK_PENDING_WAKEUP	0x01
 #define PRINTK_PENDING_SCHED	0x02
+#define PRINTK_PENDING_OUTPUT	0x04
 
 static DEFINE_PER_CPU(int, printk_pending);
 static DEFINE_PER_CPU(char [PRINTK_BUF_SIZE], printk_sched_buf);
 
+/* kconsoled, which writes out what printk deferred */
+static DECLARE_WAIT_QUEUE_HEAD(printk_console_wait);
+
 void printk_tick(void)
 {
 	if (__this_cpu_read(printk_pending)) {
@@ -1355,6 +1400,8 @@ void printk_tick(void)
 		}
 		if (pending & PRINTK_PENDING_WAKEUP)
 			wake_up_interruptible(&log_wait);
+		if (pending & PRINTK_PENDING_OUTPUT)
+			wake_up_interruptible(&printk_console_wait);
 	}
 }
 
@@ -1371,6 +1418,49 @@ void wake_up_klogd(void)
 		this_cpu_or(printk_pending, PRINTK_PENDING_WAKEUP);
 }
 
+#ifdef CONFIG_PRINTK
+/*
+ * Console output of a printk from atomic context is left to a thread, so
+ * that a burst of messages from an interrupt handler does not hold up the
+ * cpu behind a slow console. Oopses still go straight out.
+ */
+static bool __read_mostly printk_defer_console = true;
+module_param_named(defer_console, printk_defer_console, bool,
+		   S_IRUGO | S_IWUSR);
+
+static struct task_struct *printk_console_task;
+
+/*
+ * Called from vprintk() with logbuf_lock held: if the console output is to
+ * be deferred, have the next tick on this cpu wake the console thread. The
+ * wakeup cannot be done from here, printk may be called under the runqueue
+ * locks.
+ */
+static bool printk_defer_output(unsigned long flags)
+{
+	if (!printk_defer_console || !printk_console_task || oops_in_progress)
+		return false;
+	if (!irqs_disabled_flags(flags) && !in_atomic())
+		return false;
+
+	__this_cpu_or(printk_pending, PRINTK_PENDING_OUTPUT);
+	return true;
+}
+
+static int printk_console_thread(void *unused)
+{
+	for (;;) {
+		/* resume_console() flushes what piles up while suspended */
+		wait_event_interruptible(printk_console_wait,
+					 con_start != log_end &&
+					 !console_suspended);
+		console_lock();
+		console_unlock();
+	}
+	return 0;
+}
+#endif
+
 /**
  * console_unlock - unlock the console system
  *
@@ -1405,8 +1495,8 @@ again:
 		if (con_start == log_end)
 			break;			/* Nothing to print */
 		_con_start = con_start;
-		_log_end = log_end;
-		con_start = log_end;		/* Flush */
+		_log_end = console_chunk_end(con_start, log_end);
+		con_start = _log_end;		/* Flush */
 		raw_spin_unlock(&logbuf_lock);
 		stop_critical_timings();	/* don't trace print latency */
 		call_console_drivers(_con_start, _log_end);
@@ -1756,6 +1846,12 @@ static int __init printk_late_init(void)
 		}
 	}
 	hotcpu_notifier(console_cpu_notify, 0);
+#ifdef CONFIG_PRINTK
+	printk_console_task = kthread_run(printk_console_thread, NULL,
+					  "kconsoled");
+	if (IS_ERR(printk_console_task))
+		printk_console_task = NULL;
+#endif
 	return 0;
 }
 late_initcall(printk_late_init);
@@ -62,7 +62,7 @@
 
 static struct lock_class_key rcu_node_class[NUM_RCU_LVLS];
 
-#define RCU_STATE_INITIALIZER(structname) { \
+#define RCU_STATE_INITIALIZER(structname, cr) { \
 	.level = { &structname##_state.node[0] }, \
 	.levelcnt = { \
 		NUM_RCU_LVL_0,  /* root of hierarchy. */ \
@@ -80,13 +80,15 @@ static struct lock_class_key rcu_node_class[NUM_RCU_LVLS];
 	.fqslock = __RAW_SPIN_LOCK_UNLOCKED(&structname##_state.fqslock), \
 	.n_force_qs = 0, \
 	.n_force_qs_ngp = 0, \
+	.call = cr, \
 	.name = #structname, \
 }
 
-struct rcu_state rcu_sched_state = RCU_STATE_INITIALIZER(rcu_sched);
+struct rcu_state rcu_sched_state =
+	RCU_STATE_INITIALIZER(rcu_sched, call_rcu_sched);
 DEFINE_PER_CPU(struct rcu_data, rcu_sched_data);
 
-struct rcu_state rcu_bh_state = RCU_STATE_INITIALIZER(rcu_bh);
+struct rcu_state rcu_bh_state = RCU_STATE_INITIALIZER(rcu_bh, call_rcu_bh);
 DEFINE_PER_CPU(struct rcu_data, rcu_bh_data);
 
 static struct rcu_state *rcu_state;
@@ -1395,6 +1397,10 @@ static void rcu_adopt_orphan_cbs(struct rcu_state *rsp)
 	    rsp->rcu_barrier_in_progress != current)
 		return;
 
+	/* No-CBs CPUs hand the orphans to their kthread. */
+	if (rcu_nocb_adopt_orphan_cbs(rsp, rdp))
+		return;
+
 	/* Do the accounting first. */
 	rdp->qlen_lazy += rsp->qlen_lazy;
 	rdp->qlen += rsp->qlen;
@@ -1871,7 +1877,7 @@ static void rcu_leak_callback(struct rcu_head *rhp)
  */
 static void
 __call_rcu(struct rcu_head *head, void (*func)(struct rcu_head *rcu),
-	   struct rcu_state *rsp, bool lazy)
+	   struct rcu_state *rsp, int cpu, bool lazy)
 {
 	unsigned long flags;
 	struct rcu_data *rdp;
@@ -1897,6 +1903,15 @@ __call_rcu(struct rcu_head *head, void (*func)(struct rcu_head *rcu),
 	local_irq_save(flags);
 	rdp = this_cpu_ptr(rsp->rda);
 
+	/* Hand the callback to the kthread of a no-CBs CPU. */
+	if (unlikely(cpu != -1 || is_nocb_cpu(rdp->cpu))) {
+		if (cpu != -1)
+			rdp = per_cpu_ptr(rsp->rda, cpu);
+		WARN_ON_ONCE(!__call_rcu_nocb(rdp, head, lazy));
+		local_irq_restore(flags);
+		return;
+	}
+
 	/* Add the callback to our list. */
 	rdp->qlen++;
 	if (lazy)
@@ -1958,7 +1973,7 @@ __call_rcu(struct rcu_head *head, void (*func)(struct rcu_head *rcu),
  */
 void call_rcu_sched(struct rcu_head *head, void (*func)(struct rcu_head *rcu))
 {
-	__call_rcu(head, func, &rcu_sched_state, 0);
+	__call_rcu(head, func, &rcu_sched_state, -1, 0);
 }
 EXPORT_SYMBOL_GPL(call_rcu_sched);
 
@@ -1967,7 +1982,7 @@ EXPORT_SYMBOL_GPL(call_rcu_sched);
  */
 void call_rcu_bh(struct rcu_head *head, void (*func)(struct rcu_head *rcu))
 {
-	__call_rcu(head, func, &rcu_bh_state, 0);
+	__call_rcu(head, func, &rcu_bh_state, -1, 0);
 }
 EXPORT_SYMBOL_GPL(call_rcu_bh);
 
@@ -2250,6 +2265,30 @@ static int rcu_cpu_has_callbacks(int cpu)
 	       rcu_preempt_cpu_has_callbacks(cpu);
 }
 
+#ifdef CONFIG_NO_HZ_ADAPTIVE
+
+/* Does the current grace period still wait for a quiescent state here? */
+static int rcu_needs_qs(struct rcu_data *rdp)
+{
+	return rdp->qs_pending && !rdp->passed_quiesce;
+}
+
+/*
+ * Does RCU rely on the scheduling-clock tick of the specified busy CPU,
+ * either to advance callbacks or to notice a quiescent state?  A tick
+ * taken in user mode records the quiescent state before this is asked,
+ * so a CPU running user code without callbacks normally does not.
+ */
+int rcu_needs_tick(int cpu)
+{
+	return rcu_cpu_has_callbacks(cpu) ||
+	       rcu_needs_qs(&per_cpu(rcu_sched_data, cpu)) ||
+	       rcu_needs_qs(&per_cpu(rcu_bh_data, cpu)) ||
+	       rcu_needs_qs(per_cpu_ptr(rcu_state->rda, cpu));
+}
+
+#endif /* #ifdef CONFIG_NO_HZ_ADAPTIVE */
+
 /*
  * RCU callback function for _rcu_barrier().  If we are last, wake
  * up the task executing _rcu_barrier().
@@ -2328,7 +2367,12 @@ static void _rcu_barrier(struct rcu_state *rsp,
 	for_each_possible_cpu(cpu) {
 		preempt_disable();
 		rdp = per_cpu_ptr(rsp->rda, cpu);
-		if (cpu_is_offline(cpu)) {
+		if (is_nocb_cpu(cpu)) {
+			preempt_enable();
+			atomic_inc(&rcu_barrier_cpu_count);
+			__call_rcu(&per_cpu(rcu_barrier_head, cpu),
+				   rcu_barrier_callback, rsp, cpu, 0);
+		} else if (cpu_is_offline(cpu)) {
 			preempt_enable();
 			while (cpu_is_offline(cpu) && ACCESS_ONCE(rdp->qlen))
 				schedule_timeout_interruptible(1);
@@ -2415,6 +2459,7 @@ rcu_boot_init_percpu_data(int cpu, struct rcu_state *rsp)
 	WARN_ON_ONCE(atomic_read(&rdp->dynticks->dynticks) != 1);
 	rdp->cpu = cpu;
 	rdp->rsp = rsp;
+	rcu_boot_init_nocb_percpu_data(rdp);
 	raw_spin_unlock_irqrestore(&rnp->lock, flags);
 }
 
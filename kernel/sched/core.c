@@ -72,6 +72,8 @@
 #include <linux/slab.h>
 #include <linux/init_task.h>
 #include <linux/binfmts.h>
+#include <linux/cpufreq_task_stats.h>
+#include <linux/uid_cputime.h>
 
 #include <asm/switch_to.h>
 #include <asm/tlb.h>
@@ -615,6 +617,19 @@ static inline bool got_nohz_idle_kick(void)
 	return idle_cpu(cpu) && test_bit(NOHZ_BALANCE_KICK, nohz_flags(cpu));
 }
 
+#ifdef CONFIG_NO_HZ_ADAPTIVE
+/*
+ * Is the current task the only runnable one on this cpu, and a CFS task?
+ * Then nothing needs the tick to preempt or time-slice it.
+ */
+bool sched_single_fair_task(void)
+{
+	struct rq *rq = this_rq();
+
+	return rq->nr_running == 1 && rq->curr->sched_class == &fair_sched_class;
+}
+#endif
+
 #else /* CONFIG_NO_HZ */
 
 static inline bool got_nohz_idle_kick(void)
@@ -1484,6 +1499,8 @@ static void sched_ttwu_pending(void)
 
 void scheduler_ipi(void)
 {
+	tick_nohz_stretch_restart();
+
 	if (llist_empty(&this_rq()->wake_list) && !got_nohz_idle_kick())
 		return;
 
@@ -2880,6 +2897,10 @@ void account_user_time(struct task_struct *p, cputime_t cputime,
 
 	/* Account for user time used */
 	acct_update_integrals(p);
+
+	/* Account user time to the current cpu frequency */
+	cpufreq_task_stats_account(p, cputime);
+	uid_cputime_account(p, cputime, true);
 }
 
 /*
@@ -2930,6 +2951,10 @@ void __account_system_time(struct task_struct *p, cputime_t cputime,
 
 	/* Account for system time used */
 	acct_update_integrals(p);
+
+	/* Account system time to the current cpu frequency */
+	cpufreq_task_stats_account(p, cputime);
+	uid_cputime_account(p, cputime, false);
 }
 
 /*
@@ -7180,6 +7205,9 @@ int in_sched_functions(unsigned long addr)
 #ifdef CONFIG_CGROUP_SCHED
 struct task_group root_task_group;
 LIST_HEAD(task_groups);
+#ifdef CONFIG_SCHEDSTATS
+static DEFINE_PER_CPU(struct sched_lat_hist, root_lat_hist);
+#endif
 #endif
 
 DECLARE_PER_CPU(cpumask_var_t, load_balance_tmpmask);
@@ -7239,6 +7267,9 @@ void __init sched_init(void)
 
 #ifdef CONFIG_CGROUP_SCHED
 	list_add(&root_task_group.list, &task_groups);
+#ifdef CONFIG_SCHEDSTATS
+	root_task_group.lat_hist = &root_lat_hist;
+#endif
 	INIT_LIST_HEAD(&root_task_group.children);
 	INIT_LIST_HEAD(&root_task_group.siblings);
 	autogroup_init(&init_task);
@@ -7527,10 +7558,31 @@ void set_curr_task(int cpu, struct task_struct *p)
 /* task_group_lock serializes the addition/removal of task groups */
 static DEFINE_SPINLOCK(task_group_lock);
 
+#ifdef CONFIG_SCHEDSTATS
+static int alloc_lat_hist(struct task_group *tg)
+{
+	tg->lat_hist = alloc_percpu(struct sched_lat_hist);
+	return tg->lat_hist != NULL;
+}
+
+static void free_lat_hist(struct task_group *tg)
+{
+	free_percpu(tg->lat_hist);
+}
+#else
+static inline int alloc_lat_hist(struct task_group *tg)
+{
+	return 1;
+}
+
+static inline void free_lat_hist(struct task_group *tg) { }
+#endif
+
 static void free_sched_group(struct task_group *tg)
 {
 	free_fair_sched_group(tg);
 	free_rt_sched_group(tg);
+	free_lat_hist(tg);
 	autogroup_free(tg);
 	kfree(tg);
 }
@@ -7551,6 +7603,9 @@ struct task_group *sched_create_group(struct task_group *parent)
 	if (!alloc_rt_sched_group(tg, parent))
 		goto err;
 
+	if (!alloc_lat_hist(tg))
+		goto err;
+
 	spin_lock_irqsave(&task_group_lock, flags);
 	list_add_rcu(&tg->list, &task_groups);
 
@@ -8008,6 +8063,24 @@ static u64 cpu_shares_read_u64(struct cgroup *cgrp, struct cftype *cft)
 	return (u64) scale_load_down(tg->shares);
 }
 
+static int cpu_latency_sensitive_write_u64(struct cgroup *cgrp,
+					   struct cftype *cft, u64 val)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+
+	if (tg == &root_task_group)
+		return -EINVAL;
+
+	tg->latency_sensitive = !!val;
+	return 0;
+}
+
+static u64 cpu_latency_sensitive_read_u64(struct cgroup *cgrp,
+					  struct cftype *cft)
+{
+	return cgroup_tg(cgrp)->latency_sensitive;
+}
+
 #ifdef CONFIG_CFS_BANDWIDTH
 static DEFINE_MUTEX(cfs_constraints_mutex);
 
@@ -8271,6 +8344,28 @@ static u64 cpu_rt_period_read_uint(struct cgroup *cgrp, struct cftype *cft)
 }
 #endif /* CONFIG_RT_GROUP_SCHED */
 
+#ifdef CONFIG_SCHEDSTATS
+static int cpu_lat_hist_show(struct cgroup *cgrp, struct cftype *cft,
+			     struct seq_file *m)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+	int i, cpu;
+
+	for (i = 0; i < SCHED_LAT_BUCKETS; i++) {
+		u64 count = 0;
+
+		for_each_possible_cpu(cpu)
+			count += per_cpu_ptr(tg->lat_hist, cpu)->count[i];
+
+		if (i < SCHED_LAT_BUCKETS - 1)
+			seq_printf(m, "%lu %llu\n", 1024UL << i, count);
+		else
+			seq_printf(m, "inf %llu\n", count);
+	}
+	return 0;
+}
+#endif
+
 static struct cftype cpu_files[] = {
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	{
@@ -8278,6 +8373,11 @@ static struct cftype cpu_files[] = {
 		.read_u64 = cpu_shares_read_u64,
 		.write_u64 = cpu_shares_write_u64,
 	},
+	{
+		.name = "latency_sensitive",
+		.read_u64 = cpu_latency_sensitive_read_u64,
+		.write_u64 = cpu_latency_sensitive_write_u64,
+	},
 #endif
 #ifdef CONFIG_CFS_BANDWIDTH
 	{
@@ -8307,6 +8407,12 @@ static struct cftype cpu_files[] = {
 		.write_u64 = cpu_rt_period_write_uint,
 	},
 #endif
+#ifdef CONFIG_SCHEDSTATS
+	{
+		.name = "latency_hist",
+		.read_seq_string = cpu_lat_hist_show,
+	},
+#endif
 };
 
 static int cpu_cgroup_populate(struct cgroup_subsys *ss, struct cgroup *cont)
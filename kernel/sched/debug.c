@@ -464,6 +464,16 @@ void proc_sched_show_task(struct task_struct *p, struct seq_file *m)
 	P(se.statistics.nr_wakeups_passive);
 	P(se.statistics.nr_wakeups_idle);
 
+	if (p->se.statistics.lat_hist_on) {
+		int i;
+
+		for (i = 0; i < SCHED_LAT_BUCKETS - 1; i++)
+			SEQ_printf(m, "lat_hist.%-26lu:%21u\n", 1024UL << i,
+				   p->se.statistics.lat_hist.count[i]);
+		SEQ_printf(m, "%-35s:%21u\n", "lat_hist.inf",
+			   p->se.statistics.lat_hist.count[i]);
+	}
+
 	{
 		u64 avg_atom, avg_per_cpu;
 
@@ -516,3 +526,10 @@ void proc_sched_set_task(struct task_struct *p)
 	memset(&p->se.statistics, 0, sizeof(p->se.statistics));
 #endif
 }
+
+void proc_sched_set_lat_hist(struct task_struct *p)
+{
+#ifdef CONFIG_SCHEDSTATS
+	p->se.statistics.lat_hist_on = 1;
+#endif
+}
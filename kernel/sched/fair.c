@@ -89,6 +89,12 @@ unsigned int normalized_sysctl_sched_wakeup_granularity = 1000000UL;
 
 const_debug unsigned int sysctl_sched_migration_cost = 500000UL;
 
+/*
+ * Total load, in percent of one nice-0 task running all the time, under
+ * which PACKING keeps the system on as few cpus as possible.
+ */
+const_debug unsigned int sysctl_sched_packing_load = 80;
+
 /*
  * The exponential sliding  window over which load is averaged for shares
  * distribution.
@@ -319,6 +325,11 @@ static inline int depth_se(struct sched_entity *se)
 	return depth;
 }
 
+static inline int task_latency_sensitive(struct task_struct *p)
+{
+	return task_group(p)->latency_sensitive;
+}
+
 static void
 find_matching_se(struct sched_entity **se, struct sched_entity **pse)
 {
@@ -414,6 +425,11 @@ find_matching_se(struct sched_entity **se, struct sched_entity **pse)
 {
 }
 
+static inline int task_latency_sensitive(struct task_struct *p)
+{
+	return 0;
+}
+
 #endif	/* CONFIG_FAIR_GROUP_SCHED */
 
 static __always_inline
@@ -2700,6 +2716,56 @@ done:
 	return target;
 }
 
+/*
+ * While the decayed load of all active cpus together stays under
+ * sysctl_sched_packing_load, return the lowest-numbered busy cpu in
+ * @allowed (any active cpu if NULL) for wakeups to pile onto, so the
+ * idle ones stay idle and the hotplug governors can take them down.
+ * Returns -1 when packing is off or the load is too high.
+ */
+static int sched_packing_cpu(const struct cpumask *allowed)
+{
+	unsigned long limit = NICE_0_LOAD * sysctl_sched_packing_load / 100;
+	unsigned long load = 0;
+	int i, pack = -1;
+
+	if (!sched_feat(PACKING))
+		return -1;
+
+	for_each_cpu(i, cpu_active_mask) {
+		load += target_load(i, 2);
+		if (load > limit)
+			return -1;
+
+		if (pack < 0 && cpu_rq(i)->nr_running &&
+		    (!allowed || cpumask_test_cpu(i, allowed)))
+			pack = i;
+	}
+
+	return pack;
+}
+
+/*
+ * Latency sensitive tasks would rather start on any idle cpu than queue
+ * behind the work on the chosen one. Cpus that are going down are no
+ * longer active and are skipped, so a woken task does not land on a
+ * core the hotplug governor is taking away.
+ */
+static int select_idle_active_cpu(struct task_struct *p, int target)
+{
+	int i;
+
+	if (idle_cpu(target) && cpu_active(target))
+		return target;
+
+	for_each_cpu_and(i, tsk_cpus_allowed(p), cpu_active_mask) {
+		if (idle_cpu(i))
+			return i;
+	}
+
+	return target;
+}
+
 /*
  * sched_balance_self: balance the current task (running on cpu) in domains
  * that have the 'flag' flag set. In practice, this is SD_BALANCE_FORK and
@@ -2725,6 +2791,14 @@ select_task_rq_fair(struct task_struct *p, int sd_flag, int wake_flags)
 	if (p->rt.nr_cpus_allowed == 1)
 		return prev_cpu;
 
+	if ((sd_flag & (SD_BALANCE_WAKE | SD_BALANCE_FORK)) &&
+	    !task_latency_sensitive(p)) {
+		int pack_cpu = sched_packing_cpu(tsk_cpus_allowed(p));
+
+		if (pack_cpu >= 0)
+			return pack_cpu;
+	}
+
 	if (sd_flag & SD_BALANCE_WAKE) {
 		if (cpumask_test_cpu(cpu, tsk_cpus_allowed(p)))
 			want_affine = 1;
@@ -2827,6 +2901,8 @@ select_task_rq_fair(struct task_struct *p, int sd_flag, int wake_flags)
 		/* while loop will break here if sd == NULL */
 	}
 unlock:
+	if ((sd_flag & SD_BALANCE_WAKE) && task_latency_sensitive(p))
+		new_cpu = select_idle_active_cpu(p, new_cpu);
 	rcu_read_unlock();
 
 	return new_cpu;
@@ -2963,6 +3039,18 @@ static void check_preempt_wakeup(struct rq *rq, struct task_struct *p, int wake_
 	find_matching_se(&se, &pse);
 	update_curr(cfs_rq_of(se));
 	BUG_ON(!pse);
+
+	/*
+	 * A latency sensitive task preempts any other task it is ahead of;
+	 * the wakeup granularity only applies among its peers.
+	 */
+	if (task_latency_sensitive(p) && !task_latency_sensitive(curr) &&
+	    wakeup_preempt_entity(se, pse) >= 0) {
+		if (!next_buddy_marked)
+			set_next_buddy(pse);
+		goto preempt;
+	}
+
 	if (wakeup_preempt_entity(se, pse) == 1) {
 		/*
 		 * Bias pick_next to pick the sched entity that is
@@ -4600,6 +4688,10 @@ void idle_balance(int this_cpu, struct rq *this_rq)
 	if (this_rq->avg_idle < sysctl_sched_migration_cost)
 		return;
 
+	/* while packing, a cpu going idle stays idle */
+	if (sched_packing_cpu(NULL) >= 0)
+		return;
+
 	/*
 	 * Drop the rq->lock, but keep IRQ/preempt disabled.
 	 */
@@ -4953,6 +5045,7 @@ static void rebalance_domains(int cpu, enum cpu_idle_type idle)
 	unsigned long next_balance = jiffies + 60*HZ;
 	int update_next_balance = 0;
 	int need_serialize;
+	int packing = idle == CPU_IDLE && sched_packing_cpu(NULL) >= 0;
 
 	update_shares(cpu);
 
@@ -4977,7 +5070,8 @@ static void rebalance_domains(int cpu, enum cpu_idle_type idle)
 		}
 
 		if (time_after_eq(jiffies, sd->last_balance + interval)) {
-			if (load_balance(cpu, rq, sd, idle, &balance)) {
+			/* idle cpus do not pull work while packing */
+			if (!packing && load_balance(cpu, rq, sd, idle, &balance)) {
 				/*
 				 * We've pulled tasks over so either we're no
 				 * longer idle.
@@ -66,6 +66,12 @@ SCHED_FEAT(NONTASK_POWER, true)
  */
 SCHED_FEAT(TTWU_QUEUE, true)
 
+/*
+ * Keep light loads on the lowest-numbered busy cpu so the other cpus can
+ * stay idle, see sched_packing_cpu().
+ */
+SCHED_FEAT(PACKING, false)
+
 SCHED_FEAT(FORCE_SD_OVERLAP, false)
 SCHED_FEAT(RT_RUNTIME_SHARE, true)
 SCHED_FEAT(LB_MIN, false)
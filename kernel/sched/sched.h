@@ -3,6 +3,7 @@
 #include <linux/mutex.h>
 #include <linux/spinlock.h>
 #include <linux/stop_machine.h>
+#include <linux/tick.h>
 
 #include "cpupri.h"
 
@@ -110,6 +111,8 @@ struct task_group {
 	/* runqueue "owned" by this group on each cpu */
 	struct cfs_rq **cfs_rq;
 	unsigned long shares;
+	/* wakeups prefer idle cpus and preempt without granularity */
+	int latency_sensitive;
 
 	atomic_t load_weight;
 #endif
@@ -132,6 +135,10 @@ struct task_group {
 	struct autogroup *autogroup;
 #endif
 
+#ifdef CONFIG_SCHEDSTATS
+	struct sched_lat_hist __percpu *lat_hist;
+#endif
+
 	struct cfs_bandwidth cfs_bandwidth;
 };
 
@@ -913,14 +920,24 @@ extern void cpuacct_charge(struct task_struct *tsk, u64 cputime);
 static inline void cpuacct_charge(struct task_struct *tsk, u64 cputime) {}
 #endif
 
+extern void sched_update_nr_prod(int cpu, unsigned long nr_running);
+
 static inline void inc_nr_running(struct rq *rq)
 {
 	rq->nr_running++;
+	sched_update_nr_prod(cpu_of(rq), rq->nr_running);
+	/* a second task needs the tick to share the cpu */
+	if (rq->nr_running == 2)
+		tick_nohz_stretch_kick(cpu_of(rq));
 }
 
 static inline void dec_nr_running(struct rq *rq)
 {
 	rq->nr_running--;
+	sched_update_nr_prod(cpu_of(rq), rq->nr_running);
+	/* catch up with the accounting before the cpu goes idle */
+	if (!rq->nr_running)
+		tick_nohz_stretch_kick(cpu_of(rq));
 }
 
 extern void update_rq_clock(struct rq *rq);
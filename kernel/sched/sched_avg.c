@@ -0,0 +1,122 @@
+/*
+ * kernel/sched/sched_avg.c
+ *
+ * Runqueue length averages for cpufreq governors and hotplug policies.
+ *
+ * Every runqueue keeps the time integral of its nr_running, advanced
+ * whenever nr_running changes. Readers never touch the runqueue lock:
+ * they take a snapshot of the integral and divide the difference between
+ * two snapshots by the time between them. Each reader keeps its own
+ * snapshot, so any number of governors and hotplug policies can sample at
+ * their own rate without a timer of their own and without resetting each
+ * other's window.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/seqlock.h>
+
+#include "sched.h"
+
+struct nr_stats {
+	seqcount_t seq;
+	u64 stamp;
+	u64 integral;
+	unsigned long nr_running;
+};
+
+static DEFINE_PER_CPU(struct nr_stats, runqueue_nr_stats);
+
+/*
+ * Called with rq->lock held after rq->nr_running changed, so the writers
+ * of one cpu's stats are serialised by that lock.
+ */
+void sched_update_nr_prod(int cpu, unsigned long nr_running)
+{
+	struct nr_stats *stats = &per_cpu(runqueue_nr_stats, cpu);
+	u64 now = sched_clock();
+
+	write_seqcount_begin(&stats->seq);
+	if (now > stats->stamp)
+		stats->integral += (u64)stats->nr_running *
+				   (now - stats->stamp);
+	stats->stamp = now;
+	stats->nr_running = nr_running;
+	write_seqcount_end(&stats->seq);
+}
+
+static u64 nr_stats_integral(int cpu, u64 now)
+{
+	struct nr_stats *stats = &per_cpu(runqueue_nr_stats, cpu);
+	unsigned long nr;
+	unsigned int seq;
+	u64 integral, stamp;
+
+	do {
+		seq = read_seqcount_begin(&stats->seq);
+		integral = stats->integral;
+		stamp = stats->stamp;
+		nr = stats->nr_running;
+	} while (read_seqcount_retry(&stats->seq, seq));
+
+	if (now > stamp)
+		integral += (u64)nr * (now - stamp);
+
+	return integral;
+}
+
+/**
+ * sched_nr_running_snapshot - record the runqueue integral of a cpu
+ * @cpu:	cpu to sample, or -1 for the sum over all cpus
+ * @snap:	filled in with the current time and integral
+ */
+void sched_nr_running_snapshot(int cpu, struct sched_nr_snapshot *snap)
+{
+	u64 now = sched_clock();
+	int i;
+
+	snap->stamp = now;
+	if (cpu >= 0) {
+		snap->integral = nr_stats_integral(cpu, now);
+		return;
+	}
+
+	snap->integral = 0;
+	for_each_possible_cpu(i)
+		snap->integral += nr_stats_integral(i, now);
+}
+EXPORT_SYMBOL_GPL(sched_nr_running_snapshot);
+
+/**
+ * sched_nr_running_avg - average runqueue length since a snapshot
+ * @cpu:	cpu to sample, or -1 for the sum over all cpus
+ * @prev:	snapshot taken by the previous call, updated to now
+ *
+ * Returns the average number of runnable tasks since @prev, times 100.
+ * A zeroed @prev yields the instantaneous value.
+ */
+unsigned int sched_nr_running_avg(int cpu, struct sched_nr_snapshot *prev)
+{
+	struct sched_nr_snapshot cur;
+	u64 delta;
+	bool first = !prev->stamp;
+
+	sched_nr_running_snapshot(cpu, &cur);
+	delta = cur.stamp - prev->stamp;
+	if (first || !delta || cur.stamp < prev->stamp) {
+		*prev = cur;
+		return (cpu >= 0 ? get_cpu_nr_running(cpu) : nr_running()) * 100;
+	}
+
+	delta = div64_u64((cur.integral - prev->integral) * 100, delta);
+	*prev = cur;
+
+	return (unsigned int)delta;
+}
+EXPORT_SYMBOL_GPL(sched_nr_running_avg);
@@ -47,6 +47,29 @@ rq_sched_info_depart(struct rq *rq, unsigned long long delta)
 # define schedstat_set(var, val)	do { } while (0)
 #endif
 
+#ifdef CONFIG_SCHEDSTATS
+/*
+ * Account a wait-to-run latency in the task's group and, when asked for
+ * through /proc/<pid>/sched, in the task itself. Called with the rq lock.
+ */
+static inline void
+sched_lat_account(struct task_struct *t, unsigned long long delta)
+{
+	int b = min_t(int, fls64(delta >> 10), SCHED_LAT_BUCKETS - 1);
+#ifdef CONFIG_CGROUP_SCHED
+	/* task_group() is defined after this file is included */
+	struct task_group *tg = t->sched_task_group;
+
+	if (tg->lat_hist)
+		__this_cpu_inc(tg->lat_hist->count[b]);
+#endif
+	if (t->se.statistics.lat_hist_on)
+		t->se.statistics.lat_hist.count[b]++;
+}
+#else
+# define sched_lat_account(t, delta)	do { } while (0)
+#endif
+
 #if defined(CONFIG_SCHEDSTATS) || defined(CONFIG_TASK_DELAY_ACCT)
 static inline void sched_info_reset_dequeued(struct task_struct *t)
 {
@@ -81,8 +104,10 @@ static void sched_info_arrive(struct task_struct *t)
 {
 	unsigned long long now = task_rq(t)->clock, delta = 0;
 
-	if (t->sched_info.last_queued)
+	if (t->sched_info.last_queued) {
 		delta = now - t->sched_info.last_queued;
+		sched_lat_account(t, delta);
+	}
 	sched_info_reset_dequeued(t);
 	t->sched_info.run_delay += delta;
 	t->sched_info.last_arrival = now;
@@ -128,6 +128,10 @@ int (*timer_slack_check)(struct task_struct *task, unsigned long slack_ns) =
 	NULL;
 EXPORT_SYMBOL_GPL(timer_slack_check);
 
+unsigned long (*timer_slack_adjust)(struct task_struct *task,
+				    unsigned long slack_ns) = NULL;
+EXPORT_SYMBOL_GPL(timer_slack_adjust);
+
 /*
  * Returns true if current's euid is same as p's uid or euid,
  * or has CAP_SYS_NICE to p's user_ns.
@@ -825,6 +825,101 @@ static void wakeup_user(void)
 		queue_work(rq_wq, &rq_info.def_timer_work);
 	}
 }
+
+#ifdef CONFIG_NO_HZ_ADAPTIVE
+/*
+ * Adaptive tick: a cpu whose only runnable task is a CFS task in user
+ * mode needs its tick for little more than accounting, so the tick is
+ * programmed up to tick_stretch_max periods ahead instead of one, and
+ * the jiffies that went by are accounted to the task when it comes back.
+ * The cpu with the do_timer duty never stretches, so jiffies and the rest
+ * of the housekeeping stay on it. A second runnable task or the task
+ * going to sleep restarts the periodic tick right away, locally or
+ * through a reschedule IPI.
+ */
+static int tick_stretch_max __read_mostly = DIV_ROUND_UP(HZ, 50);
+
+static int __init setup_tick_stretch(char *str)
+{
+	get_option(&str, &tick_stretch_max);
+	tick_stretch_max = max(tick_stretch_max, 1);
+	return 1;
+}
+__setup("nohz_stretch=", setup_tick_stretch);
+
+static bool tick_stretch_cpu_timers(struct task_struct *p)
+{
+	return p->cputime_expires.utime || p->cputime_expires.stime ||
+	       p->cputime_expires.sum_exec_runtime ||
+	       p->signal->cputimer.running;
+}
+
+/* Tick periods to program ahead of the tick that just ran */
+static unsigned int tick_stretch_periods(int cpu, int user)
+{
+	unsigned long next, delta;
+
+	if (tick_stretch_max <= 1 || !user || tick_do_timer_cpu == cpu ||
+	    !sched_single_fair_task() || tick_stretch_cpu_timers(current) ||
+	    rcu_needs_tick(cpu) || printk_needs_cpu(cpu) || arch_needs_cpu(cpu))
+		return 1;
+
+	next = get_next_timer_interrupt(jiffies);
+	delta = next - jiffies;
+	return clamp_t(unsigned long, delta, 1, tick_stretch_max);
+}
+
+/* Account the ticks skipped since the last one, up to and excluding @upto */
+static void tick_stretch_account(struct tick_sched *ts, unsigned long upto)
+{
+	long ticks = upto - ts->stretch_jiffies - 1;
+
+	ticks = min_t(long, ticks, ts->stretch - 1);
+	while (ticks-- > 0)
+		account_process_tick(current, 1);
+}
+
+/*
+ * Bring the periodic tick back on this cpu, called with interrupts
+ * disabled when something other than the single task may need the cpu.
+ */
+void tick_nohz_stretch_restart(void)
+{
+	struct tick_sched *ts = &__get_cpu_var(tick_cpu_sched);
+	ktime_t now;
+
+	if (likely(ts->stretch <= 1) || ts->tick_stopped)
+		return;
+
+	/* Called from within the tick itself, which decides on its own */
+	if (hrtimer_try_to_cancel(&ts->sched_timer) < 0)
+		return;
+
+	tick_stretch_account(ts, jiffies + 1);
+	ts->stretch = 1;
+
+	/* no softirq wakeup, the caller may hold a runqueue lock */
+	now = ktime_get();
+	hrtimer_set_expires(&ts->sched_timer, ts->stretch_last);
+	hrtimer_forward(&ts->sched_timer, now, tick_period);
+	__hrtimer_start_range_ns(&ts->sched_timer,
+				 hrtimer_get_expires(&ts->sched_timer), 0,
+				 HRTIMER_MODE_ABS_PINNED, 0);
+}
+
+/* The number of runnable tasks on @cpu just left one, with rq->lock held */
+void tick_nohz_stretch_kick(int cpu)
+{
+	if (likely(per_cpu(tick_cpu_sched, cpu).stretch <= 1))
+		return;
+
+	if (cpu == smp_processor_id())
+		tick_nohz_stretch_restart();
+	else
+		smp_send_reschedule(cpu);
+}
+#endif
+
 /*
  * We rearm the timer until we get disabled by the idle code.
  * Called with interrupts disabled and timer->base->cpu_base->lock held.
@@ -836,6 +931,7 @@ static enum hrtimer_restart tick_sched_timer(struct hrtimer *timer)
 	struct pt_regs *regs = get_irq_regs();
 	ktime_t now = ktime_get();
 	int cpu = smp_processor_id();
+	unsigned int periods = 1;
 
 #ifdef CONFIG_NO_HZ
 	/*
@@ -870,6 +966,10 @@ static enum hrtimer_restart tick_sched_timer(struct hrtimer *timer)
 			touch_softlockup_watchdog();
 			ts->idle_jiffies++;
 		}
+#ifdef CONFIG_NO_HZ_ADAPTIVE
+		if (ts->stretch > 1)
+			tick_stretch_account(ts, jiffies);
+#endif
 		update_process_times(user_mode(regs));
 		profile_tick(CPU_PROFILING);
 
@@ -885,9 +985,20 @@ static enum hrtimer_restart tick_sched_timer(struct hrtimer *timer)
 			 */
 			wakeup_user();
 		}
+
+#ifdef CONFIG_NO_HZ_ADAPTIVE
+		periods = tick_stretch_periods(cpu, user_mode(regs));
+		ts->stretch = periods;
+		ts->stretch_jiffies = jiffies;
+		ts->stretch_last = hrtimer_get_expires(timer);
+#endif
 	}
 
-	hrtimer_forward(timer, now, tick_period);
+	if (likely(periods == 1))
+		hrtimer_forward(timer, now, tick_period);
+	else
+		hrtimer_forward(timer, now,
+				ns_to_ktime(ktime_to_ns(tick_period) * periods));
 
 	return HRTIMER_RESTART;
 }
@@ -314,6 +314,26 @@ unsigned long round_jiffies_up_relative(unsigned long j)
 }
 EXPORT_SYMBOL_GPL(round_jiffies_up_relative);
 
+/**
+ * align_jiffies_relative - delay to the next multiple of a sampling period
+ * @period: the sampling period in jiffies
+ *
+ * Periodic sampling work that rearms itself with this delay expires on
+ * jiffies that are multiples of @period, unlike round_jiffies() with no
+ * per-cpu skew. Work sampling at periods that divide one another then
+ * runs off the same tick, so a CPU leaves idle once for all of it; made
+ * deferrable, it does not wake an idle CPU at all.
+ *
+ * The return value is between 1 and @period.
+ */
+unsigned long align_jiffies_relative(unsigned long period)
+{
+	if (!period)
+		return 1;
+	return period - jiffies % period;
+}
+EXPORT_SYMBOL_GPL(align_jiffies_relative);
+
 /**
  * set_timer_slack - set the allowed slack for a timer
  * @timer: the timer to be modified
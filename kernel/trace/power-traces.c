@@ -12,9 +12,13 @@
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/power.h>
+#include <trace/events/dvfs.h>
 
 #ifdef EVENT_POWER_TRACING_DEPRECATED
 EXPORT_TRACEPOINT_SYMBOL_GPL(power_start);
 #endif
 EXPORT_TRACEPOINT_SYMBOL_GPL(cpu_idle);
 
+/* the governors can be modules */
+EXPORT_TRACEPOINT_SYMBOL_GPL(dvfs_governor);
+EXPORT_TRACEPOINT_SYMBOL_GPL(dvfs_hotplug_check);
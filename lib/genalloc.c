@@ -372,6 +372,86 @@ retry:
 }
 EXPORT_SYMBOL(gen_pool_alloc_aligned);
 
+/*
+ * Find the highest run of @nr clear bits in the first @size bits of
+ * @map, returns @size if there is none.
+ */
+static unsigned long bitmap_find_last_zero_area(unsigned long *map,
+						unsigned long size,
+						unsigned long nr)
+{
+	unsigned long start = 0, end, found = size;
+
+	for (;;) {
+		start = find_next_zero_bit(map, size, start);
+		if (start >= size)
+			break;
+		end = find_next_bit(map, size, start);
+		if (end - start >= nr)
+			found = end - nr;
+		start = end;
+	}
+	return found;
+}
+
+/**
+ * gen_pool_alloc_top - allocate special memory from the top of the pool
+ * @pool: pool to allocate from
+ * @size: number of bytes to allocate from the pool
+ *
+ * Like gen_pool_alloc(), but takes the highest free range that fits, so
+ * callers can keep allocations of one kind packed at the top of the pool
+ * and the rest packed at the bottom.  Can not be used in NMI handler on
+ * architectures without NMI-safe cmpxchg implementation.
+ */
+unsigned long gen_pool_alloc_top(struct gen_pool *pool, size_t size)
+{
+	struct gen_pool_chunk *chunk, *found;
+	unsigned long addr = 0;
+	int order = pool->min_alloc_order;
+	int nbits, start_bit = 0, end_bit, bit, remain;
+
+#ifndef CONFIG_ARCH_HAVE_NMI_SAFE_CMPXCHG
+	BUG_ON(in_nmi());
+#endif
+
+	if (size == 0)
+		return 0;
+
+	nbits = (size + (1UL << order) - 1) >> order;
+	rcu_read_lock();
+retry:
+	found = NULL;
+	list_for_each_entry_rcu(chunk, &pool->chunks, next_chunk) {
+		if (size > atomic_read(&chunk->avail))
+			continue;
+
+		end_bit = (chunk->end_addr - chunk->start_addr) >> order;
+		bit = bitmap_find_last_zero_area(chunk->bits, end_bit, nbits);
+		if (bit < end_bit &&
+		    (!found || chunk->start_addr > found->start_addr)) {
+			found = chunk;
+			start_bit = bit;
+		}
+	}
+
+	if (found) {
+		remain = bitmap_set_ll(found->bits, start_bit, nbits);
+		if (remain) {
+			remain = bitmap_clear_ll(found->bits, start_bit,
+						 nbits - remain);
+			BUG_ON(remain);
+			goto retry;
+		}
+
+		addr = found->start_addr + ((unsigned long)start_bit << order);
+		atomic_sub(nbits << order, &found->avail);
+	}
+	rcu_read_unlock();
+	return addr;
+}
+EXPORT_SYMBOL(gen_pool_alloc_top);
+
 /**
  * gen_pool_free - free allocated special memory back to the pool
  * @pool: pool to free to
@@ -470,3 +550,33 @@ size_t gen_pool_size(struct gen_pool *pool)
 	return size;
 }
 EXPORT_SYMBOL_GPL(gen_pool_size);
+
+/**
+ * gen_pool_largest_free - get the largest free range of the pool
+ * @pool: pool to look at
+ *
+ * Return the size in bytes of the largest range a single allocation can
+ * still get from the specified pool.  The pool is not locked, the answer
+ * is only a snapshot.
+ */
+size_t gen_pool_largest_free(struct gen_pool *pool)
+{
+	struct gen_pool_chunk *chunk;
+	int order = pool->min_alloc_order;
+	unsigned long start, end, end_bit, largest = 0;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(chunk, &pool->chunks, next_chunk) {
+		end_bit = (chunk->end_addr - chunk->start_addr) >> order;
+		for (start = 0; ; start = end) {
+			start = find_next_zero_bit(chunk->bits, end_bit, start);
+			if (start >= end_bit)
+				break;
+			end = find_next_bit(chunk->bits, end_bit, start);
+			largest = max(largest, end - start);
+		}
+	}
+	rcu_read_unlock();
+	return (size_t)largest << order;
+}
+EXPORT_SYMBOL_GPL(gen_pool_largest_free);
@@ -0,0 +1,618 @@
+/*
+ * Benchmarks of kernel hot paths
+ *
+ * One place to time the paths a build is judged by: the zram codecs, page
+ * allocation with and without compaction, fsync on the data partition,
+ * zram block I/O and cpufreq transitions. Runs are repeatable, the input
+ * data is generated from a fixed seed, and the results are one line per
+ * test of key=value pairs so two builds can be compared by a script.
+ *
+ *	echo all > /sys/kernel/debug/kbench/run
+ *	echo "lzo_compress fsync" > /sys/kernel/debug/kbench/run
+ *	cat /sys/kernel/debug/kbench/results
+ *
+ * Tests run in the context of the writer, one at a time. The tunables are
+ * module parameters, zram tests only run once zram_path names an unused
+ * zram device, its contents are overwritten.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/cpufreq.h>
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/gfp.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/lz4.h>
+#include <linux/lzo.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/utsname.h>
+#include <linux/vmalloc.h>
+
+#define KBENCH_MAX_ITERATIONS	100000
+#define KBENCH_CODEC_PAGES	64
+#define KBENCH_ALLOC_BATCH	64
+#define KBENCH_HIGH_ORDER	4
+#define KBENCH_ZRAM_CHUNK	(64 * 1024)
+
+static unsigned int iterations = 100;
+module_param(iterations, uint, 0644);
+MODULE_PARM_DESC(iterations, "Repetitions of each test");
+
+static char fsync_path[64] = "/data/kbench.tmp";
+module_param_string(fsync_path, fsync_path, sizeof(fsync_path), 0644);
+MODULE_PARM_DESC(fsync_path, "File appended to and fsynced by the fsync test");
+
+static char zram_path[64];
+module_param_string(zram_path, zram_path, sizeof(zram_path), 0644);
+MODULE_PARM_DESC(zram_path, "Unused zram device for the zram tests");
+
+static unsigned int zram_size_kb = 4096;
+module_param(zram_size_kb, uint, 0644);
+MODULE_PARM_DESC(zram_size_kb, "Bytes moved per zram test pass, in kB");
+
+struct kbench_result {
+	bool	valid;
+	int	err;
+	u64	ops;
+	u64	failed;
+	u64	bytes;
+	u64	total_ns;
+	u64	min_ns;
+	u64	max_ns;
+};
+
+struct kbench_test {
+	const char *name;
+	int (*run)(struct kbench_result *r, unsigned int n);
+};
+
+static DEFINE_MUTEX(kbench_mutex);
+static struct dentry *kbench_dir;
+
+static inline u64 kbench_now(void)
+{
+	return ktime_to_ns(ktime_get());
+}
+
+static void kbench_sample(struct kbench_result *r, u64 start, u64 bytes)
+{
+	u64 ns = kbench_now() - start;
+
+	r->ops++;
+	r->bytes += bytes;
+	r->total_ns += ns;
+	if (!r->min_ns || ns < r->min_ns)
+		r->min_ns = ns;
+	if (ns > r->max_ns)
+		r->max_ns = ns;
+}
+
+/*
+ * Something that compresses about as well as anonymous memory does: most
+ * of each page repeats what came shortly before it, the rest is noise.
+ */
+static void kbench_fill(u8 *buf, size_t len)
+{
+	u32 seed = 0x4b42;
+	size_t i, j;
+
+	for (i = 0; i < len; i += 16) {
+		seed = seed * 1103515245 + 12345;
+		if (i >= 256 && (seed & 3)) {
+			memcpy(buf + i, buf + i - 16 * (1 + ((seed >> 8) & 15)),
+			       min_t(size_t, 16, len - i));
+			continue;
+		}
+		for (j = i; j < i + 16 && j < len; j++) {
+			seed = seed * 1103515245 + 12345;
+			buf[j] = seed >> 16;
+		}
+	}
+}
+
+struct kbench_codec {
+	int (*compress)(const unsigned char *src, size_t src_len,
+			unsigned char *dst, size_t *dst_len, void *wrkmem);
+	int (*decompress)(const unsigned char *src, size_t src_len,
+			  unsigned char *dst, size_t *dst_len);
+	size_t wrkmem_size;
+};
+
+static const struct kbench_codec kbench_lzo = {
+	.compress	= lzo1x_1_compress,
+	.decompress	= lzo1x_decompress_safe,
+	.wrkmem_size	= LZO1X_1_MEM_COMPRESS,
+};
+
+static const struct kbench_codec kbench_lz4 = {
+	.compress	= lz4_compress,
+	.decompress	= lz4_decompress_unknownoutputsize,
+	.wrkmem_size	= LZ4_MEM_COMPRESS,
+};
+
+/* Page at a time, the way zram uses the codecs */
+static int kbench_codec(struct kbench_result *r, unsigned int n,
+			const struct kbench_codec *codec, bool decompress)
+{
+	size_t clen[KBENCH_CODEC_PAGES];
+	u8 *src, *dst, *out = NULL;
+	void *wrkmem;
+	size_t len;
+	unsigned int i, p;
+	u64 start;
+	int ret = -ENOMEM;
+
+	src = vmalloc(KBENCH_CODEC_PAGES * PAGE_SIZE);
+	/* both codecs stay below twice the input in the worst case */
+	dst = vmalloc(KBENCH_CODEC_PAGES * 2 * PAGE_SIZE);
+	wrkmem = vmalloc(codec->wrkmem_size);
+	if (decompress)
+		out = vmalloc(PAGE_SIZE);
+	if (!src || !dst || !wrkmem || (decompress && !out))
+		goto out;
+
+	kbench_fill(src, KBENCH_CODEC_PAGES * PAGE_SIZE);
+
+	for (p = 0; p < KBENCH_CODEC_PAGES; p++) {
+		clen[p] = 2 * PAGE_SIZE;
+		ret = codec->compress(src + p * PAGE_SIZE, PAGE_SIZE,
+				      dst + p * 2 * PAGE_SIZE, &clen[p],
+				      wrkmem);
+		if (ret)
+			goto out;
+	}
+
+	for (i = 0; i < n; i++) {
+		for (p = 0; p < KBENCH_CODEC_PAGES; p++) {
+			if (decompress) {
+				len = PAGE_SIZE;
+				start = kbench_now();
+				ret = codec->decompress(dst + p * 2 * PAGE_SIZE,
+							clen[p], out, &len);
+				kbench_sample(r, start, PAGE_SIZE);
+				if (!ret && len != PAGE_SIZE)
+					ret = -EINVAL;
+			} else {
+				len = 2 * PAGE_SIZE;
+				start = kbench_now();
+				ret = codec->compress(src + p * PAGE_SIZE,
+						      PAGE_SIZE,
+						      dst + p * 2 * PAGE_SIZE,
+						      &len, wrkmem);
+				kbench_sample(r, start, PAGE_SIZE);
+			}
+			if (ret)
+				goto out;
+		}
+		cond_resched();
+	}
+
+out:
+	vfree(out);
+	vfree(wrkmem);
+	vfree(dst);
+	vfree(src);
+	return ret;
+}
+
+static int kbench_lzo_compress(struct kbench_result *r, unsigned int n)
+{
+	return kbench_codec(r, n, &kbench_lzo, false);
+}
+
+static int kbench_lzo_decompress(struct kbench_result *r, unsigned int n)
+{
+	return kbench_codec(r, n, &kbench_lzo, true);
+}
+
+static int kbench_lz4_compress(struct kbench_result *r, unsigned int n)
+{
+	return kbench_codec(r, n, &kbench_lz4, false);
+}
+
+static int kbench_lz4_decompress(struct kbench_result *r, unsigned int n)
+{
+	return kbench_codec(r, n, &kbench_lz4, true);
+}
+
+/*
+ * Order 0 pages in batches big enough to go past the per-cpu lists, so
+ * the refill and drain from the buddy lists are part of the numbers.
+ */
+static int kbench_page_alloc(struct kbench_result *r, unsigned int n)
+{
+	struct page *pages[KBENCH_ALLOC_BATCH];
+	unsigned int i, j;
+	u64 start;
+
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < KBENCH_ALLOC_BATCH; j++) {
+			start = kbench_now();
+			pages[j] = alloc_page(GFP_KERNEL);
+			kbench_sample(r, start, PAGE_SIZE);
+			if (!pages[j])
+				r->failed++;
+		}
+		for (j = 0; j < KBENCH_ALLOC_BATCH; j++)
+			if (pages[j])
+				__free_page(pages[j]);
+		cond_resched();
+	}
+
+	return 0;
+}
+
+/*
+ * Blocks of the size drivers ask for, all held until the end so the
+ * later ones have to go through reclaim and compaction.
+ */
+static int kbench_page_alloc_high(struct kbench_result *r, unsigned int n)
+{
+	struct page **pages;
+	unsigned int i;
+	u64 start;
+
+	pages = vzalloc(n * sizeof(*pages));
+	if (!pages)
+		return -ENOMEM;
+
+	for (i = 0; i < n; i++) {
+		start = kbench_now();
+		pages[i] = alloc_pages(GFP_KERNEL | __GFP_NOWARN |
+				       __GFP_NORETRY, KBENCH_HIGH_ORDER);
+		kbench_sample(r, start, PAGE_SIZE << KBENCH_HIGH_ORDER);
+		if (!pages[i])
+			r->failed++;
+		cond_resched();
+	}
+
+	for (i = 0; i < n; i++)
+		if (pages[i])
+			__free_pages(pages[i], KBENCH_HIGH_ORDER);
+	vfree(pages);
+
+	return 0;
+}
+
+/* One page appended and fsynced at a time, like a database journal */
+static int kbench_fsync(struct kbench_result *r, unsigned int n)
+{
+	struct file *file;
+	mm_segment_t old_fs;
+	loff_t pos = 0;
+	unsigned int i;
+	ssize_t written;
+	u8 *buf;
+	u64 start;
+	int ret = 0;
+
+	buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	kbench_fill(buf, PAGE_SIZE);
+
+	file = filp_open(fsync_path, O_WRONLY | O_CREAT | O_TRUNC | O_LARGEFILE,
+			 0600);
+	if (IS_ERR(file)) {
+		kfree(buf);
+		return PTR_ERR(file);
+	}
+
+	old_fs = get_fs();
+	set_fs(KERNEL_DS);
+	for (i = 0; i < n; i++) {
+		start = kbench_now();
+		written = vfs_write(file, (__force const char __user *)buf,
+				    PAGE_SIZE, &pos);
+		if (written != PAGE_SIZE) {
+			ret = written < 0 ? written : -EIO;
+			break;
+		}
+		ret = vfs_fsync(file, 0);
+		kbench_sample(r, start, PAGE_SIZE);
+		if (ret)
+			break;
+	}
+	set_fs(old_fs);
+
+	filp_close(file, NULL);
+	kfree(buf);
+	return ret;
+}
+
+/*
+ * Whole passes over the first zram_size_kb of the device. Writes only
+ * reach zram on writeback, so a write pass ends with the fsync, and a
+ * read pass starts with the page cache of the device dropped.
+ */
+static int kbench_zram(struct kbench_result *r, unsigned int n, bool read)
+{
+	struct file *file;
+	struct inode *inode;
+	mm_segment_t old_fs;
+	loff_t size, pos;
+	unsigned int i;
+	ssize_t done;
+	u8 *buf;
+	u64 start;
+	int ret = 0;
+
+	if (!zram_path[0])
+		return -ENODEV;
+
+	/* O_EXCL keeps us off a device that is swap or mounted */
+	file = filp_open(zram_path, O_RDWR | O_EXCL | O_LARGEFILE, 0);
+	if (IS_ERR(file))
+		return PTR_ERR(file);
+
+	inode = file->f_mapping->host;
+	size = min_t(loff_t, i_size_read(inode), (loff_t)zram_size_kb << 10);
+	size &= ~(loff_t)(KBENCH_ZRAM_CHUNK - 1);
+	if (!S_ISBLK(file->f_path.dentry->d_inode->i_mode) || !size) {
+		ret = -ENODEV;
+		goto out_close;
+	}
+
+	buf = vmalloc(KBENCH_ZRAM_CHUNK);
+	if (!buf) {
+		ret = -ENOMEM;
+		goto out_close;
+	}
+	kbench_fill(buf, KBENCH_ZRAM_CHUNK);
+
+	old_fs = get_fs();
+	set_fs(KERNEL_DS);
+	/* the read test needs something on the device, once */
+	for (i = 0; i < (read ? n + 1 : n); i++) {
+		bool timed = !read || i > 0;
+
+		if (read && timed) {
+			invalidate_mapping_pages(file->f_mapping, 0, -1);
+			start = kbench_now();
+			for (pos = 0; pos < size; ) {
+				done = vfs_read(file, (__force char __user *)buf,
+						KBENCH_ZRAM_CHUNK, &pos);
+				if (done != KBENCH_ZRAM_CHUNK) {
+					ret = done < 0 ? done : -EIO;
+					goto out_fs;
+				}
+			}
+			kbench_sample(r, start, size);
+		} else {
+			start = kbench_now();
+			for (pos = 0; pos < size; ) {
+				done = vfs_write(file,
+						 (__force const char __user *)buf,
+						 KBENCH_ZRAM_CHUNK, &pos);
+				if (done != KBENCH_ZRAM_CHUNK) {
+					ret = done < 0 ? done : -EIO;
+					goto out_fs;
+				}
+			}
+			ret = vfs_fsync(file, 0);
+			if (timed)
+				kbench_sample(r, start, size);
+			if (ret)
+				goto out_fs;
+		}
+		cond_resched();
+	}
+
+out_fs:
+	set_fs(old_fs);
+	vfree(buf);
+out_close:
+	filp_close(file, NULL);
+	return ret;
+}
+
+static int kbench_zram_write(struct kbench_result *r, unsigned int n)
+{
+	return kbench_zram(r, n, false);
+}
+
+static int kbench_zram_read(struct kbench_result *r, unsigned int n)
+{
+	return kbench_zram(r, n, true);
+}
+
+/*
+ * Back and forth between the lowest and the highest frequency of the
+ * policy of cpu 0. The governor may override the end result, pick
+ * performance or userspace to keep it out of the way.
+ */
+static int kbench_cpufreq(struct kbench_result *r, unsigned int n)
+{
+#ifdef CONFIG_CPU_FREQ
+	struct cpufreq_policy *policy;
+	unsigned int orig, target;
+	unsigned int i;
+	u64 start;
+	int ret = 0;
+
+	policy = cpufreq_cpu_get(0);
+	if (!policy)
+		return -ENODEV;
+
+	if (policy->min == policy->max) {
+		cpufreq_cpu_put(policy);
+		return -EINVAL;
+	}
+
+	orig = policy->cur;
+	for (i = 0; i < n; i++) {
+		target = (i & 1) ? policy->min : policy->max;
+		start = kbench_now();
+		ret = cpufreq_driver_target(policy, target,
+					    CPUFREQ_RELATION_L);
+		kbench_sample(r, start, 0);
+		if (ret)
+			break;
+	}
+	cpufreq_driver_target(policy, orig, CPUFREQ_RELATION_L);
+
+	cpufreq_cpu_put(policy);
+	return ret;
+#else
+	return -ENODEV;
+#endif
+}
+
+static const struct kbench_test kbench_tests[] = {
+	{ "lzo_compress",	kbench_lzo_compress },
+	{ "lzo_decompress",	kbench_lzo_decompress },
+	{ "lz4_compress",	kbench_lz4_compress },
+	{ "lz4_decompress",	kbench_lz4_decompress },
+	{ "page_alloc",		kbench_page_alloc },
+	{ "page_alloc_order4",	kbench_page_alloc_high },
+	{ "fsync",		kbench_fsync },
+	{ "zram_write",		kbench_zram_write },
+	{ "zram_read",		kbench_zram_read },
+	{ "cpufreq",		kbench_cpufreq },
+};
+
+static struct kbench_result kbench_results[ARRAY_SIZE(kbench_tests)];
+
+static void kbench_run_one(int i)
+{
+	struct kbench_result *r = &kbench_results[i];
+	unsigned int n = clamp_t(unsigned int, iterations, 1,
+				 KBENCH_MAX_ITERATIONS);
+
+	memset(r, 0, sizeof(*r));
+	r->err = kbench_tests[i].run(r, n);
+	r->valid = true;
+}
+
+static int kbench_run(const char *name)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(kbench_tests); i++) {
+		if (!strcmp(name, "all") || !strcmp(name, kbench_tests[i].name)) {
+			kbench_run_one(i);
+			if (strcmp(name, "all"))
+				return 0;
+		}
+	}
+
+	return strcmp(name, "all") ? -EINVAL : 0;
+}
+
+static ssize_t kbench_run_write(struct file *file, const char __user *ubuf,
+				size_t count, loff_t *ppos)
+{
+	char buf[128];
+	char *cur, *name;
+	int ret = 0;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	if (mutex_lock_interruptible(&kbench_mutex))
+		return -ERESTARTSYS;
+
+	cur = strim(buf);
+	while ((name = strsep(&cur, " ,")) != NULL) {
+		if (!*name)
+			continue;
+		ret = kbench_run(name);
+		if (ret)
+			break;
+	}
+
+	mutex_unlock(&kbench_mutex);
+
+	return ret ? ret : count;
+}
+
+static const struct file_operations kbench_run_fops = {
+	.owner		= THIS_MODULE,
+	.write		= kbench_run_write,
+	.llseek		= noop_llseek,
+};
+
+static int kbench_results_show(struct seq_file *m, void *v)
+{
+	struct kbench_result *r;
+	int i;
+
+	mutex_lock(&kbench_mutex);
+
+	seq_printf(m, "# kbench release=%s machine=%s iterations=%u\n",
+		   utsname()->release, utsname()->machine, iterations);
+
+	for (i = 0; i < ARRAY_SIZE(kbench_tests); i++) {
+		r = &kbench_results[i];
+		if (!r->valid)
+			continue;
+		seq_printf(m, "%s err=%d ops=%llu failed=%llu bytes=%llu "
+			   "total_ns=%llu avg_ns=%llu min_ns=%llu max_ns=%llu "
+			   "mb_s=%llu\n",
+			   kbench_tests[i].name, r->err, r->ops, r->failed,
+			   r->bytes, r->total_ns,
+			   r->ops ? div64_u64(r->total_ns, r->ops) : 0,
+			   r->min_ns, r->max_ns,
+			   r->total_ns ?
+			   div64_u64(r->bytes * 1000, r->total_ns) : 0);
+	}
+
+	mutex_unlock(&kbench_mutex);
+
+	return 0;
+}
+
+static int kbench_results_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, kbench_results_show, NULL);
+}
+
+static const struct file_operations kbench_results_fops = {
+	.owner		= THIS_MODULE,
+	.open		= kbench_results_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init kbench_init(void)
+{
+	kbench_dir = debugfs_create_dir("kbench", NULL);
+	if (!kbench_dir)
+		return -ENOMEM;
+
+	if (!debugfs_create_file("run", S_IWUSR, kbench_dir, NULL,
+				 &kbench_run_fops) ||
+	    !debugfs_create_file("results", S_IRUGO, kbench_dir, NULL,
+				 &kbench_results_fops)) {
+		debugfs_remove_recursive(kbench_dir);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void __exit kbench_exit(void)
+{
+	debugfs_remove_recursive(kbench_dir);
+}
+
+module_init(kbench_init);
+module_exit(kbench_exit);
+
+MODULE_DESCRIPTION("Benchmarks of kernel hot paths");
+MODULE_LICENSE("GPL");
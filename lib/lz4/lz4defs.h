@@ -59,6 +59,13 @@ typedef struct _U64_S { u64 v; } U64_S;
 	} while (0)
 #endif
 
+/*
+ * Literal runs and matches that do not overlap their source and are at
+ * least this long are copied with memcpy(), which moves 32 bytes per
+ * ldm/stm pair with preloads on ARM instead of one word per load/store.
+ */
+#define LZ4_MEMCPY_MIN	64
+
 #define COPYLENGTH 8
 #define ML_BITS  4
 #define ML_MASK  ((1U << ML_BITS) - 1)
@@ -88,6 +88,13 @@ copy_literal_run:
 				if (likely(HAVE_IP(t, 15) && HAVE_OP(t, 15))) {
 					const unsigned char *ie = ip + t;
 					unsigned char *oe = op + t;
+					if (t >= LZO_MEMCPY_MIN) {
+						memcpy(op, ip, t);
+						ip = ie;
+						op = oe;
+						state = 4;
+						continue;
+					}
 					do {
 						COPY8(op, ip);
 						op += 8;
@@ -177,16 +184,20 @@ copy_literal_run:
 		if (op - m_pos >= 8) {
 			unsigned char *oe = op + t;
 			if (likely(HAVE_OP(t, 15))) {
-				do {
-					COPY8(op, m_pos);
-					op += 8;
-					m_pos += 8;
+				if (t >= LZO_MEMCPY_MIN && op - m_pos >= t) {
+					memcpy(op, m_pos, t);
+				} else {
+					do {
+						COPY8(op, m_pos);
+						op += 8;
+						m_pos += 8;
 #  if !defined(__arm__)
-					COPY8(op, m_pos);
-					op += 8;
-					m_pos += 8;
+						COPY8(op, m_pos);
+						op += 8;
+						m_pos += 8;
 #  endif
-				} while (op < oe);
+					} while (op < oe);
+				}
 				op = oe;
 				if (HAVE_IP(6, 0)) {
 					state = next;
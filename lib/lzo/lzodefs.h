@@ -28,6 +28,12 @@
 		COPY4(dst, src); COPY4((dst) + 4, (src) + 4)
 #endif
 
+/*
+ * Literal runs and non-overlapping matches at least this long go through
+ * memcpy(), which on ARM copies 32 bytes per ldm/stm pair with preloads.
+ */
+#define LZO_MEMCPY_MIN	64
+
 #if defined(__BIG_ENDIAN) && defined(__LITTLE_ENDIAN)
 #error "conflicting endian definitions"
 #elif defined(__x86_64__)
@@ -7,6 +7,10 @@
 #include <linux/sched.h>
 #include <linux/init.h>
 #include <linux/export.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 /*
  * Initialize an rwsem:
@@ -24,6 +28,9 @@ void __init_rwsem(struct rw_semaphore *sem, const char *name,
 	sem->count = RWSEM_UNLOCKED_VALUE;
 	raw_spin_lock_init(&sem->wait_lock);
 	INIT_LIST_HEAD(&sem->wait_list);
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+	sem->owner = NULL;
+#endif
 }
 
 EXPORT_SYMBOL(__init_rwsem);
@@ -60,7 +67,7 @@ __rwsem_do_wake(struct rw_semaphore *sem, int wake_type)
 	struct rwsem_waiter *waiter;
 	struct task_struct *tsk;
 	struct list_head *next;
-	signed long oldcount, woken, loop, adjustment;
+	signed long oldcount, woken, loop, adjustment, grant;
 
 	waiter = list_entry(sem->wait_list.next, struct rwsem_waiter, list);
 	if (!(waiter->flags & RWSEM_WAITING_FOR_WRITE))
@@ -101,22 +108,26 @@ __rwsem_do_wake(struct rw_semaphore *sem, int wake_type)
  readers_only:
 	/* If we come here from up_xxxx(), another thread might have reached
 	 * rwsem_down_failed_common() before we acquired the spinlock and
-	 * woken up a waiter, making it now active.  We prefer to check for
-	 * this first in order to not spend too much time with the spinlock
-	 * held if we're not going to be able to wake up readers in the end.
-	 *
-	 * Note that we do not need to update the rwsem count: any writer
-	 * trying to acquire rwsem will run rwsem_down_write_failed() due
-	 * to the waiting threads and block trying to acquire the spinlock.
-	 *
-	 * We use a dummy atomic update in order to acquire the cache line
-	 * exclusively since we expect to succeed and run the final rwsem
-	 * count adjustment pretty soon.
+	 * woken up a waiter, making it now active.  A writer spinning on the
+	 * owner may also have taken the sem without the spinlock.  So unless
+	 * the sem is known to be read owned, grant the first read lock right
+	 * away, and back it out if a writer got there first.  This also gets
+	 * the cache line exclusively, as we expect to succeed and run the
+	 * final rwsem count adjustment pretty soon.
 	 */
-	if (wake_type == RWSEM_WAKE_ANY &&
-	    rwsem_atomic_update(0, sem) < RWSEM_WAITING_BIAS)
-		/* Someone grabbed the sem for write already */
-		goto out;
+	grant = 0;
+	if (wake_type != RWSEM_WAKE_READ_OWNED) {
+		grant = RWSEM_ACTIVE_READ_BIAS;
+ try_reader_grant:
+		oldcount = rwsem_atomic_update(grant, sem) - grant;
+		if (oldcount < RWSEM_WAITING_BIAS) {
+			/* Someone grabbed the sem for write already */
+			if (rwsem_atomic_update(-grant, sem) & RWSEM_ACTIVE_MASK)
+				goto out;
+			/* and has released it again, retry the grant */
+			goto try_reader_grant;
+		}
+	}
 
 	/* Grant an infinite number of read locks to the readers at the front
 	 * of the queue.  Note we increment the 'active part' of the count by
@@ -134,7 +145,7 @@ __rwsem_do_wake(struct rw_semaphore *sem, int wake_type)
 
 	} while (waiter->flags & RWSEM_WAITING_FOR_READ);
 
-	adjustment = woken * RWSEM_ACTIVE_READ_BIAS;
+	adjustment = woken * RWSEM_ACTIVE_READ_BIAS - grant;
 	if (waiter->flags & RWSEM_WAITING_FOR_READ)
 		/* hit end of list above */
 		adjustment -= RWSEM_WAITING_BIAS;
@@ -166,6 +177,163 @@ __rwsem_do_wake(struct rw_semaphore *sem, int wake_type)
 	goto try_again_write;
 }
 
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+/*
+ * Optimistic spinning for writers.
+ *
+ * A writer that finds the sem held by another writer that is running on
+ * some cpu keeps trying to take it instead of going to sleep, the same as
+ * a mutex does: mmap_sem and friends are mostly held for short sections
+ * and a sleep and wakeup costs more than the wait. The spin stops when
+ * the owner sleeps, when we need to reschedule, or when readers hold the
+ * sem, since there is no telling when the last of them will leave.
+ */
+
+/* spins without an owner before assuming the sem is read owned */
+#define RWSEM_SPIN_NO_OWNER	100
+
+enum rwsem_spin_item {
+	RWSEM_SPIN_ACQUIRED,	/* taken while spinning */
+	RWSEM_SPIN_FAILED,	/* spun, then queued */
+	RWSEM_SPIN_NR_ITEMS,
+};
+
+static DEFINE_PER_CPU(unsigned long [RWSEM_SPIN_NR_ITEMS], rwsem_spin_stat);
+
+static inline void rwsem_spin_count(enum rwsem_spin_item item)
+{
+	this_cpu_inc(rwsem_spin_stat[item]);
+}
+
+/*
+ * Take the sem for write if it is free, whether or not there are waiters:
+ * __rwsem_do_wake() copes with the sem being stolen from under a waiter.
+ */
+static inline bool rwsem_try_write_lock_unqueued(struct rw_semaphore *sem)
+{
+	long old, count = ACCESS_ONCE(sem->count);
+
+	while (count == 0 || count == RWSEM_WAITING_BIAS) {
+		old = cmpxchg(&sem->count, count,
+			      count + RWSEM_ACTIVE_WRITE_BIAS);
+		if (old == count) {
+			sem->owner = current;
+			return true;
+		}
+		count = old;
+	}
+	return false;
+}
+
+static inline bool rwsem_owner_running(struct rw_semaphore *sem,
+				       struct task_struct *owner)
+{
+	if (sem->owner != owner)
+		return false;
+
+	/*
+	 * Dereference owner only after checking it still owns the sem;
+	 * rcu_read_lock() keeps the task_struct around in the meantime.
+	 */
+	barrier();
+
+	return owner->on_cpu;
+}
+
+/*
+ * Spin while owner holds the sem and runs. Returns true if it released
+ * the sem, false if it went to sleep or we have to reschedule.
+ */
+static noinline bool rwsem_spin_on_owner(struct rw_semaphore *sem,
+					 struct task_struct *owner)
+{
+	rcu_read_lock();
+	while (rwsem_owner_running(sem, owner)) {
+		if (need_resched())
+			break;
+
+		arch_mutex_cpu_relax();
+	}
+	rcu_read_unlock();
+
+	return ACCESS_ONCE(sem->owner) == NULL;
+}
+
+static bool rwsem_optimistic_spin(struct rw_semaphore *sem)
+{
+	struct task_struct *owner;
+	unsigned int no_owner = 0;
+	bool taken = false;
+
+	preempt_disable();
+
+	for (;;) {
+		owner = ACCESS_ONCE(sem->owner);
+		if (owner && !rwsem_spin_on_owner(sem, owner))
+			break;
+
+		if (rwsem_try_write_lock_unqueued(sem)) {
+			taken = true;
+			break;
+		}
+
+		/*
+		 * Without an owner either readers hold the sem or a writer
+		 * has just taken it and not yet set the owner. Give the
+		 * latter a moment; an RT task must not spin at all, it could
+		 * keep that writer from ever getting there.
+		 */
+		if (!owner && (need_resched() || rt_task(current) ||
+			       ++no_owner > RWSEM_SPIN_NO_OWNER))
+			break;
+
+		arch_mutex_cpu_relax();
+	}
+
+	preempt_enable();
+
+	rwsem_spin_count(taken ? RWSEM_SPIN_ACQUIRED : RWSEM_SPIN_FAILED);
+	return taken;
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int rwsem_spin_show(struct seq_file *m, void *v)
+{
+	unsigned long acquired = 0, failed = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		acquired += per_cpu(rwsem_spin_stat, cpu)[RWSEM_SPIN_ACQUIRED];
+		failed += per_cpu(rwsem_spin_stat, cpu)[RWSEM_SPIN_FAILED];
+	}
+
+	seq_printf(m, "acquired %lu\n", acquired);
+	seq_printf(m, "failed %lu\n", failed);
+	return 0;
+}
+
+static int rwsem_spin_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, rwsem_spin_show, NULL);
+}
+
+static const struct file_operations rwsem_spin_fops = {
+	.open		= rwsem_spin_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init rwsem_spin_debugfs_init(void)
+{
+	debugfs_create_file("rwsem_spin", S_IRUGO, NULL, NULL,
+			    &rwsem_spin_fops);
+	return 0;
+}
+late_initcall(rwsem_spin_debugfs_init);
+#endif
+#endif
+
 /*
  * wait for a lock to be granted
  */
@@ -201,7 +369,7 @@ rwsem_down_failed_common(struct rw_semaphore *sem,
 	if (count == RWSEM_WAITING_BIAS)
 		sem = __rwsem_do_wake(sem, RWSEM_WAKE_NO_ACTIVE);
 	else if (count > RWSEM_WAITING_BIAS &&
-		 adjustment == -RWSEM_ACTIVE_WRITE_BIAS)
+		 (flags & RWSEM_WAITING_FOR_WRITE))
 		sem = __rwsem_do_wake(sem, RWSEM_WAKE_READ_OWNED);
 
 	raw_spin_unlock_irq(&sem->wait_lock);
@@ -233,8 +401,17 @@ struct rw_semaphore __sched *rwsem_down_read_failed(struct rw_semaphore *sem)
  */
 struct rw_semaphore __sched *rwsem_down_write_failed(struct rw_semaphore *sem)
 {
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+	/* stop counting as active while trying to steal the sem */
+	rwsem_atomic_update(-RWSEM_ACTIVE_WRITE_BIAS, sem);
+	if (rwsem_optimistic_spin(sem))
+		return sem;
+
+	return rwsem_down_failed_common(sem, RWSEM_WAITING_FOR_WRITE, 0);
+#else
 	return rwsem_down_failed_common(sem, RWSEM_WAITING_FOR_WRITE,
 					-RWSEM_ACTIVE_WRITE_BIAS);
+#endif
 }
 
 /*
@@ -0,0 +1,506 @@
+/*
+ * mm/bootprefetch.c
+ *
+ * Boot time page cache prefetch.
+ *
+ * While recording, every range of file pages read through read() or
+ * faulted in through a file mapping is logged as a (file, start, length)
+ * extent, coalescing consecutive accesses to the same file. When the
+ * recording is read back the extents are sorted by file, in order of first
+ * access, and by offset, and neighbours less than PREFETCH_MERGE_GAP pages
+ * apart are merged. Reading /proc/bootprefetch gives one "start nr path"
+ * line per extent.
+ *
+ * Replaying such a trace has a kernel thread issue readahead for each
+ * extent, so the pages the zygote preload and system_server are about to
+ * touch come in as a few large reads while init carries on, instead of
+ * thousands of scattered 4k faults. Readahead issued by the replay is not
+ * recorded, so the next boot's trace can be taken at the same time.
+ *
+ * Commands written to /proc/bootprefetch:
+ *	record		start a new recording, dropping the previous one
+ *	stop		stop recording
+ *	replay <path>	replay the trace stored in <path>
+ *
+ * "bootprefetch_record" on the command line starts recording at boot.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/bootprefetch.h>
+#include <linux/dcache.h>
+#include <linux/err.h>
+#include <linux/fs.h>
+#include <linux/hash.h>
+#include <linux/init.h>
+#include <linux/kthread.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+#define PREFETCH_MAX_FILES	4096
+#define PREFETCH_MAX_EXTENTS	32768
+#define PREFETCH_MERGE_GAP	8		/* pages */
+#define PREFETCH_TRACE_MAX	(4 << 20)	/* bytes */
+#define PREFETCH_HASH_BITS	8
+
+struct prefetch_file {
+	struct hlist_node hash;
+	dev_t dev;
+	unsigned long ino;
+	unsigned int id;
+	int last;		/* extent last extended for this file */
+	char path[0];
+};
+
+struct prefetch_extent {
+	unsigned int file;
+	unsigned int nr;
+	pgoff_t start;
+};
+
+bool boot_prefetch_recording;
+
+/* protects the tables below against the recording hooks */
+static DEFINE_SPINLOCK(prefetch_lock);
+/* serializes commands and trace dumps */
+static DEFINE_MUTEX(prefetch_mutex);
+
+static struct hlist_head *prefetch_hash;
+static struct prefetch_file **prefetch_files;
+static unsigned int prefetch_nr_files;
+static struct prefetch_extent *prefetch_extents;
+static unsigned int prefetch_nr_extents;
+static bool prefetch_sorted;
+
+static bool prefetch_replaying;
+static bool prefetch_record_at_boot;
+
+static inline struct hlist_head *prefetch_bucket(struct inode *inode)
+{
+	unsigned long key = inode->i_ino ^ inode->i_sb->s_dev;
+
+	return &prefetch_hash[hash_long(key, PREFETCH_HASH_BITS)];
+}
+
+static struct prefetch_file *prefetch_lookup(struct inode *inode)
+{
+	struct prefetch_file *pf;
+	struct hlist_node *node;
+
+	hlist_for_each_entry(pf, node, prefetch_bucket(inode), hash)
+		if (pf->ino == inode->i_ino && pf->dev == inode->i_sb->s_dev)
+			return pf;
+
+	return NULL;
+}
+
+static struct prefetch_file *prefetch_alloc_file(struct file *file,
+						 struct inode *inode)
+{
+	struct prefetch_file *pf = NULL;
+	char *buf, *path;
+
+	buf = kmalloc(PATH_MAX, GFP_KERNEL);
+	if (!buf)
+		return NULL;
+
+	path = d_path(&file->f_path, buf, PATH_MAX);
+	if (IS_ERR(path) || d_unlinked(file->f_path.dentry) ||
+	    strchr(path, '\n'))
+		goto out;
+
+	pf = kmalloc(sizeof(*pf) + strlen(path) + 1, GFP_KERNEL);
+	if (!pf)
+		goto out;
+
+	pf->dev = inode->i_sb->s_dev;
+	pf->ino = inode->i_ino;
+	pf->last = -1;
+	strcpy(pf->path, path);
+out:
+	kfree(buf);
+	return pf;
+}
+
+void __boot_prefetch_record(struct file *file, pgoff_t index,
+			    unsigned long nr)
+{
+	struct inode *inode = file->f_mapping->host;
+	struct prefetch_file *pf, *new = NULL;
+	struct prefetch_extent *ext;
+
+	if (!S_ISREG(inode->i_mode) || !nr)
+		return;
+
+	spin_lock(&prefetch_lock);
+	if (!boot_prefetch_recording)
+		goto out;
+
+	pf = prefetch_lookup(inode);
+	if (!pf) {
+		spin_unlock(&prefetch_lock);
+		new = prefetch_alloc_file(file, inode);
+		if (!new)
+			return;
+		spin_lock(&prefetch_lock);
+
+		/* the tables may have been replaced meanwhile */
+		if (!boot_prefetch_recording)
+			goto out;
+
+		pf = prefetch_lookup(inode);
+		if (!pf) {
+			if (prefetch_nr_files == PREFETCH_MAX_FILES)
+				goto out;
+
+			pf = new;
+			new = NULL;
+			pf->id = prefetch_nr_files;
+			prefetch_files[prefetch_nr_files++] = pf;
+			hlist_add_head(&pf->hash, prefetch_bucket(inode));
+		}
+	}
+
+	if (pf->last >= 0) {
+		ext = &prefetch_extents[pf->last];
+		if (index >= ext->start && index <= ext->start + ext->nr) {
+			if (index + nr > ext->start + ext->nr)
+				ext->nr = index + nr - ext->start;
+			goto out;
+		}
+	}
+
+	if (prefetch_nr_extents == PREFETCH_MAX_EXTENTS) {
+		/* keep what is there rather than wrapping */
+		boot_prefetch_recording = false;
+		goto out;
+	}
+
+	ext = &prefetch_extents[prefetch_nr_extents];
+	ext->file = pf->id;
+	ext->start = index;
+	ext->nr = nr;
+	pf->last = prefetch_nr_extents++;
+out:
+	spin_unlock(&prefetch_lock);
+	kfree(new);
+}
+
+static void prefetch_free(struct hlist_head *hash,
+			  struct prefetch_file **files, unsigned int nr_files,
+			  struct prefetch_extent *extents)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr_files; i++)
+		kfree(files[i]);
+
+	kfree(hash);
+	vfree(files);
+	vfree(extents);
+}
+
+static int prefetch_start(void)
+{
+	struct hlist_head *hash;
+	struct prefetch_file **files;
+	struct prefetch_extent *extents;
+	unsigned int nr_files;
+	int i;
+
+	hash = kmalloc(sizeof(*hash) << PREFETCH_HASH_BITS, GFP_KERNEL);
+	files = vmalloc(PREFETCH_MAX_FILES * sizeof(*files));
+	extents = vmalloc(PREFETCH_MAX_EXTENTS * sizeof(*extents));
+	if (!hash || !files || !extents) {
+		prefetch_free(hash, files, 0, extents);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < 1 << PREFETCH_HASH_BITS; i++)
+		INIT_HLIST_HEAD(&hash[i]);
+
+	spin_lock(&prefetch_lock);
+	swap(hash, prefetch_hash);
+	swap(files, prefetch_files);
+	swap(extents, prefetch_extents);
+	nr_files = prefetch_nr_files;
+	prefetch_nr_files = 0;
+	prefetch_nr_extents = 0;
+	prefetch_sorted = false;
+	boot_prefetch_recording = true;
+	spin_unlock(&prefetch_lock);
+
+	prefetch_free(hash, files, nr_files, extents);
+
+	return 0;
+}
+
+static void prefetch_stop(void)
+{
+	spin_lock(&prefetch_lock);
+	boot_prefetch_recording = false;
+	spin_unlock(&prefetch_lock);
+}
+
+static int prefetch_cmp(const void *a, const void *b)
+{
+	const struct prefetch_extent *x = a, *y = b;
+
+	if (x->file != y->file)
+		return x->file < y->file ? -1 : 1;
+	if (x->start != y->start)
+		return x->start < y->start ? -1 : 1;
+
+	return 0;
+}
+
+/* called with recording stopped, the hooks no longer touch the extents */
+static void prefetch_sort(void)
+{
+	struct prefetch_extent *ext = prefetch_extents;
+	unsigned int i, n = 0;
+	pgoff_t end;
+
+	if (prefetch_sorted || !prefetch_nr_extents)
+		return;
+
+	sort(ext, prefetch_nr_extents, sizeof(*ext), prefetch_cmp, NULL);
+
+	for (i = 1; i < prefetch_nr_extents; i++) {
+		if (ext[i].file == ext[n].file &&
+		    ext[i].start <= ext[n].start + ext[n].nr +
+				    PREFETCH_MERGE_GAP) {
+			end = max(ext[n].start + ext[n].nr,
+				  ext[i].start + ext[i].nr);
+			ext[n].nr = end - ext[n].start;
+		} else {
+			ext[++n] = ext[i];
+		}
+	}
+
+	prefetch_nr_extents = n + 1;
+	prefetch_sorted = true;
+}
+
+static int prefetch_replay_fn(void *data)
+{
+	char *trace_path = data;
+	struct file *trace, *filp = NULL;
+	unsigned long start, pages = 0, files = 0;
+	char *buf = NULL, *line, *next, *path;
+	const char *cur = NULL;
+	unsigned int nr;
+	loff_t size;
+	int len = 0, n;
+
+	trace = filp_open(trace_path, O_RDONLY | O_LARGEFILE, 0);
+	if (IS_ERR(trace)) {
+		pr_info("bootprefetch: no trace in %s\n", trace_path);
+		goto out;
+	}
+
+	size = min_t(loff_t, i_size_read(trace->f_mapping->host),
+		     PREFETCH_TRACE_MAX);
+	buf = vmalloc(size + 1);
+	if (buf)
+		len = kernel_read(trace, 0, buf, size);
+	fput(trace);
+	if (len <= 0)
+		goto out;
+	buf[len] = '\0';
+
+	for (line = buf; line; line = next) {
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+
+		if (sscanf(line, "%lu %u %n", &start, &nr, &n) != 2 ||
+		    !line[n])
+			continue;
+
+		path = line + n;
+		if (!cur || strcmp(path, cur)) {
+			if (filp)
+				fput(filp);
+
+			cur = path;
+			filp = filp_open(path, O_RDONLY | O_LARGEFILE, 0);
+			if (IS_ERR(filp)) {
+				filp = NULL;
+				continue;
+			}
+			files++;
+		}
+
+		if (filp) {
+			force_page_cache_readahead(filp->f_mapping, filp,
+						   start, nr);
+			pages += nr;
+		}
+	}
+
+	if (filp)
+		fput(filp);
+
+	pr_info("bootprefetch: replayed %lu pages of %lu files\n",
+		pages, files);
+out:
+	vfree(buf);
+	kfree(trace_path);
+
+	mutex_lock(&prefetch_mutex);
+	prefetch_replaying = false;
+	mutex_unlock(&prefetch_mutex);
+
+	return 0;
+}
+
+static int prefetch_replay(const char *path)
+{
+	struct task_struct *tsk;
+	char *arg;
+
+	if (prefetch_replaying)
+		return -EBUSY;
+
+	arg = kstrdup(path, GFP_KERNEL);
+	if (!arg)
+		return -ENOMEM;
+
+	prefetch_replaying = true;
+	tsk = kthread_run(prefetch_replay_fn, arg, "bootprefetch");
+	if (IS_ERR(tsk)) {
+		prefetch_replaying = false;
+		kfree(arg);
+		return PTR_ERR(tsk);
+	}
+
+	return 0;
+}
+
+static void *prefetch_seq_start(struct seq_file *m, loff_t *pos)
+{
+	mutex_lock(&prefetch_mutex);
+
+	if (boot_prefetch_recording)
+		return ERR_PTR(-EBUSY);
+
+	prefetch_sort();
+	if (*pos >= prefetch_nr_extents)
+		return NULL;
+
+	return &prefetch_extents[*pos];
+}
+
+static void *prefetch_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	if (++*pos >= prefetch_nr_extents)
+		return NULL;
+
+	return &prefetch_extents[*pos];
+}
+
+static void prefetch_seq_stop(struct seq_file *m, void *v)
+{
+	mutex_unlock(&prefetch_mutex);
+}
+
+static int prefetch_seq_show(struct seq_file *m, void *v)
+{
+	struct prefetch_extent *ext = v;
+
+	seq_printf(m, "%lu %u %s\n", ext->start, ext->nr,
+		   prefetch_files[ext->file]->path);
+
+	return 0;
+}
+
+static const struct seq_operations prefetch_seq_ops = {
+	.start	= prefetch_seq_start,
+	.next	= prefetch_seq_next,
+	.stop	= prefetch_seq_stop,
+	.show	= prefetch_seq_show,
+};
+
+static int prefetch_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &prefetch_seq_ops);
+}
+
+static ssize_t prefetch_write(struct file *file, const char __user *ubuf,
+			      size_t count, loff_t *ppos)
+{
+	char *buf, *cmd;
+	int ret;
+
+	if (count > PATH_MAX)
+		return -EINVAL;
+
+	buf = kmalloc(count + 1, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	if (copy_from_user(buf, ubuf, count)) {
+		kfree(buf);
+		return -EFAULT;
+	}
+	buf[count] = '\0';
+	cmd = strim(buf);
+
+	mutex_lock(&prefetch_mutex);
+	if (!strcmp(cmd, "record")) {
+		ret = prefetch_start();
+	} else if (!strcmp(cmd, "stop")) {
+		prefetch_stop();
+		ret = 0;
+	} else if (!strncmp(cmd, "replay ", 7)) {
+		ret = prefetch_replay(skip_spaces(cmd + 7));
+	} else {
+		ret = -EINVAL;
+	}
+	mutex_unlock(&prefetch_mutex);
+
+	kfree(buf);
+
+	return ret ? ret : count;
+}
+
+static const struct file_operations prefetch_fops = {
+	.open		= prefetch_open,
+	.read		= seq_read,
+	.write		= prefetch_write,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
+static int __init prefetch_record_setup(char *str)
+{
+	prefetch_record_at_boot = true;
+	return 1;
+}
+__setup("bootprefetch_record", prefetch_record_setup);
+
+static int __init boot_prefetch_init(void)
+{
+	proc_create("bootprefetch", S_IRUSR | S_IWUSR, NULL, &prefetch_fops);
+
+	if (prefetch_record_at_boot) {
+		mutex_lock(&prefetch_mutex);
+		if (prefetch_start())
+			pr_err("bootprefetch: no memory to record\n");
+		mutex_unlock(&prefetch_mutex);
+	}
+
+	return 0;
+}
+module_init(boot_prefetch_init);
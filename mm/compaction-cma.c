@@ -14,6 +14,8 @@
 #include <linux/backing-dev.h>
 #include <linux/sysctl.h>
 #include <linux/sysfs.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
 #include "internal.h"
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
@@ -533,6 +535,17 @@ static isolate_migrate_t isolate_migratepages(struct zone *zone,
 	return ISOLATE_SUCCESS;
 }
 
+/* free blocks of @order, counting each larger one as several */
+static unsigned long zone_free_blocks(struct zone *zone, int order)
+{
+	unsigned long nr = 0;
+	int o;
+
+	for (o = order; o < MAX_ORDER; o++)
+		nr += zone->free_area[o].nr_free << (o - order);
+	return nr;
+}
+
 static int compact_finished(struct zone *zone,
 			    struct compact_control *cc)
 {
@@ -553,6 +566,11 @@ static int compact_finished(struct zone *zone,
 	if (cc->order == -1)
 		return COMPACT_CONTINUE;
 
+	/* kcompactd keeps going until the whole reserve is there */
+	if (cc->reserve_blocks)
+		return zone_free_blocks(zone, cc->order) >= cc->reserve_blocks ?
+			COMPACT_PARTIAL : COMPACT_CONTINUE;
+
 	/* Compaction run is not finished if the watermark is not met */
 	watermark = low_wmark_pages(zone);
 	watermark += (1 << cc->order);
@@ -631,6 +649,9 @@ static int compact_zone(struct zone *zone, struct compact_control *cc)
 	ret = compaction_suitable(zone, cc->order);
 	switch (ret) {
 	case COMPACT_PARTIAL:
+		/* one free block is not the reserve kcompactd is after */
+		if (cc->reserve_blocks)
+			break;
 	case COMPACT_SKIPPED:
 		/* Compaction is likely to fail */
 		return ret;
@@ -863,10 +884,143 @@ int sysctl_compaction_handler(struct ctl_table *table, int write,
 	return 0;
 }
 
+#ifdef CONFIG_COMPACTION_BACKGROUND
+/*
+ * Background compaction: kcompactd keeps sysctl_compaction_reserve_blocks
+ * free blocks of sysctl_compaction_reserve_order or larger in every zone,
+ * so that pgd, ion and wlan buffer allocations need not stall in direct
+ * compaction. It is woken by high-order allocations that leave a zone
+ * below its reserve, and runs SCHED_IDLE with async migration, so it only
+ * takes cpu time nobody else wants. A zone where compaction cannot restore
+ * the reserve is skipped for a growing number of wakeups, with a backoff of
+ * its own so that direct compaction is not deferred by it. The full
+ * compaction done when the screen goes off is handed to it as well.
+ */
+int sysctl_compaction_reserve_order = 3;
+int sysctl_compaction_reserve_blocks = 32;
+
+static struct task_struct *kcompactd_task;
+static DECLARE_WAIT_QUEUE_HEAD(kcompactd_wait);
+static bool kcompactd_pending;
+static bool kcompactd_full;
+
+static bool zone_below_reserve(struct zone *zone)
+{
+	return zone_free_blocks(zone, sysctl_compaction_reserve_order) <
+	       sysctl_compaction_reserve_blocks;
+}
+
+void wakeup_kcompactd(struct zone *zone, int order)
+{
+	if (!kcompactd_task || kcompactd_pending)
+		return;
+	if (!sysctl_compaction_reserve_blocks || !zone_below_reserve(zone))
+		return;
+
+	kcompactd_pending = true;
+	if (waitqueue_active(&kcompactd_wait))
+		wake_up_interruptible(&kcompactd_wait);
+}
+
+static bool kcompactd_deferred(struct zone *zone)
+{
+	if (zone->kcompactd_considered < (1U << zone->kcompactd_defer_shift)) {
+		zone->kcompactd_considered++;
+		return true;
+	}
+	return false;
+}
+
+static void kcompactd_defer(struct zone *zone)
+{
+	zone->kcompactd_considered = 0;
+	if (zone->kcompactd_defer_shift < COMPACT_MAX_DEFER_SHIFT)
+		zone->kcompactd_defer_shift++;
+}
+
+static void kcompactd_balance(void)
+{
+	struct zone *zone;
+
+	for_each_populated_zone(zone) {
+		struct compact_control cc = {
+			.nr_freepages = 0,
+			.nr_migratepages = 0,
+			.order = sysctl_compaction_reserve_order,
+			.migratetype = allocflags_to_migratetype(GFP_KERNEL),
+			.zone = zone,
+			.sync = false,
+			.reserve_blocks = sysctl_compaction_reserve_blocks,
+		};
+
+		if (kthread_should_stop() || freezing(current))
+			return;
+		if (!zone_below_reserve(zone) || kcompactd_deferred(zone))
+			continue;
+
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+		compact_zone(zone, &cc);
+
+		if (zone_below_reserve(zone))
+			kcompactd_defer(zone);
+		else
+			zone->kcompactd_defer_shift = 0;
+	}
+}
+
+static int kcompactd(void *unused)
+{
+	struct sched_param param = { .sched_priority = 0 };
+
+	sched_setscheduler(current, SCHED_IDLE, &param);
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(kcompactd_wait,
+				     kcompactd_pending || kcompactd_full ||
+				     kthread_should_stop());
+
+		if (kcompactd_full) {
+			kcompactd_full = false;
+			compact_nodes();
+		}
+		if (kcompactd_pending) {
+			kcompactd_balance();
+			kcompactd_pending = false;
+		}
+	}
+
+	return 0;
+}
+
+static int __init kcompactd_init(void)
+{
+	struct task_struct *task;
+
+	task = kthread_run(kcompactd, NULL, "kcompactd");
+	if (IS_ERR(task)) {
+		pr_err("Failed to start kcompactd\n");
+		return PTR_ERR(task);
+	}
+	kcompactd_task = task;
+	return 0;
+}
+module_init(kcompactd_init);
+#endif /* CONFIG_COMPACTION_BACKGROUND */
+
 #ifdef CONFIG_HAS_EARLYSUSPEND
 
 static void compaction_suspend(struct early_suspend *handler)
 {
+#ifdef CONFIG_COMPACTION_BACKGROUND
+	/* compact in the background instead of holding up early suspend */
+	if (kcompactd_task) {
+		kcompactd_full = true;
+		wake_up_interruptible(&kcompactd_wait);
+		return;
+	}
+#endif
 	compact_nodes();
 }
 
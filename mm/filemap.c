@@ -34,6 +34,9 @@
 #include <linux/hardirq.h> /* for BUG_ON(!in_atomic()) only */
 #include <linux/memcontrol.h>
 #include <linux/cleancache.h>
+#include <linux/bootprefetch.h>
+#include <linux/hotpin.h>
+#include <linux/workingset.h>
 #include "internal.h"
 
 /*
@@ -128,6 +131,7 @@ void __delete_from_page_cache(struct page *page)
 	page->mapping = NULL;
 	/* Leave page->index set: truncation lookup relies upon it */
 	mapping->nrpages--;
+	hotpin_account(mapping, -1);
 	__dec_zone_page_state(page, NR_FILE_PAGES);
 	if (PageSwapBacked(page))
 		__dec_zone_page_state(page, NR_SHMEM);
@@ -414,6 +418,7 @@ int replace_page_cache_page(struct page *old, struct page *new, gfp_t gfp_mask)
 		error = radix_tree_insert(&mapping->page_tree, offset, new);
 		BUG_ON(error);
 		mapping->nrpages++;
+		hotpin_account(mapping, 1);
 		__inc_zone_page_state(new, NR_FILE_PAGES);
 		if (PageSwapBacked(new))
 			__inc_zone_page_state(new, NR_SHMEM);
@@ -463,6 +468,7 @@ int add_to_page_cache_locked(struct page *page, struct address_space *mapping,
 		error = radix_tree_insert(&mapping->page_tree, offset, page);
 		if (likely(!error)) {
 			mapping->nrpages++;
+			hotpin_account(mapping, 1);
 			__inc_zone_page_state(page, NR_FILE_PAGES);
 			spin_unlock_irq(&mapping->tree_lock);
 		} else {
@@ -486,8 +492,15 @@ int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 	int ret;
 
 	ret = add_to_page_cache(page, mapping, offset, gfp_mask);
-	if (ret == 0)
-		lru_cache_add_file(page);
+	if (ret == 0) {
+		/* refaulting within the active list's reach: working set */
+		if (workingset_refault(mapping, offset)) {
+			workingset_activation(page);
+			lru_cache_add_lru(page, LRU_ACTIVE_FILE);
+		} else {
+			lru_cache_add_file(page);
+		}
+	}
 	return ret;
 }
 EXPORT_SYMBOL_GPL(add_to_page_cache_lru);
@@ -1098,6 +1111,8 @@ static void do_generic_file_read(struct file *filp, loff_t *ppos,
 	last_index = (*ppos + desc->count + PAGE_CACHE_SIZE-1) >> PAGE_CACHE_SHIFT;
 	offset = *ppos & ~PAGE_CACHE_MASK;
 
+	boot_prefetch_record(filp, index, last_index - index);
+
 	for (;;) {
 		struct page *page;
 		pgoff_t end_index;
@@ -1587,9 +1602,10 @@ static void do_sync_mmap_readahead(struct vm_area_struct *vma,
 		return;
 
 	/*
-	 * mmap read-around
+	 * mmap read-around, sized by how much of the previous one was used
 	 */
-	ra_pages = max_sane_readahead(ra->ra_pages);
+	ra_window_miss(mapping, ra);
+	ra_pages = max_sane_readahead(ra_window(ra));
 	ra->start = max_t(long, 0, offset - ra_pages / 2);
 	ra->size = ra_pages;
 	ra->async_size = ra_pages / 4;
@@ -1646,6 +1662,8 @@ int filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 	if (offset >= size)
 		return VM_FAULT_SIGBUS;
 
+	boot_prefetch_record(file, offset, 1);
+
 	/*
 	 * Do we have something in the page cache already?
 	 */
@@ -0,0 +1,97 @@
+/*
+ * mm/hotpin.c
+ *
+ * Hot pinning of file mappings.
+ *
+ * madvise(MADV_HOTPIN) on a file mapping marks the whole address_space,
+ * so its page cache outlives the mapping and survives the process that
+ * asked, as the launcher APK or framework jars should across a trip
+ * into a game. Reclaim puts pages of a pinned mapping back on the active
+ * list instead of evicting them, as long as both hold:
+ *
+ *  - reclaim is not yet scanning harder than hotpin_min_priority, past
+ *    which the pressure is at the level where processes get killed,
+ *  - all pinned mappings together cache no more than hotpin_max_pages.
+ *
+ * MADV_NOHOTPIN drops the mark again; so does evicting the inode. The
+ * hotpin_protected and hotpin_released vmstat events count pages spared
+ * and pages of pinned mappings evicted anyway.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/backing-dev.h>
+#include <linux/capability.h>
+#include <linux/fs.h>
+#include <linux/hotpin.h>
+#include <linux/mm.h>
+#include <linux/mman.h>
+#include <linux/mmzone.h>
+#include <linux/sysctl.h>
+#include <linux/vmstat.h>
+
+atomic_long_t nr_hotpin_pages = ATOMIC_LONG_INIT(0);
+
+/* 64MB with 4k pages */
+unsigned long sysctl_hotpin_max_pages = 16384;
+int sysctl_hotpin_min_priority = DEF_PRIORITY - 10;
+
+static void hotpin_mapping(struct address_space *mapping, bool pin)
+{
+	spin_lock_irq(&mapping->tree_lock);
+	if (pin && !test_and_set_bit(AS_HOTPIN, &mapping->flags))
+		atomic_long_add(mapping->nrpages, &nr_hotpin_pages);
+	else if (!pin && test_and_clear_bit(AS_HOTPIN, &mapping->flags))
+		atomic_long_sub(mapping->nrpages, &nr_hotpin_pages);
+	spin_unlock_irq(&mapping->tree_lock);
+}
+
+long hotpin_madvise(struct vm_area_struct *vma, int behavior)
+{
+	struct address_space *mapping;
+
+	if (!capable(CAP_IPC_LOCK))
+		return -EPERM;
+
+	if (!vma->vm_file)
+		return -EBADF;
+
+	/* shmem and friends are anon memory, not page cache to keep */
+	mapping = vma->vm_file->f_mapping;
+	if (mapping_cap_swap_backed(mapping))
+		return -EINVAL;
+
+	hotpin_mapping(mapping, behavior == MADV_HOTPIN);
+	return 0;
+}
+
+/* called on a locked page from shrink_page_list() */
+bool hotpin_page_protected(struct page *page, int priority)
+{
+	struct address_space *mapping = page_mapping(page);
+
+	if (!mapping || !mapping_hotpin(mapping))
+		return false;
+
+	if (priority < sysctl_hotpin_min_priority ||
+	    atomic_long_read(&nr_hotpin_pages) > sysctl_hotpin_max_pages) {
+		count_vm_event(HOTPIN_RELEASED);
+		return false;
+	}
+
+	count_vm_event(HOTPIN_PROTECTED);
+	return true;
+}
+
+int hotpin_pages_handler(struct ctl_table *table, int write,
+			 void __user *buffer, size_t *length, loff_t *ppos)
+{
+	unsigned long pages = atomic_long_read(&nr_hotpin_pages);
+	struct ctl_table t = *table;
+
+	t.data = &pages;
+	t.maxlen = sizeof(pages);
+	return proc_doulongvec_minmax(&t, write, buffer, length, ppos);
+}
@@ -90,6 +90,7 @@ extern unsigned long highest_memmap_pfn;
  */
 extern int isolate_lru_page(struct page *page);
 extern void putback_lru_page(struct page *page);
+extern bool boost_watermark(struct zone *zone);
 
 /*
  * in mm/page_alloc.c
@@ -124,6 +125,7 @@ struct compact_control {
 	int order;          /* order a direct compactor needs */
 	int migratetype;        /* MOVABLE, RECLAIMABLE etc */
 	struct zone *zone;
+	unsigned long reserve_blocks;	/* kcompactd: free blocks of order to reach */
 };
 
 unsigned long
@@ -36,6 +36,10 @@
 #include <linux/hash.h>
 #include <linux/freezer.h>
 #include <linux/oom.h>
+#include <linux/power_supply.h>
+#ifdef CONFIG_HAS_EARLYSUSPEND
+#include <linux/earlysuspend.h>
+#endif
 
 #include <asm/tlbflush.h>
 #include "internal.h"
@@ -183,6 +187,15 @@ static unsigned long ksm_pages_unshared;
 /* The number of rmap_items in use: to calculate pages_volatile */
 static unsigned long ksm_rmap_items;
 
+/* Map zero-filled pages to the zero page instead of a ksm page */
+static unsigned int ksm_use_zero_pages = 1;
+
+/* The number of page slots remapped to the zero page, ever */
+static unsigned long ksm_zero_pages_merged;
+
+/* Checksum of an empty page, as a marker in rmap_item->oldchecksum */
+static u32 zero_checksum __read_mostly;
+
 /* Number of pages ksmd should scan in one batch */
 static unsigned int ksm_thread_pages_to_scan = 250;
 
@@ -198,6 +211,43 @@ static DECLARE_WAIT_QUEUE_HEAD(ksm_thread_wait);
 static DEFINE_MUTEX(ksm_thread_mutex);
 static DEFINE_SPINLOCK(ksm_mmlist_lock);
 
+static struct task_struct *ksm_thread;
+
+/*
+ * Scan rate governor: at the end of every full scan its yield, the pages
+ * merged per 1000 scanned, decides the rate of the next one. A good yield
+ * doubles the batch size, up to KSM_BOOST_MAX times pages_to_scan; a poor
+ * one doubles the sleep, up to KSM_BACKOFF_MAX times or a minute, which
+ * costs nothing while there is little left to merge. In between the rate
+ * drifts back towards pages_to_scan and sleep_millisecs.
+ */
+#define KSM_BOOST_MAX		8
+#define KSM_BACKOFF_MAX		5
+#define KSM_SLEEP_MAX_MSECS	(60 * MSEC_PER_SEC)
+
+static unsigned int ksm_adaptive = 1;
+static unsigned int ksm_yield_high = 10;	/* per 1000 pages scanned */
+static unsigned int ksm_yield_low = 1;
+static unsigned int ksm_boost = 1;
+static unsigned int ksm_backoff;
+
+/* The full scan in progress, guarded by ksm_thread_mutex */
+static unsigned long ksm_scan_pages;
+static unsigned long ksm_scan_merges;
+static unsigned long ksm_scan_start;		/* jiffies */
+static unsigned long long ksm_scan_runtime;	/* ksmd cpu time, ns */
+
+/* What the last full scan achieved */
+static unsigned int ksm_scan_yield;
+static unsigned long ksm_scan_merges_per_sec;
+static unsigned long ksm_scan_cpu_msecs;
+
+#ifdef CONFIG_HAS_EARLYSUSPEND
+/* Leave the cpu to the foreground while the screen is on, unless charging */
+static unsigned int ksm_screen_on_pause = 1;
+static bool ksm_screen_on = true;
+#endif
+
 #define KSM_KMEM_CACHE(__struct, __flags) kmem_cache_create("ksm_"#__struct,\
 		sizeof(struct __struct), __alignof__(struct __struct),\
 		(__flags), NULL)
@@ -682,6 +732,20 @@ static u32 calc_checksum(struct page *page)
 	return checksum;
 }
 
+static bool page_is_zero_filled(struct page *page)
+{
+	void *addr = kmap_atomic(page);
+	bool zero = !memchr_inv(addr, 0, PAGE_SIZE);
+
+	kunmap_atomic(addr);
+	return zero;
+}
+
+static inline bool is_ksm_zero_page(struct page *page)
+{
+	return page == ZERO_PAGE(0);
+}
+
 static int memcmp_pages(struct page *page1, struct page *page2)
 {
 	char *addr1, *addr2;
@@ -773,6 +837,7 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 	pud_t *pud;
 	pmd_t *pmd;
 	pte_t *ptep;
+	pte_t newpte;
 	spinlock_t *ptl;
 	unsigned long addr;
 	int err = -EFAULT;
@@ -800,12 +865,19 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 		goto out;
 	}
 
-	get_page(kpage);
-	page_add_anon_rmap(kpage, vma, addr);
+	/* the zero page is neither refcounted nor on any rmap */
+	if (is_ksm_zero_page(kpage)) {
+		newpte = pte_mkspecial(pfn_pte(page_to_pfn(kpage),
+					       vma->vm_page_prot));
+	} else {
+		get_page(kpage);
+		page_add_anon_rmap(kpage, vma, addr);
+		newpte = mk_pte(kpage, vma->vm_page_prot);
+	}
 
 	flush_cache_page(vma, addr, pte_pfn(*ptep));
 	ptep_clear_flush(vma, addr, ptep);
-	set_pte_at_notify(mm, addr, ptep, mk_pte(kpage, vma->vm_page_prot));
+	set_pte_at_notify(mm, addr, ptep, newpte);
 
 	page_remove_rmap(page);
 	if (!page_mapped(page))
@@ -902,7 +974,7 @@ static int try_to_merge_one_page(struct vm_area_struct *vma,
 
 	if ((vma->vm_flags & VM_LOCKED) && kpage && !err) {
 		munlock_vma_page(page);
-		if (!PageMlocked(kpage)) {
+		if (!PageMlocked(kpage) && !is_ksm_zero_page(kpage)) {
 			unlock_page(page);
 			lock_page(kpage);
 			mlock_vma_page(kpage);
@@ -947,6 +1019,33 @@ out:
 	return err;
 }
 
+/*
+ * try_to_merge_with_zero_page - map a zero-filled page to the zero page.
+ * Nothing goes into the trees: the zero page is never a ksm page, and a
+ * later write to it simply faults in a fresh anonymous page.
+ *
+ * This function returns 0 if the page was remapped, -EFAULT otherwise.
+ */
+static int try_to_merge_with_zero_page(struct rmap_item *rmap_item,
+				       struct page *page)
+{
+	struct mm_struct *mm = rmap_item->mm;
+	struct vm_area_struct *vma;
+	int err = -EFAULT;
+
+	down_read(&mm->mmap_sem);
+	if (ksm_test_exit(mm))
+		goto out;
+	vma = find_vma(mm, rmap_item->address);
+	if (!vma || vma->vm_start > rmap_item->address)
+		goto out;
+
+	err = try_to_merge_one_page(vma, page, ZERO_PAGE(0));
+out:
+	up_read(&mm->mmap_sem);
+	return err;
+}
+
 /*
  * try_to_merge_two_pages - take two identical pages and prepare them
  * to be merged into one page.
@@ -1183,11 +1282,27 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 
 	remove_rmap_item_from_tree(rmap_item);
 
+	/*
+	 * An empty page needs no tree: if it was already empty on the last
+	 * scan, point it at the zero page. memchr_inv() stops at the first
+	 * nonzero byte, so this costs next to nothing on any other page.
+	 */
+	if (ksm_use_zero_pages && page_is_zero_filled(page)) {
+		if (rmap_item->oldchecksum == zero_checksum &&
+		    !try_to_merge_with_zero_page(rmap_item, page)) {
+			ksm_zero_pages_merged++;
+			ksm_scan_merges++;
+		}
+		rmap_item->oldchecksum = zero_checksum;
+		return;
+	}
+
 	/* We first start with searching the page inside the stable tree */
 	kpage = stable_tree_search(page);
 	if (kpage) {
 		err = try_to_merge_with_ksm_page(rmap_item, page, kpage);
 		if (!err) {
+			ksm_scan_merges++;
 			/*
 			 * The page was successfully merged:
 			 * add its rmap_item to the stable tree.
@@ -1224,6 +1339,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 		 * tree, and insert it instead as new node in the stable tree.
 		 */
 		if (kpage) {
+			ksm_scan_merges++;
 			remove_rmap_item_from_tree(tree_rmap_item);
 
 			lock_page(kpage);
@@ -1407,6 +1523,57 @@ next_mm:
 	return NULL;
 }
 
+/*
+ * Account the full scan just completed and set the rate of the next one.
+ */
+static void ksm_scan_done(void)
+{
+	unsigned long elapsed = max(jiffies - ksm_scan_start, 1UL);
+	unsigned long long runtime = task_sched_runtime(current);
+	unsigned int yield = 0;
+
+	if (ksm_scan_pages)
+		yield = ksm_scan_merges * 1000 / ksm_scan_pages;
+	ksm_scan_yield = yield;
+	ksm_scan_merges_per_sec = ksm_scan_merges * HZ / elapsed;
+	ksm_scan_cpu_msecs = div_u64(runtime - ksm_scan_runtime,
+				     NSEC_PER_MSEC);
+
+	if (!ksm_adaptive) {
+		ksm_boost = 1;
+		ksm_backoff = 0;
+	} else if (yield >= ksm_yield_high) {
+		ksm_boost = min(ksm_boost * 2, (unsigned int)KSM_BOOST_MAX);
+		ksm_backoff = 0;
+	} else if (yield < ksm_yield_low) {
+		ksm_boost = 1;
+		ksm_backoff = min(ksm_backoff + 1, (unsigned int)KSM_BACKOFF_MAX);
+	} else {
+		ksm_boost = max(ksm_boost / 2, 1U);
+		if (ksm_backoff)
+			ksm_backoff--;
+	}
+
+	ksm_scan_pages = 0;
+	ksm_scan_merges = 0;
+	ksm_scan_start = jiffies;
+	ksm_scan_runtime = runtime;
+}
+
+static unsigned int ksm_batch_pages(void)
+{
+	return ksm_thread_pages_to_scan * ksm_boost;
+}
+
+static unsigned int ksm_sleep_msecs(void)
+{
+	unsigned int msecs = ksm_thread_sleep_millisecs;
+
+	if (!ksm_backoff || msecs >= KSM_SLEEP_MAX_MSECS)
+		return msecs;
+	return min(msecs << ksm_backoff, (unsigned int)KSM_SLEEP_MAX_MSECS);
+}
+
 /**
  * ksm_do_scan  - the ksm scanner main worker function.
  * @scan_npages - number of pages we want to scan before we return.
@@ -1419,8 +1586,11 @@ static void ksm_do_scan(unsigned int scan_npages)
 	while (scan_npages-- && likely(!freezing(current))) {
 		cond_resched();
 		rmap_item = scan_get_next_rmap_item(&page);
-		if (!rmap_item)
+		if (!rmap_item) {
+			ksm_scan_done();
 			return;
+		}
+		ksm_scan_pages++;
 		if (!PageKsm(page) || !in_stable_tree(rmap_item))
 			cmp_and_merge_page(page, rmap_item);
 		put_page(page);
@@ -1432,6 +1602,21 @@ static int ksmd_should_run(void)
 	return (ksm_run & KSM_RUN_MERGE) && !list_empty(&ksm_mm_head.mm_list);
 }
 
+static bool ksmd_paused(void)
+{
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	if (!ksm_screen_on_pause || !ksm_screen_on)
+		return false;
+#ifdef CONFIG_POWER_SUPPLY
+	if (power_supply_is_system_supplied() > 0)
+		return false;
+#endif
+	return true;
+#else
+	return false;
+#endif
+}
+
 static int ksm_scan_thread(void *nothing)
 {
 	set_freezable();
@@ -1439,15 +1624,16 @@ static int ksm_scan_thread(void *nothing)
 
 	while (!kthread_should_stop()) {
 		mutex_lock(&ksm_thread_mutex);
-		if (ksmd_should_run())
-			ksm_do_scan(ksm_thread_pages_to_scan);
+		if (ksmd_should_run() && !ksmd_paused())
+			ksm_do_scan(ksm_batch_pages());
 		mutex_unlock(&ksm_thread_mutex);
 
 		try_to_freeze();
 
+		/* while paused, this also polls for a charger */
 		if (ksmd_should_run()) {
 			schedule_timeout_interruptible(
-				msecs_to_jiffies(ksm_thread_sleep_millisecs));
+				msecs_to_jiffies(ksm_sleep_msecs()));
 		} else {
 			wait_event_freezable(ksm_thread_wait,
 				ksmd_should_run() || kthread_should_stop());
@@ -1499,7 +1685,7 @@ int ksm_madvise(struct vm_area_struct *vma, unsigned long start,
 	return 0;
 }
 
-int __ksm_enter(struct mm_struct *mm)
+static int ksm_enter_mm(struct mm_struct *mm, bool forked)
 {
 	struct mm_slot *mm_slot;
 	int needs_wakeup;
@@ -1517,8 +1703,16 @@ int __ksm_enter(struct mm_struct *mm)
 	 * Insert just behind the scanning cursor, to let the area settle
 	 * down a little; when fork is followed by immediate exec, we don't
 	 * want ksmd to waste time setting up and tearing down an rmap_list.
+	 *
+	 * A child forked from a mergeable mm, as zygote children are, goes
+	 * just ahead of the cursor instead: what it allocates while it
+	 * specializes duplicates its siblings, and there is no exec to wait
+	 * for. ksmd gets to it no earlier than its next batch.
 	 */
-	list_add_tail(&mm_slot->mm_list, &ksm_scan.mm_slot->mm_list);
+	if (forked)
+		list_add(&mm_slot->mm_list, &ksm_scan.mm_slot->mm_list);
+	else
+		list_add_tail(&mm_slot->mm_list, &ksm_scan.mm_slot->mm_list);
 	spin_unlock(&ksm_mmlist_lock);
 
 	set_bit(MMF_VM_MERGEABLE, &mm->flags);
@@ -1530,6 +1724,16 @@ int __ksm_enter(struct mm_struct *mm)
 	return 0;
 }
 
+int __ksm_enter(struct mm_struct *mm)
+{
+	return ksm_enter_mm(mm, false);
+}
+
+int __ksm_fork(struct mm_struct *mm)
+{
+	return ksm_enter_mm(mm, true);
+}
+
 void __ksm_exit(struct mm_struct *mm)
 {
 	struct mm_slot *mm_slot;
@@ -1964,6 +2168,36 @@ static ssize_t pages_volatile_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(pages_volatile);
 
+static ssize_t use_zero_pages_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_use_zero_pages);
+}
+
+static ssize_t use_zero_pages_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	unsigned long val;
+	int err;
+
+	err = strict_strtoul(buf, 10, &val);
+	if (err || val > 1)
+		return -EINVAL;
+
+	ksm_use_zero_pages = val;
+
+	return count;
+}
+KSM_ATTR(use_zero_pages);
+
+static ssize_t zero_pages_merged_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_zero_pages_merged);
+}
+KSM_ATTR_RO(zero_pages_merged);
+
 static ssize_t full_scans_show(struct kobject *kobj,
 			       struct kobj_attribute *attr, char *buf)
 {
@@ -1971,6 +2205,137 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t adaptive_show(struct kobject *kobj,
+			     struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_adaptive);
+}
+
+static ssize_t adaptive_store(struct kobject *kobj,
+			      struct kobj_attribute *attr,
+			      const char *buf, size_t count)
+{
+	unsigned long val;
+	int err;
+
+	err = strict_strtoul(buf, 10, &val);
+	if (err || val > 1)
+		return -EINVAL;
+
+	mutex_lock(&ksm_thread_mutex);
+	ksm_adaptive = val;
+	if (!val) {
+		ksm_boost = 1;
+		ksm_backoff = 0;
+	}
+	mutex_unlock(&ksm_thread_mutex);
+
+	return count;
+}
+KSM_ATTR(adaptive);
+
+static ssize_t yield_high_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_yield_high);
+}
+
+static ssize_t yield_high_store(struct kobject *kobj,
+				struct kobj_attribute *attr,
+				const char *buf, size_t count)
+{
+	unsigned long val;
+	int err;
+
+	err = strict_strtoul(buf, 10, &val);
+	if (err || val > 1000 || val < ksm_yield_low)
+		return -EINVAL;
+
+	ksm_yield_high = val;
+
+	return count;
+}
+KSM_ATTR(yield_high);
+
+static ssize_t yield_low_show(struct kobject *kobj,
+			      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_yield_low);
+}
+
+static ssize_t yield_low_store(struct kobject *kobj,
+			       struct kobj_attribute *attr,
+			       const char *buf, size_t count)
+{
+	unsigned long val;
+	int err;
+
+	err = strict_strtoul(buf, 10, &val);
+	if (err || val > ksm_yield_high)
+		return -EINVAL;
+
+	ksm_yield_low = val;
+
+	return count;
+}
+KSM_ATTR(yield_low);
+
+static ssize_t full_scan_yield_show(struct kobject *kobj,
+				    struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_scan_yield);
+}
+KSM_ATTR_RO(full_scan_yield);
+
+static ssize_t full_scan_merges_per_sec_show(struct kobject *kobj,
+					     struct kobj_attribute *attr,
+					     char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_scan_merges_per_sec);
+}
+KSM_ATTR_RO(full_scan_merges_per_sec);
+
+static ssize_t full_scan_cpu_msecs_show(struct kobject *kobj,
+					struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_scan_cpu_msecs);
+}
+KSM_ATTR_RO(full_scan_cpu_msecs);
+
+static ssize_t scan_rate_show(struct kobject *kobj,
+			      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u pages every %u ms\n",
+		       ksm_batch_pages(), ksm_sleep_msecs());
+}
+KSM_ATTR_RO(scan_rate);
+
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static ssize_t screen_on_pause_show(struct kobject *kobj,
+				    struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_screen_on_pause);
+}
+
+static ssize_t screen_on_pause_store(struct kobject *kobj,
+				     struct kobj_attribute *attr,
+				     const char *buf, size_t count)
+{
+	unsigned long val;
+	int err;
+
+	err = strict_strtoul(buf, 10, &val);
+	if (err || val > 1)
+		return -EINVAL;
+
+	ksm_screen_on_pause = val;
+	wake_up_process(ksm_thread);
+
+	return count;
+}
+KSM_ATTR(screen_on_pause);
+#endif
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
@@ -1979,7 +2344,19 @@ static struct attribute *ksm_attrs[] = {
 	&pages_sharing_attr.attr,
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
+	&use_zero_pages_attr.attr,
+	&zero_pages_merged_attr.attr,
 	&full_scans_attr.attr,
+	&adaptive_attr.attr,
+	&yield_high_attr.attr,
+	&yield_low_attr.attr,
+	&full_scan_yield_attr.attr,
+	&full_scan_merges_per_sec_attr.attr,
+	&full_scan_cpu_msecs_attr.attr,
+	&scan_rate_attr.attr,
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	&screen_on_pause_attr.attr,
+#endif
 	NULL,
 };
 
@@ -1989,15 +2366,36 @@ static struct attribute_group ksm_attr_group = {
 };
 #endif /* CONFIG_SYSFS */
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static void ksm_early_suspend(struct early_suspend *handler)
+{
+	ksm_screen_on = false;
+	wake_up_process(ksm_thread);
+}
+
+static void ksm_late_resume(struct early_suspend *handler)
+{
+	ksm_screen_on = true;
+}
+
+static struct early_suspend ksm_early_suspend_handler = {
+	.level = EARLY_SUSPEND_LEVEL_DISABLE_FB,
+	.suspend = ksm_early_suspend,
+	.resume = ksm_late_resume,
+};
+#endif
+
 static int __init ksm_init(void)
 {
-	struct task_struct *ksm_thread;
 	int err;
 
 	err = ksm_slab_init();
 	if (err)
 		goto out;
 
+	zero_checksum = calc_checksum(ZERO_PAGE(0));
+
+	ksm_scan_start = jiffies;
 	ksm_thread = kthread_run(ksm_scan_thread, NULL, "ksmd");
 	if (IS_ERR(ksm_thread)) {
 		printk(KERN_ERR "ksm: creating kthread failed\n");
@@ -2023,6 +2421,9 @@ static int __init ksm_init(void)
 	 * later callbacks could only be taking locks which nest within that.
 	 */
 	hotplug_memory_notifier(ksm_memory_callback, 100);
+#endif
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	register_early_suspend(&ksm_early_suspend_handler);
 #endif
 	return 0;
 
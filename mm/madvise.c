@@ -14,6 +14,7 @@
 #include <linux/sched.h>
 #include <linux/ksm.h>
 #include <linux/file.h>
+#include <linux/hotpin.h>
 
 /*
  * Any behaviour which results in changes to the vma->vm_flags needs to
@@ -26,6 +27,10 @@ static int madvise_need_mmap_write(int behavior)
 	case MADV_REMOVE:
 	case MADV_WILLNEED:
 	case MADV_DONTNEED:
+#ifdef CONFIG_FILE_HOTPIN
+	case MADV_HOTPIN:
+	case MADV_NOHOTPIN:
+#endif
 		return 0;
 	default:
 		/* be safe, default to 1. list exceptions explicitly */
@@ -285,6 +290,12 @@ madvise_vma(struct vm_area_struct *vma, struct vm_area_struct **prev,
 		return madvise_willneed(vma, prev, start, end);
 	case MADV_DONTNEED:
 		return madvise_dontneed(vma, prev, start, end);
+#ifdef CONFIG_FILE_HOTPIN
+	case MADV_HOTPIN:
+	case MADV_NOHOTPIN:
+		*prev = vma;
+		return hotpin_madvise(vma, behavior);
+#endif
 	default:
 		return madvise_behavior(vma, prev, start, end, behavior);
 	}
@@ -312,6 +323,10 @@ madvise_behavior_valid(int behavior)
 #endif
 	case MADV_DONTDUMP:
 	case MADV_DODUMP:
+#ifdef CONFIG_FILE_HOTPIN
+	case MADV_HOTPIN:
+	case MADV_NOHOTPIN:
+#endif
 		return 1;
 
 	default:
@@ -349,6 +364,9 @@ madvise_behavior_valid(int behavior)
  *  MADV_MERGEABLE - the application recommends that KSM try to merge pages in
  *		this area with pages of identical content from other such areas.
  *  MADV_UNMERGEABLE- cancel MADV_MERGEABLE: no longer merge pages with others.
+ *  MADV_HOTPIN - keep the page cache of the mapped file from reclaim, up to
+ *		the limits described in mm/hotpin.c.
+ *  MADV_NOHOTPIN - cancel MADV_HOTPIN for the mapped file.
  *
  * return values:
  *  zero    - success
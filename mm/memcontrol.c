@@ -2019,9 +2019,23 @@ void mem_cgroup_update_page_stat(struct page *page,
  * TODO: maybe necessary to use big numbers in big irons.
  */
 #define CHARGE_BATCH	32U
+
+/*
+ * With CONFIG_CGROUP_MEM_RES_CTLR_LITE each cpu caches charges for a few
+ * groups at once, so tasks of different app groups sharing a cpu do not
+ * keep draining each other's stock, and single page uncharges go back to
+ * the stock instead of the res_counter.
+ */
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_LITE
+#define NR_MEMCG_STOCK	4
+#else
+#define NR_MEMCG_STOCK	1
+#endif
+
 struct memcg_stock_pcp {
-	struct mem_cgroup *cached; /* this never be root cgroup */
-	unsigned int nr_pages;
+	struct mem_cgroup *cached[NR_MEMCG_STOCK]; /* never be root cgroup */
+	unsigned int nr_pages[NR_MEMCG_STOCK];
+	unsigned int next;	/* slot to recycle when all are in use */
 	struct work_struct work;
 	unsigned long flags;
 #define FLUSHING_CACHED_CHARGE	(0)
@@ -2029,6 +2043,16 @@ struct memcg_stock_pcp {
 static DEFINE_PER_CPU(struct memcg_stock_pcp, memcg_stock);
 static DEFINE_MUTEX(percpu_charge_mutex);
 
+static int stock_slot(struct memcg_stock_pcp *stock, struct mem_cgroup *memcg)
+{
+	int i;
+
+	for (i = 0; i < NR_MEMCG_STOCK; i++)
+		if (stock->cached[i] == memcg)
+			return i;
+	return -1;
+}
+
 /*
  * Try to consume stocked charge on this cpu. If success, one page is consumed
  * from local stock and true is returned. If the stock is 0 or charges from a
@@ -2039,10 +2063,12 @@ static bool consume_stock(struct mem_cgroup *memcg)
 {
 	struct memcg_stock_pcp *stock;
 	bool ret = true;
+	int i;
 
 	stock = &get_cpu_var(memcg_stock);
-	if (memcg == stock->cached && stock->nr_pages)
-		stock->nr_pages--;
+	i = stock_slot(stock, memcg);
+	if (i >= 0 && stock->nr_pages[i])
+		stock->nr_pages[i]--;
 	else /* need to call res_counter_charge */
 		ret = false;
 	put_cpu_var(memcg_stock);
@@ -2050,21 +2076,32 @@ static bool consume_stock(struct mem_cgroup *memcg)
 }
 
 /*
- * Returns stocks cached in percpu to res_counter and reset cached information.
+ * Returns one slot's stock to res_counter and reset cached information.
  */
-static void drain_stock(struct memcg_stock_pcp *stock)
+static void drain_stock_slot(struct memcg_stock_pcp *stock, int i)
 {
-	struct mem_cgroup *old = stock->cached;
+	struct mem_cgroup *old = stock->cached[i];
 
-	if (stock->nr_pages) {
-		unsigned long bytes = stock->nr_pages * PAGE_SIZE;
+	if (stock->nr_pages[i]) {
+		unsigned long bytes = stock->nr_pages[i] * PAGE_SIZE;
 
 		res_counter_uncharge(&old->res, bytes);
 		if (do_swap_account)
 			res_counter_uncharge(&old->memsw, bytes);
-		stock->nr_pages = 0;
+		stock->nr_pages[i] = 0;
 	}
-	stock->cached = NULL;
+	stock->cached[i] = NULL;
+}
+
+/*
+ * Returns stocks cached in percpu to res_counter and reset cached information.
+ */
+static void drain_stock(struct memcg_stock_pcp *stock)
+{
+	int i;
+
+	for (i = 0; i < NR_MEMCG_STOCK; i++)
+		drain_stock_slot(stock, i);
 }
 
 /*
@@ -2085,15 +2122,54 @@ static void drain_local_stock(struct work_struct *dummy)
 static void refill_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 {
 	struct memcg_stock_pcp *stock = &get_cpu_var(memcg_stock);
+	int i;
 
-	if (stock->cached != memcg) { /* reset if necessary */
-		drain_stock(stock);
-		stock->cached = memcg;
+	i = stock_slot(stock, memcg);
+	if (i < 0) { /* reset if necessary */
+		i = stock_slot(stock, NULL);
+		if (i < 0) {
+			i = stock->next;
+			stock->next = (i + 1) % NR_MEMCG_STOCK;
+			drain_stock_slot(stock, i);
+		}
+		stock->cached[i] = memcg;
 	}
-	stock->nr_pages += nr_pages;
+	stock->nr_pages[i] += nr_pages;
 	put_cpu_var(memcg_stock);
 }
 
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_LITE
+/*
+ * Keep an uncharged page in this cpu's stock when it already caches the
+ * group, the next charge from it on this cpu then does not touch the
+ * res_counter either. Returns false if the caller has to uncharge.
+ */
+static bool uncharge_to_stock(struct mem_cgroup *memcg)
+{
+	struct memcg_stock_pcp *stock;
+	bool ret = false;
+	int i;
+
+	/* the stock is only protected against preemption */
+	if (in_interrupt())
+		return false;
+
+	stock = &get_cpu_var(memcg_stock);
+	i = stock_slot(stock, memcg);
+	if (i >= 0 && stock->nr_pages[i] < CHARGE_BATCH) {
+		stock->nr_pages[i]++;
+		ret = true;
+	}
+	put_cpu_var(memcg_stock);
+	return ret;
+}
+#else
+static inline bool uncharge_to_stock(struct mem_cgroup *memcg)
+{
+	return false;
+}
+#endif
+
 /*
  * Drains all per-CPU charge caches for given root_memcg resp. subtree
  * of the hierarchy under it. sync flag says whether we should block
@@ -2101,7 +2177,7 @@ static void refill_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
  */
 static void drain_all_stock(struct mem_cgroup *root_memcg, bool sync)
 {
-	int cpu, curcpu;
+	int cpu, curcpu, i;
 
 	/* Notify other cpus that system-wide "drain" is running */
 	get_online_cpus();
@@ -2110,10 +2186,13 @@ static void drain_all_stock(struct mem_cgroup *root_memcg, bool sync)
 		struct memcg_stock_pcp *stock = &per_cpu(memcg_stock, cpu);
 		struct mem_cgroup *memcg;
 
-		memcg = stock->cached;
-		if (!memcg || !stock->nr_pages)
-			continue;
-		if (!mem_cgroup_same_or_subtree(root_memcg, memcg))
+		for (i = 0; i < NR_MEMCG_STOCK; i++) {
+			memcg = stock->cached[i];
+			if (memcg && stock->nr_pages[i] &&
+			    mem_cgroup_same_or_subtree(root_memcg, memcg))
+				break;
+		}
+		if (i == NR_MEMCG_STOCK)
 			continue;
 		if (!test_and_set_bit(FLUSHING_CACHED_CHARGE, &stock->flags)) {
 			if (cpu == curcpu)
@@ -2966,6 +3045,11 @@ static void mem_cgroup_do_uncharge(struct mem_cgroup *memcg,
 		batch->memsw_nr_pages++;
 	return;
 direct_uncharge:
+	/* the stock holds memsw charges too whenever swap is accounted */
+	if (nr_pages == 1 && uncharge_memsw == do_swap_account &&
+	    !test_thread_flag(TIF_MEMDIE) &&
+	    !atomic_read(&memcg->under_oom) && uncharge_to_stock(memcg))
+		return;
 	res_counter_uncharge(&memcg->res, nr_pages * PAGE_SIZE);
 	if (uncharge_memsw)
 		res_counter_uncharge(&memcg->memsw, nr_pages * PAGE_SIZE);
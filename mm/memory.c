@@ -2994,8 +2994,8 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	delayacct_set_flag(DELAYACCT_PF_SWAPIN);
 	page = lookup_swap_cache(entry);
 	if (!page) {
-		page = swapin_readahead(entry,
-					GFP_HIGHUSER_MOVABLE, vma, address);
+		page = swapin_vma_readahead(entry,
+					GFP_HIGHUSER_MOVABLE, vma, address, pmd);
 		if (!page) {
 			/*
 			 * Back out if somebody else faulted in this pte
@@ -61,6 +61,7 @@ void compare_swap_oom_score_adj(int old_val, int new_val)
 	if (current->signal->oom_score_adj == old_val)
 		current->signal->oom_score_adj = new_val;
 	trace_oom_score_adj_update(current);
+	lowmem_adj_tree_update(current);
 	spin_unlock_irq(&sighand->siglock);
 }
 
@@ -81,6 +82,7 @@ int test_set_oom_score_adj(int new_val)
 	old_val = current->signal->oom_score_adj;
 	current->signal->oom_score_adj = new_val;
 	trace_oom_score_adj_update(current);
+	lowmem_adj_tree_update(current);
 	spin_unlock_irq(&sighand->siglock);
 
 	return old_val;
@@ -35,6 +35,9 @@
 #include <linux/buffer_head.h> /* __set_page_dirty_buffers */
 #include <linux/pagevec.h>
 #include <trace/events/writeback.h>
+#ifdef CONFIG_HAS_EARLYSUSPEND
+#include <linux/earlysuspend.h>
+#endif
 
 /*
  * Sleep at most 200ms at a time in balance_dirty_pages().
@@ -1516,6 +1519,73 @@ int dirty_writeback_centisecs_handler(ctl_table *table, int write,
 	return 0;
 }
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+/*
+ * While the screen is on, kupdate-style writeback runs at the longer
+ * active interval so that flushes are batched rather than landing in the
+ * middle of scrolling. On screen-off everything dirty is written out at
+ * once, and the suspend interval keeps the flushers from waking the
+ * storage every few seconds afterwards. Writeback driven by the dirty
+ * thresholds is untouched in both states.
+ */
+int dynamic_dirty_writeback = 1;
+unsigned int dirty_writeback_active_interval = 15 * 100; /* centiseconds */
+unsigned int dirty_writeback_suspend_interval = 60 * 100; /* centiseconds */
+static bool dirty_writeback_screen_off;
+
+static void dirty_writeback_update_interval(void)
+{
+	if (!dynamic_dirty_writeback)
+		return;
+
+	dirty_writeback_interval = dirty_writeback_screen_off ?
+		dirty_writeback_suspend_interval :
+		dirty_writeback_active_interval;
+	bdi_arm_supers_timer();
+}
+
+int dynamic_dirty_writeback_handler(struct ctl_table *table, int write,
+	void __user *buffer, size_t *length, loff_t *ppos)
+{
+	int ret;
+
+	ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (!ret && write)
+		dirty_writeback_update_interval();
+	return ret;
+}
+
+static void dirty_writeback_early_suspend(struct early_suspend *handler)
+{
+	dirty_writeback_screen_off = true;
+	if (!dynamic_dirty_writeback)
+		return;
+
+	dirty_writeback_update_interval();
+	wakeup_flusher_threads(0, WB_REASON_PERIODIC);
+}
+
+static void dirty_writeback_late_resume(struct early_suspend *handler)
+{
+	dirty_writeback_screen_off = false;
+	dirty_writeback_update_interval();
+}
+
+static struct early_suspend dirty_writeback_early_suspend_handler = {
+	.level = EARLY_SUSPEND_LEVEL_DISABLE_FB,
+	.suspend = dirty_writeback_early_suspend,
+	.resume = dirty_writeback_late_resume,
+};
+
+static int __init dynamic_dirty_writeback_init(void)
+{
+	dirty_writeback_update_interval();
+	register_early_suspend(&dirty_writeback_early_suspend_handler);
+	return 0;
+}
+late_initcall(dynamic_dirty_writeback_init);
+#endif
+
 #ifdef CONFIG_BLOCK
 void laptop_mode_timer_fn(unsigned long data)
 {
@@ -60,6 +60,7 @@
 #include <linux/migrate.h>
 #include <linux/delay.h>
 #include <linux/dma-contiguous.h>
+#include <linux/workqueue.h>
 
 #include <asm/tlbflush.h>
 #include <asm/div64.h>
@@ -725,6 +726,92 @@ static void free_one_page(struct zone *zone, struct page *page, int order,
 	spin_unlock(&zone->lock);
 }
 
+/*
+ * Kernel stacks, pgds and network buffers come and go in blocks of order 1
+ * to 3. A few such blocks are kept on per cpu lists so that they rarely
+ * need the zone lock; they are drained together with the order-0 lists,
+ * under memory pressure and when a cpu goes away. Blocks of the CMA,
+ * isolated and reserve pageblocks always go back to the buddy lists.
+ */
+static inline int pcp_high_limit(int order)
+{
+	return PCP_HIGH_BLOCKS >> (order - 1);
+}
+
+static inline bool pcp_has_high(struct per_cpu_pages *pcp)
+{
+	int i;
+
+	for (i = 0; i < PCP_HIGH_ORDERS; i++)
+		if (pcp->high_count[i])
+			return true;
+	return false;
+}
+
+/* Must be called with interrupts disabled */
+static bool free_pcp_high(struct zone *zone, struct page *page, int order,
+			  int migratetype)
+{
+	struct per_cpu_pages *pcp;
+
+	if (!order || order > PCP_HIGH_ORDERS ||
+	    migratetype >= MIGRATE_PCPTYPES)
+		return false;
+
+	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	if (pcp->high_count[order - 1] >= pcp_high_limit(order))
+		return false;
+
+	set_page_private(page, migratetype);
+	list_add(&page->lru, &pcp->high_lists[order - 1]);
+	pcp->high_count[order - 1]++;
+	return true;
+}
+
+/* Must be called with interrupts disabled */
+static struct page *rmqueue_pcp_high(struct zone *zone, int order,
+				     int migratetype)
+{
+	struct per_cpu_pages *pcp;
+	struct page *page;
+
+	if (order > PCP_HIGH_ORDERS)
+		return NULL;
+
+	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	list_for_each_entry(page, &pcp->high_lists[order - 1], lru) {
+		if (page_private(page) != migratetype)
+			continue;
+		list_del(&page->lru);
+		pcp->high_count[order - 1]--;
+		return page;
+	}
+	return NULL;
+}
+
+/* Must be called with interrupts disabled */
+static void drain_pcp_high(struct zone *zone, struct per_cpu_pages *pcp)
+{
+	struct page *page, *next;
+	int i, order;
+
+	spin_lock(&zone->lock);
+	zone->all_unreclaimable = 0;
+	zone->pages_scanned = 0;
+	for (i = 0; i < PCP_HIGH_ORDERS; i++) {
+		order = i + 1;
+		list_for_each_entry_safe(page, next, &pcp->high_lists[i], lru) {
+			list_del(&page->lru);
+			/* the pageblock may have been isolated meanwhile */
+			__free_one_page(page, zone, order,
+					get_pageblock_migratetype(page));
+			__mod_zone_page_state(zone, NR_FREE_PAGES, 1 << order);
+		}
+		pcp->high_count[i] = 0;
+	}
+	spin_unlock(&zone->lock);
+}
+
 static bool free_pages_prepare(struct page *page, unsigned int order)
 {
 	int i;
@@ -756,16 +843,19 @@ static void __free_pages_ok(struct page *page, unsigned int order)
 {
 	unsigned long flags;
 	int wasMlocked = __TestClearPageMlocked(page);
+	struct zone *zone = page_zone(page);
+	int migratetype;
 
 	if (!free_pages_prepare(page, order))
 		return;
 
+	migratetype = get_pageblock_migratetype(page);
 	local_irq_save(flags);
 	if (unlikely(wasMlocked))
 		free_page_mlock(page);
 	__count_vm_events(PGFREE, 1 << order);
-	free_one_page(page_zone(page), page, order,
-					get_pageblock_migratetype(page));
+	if (!free_pcp_high(zone, page, order, migratetype))
+		free_one_page(zone, page, order, migratetype);
 	local_irq_restore(flags);
 }
 
@@ -1093,6 +1183,16 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 					struct page, lru);
 			area->nr_free--;
 
+			/*
+			 * The pageblock ends up holding pages of more than one
+			 * type: boost the watermarks so kswapd frees whole
+			 * blocks before the next fallback has to mix another.
+			 */
+			if (current_order < pageblock_order &&
+			    !is_migrate_cma(migratetype) &&
+			    boost_watermark(zone))
+				__count_vm_event(WATERMARK_BOOST_FRAG);
+
 			/*
 			 * If breaking a large block of pages, move all free
 			 * pages to the preferred allocation list. If falling
@@ -1305,6 +1405,8 @@ static void drain_pages(unsigned int cpu)
 			free_pcppages_bulk(zone, pcp->count, pcp);
 			pcp->count = 0;
 		}
+		if (pcp_has_high(pcp))
+			drain_pcp_high(zone, pcp);
 		local_irq_restore(flags);
 	}
 }
@@ -1348,7 +1450,7 @@ void drain_all_pages(void)
 		bool has_pcps = false;
 		for_each_populated_zone(zone) {
 			pcp = per_cpu_ptr(zone->pageset, cpu);
-			if (pcp->pcp.count) {
+			if (pcp->pcp.count || pcp_has_high(&pcp->pcp)) {
 				has_pcps = true;
 				break;
 			}
@@ -1620,24 +1722,33 @@ again:
 			 */
 			WARN_ON_ONCE(order > 1);
 		}
-		spin_lock_irqsave(&zone->lock, flags);
-		if (gfp_flags & __GFP_CMA)
-			page = __rmqueue_cma(zone, order, migratetype);
-		else
-			page = __rmqueue(zone, order, migratetype);
-		spin_unlock(&zone->lock);
-		if (!page)
-			goto failed;
-		if (is_cma_pageblock(page))
-			__mod_zone_page_state(zone, NR_FREE_CMA_PAGES,
+		local_irq_save(flags);
+		page = rmqueue_pcp_high(zone, order, migratetype);
+		if (!page) {
+			spin_lock(&zone->lock);
+			if (gfp_flags & __GFP_CMA)
+				page = __rmqueue_cma(zone, order, migratetype);
+			else
+				page = __rmqueue(zone, order, migratetype);
+			spin_unlock(&zone->lock);
+			if (!page)
+				goto failed;
+			wakeup_kcompactd(zone, order);
+			if (is_cma_pageblock(page))
+				__mod_zone_page_state(zone, NR_FREE_CMA_PAGES,
+						      -(1 << order));
+			__mod_zone_page_state(zone, NR_FREE_PAGES,
 					      -(1 << order));
-		__mod_zone_page_state(zone, NR_FREE_PAGES, -(1 << order));
+		}
 	}
 
 	__count_zone_vm_events(PGALLOC, zone, 1 << order);
 	zone_statistics(preferred_zone, zone, gfp_flags);
 	local_irq_restore(flags);
 
+	if (unlikely(zone_test_and_clear_flag(zone, ZONE_BOOSTED_WATERMARK)))
+		wakeup_kswapd(zone, 0, zone_idx(zone));
+
 	VM_BUG_ON(bad_range(zone, page));
 	if (prep_new_page(page, order, gfp_flags))
 		goto again;
@@ -4037,7 +4148,7 @@ static int zone_batchsize(struct zone *zone)
 static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
 {
 	struct per_cpu_pages *pcp;
-	int migratetype;
+	int migratetype, order;
 
 	memset(p, 0, sizeof(*p));
 
@@ -4047,6 +4158,8 @@ static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
 	pcp->batch = max(1UL, 1 * batch);
 	for (migratetype = 0; migratetype < MIGRATE_PCPTYPES; migratetype++)
 		INIT_LIST_HEAD(&pcp->lists[migratetype]);
+	for (order = 0; order < PCP_HIGH_ORDERS; order++)
+		INIT_LIST_HEAD(&pcp->high_lists[order]);
 }
 
 /*
@@ -6154,26 +6267,30 @@ static struct page *
 __alloc_contig_migrate_alloc(struct page *page, unsigned long private,
 			     int **resultp)
 {
-	gfp_t gfp_mask = GFP_USER | __GFP_MOVABLE;
-
+	/* keep highmem pages in highmem, lowmem is what the kernel needs */
 	if (PageHighMem(page))
-		printk(KERN_INFO "%s[%d] gfp_mask 0x%x\n",
-				__func__, __LINE__, (unsigned int) gfp_mask);
+		return alloc_page(GFP_HIGHUSER_MOVABLE);
 
-	return alloc_page(gfp_mask);
+	return alloc_page(GFP_USER | __GFP_MOVABLE);
 }
 
 struct page *failed_pages[5][10];	/* FIXME: locking */
 
+/* pages isolated from the lru before each migrate_pages() call */
+#define CONTIG_MIGRATE_BATCH	(8 * COMPACT_CLUSTER_MAX)
+
+/* ranges of at least this many pageblocks are migrated by several cpus */
+#define CONTIG_PARALLEL_BLOCKS	2
+
 /* [start, end) must belong to a single zone. */
-static int __alloc_contig_migrate_range(unsigned long start, unsigned long end)
+static int __alloc_contig_migrate_range(unsigned long start, unsigned long end,
+					atomic_t *abort)
 {
 	/* This function is based on compact_zone() from compaction.c. */
 
 	unsigned long pfn = start;
 	int tries = 0;
 	int ret = 0;
-	int i, j;
 
 	struct compact_control cc = {
 		.nr_migratepages = 0,
@@ -6183,23 +6300,38 @@ static int __alloc_contig_migrate_range(unsigned long start, unsigned long end)
 	};
 	INIT_LIST_HEAD(&cc.migratepages);
 
-	for (i = 0; i < 5; i++) {
-		for (j = 0; j < 10; j++)
-			failed_pages[i][j] = NULL;
-	}
-
-	migrate_prep();
-
 	while (pfn < end || !list_empty(&cc.migratepages)) {
 		if (fatal_signal_pending(current)) {
 			ret = -EINTR;
 			break;
 		}
+		/* some other chunk failed, the range is lost anyway */
+		if (atomic_read(abort)) {
+			ret = -EBUSY;
+			break;
+		}
 
 		if (list_empty(&cc.migratepages)) {
-			cc.nr_migratepages = 0;
-			pfn = isolate_migratepages_range(cc.zone, &cc,
-							 pfn, end);
+			LIST_HEAD(batch);
+			unsigned long nr = 0;
+
+			/*
+			 * Gather a good batch before migrating: the passes of
+			 * migrate_pages() over the pages it could not move yet
+			 * then have other work in between. Each isolation
+			 * call accounts every page on cc.migratepages as
+			 * isolated, so it must only ever see its own pages.
+			 */
+			do {
+				cc.nr_migratepages = 0;
+				pfn = isolate_migratepages_range(cc.zone, &cc,
+								 pfn, end);
+				list_splice_init(&cc.migratepages, &batch);
+				nr += cc.nr_migratepages;
+			} while (pfn && pfn < end &&
+				 nr < CONTIG_MIGRATE_BATCH);
+			list_splice(&batch, &cc.migratepages);
+			cc.nr_migratepages = nr;
 			if (!pfn) {
 				ret = -EINTR;
 				break;
@@ -6216,9 +6348,93 @@ static int __alloc_contig_migrate_range(unsigned long start, unsigned long end)
 	}
 
 	putback_lru_pages(&cc.migratepages);
+	if (ret < 0)
+		atomic_cmpxchg(abort, 0, ret);
 	return ret > 0 ? 0 : ret;
 }
 
+struct contig_migrate_work {
+	struct work_struct	work;
+	unsigned long		start;
+	unsigned long		end;
+	atomic_t		*abort;		/* first error of any chunk */
+};
+
+static void contig_migrate_fn(struct work_struct *work)
+{
+	struct contig_migrate_work *w =
+		container_of(work, struct contig_migrate_work, work);
+
+	__alloc_contig_migrate_range(w->start, w->end, w->abort);
+}
+
+/*
+ * Split a large range into pageblock aligned chunks, one per online cpu,
+ * and migrate them concurrently. The caller takes the first chunk itself
+ * so that a fatal signal still ends the whole allocation.
+ */
+static int alloc_contig_migrate_parallel(unsigned long start,
+					 unsigned long end)
+{
+	struct contig_migrate_work *works;
+	unsigned long chunk, pfn;
+	atomic_t abort = ATOMIC_INIT(0);
+	int nr, i;
+
+	nr = min_t(unsigned long, num_online_cpus(),
+		   (end - start) / (CONTIG_PARALLEL_BLOCKS * pageblock_nr_pages));
+	if (nr < 2)
+		return __alloc_contig_migrate_range(start, end, &abort);
+
+	works = kcalloc(nr, sizeof(*works), GFP_KERNEL);
+	if (!works)
+		return __alloc_contig_migrate_range(start, end, &abort);
+
+	chunk = ALIGN(DIV_ROUND_UP(end - start, nr), pageblock_nr_pages);
+	for (i = 0, pfn = start; i < nr && pfn < end; i++, pfn += chunk) {
+		works[i].start = pfn;
+		works[i].end = min(pfn + chunk, end);
+		works[i].abort = &abort;
+		INIT_WORK(&works[i].work, contig_migrate_fn);
+		if (i)
+			queue_work(system_unbound_wq, &works[i].work);
+	}
+	nr = i;
+
+	__alloc_contig_migrate_range(works[0].start, works[0].end, &abort);
+	for (i = 1; i < nr; i++)
+		flush_work(&works[i].work);
+
+	kfree(works);
+	/* the first failure, not the chunks that gave up because of it */
+	return atomic_read(&abort);
+}
+
+/* first page in [start, end) still in use, a hint for the next attempt */
+static unsigned long contig_busy_pfn(unsigned long start, unsigned long end)
+{
+	unsigned long pfn = start;
+	struct page *page;
+	unsigned int order;
+
+	while (pfn < end) {
+		if (!pfn_valid_within(pfn)) {
+			pfn++;
+			continue;
+		}
+		page = pfn_to_page(pfn);
+		if (PageBuddy(page)) {
+			order = page_order(page);
+			pfn += 1UL << min(order, MAX_ORDER - 1U);
+		} else if (page_count(page) == 0) {
+			pfn++;
+		} else {
+			return pfn;
+		}
+	}
+	return start;
+}
+
 /*
  * Update zone's cma pages counter used for watermark level calculation.
  */
@@ -6250,8 +6466,12 @@ static int __reclaim_pages(struct zone *zone, gfp_t gfp_mask, int count)
 	 */
 	__update_cma_watermarks(zone, count);
 
-	/* Obey watermarks as if the page was being allocated */
-	while (!zone_watermark_ok(zone, 0, low_wmark_pages(zone), 0, 0)
+	/*
+	 * Obey watermarks as if the page was being allocated. The reclaim
+	 * below boosts them on every stall, so test against the unboosted
+	 * watermark or the target keeps moving away.
+	 */
+	while (!zone_watermark_ok(zone, 0, zone->watermark[WMARK_LOW], 0, 0)
 			&& retry++ < 16) {
 		wake_all_kswapd(order, zonelist, high_zoneidx, zone_idx(zone));
 
@@ -6270,13 +6490,16 @@ static int __reclaim_pages(struct zone *zone, gfp_t gfp_mask, int count)
 }
 
 /**
- * alloc_contig_range() -- tries to allocate given range of pages
+ * __alloc_contig_range() -- tries to allocate given range of pages
  * @start:	start PFN to allocate
  * @end:	one-past-the-last PFN to allocate
  * @migratetype:	migratetype of the underlaying pageblocks (either
  *			#MIGRATE_MOVABLE or #MIGRATE_CMA).  All pageblocks
  *			in range must have the same migratetype and it must
  *			be either of the two.
+ * @fast:	give up on the first busy page instead of waiting for it,
+ *		for callers that have other ranges to try
+ * @busy_pfn:	if not NULL, set to a page still in use on -EBUSY
  *
  * The PFN range does not have to be pageblock or MAX_ORDER_NR_PAGES
  * aligned, however it's the caller's responsibility to guarantee that
@@ -6289,12 +6512,13 @@ static int __reclaim_pages(struct zone *zone, gfp_t gfp_mask, int count)
  * pages which PFN is in [start, end) are allocated for the caller and
  * need to be freed with free_contig_range().
  */
-int alloc_contig_range(unsigned long start, unsigned long end,
-		       unsigned migratetype)
+int __alloc_contig_range(unsigned long start, unsigned long end,
+			 unsigned migratetype, bool fast,
+			 unsigned long *busy_pfn)
 {
 	struct zone *zone = page_zone(pfn_to_page(start));
 	unsigned long outer_start, outer_end;
-	int ret = 0, order, retry = 0;
+	int ret = 0, order, retry = fast ? 5 : 0;
 
 	/*
 	 * What we do here is we mark all pageblocks in range as
@@ -6328,13 +6552,19 @@ int alloc_contig_range(unsigned long start, unsigned long end,
 		goto done;
 	}
 
+	/*
+	 * Empty the per-cpu page and lru lists once up front, so that the
+	 * free pages in range are in the buddy lists and the others on the
+	 * lru, where the isolation scanner can find them.
+	 */
 	drain_all_pages();
+	migrate_prep();
 	zone->cma_alloc = 1;
 
 migrate:
 	printk(KERN_DEBUG "migrating range %lx %lx, retry (%d)\n",
 				start, end, retry);
-	ret = __alloc_contig_migrate_range(start, end);
+	ret = alloc_contig_migrate_parallel(start, end);
 	if (ret) {
 		printk(KERN_ERR "__alloc_contig_migrate_range failed\n");
 		goto done;
@@ -6411,15 +6641,25 @@ done:
 		cf = zone_page_state(zone, NR_FREE_PAGES);
 		printk(KERN_ERR "%s[%d] free %lu, cma count %lu\n",
 					 __func__, __LINE__, cf, count);
+		migrate_prep();
 		goto migrate;
 	}
 
+	if (busy_pfn && (ret == -EBUSY || ret == -EAGAIN))
+		*busy_pfn = contig_busy_pfn(start, end);
+
 	undo_isolate_page_range(pfn_max_align_down(start),
 				pfn_max_align_up(end), migratetype);
 	zone->cma_alloc = 0;
 	return ret;
 }
 
+int alloc_contig_range(unsigned long start, unsigned long end,
+		       unsigned migratetype)
+{
+	return __alloc_contig_range(start, end, migratetype, false, NULL);
+}
+
 void free_contig_range(unsigned long pfn, unsigned nr_pages)
 {
 	for (; nr_pages--; ++pfn)
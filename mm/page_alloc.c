@@ -724,6 +724,92 @@ static void free_one_page(struct zone *zone, struct page *page, int order,
 	spin_unlock(&zone->lock);
 }
 
+/*
+ * Kernel stacks, pgds and network buffers come and go in blocks of order 1
+ * to 3. A few such blocks are kept on per cpu lists so that they rarely
+ * need the zone lock; they are drained together with the order-0 lists,
+ * under memory pressure and when a cpu goes away. Blocks of the CMA,
+ * isolated and reserve pageblocks always go back to the buddy lists.
+ */
+static inline int pcp_high_limit(int order)
+{
+	return PCP_HIGH_BLOCKS >> (order - 1);
+}
+
+static inline bool pcp_has_high(struct per_cpu_pages *pcp)
+{
+	int i;
+
+	for (i = 0; i < PCP_HIGH_ORDERS; i++)
+		if (pcp->high_count[i])
+			return true;
+	return false;
+}
+
+/* Must be called with interrupts disabled */
+static bool free_pcp_high(struct zone *zone, struct page *page, int order,
+			  int migratetype)
+{
+	struct per_cpu_pages *pcp;
+
+	if (!order || order > PCP_HIGH_ORDERS ||
+	    migratetype >= MIGRATE_PCPTYPES)
+		return false;
+
+	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	if (pcp->high_count[order - 1] >= pcp_high_limit(order))
+		return false;
+
+	set_page_private(page, migratetype);
+	list_add(&page->lru, &pcp->high_lists[order - 1]);
+	pcp->high_count[order - 1]++;
+	return true;
+}
+
+/* Must be called with interrupts disabled */
+static struct page *rmqueue_pcp_high(struct zone *zone, int order,
+				     int migratetype)
+{
+	struct per_cpu_pages *pcp;
+	struct page *page;
+
+	if (order > PCP_HIGH_ORDERS)
+		return NULL;
+
+	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	list_for_each_entry(page, &pcp->high_lists[order - 1], lru) {
+		if (page_private(page) != migratetype)
+			continue;
+		list_del(&page->lru);
+		pcp->high_count[order - 1]--;
+		return page;
+	}
+	return NULL;
+}
+
+/* Must be called with interrupts disabled */
+static void drain_pcp_high(struct zone *zone, struct per_cpu_pages *pcp)
+{
+	struct page *page, *next;
+	int i, order;
+
+	spin_lock(&zone->lock);
+	zone->all_unreclaimable = 0;
+	zone->pages_scanned = 0;
+	for (i = 0; i < PCP_HIGH_ORDERS; i++) {
+		order = i + 1;
+		list_for_each_entry_safe(page, next, &pcp->high_lists[i], lru) {
+			list_del(&page->lru);
+			/* the pageblock may have been isolated meanwhile */
+			__free_one_page(page, zone, order,
+					get_pageblock_migratetype(page));
+			__mod_zone_page_state(zone, NR_FREE_PAGES, 1 << order);
+		}
+		pcp->high_count[i] = 0;
+	}
+	spin_unlock(&zone->lock);
+}
+
 static bool free_pages_prepare(struct page *page, unsigned int order)
 {
 	int i;
@@ -754,16 +840,19 @@ static void __free_pages_ok(struct page *page, unsigned int order)
 {
 	unsigned long flags;
 	int wasMlocked = __TestClearPageMlocked(page);
+	struct zone *zone = page_zone(page);
+	int migratetype;
 
 	if (!free_pages_prepare(page, order))
 		return;
 
+	migratetype = get_pageblock_migratetype(page);
 	local_irq_save(flags);
 	if (unlikely(wasMlocked))
 		free_page_mlock(page);
 	__count_vm_events(PGFREE, 1 << order);
-	free_one_page(page_zone(page), page, order,
-					get_pageblock_migratetype(page));
+	if (!free_pcp_high(zone, page, order, migratetype))
+		free_one_page(zone, page, order, migratetype);
 	local_irq_restore(flags);
 }
 
@@ -1025,6 +1114,16 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 					struct page, lru);
 			area->nr_free--;
 
+			/*
+			 * The pageblock ends up holding pages of more than one
+			 * type: boost the watermarks so kswapd frees whole
+			 * blocks before the next fallback has to mix another.
+			 */
+			if (current_order < pageblock_order &&
+			    !is_migrate_cma(migratetype) &&
+			    boost_watermark(zone))
+				__count_vm_event(WATERMARK_BOOST_FRAG);
+
 			/*
 			 * If breaking a large block of pages, move all free
 			 * pages to the preferred allocation list. If falling
@@ -1185,6 +1284,8 @@ static void drain_pages(unsigned int cpu)
 			free_pcppages_bulk(zone, pcp->count, pcp);
 			pcp->count = 0;
 		}
+		if (pcp_has_high(pcp))
+			drain_pcp_high(zone, pcp);
 		local_irq_restore(flags);
 	}
 }
@@ -1228,7 +1329,7 @@ void drain_all_pages(void)
 		bool has_pcps = false;
 		for_each_populated_zone(zone) {
 			pcp = per_cpu_ptr(zone->pageset, cpu);
-			if (pcp->pcp.count) {
+			if (pcp->pcp.count || pcp_has_high(&pcp->pcp)) {
 				has_pcps = true;
 				break;
 			}
@@ -1466,18 +1567,26 @@ again:
 			 */
 			WARN_ON_ONCE(order > 1);
 		}
-		spin_lock_irqsave(&zone->lock, flags);
-		page = __rmqueue(zone, order, migratetype);
-		spin_unlock(&zone->lock);
-		if (!page)
-			goto failed;
-		__mod_zone_page_state(zone, NR_FREE_PAGES, -(1 << order));
+		local_irq_save(flags);
+		page = rmqueue_pcp_high(zone, order, migratetype);
+		if (!page) {
+			spin_lock(&zone->lock);
+			page = __rmqueue(zone, order, migratetype);
+			spin_unlock(&zone->lock);
+			if (!page)
+				goto failed;
+			__mod_zone_page_state(zone, NR_FREE_PAGES,
+					      -(1 << order));
+		}
 	}
 
 	__count_zone_vm_events(PGALLOC, zone, 1 << order);
 	zone_statistics(preferred_zone, zone, gfp_flags);
 	local_irq_restore(flags);
 
+	if (unlikely(zone_test_and_clear_flag(zone, ZONE_BOOSTED_WATERMARK)))
+		wakeup_kswapd(zone, 0, zone_idx(zone));
+
 	VM_BUG_ON(bad_range(zone, page));
 	if (prep_new_page(page, order, gfp_flags))
 		goto again;
@@ -3886,7 +3995,7 @@ static int zone_batchsize(struct zone *zone)
 static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
 {
 	struct per_cpu_pages *pcp;
-	int migratetype;
+	int migratetype, order;
 
 	memset(p, 0, sizeof(*p));
 
@@ -3896,6 +4005,8 @@ static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
 	pcp->batch = max(1UL, 1 * batch);
 	for (migratetype = 0; migratetype < MIGRATE_PCPTYPES; migratetype++)
 		INIT_LIST_HEAD(&pcp->lists[migratetype]);
+	for (order = 0; order < PCP_HIGH_ORDERS; order++)
+		INIT_LIST_HEAD(&pcp->high_lists[order]);
 }
 
 /*
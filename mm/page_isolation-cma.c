@@ -105,8 +105,6 @@ __test_page_isolated_in_pageblock(unsigned long pfn, unsigned long end_pfn)
 		else if (page_count(page) == 0 &&
 				page_private(page) == MIGRATE_ISOLATE) {
 			pfn += 1;
-			printk(KERN_INFO "%s:%d ", __func__, __LINE__);
-			dump_page(page);
 		} else {
 			printk(KERN_INFO "%s:%d ", __func__, __LINE__);
 			dump_page(page);
@@ -26,6 +26,7 @@ void
 file_ra_state_init(struct file_ra_state *ra, struct address_space *mapping)
 {
 	ra->ra_pages = mapping->backing_dev_info->ra_pages;
+	ra->ra_window = ra->ra_pages;
 	ra->prev_pos = -1;
 }
 EXPORT_SYMBOL_GPL(file_ra_state_init);
@@ -259,6 +260,54 @@ unsigned long ra_submit(struct file_ra_state *ra,
 	return actual;
 }
 
+/*
+ * Adaptive per-file window.
+ *
+ * Reaching the PG_readahead marker of the last window is a hit and doubles
+ * the window, up to ra_pages. A cache miss away from the expected position
+ * while that marker is still set means the reader moved on without using
+ * the window; that is a miss and halves the window, down to
+ * VM_MIN_READAHEAD. Random readers such as apk and dex mappings thus settle
+ * on small windows instead of filling the page cache with pages nobody
+ * reads, while streams keep the full ra_pages.
+ */
+#define RA_MIN_WINDOW	(VM_MIN_READAHEAD * 1024 / PAGE_CACHE_SIZE)
+
+unsigned long ra_window(struct file_ra_state *ra)
+{
+	if (!ra->ra_window || ra->ra_window > ra->ra_pages)
+		return ra->ra_pages;
+
+	return ra->ra_window;
+}
+
+static void ra_window_hit(struct file_ra_state *ra)
+{
+	ra->ra_window = min_t(unsigned int, ra_window(ra) * 2, ra->ra_pages);
+}
+
+void ra_window_miss(struct address_space *mapping, struct file_ra_state *ra)
+{
+	struct page *page;
+	bool unused;
+
+	if (!ra->size || !ra->async_size)
+		return;
+
+	page = find_get_page(mapping, ra->start + ra->size - ra->async_size);
+	if (!page)
+		return;
+
+	/* same bit is used for PG_readahead and PG_reclaim */
+	unused = PageReadahead(page) && !PageWriteback(page);
+	page_cache_release(page);
+
+	if (unused)
+		ra->ra_window = max_t(unsigned int, ra_window(ra) / 2,
+				      min_t(unsigned int, RA_MIN_WINDOW,
+					    ra->ra_pages));
+}
+
 /*
  * Set the initial window size, round to next power of 2 and square
  * for small size, x 4 for medium, and x 2 for large
@@ -398,7 +447,15 @@ ondemand_readahead(struct address_space *mapping,
 		   bool hit_readahead_marker, pgoff_t offset,
 		   unsigned long req_size)
 {
-	unsigned long max = max_sane_readahead(ra->ra_pages);
+	unsigned long max;
+
+	if (hit_readahead_marker)
+		ra_window_hit(ra);
+	else if (offset && offset != ra->start + ra->size &&
+		 offset != ra->start + ra->size - ra->async_size)
+		ra_window_miss(mapping, ra);
+
+	max = max_sane_readahead(ra_window(ra));
 
 	/*
 	 * start of file
@@ -30,6 +30,7 @@
 #include <linux/fault-inject.h>
 #include <linux/stacktrace.h>
 #include <linux/prefetch.h>
+#include <linux/debugfs.h>
 
 #include <trace/events/kmem.h>
 
@@ -231,6 +232,10 @@ static inline void stat(const struct kmem_cache *s, enum stat_item si)
 #ifdef CONFIG_SLUB_STATS
 	__this_cpu_inc(s->cpu_slab->stat[si]);
 #endif
+#ifdef CONFIG_SLUB_PROFILE
+	if (si < NR_SLUB_PROF_ITEMS)
+		__this_cpu_inc(s->cpu_slab->prof[si]);
+#endif
 }
 
 /********************************************************************
@@ -3078,6 +3083,9 @@ static int kmem_cache_open(struct kmem_cache *s,
 		s->cpu_partial = 13;
 	else
 		s->cpu_partial = 30;
+#ifdef CONFIG_SLUB_PROFILE
+	s->cpu_partial_base = s->cpu_partial;
+#endif
 
 	s->refcount = 1;
 #ifdef CONFIG_NUMA
@@ -4690,6 +4698,10 @@ static ssize_t cpu_partial_store(struct kmem_cache *s, const char *buf,
 		return -EINVAL;
 
 	s->cpu_partial = objects;
+#ifdef CONFIG_SLUB_PROFILE
+	/* autotuning starts over from what was asked for */
+	s->cpu_partial_base = objects;
+#endif
 	flush_all(s);
 	return length;
 }
@@ -5513,3 +5525,141 @@ static int __init slab_proc_init(void)
 }
 module_init(slab_proc_init);
 #endif /* CONFIG_SLABINFO */
+
+#ifdef CONFIG_SLUB_PROFILE
+/*
+ * Sample the per cpu fast and slow path counts of every cache. A busy cache
+ * whose slow paths take more than SLUB_TUNE_HOT percent of its operations
+ * gets its cpu_partial doubled, up to SLUB_TUNE_MAX times the default or
+ * SLUB_TUNE_MAX_BYTES worth of objects per cpu; once they drop below
+ * SLUB_TUNE_COLD percent it shrinks back by a quarter per sample.
+ */
+#define SLUB_PROFILE_INTERVAL	(4 * HZ)
+#define SLUB_TUNE_MIN_RATE	1000	/* operations per second */
+#define SLUB_TUNE_HOT		10
+#define SLUB_TUNE_COLD		2
+#define SLUB_TUNE_MAX		8
+#define SLUB_TUNE_MAX_BYTES	(64 * 1024)
+
+static u32 slub_autotune = 1;
+static unsigned long slub_profile_stamp;
+static void slub_profile_fn(struct work_struct *work);
+static DECLARE_DEFERRED_WORK(slub_profile_work, slub_profile_fn);
+
+static void slub_profile_sample(struct kmem_cache *s, unsigned long elapsed)
+{
+	unsigned long sum, delta;
+	int cpu, i;
+
+	for (i = 0; i < NR_SLUB_PROF_ITEMS; i++) {
+		sum = 0;
+		for_each_possible_cpu(cpu)
+			sum += per_cpu_ptr(s->cpu_slab, cpu)->prof[i];
+		delta = sum - s->prof_last[i];
+		s->prof_last[i] = sum;
+		s->prof_rate[i] = delta * HZ / elapsed;
+	}
+}
+
+static void slub_autotune_cache(struct kmem_cache *s)
+{
+	unsigned long ops, slow;
+	int limit, partial = s->cpu_partial;
+
+	if (kmem_cache_debug(s) || !s->cpu_partial_base)
+		return;
+
+	ops = s->prof_rate[ALLOC_FASTPATH] + s->prof_rate[ALLOC_SLOWPATH] +
+	      s->prof_rate[FREE_FASTPATH] + s->prof_rate[FREE_SLOWPATH];
+	slow = s->prof_rate[ALLOC_SLOWPATH] + s->prof_rate[FREE_SLOWPATH];
+
+	limit = min(s->cpu_partial_base * SLUB_TUNE_MAX,
+		    SLUB_TUNE_MAX_BYTES / s->size);
+	limit = max(limit, s->cpu_partial_base);
+
+	if (ops >= SLUB_TUNE_MIN_RATE && slow * 100 > ops * SLUB_TUNE_HOT)
+		partial = min(partial * 2, limit);
+	else if (slow * 100 < ops * SLUB_TUNE_COLD || ops < SLUB_TUNE_MIN_RATE)
+		partial = max(partial - partial / 4, s->cpu_partial_base);
+
+	/* the per cpu lists drain themselves down to a lower limit */
+	s->cpu_partial = partial;
+}
+
+static void slub_profile_fn(struct work_struct *work)
+{
+	unsigned long elapsed = max(jiffies - slub_profile_stamp, 1UL);
+	struct kmem_cache *s;
+
+	slub_profile_stamp = jiffies;
+
+	down_read(&slub_lock);
+	list_for_each_entry(s, &slab_caches, list) {
+		slub_profile_sample(s, elapsed);
+		if (slub_autotune)
+			slub_autotune_cache(s);
+	}
+	up_read(&slub_lock);
+
+	queue_delayed_work(system_power_efficient_wq, &slub_profile_work,
+			   SLUB_PROFILE_INTERVAL);
+}
+
+static int slub_profile_show(struct seq_file *m, void *unused)
+{
+	struct kmem_cache *s;
+
+	seq_printf(m, "%-24s %6s %9s %9s %9s %9s %7s\n", "name", "size",
+		   "alloc/s", "slow/s", "free/s", "slow/s", "partial");
+
+	down_read(&slub_lock);
+	list_for_each_entry(s, &slab_caches, list) {
+		unsigned long *r = s->prof_rate;
+
+		if (!r[ALLOC_FASTPATH] && !r[ALLOC_SLOWPATH] &&
+		    !r[FREE_FASTPATH] && !r[FREE_SLOWPATH])
+			continue;
+		seq_printf(m, "%-24s %6d %9lu %9lu %9lu %9lu %3d/%-3d\n",
+			   s->name, s->objsize,
+			   r[ALLOC_FASTPATH] + r[ALLOC_SLOWPATH],
+			   r[ALLOC_SLOWPATH],
+			   r[FREE_FASTPATH] + r[FREE_SLOWPATH],
+			   r[FREE_SLOWPATH], s->cpu_partial,
+			   s->cpu_partial_base);
+	}
+	up_read(&slub_lock);
+
+	return 0;
+}
+
+static int slub_profile_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, slub_profile_show, NULL);
+}
+
+static const struct file_operations slub_profile_fops = {
+	.open		= slub_profile_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init slub_profile_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("slub_profile", NULL);
+	if (dir) {
+		debugfs_create_file("caches", S_IRUSR, dir, NULL,
+				    &slub_profile_fops);
+		debugfs_create_bool("autotune", S_IRUSR | S_IWUSR, dir,
+				    &slub_autotune);
+	}
+
+	slub_profile_stamp = jiffies;
+	queue_delayed_work(system_power_efficient_wq, &slub_profile_work,
+			   SLUB_PROFILE_INTERVAL);
+	return 0;
+}
+late_initcall(slub_profile_init);
+#endif /* CONFIG_SLUB_PROFILE */
@@ -17,9 +17,16 @@
 #include <linux/pagevec.h>
 #include <linux/migrate.h>
 #include <linux/page_cgroup.h>
+#include <linux/log2.h>
 
 #include <asm/pgtable.h>
 
+/*
+ * Swap-in readahead that turned out useful since the last window was sized.
+ * Starts out as some hits so that the first faults do read ahead.
+ */
+static atomic_t swapin_readahead_hits = ATOMIC_INIT(4);
+
 /*
  * swapper_space is a fiction, retained to simplify the path through
  * vmscan's shrink_page_list.
@@ -264,8 +271,14 @@ struct page * lookup_swap_cache(swp_entry_t entry)
 
 	page = find_get_page(&swapper_space, entry.val);
 
-	if (page)
+	if (page) {
 		INC_CACHE_INFO(find_success);
+		/* PG_reclaim means reclaim for a page under writeback */
+		if (!PageWriteback(page) && TestClearPageReadahead(page)) {
+			atomic_inc(&swapin_readahead_hits);
+			count_vm_event(SWAP_RA_HIT);
+		}
+	}
 
 	INC_CACHE_INFO(find_total);
 	return page;
@@ -410,3 +423,126 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	lru_add_drain();	/* Push any new pages onto the LRU now */
 	return read_swap_cache_async(entry, gfp_mask, vma, addr);
 }
+
+/*
+ * VMA based swap readahead.
+ *
+ * Where seeks are free, as on zram, the slots next to the faulting one
+ * hold whatever was reclaimed around the same time rather than what the
+ * task will touch next, and reading them in only wastes decompression and
+ * memory. The neighbouring ptes of the faulting address know better: the
+ * swap entries found there are read in instead, from a window that grows
+ * while the pages read ahead get faulted on and shrinks, by half at most
+ * per fault, when they are not. A fault right next to the previous one in
+ * the vma reads ahead in that direction, any other around the fault.
+ */
+int sysctl_swap_vma_readahead = 1;
+
+#define SWAP_RA_WIN_MAX		32	/* ptes looked at per fault */
+
+static unsigned int swapin_vma_window(struct vm_area_struct *vma,
+				      unsigned long faddr,
+				      unsigned long *prev_addr)
+{
+	unsigned long info = vma->swap_ra_info;
+	unsigned int prev_win = info & ~PAGE_MASK;
+	unsigned int max_win, hits, win;
+
+	max_win = min(1U << page_cluster, (unsigned int)SWAP_RA_WIN_MAX);
+	*prev_addr = info & PAGE_MASK;
+
+	hits = atomic_xchg(&swapin_readahead_hits, 0);
+	win = hits + 2;
+	if (hits == 0) {
+		/* nothing to judge by, read ahead only for a sequential fault */
+		if (faddr != *prev_addr + PAGE_SIZE &&
+		    faddr != *prev_addr - PAGE_SIZE)
+			win = 1;
+	} else
+		win = roundup_pow_of_two(max(win, 4U));
+
+	win = min(win, max_win);
+	win = max(win, min(prev_win / 2, max_win));
+
+	vma->swap_ra_info = faddr | win;
+	return win;
+}
+
+/**
+ * swapin_vma_readahead - swap in a page and its neighbours in the vma
+ * @entry: swap entry of this memory
+ * @gfp_mask: memory allocation flags
+ * @vma: user vma this address belongs to
+ * @addr: faulting address
+ * @pmd: pmd mapping @addr
+ *
+ * Returns the struct page for entry and addr, after queueing swapin.
+ * Falls back to swapin_readahead() unless the swap device is solid state.
+ *
+ * Caller must hold down_read on the vma->vm_mm.
+ */
+struct page *swapin_vma_readahead(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			pmd_t *pmd)
+{
+	unsigned long faddr = addr & PAGE_MASK;
+	unsigned long prev_addr, start, end, lo, hi;
+	unsigned int win, before, i, nr;
+	pte_t ptes[SWAP_RA_WIN_MAX], *pte;
+	struct page *page;
+	swp_entry_t swap;
+
+	if (!sysctl_swap_vma_readahead || !swap_entry_solidstate(entry))
+		return swapin_readahead(entry, gfp_mask, vma, addr);
+
+	win = swapin_vma_window(vma, faddr, &prev_addr);
+	if (win <= 1)
+		goto out;
+
+	if (faddr == prev_addr + PAGE_SIZE)
+		before = 0;
+	else if (faddr == prev_addr - PAGE_SIZE)
+		before = win - 1;
+	else
+		before = win / 2;
+
+	/* stay within the vma and the page table of the fault */
+	lo = max(vma->vm_start, faddr & PMD_MASK);
+	hi = min(vma->vm_end, (faddr & PMD_MASK) + PMD_SIZE);
+	before = min_t(unsigned long, before, (faddr - lo) >> PAGE_SHIFT);
+	start = faddr - ((unsigned long)before << PAGE_SHIFT);
+	end = min(start + ((unsigned long)win << PAGE_SHIFT), hi);
+	nr = (end - start) >> PAGE_SHIFT;
+
+	/* a stale copy only costs a useless read */
+	pte = pte_offset_map(pmd, start);
+	for (i = 0; i < nr; i++)
+		ptes[i] = pte[i];
+	pte_unmap(pte);
+
+	for (i = 0, addr = start; i < nr; i++, addr += PAGE_SIZE) {
+		if (addr == faddr)
+			continue;
+		if (!is_swap_pte(ptes[i]))
+			continue;
+		swap = pte_to_swp_entry(ptes[i]);
+		if (unlikely(non_swap_entry(swap)))
+			continue;
+
+		page = find_get_page(&swapper_space, swap.val);
+		if (page) {
+			page_cache_release(page);
+			continue;
+		}
+
+		page = read_swap_cache_async(swap, gfp_mask, vma, addr);
+		if (!page)
+			continue;
+		SetPageReadahead(page);
+		count_vm_event(SWAP_RA);
+		page_cache_release(page);
+	}
+	lru_add_drain();	/* Push any new pages onto the LRU now */
+out:
+	return read_swap_cache_async(entry, gfp_mask, vma, faddr);
+}
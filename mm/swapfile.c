@@ -2330,6 +2330,17 @@ int swapcache_prepare(swp_entry_t entry)
 	return __swap_duplicate(entry, SWAP_HAS_CACHE);
 }
 
+/*
+ * Seeks are cheap on the device of @entry (flash, zram): neighbouring slots
+ * gain nothing from being read together.
+ */
+bool swap_entry_solidstate(swp_entry_t entry)
+{
+	struct swap_info_struct *si = swap_info[swp_type(entry)];
+
+	return si && (si->flags & SWP_SOLIDSTATE);
+}
+
 struct swap_info_struct *page_swap_info(struct page *page)
 {
 	swp_entry_t swap = { .val = page_private(page) };
@@ -22,6 +22,7 @@
 #include <linux/swap.h>
 #include <linux/printk.h>
 #include <linux/slab.h>
+#include <linux/notifier.h>
 #include <linux/vmpressure.h>
 
 /*
@@ -113,8 +114,8 @@ static enum vmpressure_levels vmpressure_level(unsigned long pressure)
 	return VMPRESSURE_LOW;
 }
 
-static enum vmpressure_levels vmpressure_calc_level(unsigned long scanned,
-						    unsigned long reclaimed)
+static unsigned long vmpressure_calc_pressure(unsigned long scanned,
+					      unsigned long reclaimed)
 {
 	unsigned long scale = scanned + reclaimed;
 	unsigned long pressure;
@@ -132,7 +133,30 @@ static enum vmpressure_levels vmpressure_calc_level(unsigned long scanned,
 	pr_debug("%s: %3lu  (s: %lu  r: %lu)\n", __func__, pressure,
 		 scanned, reclaimed);
 
-	return vmpressure_level(pressure);
+	return pressure;
+}
+
+static enum vmpressure_levels vmpressure_calc_level(unsigned long scanned,
+						    unsigned long reclaimed)
+{
+	return vmpressure_level(vmpressure_calc_pressure(scanned, reclaimed));
+}
+
+/*
+ * In-kernel consumers of the system wide (root cgroup) pressure, such as
+ * the Android low memory killer. They are called from the vmpressure work
+ * with the pressure in percent as the notifier value.
+ */
+static BLOCKING_NOTIFIER_HEAD(vmpressure_notifier);
+
+int vmpressure_notifier_register(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_register(&vmpressure_notifier, nb);
+}
+
+int vmpressure_notifier_unregister(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_unregister(&vmpressure_notifier, nb);
 }
 
 struct vmpressure_event {
@@ -188,6 +212,11 @@ static void vmpressure_work_fn(struct work_struct *work)
 	vmpr->reclaimed = 0;
 	mutex_unlock(&vmpr->sr_lock);
 
+	if (vmpr == memcg_to_vmpressure(NULL))
+		blocking_notifier_call_chain(&vmpressure_notifier,
+				vmpressure_calc_pressure(scanned, reclaimed),
+				NULL);
+
 	do {
 		if (vmpressure_event(vmpr, scanned, reclaimed))
 			break;
@@ -44,6 +44,8 @@
 #include <linux/oom.h>
 #include <linux/prefetch.h>
 #include <linux/debugfs.h>
+#include <linux/hotpin.h>
+#include <linux/workingset.h>
 
 #include <asm/tlbflush.h>
 #include <asm/div64.h>
@@ -163,6 +165,12 @@ extern int get_soft_reclaim_status(void);
 int vm_swappiness = 100;
 long vm_total_pages;	/* The total number of pages which the VM controls */
 
+/*
+ * How far the low and high watermarks may be boosted, in 1/10000ths of the
+ * high watermark. 0 disables boosting.
+ */
+int watermark_boost_factor __read_mostly = 15000;
+
 static LIST_HEAD(shrinker_list);
 static DECLARE_RWSEM(shrinker_rwsem);
 
@@ -635,6 +643,7 @@ static int __remove_mapping(struct address_space *mapping, struct page *page)
 
 		freepage = mapping->a_ops->freepage;
 
+		workingset_eviction(mapping, page);
 		__delete_from_page_cache(page);
 		spin_unlock_irq(&mapping->tree_lock);
 		mem_cgroup_uncharge_cache_page(page);
@@ -814,7 +823,8 @@ static enum page_references page_check_references(struct page *page,
 }
 
 /*
- * shrink_page_list() returns the number of reclaimed pages
+ * shrink_page_list() returns the number of reclaimed pages. A NULL @mz means
+ * the pages come from any zone and are reclaimed regardless of references.
  */
 static unsigned long shrink_page_list(struct list_head *page_list,
 				      struct mem_cgroup_zone *mz,
@@ -830,6 +840,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 	unsigned long nr_congested = 0;
 	unsigned long nr_reclaimed = 0;
 	unsigned long nr_writeback = 0;
+	enum ttu_flags ttu = mz ? TTU_UNMAP : TTU_UNMAP | TTU_IGNORE_ACCESS;
 
 	cond_resched();
 
@@ -848,7 +859,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			goto keep;
 
 		VM_BUG_ON(PageActive(page));
-		VM_BUG_ON(page_zone(page) != mz->zone);
+		VM_BUG_ON(mz && page_zone(page) != mz->zone);
 
 		sc->nr_scanned++;
 
@@ -882,7 +893,14 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			}
 		}
 
-		references = page_check_references(page, mz, sc);
+		/* no zone means the caller picked the pages itself */
+		if (mz)
+			references = page_check_references(page, mz, sc);
+		else
+			references = PAGEREF_RECLAIM;
+		if (references != PAGEREF_ACTIVATE &&
+		    hotpin_page_protected(page, priority))
+			references = PAGEREF_ACTIVATE;
 		switch (references) {
 		case PAGEREF_ACTIVATE:
 			goto activate_locked;
@@ -912,7 +930,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 		 * processes. Try to unmap it here.
 		 */
 		if (page_mapped(page) && mapping) {
-			switch (try_to_unmap(page, TTU_UNMAP)) {
+			switch (try_to_unmap(page, ttu)) {
 			case SWAP_FAIL:
 				goto activate_locked;
 			case SWAP_AGAIN:
@@ -1073,7 +1091,7 @@ keep_lumpy:
 	 * back off and wait for congestion to clear because further reclaim
 	 * will encounter the same problem
 	 */
-	if (nr_dirty && nr_dirty == nr_congested && global_reclaim(sc))
+	if (mz && nr_dirty && nr_dirty == nr_congested && global_reclaim(sc))
 		zone_set_flag(mz->zone, ZONE_CONGESTED);
 
 	free_hot_cold_page_list(&free_pages, 1);
@@ -1085,6 +1103,44 @@ keep_lumpy:
 	return nr_reclaimed;
 }
 
+#ifdef CONFIG_PROCESS_RECLAIM
+/*
+ * Reclaim pages the caller isolated from the LRU and accounted as isolated,
+ * for /proc/<pid>/reclaim. The caller chose them because the process is not
+ * expected to touch them soon, so references are ignored. Whatever cannot be
+ * reclaimed goes back to the LRU.
+ */
+unsigned long reclaim_pages_from_list(struct list_head *page_list)
+{
+	struct scan_control sc = {
+		.gfp_mask = GFP_KERNEL,
+		.may_writepage = 1,
+		.may_unmap = 1,
+		.may_swap = 1,
+		.reclaim_mode = RECLAIM_MODE_SINGLE | RECLAIM_MODE_ASYNC,
+	};
+	unsigned long nr_reclaimed, nr_dirty = 0, nr_writeback = 0;
+	struct page *page;
+
+	list_for_each_entry(page, page_list, lru) {
+		dec_zone_page_state(page, NR_ISOLATED_ANON +
+				    page_is_file_cache(page));
+		ClearPageActive(page);
+	}
+
+	nr_reclaimed = shrink_page_list(page_list, NULL, &sc, DEF_PRIORITY,
+					&nr_dirty, &nr_writeback);
+
+	while (!list_empty(page_list)) {
+		page = lru_to_page(page_list);
+		list_del(&page->lru);
+		putback_lru_page(page);
+	}
+
+	return nr_reclaimed;
+}
+#endif
+
 /*
  * Attempt to remove the specified page from its LRU.  Only take this page
  * if it is of the appropriate PageActive status.  Pages which are being
@@ -2513,10 +2569,75 @@ out:
 	return 0;
 }
 
+/*
+ * Raise the zone's watermarks by a pageblock so that kswapd wakes earlier
+ * and reclaims ahead of the next burst of allocations instead of leaving it
+ * to direct reclaim. Called with zone->lock held, the caller kicks kswapd
+ * once the lock is dropped.
+ */
+bool boost_watermark(struct zone *zone)
+{
+	unsigned long max_boost;
+
+	if (!watermark_boost_factor)
+		return false;
+
+	max_boost = mult_frac(zone->watermark[WMARK_HIGH],
+			      watermark_boost_factor, 10000);
+	if (zone->watermark_boost >= max_boost)
+		return false;
+
+	zone->watermark_boost = min(zone->watermark_boost + pageblock_nr_pages,
+				    max_boost);
+	zone_set_flag(zone, ZONE_BOOSTED_WATERMARK);
+	return true;
+}
+
+/* an allocation just stalled in direct reclaim, get kswapd ahead of it */
+static void boost_watermark_stall(struct zonelist *zonelist, gfp_t gfp_mask,
+				  nodemask_t *nodemask)
+{
+	struct zone *zone;
+	unsigned long flags;
+	bool boosted;
+
+	first_zones_zonelist(zonelist, gfp_zone(gfp_mask), nodemask, &zone);
+	if (!zone)
+		return;
+
+	spin_lock_irqsave(&zone->lock, flags);
+	boosted = boost_watermark(zone);
+	spin_unlock_irqrestore(&zone->lock, flags);
+
+	if (boosted)
+		count_vm_event(WATERMARK_BOOST_STALL);
+	if (zone_test_and_clear_flag(zone, ZONE_BOOSTED_WATERMARK))
+		wakeup_kswapd(zone, 0, zone_idx(zone));
+}
+
+/* each kswapd pass halves whatever boost is left */
+static void decay_watermark_boost(pg_data_t *pgdat)
+{
+	struct zone *zone;
+	unsigned long flags;
+	int i;
+
+	for (i = 0; i < pgdat->nr_zones; i++) {
+		zone = pgdat->node_zones + i;
+		if (!zone->watermark_boost)
+			continue;
+
+		spin_lock_irqsave(&zone->lock, flags);
+		zone->watermark_boost >>= 1;
+		spin_unlock_irqrestore(&zone->lock, flags);
+	}
+}
+
 unsigned long try_to_free_pages(struct zonelist *zonelist, int order,
 				gfp_t gfp_mask, nodemask_t *nodemask)
 {
 	unsigned long nr_reclaimed;
+	u64 start;
 	struct scan_control sc = {
 		.gfp_mask = (gfp_mask = memalloc_noio_flags(gfp_mask)),
 		.may_writepage = !laptop_mode,
@@ -2539,10 +2660,15 @@ unsigned long try_to_free_pages(struct zonelist *zonelist, int order,
 				sc.may_writepage,
 				gfp_mask);
 
+	start = local_clock();
 	nr_reclaimed = do_try_to_free_pages(zonelist, &sc, &shrink);
+	count_vm_events(ALLOCSTALL_US,
+			div_u64(local_clock() - start, NSEC_PER_USEC));
 
 	trace_mm_vmscan_direct_reclaim_end(nr_reclaimed);
 
+	boost_watermark_stall(zonelist, gfp_mask, nodemask);
+
 	return nr_reclaimed;
 }
 
@@ -3231,6 +3357,7 @@ static int kswapd(void *p)
 			balanced_classzone_idx = classzone_idx;
 			balanced_order = balance_pgdat(pgdat, order,
 						&balanced_classzone_idx);
+			decay_watermark_boost(pgdat);
 		}
 	}
 
@@ -766,6 +766,9 @@ const char * const vmstat_text[] = {
 	"allocstall",
 
 	"pgrotated",
+	"allocstall_us",
+	"watermark_boost_stall",
+	"watermark_boost_frag",
 
 #ifdef CONFIG_COMPACTION
 	"compact_blocks_moved",
@@ -789,6 +792,24 @@ const char * const vmstat_text[] = {
 	"unevictable_pgs_stranded",
 	"unevictable_pgs_mlockfreed",
 
+#ifdef CONFIG_SWAP
+	"swap_ra",
+	"swap_ra_hit",
+#endif
+
+#ifdef CONFIG_WORKINGSET_REFAULT
+	"workingset_refault",
+	"workingset_activate",
+#endif
+
+#ifdef CONFIG_FILE_HOTPIN
+	"hotpin_protected",
+	"hotpin_released",
+#endif
+
+	"vmacache_find_calls",
+	"vmacache_find_hits",
+
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 	"thp_fault_alloc",
 	"thp_fault_fallback",
@@ -984,6 +1005,7 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 		   "\n        min      %lu"
 		   "\n        low      %lu"
 		   "\n        high     %lu"
+		   "\n        boost    %lu"
 		   "\n        scanned  %lu"
 		   "\n        spanned  %lu"
 		   "\n        present  %lu",
@@ -991,6 +1013,7 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 		   min_wmark_pages(zone),
 		   low_wmark_pages(zone),
 		   high_wmark_pages(zone),
+		   zone->watermark_boost,
 		   zone->pages_scanned,
 		   zone->spanned_pages,
 		   zone->present_pages);
@@ -0,0 +1,143 @@
+/*
+ * mm/workingset.c
+ *
+ * Page cache refault detection.
+ *
+ * Every page evicted from the inactive file list and every page
+ * promoted to the active list advances workingset_age, so the distance
+ * between the age recorded when a page was evicted and the age when it
+ * is read back in is the number of inactive list slots the page would
+ * have needed to still be resident. When that distance is no larger
+ * than the active file list, the page could have stayed cached had the
+ * active list made room for it; it is part of the working set and is
+ * put straight on the active list, where it competes with the pages
+ * that pushed it out. Those activations count as rotated file pages, so
+ * get_scan_count() turns the pressure towards anon (zram) instead of
+ * evicting file pages that are needed again at once.
+ *
+ * The eviction ages live in a set-associative table hashed by mapping
+ * and index rather than in the page cache radix tree: the lookup
+ * functions and shmem already give exceptional entries a meaning of
+ * their own. The table is sized from memory, a full set recycles its
+ * oldest entry, and a stale or colliding entry only costs a misplaced
+ * activation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/fs.h>
+#include <linux/init.h>
+#include <linux/jhash.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/vmstat.h>
+#include <linux/workingset.h>
+
+#define SHADOW_WAYS	8
+
+struct shadow_entry {
+	u32 key;	/* 0 when the slot is free */
+	u32 age;
+};
+
+static atomic_long_t workingset_age = ATOMIC_LONG_INIT(0);
+
+static struct shadow_entry *shadow_table __read_mostly;
+static unsigned long shadow_mask __read_mostly;
+
+static struct shadow_entry *shadow_bucket(struct address_space *mapping,
+					  pgoff_t index, u32 *key)
+{
+	u32 a = (u32)(unsigned long)mapping;
+	u32 b = (u32)index;
+
+	*key = jhash_2words(a, b, 1) | 1;
+	return shadow_table +
+		(jhash_2words(a, b, 0) & shadow_mask) * SHADOW_WAYS;
+}
+
+void workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct shadow_entry *set, *victim;
+	u32 key, age, oldest = 0;
+	int i;
+
+	if (!shadow_table)
+		return;
+
+	age = (u32)atomic_long_inc_return(&workingset_age);
+	set = shadow_bucket(mapping, page->index, &key);
+
+	/* racing updates of a set only lose an entry */
+	victim = set;
+	for (i = 0; i < SHADOW_WAYS; i++) {
+		if (!set[i].key) {
+			victim = &set[i];
+			break;
+		}
+		if (age - set[i].age > oldest) {
+			oldest = age - set[i].age;
+			victim = &set[i];
+		}
+	}
+	victim->age = age;
+	victim->key = key;
+}
+
+bool workingset_refault(struct address_space *mapping, pgoff_t index)
+{
+	struct shadow_entry *set;
+	u32 key, distance;
+	int i;
+
+	if (!shadow_table)
+		return false;
+
+	set = shadow_bucket(mapping, index, &key);
+	for (i = 0; i < SHADOW_WAYS; i++) {
+		if (ACCESS_ONCE(set[i].key) != key)
+			continue;
+
+		distance = (u32)atomic_long_read(&workingset_age) -
+			   ACCESS_ONCE(set[i].age);
+		set[i].key = 0;
+
+		count_vm_event(WORKINGSET_REFAULT);
+		if (distance > global_page_state(NR_ACTIVE_FILE))
+			return false;
+
+		count_vm_event(WORKINGSET_ACTIVATE);
+		return true;
+	}
+	return false;
+}
+
+void workingset_activation(struct page *page)
+{
+	atomic_long_inc(&workingset_age);
+}
+
+static int __init workingset_init(void)
+{
+	struct shadow_entry *table;
+	unsigned long nr_sets;
+
+	/* one entry for every four pages of memory */
+	nr_sets = roundup_pow_of_two(max(totalram_pages / 4 / SHADOW_WAYS,
+					 1UL));
+	table = vzalloc(nr_sets * SHADOW_WAYS * sizeof(struct shadow_entry));
+	if (!table) {
+		pr_warn("workingset: no memory for %lu shadow sets\n", nr_sets);
+		return -ENOMEM;
+	}
+
+	shadow_mask = nr_sets - 1;
+	smp_wmb();
+	shadow_table = table;
+
+	return 0;
+}
+module_init(workingset_init);
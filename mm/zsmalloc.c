@@ -33,13 +33,20 @@
  * is returned (see zs_malloc).
  *
  * Additionally, zs_malloc() does not return a dereferenceable pointer.
- * Instead, it returns an opaque handle (unsigned long) which encodes actual
- * location of the allocated object. The reason for this indirection is that
- * zsmalloc does not keep zspages permanently mapped since that would cause
- * issues on 32-bit systems where the VA region for kernel space mappings
- * is very small. So, before using the allocating memory, the object has to
- * be mapped using zs_map_object() to get a usable pointer and subsequently
- * unmapped using zs_unmap_object().
+ * Instead, it returns an opaque handle (unsigned long) which refers to a
+ * small slab-allocated slot holding the actual location of the allocated
+ * object. The reason for this indirection is that zsmalloc does not keep
+ * zspages permanently mapped since that would cause issues on 32-bit
+ * systems where the VA region for kernel space mappings is very small. So,
+ * before using the allocating memory, the object has to be mapped using
+ * zs_map_object() to get a usable pointer and subsequently unmapped using
+ * zs_unmap_object(). Because users only ever see the handle, objects can
+ * be migrated between zspages of the same class (see zs_compact()).
+ *
+ * Each allocated object starts with a ZS_HANDLE_SIZE header recording its
+ * handle (a back-reference) with OBJ_ALLOCATED_TAG set, which is how
+ * compaction finds live objects. Huge classes (one object per single page
+ * zspage) have no room for the header and keep it in first_page->private.
  *
  * Following is how we use various fields and flags of underlying
  * struct page(s) to form a zspage.
@@ -56,7 +63,8 @@
  *	For _first_ page only:
  *
  *	page->private (union with page->first_page): refers to the
- *		component page after the first page
+ *		component page after the first page. For huge classes this
+ *		holds the handle of the only object instead.
  *	page->freelist: points to the first free object in zspage.
  *		Free objects are linked together using in-place
  *		metadata.
@@ -79,6 +87,7 @@
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <linux/bitops.h>
+#include <linux/bit_spinlock.h>
 #include <linux/errno.h>
 #include <linux/highmem.h>
 #include <linux/init.h>
@@ -92,6 +101,10 @@
 #include <linux/hardirq.h>
 #include <linux/spinlock.h>
 #include <linux/types.h>
+#include <linux/shrinker.h>
+#include <linux/percpu.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/zsmalloc.h>
 
 /*
@@ -109,9 +122,12 @@
 #define ZS_MAX_ZSPAGE_ORDER 2
 #define ZS_MAX_PAGES_PER_ZSPAGE (_AC(1, UL) << ZS_MAX_ZSPAGE_ORDER)
 
+#define ZS_HANDLE_SIZE (sizeof(unsigned long))
+
 /*
  * Object location (<PFN>, <obj_idx>) is encoded as
- * as single (unsigned long) handle value.
+ * as single (unsigned long) obj value, which is stored in the slot
+ * a handle points to.
  *
  * Note that object index <obj_idx> is relative to system
  * page <PFN> it is stored in, so for each sub-page belonging
@@ -132,7 +148,24 @@
 #endif
 #endif
 #define _PFN_BITS		(MAX_PHYSMEM_BITS - PAGE_SHIFT)
-#define OBJ_INDEX_BITS	(BITS_PER_LONG - _PFN_BITS)
+
+/*
+ * Memory for allocating a handle keeps the object position by encoding
+ * <page, obj_idx>, and the encoded value has room in its least
+ * significant bit (ie, look at location_to_obj). We use that bit to
+ * synchronize between object access by the user and migration.
+ */
+#define HANDLE_PIN_BIT	0
+
+/*
+ * Head in allocated object should have OBJ_ALLOCATED_TAG to identify
+ * the object was allocated or not. It's okay to add the status bit in
+ * the least bit because the header keeps a handle, which is a 4/8-byte
+ * aligned address, so we have at least one free bit there.
+ */
+#define OBJ_ALLOCATED_TAG 1
+#define OBJ_TAG_BITS	1
+#define OBJ_INDEX_BITS	(BITS_PER_LONG - _PFN_BITS - OBJ_TAG_BITS)
 #define OBJ_INDEX_MASK	((_AC(1, UL) << OBJ_INDEX_BITS) - 1)
 
 #define MAX(a, b) ((a) >= (b) ? (a) : (b))
@@ -186,6 +219,30 @@ enum fullness_group {
  */
 static const int fullness_threshold_frac = 4;
 
+/*
+ * Classes holding typical compressed pages (roughly a quarter to half a
+ * page) are hammered by every cpu during swap storms. Each of them gets
+ * a per-cpu magazine of handles that were freed, or allocated ahead of
+ * time. The objects behind the handles stay allocated and keep their
+ * header, so compaction may still move them.
+ */
+#define ZS_MAG_SIZE		16
+#define ZS_MAG_BATCH		(ZS_MAG_SIZE / 2)
+#define ZS_MAG_MIN_CLASS_SIZE	(PAGE_SIZE / 4)
+#define ZS_MAG_MAX_CLASS_SIZE	(PAGE_SIZE / 2 + ZS_SIZE_CLASS_DELTA)
+
+struct zs_magazine {
+	spinlock_t lock;
+	int count;
+	unsigned long handle[ZS_MAG_SIZE];
+
+	/* protected by lock, summed up for debugfs */
+	unsigned long alloc_hit;	/* zs_malloc() served from here */
+	unsigned long alloc_miss;	/* zs_malloc() found it empty */
+	unsigned long free_hit;	/* zs_free() stashed the handle here */
+	unsigned long free_miss;	/* zs_free() had to drain first */
+};
+
 struct size_class {
 	/*
 	 * Size of objects stored in this class. Must be multiple
@@ -196,10 +253,19 @@ struct size_class {
 
 	/* Number of PAGE_SIZE sized pages to combine to form a 'zspage' */
 	int pages_per_zspage;
+	/* huge object: pages_per_zspage == 1 && maxobj_per_zspage == 1 */
+	bool huge;
 
 	spinlock_t lock;
 
+	/* objects in zspages of this class, and of those, in use */
+	unsigned long obj_allocated;
+	unsigned long obj_used;
+
 	struct page *fullness_list[_ZS_NR_FULLNESS_GROUPS];
+
+	/* per-cpu handle cache, NULL unless the class is a hot one */
+	struct zs_magazine __percpu *mag;
 };
 
 /*
@@ -209,15 +275,35 @@ struct size_class {
  * This must be power of 2 and less than or equal to ZS_ALIGN
  */
 struct link_free {
-	/* Handle of next free chunk (encodes <PFN, obj_idx>) */
-	void *next;
+	union {
+		/*
+		 * Position of next free chunk (encodes <PFN, obj_idx>)
+		 * It's valid for non-allocated object
+		 */
+		void *next;
+		/*
+		 * Handle of allocated object.
+		 */
+		unsigned long handle;
+	};
 };
 
 struct zs_pool {
 	struct size_class *size_class[ZS_SIZE_CLASSES];
+	struct kmem_cache *handle_cachep;
 
 	gfp_t flags;	/* allocation flags used when growing pool */
 	atomic_long_t pages_allocated;
+	/* zspage pages freed by compaction */
+	atomic_long_t pages_compacted;
+
+	/* compact classes in the background when the VM asks for memory */
+	struct shrinker shrinker;
+	bool shrinker_enabled;
+
+#ifdef CONFIG_ZSMALLOC_STAT
+	struct dentry *stat_dentry;
+#endif
 };
 
 /*
@@ -252,6 +338,42 @@ static int is_last_page(struct page *page)
 	return PagePrivate2(page);
 }
 
+static unsigned long alloc_handle(struct zs_pool *pool)
+{
+	return (unsigned long)kmem_cache_alloc(pool->handle_cachep,
+		pool->flags & ~__GFP_HIGHMEM);
+}
+
+static void free_handle(struct zs_pool *pool, unsigned long handle)
+{
+	kmem_cache_free(pool->handle_cachep, (void *)handle);
+}
+
+static void record_obj(unsigned long handle, unsigned long obj)
+{
+	*(unsigned long *)handle = obj;
+}
+
+static unsigned long handle_to_obj(unsigned long handle)
+{
+	return *(unsigned long *)handle;
+}
+
+static int trypin_tag(unsigned long handle)
+{
+	return bit_spin_trylock(HANDLE_PIN_BIT, (unsigned long *)handle);
+}
+
+static void pin_tag(unsigned long handle)
+{
+	bit_spin_lock(HANDLE_PIN_BIT, (unsigned long *)handle);
+}
+
+static void unpin_tag(unsigned long handle)
+{
+	bit_spin_unlock(HANDLE_PIN_BIT, (unsigned long *)handle);
+}
+
 static void get_zspage_mapping(struct page *page, unsigned int *class_idx,
 				enum fullness_group *fullness)
 {
@@ -289,14 +411,15 @@ static int get_size_class_index(int size)
 		idx = DIV_ROUND_UP(size - ZS_MIN_ALLOC_SIZE,
 				ZS_SIZE_CLASS_DELTA);
 
-	return idx;
+	/* PAGE_SIZE objects plus their header land in the last class */
+	return min_t(int, ZS_SIZE_CLASSES - 1, idx);
 }
 
 /*
  * For each size class, zspages are divided into different groups
  * depending on how "full" they are. This was done so that we could
  * easily find empty or nearly empty zspages when we try to shrink
- * the pool (not yet implemented). This function returns fullness
+ * the pool (see zs_compact()). This function returns fullness
  * status of the given page.
  */
 static enum fullness_group get_fullness_group(struct page *page)
@@ -463,36 +586,49 @@ static struct page *get_next_page(struct page *page)
 }
 
 /*
- * Encode <page, obj_idx> as a single handle value.
+ * Encode <page, obj_idx> as a single obj value.
  * On hardware platforms with physical memory starting at 0x0 the pfn
- * could be 0 so we ensure that the handle will never be 0 by adjusting the
- * encoded obj_idx value before encoding.
+ * could be 0 so we ensure that the obj will never be 0 by adjusting the
+ * encoded obj_idx value before encoding. The low OBJ_TAG_BITS are left
+ * clear for HANDLE_PIN_BIT.
  */
-static void *obj_location_to_handle(struct page *page, unsigned long obj_idx)
+static void *location_to_obj(struct page *page, unsigned long obj_idx)
 {
-	unsigned long handle;
+	unsigned long obj;
 
 	if (!page) {
 		BUG_ON(obj_idx);
 		return NULL;
 	}
 
-	handle = page_to_pfn(page) << OBJ_INDEX_BITS;
-	handle |= ((obj_idx + 1) & OBJ_INDEX_MASK);
+	obj = page_to_pfn(page) << OBJ_INDEX_BITS;
+	obj |= ((obj_idx + 1) & OBJ_INDEX_MASK);
+	obj <<= OBJ_TAG_BITS;
 
-	return (void *)handle;
+	return (void *)obj;
 }
 
 /*
- * Decode <page, obj_idx> pair from the given object handle. We adjust the
+ * Decode <page, obj_idx> pair from the given obj value. We adjust the
  * decoded obj_idx back to its original value since it was adjusted in
- * obj_location_to_handle().
+ * location_to_obj().
  */
-static void obj_handle_to_location(unsigned long handle, struct page **page,
+static void obj_to_location(unsigned long obj, struct page **page,
 				unsigned long *obj_idx)
 {
-	*page = pfn_to_page(handle >> OBJ_INDEX_BITS);
-	*obj_idx = (handle & OBJ_INDEX_MASK) - 1;
+	obj >>= OBJ_TAG_BITS;
+	*page = pfn_to_page(obj >> OBJ_INDEX_BITS);
+	*obj_idx = (obj & OBJ_INDEX_MASK) - 1;
+}
+
+static unsigned long obj_to_head(struct size_class *class, struct page *page,
+			void *obj)
+{
+	if (class->huge) {
+		VM_BUG_ON(!is_first_page(page));
+		return page_private(page);
+	} else
+		return *(unsigned long *)obj;
 }
 
 static unsigned long obj_idx_to_offset(struct page *page,
@@ -567,7 +703,7 @@ static void init_zspage(struct page *first_page, struct size_class *class)
 		link = (struct link_free *)vaddr + off / sizeof(*link);
 
 		while ((off += class->size) < PAGE_SIZE) {
-			link->next = obj_location_to_handle(page, i++);
+			link->next = location_to_obj(page, i++);
 			link += class->size / sizeof(*link);
 		}
 
@@ -577,7 +713,7 @@ static void init_zspage(struct page *first_page, struct size_class *class)
 		 * page (if present)
 		 */
 		next_page = get_next_page(page);
-		link->next = obj_location_to_handle(next_page, 0);
+		link->next = location_to_obj(next_page, 0);
 		kunmap_atomic(vaddr);
 		page = next_page;
 		off %= PAGE_SIZE;
@@ -631,7 +767,7 @@ static struct page *alloc_zspage(struct size_class *class, gfp_t flags)
 
 	init_zspage(first_page, class);
 
-	first_page->freelist = obj_location_to_handle(first_page, 0);
+	first_page->freelist = location_to_obj(first_page, 0);
 	/* Maximum number of objects we can store in this zspage */
 	first_page->objects = class->pages_per_zspage * PAGE_SIZE / class->size;
 
@@ -760,6 +896,11 @@ static void __zs_unmap_object(struct mapping_area *area,
 	if (area->vm_mm == ZS_MM_RO)
 		goto out;
 
+	/* the handle header was never handed out, don't overwrite it */
+	buf = buf + ZS_HANDLE_SIZE;
+	size -= ZS_HANDLE_SIZE;
+	off += ZS_HANDLE_SIZE;
+
 	sizes[0] = PAGE_SIZE - off;
 	sizes[1] = size - sizes[0];
 
@@ -778,6 +919,99 @@ out:
 
 #endif /* CONFIG_PGTABLE_MAPPING */
 
+#ifdef CONFIG_ZSMALLOC_STAT
+static struct dentry *zs_stat_root;
+static atomic_t zs_pool_id = ATOMIC_INIT(0);
+
+static int zs_stats_mag_show(struct seq_file *s, void *v)
+{
+	struct zs_pool *pool = s->private;
+	struct size_class *class;
+	int i, cpu;
+
+	seq_printf(s, " %5s %5s %10s %10s %10s %10s %8s\n", "class",
+			"size", "alloc_hit", "alloc_miss", "free_hit",
+			"free_miss", "hit_rate");
+
+	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
+		unsigned long alloc_hit = 0, alloc_miss = 0;
+		unsigned long free_hit = 0, free_miss = 0;
+		unsigned long total;
+
+		class = pool->size_class[i];
+		if (!class || class->index != i || !class->mag)
+			continue;
+
+		/* racy, but these are only statistics */
+		for_each_possible_cpu(cpu) {
+			struct zs_magazine *mag = per_cpu_ptr(class->mag, cpu);
+
+			alloc_hit += mag->alloc_hit;
+			alloc_miss += mag->alloc_miss;
+			free_hit += mag->free_hit;
+			free_miss += mag->free_miss;
+		}
+
+		total = alloc_hit + alloc_miss + free_hit + free_miss;
+		seq_printf(s, " %5u %5d %10lu %10lu %10lu %10lu %7lu%%\n",
+			i, class->size, alloc_hit, alloc_miss, free_hit,
+			free_miss,
+			total ? (alloc_hit + free_hit) * 100 / total : 0);
+	}
+
+	return 0;
+}
+
+static int zs_stats_mag_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, zs_stats_mag_show, inode->i_private);
+}
+
+static const struct file_operations zs_stat_mag_ops = {
+	.open		= zs_stats_mag_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void zs_stat_init(void)
+{
+	zs_stat_root = debugfs_create_dir("zsmalloc", NULL);
+	if (!zs_stat_root)
+		pr_warn("debugfs 'zsmalloc' stat dir creation failed\n");
+}
+
+static void zs_stat_exit(void)
+{
+	debugfs_remove_recursive(zs_stat_root);
+}
+
+static void zs_pool_stat_create(struct zs_pool *pool)
+{
+	char name[16];
+
+	if (!zs_stat_root)
+		return;
+
+	snprintf(name, sizeof(name), "pool-%d",
+		atomic_inc_return(&zs_pool_id));
+	pool->stat_dentry = debugfs_create_file(name, S_IRUGO, zs_stat_root,
+					pool, &zs_stat_mag_ops);
+	if (!pool->stat_dentry)
+		pr_warn("%s stat file creation failed\n", name);
+}
+
+static void zs_pool_stat_destroy(struct zs_pool *pool)
+{
+	debugfs_remove(pool->stat_dentry);
+}
+#else
+static inline void zs_stat_init(void) { }
+static inline void zs_stat_exit(void) { }
+static inline void zs_pool_stat_create(struct zs_pool *pool) { }
+static inline void zs_pool_stat_destroy(struct zs_pool *pool) { }
+#endif
+
 static int zs_cpu_notifier(struct notifier_block *nb, unsigned long action,
 				void *pcpu)
 {
@@ -812,12 +1046,14 @@ static void zs_exit(void)
 	for_each_online_cpu(cpu)
 		zs_cpu_notifier(NULL, CPU_DEAD, (void *)(long)cpu);
 	unregister_cpu_notifier(&zs_cpu_nb);
+	zs_stat_exit();
 }
 
 static int zs_init(void)
 {
 	int cpu, ret;
 
+	zs_stat_init();
 	register_cpu_notifier(&zs_cpu_nb);
 	for_each_online_cpu(cpu) {
 		ret = zs_cpu_notifier(NULL, CPU_UP_PREPARE, (void *)(long)cpu);
@@ -847,6 +1083,648 @@ static bool can_merge(struct size_class *prev, int size, int pages_per_zspage)
 	return true;
 }
 
+static bool zspage_full(struct page *page)
+{
+	BUG_ON(!is_first_page(page));
+
+	return page->inuse == page->objects;
+}
+
+static unsigned long obj_malloc(struct page *first_page,
+		struct size_class *class, unsigned long handle)
+{
+	unsigned long obj;
+	struct link_free *link;
+
+	struct page *m_page;
+	unsigned long m_objidx, m_offset;
+	void *vaddr;
+
+	obj = (unsigned long)first_page->freelist;
+	obj_to_location(obj, &m_page, &m_objidx);
+	m_offset = obj_idx_to_offset(m_page, m_objidx, class->size);
+
+	vaddr = kmap_atomic(m_page);
+	link = (struct link_free *)vaddr + m_offset / sizeof(*link);
+	first_page->freelist = link->next;
+	if (!class->huge)
+		/* record handle in the header of allocated chunk */
+		link->handle = handle | OBJ_ALLOCATED_TAG;
+	else
+		/* record handle in first_page->private */
+		set_page_private(first_page, handle | OBJ_ALLOCATED_TAG);
+	kunmap_atomic(vaddr);
+	first_page->inuse++;
+	class->obj_used++;
+
+	return obj;
+}
+
+static void obj_free(struct size_class *class, unsigned long obj)
+{
+	struct link_free *link;
+	struct page *first_page, *f_page;
+	unsigned long f_objidx, f_offset;
+	void *vaddr;
+
+	obj &= ~OBJ_ALLOCATED_TAG;
+	obj_to_location(obj, &f_page, &f_objidx);
+	first_page = get_first_page(f_page);
+	f_offset = obj_idx_to_offset(f_page, f_objidx, class->size);
+
+	/* Insert this object in containing zspage's freelist */
+	vaddr = kmap_atomic(f_page);
+	link = (struct link_free *)(vaddr + f_offset);
+	link->next = first_page->freelist;
+	if (class->huge)
+		set_page_private(first_page, 0);
+	kunmap_atomic(vaddr);
+	first_page->freelist = (void *)obj;
+	first_page->inuse--;
+	class->obj_used--;
+}
+
+static void __zs_free(struct zs_pool *pool, unsigned long handle)
+{
+	struct page *first_page, *f_page;
+	unsigned long obj, f_objidx;
+	int class_idx;
+	struct size_class *class;
+	enum fullness_group fullness;
+
+	/* the object can't be migrated under us while it is pinned */
+	pin_tag(handle);
+	obj = handle_to_obj(handle);
+	obj_to_location(obj, &f_page, &f_objidx);
+	first_page = get_first_page(f_page);
+
+	get_zspage_mapping(first_page, &class_idx, &fullness);
+	class = pool->size_class[class_idx];
+
+	spin_lock(&class->lock);
+	obj_free(class, obj);
+	fullness = fix_fullness_group(pool, first_page);
+	if (fullness == ZS_EMPTY)
+		class->obj_allocated -= get_maxobj_per_zspage(class->size,
+						class->pages_per_zspage);
+	spin_unlock(&class->lock);
+	unpin_tag(handle);
+
+	if (fullness == ZS_EMPTY) {
+		atomic_long_sub(class->pages_per_zspage,
+				&pool->pages_allocated);
+		free_zspage(first_page);
+	}
+
+	free_handle(pool, handle);
+}
+
+static unsigned long zs_mag_pop(struct size_class *class)
+{
+	struct zs_magazine *mag = get_cpu_ptr(class->mag);
+	unsigned long handle = 0;
+
+	spin_lock(&mag->lock);
+	if (mag->count) {
+		handle = mag->handle[--mag->count];
+		mag->alloc_hit++;
+	} else {
+		mag->alloc_miss++;
+	}
+	spin_unlock(&mag->lock);
+	put_cpu_ptr(class->mag);
+
+	return handle;
+}
+
+/*
+ * Stash @nr handles in this cpu's magazine. If it is full, the oldest
+ * batch is moved out to @spill, and the count of those is returned.
+ */
+static int zs_mag_push(struct size_class *class, unsigned long *handle,
+			int nr, unsigned long *spill)
+{
+	struct zs_magazine *mag = get_cpu_ptr(class->mag);
+	int i, nr_spill = 0;
+
+	spin_lock(&mag->lock);
+	for (i = 0; i < nr; i++) {
+		if (mag->count == ZS_MAG_SIZE) {
+			memcpy(spill + nr_spill, mag->handle,
+				ZS_MAG_BATCH * sizeof(*spill));
+			memmove(mag->handle, mag->handle + ZS_MAG_BATCH,
+				(ZS_MAG_SIZE - ZS_MAG_BATCH) * sizeof(*spill));
+			mag->count -= ZS_MAG_BATCH;
+			nr_spill += ZS_MAG_BATCH;
+			mag->free_miss++;
+		} else {
+			mag->free_hit++;
+		}
+		mag->handle[mag->count++] = handle[i];
+	}
+	spin_unlock(&mag->lock);
+	put_cpu_ptr(class->mag);
+
+	return nr_spill;
+}
+
+/*
+ * Allocate a batch of objects from zspages the class already has, under
+ * a single acquisition of class->lock, and stash them in the magazine.
+ * Does not grow the class: the caller falls back to the slow path for
+ * that.
+ */
+static void zs_mag_refill(struct zs_pool *pool, struct size_class *class)
+{
+	unsigned long handle[ZS_MAG_BATCH];
+	unsigned long spill[ZS_MAG_BATCH];
+	struct page *first_page;
+	unsigned long obj;
+	int i, nr, nr_spill;
+
+	for (nr = 0; nr < ZS_MAG_BATCH; nr++) {
+		handle[nr] = alloc_handle(pool);
+		if (!handle[nr])
+			break;
+	}
+
+	spin_lock(&class->lock);
+	for (i = 0; i < nr; i++) {
+		first_page = find_get_zspage(class);
+		if (!first_page)
+			break;
+
+		obj = obj_malloc(first_page, class, handle[i]);
+		fix_fullness_group(pool, first_page);
+		record_obj(handle[i], obj);
+	}
+	spin_unlock(&class->lock);
+
+	while (nr > i)
+		free_handle(pool, handle[--nr]);
+
+	/* we might have been migrated to a cpu with a full magazine */
+	nr_spill = zs_mag_push(class, handle, nr, spill);
+	for (i = 0; i < nr_spill; i++)
+		__zs_free(pool, spill[i]);
+}
+
+static bool zs_mag_free(struct zs_pool *pool, unsigned long handle)
+{
+	struct page *f_page;
+	unsigned long obj, f_objidx;
+	int class_idx;
+	enum fullness_group fullness;
+	struct size_class *class;
+	unsigned long spill[ZS_MAG_BATCH];
+	int i, nr_spill;
+
+	/* pin so that compaction can't move the object to another zspage */
+	pin_tag(handle);
+	obj = handle_to_obj(handle);
+	obj_to_location(obj, &f_page, &f_objidx);
+	get_zspage_mapping(get_first_page(f_page), &class_idx, &fullness);
+	unpin_tag(handle);
+
+	class = pool->size_class[class_idx];
+	if (!class->mag)
+		return false;
+
+	nr_spill = zs_mag_push(class, &handle, 1, spill);
+	for (i = 0; i < nr_spill; i++)
+		__zs_free(pool, spill[i]);
+
+	return true;
+}
+
+/* Give every handle cached by @class back to its zspage. */
+static void zs_mag_drain(struct zs_pool *pool, struct size_class *class)
+{
+	unsigned long handle[ZS_MAG_SIZE];
+	int cpu, i, nr;
+
+	if (!class->mag)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct zs_magazine *mag = per_cpu_ptr(class->mag, cpu);
+
+		spin_lock(&mag->lock);
+		nr = mag->count;
+		memcpy(handle, mag->handle, nr * sizeof(*handle));
+		mag->count = 0;
+		spin_unlock(&mag->lock);
+
+		for (i = 0; i < nr; i++)
+			__zs_free(pool, handle[i]);
+	}
+}
+
+static int zs_mag_create(struct size_class *class)
+{
+	int cpu;
+
+	if (class->huge || class->size < ZS_MAG_MIN_CLASS_SIZE ||
+			class->size > ZS_MAG_MAX_CLASS_SIZE)
+		return 0;
+
+	class->mag = alloc_percpu(struct zs_magazine);
+	if (!class->mag)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(class->mag, cpu)->lock);
+
+	return 0;
+}
+
+/*
+ * Copy a whole class->size chunk, header included, from src to dst.
+ * Either object may span two component pages.
+ */
+static void zs_object_copy(unsigned long dst, unsigned long src,
+				struct size_class *class)
+{
+	struct page *s_page, *d_page;
+	unsigned long s_objidx, d_objidx;
+	unsigned long s_off, d_off;
+	void *s_addr, *d_addr;
+	int s_size, d_size, size;
+	int written = 0;
+
+	s_size = d_size = class->size;
+
+	obj_to_location(src, &s_page, &s_objidx);
+	obj_to_location(dst, &d_page, &d_objidx);
+
+	s_off = obj_idx_to_offset(s_page, s_objidx, class->size);
+	d_off = obj_idx_to_offset(d_page, d_objidx, class->size);
+
+	if (s_off + class->size > PAGE_SIZE)
+		s_size = PAGE_SIZE - s_off;
+
+	if (d_off + class->size > PAGE_SIZE)
+		d_size = PAGE_SIZE - d_off;
+
+	s_addr = kmap_atomic(s_page);
+	d_addr = kmap_atomic(d_page);
+
+	while (1) {
+		size = min(s_size, d_size);
+		memcpy(d_addr + d_off, s_addr + s_off, size);
+		written += size;
+
+		if (written == class->size)
+			break;
+
+		s_off += size;
+		s_size -= size;
+		d_off += size;
+		d_size -= size;
+
+		/* kmap_atomic() slots must be released in reverse order */
+		if (s_off >= PAGE_SIZE) {
+			kunmap_atomic(d_addr);
+			kunmap_atomic(s_addr);
+			s_page = get_next_page(s_page);
+			BUG_ON(!s_page);
+			s_addr = kmap_atomic(s_page);
+			d_addr = kmap_atomic(d_page);
+			s_size = class->size - written;
+			s_off = 0;
+		}
+
+		if (d_off >= PAGE_SIZE) {
+			kunmap_atomic(d_addr);
+			d_page = get_next_page(d_page);
+			BUG_ON(!d_page);
+			d_addr = kmap_atomic(d_page);
+			d_size = class->size - written;
+			d_off = 0;
+		}
+	}
+
+	kunmap_atomic(d_addr);
+	kunmap_atomic(s_addr);
+}
+
+/*
+ * Find the first allocated object in @page starting from @index and pin
+ * its handle. Objects currently pinned by their user are skipped.
+ * Returns the pinned handle, or 0 if none is left in this component page.
+ */
+static unsigned long find_alloced_obj(struct page *page, int index,
+					struct size_class *class)
+{
+	unsigned long head;
+	int offset = 0;
+	unsigned long handle = 0;
+	void *addr = kmap_atomic(page);
+
+	if (!is_first_page(page))
+		offset = page->index;
+	offset += class->size * index;
+
+	while (offset < PAGE_SIZE) {
+		head = obj_to_head(class, page, addr + offset);
+		if (head & OBJ_ALLOCATED_TAG) {
+			handle = head & ~OBJ_ALLOCATED_TAG;
+			if (trypin_tag(handle))
+				break;
+			handle = 0;
+		}
+
+		offset += class->size;
+		index++;
+	}
+
+	kunmap_atomic(addr);
+	return handle;
+}
+
+struct zs_compact_control {
+	/* Source page for migration which could be a subpage of zspage. */
+	struct page *s_page;
+	/*
+	 * Destination page for migration which should be a first page
+	 * of zspage.
+	 */
+	struct page *d_page;
+	/* Starting object index within @s_page which used for live object
+	 * in the subpage. */
+	int index;
+	/* how many of objects are migrated */
+	unsigned long nr_migrated;
+};
+
+/*
+ * Move live objects from cc->s_page into cc->d_page until either the
+ * source zspage is drained (returns 0) or the destination is full
+ * (returns -ENOMEM). Called with class->lock held.
+ */
+static int migrate_zspage(struct size_class *class,
+				struct zs_compact_control *cc)
+{
+	unsigned long used_obj, free_obj;
+	unsigned long handle;
+	struct page *s_page = cc->s_page;
+	struct page *d_page = cc->d_page;
+	unsigned long index = cc->index;
+	int nr_migrated = 0;
+	int ret = 0;
+
+	while (1) {
+		handle = find_alloced_obj(s_page, index, class);
+		if (!handle) {
+			s_page = get_next_page(s_page);
+			if (!s_page)
+				break;
+			index = 0;
+			continue;
+		}
+
+		/* Stop if there is no more space */
+		if (zspage_full(d_page)) {
+			unpin_tag(handle);
+			ret = -ENOMEM;
+			break;
+		}
+
+		used_obj = handle_to_obj(handle);
+		free_obj = obj_malloc(d_page, class, handle);
+		zs_object_copy(free_obj, used_obj, class);
+		index++;
+		/*
+		 * record_obj updates handle's value to free_obj and it will
+		 * invalidate lock bit(ie, HANDLE_PIN_BIT) of handle, which
+		 * breaks synchronization using pin_tag(e,g, zs_free) so
+		 * let's keep the lock bit.
+		 */
+		free_obj |= BIT(HANDLE_PIN_BIT);
+		record_obj(handle, free_obj);
+		unpin_tag(handle);
+		obj_free(class, used_obj);
+		nr_migrated++;
+	}
+
+	/* Remember last position in this iteration */
+	cc->s_page = s_page;
+	cc->index = index;
+	cc->nr_migrated += nr_migrated;
+
+	return ret;
+}
+
+static struct page *isolate_target_page(struct size_class *class)
+{
+	int i;
+	struct page *page;
+
+	for (i = 0; i < _ZS_NR_FULLNESS_GROUPS; i++) {
+		page = class->fullness_list[i];
+		if (page) {
+			remove_zspage(page, class, i);
+			break;
+		}
+	}
+
+	return page;
+}
+
+static struct page *isolate_source_page(struct size_class *class)
+{
+	struct page *page;
+
+	page = class->fullness_list[ZS_ALMOST_EMPTY];
+	if (page)
+		remove_zspage(page, class, ZS_ALMOST_EMPTY);
+
+	return page;
+}
+
+/*
+ * Put an isolated zspage back on the list matching its current fullness,
+ * freeing it if compaction has emptied it. Called with class->lock held.
+ */
+static enum fullness_group putback_zspage(struct zs_pool *pool,
+			struct size_class *class, struct page *first_page)
+{
+	enum fullness_group fullness;
+
+	BUG_ON(!is_first_page(first_page));
+
+	fullness = get_fullness_group(first_page);
+	insert_zspage(first_page, class, fullness);
+	set_zspage_mapping(first_page, class->index, fullness);
+
+	if (fullness == ZS_EMPTY) {
+		class->obj_allocated -= get_maxobj_per_zspage(class->size,
+						class->pages_per_zspage);
+		atomic_long_sub(class->pages_per_zspage,
+				&pool->pages_allocated);
+		atomic_long_add(class->pages_per_zspage,
+				&pool->pages_compacted);
+		free_zspage(first_page);
+	}
+
+	return fullness;
+}
+
+/*
+ * Number of zspage pages that could be freed if the live objects of this
+ * class were packed as densely as possible.
+ */
+static unsigned long zs_can_compact(struct size_class *class)
+{
+	unsigned long obj_wasted;
+
+	obj_wasted = class->obj_allocated - class->obj_used;
+	obj_wasted /= get_maxobj_per_zspage(class->size,
+			class->pages_per_zspage);
+
+	return obj_wasted * class->pages_per_zspage;
+}
+
+static unsigned long __zs_compact(struct zs_pool *pool,
+				struct size_class *class)
+{
+	struct zs_compact_control cc;
+	struct page *src_page;
+	struct page *dst_page = NULL;
+
+	cc.nr_migrated = 0;
+	spin_lock(&class->lock);
+	while ((src_page = isolate_source_page(class))) {
+
+		BUG_ON(!is_first_page(src_page));
+
+		if (!zs_can_compact(class))
+			break;
+
+		cc.index = 0;
+		cc.s_page = src_page;
+
+		while ((dst_page = isolate_target_page(class))) {
+			cc.d_page = dst_page;
+			/*
+			 * If there is no more space in dst_page, resched
+			 * and see if anyone had allocated another zspage.
+			 */
+			if (!migrate_zspage(class, &cc))
+				break;
+
+			putback_zspage(pool, class, dst_page);
+		}
+
+		/* Stop if we couldn't find slot */
+		if (dst_page == NULL)
+			break;
+
+		putback_zspage(pool, class, dst_page);
+		putback_zspage(pool, class, src_page);
+		spin_unlock(&class->lock);
+		cond_resched();
+		spin_lock(&class->lock);
+	}
+
+	if (src_page)
+		putback_zspage(pool, class, src_page);
+
+	spin_unlock(&class->lock);
+
+	return cc.nr_migrated;
+}
+
+/**
+ * zs_compact - migrate objects out of sparsely used zspages
+ * @pool: pool to compact
+ *
+ * Moves live objects from ZS_ALMOST_EMPTY zspages into the fuller
+ * zspages of the same class so that the emptied zspages can be freed.
+ * Objects mapped at the time are skipped. May sleep.
+ *
+ * Returns the number of objects migrated.
+ */
+unsigned long zs_compact(struct zs_pool *pool)
+{
+	int i;
+	unsigned long nr_migrated = 0;
+	struct size_class *class;
+
+	for (i = ZS_SIZE_CLASSES - 1; i >= 0; i--) {
+		class = pool->size_class[i];
+		if (!class)
+			continue;
+		if (class->index != i)
+			continue;
+		/* cached handles would pin otherwise empty zspages */
+		zs_mag_drain(pool, class);
+		nr_migrated += __zs_compact(pool, class);
+	}
+
+	return nr_migrated;
+}
+EXPORT_SYMBOL_GPL(zs_compact);
+
+unsigned long zs_get_compacted_pages(struct zs_pool *pool)
+{
+	return atomic_long_read(&pool->pages_compacted);
+}
+EXPORT_SYMBOL_GPL(zs_get_compacted_pages);
+
+static unsigned long zs_pool_compactable(struct zs_pool *pool)
+{
+	int i;
+	unsigned long pages = 0;
+	struct size_class *class;
+
+	for (i = ZS_SIZE_CLASSES - 1; i >= 0; i--) {
+		class = pool->size_class[i];
+		if (!class)
+			continue;
+		if (class->index != i)
+			continue;
+		/* racy read, only used as a reclaim hint */
+		pages += zs_can_compact(class);
+	}
+
+	return pages;
+}
+
+/*
+ * Background compaction: when the VM is reclaiming, compact the pool and
+ * report the number of pages still reclaimable by doing so.
+ */
+static int zs_shrinker_shrink(struct shrinker *shrinker,
+				struct shrink_control *sc)
+{
+	struct zs_pool *pool = container_of(shrinker, struct zs_pool,
+					shrinker);
+
+	if (sc->nr_to_scan)
+		zs_compact(pool);
+
+	return min_t(unsigned long, zs_pool_compactable(pool), INT_MAX);
+}
+
+static void zs_unregister_shrinker(struct zs_pool *pool)
+{
+	if (pool->shrinker_enabled) {
+		unregister_shrinker(&pool->shrinker);
+		pool->shrinker_enabled = false;
+	}
+}
+
+static void zs_register_shrinker(struct zs_pool *pool)
+{
+	pool->shrinker.shrink = zs_shrinker_shrink;
+	pool->shrinker.batch = 0;
+	pool->shrinker.seeks = DEFAULT_SEEKS;
+
+	register_shrinker(&pool->shrinker);
+	pool->shrinker_enabled = true;
+}
+
 /**
  * zs_create_pool - Creates an allocation pool to work from.
  * @flags: allocation flags used to allocate pool metadata
@@ -905,12 +1783,25 @@ struct zs_pool *zs_create_pool(gfp_t flags)
 		class->size = size;
 		class->index = i;
 		class->pages_per_zspage = pages_per_zspage;
+		if (pages_per_zspage == 1 &&
+			get_maxobj_per_zspage(size, pages_per_zspage) == 1)
+			class->huge = true;
 		spin_lock_init(&class->lock);
 		pool->size_class[i] = class;
+		if (zs_mag_create(class))
+			goto err;
 	}
 
+	pool->handle_cachep = kmem_cache_create("zs_handle", ZS_HANDLE_SIZE,
+					0, 0, NULL);
+	if (!pool->handle_cachep)
+		goto err;
+
 	pool->flags = flags;
 
+	zs_register_shrinker(pool);
+	zs_pool_stat_create(pool);
+
 	return pool;
 
 err:
@@ -923,6 +1814,9 @@ void zs_destroy_pool(struct zs_pool *pool)
 {
 	int i;
 
+	zs_pool_stat_destroy(pool);
+	zs_unregister_shrinker(pool);
+
 	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
 		int fg;
 		struct size_class *class = pool->size_class[i];
@@ -933,6 +1827,9 @@ void zs_destroy_pool(struct zs_pool *pool)
 		if (class->index != i)
 			continue;
 
+		zs_mag_drain(pool, class);
+		free_percpu(class->mag);
+
 		for (fg = 0; fg < _ZS_NR_FULLNESS_GROUPS; fg++) {
 			if (class->fullness_list[fg]) {
 				pr_info("Freeing non-empty class with size %db, fullness group %d\n",
@@ -941,6 +1838,9 @@ void zs_destroy_pool(struct zs_pool *pool)
 		}
 		kfree(class);
 	}
+
+	if (pool->handle_cachep)
+		kmem_cache_destroy(pool->handle_cachep);
 	kfree(pool);
 }
 EXPORT_SYMBOL_GPL(zs_destroy_pool);
@@ -956,18 +1856,30 @@ EXPORT_SYMBOL_GPL(zs_destroy_pool);
  */
 unsigned long zs_malloc(struct zs_pool *pool, size_t size)
 {
-	unsigned long obj;
-	struct link_free *link;
+	unsigned long handle, obj;
 	struct size_class *class;
-	void *vaddr;
-
-	struct page *first_page, *m_page;
-	unsigned long m_objidx, m_offset;
+	struct page *first_page;
 
 	if (unlikely(!size || size > ZS_MAX_ALLOC_SIZE))
 		return 0;
 
-	class = pool->size_class[get_size_class_index(size)];
+	/* extra space in chunk to keep the handle */
+	class = pool->size_class[get_size_class_index(size + ZS_HANDLE_SIZE)];
+
+	if (class->mag) {
+		handle = zs_mag_pop(class);
+		if (handle)
+			return handle;
+
+		zs_mag_refill(pool, class);
+		handle = zs_mag_pop(class);
+		if (handle)
+			return handle;
+	}
+
+	handle = alloc_handle(pool);
+	if (!handle)
+		return 0;
 
 	spin_lock(&class->lock);
 	first_page = find_get_zspage(class);
@@ -975,73 +1887,39 @@ unsigned long zs_malloc(struct zs_pool *pool, size_t size)
 	if (!first_page) {
 		spin_unlock(&class->lock);
 		first_page = alloc_zspage(class, pool->flags);
-		if (unlikely(!first_page))
+		if (unlikely(!first_page)) {
+			free_handle(pool, handle);
 			return 0;
+		}
 
 		set_zspage_mapping(first_page, class->index, ZS_EMPTY);
 		atomic_long_add(class->pages_per_zspage,
 					&pool->pages_allocated);
+
 		spin_lock(&class->lock);
+		class->obj_allocated += get_maxobj_per_zspage(class->size,
+						class->pages_per_zspage);
 	}
 
-	obj = (unsigned long)first_page->freelist;
-	obj_handle_to_location(obj, &m_page, &m_objidx);
-	m_offset = obj_idx_to_offset(m_page, m_objidx, class->size);
-
-	vaddr = kmap_atomic(m_page);
-	link = (struct link_free *)vaddr + m_offset / sizeof(*link);
-	first_page->freelist = link->next;
-	memset(link, POISON_INUSE, sizeof(*link));
-	kunmap_atomic(vaddr);
-
-	first_page->inuse++;
+	obj = obj_malloc(first_page, class, handle);
 	/* Now move the zspage to another fullness group, if required */
 	fix_fullness_group(pool, first_page);
+	record_obj(handle, obj);
 	spin_unlock(&class->lock);
 
-	return obj;
+	return handle;
 }
 EXPORT_SYMBOL_GPL(zs_malloc);
 
-void zs_free(struct zs_pool *pool, unsigned long obj)
+void zs_free(struct zs_pool *pool, unsigned long handle)
 {
-	struct link_free *link;
-	struct page *first_page, *f_page;
-	unsigned long f_objidx, f_offset;
-	void *vaddr;
-
-	int class_idx;
-	struct size_class *class;
-	enum fullness_group fullness;
-
-	if (unlikely(!obj))
+	if (unlikely(!handle))
 		return;
 
-	obj_handle_to_location(obj, &f_page, &f_objidx);
-	first_page = get_first_page(f_page);
-
-	get_zspage_mapping(first_page, &class_idx, &fullness);
-	class = pool->size_class[class_idx];
-	f_offset = obj_idx_to_offset(f_page, f_objidx, class->size);
-
-	spin_lock(&class->lock);
-
-	/* Insert this object in containing zspage's freelist */
-	vaddr = kmap_atomic(f_page);
-	link = (struct link_free *)(vaddr + f_offset);
-	link->next = first_page->freelist;
-	kunmap_atomic(vaddr);
-	first_page->freelist = (void *)obj;
-
-	first_page->inuse--;
-	fullness = fix_fullness_group(pool, first_page);
-	spin_unlock(&class->lock);
+	if (zs_mag_free(pool, handle))
+		return;
 
-	if (fullness == ZS_EMPTY) {
-		atomic_long_sub(class->pages_per_zspage,
-				&pool->pages_allocated);
-		free_zspage(first_page);
-	}
+	__zs_free(pool, handle);
 }
 EXPORT_SYMBOL_GPL(zs_free);
 
@@ -1063,13 +1941,14 @@ void *zs_map_object(struct zs_pool *pool, unsigned long handle,
 			enum zs_mapmode mm)
 {
 	struct page *page;
-	unsigned long obj_idx, off;
+	unsigned long obj, obj_idx, off;
 
 	unsigned int class_idx;
 	enum fullness_group fg;
 	struct size_class *class;
 	struct mapping_area *area;
 	struct page *pages[2];
+	void *ret;
 
 	BUG_ON(!handle);
 
@@ -1080,7 +1959,11 @@ void *zs_map_object(struct zs_pool *pool, unsigned long handle,
 	 */
 	BUG_ON(in_interrupt());
 
-	obj_handle_to_location(handle, &page, &obj_idx);
+	/* From now on, migration cannot move the object */
+	pin_tag(handle);
+
+	obj = handle_to_obj(handle);
+	obj_to_location(obj, &page, &obj_idx);
 	get_zspage_mapping(get_first_page(page), &class_idx, &fg);
 	class = pool->size_class[class_idx];
 	off = obj_idx_to_offset(page, obj_idx, class->size);
@@ -1090,7 +1973,8 @@ void *zs_map_object(struct zs_pool *pool, unsigned long handle,
 	if (off + class->size <= PAGE_SIZE) {
 		/* this object is contained entirely within a page */
 		area->vm_addr = kmap_atomic(page);
-		return area->vm_addr + off;
+		ret = area->vm_addr + off;
+		goto out;
 	}
 
 	/* this object spans two pages */
@@ -1098,14 +1982,19 @@ void *zs_map_object(struct zs_pool *pool, unsigned long handle,
 	pages[1] = get_next_page(page);
 	BUG_ON(!pages[1]);
 
-	return __zs_map_object(area, pages, off, class->size);
+	ret = __zs_map_object(area, pages, off, class->size);
+out:
+	if (!class->huge)
+		ret += ZS_HANDLE_SIZE;
+
+	return ret;
 }
 EXPORT_SYMBOL_GPL(zs_map_object);
 
 void zs_unmap_object(struct zs_pool *pool, unsigned long handle)
 {
 	struct page *page;
-	unsigned long obj_idx, off;
+	unsigned long obj, obj_idx, off;
 
 	unsigned int class_idx;
 	enum fullness_group fg;
@@ -1114,7 +2003,8 @@ void zs_unmap_object(struct zs_pool *pool, unsigned long handle)
 
 	BUG_ON(!handle);
 
-	obj_handle_to_location(handle, &page, &obj_idx);
+	obj = handle_to_obj(handle);
+	obj_to_location(obj, &page, &obj_idx);
 	get_zspage_mapping(get_first_page(page), &class_idx, &fg);
 	class = pool->size_class[class_idx];
 	off = obj_idx_to_offset(page, obj_idx, class->size);
@@ -1132,6 +2022,7 @@ void zs_unmap_object(struct zs_pool *pool, unsigned long handle)
 		__zs_unmap_object(area, pages, off, class->size);
 	}
 	put_cpu_var(zs_map_area);
+	unpin_tag(handle);
 }
 EXPORT_SYMBOL_GPL(zs_unmap_object);
 
@@ -2842,14 +2842,34 @@ static inline void hci_scodata_packet(struct hci_dev *hdev, struct sk_buff *skb)
 	kfree_skb(skb);
 }
 
+/* Takes all frames the driver has queued in one go, instead of one rx_q
+ * lock round trip per frame, and hands them out from the private list.
+ */
+static struct sk_buff *hci_rx_dequeue(struct hci_dev *hdev,
+						struct sk_buff_head *rx_q)
+{
+	unsigned long flags;
+
+	if (skb_queue_empty(rx_q) && !skb_queue_empty(&hdev->rx_q)) {
+		spin_lock_irqsave(&hdev->rx_q.lock, flags);
+		skb_queue_splice_tail_init(&hdev->rx_q, rx_q);
+		spin_unlock_irqrestore(&hdev->rx_q.lock, flags);
+	}
+
+	return __skb_dequeue(rx_q);
+}
+
 static void hci_rx_work(struct work_struct *work)
 {
 	struct hci_dev *hdev = container_of(work, struct hci_dev, rx_work);
+	struct sk_buff_head rx_q;
 	struct sk_buff *skb;
 
 	BT_DBG("%s", hdev->name);
 
-	while ((skb = skb_dequeue(&hdev->rx_q))) {
+	__skb_queue_head_init(&rx_q);
+
+	while ((skb = hci_rx_dequeue(hdev, &rx_q))) {
 		/* Send copy to monitor */
 		hci_send_to_monitor(hdev, skb);
 
@@ -4772,6 +4772,16 @@ int l2cap_recv_acldata(struct hci_conn *hcon, struct sk_buff *skb, u16 flags)
 			release_sock(sk);
 		}
 
+		/* Reassemble in the start fragment itself when the rest of
+		 * the frame fits in its tailroom, as it does in the
+		 * HCI_MAX_FRAME_SIZE buffers of the UART and SDIO drivers.
+		 */
+		if (!skb_cloned(skb) && skb_tailroom(skb) >= len - skb->len) {
+			conn->rx_skb = skb;
+			conn->rx_len = len - skb->len;
+			return 0;
+		}
+
 		/* Allocate skb for the complete frame (with header) */
 		conn->rx_skb = bt_skb_alloc(len, GFP_ATOMIC);
 		if (!conn->rx_skb)
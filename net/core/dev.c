@@ -2652,6 +2652,84 @@ EXPORT_SYMBOL(rps_sock_flow_table);
 
 struct static_key rps_needed __read_mostly;
 
+/*
+ * Automatic steering for rx queues without an rps_cpus mask. A cpu that
+ * took more than rps_auto_threshold packets in the last window spreads
+ * the flows it receives over the online cpus by rxhash until its load
+ * drops again. The window gives the hysteresis that keeps flows from
+ * bouncing between cpus, and the map of online cpus is rebuilt from the
+ * hotplug notifier so nothing is steered to a cpu that is going down.
+ */
+#define RPS_AUTO_WINDOW		(HZ / 10)
+
+int rps_auto_threshold __read_mostly = 500;
+EXPORT_SYMBOL(rps_auto_threshold);
+
+static struct rps_map __rcu *rps_auto_map;
+static DEFINE_MUTEX(rps_auto_mutex);
+
+static void rps_auto_update_map(int going_down)
+{
+	struct rps_map *map, *old;
+	int cpu, len = 0;
+
+	map = kmalloc(RPS_MAP_SIZE(nr_cpu_ids), GFP_KERNEL);
+
+	mutex_lock(&rps_auto_mutex);
+	if (map) {
+		for_each_online_cpu(cpu)
+			if (cpu != going_down)
+				map->cpus[len++] = cpu;
+		map->len = len;
+		/* nothing to spread over */
+		if (len < 2) {
+			kfree(map);
+			map = NULL;
+		}
+	}
+	old = rcu_dereference_protected(rps_auto_map,
+					lockdep_is_held(&rps_auto_mutex));
+	rcu_assign_pointer(rps_auto_map, map);
+	mutex_unlock(&rps_auto_mutex);
+
+	if (old)
+		kfree_rcu(old, rcu);
+}
+
+static int get_rps_auto_cpu(struct sk_buff *skb)
+{
+	struct softnet_data *sd = &__get_cpu_var(softnet_data);
+	struct rps_map *map;
+	u16 tcpu;
+
+	if (!rps_auto_threshold)
+		return -1;
+
+	if (time_after_eq(jiffies, sd->rps_auto_window)) {
+		sd->rps_auto_busy = sd->rps_auto_count >= rps_auto_threshold;
+		sd->rps_auto_count = 0;
+		sd->rps_auto_window = jiffies + RPS_AUTO_WINDOW;
+	}
+	sd->rps_auto_count++;
+
+	if (!sd->rps_auto_busy)
+		return -1;
+
+	map = rcu_dereference(rps_auto_map);
+	if (!map)
+		return -1;
+
+	skb_reset_network_header(skb);
+	if (!skb_get_rxhash(skb))
+		return -1;
+
+	tcpu = map->cpus[((u64) skb->rxhash * map->len) >> 32];
+	if (tcpu == smp_processor_id() || !cpu_online(tcpu))
+		return -1;
+
+	return tcpu;
+}
+
 static struct rps_dev_flow *
 set_rps_cpu(struct net_device *dev, struct sk_buff *skb,
 	    struct rps_dev_flow *rflow, u16 next_cpu)
@@ -2735,6 +2813,7 @@ static int get_rps_cpu(struct net_device *dev, struct sk_buff *skb,
 			goto done;
 		}
 	} else if (!rcu_access_pointer(rxqueue->rps_flow_table)) {
+		cpu = get_rps_auto_cpu(skb);
 		goto done;
 	}
 
@@ -6233,6 +6312,18 @@ static int dev_cpu_callback(struct notifier_block *nfb,
 	unsigned int cpu, oldcpu = (unsigned long)ocpu;
 	struct softnet_data *sd, *oldsd;
 
+#ifdef CONFIG_RPS
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_ONLINE:
+	case CPU_DOWN_FAILED:
+		rps_auto_update_map(-1);
+		break;
+	case CPU_DOWN_PREPARE:
+		rps_auto_update_map(oldcpu);
+		break;
+	}
+#endif
+
 	if (action != CPU_DEAD && action != CPU_DEAD_FROZEN)
 		return NOTIFY_OK;
 
@@ -6559,6 +6650,12 @@ static int __init net_dev_init(void)
 
 	dev_boot_phase = 0;
 
+#ifdef CONFIG_RPS
+	rps_auto_update_map(-1);
+	if (rps_auto_threshold)
+		static_key_slow_inc(&rps_needed);
+#endif
+
 	/* The loopback device is special if any other network devices
 	 * is present in a network namespace the loopback device must
 	 * be present. Since we now dynamically allocate and free the
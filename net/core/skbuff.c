@@ -582,6 +582,178 @@ bool skb_recycle_check(struct sk_buff *skb, int skb_size)
 }
 EXPORT_SYMBOL(skb_recycle_check);
 
+/*
+ * skb pools keep the linear skbs a driver hands back on tx completion in a
+ * small per-cpu cache, so the next buffer of the same size skips both the
+ * skbuff_head_cache and the kmalloc round trip. The skbs are queued as they
+ * were freed and only cleaned up by skb_recycle_check() when allocated
+ * again, because completion handlers usually run with interrupts disabled.
+ * The caches are dropped under memory pressure by skb_pool_shrinker.
+ */
+struct skb_pool {
+	struct list_head	list;
+	unsigned int		skb_size;
+	unsigned int		max_per_cpu;
+	struct sk_buff_head __percpu *cache;
+};
+
+static LIST_HEAD(skb_pools);
+static DEFINE_SPINLOCK(skb_pools_lock);
+
+/**
+ *	skb_pool_create - create a recycling pool of receive sized skbs
+ *	@skb_size: linear data size of the skbs handed out by the pool
+ *	@max_per_cpu: number of freed skbs kept on each cpu
+ *
+ *	Returns the new pool or %NULL if there is no free memory.
+ *	Must be called from process context.
+ */
+struct skb_pool *skb_pool_create(unsigned int skb_size,
+				 unsigned int max_per_cpu)
+{
+	struct skb_pool *pool;
+	int cpu;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return NULL;
+
+	pool->cache = alloc_percpu(struct sk_buff_head);
+	if (!pool->cache) {
+		kfree(pool);
+		return NULL;
+	}
+
+	for_each_possible_cpu(cpu)
+		skb_queue_head_init(per_cpu_ptr(pool->cache, cpu));
+	pool->skb_size = skb_size;
+	pool->max_per_cpu = max_per_cpu;
+
+	spin_lock(&skb_pools_lock);
+	list_add(&pool->list, &skb_pools);
+	spin_unlock(&skb_pools_lock);
+
+	return pool;
+}
+EXPORT_SYMBOL(skb_pool_create);
+
+/**
+ *	skb_pool_destroy - free a pool and the skbs cached in it
+ *	@pool: pool to free
+ *
+ *	The caller must make sure skb_pool_alloc() and skb_pool_free() can
+ *	no longer be called on @pool.
+ */
+void skb_pool_destroy(struct skb_pool *pool)
+{
+	int cpu;
+
+	spin_lock(&skb_pools_lock);
+	list_del(&pool->list);
+	spin_unlock(&skb_pools_lock);
+
+	for_each_possible_cpu(cpu)
+		skb_queue_purge(per_cpu_ptr(pool->cache, cpu));
+	free_percpu(pool->cache);
+	kfree(pool);
+}
+EXPORT_SYMBOL(skb_pool_destroy);
+
+/**
+ *	skb_pool_alloc - allocate an skb from a pool
+ *	@pool: pool to allocate from
+ *	@gfp_mask: allocation mask used when the pool is empty
+ *
+ *	Returns an skb with at least the pool's skb_size bytes of tailroom
+ *	and NET_SKB_PAD of headroom, just like __netdev_alloc_skb(). Cached
+ *	skbs are only reused with interrupts enabled; otherwise, or when the
+ *	cache of this cpu is empty, a new skb is allocated.
+ *
+ *	%NULL is returned if there is no free memory.
+ */
+struct sk_buff *skb_pool_alloc(struct skb_pool *pool, gfp_t gfp_mask)
+{
+	struct sk_buff_head *cache;
+	struct sk_buff *skb;
+
+	while (!irqs_disabled()) {
+		cache = get_cpu_ptr(pool->cache);
+		skb = skb_dequeue(cache);
+		put_cpu_ptr(pool->cache);
+		if (!skb)
+			break;
+
+		if (skb_recycle_check(skb, pool->skb_size))
+			return skb;
+		consume_skb(skb);
+	}
+
+	skb = __alloc_skb(pool->skb_size + NET_SKB_PAD, gfp_mask, 0,
+			  NUMA_NO_NODE);
+	if (likely(skb))
+		skb_reserve(skb, NET_SKB_PAD);
+	return skb;
+}
+EXPORT_SYMBOL(skb_pool_alloc);
+
+/**
+ *	skb_pool_free - give an skb back to a pool
+ *	@pool: pool the skb was allocated from
+ *	@skb: buffer to free
+ *
+ *	Drops the caller's reference to @skb. If that was the last one the
+ *	skb is kept on this cpu for skb_pool_alloc(), unless the cache is
+ *	full. Can be called from any context.
+ */
+void skb_pool_free(struct skb_pool *pool, struct sk_buff *skb)
+{
+	struct sk_buff_head *cache;
+
+	if (skb_shared(skb) || skb_cloned(skb)) {
+		dev_kfree_skb_any(skb);
+		return;
+	}
+
+	cache = get_cpu_ptr(pool->cache);
+	if (skb_queue_len(cache) < pool->max_per_cpu) {
+		skb_queue_tail(cache, skb);
+		skb = NULL;
+	}
+	put_cpu_ptr(pool->cache);
+
+	if (skb)
+		dev_kfree_skb_any(skb);
+}
+EXPORT_SYMBOL(skb_pool_free);
+
+static int skb_pool_shrink(struct shrinker *shrinker,
+			   struct shrink_control *sc)
+{
+	struct skb_pool *pool;
+	int count = 0;
+	int cpu;
+
+	spin_lock(&skb_pools_lock);
+	list_for_each_entry(pool, &skb_pools, list) {
+		for_each_possible_cpu(cpu) {
+			struct sk_buff_head *cache;
+
+			cache = per_cpu_ptr(pool->cache, cpu);
+			if (sc->nr_to_scan)
+				skb_queue_purge(cache);
+			count += skb_queue_len(cache);
+		}
+	}
+	spin_unlock(&skb_pools_lock);
+
+	return count;
+}
+
+static struct shrinker skb_pool_shrinker = {
+	.shrink = skb_pool_shrink,
+	.seeks = DEFAULT_SEEKS,
+};
+
 static void __copy_skb_header(struct sk_buff *new, const struct sk_buff *old)
 {
 	new->tstamp		= old->tstamp;
@@ -2964,6 +3136,7 @@ void __init skb_init(void)
 						0,
 						SLAB_HWCACHE_ALIGN|SLAB_PANIC,
 						NULL);
+	register_shrinker(&skb_pool_shrinker);
 }
 
 /**
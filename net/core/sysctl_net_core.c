@@ -87,6 +87,27 @@ static int rps_sock_flow_sysctl(ctl_table *table, int write,
 
 	return ret;
 }
+
+static int rps_auto_sysctl(ctl_table *table, int write,
+			   void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	static DEFINE_MUTEX(rps_auto_sysctl_mutex);
+	int old, ret;
+
+	mutex_lock(&rps_auto_sysctl_mutex);
+	old = rps_auto_threshold;
+	ret = proc_dointvec_minmax(table, write, buffer, lenp, ppos);
+	if (write && !ret && !old != !rps_auto_threshold) {
+		/* get_rps_cpu() is only called while rps_needed is set */
+		if (rps_auto_threshold)
+			static_key_slow_inc(&rps_needed);
+		else
+			static_key_slow_dec(&rps_needed);
+	}
+	mutex_unlock(&rps_auto_sysctl_mutex);
+
+	return ret;
+}
 #endif /* CONFIG_RPS */
 
 static struct ctl_table net_core_table[] = {
@@ -181,6 +202,14 @@ static struct ctl_table net_core_table[] = {
 		.mode		= 0644,
 		.proc_handler	= rps_sock_flow_sysctl
 	},
+	{
+		.procname	= "rps_auto_threshold",
+		.data		= &rps_auto_threshold,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= rps_auto_sysctl,
+		.extra1		= &zero,
+	},
 #endif
 #endif /* CONFIG_NET */
 	{
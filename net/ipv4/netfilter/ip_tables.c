@@ -24,8 +24,12 @@
 #include <linux/proc_fs.h>
 #include <linux/err.h>
 #include <linux/cpumask.h>
+#include <linux/sort.h>
+#include <linux/fs.h>
+#include <net/sock.h>
 
 #include <linux/netfilter/x_tables.h>
+#include <linux/netfilter/xt_owner.h>
 #include <linux/netfilter_ipv4/ip_tables.h>
 #include <net/netfilter/nf_log.h>
 #include "../../netfilter/xt_repldata.h"
@@ -177,6 +181,222 @@ static inline bool unconditional(const struct ipt_entry *e)
 #undef FWINV
 }
 
+/*
+ * Per-UID rule index.
+ *
+ * Android installs long runs of rules whose only condition is
+ * "-m owner --uid-owner N" (one per app). Such a rule can only match a
+ * packet whose socket belongs to N, so within a run of them every rule
+ * before the first one naming the packet's uid is known not to match.
+ * When a table is replaced, runs of at least IPT_UID_RUN_MIN such rules
+ * are indexed by uid; ipt_do_table() then jumps from inside a run straight
+ * to the next rule for the packet's uid, or past the run if there is none.
+ * The rule it lands on is evaluated as usual, so counters, targets and
+ * jumps behave exactly as with the linear walk.
+ */
+#define IPT_UID_RUN_MIN	4
+
+struct ipt_uid_rule {
+	uid_t uid;
+	unsigned int offset;
+};
+
+struct ipt_uid_run {
+	unsigned int start;	/* offset of the first rule of the run */
+	unsigned int end;	/* offset of the rule after the run */
+	unsigned int first;	/* slice of rules[], sorted by uid and offset */
+	unsigned int count;
+};
+
+struct ipt_uid_index {
+	unsigned int nr_runs;
+	struct ipt_uid_run *runs;
+	struct ipt_uid_rule *rules;
+	unsigned long map[0];	/* one bit per rule slot inside a run */
+};
+
+#define IPT_UID_SLOT(off)	((off) / __alignof__(struct ipt_entry))
+
+static bool ipt_uid_only_rule(const struct ipt_entry *e, uid_t *uid)
+{
+	static const struct ipt_ip any;
+	const struct xt_entry_match *ematch;
+	const struct xt_owner_match_info *info;
+	unsigned int n = 0;
+
+	if (memcmp(&e->ip, &any, sizeof(any)) != 0)
+		return false;
+
+	xt_ematch_foreach(ematch, e) {
+		if (n++ ||
+		    strcmp(ematch->u.kernel.match->name, "owner") != 0 ||
+		    ematch->u.kernel.match->revision != 1)
+			return false;
+		info = (const struct xt_owner_match_info *)ematch->data;
+		if (info->match != XT_OWNER_UID || info->invert ||
+		    info->uid_min != info->uid_max)
+			return false;
+		*uid = info->uid_min;
+	}
+
+	return n == 1;
+}
+
+static int ipt_uid_rule_cmp(const void *a, const void *b)
+{
+	const struct ipt_uid_rule *ra = a, *rb = b;
+
+	if (ra->uid != rb->uid)
+		return ra->uid < rb->uid ? -1 : 1;
+	if (ra->offset != rb->offset)
+		return ra->offset < rb->offset ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Builds the uid index of a table whose entries have been checked. Runs
+ * never cross a chain boundary because chain heads and policies have no
+ * matches. The index is an optimisation only: without memory the table
+ * is simply walked linearly.
+ */
+static void ipt_build_uid_index(struct xt_table_info *newinfo, void *entry0)
+{
+	struct ipt_uid_index *idx;
+	struct ipt_uid_run *run = NULL;
+	struct ipt_entry *iter;
+	unsigned int nr_runs = 0, nr_rules = 0, len = 0;
+	unsigned int map_size, size, off, i;
+	uid_t uid;
+
+	/* Pass 1: size the runs that are long enough to index */
+	xt_entry_foreach(iter, entry0, newinfo->size) {
+		if (ipt_uid_only_rule(iter, &uid)) {
+			len++;
+			continue;
+		}
+		if (len >= IPT_UID_RUN_MIN) {
+			nr_runs++;
+			nr_rules += len;
+		}
+		len = 0;
+	}
+	/* The table always ends with the ERROR target, so no run is left open */
+
+	if (!nr_runs)
+		return;
+
+	map_size = BITS_TO_LONGS(IPT_UID_SLOT(newinfo->size)) *
+		   sizeof(unsigned long);
+	size = sizeof(*idx) + map_size + nr_runs * sizeof(*idx->runs) +
+	       nr_rules * sizeof(*idx->rules);
+	if (size <= PAGE_SIZE)
+		idx = kzalloc(size, GFP_KERNEL);
+	else
+		idx = vzalloc(size);
+	if (!idx)
+		return;
+
+	idx->runs = (void *)idx->map + map_size;
+	idx->rules = (void *)(idx->runs + nr_runs);
+
+	/* Pass 2: record the runs and their rules */
+	nr_rules = 0;
+	len = 0;
+	xt_entry_foreach(iter, entry0, newinfo->size) {
+		off = (void *)iter - entry0;
+		if (ipt_uid_only_rule(iter, &uid)) {
+			if (!len++) {
+				run = &idx->runs[idx->nr_runs];
+				run->start = off;
+				run->first = nr_rules;
+			}
+			idx->rules[nr_rules].uid = uid;
+			idx->rules[nr_rules].offset = off;
+			nr_rules++;
+			continue;
+		}
+		if (len >= IPT_UID_RUN_MIN) {
+			run->end = off;
+			run->count = len;
+			idx->nr_runs++;
+		} else {
+			nr_rules -= len;
+		}
+		len = 0;
+	}
+
+	for (i = 0; i < idx->nr_runs; i++) {
+		run = &idx->runs[i];
+		for (off = run->start; off < run->end;
+		     off = off + get_entry(entry0, off)->next_offset)
+			__set_bit(IPT_UID_SLOT(off), idx->map);
+		sort(&idx->rules[run->first], run->count,
+		     sizeof(struct ipt_uid_rule), ipt_uid_rule_cmp, NULL);
+	}
+
+	newinfo->classifier = idx;
+}
+
+/*
+ * @e is inside an indexed run: returns the first rule at or after @e that
+ * names @uid, or the rule after the run. A packet without a socket file
+ * (!@has_uid) matches none of the rules.
+ */
+static struct ipt_entry *
+ipt_uid_skip(const struct ipt_uid_index *idx, const void *table_base,
+	     struct ipt_entry *e, uid_t uid, bool has_uid)
+{
+	unsigned int off = (void *)e - table_base;
+	const struct ipt_uid_run *run;
+	const struct ipt_uid_rule *rule;
+	unsigned int lo, hi, mid;
+
+	lo = 0;
+	hi = idx->nr_runs;
+	while (hi - lo > 1) {
+		mid = (lo + hi) / 2;
+		if (idx->runs[mid].start <= off)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	run = &idx->runs[lo];
+
+	if (!has_uid)
+		return get_entry(table_base, run->end);
+
+	/* lower bound of {uid, off} */
+	rule = &idx->rules[run->first];
+	lo = 0;
+	hi = run->count;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (rule[mid].uid < uid ||
+		    (rule[mid].uid == uid && rule[mid].offset < off))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo < run->count && rule[lo].uid == uid)
+		return get_entry(table_base, rule[lo].offset);
+	return get_entry(table_base, run->end);
+}
+
+/* The socket owner uid as xt_owner sees it */
+static bool ipt_skb_uid(const struct sk_buff *skb, uid_t *uid)
+{
+	const struct file *filp;
+
+	if (skb->sk == NULL || skb->sk->sk_socket == NULL)
+		return false;
+	filp = skb->sk->sk_socket->file;
+	if (filp == NULL)
+		return false;
+	*uid = filp->f_cred->fsuid;
+	return true;
+}
+
 /* for const-correctness */
 static inline const struct xt_entry_target *
 ipt_get_target_c(const struct ipt_entry *e)
@@ -303,6 +523,9 @@ ipt_do_table(struct sk_buff *skb,
 	const struct xt_table_info *private;
 	struct xt_action_param acpar;
 	unsigned int addend;
+	const struct ipt_uid_index *uid_idx;
+	int uid_state = 0;	/* 0: not looked up, 1: none, 2: valid */
+	uid_t uid = 0;
 
 	/* Initialization */
 	ip = ip_hdr(skb);
@@ -331,6 +554,7 @@ ipt_do_table(struct sk_buff *skb,
 	jumpstack  = (struct ipt_entry **)private->jumpstack[cpu];
 	stackptr   = per_cpu_ptr(private->stackptr, cpu);
 	origptr    = *stackptr;
+	uid_idx    = private->classifier;
 
 	e = get_entry(table_base, private->hook_entry[hook]);
 
@@ -343,6 +567,15 @@ ipt_do_table(struct sk_buff *skb,
 		const struct xt_entry_match *ematch;
 
 		IP_NF_ASSERT(e);
+		if (uid_idx && test_bit(IPT_UID_SLOT((void *)e - table_base),
+					uid_idx->map)) {
+			if (!uid_state)
+				uid_state = ipt_skb_uid(skb, &uid) ? 2 : 1;
+			/* lands on a rule outside the run or one for uid */
+			e = ipt_uid_skip(uid_idx, table_base, e, uid,
+					 uid_state == 2);
+		}
+
 		if (!ip_packet_match(ip, indev, outdev,
 		    &e->ip, acpar.fragoff)) {
  no_match:
@@ -862,6 +1095,8 @@ translate_table(struct net *net, struct xt_table_info *newinfo, void *entry0,
 		return ret;
 	}
 
+	ipt_build_uid_index(newinfo, entry0);
+
 	/* And one copy for every other CPU */
 	for_each_possible_cpu(i) {
 		if (newinfo->entries[i] && newinfo->entries[i] != entry0)
@@ -1764,6 +1999,8 @@ translate_compat_table(struct net *net,
 		return ret;
 	}
 
+	ipt_build_uid_index(newinfo, entry1);
+
 	/* And one copy for every other CPU */
 	for_each_possible_cpu(i)
 		if (newinfo->entries[i] && newinfo->entries[i] != entry1)
@@ -173,6 +173,9 @@ minstrel_ht_calc_tp(struct minstrel_ht_sta *mi, int group, int rate)
 	mr->cur_tp = MINSTREL_TRUNC((1000000 / usecs) * mr->probability);
 }
 
+static void
+minstrel_ht_update_rates(struct minstrel_priv *mp, struct minstrel_ht_sta *mi);
+
 /*
  * Update rate statistics and select new primary rates
  *
@@ -293,7 +296,9 @@ minstrel_ht_update_stats(struct minstrel_priv *mp, struct minstrel_ht_sta *mi)
 		}
 	}
 
-	mi->stats_update = jiffies;
+	mi->stats_next = jiffies + msecs_to_jiffies(mp->update_interval / 2);
+
+	minstrel_ht_update_rates(mp, mi);
 }
 
 static bool
@@ -389,6 +394,7 @@ minstrel_ht_tx_status(void *priv, struct ieee80211_supported_band *sband,
 	struct ieee80211_tx_rate *ar = info->status.rates;
 	struct minstrel_rate_stats *rate, *rate2;
 	struct minstrel_priv *mp = priv;
+	unsigned int max_tp_rate, max_tp_rate2;
 	bool last = false;
 	int group;
 	int i = 0;
@@ -438,20 +444,23 @@ minstrel_ht_tx_status(void *priv, struct ieee80211_supported_band *sband,
 	/*
 	 * check for sudden death of spatial multiplexing,
 	 * downgrade to a lower number of streams if necessary.
+	 * Less than 20% delivered, compared without dividing.
 	 */
+	max_tp_rate = mi->max_tp_rate;
+	max_tp_rate2 = mi->max_tp_rate2;
+
 	rate = minstrel_get_ratestats(mi, mi->max_tp_rate);
-	if (rate->attempts > 30 &&
-	    MINSTREL_FRAC(rate->success, rate->attempts) <
-	    MINSTREL_FRAC(20, 100))
+	if (rate->attempts > 30 && rate->success * 5 < rate->attempts)
 		minstrel_downgrade_rate(mi, &mi->max_tp_rate, true);
 
 	rate2 = minstrel_get_ratestats(mi, mi->max_tp_rate2);
-	if (rate2->attempts > 30 &&
-	    MINSTREL_FRAC(rate2->success, rate2->attempts) <
-	    MINSTREL_FRAC(20, 100))
+	if (rate2->attempts > 30 && rate2->success * 5 < rate2->attempts)
 		minstrel_downgrade_rate(mi, &mi->max_tp_rate2, false);
 
-	if (time_after(jiffies, mi->stats_update + (mp->update_interval / 2 * HZ) / 1000)) {
+	if (max_tp_rate != mi->max_tp_rate || max_tp_rate2 != mi->max_tp_rate2)
+		minstrel_ht_update_rates(mp, mi);
+
+	if (time_after(jiffies, mi->stats_next)) {
 		minstrel_ht_update_stats(mp, mi);
 		if (!(info->flags & IEEE80211_TX_CTL_AMPDU))
 			minstrel_aggr_check(sta, skb);
@@ -520,7 +529,7 @@ minstrel_ht_set_rate(struct minstrel_priv *mp, struct minstrel_ht_sta *mi,
 	struct minstrel_rate_stats *mr;
 
 	mr = minstrel_get_ratestats(mi, index);
-	if (!mr->retry_updated)
+	if (!sample && !mr->retry_updated)
 		minstrel_calc_retransmit(mp, mi, index);
 
 	if (sample)
@@ -538,6 +547,24 @@ minstrel_ht_set_rate(struct minstrel_priv *mp, struct minstrel_ht_sta *mi,
 	rate->idx = index % MCS_GROUP_RATES + (group->streams - 1) * MCS_GROUP_RATES;
 }
 
+/*
+ * The primary rates, their retry counts and flags only change with the
+ * stats or a downgrade, so their tx rate entries are set up here instead
+ * of for every frame in get_rate.
+ */
+static void
+minstrel_ht_update_rates(struct minstrel_priv *mp, struct minstrel_ht_sta *mi)
+{
+	minstrel_ht_set_rate(mp, mi, &mi->tx_rates[MINSTREL_TX_TP],
+			     mi->max_tp_rate, false, false);
+	minstrel_ht_set_rate(mp, mi, &mi->tx_rates[MINSTREL_TX_TP2],
+			     mi->max_tp_rate2, false, true);
+	minstrel_ht_set_rate(mp, mi, &mi->tx_rates[MINSTREL_TX_PROB],
+			     mi->max_prob_rate, false, false);
+	minstrel_ht_set_rate(mp, mi, &mi->tx_rates[MINSTREL_TX_PROB_RTS],
+			     mi->max_prob_rate, false, true);
+}
+
 static inline int
 minstrel_get_duration(int index)
 {
@@ -636,8 +663,7 @@ minstrel_ht_get_rate(void *priv, struct ieee80211_sta *sta, void *priv_sta,
 			true, false);
 		info->flags |= IEEE80211_TX_CTL_RATE_CTRL_PROBE;
 	} else {
-		minstrel_ht_set_rate(mp, mi, &ar[0], mi->max_tp_rate,
-			false, false);
+		ar[0] = mi->tx_rates[MINSTREL_TX_TP];
 	}
 
 	if (mp->hw->max_rates >= 3) {
@@ -647,14 +673,12 @@ minstrel_ht_get_rate(void *priv, struct ieee80211_sta *sta, void *priv_sta,
 		 * max_tp_rate -> max_tp_rate2 -> max_prob_rate by default.
 		 */
 		if (sample_idx >= 0)
-			minstrel_ht_set_rate(mp, mi, &ar[1], mi->max_tp_rate,
-				false, false);
+			ar[1] = mi->tx_rates[MINSTREL_TX_TP];
 		else
-			minstrel_ht_set_rate(mp, mi, &ar[1], mi->max_tp_rate2,
-				false, true);
+			ar[1] = mi->tx_rates[MINSTREL_TX_TP2];
 
-		minstrel_ht_set_rate(mp, mi, &ar[2], mi->max_prob_rate,
-				     false, !sample);
+		ar[2] = mi->tx_rates[sample ? MINSTREL_TX_PROB :
+					      MINSTREL_TX_PROB_RTS];
 
 		ar[3].count = 0;
 		ar[3].idx = -1;
@@ -664,8 +688,8 @@ minstrel_ht_get_rate(void *priv, struct ieee80211_sta *sta, void *priv_sta,
 		 * sample_rate -> max_prob_rate for sampling and
 		 * max_tp_rate -> max_prob_rate by default.
 		 */
-		minstrel_ht_set_rate(mp, mi, &ar[1], mi->max_prob_rate,
-				     false, !sample);
+		ar[1] = mi->tx_rates[sample ? MINSTREL_TX_PROB :
+					      MINSTREL_TX_PROB_RTS];
 
 		ar[2].count = 0;
 		ar[2].idx = -1;
@@ -710,7 +734,7 @@ minstrel_ht_update_caps(void *priv, struct ieee80211_supported_band *sband,
 
 	msp->is_ht = true;
 	memset(mi, 0, sizeof(*mi));
-	mi->stats_update = jiffies;
+	mi->stats_next = jiffies + msecs_to_jiffies(mp->update_interval / 2);
 
 	ack_dur = ieee80211_frame_duration(local, 10, 60, 1, 1);
 	mi->overhead = ieee80211_frame_duration(local, 0, 60, 1, 1) + ack_dur;
@@ -774,6 +798,7 @@ minstrel_ht_update_caps(void *priv, struct ieee80211_supported_band *sband,
 	if (!n_supported)
 		goto use_legacy;
 
+	minstrel_ht_update_rates(mp, mi);
 	return;
 
 use_legacy:
@@ -817,7 +842,7 @@ minstrel_ht_alloc_sta(void *priv, struct ieee80211_sta *sta, gfp_t gfp)
 			max_rates = sband->n_bitrates;
 	}
 
-	msp = kzalloc(sizeof(struct minstrel_ht_sta), gfp);
+	msp = kzalloc(sizeof(*msp), gfp);
 	if (!msp)
 		return NULL;
 
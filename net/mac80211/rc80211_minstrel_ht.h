@@ -69,6 +69,15 @@ struct minstrel_mcs_group_data {
 	struct minstrel_rate_stats rates[MCS_GROUP_RATES];
 };
 
+/* tx rate entries kept ready for the primary rates */
+enum minstrel_ht_tx_rate {
+	MINSTREL_TX_TP,		/* max_tp_rate */
+	MINSTREL_TX_TP2,	/* max_tp_rate2, with rts/cts */
+	MINSTREL_TX_PROB,	/* max_prob_rate */
+	MINSTREL_TX_PROB_RTS,	/* max_prob_rate, with rts/cts */
+	MINSTREL_TX_RATES
+};
+
 struct minstrel_ht_sta {
 	/* ampdu length (average, per sampling interval) */
 	unsigned int ampdu_len;
@@ -86,8 +95,11 @@ struct minstrel_ht_sta {
 	/* best probability rate */
 	unsigned int max_prob_rate;
 
-	/* time of last status update */
-	unsigned long stats_update;
+	/* time of next status update */
+	unsigned long stats_next;
+
+	/* get_rate copies these, refreshed with the primary rates */
+	struct ieee80211_tx_rate tx_rates[MINSTREL_TX_RATES];
 
 	/* overhead time in usec for each frame */
 	unsigned int overhead;
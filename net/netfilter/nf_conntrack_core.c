@@ -208,6 +208,16 @@ destroy_conntrack(struct nf_conntrack *nfct)
 
 	rcu_read_unlock();
 
+	/*
+	 * A confirmed conntrack without a helper is on no list any more
+	 * and cannot own expectations, so the usual NATed flow is freed
+	 * without taking the global lock a second time.
+	 */
+	if (nf_ct_is_confirmed(ct) && !nfct_help(ct)) {
+		NF_CT_STAT_INC_ATOMIC(net, delete);
+		goto free;
+	}
+
 	spin_lock_bh(&nf_conntrack_lock);
 	/* Expectations will have been removed in clean_from_lists,
 	 * except TFTP can create an expectation on the first packet,
@@ -224,6 +234,7 @@ destroy_conntrack(struct nf_conntrack *nfct)
 	NF_CT_STAT_INC(net, delete);
 	spin_unlock_bh(&nf_conntrack_lock);
 
+free:
 	if (ct->master)
 		nf_ct_put(ct->master);
 
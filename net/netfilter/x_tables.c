@@ -722,6 +722,11 @@ void xt_free_table_info(struct xt_table_info *info)
 
 	free_percpu(info->stackptr);
 
+	if (is_vmalloc_addr(info->classifier))
+		vfree(info->classifier);
+	else
+		kfree(info->classifier);
+
 	kfree(info);
 }
 EXPORT_SYMBOL(xt_free_table_info);
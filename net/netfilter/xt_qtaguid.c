@@ -767,7 +767,8 @@ static int get_active_counter_set(tag_t tag)
 
 /*
  * Find the entry for tracking the specified interface.
- * Caller must hold iface_stat_list_lock
+ * Caller must hold iface_stat_list_lock or be in an RCU read-side section.
+ * Entries are never freed, so the packet path only needs the latter.
  */
 static struct iface_stat *get_iface_entry(const char *ifname)
 {
@@ -780,7 +781,7 @@ static struct iface_stat *get_iface_entry(const char *ifname)
 	}
 
 	/* Iterate over interfaces */
-	list_for_each_entry(iface_entry, &iface_stat_list, list) {
+	list_for_each_entry_rcu(iface_entry, &iface_stat_list, list) {
 		if (!strcmp(ifname, iface_entry->ifname))
 			goto done;
 	}
@@ -800,6 +801,7 @@ static int iface_stat_fmt_proc_read(char *page, char **num_items_returned,
 	struct iface_stat *iface_entry;
 	struct rtnl_link_stats64 dev_stats, *stats;
 	struct rtnl_link_stats64 no_dev_stats = {0};
+	struct byte_packet_counters skb_totals[IFS_MAX_DIRECTIONS];
 
 	if (unlikely(module_passive)) {
 		*eof = 1;
@@ -867,15 +869,16 @@ static int iface_stat_fmt_proc_read(char *page, char **num_items_returned,
 				stats->tx_bytes, stats->tx_packets
 				);
 		} else {
+			iface_stat_fold_skb_totals(iface_entry, skb_totals);
 			len = snprintf(
 				outp, char_count,
 				"%s "
 				"%llu %llu %llu %llu\n",
 				iface_entry->ifname,
-				iface_entry->totals_via_skb[IFS_RX].bytes,
-				iface_entry->totals_via_skb[IFS_RX].packets,
-				iface_entry->totals_via_skb[IFS_TX].bytes,
-				iface_entry->totals_via_skb[IFS_TX].packets
+				skb_totals[IFS_RX].bytes,
+				skb_totals[IFS_RX].packets,
+				skb_totals[IFS_TX].bytes,
+				skb_totals[IFS_TX].packets
 				);
 		}
 		if (len >= char_count) {
@@ -995,7 +998,7 @@ static struct iface_stat *iface_alloc(struct net_device *net_dev)
 	isw->iface_entry = new_iface;
 	INIT_WORK(&isw->iface_work, iface_create_proc_worker);
 	schedule_work(&isw->iface_work);
-	list_add(&new_iface->list, &iface_stat_list);
+	list_add_rcu(&new_iface->list, &iface_stat_list);
 	return new_iface;
 }
 
@@ -1303,6 +1306,7 @@ static void iface_stat_update_from_skb(const struct sk_buff *skb,
 				       struct xt_action_param *par)
 {
 	struct iface_stat *entry;
+	struct iface_skb_stats *stats;
 	const struct net_device *el_dev;
 	enum ifs_tx_rx direction = par->in ? IFS_RX : IFS_TX;
 	int bytes = skb->len;
@@ -1337,21 +1341,27 @@ static void iface_stat_update_from_skb(const struct sk_buff *skb,
 			 par->family, proto);
 	}
 
-	spin_lock_bh(&iface_stat_list_lock);
+	rcu_read_lock();
 	entry = get_iface_entry(el_dev->name);
 	if (entry == NULL) {
 		IF_DEBUG("qtaguid: iface_stat: %s(%s): not tracked\n",
 			 __func__, el_dev->name);
-		spin_unlock_bh(&iface_stat_list_lock);
+		rcu_read_unlock();
 		return;
 	}
 
 	IF_DEBUG("qtaguid: %s(%s): entry=%p\n", __func__,
 		 el_dev->name, entry);
 
-	entry->totals_via_skb[direction].bytes += bytes;
-	entry->totals_via_skb[direction].packets++;
-	spin_unlock_bh(&iface_stat_list_lock);
+	/* The per cpu slot must not be reentered from a softirq */
+	local_bh_disable();
+	stats = &entry->totals_via_skb[smp_processor_id()];
+	u64_stats_update_begin(&stats->syncp);
+	stats->totals[direction].bytes += bytes;
+	stats->totals[direction].packets++;
+	u64_stats_update_end(&stats->syncp);
+	local_bh_enable();
+	rcu_read_unlock();
 }
 
 static void tag_stat_update(struct tag_stat *tag_entry,
@@ -1409,7 +1419,9 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 		 ifname, uid, sk, direction, proto, bytes);
 
 
+	rcu_read_lock();
 	iface_entry = get_iface_entry(ifname);
+	rcu_read_unlock();
 	if (!iface_entry) {
 		pr_err_ratelimited("qtaguid: iface_stat: stat_update() "
 				   "%s not found\n", ifname);
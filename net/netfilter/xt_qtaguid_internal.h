@@ -11,8 +11,12 @@
 #define __XT_QTAGUID_INTERNAL_H__
 
 #include <linux/types.h>
+#include <linux/cache.h>
+#include <linux/cpumask.h>
 #include <linux/rbtree.h>
 #include <linux/spinlock_types.h>
+#include <linux/string.h>
+#include <linux/u64_stats_sync.h>
 #include <linux/workqueue.h>
 
 /* Iface handling */
@@ -195,15 +199,24 @@ struct tag_stat {
 	struct data_counters *parent_counters;
 };
 
+/*
+ * Per cpu share of the skb based totals of an iface. Updated from the
+ * packet path with BHs off and without any lock, folded on read.
+ */
+struct iface_skb_stats {
+	struct byte_packet_counters totals[IFS_MAX_DIRECTIONS];
+	struct u64_stats_sync syncp;
+} ____cacheline_aligned_in_smp;
+
 struct iface_stat {
-	struct list_head list;  /* in iface_stat_list */
+	struct list_head list;  /* in iface_stat_list, RCU */
 	char *ifname;
 	bool active;
 	/* net_dev is only valid for active iface_stat */
 	struct net_device *net_dev;
 
 	struct byte_packet_counters totals_via_dev[IFS_MAX_DIRECTIONS];
-	struct byte_packet_counters totals_via_skb[IFS_MAX_DIRECTIONS];
+	struct iface_skb_stats totals_via_skb[NR_CPUS];
 	/*
 	 * We keep the last_known, because some devices reset their counters
 	 * just before NETDEV_UP, while some will reset just before
@@ -222,6 +235,29 @@ struct iface_stat {
 	spinlock_t tag_stat_list_lock;
 };
 
+static inline void iface_stat_fold_skb_totals(struct iface_stat *entry,
+	struct byte_packet_counters totals[IFS_MAX_DIRECTIONS])
+{
+	struct byte_packet_counters tmp[IFS_MAX_DIRECTIONS];
+	struct iface_skb_stats *stats;
+	unsigned int start;
+	int cpu, dir;
+
+	memset(totals, 0, sizeof(tmp));
+	for_each_possible_cpu(cpu) {
+		stats = &entry->totals_via_skb[cpu];
+		do {
+			start = u64_stats_fetch_begin_bh(&stats->syncp);
+			memcpy(tmp, stats->totals, sizeof(tmp));
+		} while (u64_stats_fetch_retry_bh(&stats->syncp, start));
+
+		for (dir = 0; dir < IFS_MAX_DIRECTIONS; dir++) {
+			totals[dir].bytes += tmp[dir].bytes;
+			totals[dir].packets += tmp[dir].packets;
+		}
+	}
+}
+
 /* This is needed to create proc_dir_entries from atomic context. */
 struct iface_stat_work {
 	struct work_struct iface_work;
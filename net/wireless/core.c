@@ -1051,6 +1051,8 @@ static int __init cfg80211_init(void)
 	if (!cfg80211_wq)
 		goto out_fail_wq;
 
+	cfg80211_scan_throttle_init();
+
 	return 0;
 
 out_fail_wq:
@@ -1070,6 +1072,7 @@ subsys_initcall(cfg80211_init);
 
 static void __exit cfg80211_exit(void)
 {
+	cfg80211_scan_throttle_exit();
 	debugfs_remove(ieee80211_debugfs_dir);
 	nl80211_exit();
 	unregister_netdevice_notifier(&cfg80211_netdev_notifier);
@@ -61,6 +61,10 @@ struct cfg80211_registered_device {
 	struct list_head bss_list;
 	struct rb_root bss_tree;
 	u32 bss_generation;
+	/* bss_generation at the last unlink, for incremental dumps */
+	u32 bss_unlink_generation;
+	/* jiffies of the last scan userspace triggered, protected by RTNL */
+	unsigned long last_user_scan;
 	struct cfg80211_scan_request *scan_req; /* protected by RTNL */
 	struct cfg80211_sched_scan_request *sched_scan_req;
 	unsigned long suspend_at;
@@ -133,6 +137,14 @@ struct cfg80211_internal_bss {
 	bool beacon_ies_allocated;
 	bool proberesp_ies_allocated;
 
+	/*
+	 * bss_generation at the last change userspace cares about, and the
+	 * signal reported then; a signal drifting by less than a few dB or
+	 * a new TSF alone doesn't count as a change.
+	 */
+	u32 generation;
+	s32 reported_signal;
+
 	/* must be last because of priv member */
 	struct cfg80211_bss pub;
 };
@@ -277,6 +289,14 @@ void ieee80211_set_bitrate_flags(struct wiphy *wiphy);
 void cfg80211_bss_expire(struct cfg80211_registered_device *dev);
 void cfg80211_bss_age(struct cfg80211_registered_device *dev,
                       unsigned long age_secs);
+bool cfg80211_scan_throttled(struct cfg80211_registered_device *rdev);
+#ifdef CONFIG_HAS_EARLYSUSPEND
+void cfg80211_scan_throttle_init(void);
+void cfg80211_scan_throttle_exit(void);
+#else
+static inline void cfg80211_scan_throttle_init(void) {}
+static inline void cfg80211_scan_throttle_exit(void) {}
+#endif
 
 /* IBSS */
 int __cfg80211_join_ibss(struct cfg80211_registered_device *rdev,
@@ -242,6 +242,7 @@ static const struct nla_policy nl80211_policy[NL80211_ATTR_MAX+1] = {
 	[NL80211_ATTR_VENDOR_DATA] = { .type = NLA_BINARY },
 	[NL80211_ATTR_QOS_MAP] = { .type = NLA_BINARY,
 				   .len = IEEE80211_QOS_MAP_LEN_MAX },
+	[NL80211_ATTR_BSS_CHANGED_SINCE] = { .type = NLA_U32 },
 };
 
 /* policy for the key attributes */
@@ -4093,7 +4094,7 @@ static int nl80211_trigger_scan(struct sk_buff *skb, struct genl_info *info)
 	if (!rdev->ops->scan)
 		return -EOPNOTSUPP;
 
-	if (rdev->scan_req)
+	if (rdev->scan_req || cfg80211_scan_throttled(rdev))
 		return -EBUSY;
 
 	if (info->attrs[NL80211_ATTR_SCAN_FREQUENCIES]) {
@@ -4272,6 +4273,7 @@ static int nl80211_trigger_scan(struct sk_buff *skb, struct genl_info *info)
 	err = rdev->ops->scan(&rdev->wiphy, dev, request);
 
 	if (!err) {
+		rdev->last_user_scan = jiffies;
 		nl80211_send_scan_start(rdev, dev);
 		dev_hold(dev);
 	} else {
@@ -4543,6 +4545,9 @@ static int nl80211_send_bss(struct sk_buff *msg, struct netlink_callback *cb,
 
 	NLA_PUT_U32(msg, NL80211_ATTR_GENERATION, rdev->bss_generation);
 	NLA_PUT_U32(msg, NL80211_ATTR_IFINDEX, wdev->netdev->ifindex);
+	/* tells an incremental dump from a full one */
+	if (cb->args[2])
+		NLA_PUT_U32(msg, NL80211_ATTR_BSS_CHANGED_SINCE, cb->args[3]);
 
 	bss = nla_nest_start(msg, NL80211_ATTR_BSS);
 	if (!bss)
@@ -4610,12 +4615,21 @@ static int nl80211_dump_scan(struct sk_buff *skb,
 	struct cfg80211_internal_bss *scan;
 	struct wireless_dev *wdev;
 	int start = cb->args[1], idx = 0;
+	bool first = !cb->args[0];
+	u32 since;
 	int err;
 
 	err = nl80211_prepare_netdev_dump(skb, cb, &rdev, &dev);
 	if (err)
 		return err;
 
+	/* the attributes were only parsed for the first call */
+	if (first && nl80211_fam.attrbuf[NL80211_ATTR_BSS_CHANGED_SINCE]) {
+		cb->args[2] = 1;
+		cb->args[3] = nla_get_u32(
+			nl80211_fam.attrbuf[NL80211_ATTR_BSS_CHANGED_SINCE]);
+	}
+
 	wdev = dev->ieee80211_ptr;
 
 	wdev_lock(wdev);
@@ -4624,9 +4638,17 @@ static int nl80211_dump_scan(struct sk_buff *skb,
 
 	cb->seq = rdev->bss_generation;
 
+	/* removals can't be told incrementally, fall back to the full list */
+	since = cb->args[3];
+	if (first && cb->args[2] &&
+	    (s32)(rdev->bss_unlink_generation - since) > 0)
+		cb->args[2] = 0;
+
 	list_for_each_entry(scan, &rdev->bss_list, list) {
 		if (++idx <= start)
 			continue;
+		if (cb->args[2] && (s32)(scan->generation - since) <= 0)
+			continue;
 		if (nl80211_send_bss(skb, cb,
 				cb->nlh->nlmsg_seq, NLM_F_MULTI,
 				rdev, wdev, scan) < 0) {
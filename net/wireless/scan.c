@@ -10,6 +10,7 @@
 #include <linux/wireless.h>
 #include <linux/nl80211.h>
 #include <linux/etherdevice.h>
+#include <linux/earlysuspend.h>
 #include <net/arp.h>
 #include <net/cfg80211.h>
 #include <net/cfg80211-wext.h>
@@ -20,6 +21,62 @@
 
 #define IEEE80211_SCAN_RESULT_EXPIRE	(7 * HZ)
 
+/* signal moves that make a BSS show up in an incremental dump */
+#define BSS_SIGNAL_CHANGE_MBM		500
+#define BSS_SIGNAL_CHANGE_UNSPEC	5
+
+/*
+ * Scans requested from userspace while the screen is off are held to one
+ * per bg_scan_interval_ms, the connection manager's own scans (sme.c) are
+ * not affected. 0 disables the throttling.
+ */
+static unsigned int bg_scan_interval_ms = 10000;
+module_param(bg_scan_interval_ms, uint, 0644);
+MODULE_PARM_DESC(bg_scan_interval_ms,
+		 "Minimum interval between userspace scans while the screen is off");
+
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static bool cfg80211_screen_off;
+
+static void cfg80211_scan_early_suspend(struct early_suspend *h)
+{
+	cfg80211_screen_off = true;
+}
+
+static void cfg80211_scan_late_resume(struct early_suspend *h)
+{
+	cfg80211_screen_off = false;
+}
+
+static struct early_suspend cfg80211_scan_early_suspend_desc = {
+	.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN,
+	.suspend = cfg80211_scan_early_suspend,
+	.resume = cfg80211_scan_late_resume,
+};
+
+void cfg80211_scan_throttle_init(void)
+{
+	register_early_suspend(&cfg80211_scan_early_suspend_desc);
+}
+
+void cfg80211_scan_throttle_exit(void)
+{
+	unregister_early_suspend(&cfg80211_scan_early_suspend_desc);
+}
+#else
+#define cfg80211_screen_off	false
+#endif
+
+/* must hold RTNL, last_user_scan is set once the driver took the scan */
+bool cfg80211_scan_throttled(struct cfg80211_registered_device *rdev)
+{
+	unsigned int interval = ACCESS_ONCE(bg_scan_interval_ms);
+
+	return cfg80211_screen_off && interval && rdev->last_user_scan &&
+	       time_before(jiffies, rdev->last_user_scan +
+				    msecs_to_jiffies(interval));
+}
+
 void ___cfg80211_scan_done(struct cfg80211_registered_device *rdev, bool leak)
 {
 	struct cfg80211_scan_request *request;
@@ -193,6 +250,8 @@ static void __cfg80211_unlink_bss(struct cfg80211_registered_device *dev,
 	list_del_init(&bss->list);
 	rb_erase(&bss->rbn, &dev->bss_tree);
 	kref_put(&bss->ref, bss_release);
+	/* the generation is bumped right after by all callers */
+	dev->bss_unlink_generation = dev->bss_generation + 1;
 }
 
 /* must hold dev->bss_lock! */
@@ -600,11 +659,38 @@ copy_hidden_ies(struct cfg80211_internal_bss *res,
 			res->pub.len_beacon_ies);
 }
 
+/*
+ * Whether an update is worth sending in an incremental dump. The beacon
+ * IEs carry the TIM, so only a change in their length counts.
+ */
+static bool cfg80211_bss_changed(struct cfg80211_registered_device *dev,
+				 struct cfg80211_internal_bss *found,
+				 struct cfg80211_internal_bss *res)
+{
+	s32 thold = dev->wiphy.signal_type == CFG80211_SIGNAL_TYPE_MBM ?
+		    BSS_SIGNAL_CHANGE_MBM : BSS_SIGNAL_CHANGE_UNSPEC;
+
+	if (found->pub.capability != res->pub.capability ||
+	    found->pub.beacon_interval != res->pub.beacon_interval ||
+	    abs(found->reported_signal - res->pub.signal) >= thold)
+		return true;
+
+	if (res->pub.proberesp_ies &&
+	    (found->pub.len_proberesp_ies != res->pub.len_proberesp_ies ||
+	     memcmp(found->pub.proberesp_ies, res->pub.proberesp_ies,
+		    res->pub.len_proberesp_ies)))
+		return true;
+
+	return res->pub.beacon_ies &&
+	       found->pub.len_beacon_ies != res->pub.len_beacon_ies;
+}
+
 static struct cfg80211_internal_bss *
 cfg80211_bss_update(struct cfg80211_registered_device *dev,
 		    struct cfg80211_internal_bss *res)
 {
 	struct cfg80211_internal_bss *found = NULL;
+	bool changed = true;
 
 	/*
 	 * The reference to "res" is donated to this function.
@@ -622,6 +708,8 @@ cfg80211_bss_update(struct cfg80211_registered_device *dev,
 	found = rb_find_bss(dev, res);
 
 	if (found) {
+		changed = cfg80211_bss_changed(dev, found, res);
+
 		found->pub.beacon_interval = res->pub.beacon_interval;
 		found->pub.tsf = res->pub.tsf;
 		found->pub.signal = res->pub.signal;
@@ -725,6 +813,10 @@ cfg80211_bss_update(struct cfg80211_registered_device *dev,
 	}
 
 	dev->bss_generation++;
+	if (changed) {
+		found->generation = dev->bss_generation;
+		found->reported_signal = found->pub.signal;
+	}
 	spin_unlock_bh(&dev->bss_lock);
 
 	kref_get(&found->ref);
@@ -926,7 +1018,7 @@ int cfg80211_wext_siwscan(struct net_device *dev,
 	if (IS_ERR(rdev))
 		return PTR_ERR(rdev);
 
-	if (rdev->scan_req) {
+	if (rdev->scan_req || cfg80211_scan_throttled(rdev)) {
 		err = -EBUSY;
 		goto out;
 	}
@@ -1025,6 +1117,7 @@ int cfg80211_wext_siwscan(struct net_device *dev,
 		rdev->scan_req = NULL;
 		/* creq will be freed below */
 	} else {
+		rdev->last_user_scan = jiffies;
 		nl80211_send_scan_start(rdev, dev);
 		/* creq now owned by driver */
 		creq = NULL;
@@ -44,7 +44,8 @@ static const struct snd_pcm_hardware dma_hardware = {
 	.channels_max		= 6,
 	.buffer_bytes_max	= 128*1024,
 	.period_bytes_min	= PAGE_SIZE,
-	.period_bytes_max	= PAGE_SIZE*8,
+	/* deep buffers wake the AP up as little as possible */
+	.period_bytes_max	= PAGE_SIZE*16,
 	.periods_min		= 2,
 	.periods_max		= 128,
 	.fifo_size		= 32,
@@ -46,7 +46,8 @@ static const struct snd_pcm_hardware idma_hardware = {
 	.channels_min = 1,
 	.channels_max = 2,
 	.buffer_bytes_max = LP_TXBUFF_MAX,
-	.period_bytes_min = 1024,
+	/* small periods keep the fast path latency low */
+	.period_bytes_min = 256,
 	.period_bytes_max = PAGE_SIZE * 2,
 	.periods_min = 2,
 	.periods_max = 128,
@@ -190,7 +191,7 @@ static int idma_hw_params(struct snd_pcm_substream *substream,
 
 	idma_setcallbk(substream, idma_done);
 
-	pr_info("I:%s:DmaAddr=@%x Total=%d PrdSz=%d #Prds=%d dma_area=0x%x\n",
+	pr_debug("I:%s:DmaAddr=@%x Total=%d PrdSz=%d #Prds=%d dma_area=0x%x\n",
 		(substream->stream == SNDRV_PCM_STREAM_PLAYBACK) ? "P" : "C",
 		prtd->start, runtime->dma_bytes, prtd->periodsz,
 		prtd->period, (unsigned int)runtime->dma_area);
@@ -398,6 +399,11 @@ static int idma_open(struct snd_pcm_substream *substream)
 
 	pr_debug("Entered %s\n", __func__);
 
+	/* the level interrupt wraps to the start after the last period */
+	snd_pcm_hw_constraint_integer(runtime, SNDRV_PCM_HW_PARAM_PERIODS);
+	/* and is programmed as a word address */
+	snd_pcm_hw_constraint_step(runtime, 0,
+				   SNDRV_PCM_HW_PARAM_PERIOD_BYTES, 4);
 	snd_soc_set_runtime_hwparams(substream, &idma_hardware);
 
 	/* Clear AHB register */
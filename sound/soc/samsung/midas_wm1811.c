@@ -1637,6 +1637,13 @@ static int midas_wm1811_init_paiftx(struct snd_soc_pcm_runtime *rtd)
 	return snd_soc_dapm_sync(&codec->dapm);
 }
 
+/*
+ * AIF1 is fed by two concurrently usable PCMs, mixed by the I2S block:
+ * the secondary FIFO through the internal IDMA with small periods for
+ * the low latency (fast mixer) path, and the primary FIFO through the
+ * system DMA, or the SRP when it is offloading, with large periods for
+ * the deep buffer path.
+ */
 static struct snd_soc_dai_link midas_dai[] = {
 	{ /* Sec_Fifo DAI i/f */
 		.name = "Sec_FIFO TX",
@@ -30,6 +30,8 @@
 #include <linux/io.h>
 #include <linux/irq.h>
 #include <linux/uaccess.h>
+#include <linux/poll.h>
+#include <linux/spinlock.h>
 #include <linux/cma.h>
 
 #include <mach/hardware.h>
@@ -51,6 +53,8 @@ static struct srp_info srp;
 static DEFINE_MUTEX(srp_mutex);
 static DECLARE_WAIT_QUEUE_HEAD(read_wq);
 static DECLARE_WAIT_QUEUE_HEAD(decinfo_wq);
+static DECLARE_WAIT_QUEUE_HEAD(write_wq);
+static DEFINE_SPINLOCK(srp_wbuf_lock);
 
 int srp_get_status(int cmd)
 {
@@ -376,8 +380,11 @@ static void srp_reset(void)
 	srp.obuf_copy_done[0] = 0;
 	srp.obuf_copy_done[1] = 0;
 
+	srp.wbuf_rd = 0;
 	srp.wbuf_pos = 0;
 	srp.wbuf_fill_size = 0;
+	srp.ibuf_starved = 0;
+	wake_up_interruptible(&write_wq);
 
 	srp.set_bitstream_size = 0;
 	srp.stop_after_eos = 0;
@@ -387,45 +394,59 @@ static void srp_reset(void)
 	srp.pcm_size = 0;
 }
 
+/*
+ * The WBUF is a ring: wbuf_pos bytes of compressed data start at wbuf_rd.
+ * The IBUFs are refilled from it in the IBUF request interrupt, so a large
+ * WBUF keeps the SRP fed without any help from userspace, and writers are
+ * only woken up once it has drained below WBUF_LOW_THRESHOLD.
+ */
 static void srp_fill_ibuf(void)
 {
+	unsigned char *ibuf = srp.ibuf_next ? srp.ibuf1 : srp.ibuf0;
 	unsigned long fill_size = 0;
+	unsigned long len;
+	unsigned long flags;
+
+	spin_lock_irqsave(&srp_wbuf_lock, flags);
 
 	if (!srp.wbuf_pos)
-		return;
+		goto out;
 
 	if (srp.wbuf_pos >= srp.ibuf_size) {
 		fill_size = srp.ibuf_size;
-		srp.wbuf_pos -= fill_size;
+	} else if (srp.wait_for_eos) {
+		fill_size = srp.wbuf_pos;
+		memset(ibuf + fill_size, 0xFF, srp.ibuf_size - fill_size);
 	} else {
-		if (srp.wait_for_eos) {
-			fill_size = srp.wbuf_pos;
-			memset(&srp.wbuf[fill_size], 0xFF,
-				srp.ibuf_size - fill_size);
-			srp.wbuf_pos = 0;
-		}
+		/* Underrun, srp_write() fills it once enough data is there */
+		srp.ibuf_starved = 1;
+		goto out;
 	}
 
-	if (srp.ibuf_next == 0) {
-		memcpy(srp.ibuf0, srp.wbuf, srp.ibuf_size);
-		srp_debug("Fill IBUF0 (%lu)\n", fill_size);
-		srp.ibuf_empty[0] = 0;
-		srp.ibuf_next = 1;
-	} else {
-		memcpy(srp.ibuf1, srp.wbuf, srp.ibuf_size);
-		srp_debug("Fill IBUF1 (%lu)\n", fill_size);
-		srp.ibuf_empty[1] = 0;
-		srp.ibuf_next = 0;
-	}
+	len = min(fill_size, srp.wbuf_size - srp.wbuf_rd);
+	memcpy(ibuf, &srp.wbuf[srp.wbuf_rd], len);
+	if (len < fill_size)
+		memcpy(ibuf + len, srp.wbuf, fill_size - len);
+
+	srp.wbuf_rd = (srp.wbuf_rd + fill_size) % srp.wbuf_size;
+	srp.wbuf_pos -= fill_size;
+	srp.ibuf_starved = 0;
 
-	if (srp.wbuf_pos)
-		memcpy(srp.wbuf, &srp.wbuf[srp.ibuf_size], srp.wbuf_pos);
+	srp_debug("Fill IBUF%d (%lu)\n", srp.ibuf_next, fill_size);
+	srp.ibuf_empty[srp.ibuf_next] = 0;
+	srp.ibuf_next = srp.ibuf_next ? 0 : 1;
+
+	if (srp.wbuf_pos <= WBUF_LOW_THRESHOLD && waitqueue_active(&write_wq))
+		wake_up_interruptible(&write_wq);
+out:
+	spin_unlock_irqrestore(&srp_wbuf_lock, flags);
 }
 
 static ssize_t srp_write(struct file *file, const char *buffer,
 					size_t size, loff_t *pos)
 {
 	unsigned long start_threshold = 0;
+	unsigned long wr, len, flags;
 	ssize_t ret = 0;
 
 	srp_debug("Write(%d bytes)\n", size);
@@ -447,21 +468,32 @@ static ssize_t srp_write(struct file *file, const char *buffer,
 		srp_obuf_elapsed();
 	}
 
-	if (srp.wbuf_pos + size > WBUF_SIZE) {
+	if (srp.wbuf_pos + size > srp.wbuf_size) {
 		srp_debug("Occured Ibuf Overflow!!\n");
 		ret = SRP_ERROR_IBUF_OVERFLOW;
 		goto exit_func;
 	}
 
-	if (copy_from_user(&srp.wbuf[srp.wbuf_pos], buffer, size)) {
+	/* Only the interrupt consumes, the free space can only grow */
+	spin_lock_irqsave(&srp_wbuf_lock, flags);
+	wr = (srp.wbuf_rd + srp.wbuf_pos) % srp.wbuf_size;
+	spin_unlock_irqrestore(&srp_wbuf_lock, flags);
+	len = min_t(unsigned long, size, srp.wbuf_size - wr);
+	if (copy_from_user(&srp.wbuf[wr], buffer, len) ||
+	    copy_from_user(srp.wbuf, buffer + len, size - len)) {
 		srp_err("Failed to copy_from_user!!\n");
 		ret = -EFAULT;
 		goto exit_func;
 	}
 
+	spin_lock_irqsave(&srp_wbuf_lock, flags);
 	srp.wbuf_pos += size;
+	spin_unlock_irqrestore(&srp_wbuf_lock, flags);
 	srp.wbuf_fill_size += size;
 
+	if (srp.ibuf_starved && srp.wbuf_pos >= srp.ibuf_size)
+		srp_fill_ibuf();
+
 	start_threshold = srp.decoding_started
 			? srp.ibuf_size : START_THRESHOLD;
 
@@ -558,6 +590,21 @@ static ssize_t srp_read(struct file *file, char *buffer,
 	return ret;
 }
 
+static unsigned int srp_poll(struct file *file, poll_table *wait)
+{
+	unsigned int mask = 0;
+
+	poll_wait(file, &write_wq, wait);
+	poll_wait(file, &read_wq, wait);
+
+	if (srp.wbuf_pos <= WBUF_LOW_THRESHOLD)
+		mask |= POLLOUT | POLLWRNORM;
+	if (srp.decoding_started && srp.obuf_fill_done[srp.obuf_ready])
+		mask |= POLLIN | POLLRDNORM;
+
+	return mask;
+}
+
 static void srp_set_stream_size(void)
 {
 	/* Leave stream size max, if data is available */
@@ -609,7 +656,7 @@ static long srp_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 
 	case SRP_GET_IBUF_INFO:
 		srp.ibuf_info.addr = (void *) srp.wbuf;
-		srp.ibuf_info.size = srp.ibuf_size * 2;
+		srp.ibuf_info.size = srp.wbuf_size - WBUF_LOW_THRESHOLD;
 		srp.ibuf_info.num  = srp.ibuf_num;
 
 		ret = copy_to_user(argp, &srp.ibuf_info,
@@ -990,7 +1037,7 @@ static int srp_prepare_fw_buff(struct device *dev)
 		return -ENOMEM;
 	}
 
-	srp.wbuf = kzalloc(WBUF_SIZE, GFP_KERNEL);
+	srp.wbuf = vzalloc(WBUF_SIZE);
 	if (!srp.wbuf) {
 		srp_err("Failed to allocation for WBUF!\n");
 		return -ENOMEM;
@@ -1045,7 +1092,7 @@ static int srp_remove_fw_buff(struct device *dev)
 					srp.fw_info.cga_pa);
 	dma_free_writecombine(dev, DMEM_SIZE, srp.fw_info.data,
 					srp.fw_info.data_pa);
-	kfree(srp.wbuf);
+	vfree(srp.wbuf);
 	kfree(srp.sp_data.ibuf);
 	kfree(srp.sp_data.obuf);
 	kfree(srp.sp_data.commbox);
@@ -1071,6 +1118,7 @@ static const struct file_operations srp_fops = {
 	.release	= srp_release,
 	.read		= srp_read,
 	.write		= srp_write,
+	.poll		= srp_poll,
 	.unlocked_ioctl	= srp_ioctl,
 	.mmap		= srp_mmap,
 };
@@ -23,7 +23,12 @@
 
 /* IBUF/OBUF Size */
 #define IBUF_SIZE	(0x4000)
-#define WBUF_SIZE	(IBUF_SIZE * 4)
+/*
+ * The write buffer holds compressed data ahead of the IBUFs, the bigger it
+ * is the longer the SRP decodes before userspace has to be woken up.
+ */
+#define WBUF_SIZE	(CONFIG_SND_SAMSUNG_ALP_WBUF_SIZE << 10)
+#define WBUF_LOW_THRESHOLD	(WBUF_SIZE / 2)
 #define OBUF_SIZE	(soc_is_exynos5250() ? \
 			(0x4000) : (0x8000))
 
@@ -171,8 +176,10 @@ struct srp_info {
 	/* Temporary BUF informaion */
 	unsigned char	*wbuf;
 	unsigned long	wbuf_size;
+	unsigned long	wbuf_rd;
 	unsigned long	wbuf_pos;
 	unsigned long	wbuf_fill_size;
+	unsigned int	ibuf_starved;
 
 	/* Decoding informaion */
 	unsigned long	set_bitstream_size;